@@ -12,10 +12,8 @@ using RobotOS
 rostypegen()
 using .sensor_msgs.msg, .std_msgs.msg
 
-const l1  = 0.3f0                  #wheel
-const l2  = 0.06f0                  #torso
-const k   = 10
-const α   = Float32(360.0/k/2.0 * pi/180.0)
+include("robotModel.jl")
+include("pbcInference.jl")
 const DEG_TO_RAD = pi/180.0
 const satu = 2.0f0
 
@@ -50,14 +48,19 @@ end
 
 function marginalize(state::Vector{T}, param; sampleNum=5) where {T<:Real}
     effort = 0.0f0
+    xi = inputLayer(state)      #the same features and posterior for every sample
+    q = getq(param)
     for i in 1:sampleNum
-        w = rand(getq(param))
-        effort += clamp(MLBasedESC.controller(npbc, inputLayer(state), w), -satu, satu)
+        w = rand(q)
+        effort += clamp(MLBasedESC.controller(npbc, xi, w), -satu, satu)
     end
 
     return clamp(effort/sampleNum, -satu, satu)
 end
 
+# marginalize() and map() of the control loop, in place over the same posterior
+const inference = PbcInference(chainWidths(Hd), unstackParams(ps)[1], LogExpFunctions.softplus.(unstackParams(ps)[2]))
+
 function initialState(ϕ0, θ0, ϕ0dot, θ0dot)
     @assert pi-α <= θ0 <= pi+α "Give an initial spoke angle for the spoke in contact. This will help set the rimless wheel in contact with the surface"
     
@@ -73,7 +76,9 @@ function initialState(ϕ0, θ0, ϕ0dot, θ0dot)
     return [x, y, ϕ, θ, xdot, ydot, ϕdot, θdot]
 end
 
-function update_state!(msg::sensor_msgs.msg.JointState, state::Vector)
+function update_state!(msg::sensor_msgs.msg.JointState, state::Vector, sensorSeq::Ref{String}, sampleCount::Ref{Int})
+    sensorSeq[] = msg.header.frame_id  # the Teensy's sample seq, echoed for COMMAND_LATENCY
+    sampleCount[] += 1
     state[1] = msg.position[1]       #torso
     state[2] = pi + msg.position[2]     #spoke0
     state[3] = msg.velocity[1]	 #torso
@@ -91,34 +96,50 @@ function isolateSpokeStates(state)
     return spoke0, spoke1 
 end
 
+function isolateSpokeStates!(spoke0, spoke1, state)
+    spoke0[1], spoke0[2], spoke0[3], spoke0[4] = state[1], state[2], state[3], state[4]
+    spoke1[1], spoke1[2], spoke1[3], spoke1[4] = state[1], state[5], state[3], state[6]
+    return spoke0, spoke1
+end
+
 function main()
     init_node("nn_controller")
     x0 = initialState(0.0f0, pi, 0.0f0, 0.0f0)
     torque = marginalize(x0, ps; sampleNum=10)
+    checkInference(inference, npbc, satu)
 
     state = zeros(Float32,7)
     state[2] = pi;
     state[5] = pi;
     
     sensorData = Vector{Vector{Float32}}()
-    pub = Publisher{JointState}("/torso_command", queue_size=1)
-    sub = Subscriber{JointState}("/sensors", update_state!, (state,), queue_size=1)
+    pub = Publisher{JointState}("torso_command", queue_size=1)
+    sensorSeq = Ref("")
+    sampleCount = Ref(0)          # bumped per /sensors message; the torque is only recomputed when it moves
+    lastCount = 0
+    sub = Subscriber{JointState}("sensors", update_state!, (state, sensorSeq, sampleCount), queue_size=1)
     @info "ROS node initialized. Loading models..."
 
 
     @info "Model loaded. Spinning ROS..."
     loop_rate = Rate(100.0)
     torque_msg = JointState();
+    torque_msg.effort = zeros(1)
+    spoke0 = zeros(Float32, 4)
+    spoke1 = zeros(Float32, 4)
     while !is_shutdown()
-        torque_msg.header = std_msgs.msg.Header()
-        torque_msg.header.stamp = RobotOS.now()
-        spoke0, spoke1 = isolateSpokeStates(state)
-        torque = marginalize(spoke0, ps; sampleNum=10)
-        # torque = map(state, ps)
-        torque_msg.effort = zeros(1)
-        torque_msg.effort[1] = torque
-        publish(pub, torque_msg)
-        # push!(sensorData, deepcopy(state))
+        if sampleCount[] != lastCount   # no new sample, the Teensy still holds the last torque
+            lastCount = sampleCount[]
+            torque_msg.header = std_msgs.msg.Header()
+            torque_msg.header.stamp = RobotOS.now()
+            torque_msg.header.frame_id = sensorSeq[]
+            isolateSpokeStates!(spoke0, spoke1, state)
+            torque = marginalize!(inference, spoke0, satu; sampleNum=10)
+            # torque = clamp(control!(inference, spoke0), -satu, satu)   # map()
+            torque_msg.effort[1] = torque
+            publish(pub, torque_msg)
+            # push!(sensorData, deepcopy(state))
+        end
         rossleep(loop_rate)
     end
     BSON.@save "/home/bsurobotics/repos/RimlessWheel/julia_ws/catkin_ws/src/julia_pkg/src/hardware_data/bayesian_sensor_data.bson" sensorData
@@ -130,9 +151,9 @@ function safe_shutdown_hack()
     run(`rostopic pub -1 /torso_command sensor_msgs/JointState "effort: [0.] "`, wait=false);
 end
 
-Base.atexit(safe_shutdown_hack)
-
-if !isinteractive()
+# run as a script only, not when traceControllers.jl includes it for the sysimage
+if abspath(PROGRAM_FILE) == @__FILE__
+    Base.atexit(safe_shutdown_hack)
     @info "Julia packages loaded. Starting main()"
     main()
 end
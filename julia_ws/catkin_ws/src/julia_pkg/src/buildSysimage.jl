@@ -0,0 +1,31 @@
+#!/usr/bin/env julia
+# Builds a sysimage with this project's packages and the code traceControllers.jl compiles,
+# so evaluatePbc.jl and bayesianPBC.jl go from start to first torque without loading and
+# JIT-compiling DiffEqFlux, Distributions and RobotOS:
+#
+#     julia buildSysimage.jl [OUT.so]      # default pbcControllers.so next to this file
+#     julia --sysimage OUT.so evaluatePbc.jl
+#
+# julia_pkg's `julia_sysimage` target runs it, julia_controller.launch's sysimage:=OUT.so
+# uses it. PackageCompiler is added to a temporary environment, so the project's Manifest
+# is left as it is. Build on the Pi itself: the image is compiled for the CPU it is built
+# on, and it goes stale when the Manifest changes. Start a roscore first to trace RobotOS.
+using Pkg
+
+const HERE = @__DIR__
+const OUT = length(ARGS) >= 1 ? abspath(ARGS[1]) : joinpath(HERE, "pbcControllers.so")
+
+Pkg.activate(; temp=true)
+Pkg.add("PackageCompiler")
+using PackageCompiler
+
+Pkg.activate(HERE)
+Pkg.instantiate()
+packages = [:DiffEqFlux, :MLBasedESC, :LogExpFunctions, :Distributions, :BSON, :RobotOS, :PyCall]
+
+@info "Building $(OUT), this takes a while"
+create_sysimage(packages;
+                sysimage_path=OUT,
+                project=HERE,
+                precompile_execution_file=joinpath(HERE, "traceControllers.jl"))
+@info "Wrote $(OUT)"
@@ -11,10 +11,7 @@ using RobotOS
 rostypegen()
 using .sensor_msgs.msg, .std_msgs.msg
 
-const l1  = 0.26f0                  #wheel
-const l2  = 0.05f0                  #torso
-const k   = 10
-const α   = Float32(360.0/k/2.0 * pi/180.0)
+include("robotModel.jl")
 const DEG_TO_RAD = pi/180.0
 
 unn  = FastChain(FastDense(6, 8, elu), 
@@ -40,7 +37,9 @@ function initialState(θ0, θ0dot, ϕ0, ϕ0dot)
     return [x, y, ϕ, θ, xdot, ydot, ϕdot, θdot]
 end
 
-function update_state!(msg::JointState, state::Vector)
+function update_state!(msg::JointState, state::Vector, sensorSeq::Ref{String}, sampleCount::Ref{Int})
+    sensorSeq[] = msg.header.frame_id  # the Teensy's sample seq, echoed for COMMAND_LATENCY
+    sampleCount[] += 1
     state[1] = msg.position[1]*DEG_TO_RAD
     state[2] = msg.position[2]*DEG_TO_RAD
     state[3] = msg.velocity[1]*DEG_TO_RAD
@@ -50,8 +49,11 @@ end
 function main()
     init_node("nn_controller")
     state = zeros(Float64,4)
-    pub = Publisher{JointState}("/torso_command", queue_size=1)
-    sub = Subscriber{JointState}("/sensors", update_state!, (state,), queue_size=1)
+    pub = Publisher{JointState}("torso_command", queue_size=1)
+    sensorSeq = Ref("")
+    sampleCount = Ref(0)          # bumped per /sensors message; the torque is only recomputed when it moves
+    lastCount = 0
+    sub = Subscriber{JointState}("sensors", update_state!, (state, sensorSeq, sampleCount), queue_size=1)
     @info "ROS node initialized. Loading models..."
 
     x0 = initialState(pi, -1.0f0, 0.0f0, 0.0f0)
@@ -61,12 +63,16 @@ function main()
     loop_rate = Rate(1000.0)
     torque_msg = JointState();
     while !is_shutdown()
-        torque_msg.header = std_msgs.msg.Header()
-        torque_msg.header.stamp = RobotOS.now()
-        torque = unn(inputLayer(state), ps)[1]
-        torque_msg.effort = zeros(1)
-        torque_msg.effort[1] = torque
-        publish(pub, torque_msg)
+        if sampleCount[] != lastCount   # no new sample, the Teensy still holds the last torque
+            lastCount = sampleCount[]
+            torque_msg.header = std_msgs.msg.Header()
+            torque_msg.header.stamp = RobotOS.now()
+            torque_msg.header.frame_id = sensorSeq[]
+            torque = unn(inputLayer(state), ps)[1]
+            torque_msg.effort = zeros(1)
+            torque_msg.effort[1] = torque
+            publish(pub, torque_msg)
+        end
         rossleep(loop_rate)
     end
     safe_shutdown_hack()
@@ -12,10 +12,8 @@ using RobotOS
 rostypegen()
 using .sensor_msgs.msg, .std_msgs.msg
 
-const l1  = 0.3f0                  #wheel
-const l2  = 0.06f0                  #torso
-const k   = 10
-const α   = Float32(360.0/k/2.0 * pi/180.0)
+include("robotModel.jl")
+include("pbcInference.jl")
 const DEG_TO_RAD = pi/180.0
 const satu = 1.0f0;
 
@@ -45,7 +43,9 @@ function initialState(ϕ0, θ0, ϕ0dot, θ0dot)
     return [x, y, ϕ, θ, xdot, ydot, ϕdot, θdot]
 end
 
-function update_state!(msg::sensor_msgs.msg.JointState, state::Vector)
+function update_state!(msg::sensor_msgs.msg.JointState, state::Vector, sensorSeq::Ref{String}, sampleCount::Ref{Int})
+    sensorSeq[] = msg.header.frame_id  # the Teensy's sample seq, echoed for COMMAND_LATENCY
+    sampleCount[] += 1
 
     state[1] = msg.position[1]       #torso
     state[2] = pi + msg.position[2]     #spoke0
@@ -64,38 +64,60 @@ function isolateSpokeStates(state)
     return spoke0, spoke1 
 end
 
+function isolateSpokeStates!(spoke0, spoke1, state)
+    spoke0[1], spoke0[2], spoke0[3], spoke0[4] = state[1], state[2], state[3], state[4]
+    spoke1[1], spoke1[2], spoke1[3], spoke1[4] = state[1], state[5], state[3], state[6]
+    return spoke0, spoke1
+end
+
 function computeTorque(spoke0)
     tau = 1.0f0*MLBasedESC.controller(npbc, inputLayer(spoke0), ps)
     return clamp(tau, -satu, satu) 
 end
 
+# computeTorque() of the control loop, in place
+const inference = PbcInference(chainWidths(Hd), ps)
+computeTorque!(spoke0) = clamp(control!(inference, spoke0), -satu, satu)
+
 function main()
     init_node("nn_controller")
     x0 = initialState(0.0f0, pi, 0.0f0, 0.0f0)
     torque = MLBasedESC.controller(npbc, inputLayer(x0), ps)
+    checkInference(inference, npbc, satu)
 
     state = zeros(Float32,7)
     state[2] = pi;
     state[5] = pi;
-    sensorData = Vector{Vector{Float32}}()
-    pub = Publisher{JointState}("/torso_command", queue_size=1)
-    sub = Subscriber{JointState}("/sensors", update_state!, (state,), queue_size=1)
+    sensorLog = sizehint!(Float32[], 7*100*3600)  # the states, flat, an hour of them before it grows
+    # relative names: in the node's namespace, e.g. ROS_NAMESPACE=wheel1 for one wheel of several
+    pub = Publisher{JointState}("torso_command", queue_size=1)
+    sensorSeq = Ref("")
+    sampleCount = Ref(0)          # bumped per /sensors message; the torque is only recomputed when it moves
+    lastCount = 0
+    sub = Subscriber{JointState}("sensors", update_state!, (state, sensorSeq, sampleCount), queue_size=1)
     @info "ROS node initialized. Loading models..."
 
     @info "Model loaded. Spinning ROS..."
     loop_rate = Rate(100.0)
     torque_msg = JointState();
+    torque_msg.effort = zeros(1)
+    spoke0 = zeros(Float32, 4)
+    spoke1 = zeros(Float32, 4)
     while !is_shutdown()
-        torque_msg.header = std_msgs.msg.Header()
-        torque_msg.header.stamp = RobotOS.now()
-        spoke0, spoke1 = isolateSpokeStates(state)
-        torque = computeTorque(spoke0)
-        torque_msg.effort = zeros(1)
-        torque_msg.effort[1] = torque
-        publish(pub, torque_msg)
-        push!(sensorData, deepcopy(state))
+        if sampleCount[] != lastCount   # no new sample, the Teensy still holds the last torque
+            lastCount = sampleCount[]
+            torque_msg.header = std_msgs.msg.Header()
+            torque_msg.header.stamp = RobotOS.now()
+            torque_msg.header.frame_id = sensorSeq[]
+            isolateSpokeStates!(spoke0, spoke1, state)
+            torque = computeTorque!(spoke0)
+            torque_msg.effort[1] = torque
+            publish(pub, torque_msg)
+            append!(sensorLog, state)
+        end
         rossleep(loop_rate)
     end
+    sensorData = [sensorLog[i:i + 6] for i in 1:7:length(sensorLog)]
     BSON.@save "/home/bsurobotics/repos/RimlessWheel/julia_ws/catkin_ws/src/julia_pkg/src/hardware_data/deterministic_sensor_data.bson" sensorData
     safe_shutdown_hack()
 end
@@ -105,9 +127,9 @@ function safe_shutdown_hack()
     run(`rostopic pub -1 /torso_command sensor_msgs/JointState "effort: [0.] "`, wait=false);
 end
 
-Base.atexit(safe_shutdown_hack)
-
-if !isinteractive()
+# run as a script only, not when traceControllers.jl includes it for the sysimage
+if abspath(PROGRAM_FILE) == @__FILE__
+    Base.atexit(safe_shutdown_hack)
     @info "Julia packages loaded. Starting main()"
     main()
 end
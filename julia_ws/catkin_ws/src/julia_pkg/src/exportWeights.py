@@ -0,0 +1,616 @@
+#!/usr/bin/env python3
+"""Convert the saved_weights networks into C++ headers for NeuralPBC.h.
+
+Each header defines a struct in namespace pbc_weights with the FastChain layer
+widths as a pbc::Chain type and the flat DiffEqFlux parameter vector, so the
+controller is specialized per architecture at compile time. Run by the
+Teensy's PlatformIO build (teensy/scripts/export_weights.py) and usable by
+hand:  ./exportWeights.py [--out DIR] [--samples N] [--seed S] [--draws KIND] [--prune T] [--states FILE] [names...]
+
+Bayesian networks get the posterior mean, its standard deviation and a bank
+of N samples drawn here with a fixed seed (see PosteriorBank.h), laid out
+parameter-major so the samples of one weight are contiguous. --draws halton
+makes the bank's normals scrambled Halton points through the Gaussian
+quantile in antithetic pairs, as PosteriorBank::drawQuasi() does, instead of
+iid ones. --network NAME FILE WIDTHS exports a file outside the table
+below, e.g. a student from teensy/host's distill: NAME.h from FILE
+(relative to saved_weights) with the FastChain WIDTHS, e.g. 6,8,7,1.
+
+Every network also gets an int16 copy for FixedPBC.h (the posterior mean for
+Bayesian ones), quantized per layer. The integer pass is run here against a
+float64 version of MLBasedESC.controller on seeded states around the upright
+contact, and the torque error it shows goes into the header and on stdout.
+
+Every network also gets a sparse pass for SparsePBC.h (of the posterior mean
+for Bayesian ones): the forward pass of values and tangents written out as
+straight-line code with the weights as literals, only the multiply-adds of
+weights at or above --prune in magnitude emitted (0 by default, which drops
+only exact zeros), neurons nothing reads any more left out and the first
+layer's tangent, a constant of the gains, folded. The pruned network is run
+against the dense one in float64 and the torque error goes into the header
+and on stdout, as the integer pass's does. --states takes the validation
+states of both from a dataset file of recorded runs (teensy/host's dataset,
+the first 6 columns) instead of the seeded ones, at most 4096 rows spread
+over it.
+
+Next to each header goes NAME.pbcw, the same float32 vector as a flat binary
+file for the Pi's pbc_controller to mmap at startup (~weights_dir) instead of
+the compiled-in copy, so retrained weights of the same widths need no
+rebuild. Little-endian: a 64-byte header (magic "PBW1", version, the FastChain
+widths, num_params, num_samples, data offset, an FNV-1a checksum of the data
+and the network's name), then at the data offset the vector, or for a
+Bayesian network the mean followed by the bank of samples, parameter-major.
+pbc_controller's weightFile.h reads it.
+
+Only files whose generated text changes are rewritten, so an unchanged
+network does not trigger a rebuild. The BSON reader covers the subset that
+BSON.@save writes for a Vector{Float32}/Vector{Float64}; no Julia needed.
+"""
+import argparse
+import math
+import os
+import random
+import statistics
+import struct
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+DEFAULT_OUT = os.path.normpath(os.path.join(HERE, "../../../../../teensy/lib/NeuralPBC/weights"))
+
+# name -> (file, FastChain widths, which part of the vector, note)
+# Hidden layers are elu and the output layer is linear, as in evaluatePbc.jl.
+# Bayesian files hold [mu; sigma] with std = softplus(sigma), see getq() in bayesianPBC.jl.
+NETWORKS = {
+    "deter_hardware_even_1mpers": ("deter_hardware_even_1mpers_6-8-8-7-7-1_elu.bson", (6, 8, 7, 1), "all", "evaluatePbc.jl"),
+    "deter2_hardware_even_1mpers": ("deter2_hardware_even_1mpers_6-8-8-7-7-1_elu.bson", (6, 8, 7, 1), "all", ""),
+    "hardware_even_deter_1mpers": ("hardware_even_deter_1mpers_6-8-8-7-7-1_elu.bson", (6, 8, 7, 1), "all", ""),
+    "deterministic_hardware": ("deterministic_hardware_6-8-8-7-7-1_elu.bson", (6, 8, 7, 1), "all", ""),
+    "hardware_even_688771": ("hardware_even_688771elu.bson", (6, 8, 7, 1), "all", ""),
+    "rw_bayesian": ("RW_bayesian_6-8-8-5-5-1_elu.bson", (6, 8, 7, 1), "posterior", "bayesianPBC.jl"),
+}
+NUM_GAINS = 6
+FIXED_ONE = 1 << 16
+# NAME.pbcw, see weightFile.h
+WEIGHT_FILE_MAGIC = 0x31574250  # "PBW1"
+WEIGHT_FILE_VERSION = 1
+WEIGHT_FILE_HEADER = struct.Struct("<IHH8HIIII24s")
+WEIGHT_FILE_MAX_WIDTHS = 8
+# states for the quantization error: torso angle, spoke angle from the upright contact, rates;
+# the spoke range is the 10-spoke wheel's +-alpha
+ERROR_STATES = 4096
+ERROR_RANGES = ((-0.5, 0.5), (-math.pi / 10, math.pi / 10), (-3.0, 3.0), (-3.0, 3.0))
+# a dataset file of recorded runs, see teensy/host/dataset.cpp
+DATASET_MAGIC = 0x31445752  # "RWD1"
+DATASET_HEADER = struct.Struct("<IHHIIQQQII16s")
+
+
+def read_document(data, offset):
+    size, = struct.unpack_from("<i", data, offset)
+    end = offset + size
+    offset += 4
+    doc = {}
+    while offset < end - 1:
+        kind = data[offset]
+        key_end = data.index(b"\0", offset + 1)
+        key = data[offset + 1:key_end].decode()
+        offset = key_end + 1
+        if kind == 0x01:
+            value, = struct.unpack_from("<d", data, offset)
+            offset += 8
+        elif kind == 0x02:
+            length, = struct.unpack_from("<i", data, offset)
+            value = data[offset + 4:offset + 3 + length].decode()
+            offset += 4 + length
+        elif kind in (0x03, 0x04):
+            value, offset = read_document(data, offset)
+            if kind == 0x04:
+                value = [value[str(i)] for i in range(len(value))]
+        elif kind == 0x05:
+            length, = struct.unpack_from("<i", data, offset)
+            value = data[offset + 5:offset + 5 + length]
+            offset += 5 + length
+        elif kind == 0x08:
+            value = data[offset] != 0
+            offset += 1
+        elif kind == 0x0A:
+            value = None
+        elif kind == 0x10:
+            value, = struct.unpack_from("<i", data, offset)
+            offset += 4
+        elif kind == 0x12:
+            value, = struct.unpack_from("<q", data, offset)
+            offset += 8
+        else:
+            raise ValueError("unsupported BSON element 0x%02x at %d" % (kind, offset))
+        doc[key] = value
+    return doc, end
+
+
+def load_vector(path, key="param"):
+    with open(path, "rb") as f:
+        doc, _ = read_document(f.read(), 0)
+    array = doc[key]
+    if not isinstance(array, dict) or array.get("tag") != "array":
+        raise ValueError("%s: %s is not a Julia array" % (path, key))
+    element = array["type"]["name"][-1]
+    formats = {"Float32": "f", "Float64": "d"}
+    if element not in formats:
+        raise ValueError("%s: unsupported element type %s" % (path, element))
+    raw = array["data"]
+    count = len(raw) // struct.calcsize(formats[element])
+    return list(struct.unpack("<%d%s" % (count, formats[element]), raw))
+
+
+def param_count(widths):
+    return sum(i * o + o for i, o in zip(widths[:-1], widths[1:])) + NUM_GAINS
+
+
+def float_literal(x):
+    # %.9g round-trips a float32; keep it a valid C++ float literal
+    s = "%.9g" % struct.unpack("<f", struct.pack("<f", x))[0]
+    return s + ("f" if ("." in s or "e" in s) else ".0f")
+
+
+def softplus(x):
+    return max(x, 0.0) + math.log1p(math.exp(-abs(x)))
+
+
+def layers(widths):
+    """(offset, in, out) of each FastDense in the flat vector"""
+    offset, out = 0, []
+    for i, o in zip(widths[:-1], widths[1:]):
+        out.append((offset, i, o))
+        offset += i * o + o
+    return out
+
+
+def input_layer(q1, q2, w1, w2):
+    return [math.cos(q1), math.sin(q1), math.cos(q2), math.sin(q2), w1, w2]
+
+
+def reference_control(params, widths, xi):
+    """MLBasedESC.controller in float64: dot(dHd/dxi, gains)"""
+    acts, derivs = [xi], []
+    for offset, n_in, n_out in layers(widths)[:-1]:
+        x, y, dy = acts[-1], [], []
+        for o in range(n_out):
+            z = params[offset + n_in * n_out + o] + sum(params[offset + i * n_out + o] * x[i] for i in range(n_in))
+            y.append(z if z > 0 else math.expm1(z))
+            dy.append(1.0 if z > 0 else math.exp(z))
+        acts.append(y)
+        derivs.append(dy)
+    offset, n_in, _ = layers(widths)[-1]
+    g = params[offset:offset + n_in]
+    for (offset, n_in, n_out), dy in reversed(list(zip(layers(widths)[:-1], derivs))):
+        g = [g[o] * dy[o] for o in range(n_out)]
+        g = [sum(params[offset + i * n_out + o] * g[o] for o in range(n_out)) for i in range(n_in)]
+    gains = params[param_count(widths) - NUM_GAINS:]
+    return sum(a * b for a, b in zip(g, gains))
+
+
+def quantize(params, widths):
+    """int16 copy and per-layer shifts: the largest scale 2^shift that keeps each layer in range"""
+    def shift_for(values):
+        peak = max(abs(v) for v in values) or 1.0
+        shift = 15
+        while shift > 0 and round(peak * (1 << shift)) > 32767:
+            shift -= 1
+        return shift
+    spans = [(offset, offset + i * o + o) for offset, i, o in layers(widths)]
+    spans.append((param_count(widths) - NUM_GAINS, param_count(widths)))
+    values, shifts = [], []
+    for start, end in spans:
+        shift = shift_for(params[start:end])
+        shifts.append(shift)
+        values += [int(round(v * (1 << shift))) for v in params[start:end]]
+    return values, shifts
+
+
+def fixed_expm1(z):
+    """pbc::fixed::expm1(), exp(z) - 1 and exp(z) in Q16"""
+    if z <= -16 * FIXED_ONE:
+        return -FIXED_ONE, 0
+    t = (z * 94548) >> 16
+    n = t >> 16
+    f = t - n * FIXED_ONE
+    p = 896
+    for c in (3391, 15834, 45415, 65536):
+        p = c + ((p * f) >> 16)
+    e = p >> -n
+    return e - FIXED_ONE, e
+
+
+def fixed_control(values, shifts, widths, xi):
+    """FixedPBC::control() before the clamp, the same integer steps: values and tangents
+    along the gains through the layers together"""
+    def from_shift(v, s):
+        return v << (16 - s) if s <= 16 else v >> (s - 16)
+    x = [int(round(v * FIXED_ONE)) for v in xi]
+    t = [from_shift(v, shifts[-1]) for v in values[param_count(widths) - NUM_GAINS:]]
+    for (offset, n_in, n_out), s in zip(layers(widths)[:-1], shifts):
+        y, dy = [], []
+        for o in range(n_out):
+            w = [values[offset + i * n_out + o] for i in range(n_in)]
+            z = ((values[offset + n_in * n_out + o] << 16) + sum(a * b for a, b in zip(w, x))) >> s
+            dz = sum(a * b for a, b in zip(w, t)) >> s
+            if z > 0:
+                y.append(z)
+                dy.append(dz)
+            else:
+                e1, e = fixed_expm1(z)
+                y.append(e1)
+                dy.append((dz * e) >> 16)
+        x, t = y, dy
+    offset, n_in, _ = layers(widths)[-1]
+    return (sum(a * b for a, b in zip(values[offset:offset + n_in], t)) >> shifts[len(widths) - 2]) / FIXED_ONE
+
+
+def seeded_states():
+    """ERROR_STATES inputLayer() vectors drawn over ERROR_RANGES around the upright contact"""
+    rng = random.Random(1)
+    states = []
+    for _ in range(ERROR_STATES):
+        q1, q2, w1, w2 = [rng.uniform(lo, hi) for lo, hi in ERROR_RANGES]
+        states.append(input_layer(q1, math.pi + q2, w1, w2))
+    return states
+
+
+def recorded_states(path):
+    """up to ERROR_STATES inputLayer() rows of a dataset file, spread evenly over it; the
+    NaN rows padding a short chunk are skipped"""
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < DATASET_HEADER.size:
+        raise ValueError("%s: too short for a dataset header" % path)
+    magic, _, columns, chunk_rows, chunks, _, data_offset, _, _, _, _ = DATASET_HEADER.unpack_from(data)
+    if magic != DATASET_MAGIC or columns < 6:
+        raise ValueError("%s is not a dataset of recorded runs (teensy/host dataset)" % path)
+    row = struct.Struct("<6f")
+    slots = chunk_rows * chunks
+    step = max(1, slots // ERROR_STATES)
+    states = []
+    for r in range(0, slots, step):
+        xi = list(row.unpack_from(data, data_offset + r * columns * 4))
+        if all(math.isfinite(v) for v in xi):
+            states.append(xi)
+    if not states:
+        raise ValueError("%s holds no recorded states" % path)
+    return states[:ERROR_STATES]
+
+
+def control_error(candidate, params, widths, states):
+    """max and rms torque error of candidate(xi) against the float64 controller"""
+    worst, total = 0.0, 0.0
+    for xi in states:
+        error = candidate(xi) - reference_control(params, widths, xi)
+        worst = max(worst, abs(error))
+        total += error * error
+    return worst, math.sqrt(total / len(states))
+
+
+def fixed_struct(name, params, widths, states, where):
+    values, shifts = quantize(params, widths)
+    worst, rms = control_error(lambda xi: fixed_control(values, shifts, widths, xi), params, widths, states)
+    print("exportWeights: %s fixed point: max |du| %.2e, rms %.2e over %d %s" % (name, worst, rms, len(states), where))
+    lines = [
+        "",
+        "    // int16 for FixedPBC.h, layer l scaled by 2^shifts()[l] and the gains by the last;",
+        "    // against float64 over %d %s: max |u error| %.2e, rms %.2e" % (len(states), where, worst, rms),
+        "    struct fixed {",
+        "        static constexpr int num_shifts = %d;" % len(shifts),
+        "        static const int8_t* shifts() {",
+        "            static const int8_t values[num_shifts] = {%s};" % ", ".join(str(x) for x in shifts),
+        "            return values;",
+        "        }",
+        "        static const int16_t* params() {",
+        "            static const int16_t values[num_params] = {",
+    ]
+    for i in range(0, len(values), 12):
+        lines.append("                " + ", ".join(str(x) for x in values[i:i + 12]) + ",")
+    lines += [
+        "            };",
+        "            return values;",
+        "        }",
+        "    };",
+    ]
+    return lines
+
+
+def prune(params, widths, threshold):
+    """params with the weights (not the biases or gains) below threshold in magnitude set to
+    zero, and the number of non-zero weights left"""
+    pruned, kept = list(params), 0
+    for offset, n_in, n_out in layers(widths):
+        for k in range(offset, offset + n_in * n_out):
+            if pruned[k] == 0.0 or abs(pruned[k]) < threshold:
+                pruned[k] = 0.0
+            else:
+                kept += 1
+    return pruned, kept
+
+
+def live_neurons(pruned, widths):
+    """live[l][o]: whether anything downstream reads neuron o of hidden layer l"""
+    hidden = layers(widths)[:-1]
+    live = [[False] * n_out for _, _, n_out in hidden]
+    offset, n_in, _ = layers(widths)[-1]
+    reads = [pruned[offset + i] != 0.0 for i in range(n_in)]
+    for l in range(len(hidden) - 1, -1, -1):
+        live[l] = reads
+        if l == 0:
+            break
+        offset, n_in, n_out = hidden[l]
+        reads = [any(live[l][o] and pruned[offset + i * n_out + o] != 0.0 for o in range(n_out)) for i in range(n_in)]
+    return live
+
+
+def weighted_sum(start, terms):
+    """start followed by + or - |w|*name for each (w, name), as a C++ expression"""
+    text = start
+    for w, name in terms:
+        if text is None:
+            text = ("-" if w < 0 else "") + float_literal(abs(w)) + "*" + name
+        else:
+            text += (" - " if w < 0 else " + ") + float_literal(abs(w)) + "*" + name
+    return text if text is not None else "0.0f"
+
+
+def sparse_struct(name, params, widths, threshold, states, where):
+    count = param_count(widths)
+    pruned, kept = prune(params, widths, threshold)
+    total = sum(i * o for i, o in zip(widths[:-1], widths[1:]))
+    worst, rms = control_error(lambda xi: reference_control(pruned, widths, xi), params, widths, states)
+    print("exportWeights: %s pruned below %g: %d of %d weights, max |du| %.2e, rms %.2e over %d %s"
+          % (name, threshold, kept, total, worst, rms, len(states), where))
+    gains = params[count - NUM_GAINS:]
+    live = live_neurons(pruned, widths)
+    code = []
+    inputs = ["x[%d]" % i for i in range(widths[0])]
+    tangents = None
+    for l, (offset, n_in, n_out) in enumerate(layers(widths)[:-1]):
+        outputs, out_tangents = [], []
+        for o in range(n_out):
+            y, dy = "y%d_%d" % (l, o), "dy%d_%d" % (l, o)
+            outputs.append(y)
+            out_tangents.append(dy)
+            if not live[l][o]:
+                continue
+            weights = [(pruned[offset + i * n_out + o], i) for i in range(n_in)]
+            weights = [(w, i) for w, i in weights if w != 0.0 and inputs[i] is not None]
+            z = weighted_sum(float_literal(pruned[offset + n_in * n_out + o]), [(w, inputs[i]) for w, i in weights])
+            if tangents is None:
+                # the gains are the first layer's tangent, so its derivative is a constant
+                dz = float_literal(sum(w * gains[i] for w, i in weights))
+            else:
+                dz = weighted_sum(None, [(w, tangents[i]) for w, i in weights])
+            code += [
+                "float %s = %s;" % (y, z),
+                "float %s = %s;" % (dy, dz),
+                "if (%s <= 0.0f) {" % y,
+                "    %s = Elu::expm1(%s);" % (y, y),
+                "    %s *= %s + 1.0f;" % (dy, y),
+                "}",
+            ]
+        inputs = [y if live[l][o] else None for o, y in enumerate(outputs)]
+        tangents = [dy if live[l][o] else None for o, dy in enumerate(out_tangents)]
+    offset, n_in, _ = layers(widths)[-1]
+    weights = [(pruned[offset + i], i) for i in range(n_in) if pruned[offset + i] != 0.0]
+    code += [
+        "*dh = %s;" % weighted_sum(None, [(w, tangents[i]) for w, i in weights]),
+        "return %s;" % weighted_sum(float_literal(pruned[offset + n_in]), [(w, inputs[i]) for w, i in weights]),
+    ]
+    lines = [
+        "",
+        "    // straight-line pass for SparsePBC.h, weights below %g pruned: %d of %d kept;" % (threshold, kept, total),
+        "    // against the dense network over %d %s: max |u error| %.2e, rms %.2e" % (len(states), where, worst, rms),
+        "    struct sparse {",
+        "        static constexpr int num_weights = %d;" % total,
+        "        static constexpr int num_kept = %d;" % kept,
+        "",
+        "        // Hd(x) and into dh its derivative along the gains, as Chain::tangent()",
+        "        template<class Elu = pbc::ExactElu>",
+        "        static inline float tangent(const float* x, float* dh) {",
+    ]
+    lines += ["            " + line for line in code]
+    lines += [
+        "        }",
+        "    };",
+    ]
+    return lines
+
+
+def array_function(name, values, length="num_params", comment=None):
+    lines = ["    // " + comment] if comment else []
+    lines += [
+        "    static const float* %s() {" % name,
+        "        static const float values[%s] = {" % length,
+    ]
+    for i in range(0, len(values), 6):
+        lines.append("            " + ", ".join(float_literal(x) for x in values[i:i + 6]) + ",")
+    lines += [
+        "        };",
+        "        return values;",
+        "    }",
+    ]
+    return lines
+
+
+def next_prime(n):
+    p = n + 1
+    while any(p % d == 0 for d in range(2, int(p ** 0.5) + 1)):
+        p += 1
+    return p
+
+
+def halton_normals(dims, num_samples, seed):
+    """num_samples vectors of dims standard normals: scrambled Halton points, one prime
+    base per dimension with its digits through a seeded affine permutation, through the
+    quantile, with sample 2j + 1 the negative of sample 2j."""
+    rng = random.Random(seed)
+    quantile = statistics.NormalDist().inv_cdf
+    draws = [[0.0] * dims for _ in range(num_samples)]
+    base = 1
+    for k in range(dims):
+        base = next_prime(base)
+        a = rng.randrange(1, base) if base > 2 else 1
+        b = rng.randrange(base)
+        for s in range(0, num_samples, 2):
+            i, u, weight, last = s // 2 + 1, 0.0, 1.0 / base, 1.0 / base
+            while i > 0:
+                u += ((a * (i % base) + b) % base) * weight
+                last, weight, i = weight, weight / base, i // base
+            z = quantile(u + 0.5 * last)
+            draws[s][k] = z
+            if s + 1 < num_samples:
+                draws[s + 1][k] = -z
+    return draws
+
+
+def fnv1a(data):
+    h = 0x811C9DC5
+    for byte in data:
+        h = ((h ^ byte) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def weight_file(name, widths, values, num_samples):
+    """NAME.pbcw: the header, then values as float32 at offset 64"""
+    if len(widths) > WEIGHT_FILE_MAX_WIDTHS:
+        raise ValueError("%s: %d widths, a weight file holds at most %d" % (name, len(widths), WEIGHT_FILE_MAX_WIDTHS))
+    data = struct.pack("<%df" % len(values), *values)
+    padded = tuple(widths) + (0,) * (WEIGHT_FILE_MAX_WIDTHS - len(widths))
+    header = WEIGHT_FILE_HEADER.pack(WEIGHT_FILE_MAGIC, WEIGHT_FILE_VERSION, len(widths), *padded,
+                                     param_count(widths), num_samples, WEIGHT_FILE_HEADER.size, fnv1a(data),
+                                     name.encode()[:23])
+    return header + data
+
+
+def render(name, file, widths, part, note, num_samples, seed, draws="random", threshold=0.0, states=None):
+    """(the header's text, the weight file's bytes); states the validation states, the
+    seeded ones if None"""
+    params = load_vector(os.path.join(HERE, "saved_weights", file))
+    count = param_count(widths)
+    if part == "all" and len(params) != count:
+        raise ValueError("%s has %d parameters, %s needs %d" % (file, len(params), widths, count))
+    if part == "posterior" and len(params) != 2 * count:
+        raise ValueError("%s has %d parameters, [mu; sigma] of %s needs %d" % (file, len(params), widths, 2 * count))
+    where = "states" if states is None else "recorded states"
+    if states is None:
+        states = seeded_states()
+
+    body = [
+        "    typedef pbc::Chain<%s> chain;" % ", ".join(str(w) for w in widths),
+        "    static constexpr int num_params = %d;" % count,
+    ]
+    if part == "all":
+        body += array_function("params", params)
+        body += fixed_struct(name, params, widths, states, where)
+        body += sparse_struct(name, params, widths, threshold, states, where)
+        blob = weight_file(name, widths, params, 0)
+    else:
+        mean = params[:count]
+        std = [softplus(x) for x in params[count:]]
+        if draws == "halton":
+            normals = halton_normals(count, num_samples, seed)
+            how = "mean + stddev .* z, z scrambled Halton normals in antithetic pairs, seed %d" % seed
+        else:
+            rng = random.Random(seed)
+            normals = [[rng.gauss(0.0, 1.0) for _ in range(count)] for _ in range(num_samples)]
+            how = "mean + stddev .* randn, seed %d" % seed
+        draws = [[m + s * z for m, s, z in zip(mean, std, zs)] for zs in normals]
+        body += [
+            "    static constexpr int num_samples = %d;" % num_samples,
+            "",
+            "    // the mean doubles as the network of map() in bayesianPBC.jl",
+            "    static const float* params() { return mean(); }",
+        ]
+        body += array_function("mean", mean)
+        body += array_function("stddev", std, comment="softplus(sigma)")
+        body += array_function("samples", [d[k] for k in range(count) for d in draws], "num_params*num_samples",
+                               how + "; samples()[k*num_samples + s] is parameter k of sample s")
+        body += fixed_struct(name, mean, widths, states, where)
+        body += sparse_struct(name, mean, widths, threshold, states, where)
+        blob = weight_file(name, widths, mean + [d[k] for k in range(count) for d in draws], num_samples)
+
+    guard = "PbcWeights_%s_h" % name
+    lines = [
+        "// Generated by julia_pkg/src/exportWeights.py from saved_weights/%s, do not edit." % file,
+        "#ifndef %s" % guard,
+        "#define %s" % guard,
+        "",
+        "#include \"NeuralPBC.h\"",
+        "",
+        "namespace pbc_weights {",
+        "",
+        "// %s%s" % (file, (", " + note) if note else ""),
+        "struct %s {" % name,
+    ] + body + [
+        "};",
+        "",
+        "} // namespace pbc_weights",
+        "",
+        "#endif //%s" % guard,
+        "",
+    ]
+    return "\n".join(lines), blob
+
+
+def write_if_changed(path, content):
+    binary = isinstance(content, bytes)
+    if os.path.exists(path):
+        with open(path, "rb" if binary else "r") as f:
+            if f.read() == content:
+                return False
+    # a new file renamed over the old, so a controller with the old .pbcw mapped keeps it
+    with open(path + ".tmp", "wb" if binary else "w") as f:
+        f.write(content)
+    os.replace(path + ".tmp", path)
+    return True
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--out", default=DEFAULT_OUT, help="header directory (default: %(default)s)")
+    parser.add_argument("--samples", type=int, default=10, help="posterior samples per Bayesian network (default: %(default)s)")
+    parser.add_argument("--seed", type=int, default=0, help="seed for the posterior samples (default: %(default)s)")
+    parser.add_argument("--draws", choices=("random", "halton"), default="random",
+                        help="how the posterior samples are drawn (default: %(default)s)")
+    parser.add_argument("--network", nargs=3, action="append", default=[], metavar=("NAME", "FILE", "WIDTHS"),
+                        help="also export FILE (deterministic) as NAME with the FastChain WIDTHS")
+    parser.add_argument("--prune", type=float, default=0.0, metavar="T",
+                        help="leave the weights below T in magnitude out of the sparse pass (default: %(default)s)")
+    parser.add_argument("--states", metavar="FILE",
+                        help="validate the fixed-point and sparse passes on a dataset file of recorded runs")
+    parser.add_argument("names", nargs="*", help="networks to export (default: all)")
+    args = parser.parse_args(argv)
+
+    networks = dict(NETWORKS)
+    for name, file, widths in args.network:
+        try:
+            networks[name] = (file, tuple(int(w) for w in widths.split(",")), "all", "")
+        except ValueError:
+            parser.error("--network %s: widths %s are not comma-separated integers" % (name, widths))
+    names = args.names or (sorted(NETWORKS) if not args.network else [n for n, _, _ in args.network])
+    unknown = [n for n in names if n not in networks]
+    if unknown:
+        parser.error("unknown network(s) %s, known: %s" % (", ".join(unknown), ", ".join(sorted(NETWORKS))))
+
+    states = None
+    if args.states:
+        try:
+            states = recorded_states(args.states)
+        except (OSError, ValueError) as e:
+            parser.error("--states: %s" % e)
+
+    os.makedirs(args.out, exist_ok=True)
+    for name in names:
+        text, blob = render(name, *networks[name], num_samples=args.samples, seed=args.seed, draws=args.draws,
+                            threshold=args.prune, states=states)
+        for path, content in ((os.path.join(args.out, name + ".h"), text), (os.path.join(args.out, name + ".pbcw"), blob)):
+            if write_if_changed(path, content):
+                print("exportWeights: wrote %s" % path)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,128 @@
+# Allocation-free inference for the control loops of evaluatePbc.jl and bayesianPBC.jl.
+#
+# The same inputLayer and the same u = MLBasedESC.controller(npbc, xi, p) = dot(dHd/dxi, gains),
+# the gains the last 6 entries of p, but computed as teensy/lib/NeuralPBC/NeuralPBC.h does: one
+# forward-mode pass in which each FastDense carries its values and their tangent along the
+# gains, into buffers allocated once. MLBasedESC.controller takes a fresh gradient every call,
+# getq builds an MvNormal and rand draws a new vector for every sample, and the garbage of that
+# shows up as GC pauses in the control timing. marginalize! draws its samples in place from the
+# posterior's fixed mean and softplus(sigma), and checkInference compares the pass against
+# MLBasedESC.controller and checks that a call allocates nothing.
+#
+# FastDense stores W (out x in) column-major and then b, so W[o, i] is p[offset + (i-1)*out + o].
+using Random
+
+struct PbcInference
+    widths::Vector{Int}             # FastChain widths, input to output
+    params::Vector{Float32}         # the network, or the posterior mean
+    σ::Vector{Float32}              # softplus(sigma) of a posterior, empty for one network
+    xi::Vector{Float32}             # inputLayer!
+    gains::Vector{Float32}          # the tangent fed to the first layer
+    y::Vector{Vector{Float32}}      # each hidden layer's values
+    dy::Vector{Vector{Float32}}     # and tangents
+    w::Vector{Float32}              # one posterior draw
+    z::Vector{Float32}              # its standard normals
+end
+
+function PbcInference(widths, params::AbstractVector, σ::AbstractVector=Float32[])
+    widths = collect(Int, widths)
+    hidden = widths[2:end-1]
+    n = length(params)
+    PbcInference(widths, Vector{Float32}(params), Vector{Float32}(σ), zeros(Float32, widths[1]), zeros(Float32, widths[1]),
+                 [zeros(Float32, h) for h in hidden], [zeros(Float32, h) for h in hidden],
+                 zeros(Float32, isempty(σ) ? 0 : n), zeros(Float32, isempty(σ) ? 0 : n))
+end
+
+# FastChain(FastDense(in, out, ...), ...) widths, input to output
+chainWidths(chain) = [chain.layers[1].in; [layer.out for layer in chain.layers]]
+
+# inputLayer(x) into xi
+function inputLayer!(xi::Vector{Float32}, x::AbstractVector)
+    xi[2], xi[1] = sincos(Float32(x[1]))
+    xi[4], xi[3] = sincos(Float32(x[2]))
+    xi[5] = x[3]
+    xi[6] = x[4]
+    return xi
+end
+
+# Unclamped u for the parameters p at inf.xi
+function forwardControl!(inf::PbcInference, p::Vector{Float32})
+    widths = inf.widths
+    gainOffset = length(p) - length(inf.gains)
+    for i in eachindex(inf.gains)
+        inf.gains[i] = p[gainOffset + i]
+    end
+    x, t = inf.xi, inf.gains
+    offset = 0
+    for l in 1:length(widths) - 2
+        nIn, nOut = widths[l], widths[l + 1]
+        y, dy = inf.y[l], inf.dy[l]
+        @inbounds for o in 1:nOut
+            z = p[offset + nIn*nOut + o]
+            dz = 0.0f0
+            for i in 1:nIn
+                w = p[offset + (i - 1)*nOut + o]
+                z += w*x[i]
+                dz += w*t[i]
+            end
+            if z > 0
+                y[o], dy[o] = z, dz
+            else
+                e = expm1(z)        # elu, with elu'(z) = e + 1 below zero
+                y[o], dy[o] = e, (e + 1.0f0)*dz
+            end
+        end
+        offset += nIn*nOut + nOut
+        x, t = y, dy
+    end
+    u = 0.0f0
+    @inbounds for i in 1:widths[end - 1]
+        u += p[offset + i]*t[i]
+    end
+    return u
+end
+
+# Unclamped u of the network (or the posterior mean) at state
+function control!(inf::PbcInference, state::AbstractVector)
+    inputLayer!(inf.xi, state)
+    return forwardControl!(inf, inf.params)
+end
+
+# marginalize() in place: the mean of sampleNum clamped controls, each on a fresh draw
+# params + σ .* randn
+function marginalize!(inf::PbcInference, state::AbstractVector, satu::Float32; sampleNum=5)
+    inputLayer!(inf.xi, state)
+    effort = 0.0f0
+    for _ in 1:sampleNum
+        randn!(inf.z)
+        @inbounds for k in eachindex(inf.w)
+            inf.w[k] = inf.params[k] + inf.σ[k]*inf.z[k]
+        end
+        effort += clamp(forwardControl!(inf, inf.w), -satu, satu)
+    end
+    return clamp(effort/sampleNum, -satu, satu)
+end
+
+# Logs the largest difference to MLBasedESC.controller over a few states around the upright
+# contact and the bytes one call allocates; warns if either is off
+function checkInference(inf::PbcInference, npbc, satu::Float32)
+    worst = 0.0f0
+    state = zeros(Float32, 4)
+    for θ in (pi - α/2, pi, pi + α/2), ω in (-2.0f0, 0.0f0, 2.0f0)
+        state[1], state[2], state[3], state[4] = 0.1f0, θ, ω, -ω
+        reference = MLBasedESC.controller(npbc, [cos(state[1]), sin(state[1]), cos(state[2]), sin(state[2]), state[3], state[4]],
+                                          inf.params)
+        worst = max(worst, abs(control!(inf, state) - reference))
+    end
+    bytes = @allocated control!(inf, state)
+    if !isempty(inf.σ)
+        marginalize!(inf, state, satu; sampleNum=2)
+        bytes = max(bytes, @allocated marginalize!(inf, state, satu; sampleNum=2))
+    end
+    if bytes > 0 || !(worst <= 1.0f-3)
+        @warn "In-place inference: $(bytes) bytes per call, max |u - MLBasedESC.controller| = $(worst)"
+    else
+        @info "In-place inference: allocation-free, max |u - MLBasedESC.controller| = $(worst)"
+    end
+    return bytes == 0
+end
@@ -0,0 +1,6 @@
+# Rimless wheel parameters used by the scripts; mirrors RimlessWheelModel in
+# teensy/lib/RobotModel/RobotModel.h, change both together.
+const l1  = 0.3f0                  #wheel
+const l2  = 0.06f0                  #torso
+const k   = 10
+const α   = Float32(360.0/k/2.0 * pi/180.0)
@@ -0,0 +1,79 @@
+# Trace run for buildSysimage.jl: what evaluatePbc.jl and bayesianPBC.jl compile before their
+# first torque, so the sysimage has it ahead of time. Both scripts are included, which loads
+# their packages, weights and message types without running main(), and their controllers
+# are called on the states main() feeds them: the warm-up's Float64 x0 and the Float32 spoke
+# states of /sensors, through both MLBasedESC.controller and pbcInference.jl's in-place pass.
+# The second include redefines the first's globals (satu, ps, npbc, inference) with
+# a warning; each script is traced before that.
+#
+# With a ROS master reachable at ROS_MASTER_URI, a node also publishes and receives a few
+# JointStates on its own topic, for RobotOS's publish and subscriber callback paths. Without
+# one those are left to JIT at the controller's start-up.
+using Sockets
+
+const RATES = (-2.0f0, 0.0f0, 2.0f0)
+
+function traceStates(f)
+    f(initialState(0.0f0, pi, 0.0f0, 0.0f0))
+    for θ in (pi - α/2, pi, pi + α/2), ω in RATES     # α from robotModel.jl, the scripts include it
+        state = zeros(Float32, 7)
+        state[1], state[2], state[3], state[4], state[5] = 0.1f0, θ, ω, ω, θ
+        spoke0, spoke1 = isolateSpokeStates(state)
+        f(spoke0)
+        f(spoke1)
+    end
+end
+
+function rosMasterUp()
+    uri = get(ENV, "ROS_MASTER_URI", "")
+    m = match(r"^\w+://([^:/]+):(\d+)", uri)
+    m === nothing && return false
+    try
+        close(connect(m.captures[1], parse(Int, m.captures[2])))
+        return true
+    catch
+        return false
+    end
+end
+
+function traceRos()
+    init_node("pbc_sysimage_trace", anonymous=true)
+    topic = "pbc_sysimage_trace/joint_states"    # not /torso_command, nothing here reaches the wheel
+    state = zeros(Float32, 7)
+    sensorSeq = Ref("")
+    sampleCount = Ref(0)
+    pub = Publisher{JointState}(topic, queue_size=1)
+    sub = Subscriber{JointState}(topic, update_state!, (state, sensorSeq, sampleCount), queue_size=1)
+    rate = Rate(100.0)
+    msg = JointState()
+    for i in 1:50
+        msg.header = std_msgs.msg.Header()
+        msg.header.stamp = RobotOS.now()
+        msg.header.frame_id = string(i)
+        msg.position = Float64[0.0, 0.0, 0.0, 0.0]
+        msg.velocity = Float64[0.0, 0.0, 0.0]
+        msg.effort = zeros(1)
+        publish(pub, msg)
+        rossleep(rate)
+        sampleCount[] >= 5 && break
+    end
+    @info "Traced RobotOS: $(sampleCount[]) JointStates received"
+end
+
+include("bayesianPBC.jl")
+traceStates(x -> marginalize(x, ps; sampleNum=10))
+traceStates(x -> map(x, ps))
+traceStates(x -> marginalize!(inference, x, satu; sampleNum=10))
+checkInference(inference, npbc, satu)
+
+include("evaluatePbc.jl")
+traceStates(x -> MLBasedESC.controller(npbc, inputLayer(x), ps))
+traceStates(computeTorque)
+traceStates(computeTorque!)
+checkInference(inference, npbc, satu)
+
+if rosMasterUp()
+    traceRos()
+else
+    @warn "No ROS master at ROS_MASTER_URI, RobotOS's publish and subscribe paths are not traced"
+end
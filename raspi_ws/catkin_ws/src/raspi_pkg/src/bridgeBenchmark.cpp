@@ -0,0 +1,495 @@
+#include "ros/ros.h"
+#include <sensor_msgs/JointState.h>
+#include <raspi_pkg/SensorState.h>
+#include <FlightLogFormat.h>
+#include "rosserialProtocol.h"
+#include "realtime.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//BridgeBenchmark is a stand-in Teensy for the Pi's control path: it opens a pseudo-tty, links
+//it at ~link for a teensy_bridge to open as its port (bridge_benchmark.launch), and answers the
+//bridge's topic request like the firmware, with /sensors_packed and the ~command_topic
+//subscriber. It then replays a flight log's samples (~log, a run_recorder or FLIGHTnn.BIN log,
+//looped) as raspi_pkg/SensorState frames at each of ~rates Hz for ~duration seconds, and times
+//every torque the bridge writes back against the sample whose seq its frame_id echoes.
+//
+//Per rate it reports the end-to-end latency (p50, p99, max), the samples never answered, and
+//the CPU time per sample of each process named in ~processes. With ~stages it also subscribes
+//to /sensors and /torso_command, which splits the latency into bridge in (pty to /sensors),
+//controller (/sensors to /torso_command) and bridge out (to the pty); the two subscriptions
+//are an extra /sensors subscriber and serialization the bridge would not have otherwise.
+//A rate is sustainable while at most ~max_loss of its samples are lost and the p99 is within
+//the sample period. The table goes to the log, and to ~output as CSV if set.
+//
+//The replay runs at ~rt_priority on ~cpu_affinity (realtime.h), so it should be kept off the
+//cores the bridge and controller are pinned to; otherwise it competes with what it measures.
+
+static const uint16_t SENSORS_TOPIC_ID = 100;
+static const uint16_t COMMAND_TOPIC_ID = 101;
+static const uint32_t RING_SIZE = 1 << 16; //samples in flight and in one rate's window
+
+class BridgeBenchmark{
+
+    public:
+        BridgeBenchmark(ros::NodeHandle& nh, ros::NodeHandle& pnh) : nh(nh){
+            pnh.param<std::string>("link", link, "/tmp/teensy_benchmark");
+            pnh.param<std::string>("log", logPath, "");
+            pnh.param("rates", rates, std::vector<double>{100.0, 200.0, 500.0, 1000.0, 2000.0});
+            pnh.param("duration", duration, 10.0);
+            pnh.param("warmup", warmup, 5.0);
+            pnh.param("drain", drain, 0.5);
+            pnh.param("max_loss", maxLoss, 0.001);
+            pnh.param("stages", stages, true);
+            pnh.param<std::string>("command_topic", commandTopic, "/torso_command");
+            pnh.param<std::string>("output", output, "");
+            pnh.param("processes", processes, std::vector<std::string>{"teensy_bridge", "pbc_controller", "nodelet"});
+            rt = realtime::Config::fromParams(pnh, 70);
+            ring.reset(new Slot[RING_SIZE]);
+        }
+
+        ~BridgeBenchmark(){
+            running = false;
+            if (reader.joinable()) {
+                reader.join();
+            }
+            if (!link.empty()) {
+                unlink(link.c_str());
+            }
+            if (slave >= 0) close(slave);
+            if (master >= 0) close(master);
+        }
+
+        bool start(){
+            if (!loadLog()) {
+                return false;
+            }
+            if (!openPty()) {
+                return false;
+            }
+            if (stages) {
+                sensorsSub = nh.subscribe("sensors", 16, &BridgeBenchmark::sensorsCallback, this, ros::TransportHints().tcpNoDelay());
+                commandSub = nh.subscribe(commandTopic.substr(commandTopic[0] == '/'), 16, &BridgeBenchmark::commandCallback,
+                                          this, ros::TransportHints().tcpNoDelay());
+            }
+            realtime::lockMemory(rt);
+            running = true;
+            reader = std::thread(&BridgeBenchmark::readLoop, this);
+            return true;
+        }
+
+        //The sweep, from the calling thread; false if the path never answered
+        bool run(){
+            realtime::configureThread(pthread_self(), rt, "replay");
+            if (rt.lockMemory) {
+                realtime::prefaultStack();
+            }
+            ROS_INFO("bridge_benchmark: waiting up to %.0f s for torques on %s", warmup, link.c_str());
+            int64_t deadline = realtime::monotonicNs() + (int64_t)(warmup*1e9);
+            while (ros::ok() && answers.load() == 0 && realtime::monotonicNs() < deadline) {
+                replay(rates.front(), 0.2);
+            }
+            if (answers.load() == 0) {
+                ROS_ERROR("bridge_benchmark: no torque came back; is a teensy_bridge on %s and a controller running?", link.c_str());
+                return false;
+            }
+            //what the warm-up left in flight
+            usleep((useconds_t)(drain*1e6));
+            for (double rate : rates) {
+                if (!ros::ok()) break;
+                results.push_back(measure(rate));
+                report(results.back());
+            }
+            summarize();
+            return true;
+        }
+
+    private:
+        struct Slot{
+            std::atomic<uint32_t> seq{0};
+            std::atomic<int64_t> sentNs{0};
+            std::atomic<int64_t> sensorsNs{0};
+            std::atomic<int64_t> controllerNs{0};
+            std::atomic<int64_t> answeredNs{0};
+        };
+
+        struct Percentiles{
+            double p50 = 0.0, p99 = 0.0, max = 0.0; //us
+        };
+
+        struct Result{
+            double rate;
+            double achieved;     //Hz the replay kept up
+            double lateUs;       //its worst wakeup past a deadline
+            uint32_t sent, answered;
+            Percentiles total, bridgeIn, controller, bridgeOut;
+            std::vector<double> cpuUs; //per sample, one per ~processes entry
+            bool sustainable;
+        };
+
+        bool loadLog(){
+            if (logPath.empty()) {
+                ROS_ERROR("bridge_benchmark: set ~log to a flight log to replay");
+                return false;
+            }
+            std::ifstream in(logPath, std::ios::binary);
+            std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            FlightLogHeader header;
+            if (bytes.size() < FlightLogHeader::block_bytes) {
+                ROS_ERROR("bridge_benchmark: %s is not a flight log", logPath.c_str());
+                return false;
+            }
+            memcpy(&header, bytes.data(), sizeof(header));
+            if (header.magic != FlightLogHeader::MAGIC || header.record_size != sizeof(FlightRecord)) {
+                ROS_ERROR("bridge_benchmark: %s is not a flight log (magic %08x)", logPath.c_str(), header.magic);
+                return false;
+            }
+            size_t count = (bytes.size() - FlightLogHeader::block_bytes) / sizeof(FlightRecord);
+            const FlightRecord* records = reinterpret_cast<const FlightRecord*>(bytes.data() + FlightLogHeader::block_bytes);
+            for (size_t i = 0; i < count; ++i) {
+                //the block padding, the event index and the health records are not samples
+                if (records[i].stamp_us == 0 || records[i].status == FlightEventRecord::MARKER
+                    || records[i].status == FlightHealthRecord::MARKER) continue;
+                samples.push_back(records[i]);
+            }
+            if (samples.empty()) {
+                ROS_ERROR("bridge_benchmark: %s has no samples", logPath.c_str());
+                return false;
+            }
+            ROS_INFO("bridge_benchmark: %zu samples from %s", samples.size(), logPath.c_str());
+            return true;
+        }
+
+        bool openPty(){
+            master = posix_openpt(O_RDWR | O_NOCTTY);
+            if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+                ROS_ERROR("bridge_benchmark: no pseudo-tty: %s", strerror(errno));
+                return false;
+            }
+            std::string name = ptsname(master);
+            //held open, so the master does not read EIO while the bridge reopens it; raw, as the bridge sets it
+            slave = open(name.c_str(), O_RDWR | O_NOCTTY);
+            termios tio;
+            tcgetattr(slave, &tio);
+            cfmakeraw(&tio);
+            tcsetattr(slave, TCSANOW, &tio);
+            unlink(link.c_str());
+            if (symlink(name.c_str(), link.c_str()) != 0) {
+                ROS_ERROR("bridge_benchmark: cannot link %s to %s: %s", link.c_str(), name.c_str(), strerror(errno));
+                return false;
+            }
+            ROS_INFO("bridge_benchmark: Teensy stand-in on %s (%s)", link.c_str(), name.c_str());
+            return true;
+        }
+
+        //As the firmware answers the bridge's request for its topics
+        void announce(){
+            rosserial_protocol::TopicInfo sensors;
+            sensors.topicId = SENSORS_TOPIC_ID;
+            sensors.topicName = "/sensors_packed";
+            sensors.messageType = "raspi_pkg/SensorState";
+            sensors.md5sum = ros::message_traits::md5sum<raspi_pkg::SensorState>();
+            sensors.bufferSize = 512;
+            sensors.serialize(payload);
+            send(rosserial_protocol::ID_PUBLISHER, payload);
+            rosserial_protocol::TopicInfo command;
+            command.topicId = COMMAND_TOPIC_ID;
+            command.topicName = commandTopic;
+            command.messageType = "sensor_msgs/JointState";
+            command.md5sum = ros::message_traits::md5sum<sensor_msgs::JointState>();
+            command.bufferSize = 512;
+            command.serialize(payload);
+            send(rosserial_protocol::ID_SUBSCRIBER, payload);
+        }
+
+        void send(uint16_t topic, const std::vector<uint8_t>& data){
+            std::lock_guard<std::mutex> lock(writeMutex);
+            rosserial_protocol::encodeFrame(topic, data.data(), data.size(), txFrame);
+            size_t sent = 0;
+            while (sent < txFrame.size()) {
+                ssize_t n = write(master, txFrame.data() + sent, txFrame.size() - sent);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    ROS_ERROR_THROTTLE(1.0, "bridge_benchmark: write failed: %s", strerror(errno));
+                    return;
+                }
+                sent += n;
+            }
+        }
+
+        void readLoop(){
+            uint8_t buffer[512];
+            pollfd pfd = {master, POLLIN, 0};
+            sensor_msgs::JointState command;
+            while (running) {
+                if (poll(&pfd, 1, 100) <= 0) {
+                    continue;
+                }
+                ssize_t n = read(master, buffer, sizeof(buffer));
+                if (n <= 0) {
+                    continue;
+                }
+                int64_t now = realtime::monotonicNs();
+                for (ssize_t i = 0; i < n; ++i) {
+                    if (!parser.feed(buffer[i])) continue;
+                    if (parser.topic() == rosserial_protocol::ID_PUBLISHER) {
+                        announce();
+                    } else if (parser.topic() == COMMAND_TOPIC_ID) {
+                        ros::serialization::IStream stream(const_cast<uint8_t*>(parser.data().data()), parser.data().size());
+                        try {
+                            ros::serialization::deserialize(stream, command);
+                        } catch (const ros::serialization::StreamOverrunException&) {
+                            continue;
+                        }
+                        stamp(command.header.frame_id, &Slot::answeredNs, now);
+                        ++answers;
+                    }
+                }
+            }
+        }
+
+        void sensorsCallback(const sensor_msgs::JointState::ConstPtr& msg){
+            stamp(msg->header.frame_id, &Slot::sensorsNs, realtime::monotonicNs());
+        }
+
+        void commandCallback(const sensor_msgs::JointState::ConstPtr& msg){
+            stamp(msg->header.frame_id, &Slot::controllerNs, realtime::monotonicNs());
+        }
+
+        //The sample frameId names, if it is still in the ring; the first stamp counts
+        void stamp(const std::string& frameId, std::atomic<int64_t> Slot::*field, int64_t now){
+            if (frameId.empty()) return; //a watchdog zero
+            uint32_t seq = strtoul(frameId.c_str(), nullptr, 10);
+            Slot& slot = ring[seq & (RING_SIZE - 1)];
+            int64_t none = 0;
+            if (slot.seq.load() == seq) (slot.*field).compare_exchange_strong(none, now);
+        }
+
+        //seconds of samples at rate Hz, to absolute deadlines; the worst lateness in lateNs
+        uint32_t replay(double rate, double seconds, int64_t* lateNs = nullptr){
+            const int64_t period = (int64_t)(1e9/rate);
+            const uint32_t count = std::min<uint32_t>((uint32_t)(seconds*rate), RING_SIZE/2);
+            raspi_pkg::SensorState msg;
+            int64_t next = realtime::monotonicNs();
+            for (uint32_t i = 0; i < count && ros::ok(); ++i) {
+                next += period;
+                timespec t = {(time_t)(next/1000000000), (long)(next%1000000000)};
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, nullptr);
+                const FlightRecord& r = samples[cursor++ % samples.size()];
+                msg.seq = ++seq;
+                msg.stamp_us = (uint32_t)(realtime::monotonicNs()/1000);
+                msg.torso_roll = r.torso[0];
+                msg.torso_omega = r.torso[1];
+                msg.yaw = r.torso[2];
+                msg.spoke_angle[0] = r.spoke[0];
+                msg.spoke_angle[1] = r.spoke[1];
+                msg.spoke_omega[0] = r.spoke[2];
+                msg.spoke_omega[1] = r.spoke[3];
+                msg.status = r.status;
+                sampleData.resize(ros::serialization::serializationLength(msg));
+                ros::serialization::OStream stream(sampleData.data(), sampleData.size());
+                ros::serialization::serialize(stream, msg);
+                Slot& slot = ring[msg.seq & (RING_SIZE - 1)];
+                slot.sentNs = 0;
+                slot.sensorsNs = 0;
+                slot.controllerNs = 0;
+                slot.answeredNs = 0;
+                slot.seq = msg.seq;
+                int64_t now = realtime::monotonicNs();
+                if (lateNs) *lateNs = std::max(*lateNs, now - next);
+                slot.sentNs = now;
+                send(SENSORS_TOPIC_ID, sampleData);
+            }
+            return count;
+        }
+
+        Result measure(double rate){
+            Result result;
+            result.rate = rate;
+            std::vector<uint64_t> cpuBefore = cpuTicks();
+            const uint32_t first = seq + 1;
+            int64_t late = 0;
+            int64_t begin = realtime::monotonicNs();
+            result.sent = replay(rate, duration, &late);
+            double elapsed = (realtime::monotonicNs() - begin)*1e-9;
+            std::vector<uint64_t> cpuAfter = cpuTicks();
+            usleep((useconds_t)(drain*1e6));
+            result.achieved = result.sent/elapsed;
+            result.lateUs = late*1e-3;
+
+            std::vector<double> total, bridgeIn, controller, bridgeOut;
+            for (uint32_t s = first; s < first + result.sent; ++s) {
+                const Slot& slot = ring[s & (RING_SIZE - 1)];
+                if (slot.seq.load() != s || slot.answeredNs.load() == 0) continue;
+                int64_t sent = slot.sentNs, in = slot.sensorsNs, control = slot.controllerNs, answered = slot.answeredNs;
+                total.push_back((answered - sent)*1e-3);
+                if (in && control) {
+                    bridgeIn.push_back((in - sent)*1e-3);
+                    controller.push_back((control - in)*1e-3);
+                    bridgeOut.push_back((answered - control)*1e-3);
+                }
+            }
+            result.answered = total.size();
+            result.total = percentiles(total);
+            result.bridgeIn = percentiles(bridgeIn);
+            result.controller = percentiles(controller);
+            result.bridgeOut = percentiles(bridgeOut);
+            const double tickUs = 1e6/sysconf(_SC_CLK_TCK);
+            for (size_t p = 0; p < processes.size(); ++p) {
+                result.cpuUs.push_back(result.sent ? (cpuAfter[p] - cpuBefore[p])*tickUs/result.sent : 0.0);
+            }
+            double loss = result.sent ? 1.0 - (double)result.answered/result.sent : 1.0;
+            result.sustainable = loss <= maxLoss && result.total.p99 <= 1e6/rate;
+            return result;
+        }
+
+        static Percentiles percentiles(std::vector<double>& v){
+            Percentiles p;
+            if (v.empty()) return p;
+            std::sort(v.begin(), v.end());
+            p.p50 = v[v.size()/2];
+            p.p99 = v[std::min(v.size() - 1, (size_t)(0.99*v.size()))];
+            p.max = v.back();
+            return p;
+        }
+
+        //utime + stime of every process whose comm is processes[p], summed, in clock ticks
+        std::vector<uint64_t> cpuTicks() const{
+            std::vector<uint64_t> ticks(processes.size(), 0);
+            DIR* proc = opendir("/proc");
+            if (!proc) return ticks;
+            while (dirent* entry = readdir(proc)) {
+                if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+                std::ifstream in(std::string("/proc/") + entry->d_name + "/stat");
+                std::string stat((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+                size_t open = stat.find('('), close = stat.rfind(')');
+                if (open == std::string::npos || close == std::string::npos) continue;
+                std::string comm = stat.substr(open + 1, close - open - 1);
+                for (size_t p = 0; p < processes.size(); ++p) {
+                    //comm is cut to 15 characters
+                    if (comm != processes[p].substr(0, 15)) continue;
+                    unsigned long utime = 0, stime = 0;
+                    //state ppid pgrp session tty tpgid flags minflt cminflt majflt cmajflt utime stime
+                    sscanf(stat.c_str() + close + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime);
+                    ticks[p] += utime + stime;
+                }
+            }
+            closedir(proc);
+            return ticks;
+        }
+
+        void report(const Result& r){
+            std::string cpu;
+            char part[64];
+            for (size_t p = 0; p < processes.size(); ++p) {
+                snprintf(part, sizeof(part), " %s %.1f us", processes[p].c_str(), r.cpuUs[p]);
+                cpu += part;
+            }
+            ROS_INFO("bridge_benchmark: %.0f Hz (%.1f achieved, %.0f us late): %u/%u answered, p50 %.0f p99 %.0f max %.0f us%s",
+                     r.rate, r.achieved, r.lateUs, r.answered, r.sent, r.total.p50, r.total.p99, r.total.max,
+                     r.sustainable ? "" : ", not sustainable");
+            if (stages) {
+                ROS_INFO("bridge_benchmark: %.0f Hz p99: bridge in %.0f, controller %.0f, bridge out %.0f us",
+                         r.rate, r.bridgeIn.p99, r.controller.p99, r.bridgeOut.p99);
+            }
+            ROS_INFO("bridge_benchmark: %.0f Hz CPU per sample:%s", r.rate, cpu.c_str());
+        }
+
+        void summarize(){
+            const Result* best = nullptr;
+            const Result* failed = nullptr;
+            for (const Result& r : results) {
+                if (r.sustainable && !failed) best = &r;
+                else if (!r.sustainable && !failed) failed = &r;
+            }
+            if (best) {
+                ROS_INFO("bridge_benchmark: max sustainable rate %.0f Hz", best->rate);
+            } else {
+                ROS_WARN("bridge_benchmark: no rate was sustainable");
+            }
+            //the stage whose p99 grew most from the slowest rate to the first that failed
+            if (failed && stages && !results.empty()) {
+                const Result& base = results.front();
+                double growth[3] = {failed->bridgeIn.p99 - base.bridgeIn.p99, failed->controller.p99 - base.controller.p99,
+                                    failed->bridgeOut.p99 - base.bridgeOut.p99};
+                static const char* const names[3] = {"bridge in", "controller", "bridge out"};
+                int worst = std::max_element(growth, growth + 3) - growth;
+                ROS_INFO("bridge_benchmark: at %.0f Hz %s saturates first, its p99 up %.0f us", failed->rate,
+                         names[worst], growth[worst]);
+            }
+            if (output.empty()) return;
+            FILE* f = fopen(output.c_str(), "w");
+            if (!f) {
+                ROS_ERROR("bridge_benchmark: cannot write %s: %s", output.c_str(), strerror(errno));
+                return;
+            }
+            fprintf(f, "rate_hz,achieved_hz,late_us,sent,answered,p50_us,p99_us,max_us,bridge_in_p99_us,controller_p99_us,bridge_out_p99_us,sustainable");
+            for (const std::string& p : processes) fprintf(f, ",%s_cpu_us", p.c_str());
+            fprintf(f, "\n");
+            for (const Result& r : results) {
+                fprintf(f, "%.1f,%.1f,%.0f,%u,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%d", r.rate, r.achieved, r.lateUs, r.sent,
+                        r.answered, r.total.p50, r.total.p99, r.total.max, r.bridgeIn.p99, r.controller.p99,
+                        r.bridgeOut.p99, r.sustainable ? 1 : 0);
+                for (double c : r.cpuUs) fprintf(f, ",%.2f", c);
+                fprintf(f, "\n");
+            }
+            fclose(f);
+            ROS_INFO("bridge_benchmark: results in %s", output.c_str());
+        }
+
+        ros::NodeHandle nh;
+        ros::Subscriber sensorsSub, commandSub;
+        std::string link, logPath, commandTopic, output;
+        std::vector<double> rates;
+        std::vector<std::string> processes;
+        double duration, warmup, drain, maxLoss;
+        bool stages;
+        realtime::Config rt;
+
+        std::vector<FlightRecord> samples;
+        size_t cursor = 0;
+        uint32_t seq = 0;
+        std::unique_ptr<Slot[]> ring;
+        std::vector<Result> results;
+
+        int master = -1, slave = -1;
+        std::atomic<bool> running{false};
+        std::atomic<uint64_t> answers{0};
+        std::thread reader;
+        rosserial_protocol::FrameParser parser;
+        std::mutex writeMutex;
+        std::vector<uint8_t> txFrame, payload, sampleData;
+};
+
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "bridge_benchmark");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+    BridgeBenchmark benchmark(nh, pnh);
+    if (!benchmark.start()) {
+        return 1;
+    }
+    //the stage subscriptions; the replay has the main thread
+    ros::AsyncSpinner spinner(1);
+    spinner.start();
+    bool ok = benchmark.run();
+    spinner.stop();
+
+    return ok ? 0 : 1;
+}
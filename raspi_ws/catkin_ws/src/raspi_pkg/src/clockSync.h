@@ -0,0 +1,124 @@
+#ifndef RASPI_PKG_CLOCK_SYNC_H
+#define RASPI_PKG_CLOCK_SYNC_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+
+//TeensyClock maps the Teensy's micros() onto Pi time from NTP-style ping exchanges
+//(raspi_pkg/ClockSync on /clock_sync_ping and /clock_sync_pong).
+//
+//An exchange is t1 (Pi send), t2 and t3 (Teensy receive and reply) and t4 (Pi receive).
+//Its round trip is (t4 - t1) - (t3 - t2), and with the link taken as symmetric the Pi
+//time at the Teensy's (t2 + t3)/2 is (t1 + t4)/2. The exchanges of the last window whose
+//round trip is within rttMargin of the window's fastest are fitted with a line in the
+//least-squares sense, so the crystals' drift is followed as well as their offset. A point
+//more than resetTolerance off the fit (the Teensy was reset) starts the window again.
+//
+//micros() wraps every ~71 minutes; stamps are extended from the newest exchange, so they
+//must lie within ~35 minutes of it.
+
+class TeensyClock{
+
+    public:
+        TeensyClock(size_t window = 64, int64_t rttMarginNs = 200000, int64_t resetToleranceNs = 20000000)
+            : window(window), rttMarginNs(rttMarginNs), resetToleranceNs(resetToleranceNs) {}
+
+        void addExchange(int64_t piSendNs, uint32_t teensyReceiveUs, uint32_t teensySendUs, int64_t piReceiveNs){
+            Exchange e;
+            e.teensyUs = extend(teensyReceiveUs) + (int32_t)(teensySendUs - teensyReceiveUs)/2;
+            e.piNs = piSendNs + (piReceiveNs - piSendNs)/2;
+            e.rttNs = (piReceiveNs - piSendNs) - 1000*(int64_t)(int32_t)(teensySendUs - teensyReceiveUs);
+            if (e.rttNs < 0) {
+                return;
+            }
+            if (synced() && std::llabs(toPiNs(e.teensyUs) - e.piNs) > resetToleranceNs + e.rttNs) {
+                exchanges.clear();
+                e.teensyUs = teensyReceiveUs + (int32_t)(teensySendUs - teensyReceiveUs)/2;
+            }
+            lastTeensyUs = e.teensyUs;
+            exchanges.push_back(e);
+            if (exchanges.size() > window) {
+                exchanges.pop_front();
+            }
+            fit();
+        }
+
+        //Enough exchanges for a line
+        bool synced() const{
+            return fitted;
+        }
+
+        //Pi time in ns of a Teensy micros() stamp
+        int64_t toPiNs(uint32_t teensyUs) const{
+            return toPiNs(extend(teensyUs));
+        }
+
+        //(rate - 1) of the Teensy's clock against the Pi's, in ppm
+        double driftPpm() const{
+            return (rate/1000.0 - 1.0)*1e6;
+        }
+
+        //The window's fastest round trip, the bound on the offset error
+        int64_t minRttNs() const{
+            return minRtt;
+        }
+
+        size_t exchangeCount() const{
+            return exchanges.size();
+        }
+
+    private:
+        struct Exchange{
+            int64_t teensyUs; //extended micros() at the midpoint
+            int64_t piNs;
+            int64_t rttNs;
+        };
+
+        int64_t extend(uint32_t us) const{
+            return lastTeensyUs + (int32_t)(us - (uint32_t)lastTeensyUs);
+        }
+
+        int64_t toPiNs(int64_t teensyUs) const{
+            return refPiNs + (int64_t)std::llround(rate*(double)(teensyUs - refTeensyUs));
+        }
+
+        void fit(){
+            minRtt = exchanges.front().rttNs;
+            for (const Exchange& e : exchanges) {
+                minRtt = std::min(minRtt, e.rttNs);
+            }
+
+            //relative to the newest exchange, so the sums stay well inside a double's mantissa
+            const Exchange& ref = exchanges.back();
+            double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+            for (const Exchange& e : exchanges) {
+                if (e.rttNs > minRtt + rttMarginNs) {
+                    continue;
+                }
+                double x = (double)(e.teensyUs - ref.teensyUs);
+                double y = (double)(e.piNs - ref.piNs);
+                n += 1; sx += x; sy += y; sxx += x*x; sxy += x*y;
+            }
+            double varX = sxx - sx*sx/n;
+            //a second of spread before the drift is trusted; until then only the offset moves
+            rate = (n >= 4 && varX > n*1e12) ? (sxy - sx*sy/n)/varX : 1000.0;
+            refTeensyUs = ref.teensyUs + (int64_t)std::llround(sx/n);
+            refPiNs = ref.piNs + (int64_t)std::llround(sy/n);
+            fitted = exchanges.size() >= 4;
+        }
+
+        size_t window;
+        int64_t rttMarginNs;
+        int64_t resetToleranceNs;
+        std::deque<Exchange> exchanges;
+        int64_t lastTeensyUs = 0;
+        int64_t refTeensyUs = 0;
+        int64_t refPiNs = 0;
+        double rate = 1000.0; //Pi ns per Teensy us
+        int64_t minRtt = 0;
+        bool fitted = false;
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef RASPI_PKG_DIAGNOSTICS_SUMMARY_H
+#define RASPI_PKG_DIAGNOSTICS_SUMMARY_H
+
+#include "ros/ros.h"
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <raspi_pkg/SensorState.h>
+#include <sensor_msgs/JointState.h>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+//DiagnosticsSummary is the run's performance health in one place: every status on /diagnostics
+//(the Teensy's, each on its own period, and any Pi node's) and the Pi's view of the link, folded
+//into one diagnostic_msgs/DiagnosticArray with a single status on /diagnostics_summary once a
+//period. Its level is the worst any status reported in the period, or STALE for a status
+//not heard for stale_after; its message names it. The values are the Teensy's "health"
+//summary (HEALTH_SUMMARY), copied as they came, then the Pi's figures of the period:
+//  sensors   samples/lost/max_gap_ms of /sensors_packed on the Pi's clock, lost from the seq steps
+//            over the smallest step seen (the firmware's decimation)
+//  commands  /torso_command messages
+//  overruns  samples with STATUS_OVERRUN
+//  statuses  ok/warn/error/stale, of the names heard so far
+//
+//Parameters (private): period (s, default 1.0), stale_after (s, 5.0), events (the names of
+//statuses sent when something happens rather than on a period, which are never stale; default
+//the Teensy's self_test, link_governor, calibration, weight_upload, imu, benchmark,
+//odrive_faults and transport)
+
+class DiagnosticsSummary{
+
+    public:
+        DiagnosticsSummary(ros::NodeHandle& nh, ros::NodeHandle& pnh)
+            : staleAfter(pnh.param("stale_after", 5.0)){
+            pnh.param("events", events, std::vector<std::string>{"self_test", "link_governor", "calibration",
+                      "weight_upload", "imu", "benchmark", "odrive_faults", "transport"});
+            pub = nh.advertise<diagnostic_msgs::DiagnosticArray>("diagnostics_summary", 1);
+            diagnosticsSub = nh.subscribe("diagnostics", 50, &DiagnosticsSummary::diagnosticsCb, this);
+            packedSub = nh.subscribe("sensors_packed", 50, &DiagnosticsSummary::packedCb, this, ros::TransportHints().tcpNoDelay());
+            commandSub = nh.subscribe("torso_command", 10, &DiagnosticsSummary::commandCb, this, ros::TransportHints().tcpNoDelay());
+            timer = nh.createTimer(ros::Duration(pnh.param("period", 1.0)), &DiagnosticsSummary::publish, this);
+        }
+
+        void diagnosticsCb(const diagnostic_msgs::DiagnosticArray::ConstPtr& msg){
+            ros::Time now = ros::Time::now();
+            for (const diagnostic_msgs::DiagnosticStatus& status : msg->status) {
+                //the Teensy's own summary is passed on, not counted twice
+                if (status.name == "health" && status.hardware_id == "teensy") {
+                    teensyHealth = status.values;
+                    continue;
+                }
+                Source& source = sources[status.hardware_id + "/" + status.name];
+                if (source.heard.isZero())
+                    source.event = std::find(events.begin(), events.end(), status.name) != events.end();
+                source.heard = now;
+                if (!source.reported || status.level > source.level) {
+                    source.level = status.level;
+                    source.message = status.message;
+                }
+                source.reported = true;
+            }
+        }
+
+        void packedCb(const raspi_pkg::SensorState::ConstPtr& msg){
+            ros::Time now = ros::Time::now();
+            if (haveSeq) {
+                uint32_t step = msg->seq - lastSeq;
+                if (step > 0) {
+                    stride = std::min(stride, step);
+                    lost += step / stride - 1;
+                }
+                maxGap = std::max(maxGap, now - lastArrival);
+            }
+            haveSeq = true;
+            lastSeq = msg->seq;
+            lastArrival = now;
+            ++samples;
+            if (msg->status & raspi_pkg::SensorState::STATUS_OVERRUN) ++overruns;
+        }
+
+        void commandCb(const sensor_msgs::JointState::ConstPtr&){ ++commands; }
+
+        void publish(const ros::TimerEvent&){
+            ros::Time now = ros::Time::now();
+            diagnostic_msgs::DiagnosticStatus summary;
+            summary.name = "summary";
+            summary.hardware_id = "raspi";
+            summary.level = diagnostic_msgs::DiagnosticStatus::OK;
+            unsigned counts[4] = {0, 0, 0, 0};
+            for (auto& entry : sources) {
+                Source& source = entry.second;
+                uint8_t level = source.reported ? source.level : (uint8_t)diagnostic_msgs::DiagnosticStatus::OK;
+                std::string message = source.message;
+                if (!source.event && (now - source.heard).toSec() > staleAfter) {
+                    level = STALE;
+                    message = "not heard for " + std::to_string((int)(now - source.heard).toSec()) + " s";
+                }
+                ++counts[std::min<uint8_t>(level, STALE)];
+                if (level > summary.level) {
+                    summary.level = level;
+                    summary.message = entry.first + (message.empty() ? "" : ": " + message);
+                }
+                //the next period starts from what is reported in it
+                source.reported = false;
+                source.message.clear();
+            }
+            if (summary.level == diagnostic_msgs::DiagnosticStatus::OK && overruns > 0) {
+                summary.level = diagnostic_msgs::DiagnosticStatus::WARN;
+                summary.message = "control step overran";
+            }
+
+            summary.values = teensyHealth;
+            teensyHealth.clear();
+            char text[48];
+            snprintf(text, sizeof(text), "%u/%u/%.1f", samples, lost, maxGap.toSec() * 1e3);
+            add(summary, "sensors", text);
+            add(summary, "commands", std::to_string(commands));
+            add(summary, "overruns", std::to_string(overruns));
+            snprintf(text, sizeof(text), "%u/%u/%u/%u", counts[0], counts[1], counts[2], counts[3]);
+            add(summary, "statuses", text);
+            samples = lost = commands = overruns = 0;
+            maxGap = ros::Duration(0);
+
+            diagnostic_msgs::DiagnosticArray array;
+            array.header.stamp = now;
+            array.status.push_back(summary);
+            pub.publish(array);
+        }
+
+    private:
+        //diagnostic_msgs::DiagnosticStatus::STALE, which older diagnostic_msgs lack
+        enum : uint8_t { STALE = 3 };
+
+        struct Source{
+            ros::Time heard;
+            uint8_t level = 0;
+            std::string message;
+            bool reported = false;  //in this period
+            bool event = false;     //one of events
+        };
+
+        static void add(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, const std::string& value){
+            diagnostic_msgs::KeyValue kv;
+            kv.key = key;
+            kv.value = value;
+            status.values.push_back(kv);
+        }
+
+        ros::Publisher pub;
+        ros::Subscriber diagnosticsSub, packedSub, commandSub;
+        ros::Timer timer;
+        double staleAfter;
+        std::vector<std::string> events;
+        std::map<std::string, Source> sources;
+        std::vector<diagnostic_msgs::KeyValue> teensyHealth;
+        bool haveSeq = false;
+        uint32_t lastSeq = 0;
+        uint32_t stride = UINT32_MAX;
+        ros::Time lastArrival;
+        ros::Duration maxGap;
+        uint32_t samples = 0, lost = 0, commands = 0, overruns = 0;
+};
+
+#endif //RASPI_PKG_DIAGNOSTICS_SUMMARY_H
@@ -0,0 +1,13 @@
+#include "ros/ros.h"
+#include "diagnosticsSummary.h"
+
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "diagnostics_summary");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+    DiagnosticsSummary summary(nh, pnh);
+    ros::spin();
+
+    return 0;
+}
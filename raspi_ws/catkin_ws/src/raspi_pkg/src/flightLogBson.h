@@ -0,0 +1,168 @@
+#ifndef RASPI_PKG_FLIGHT_LOG_BSON_H
+#define RASPI_PKG_FLIGHT_LOG_BSON_H
+
+#include <FlightLogFormat.h>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//FlightLogBson converts a flight-recorder log (teensy/lib/FlightRecorder) into the BSON that
+//the Julia scripts write with BSON.@save "..." sensorData, so hardware_data tooling reads it
+//unchanged: sensorData is a Vector{Vector{Float32}} of the 7-element state of evaluatePbc.jl,
+//[torso roll, pi + spoke 0, torso omega, spoke 0 omega, pi + spoke 1, spoke 1 omega, yaw].
+//
+//Every element has the same encoding apart from its index key, so one element is built once
+//and each record is a memcpy of it with the key and the 28 data bytes patched in. The output
+//goes through a large buffer and the document lengths are patched at the end, so memory use
+//does not grow with the log. BSON lengths are int32, so a session that would pass 2 GiB of
+//BSON (about 12 million samples) is split into parts, each a complete sensorData.
+
+class FlightLogBson{
+
+    public:
+        static constexpr int stateSize = 7;
+        static constexpr uint32_t maxDocumentBytes = 0x7FF00000;
+
+        explicit FlightLogBson(const std::string& path) : basePath(path){
+            buffer.reserve(bufferBytes);
+            buildElement();
+        }
+
+        ~FlightLogBson(){
+            finishPart();
+        }
+
+        void add(const FlightRecord& r){
+            if (!file || documentBytes + elementBytes(count) + 2 > maxDocumentBytes) {
+                finishPart();
+                startPart();
+            }
+            char key[12];
+            int keyLength = snprintf(key, sizeof(key), "%u", count);
+            float state[stateSize] = {r.torso[0], float(M_PI) + r.spoke[0], r.torso[1], r.spoke[2],
+                                      float(M_PI) + r.spoke[1], r.spoke[3], r.torso[2]};
+            size_t at = buffer.size();
+            buffer.resize(at + 1 + keyLength + 1 + element.size());
+            uint8_t* out = &buffer[at];
+            *out++ = 0x03;
+            memcpy(out, key, keyLength + 1);
+            out += keyLength + 1;
+            memcpy(out, element.data(), element.size());
+            memcpy(out + dataOffset, state, sizeof(state));
+            documentBytes += 1 + keyLength + 1 + element.size();
+            ++count;
+            ++total;
+            if (buffer.size() >= bufferBytes - 256) flush();
+        }
+
+        bool ok() const { return good; }
+        uint64_t samples() const { return total; }
+        int parts() const { return part; }
+
+    private:
+        static constexpr size_t bufferBytes = 8 << 20;
+
+        static uint32_t elementBytes(uint32_t index){
+            int digits = 1;
+            for (uint32_t v = index; v >= 10; v /= 10) ++digits;
+            return 1 + digits + 1 + 161;
+        }
+
+        // tag/type/size/data of a Julia Array{Float32,1} as BSON.jl lowers it
+        void buildElement(){
+            std::vector<uint8_t>& e = element;
+            auto int32 = [&e](uint32_t v){ for (int i = 0; i < 4; ++i) e.push_back(v >> (8*i)); };
+            auto cstring = [&e](const char* s){ e.insert(e.end(), s, s + strlen(s) + 1); };
+            auto string = [&](const char* key, const char* value){
+                e.push_back(0x02); cstring(key); int32(strlen(value) + 1); cstring(value);
+            };
+            auto open = [&](uint8_t type, const char* key){
+                e.push_back(type); cstring(key); size_t at = e.size(); int32(0); return at;
+            };
+            auto close = [&e](size_t at){
+                e.push_back(0x00);
+                uint32_t length = e.size() - at;
+                for (int i = 0; i < 4; ++i) e[at + i] = length >> (8*i);
+            };
+
+            int32(0);
+            string("tag", "array");
+            size_t type = open(0x03, "type");
+            string("tag", "datatype");
+            close(open(0x04, "params"));
+            size_t name = open(0x04, "name");
+            string("0", "Core");
+            string("1", "Float32");
+            close(name);
+            close(type);
+            size_t size = open(0x04, "size");
+            e.push_back(0x12); cstring("0");
+            for (int i = 0; i < 8; ++i) e.push_back(i == 0 ? stateSize : 0);
+            close(size);
+            e.push_back(0x05); cstring("data"); int32(stateSize*sizeof(float)); e.push_back(0x00);
+            dataOffset = e.size();
+            e.resize(e.size() + stateSize*sizeof(float), 0);
+            e.push_back(0x00);
+            uint32_t length = e.size();
+            for (int i = 0; i < 4; ++i) e[i] = length >> (8*i);
+        }
+
+        void startPart(){
+            ++part;
+            std::string path = basePath;
+            if (part > 1) {
+                // name_2.bson, name_3.bson, ... after the first
+                size_t dot = path.rfind(".bson");
+                path.insert(dot == std::string::npos ? path.size() : dot, "_" + std::to_string(part));
+            }
+            file = fopen(path.c_str(), "wb");
+            if (!file) {
+                fprintf(stderr, "cannot write %s\n", path.c_str());
+                good = false;
+                return;
+            }
+            // root length, "sensorData" array and its length, patched in finishPart()
+            static const uint8_t head[] = {0, 0, 0, 0, 0x04, 's','e','n','s','o','r','D','a','t','a', 0, 0, 0, 0, 0};
+            buffer.assign(head, head + sizeof(head));
+            documentBytes = sizeof(head) + 2;
+            count = 0;
+        }
+
+        void finishPart(){
+            if (!file)
+                return;
+            buffer.push_back(0x00);
+            buffer.push_back(0x00);
+            flush();
+            uint32_t root = documentBytes, array = documentBytes - 16 - 1;
+            uint8_t bytes[4];
+            for (int i = 0; i < 4; ++i) bytes[i] = root >> (8*i);
+            good = good && fseek(file, 0, SEEK_SET) == 0 && fwrite(bytes, 1, 4, file) == 4;
+            for (int i = 0; i < 4; ++i) bytes[i] = array >> (8*i);
+            good = good && fseek(file, 16, SEEK_SET) == 0 && fwrite(bytes, 1, 4, file) == 4;
+            good = fclose(file) == 0 && good;
+            file = nullptr;
+        }
+
+        void flush(){
+            if (file && !buffer.empty())
+                good = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() && good;
+            buffer.clear();
+        }
+
+        std::string basePath;
+        std::vector<uint8_t> element;
+        size_t dataOffset = 0;
+        std::vector<uint8_t> buffer;
+        FILE* file = nullptr;
+        uint32_t documentBytes = 0;
+        uint32_t count = 0;
+        uint64_t total = 0;
+        int part = 0;
+        bool good = true;
+};
+
+#endif //RASPI_PKG_FLIGHT_LOG_BSON_H
@@ -0,0 +1,90 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include "flightLogBson.h"
+
+//flightlog_to_bson LOG.BIN OUT.bson: FLIGHTnn.BIN from the SD card, or a run pulled off the
+//SPI flash with pull_flight_log.py, to hardware_data BSON. The log is memory-mapped and read
+//front to back once; padding records (all zero, or erased flash) are skipped, and so are the
+//event records of a version 3 log, which the BSON has no place for (they are counted).
+
+static bool blank(const FlightRecord& r){
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(&r);
+    bool zero = true, erased = true;
+    for (size_t i = 0; i < sizeof(r); ++i) {
+        zero = zero && b[i] == 0x00;
+        erased = erased && b[i] == 0xFF;
+    }
+    return zero || erased;
+}
+
+int main(int argc, char **argv){
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s LOG.BIN OUT.bson\n", argv[0]);
+        return 2;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    int fd = open(argv[1], O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    size_t size = info.st_size;
+    if (size < FlightLogHeader::block_bytes) {
+        fprintf(stderr, "%s: too short for a flight log\n", argv[1]);
+        return 1;
+    }
+    const uint8_t* log = static_cast<const uint8_t*>(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+    if (log == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    madvise(const_cast<uint8_t*>(log), size, MADV_SEQUENTIAL);
+
+    FlightLogHeader header;
+    memcpy(&header, log, sizeof(header));
+    if (header.magic != FlightLogHeader::MAGIC || header.version < FlightLogHeader::FIRST_VERSION
+        || header.version > FlightLogHeader::VERSION || header.record_size != sizeof(FlightRecord)) {
+        fprintf(stderr, "%s: not a version %u to %u flight log (magic %08x, version %u, record %u bytes)\n", argv[1],
+                FlightLogHeader::FIRST_VERSION, FlightLogHeader::VERSION, header.magic, header.version, header.record_size);
+        return 1;
+    }
+
+    uint64_t skipped = 0, events = 0, health = 0;
+    {
+        FlightLogBson bson(argv[2]);
+        const FlightRecord* records = reinterpret_cast<const FlightRecord*>(log + FlightLogHeader::block_bytes);
+        size_t count = (size - FlightLogHeader::block_bytes) / sizeof(FlightRecord);
+        for (size_t i = 0; i < count; ++i) {
+            if (blank(records[i])) {
+                ++skipped;
+                continue;
+            }
+            if (records[i].status == FlightEventRecord::MARKER) {
+                events += reinterpret_cast<const FlightEventRecord*>(&records[i])->count;
+                continue;
+            }
+            if (records[i].status == FlightHealthRecord::MARKER) {
+                ++health;
+                continue;
+            }
+            bson.add(records[i]);
+        }
+        if (!bson.ok()) {
+            fprintf(stderr, "%s: write failed\n", argv[2]);
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%llu samples (%llu blank skipped, %llu events, %llu health) at %u us into %d file(s) in %.2f s\n",
+               (unsigned long long)bson.samples(), (unsigned long long)skipped, (unsigned long long)events,
+               (unsigned long long)health, header.period_us, bson.parts(), seconds);
+    }
+    munmap(const_cast<uint8_t*>(log), size);
+    close(fd);
+    return 0;
+}
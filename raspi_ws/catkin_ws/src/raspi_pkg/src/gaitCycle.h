@@ -0,0 +1,158 @@
+#ifndef RASPI_PKG_GAIT_CYCLE_H
+#define RASPI_PKG_GAIT_CYCLE_H
+
+#include <cmath>
+#include <cstdint>
+#include <RobotModel.h>
+#include <StanceTracker.h>
+
+//GaitCycle cuts the sample stream into steps at each touchdown (StanceTracker's change of stance
+//spoke, with its hysteresis) and keeps each step's figures as running sums, so a step costs the
+//same few words however long it lasts and nothing of it is kept once it is summarized. Between
+//two samples the torque in force is the earlier sample's and the rates are averaged, so the
+//energy is the trapezoid of torque x (torso rate - spoke rate), the power RimlessWheel's B = [-u, u]
+//puts into the wheel.
+//
+//A sample that is not valid (the caller's E-stop, calibration, ODrive reset) or a gap of more
+//than maxGap drops the step in progress; the next touchdown starts a new one. An invalid sample
+//also re-rounds the stance spoke, since the angles can jump by whole spokes there.
+//
+//GaitSummary is the mean and spread of step speed and period over a run of steps (Welford's
+//update) and the energy per metre, also O(1). One writer; the accessors are for the same thread.
+
+struct GaitStepFigures{
+    int64_t startNs, endNs;
+    double period;        //s
+    double distance;      //m, signed
+    double speed;         //m/s
+    double energyIn;      //J
+    double energyAbs;     //J
+    double torqueRms;     //N*m
+    float torsoMin, torsoMax, torsoRateMax;
+    uint32_t samples;
+};
+
+class GaitCycle{
+
+    public:
+        //m the wheel moves for a spoke, the chord between two feet
+        static double spokeChord(){ return 2.0 * RimlessWheelModel::l1 * std::sin((double)RimlessWheelModel::alpha); }
+
+        explicit GaitCycle(float hysteresis = 0.01f, double maxGap = 0.05)
+            : tracker(hysteresis), maxGap(maxGap) {}
+
+        //tNs the sample's time on one clock; true when the sample is a touchdown that closed a
+        //whole step, which step() then holds
+        bool update(int64_t tNs, float torso, float torsoRate, float spoke, float spokeRate, float torque, bool valid){
+            if (!valid) {
+                inStep = false;
+                haveLast = false;
+                tracker.reset();
+                return false;
+            }
+            bool closed = false;
+            if (haveLast) {
+                double dt = (tNs - last.tNs) * 1e-9;
+                if (dt <= 0.0 || dt > maxGap) {
+                    inStep = false;
+                } else if (inStep) {
+                    double power = last.torque * 0.5 * ((last.torsoRate - last.spokeRate) + (torsoRate - spokeRate));
+                    energyIn += power * dt;
+                    energyAbs += std::fabs(power) * dt;
+                    torqueSq += (double)last.torque * last.torque * dt;
+                    torsoMin = std::fmin(torsoMin, torso);
+                    torsoMax = std::fmax(torsoMax, torso);
+                    torsoRateMax = std::fmax(torsoRateMax, std::fabs(torsoRate));
+                    ++samples;
+                }
+            }
+            float spokeStates[4] = {spoke, 0.0f, spokeRate, 0.0f};
+            if (tracker.update(spokeStates)) {
+                if (inStep) {
+                    figures.startNs = startNs;
+                    figures.endNs = tNs;
+                    figures.period = (tNs - startNs) * 1e-9;
+                    figures.distance = (tracker.index() - startIndex) * spokeChord();
+                    figures.speed = figures.distance / figures.period;
+                    figures.energyIn = energyIn;
+                    figures.energyAbs = energyAbs;
+                    figures.torqueRms = std::sqrt(torqueSq / figures.period);
+                    figures.torsoMin = torsoMin;
+                    figures.torsoMax = torsoMax;
+                    figures.torsoRateMax = torsoRateMax;
+                    figures.samples = samples;
+                    closed = true;
+                }
+                begin(tNs, torso, torsoRate);
+            }
+            last = {tNs, torsoRate, spokeRate, torque};
+            haveLast = true;
+            return closed;
+        }
+
+        //The last step update() closed
+        const GaitStepFigures& step() const{ return figures; }
+        bool stepping() const{ return inStep; }
+
+    private:
+        struct Last{
+            int64_t tNs;
+            float torsoRate, spokeRate, torque;
+        };
+
+        void begin(int64_t tNs, float torso, float torsoRate){
+            inStep = true;
+            startNs = tNs;
+            startIndex = tracker.index();
+            energyIn = energyAbs = torqueSq = 0.0;
+            torsoMin = torsoMax = torso;
+            torsoRateMax = std::fabs(torsoRate);
+            samples = 1;
+        }
+
+        StanceTracker<RimlessWheelModel> tracker;
+        double maxGap;
+        Last last = {0, 0.0f, 0.0f, 0.0f};
+        bool haveLast = false;
+        bool inStep = false;
+        int64_t startNs = 0;
+        int32_t startIndex = 0;
+        double energyIn = 0.0, energyAbs = 0.0, torqueSq = 0.0;
+        float torsoMin = 0.0f, torsoMax = 0.0f, torsoRateMax = 0.0f;
+        uint32_t samples = 0;
+        GaitStepFigures figures = {};
+};
+
+class GaitSummary{
+
+    public:
+        void add(const GaitStepFigures& step){
+            ++count;
+            double d = step.speed - speedMean;
+            speedMean += d / count;
+            speedM2 += d * (step.speed - speedMean);
+            d = step.period - periodMean;
+            periodMean += d / count;
+            periodM2 += d * (step.period - periodMean);
+            energy += step.energyIn;
+            distance += std::fabs(step.distance);
+        }
+
+        void reset(){ *this = GaitSummary(); }
+
+        uint32_t steps() const{ return count; }
+        double meanSpeed() const{ return speedMean; }
+        double speedStd() const{ return count > 1 ? std::sqrt(speedM2 / (count - 1)) : 0.0; }
+        double meanPeriod() const{ return periodMean; }
+        double periodStd() const{ return count > 1 ? std::sqrt(periodM2 / (count - 1)) : 0.0; }
+        //NaN before the wheel has gone anywhere
+        double energyPerMetre() const{ return distance > 0.0 ? energy / distance : NAN; }
+
+    private:
+        uint32_t count = 0;
+        double speedMean = 0.0, speedM2 = 0.0;
+        double periodMean = 0.0, periodM2 = 0.0;
+        double energy = 0.0, distance = 0.0;
+};
+
+#endif //RASPI_PKG_GAIT_CYCLE_H
@@ -0,0 +1,102 @@
+#ifndef RASPI_PKG_GAIT_STATS_H
+#define RASPI_PKG_GAIT_STATS_H
+
+#include "ros/ros.h"
+#include <raspi_pkg/GaitStep.h>
+#include <raspi_pkg/SensorState.h>
+#include <sensor_msgs/JointState.h>
+#include <std_msgs/String.h>
+#include <algorithm>
+#include <string>
+#include "gaitCycle.h"
+
+//GaitStats publishes a raspi_pkg/GaitStep on /gait_steps for each step of the wheel as it
+//happens, so controllers are compared during the run rather than from its BSON afterwards.
+//Samples are /sensors_packed, on the Teensy's clock (stamp_us, unwrapped) and with the status
+//bits: a sample under E-stop, calibration or an ODrive reset is not part of any step. The torque
+//is the latest /torso_command. Each step also carries the summary of the steps since the
+//controller latched on ~controller_topic last changed, which starts the summary over.
+//
+//Parameters (private): stance_hysteresis (rad past +-alpha before a touchdown, default 0.01 as
+//pbc_controller's), max_gap (s between samples before a step is dropped, 0.05),
+//controller_topic (default nn_controller/active)
+
+class GaitStats{
+
+    public:
+        GaitStats(ros::NodeHandle& nh, ros::NodeHandle& pnh)
+            : cycle((float)pnh.param("stance_hysteresis", 0.01), pnh.param("max_gap", 0.05)){
+            pub = nh.advertise<raspi_pkg::GaitStep>("gait_steps", 10);
+            packedSub = nh.subscribe("sensors_packed", 10, &GaitStats::packedCb, this, ros::TransportHints().tcpNoDelay());
+            torqueSub = nh.subscribe("torso_command", 1, &GaitStats::torqueCb, this, ros::TransportHints().tcpNoDelay());
+            activeSub = nh.subscribe(pnh.param<std::string>("controller_topic", "nn_controller/active"), 1,
+                                     &GaitStats::activeCb, this);
+        }
+
+        void packedCb(const raspi_pkg::SensorState::ConstPtr& msg){
+            if (samples > 0) tNs += (int64_t)(int32_t)(msg->stamp_us - lastStampUs) * 1000;
+            lastStampUs = msg->stamp_us;
+            ++samples;
+            const uint8_t stopped = raspi_pkg::SensorState::STATUS_ESTOP | raspi_pkg::SensorState::STATUS_CALIBRATING |
+                                    raspi_pkg::SensorState::STATUS_ODRIVE_RESET;
+            if (!cycle.update(tNs, msg->torso_roll, msg->torso_omega, msg->spoke_angle[0], msg->spoke_omega[0], torque,
+                              !(msg->status & stopped)))
+                return;
+            const GaitStepFigures& f = cycle.step();
+            summary.add(f);
+
+            raspi_pkg::GaitStep step;
+            step.stamp = ros::Time::now();
+            step.step = ++published;
+            step.start_us = msg->stamp_us - (uint32_t)((tNs - f.startNs) / 1000);
+            step.end_us = msg->stamp_us;
+            step.period = f.period;
+            step.distance = f.distance;
+            step.speed = f.speed;
+            step.energy_in = f.energyIn;
+            step.energy_abs = f.energyAbs;
+            step.torque_rms = f.torqueRms;
+            step.torso_min = f.torsoMin;
+            step.torso_max = f.torsoMax;
+            step.torso_rate_max = f.torsoRateMax;
+            step.samples = (uint16_t)std::min<uint32_t>(f.samples, 65535);
+            step.controller = controller;
+            step.run_steps = summary.steps();
+            step.run_speed_mean = summary.meanSpeed();
+            step.run_speed_std = summary.speedStd();
+            step.run_period_mean = summary.meanPeriod();
+            step.run_period_std = summary.periodStd();
+            step.run_energy_per_m = summary.energyPerMetre();
+            pub.publish(step);
+        }
+
+        void torqueCb(const sensor_msgs::JointState::ConstPtr& msg){
+            if (!msg->effort.empty())
+                torque = msg->effort[0];
+        }
+
+        void activeCb(const std_msgs::String::ConstPtr& msg){
+            if (msg->data == controller)
+                return;
+            if (summary.steps() > 0)
+                ROS_INFO("Gait under %s: %u steps, %.3f +- %.3f m/s, %.3f s a step, %.2f J/m",
+                         controller.empty() ? "no controller" : controller.c_str(), summary.steps(), summary.meanSpeed(),
+                         summary.speedStd(), summary.meanPeriod(), summary.energyPerMetre());
+            controller = msg->data;
+            summary.reset();
+        }
+
+    private:
+        ros::Publisher pub;
+        ros::Subscriber packedSub, torqueSub, activeSub;
+        GaitCycle cycle;
+        GaitSummary summary;
+        std::string controller;
+        float torque = 0.0f;
+        uint32_t lastStampUs = 0;
+        uint64_t samples = 0;
+        int64_t tNs = 0;
+        uint32_t published = 0;
+};
+
+#endif //RASPI_PKG_GAIT_STATS_H
@@ -0,0 +1,13 @@
+#include "ros/ros.h"
+#include "gaitStats.h"
+
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "gait_stats");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+    GaitStats stats(nh, pnh);
+    ros::spin();
+
+    return 0;
+}
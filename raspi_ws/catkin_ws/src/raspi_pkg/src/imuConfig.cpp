@@ -0,0 +1,92 @@
+#include "ros/ros.h"
+#include <raspi_pkg/ImuConfig.h>
+#include <raspi_pkg/SetImuConfig.h>
+#include <algorithm>
+#include <string>
+
+//ImuConfig hands the IMU's full-scale ranges and output data rates to firmware built with
+//IMU_CONFIG_MSG: latched on /imu_config, so the Teensy gets them each time it connects, without
+//a reflash. They start from ~accel_range_g, ~gyro_range_dps, ~rate_hz, ~mag_range_gauss and
+//~mag_rate_hz, where 0 (the default) keeps the firmware's IMU_* setting, and ~set
+//(raspi_pkg/SetImuConfig) replaces them at run time, e.g. to sweep rate/range combinations.
+//
+//The checks here are the ones the firmware makes, so a bad combination is refused on the call
+//rather than in the Teensy's "imu" diagnostics; those say what the sensors took. The control
+//rate is the firmware's build profile and does not follow the IMU rate.
+
+class ImuConfigNode{
+
+    public:
+        ImuConfigNode(ros::NodeHandle& nh, ros::NodeHandle& pnh) : pnh(pnh){
+            config.accel_range_g = pnh.param("accel_range_g", 0);
+            config.gyro_range_dps = pnh.param("gyro_range_dps", 0);
+            config.rate_hz = pnh.param("rate_hz", 0.0);
+            config.mag_range_gauss = pnh.param("mag_range_gauss", 0);
+            config.mag_rate_hz = pnh.param("mag_rate_hz", 0.0);
+            std::string error = check(config);
+            if (!error.empty()) {
+                ROS_ERROR("imu_config: %s, keeping the firmware's settings", error.c_str());
+                config = raspi_pkg::ImuConfig();
+            }
+            pub = nh.advertise<raspi_pkg::ImuConfig>("imu_config", 1, true);
+            pub.publish(config);
+            service = pnh.advertiseService("set", &ImuConfigNode::set, this);
+        }
+
+        bool set(raspi_pkg::SetImuConfig::Request& req, raspi_pkg::SetImuConfig::Response& res){
+            res.message = check(req.config);
+            res.accepted = res.message.empty();
+            if (res.accepted) {
+                config = req.config;
+                pnh.setParam("accel_range_g", config.accel_range_g);
+                pnh.setParam("gyro_range_dps", config.gyro_range_dps);
+                pnh.setParam("rate_hz", config.rate_hz);
+                pnh.setParam("mag_range_gauss", config.mag_range_gauss);
+                pnh.setParam("mag_rate_hz", config.mag_rate_hz);
+                pub.publish(config);
+                ROS_INFO("imu_config: %u g, %u dps, %.1f Hz; %u gauss, %.3f Hz", config.accel_range_g,
+                         config.gyro_range_dps, config.rate_hz, config.mag_range_gauss, config.mag_rate_hz);
+            }
+            return true;
+        }
+
+        //empty if the firmware takes c
+        static std::string check(const raspi_pkg::ImuConfig& c){
+            static const uint16_t accelRanges[] = {0, 2, 4, 8, 16};
+            static const uint16_t gyroRanges[] = {0, 125, 250, 500, 1000, 2000};
+            static const uint16_t magRanges[] = {0, 4, 8, 12, 16};
+            if (std::find(std::begin(accelRanges), std::end(accelRanges), c.accel_range_g) == std::end(accelRanges)) {
+                return "accel_range_g is not 2, 4, 8 or 16";
+            }
+            if (std::find(std::begin(gyroRanges), std::end(gyroRanges), c.gyro_range_dps) == std::end(gyroRanges)) {
+                return "gyro_range_dps is not 125, 250, 500, 1000 or 2000";
+            }
+            if (std::find(std::begin(magRanges), std::end(magRanges), c.mag_range_gauss) == std::end(magRanges)) {
+                return "mag_range_gauss is not 4, 8, 12 or 16";
+            }
+            if (c.rate_hz < 0.0f || c.rate_hz > 6660.0f) {
+                return "rate_hz is not within the LSM6DSOX's 0 to 6660 Hz";
+            }
+            if (c.mag_rate_hz < 0.0f || c.mag_rate_hz > 1000.0f) {
+                return "mag_rate_hz is not within the LIS3MDL's 0 to 1000 Hz";
+            }
+            return "";
+        }
+
+    private:
+        ros::NodeHandle pnh;
+        ros::Publisher pub;
+        ros::ServiceServer service;
+        raspi_pkg::ImuConfig config;
+};
+
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "imu_config");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+    ImuConfigNode node(nh, pnh);
+    ros::spin();
+
+    return 0;
+}
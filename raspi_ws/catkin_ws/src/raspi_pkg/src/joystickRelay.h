@@ -0,0 +1,63 @@
+#ifndef RASPI_PKG_JOYSTICK_RELAY_H
+#define RASPI_PKG_JOYSTICK_RELAY_H
+
+#include "ros/ros.h"
+#include <raspi_pkg/Teleop.h>
+#include <sensor_msgs/JointState.h>
+#include <sensor_msgs/Joy.h>
+#include "messagePool.h"
+
+//JoystickRelay turns /joy into the velocity command the Teensy expects on /torso_command:
+//velocity = [right stick x, right stick y], scaled by MOTOR_VELOCITY_LIMIT on the Teensy.
+//Purely callback driven; the command message is allocated once.
+//
+//~teleop (default false): publish the two axes as raspi_pkg/Teleop on /teleop instead, for
+//firmware built with TELEOP_MSG. The 8-byte message goes to the Teensy as it is, with no
+//header, name or position arrays to fill and serialize, and the firmware applies it without
+//the JointState decode; each one is a shared_ptr from a MessagePool, so in a nodelet manager
+//the bridge gets it without a copy and the callback allocates nothing.
+//
+//The sticks go as they are: firmware built with TELEOP_SHAPING applies the deadband, expo
+//curve and rate limit itself (TeleopShaper), so teleop does not wait on a busy Pi.
+
+class JoystickRelay{
+
+    public:
+        JoystickRelay(ros::NodeHandle& nh, ros::NodeHandle& pnh){
+            compact = pnh.param("teleop", false);
+            if (compact) {
+                pub = nh.advertise<raspi_pkg::Teleop>("teleop", 1);
+            } else {
+                joystickCommand.velocity.resize(2);
+                pub = nh.advertise<sensor_msgs::JointState>("torso_command", 1);
+            }
+            sub = nh.subscribe("joy", 10, &JoystickRelay::joystickCb, this, ros::TransportHints().tcpNoDelay());
+        }
+
+        void joystickCb(const sensor_msgs::Joy::ConstPtr& msg){
+            if (msg->axes.size() < 4) {
+                ROS_WARN_THROTTLE(1.0, "Joystick reports %zu axes, need 4", msg->axes.size());
+                return;
+            }
+            if (compact) {
+                raspi_pkg::TeleopPtr teleop = teleopMsgs.next();
+                teleop->velocity[0] = msg->axes[2];
+                teleop->velocity[1] = msg->axes[3];
+                pub.publish(teleop);
+                return;
+            }
+            joystickCommand.header.stamp = ros::Time::now();
+            joystickCommand.velocity[0] = msg->axes[2];
+            joystickCommand.velocity[1] = msg->axes[3];
+            pub.publish(joystickCommand);
+        }
+
+    private:
+        ros::Publisher pub;
+        ros::Subscriber sub;
+        bool compact = false;
+        sensor_msgs::JointState joystickCommand;
+        MessagePool<raspi_pkg::Teleop> teleopMsgs;
+};
+
+#endif //RASPI_PKG_JOYSTICK_RELAY_H
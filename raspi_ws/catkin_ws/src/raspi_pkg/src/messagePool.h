@@ -0,0 +1,52 @@
+#ifndef RASPI_PKG_MESSAGE_POOL_H
+#define RASPI_PKG_MESSAGE_POOL_H
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+//MessagePool hands out messages to publish by shared_ptr, so a subscriber in the same process
+//(a nodelet manager) gets them without serialization, and reuses each one once the publisher's
+//queue and every subscriber have let it go: use_count() == 1 is the pool's own reference. After
+//the first few ticks the pool holds as many messages as are ever in flight at once and next()
+//stops allocating; so do the messages' arrays, which keep their capacity between uses.
+//
+//init runs once per message, when it is allocated, e.g. to size the arrays next()'s caller
+//fills by index. Every field the caller does not set keeps its previous use's value.
+//A pool is for one publishing thread; the subscribers may be anywhere.
+
+template<class M>
+class MessagePool{
+
+    public:
+        typedef boost::shared_ptr<M> Ptr;
+
+        explicit MessagePool(std::function<void(M&)> init = nullptr, size_t reserve = 4) : init(init){
+            messages.reserve(reserve);
+        }
+
+        Ptr next(){
+            for (const Ptr& msg : messages) {
+                if (msg.use_count() == 1)
+                    return msg;
+            }
+            Ptr msg = boost::make_shared<M>();
+            if (init)
+                init(*msg);
+            messages.push_back(msg);
+            return msg;
+        }
+
+        //messages allocated so far, which stays put once the pool has warmed up
+        size_t size() const{
+            return messages.size();
+        }
+
+    private:
+        std::function<void(M&)> init;
+        std::vector<Ptr> messages;
+};
+
+#endif //RASPI_PKG_MESSAGE_POOL_H
@@ -0,0 +1,68 @@
+#ifndef RASPI_PKG_ODRIVE_ERRORS_H
+#define RASPI_PKG_ODRIVE_ERRORS_H
+
+#include <raspi_pkg/ODriveErrors.h>
+#include <cstdint>
+
+//ODriveErrorCache holds the ODrive's error registers as of the latest /odrive_errors
+//(raspi_pkg/ODriveErrors), decoded from the packed form: the Teensy only sends the
+//non-zero registers, and only on a change or as its heartbeat, so the cache is where
+//the current value of every register lives on the Pi.
+//
+//A message whose values do not match its nonzero bits is counted and ignored. A jump of
+//changes by more than one is that many changes lost on the link; a step back is a reset
+//Teensy and starts the count again. stale() is a heartbeat missed, i.e. no word from the
+//Teensy, not a quiet ODrive.
+
+class ODriveErrorCache{
+
+    public:
+        static constexpr int numRegisters = raspi_pkg::ODriveErrors::NUM_REGISTERS;
+
+        //false if the message was malformed and left the cache as it was
+        bool update(const raspi_pkg::ODriveErrors& msg, int64_t nowNs){
+            int count = 0;
+            for (int i = 0; i < numRegisters; ++i)
+                if (msg.nonzero & (1u << i)) ++count;
+            if (count != (int)msg.values.size() || msg.nonzero >> numRegisters) {
+                ++malformed;
+                return false;
+            }
+            if (received && msg.changes >= changes && msg.changes - changes > 1)
+                lost += msg.changes - changes - 1;
+            changes = msg.changes;
+            nonzeroBits = msg.nonzero;
+            for (int i = 0, next = 0; i < numRegisters; ++i)
+                registers[i] = msg.nonzero & (1u << i) ? msg.values[next++] : 0;
+            receivedNs = nowNs;
+            readAgeNs = (int64_t)msg.age_ms*1000000;
+            received = true;
+            ++messages;
+            return true;
+        }
+
+        //raspi_pkg::ODriveErrors::ODRIVE to CONTROLLER1; 0 before the first message
+        int64_t value(int reg) const { return reg >= 0 && reg < numRegisters ? registers[reg] : 0; }
+        //Bit i for a non-zero register i
+        uint16_t nonzero() const { return nonzeroBits; }
+        bool anyError() const { return nonzeroBits != 0; }
+
+        //Since the least recently read register was read on the Teensy, as of nowNs
+        int64_t ageNs(int64_t nowNs) const { return received ? nowNs - receivedNs + readAgeNs : -1; }
+        //No message for maxSilenceNs, a few heartbeat periods
+        bool stale(int64_t nowNs, int64_t maxSilenceNs) const { return !received || nowNs - receivedNs > maxSilenceNs; }
+
+        uint64_t messageCount() const { return messages; }
+        uint64_t lostChanges() const { return lost; }
+        uint64_t malformedCount() const { return malformed; }
+
+    private:
+        int64_t registers[numRegisters] = {};
+        uint16_t nonzeroBits = 0;
+        uint32_t changes = 0;
+        bool received = false;
+        int64_t receivedNs = 0, readAgeNs = 0;
+        uint64_t messages = 0, lost = 0, malformed = 0;
+};
+
+#endif //RASPI_PKG_ODRIVE_ERRORS_H
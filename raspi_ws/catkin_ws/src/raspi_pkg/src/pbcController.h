@@ -0,0 +1,385 @@
+#ifndef RASPI_PKG_PBC_CONTROLLER_H
+#define RASPI_PKG_PBC_CONTROLLER_H
+
+#include "ros/ros.h"
+#include <sensor_msgs/JointState.h>
+#include <std_msgs/String.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <NeuralPBC.h>
+#include <PosteriorBank.h>
+#include <weights/deter_hardware_even_1mpers.h>
+#include <weights/rw_bayesian.h>
+#include <weights/deter2_hardware_even_1mpers.h>
+#include <weights/deterministic_hardware.h>
+#include <weights/hardware_even_688771.h>
+#include <weights/hardware_even_deter_1mpers.h>
+#include <RobotModel.h>
+#include <ImpactMap.h>
+#include <StatePredictor.h>
+#include <StanceTracker.h>
+#include <filters_sos.h>
+#include <RimlessWheelModel.h>
+#include "messagePool.h"
+#include "shmChannel.h"
+#include "realtime.h"
+#include "weightFile.h"
+
+//PbcController runs the neural PBC of julia_pkg's evaluatePbc.jl / bayesianPBC.jl in C++:
+//the same inputLayer, MLBasedESC.controller and clamp(satu), on the weights exported by
+//exportWeights.py. Each /sensors sample is answered with one /torso_command from inside the
+//callback, so the torque never acts on a sample older than the compute time. If /sensors goes
+//silent for ~sensor_timeout seconds a watchdog commands zero torque until samples come back.
+//position = [torso roll, spoke 0, spoke 1, yaw], velocity = [torso omega, spoke 0, spoke 1]
+//sensors and torso_command are relative names, so a controller handed a namespaced NodeHandle
+//(pbcControllerNode.cpp's ~robots, or a nodelet in a <group ns>) drives that wheel alone.
+//
+//~controller: "deterministic" (evaluatePbc.jl), "bayesian" (marginalize() over the exported
+//posterior samples), "map" (posterior mean) or another exported network by its name, e.g.
+//"hardware_even_688771"; ~satu defaults to the script's value, and ~<controller>/satu sets
+//one alone. All of them are loaded at startup; a name published on
+//~select switches between them from the next sample on, without a reload or an allocation,
+//and the latched ~active reports the one in use, so one run can A/B them.
+//
+//~weights_dir (empty by default): a directory of exportWeights.py's .pbcw files, e.g. the
+//build's pbc_weights/weights or a copy of teensy/lib/NeuralPBC/weights. Each network whose
+//<network>.pbcw is there runs on the file's weights, memory-mapped and checked against the
+//compiled widths (weightFile.h), instead of the ones compiled in; a missing file or one of
+//another shape leaves that network on the compiled-in weights with a warning. "bayesian" and
+//"map" read rw_bayesian.pbcw's samples and mean. Loading is an mmap and a checksum, so a
+//restart after a crash is back in control within milliseconds.
+//
+//Torques go out as shared_ptrs from a MessagePool, so in a nodelet manager the Teensy bridge
+//gets them without serialization, and the callback allocates nothing once the pool is warm.
+//Callbacks must not run concurrently (single-threaded spinner or nodelet callback queue).
+//~select is the exception, it only swaps a pointer.
+//
+//Each torque echoes the header.frame_id of the /sensors sample it answers, the sample's seq
+//as text, so the Teensy's COMMAND_LATENCY mode can time sample to torque; watchdog zeros
+//echo nothing.
+//
+//~predict: the sample is forward-integrated with the rimless-wheel stance dynamics (and an
+//impact inside the horizon) before inputLayer, under the torque last sent, by its age at the
+//callback (now - header.stamp, in Pi time once the bridge's clock sync is up) plus
+//~actuation_delay for the trip to the Teensy and its hold until the next control tick.
+//~max_prediction caps the horizon.
+//
+//~shm: the name of teensy_bridge's shared-memory channel (shmChannel.h), empty for ROS. With
+//it set, /sensors and /torso_command are left to the bridge, which publishes both for
+//monitoring, and a control thread waits on the channel's sample slot and writes each torque
+//into its command slot; the sensor timeout is kept by that thread.
+//
+//~contact_angle (default false): the network sees the stance spoke's angle, StanceTracker's with
+//~stance_hysteresis rad (0.01) past +-alpha before it moves on, as the firmware's
+//SPOKE_CONTACT_ANGLE, instead of the angle since start-up.
+//
+//~smoothing_hz: the low-pass cutoff on the torque sent, 0 (the default) for the raw network
+//output. A second-order section of the firmware's libFilter (filters_sos.h, the same SosFilter
+//the Teensy runs), designed for samples at ~sample_rate (Hz of /sensors, 100 by default) as
+//~smoothing_prototype "bessel" (no overshoot, the default) or "butterworth". Its state carries
+//over from sample to sample and across ~select, so a switch of networks ramps rather than
+//steps; it starts again from zero only after a watchdog zero, which is what the wheel saw.
+//The predictor is handed the smoothed torque, the one the Teensy holds.
+//
+//The control thread (over ROS, the node's spinning thread) takes realtime.h's rt_priority (70
+//by default), cpu_affinity, lock_memory and prealloc_mb; probe_latency reports at startup.
+
+typedef pbc_weights::deter_hardware_even_1mpers DeterministicNetwork;
+typedef pbc_weights::rw_bayesian BayesianNetwork;
+
+class PbcController{
+
+    public:
+        PbcController(ros::NodeHandle& nh, ros::NodeHandle& pnh){
+            //every controller is built here, so a switch is one pointer store and no allocation
+            pnh.param<std::string>("weights_dir", weightsDir, "");
+            float bayesSatu = pnh.param("bayesian/satu", pnh.param("satu", 2.0));
+            bank.reset(new PosteriorBank<BayesianNetwork, BayesianNetwork::num_samples>(bayesSatu));
+            const weight_file::WeightFile* posterior = mapWeights<BayesianNetwork::chain>("rw_bayesian", BayesianNetwork::num_samples);
+            bank->load(posterior ? posterior->samples() : BayesianNetwork::samples());
+            addNetwork<DeterministicNetwork>("deterministic", "deter_hardware_even_1mpers", pnh, 1.0);
+            controllers.push_back({"bayesian", [this](float q1, float q2, float w1, float w2){ return bank->control(q1, q2, w1, w2); }});
+            addNetwork<BayesianNetwork>("map", "rw_bayesian", pnh, 2.0, posterior);
+            //the other saved_weights networks exportWeights.py ships
+            addNetwork<pbc_weights::deter2_hardware_even_1mpers>("deter2_hardware_even_1mpers", pnh, 1.0);
+            addNetwork<pbc_weights::deterministic_hardware>("deterministic_hardware", pnh, 1.0);
+            addNetwork<pbc_weights::hardware_even_688771>("hardware_even_688771", pnh, 1.0);
+            addNetwork<pbc_weights::hardware_even_deter_1mpers>("hardware_even_deter_1mpers", pnh, 1.0);
+
+            std::string controller;
+            pnh.param<std::string>("controller", controller, "deterministic");
+            activePub = pnh.advertise<std_msgs::String>("active", 1, true);
+            if (!select(controller)) {
+                ROS_WARN("Unknown controller '%s', using deterministic", controller.c_str());
+                select("deterministic");
+            }
+            selectSub = pnh.subscribe("select", 1, &PbcController::selectCb, this);
+
+            if (pnh.param("predict", false)) {
+                double maxPrediction = pnh.param("max_prediction", 0.03);
+                actuationDelay = pnh.param("actuation_delay", 0.005);
+                predictor.reset(new StatePredictor<RimlessWheel>(0.002f, (float)maxPrediction));
+                ROS_INFO("Predicting by the sample age + %.1f ms, at most %.0f ms", actuationDelay * 1e3, maxPrediction * 1e3);
+            }
+
+            if (pnh.param("contact_angle", false)) {
+                stance.reset(new StanceTracker<RimlessWheelModel>((float)pnh.param("stance_hysteresis", 0.01)));
+            }
+
+            double smoothingHz = pnh.param("smoothing_hz", 0.0);
+            if (smoothingHz > 0.0) {
+                double sampleRate = pnh.param("sample_rate", 100.0);
+                std::string prototype = pnh.param<std::string>("smoothing_prototype", "bessel");
+                if (smoothingHz >= sampleRate / 2.0) {
+                    ROS_WARN("~smoothing_hz %.1f is not below the Nyquist rate of %.0f Hz samples, not smoothing", smoothingHz, sampleRate);
+                } else {
+                    if (prototype != "bessel" && prototype != "butterworth")
+                        ROS_WARN("Unknown ~smoothing_prototype '%s', using bessel", prototype.c_str());
+                    smoother.reset(new SosFilter<2>(prototype == "butterworth"
+                        ? IIR::design<2, IIR::PROTOTYPE::BUTTERWORTH>(smoothingHz, 1.0 / sampleRate)
+                        : IIR::design<2, IIR::PROTOTYPE::BESSEL>(smoothingHz, 1.0 / sampleRate)));
+                    ROS_INFO("Smoothing the torque at %.1f Hz (%s, %.0f Hz samples)", smoothingHz, prototype.c_str(), sampleRate);
+                }
+            }
+
+            double timeout = pnh.param("sensor_timeout", 0.05);
+            sensorTimeoutNs = (int64_t)(timeout * 1e9);
+
+            std::string shmName = pnh.param<std::string>("shm", "");
+            if (!shmName.empty()) {
+                std::string error;
+                shm = shm_channel::open(shmName, error);
+                if (!shm) {
+                    ROS_ERROR("%s, falling back to ROS topics", error.c_str());
+                }
+            }
+            rt = realtime::Config::fromParams(pnh, 70);
+            realtime::lockMemory(rt);
+            realtime::probeLatency(rt, "pbc_controller");
+            if (shm) {
+                running = true;
+                controlThread = std::thread(&PbcController::controlLoop, this);
+                realtime::configureThread(controlThread.native_handle(), rt, "control thread");
+                ROS_INFO("Controlling over shared memory %s", shmName.c_str());
+                return;
+            }
+            pub = nh.advertise<sensor_msgs::JointState>("torso_command", 1);
+            sub = nh.subscribe("sensors", 1, &PbcController::sensorCb, this, ros::TransportHints().tcpNoDelay());
+            watchdogTimer = nh.createWallTimer(ros::WallDuration(timeout / 2.0), &PbcController::watchdog, this);
+        }
+
+        void sensorCb(const sensor_msgs::JointState::ConstPtr& msg){
+            if (msg->position.size() < 2 || msg->velocity.size() < 2) {
+                ROS_WARN_THROTTLE(1.0, "Short /sensors message");
+                return;
+            }
+            float torque = compute(msg->position[0], msg->position[1], msg->velocity[0], msg->velocity[1], msg->header.stamp);
+            publish(torque, msg->header.frame_id);
+            sampleReceived();
+        }
+
+        //Makes the named controller the one the next sample sees; false if there is none
+        bool select(const std::string& name){
+            for (Controller& controller : controllers) {
+                if (controller.name == name) {
+                    active.store(&controller, std::memory_order_release);
+                    std_msgs::String msg;
+                    msg.data = name;
+                    activePub.publish(msg);
+                    ROS_INFO("PBC controller: %s", name.c_str());
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void selectCb(const std_msgs::String::ConstPtr& msg){
+            if (!select(msg->data))
+                ROS_WARN("Unknown controller '%s', keeping %s", msg->data.c_str(), active.load()->name.c_str());
+        }
+
+        void watchdog(const ros::WallTimerEvent&){
+            if (lastSensorNs == 0 || sensorsStale)
+                return;
+            if (ros::WallTime::now().toNSec() - lastSensorNs > sensorTimeoutNs) {
+                sensorsStale = true;
+                resetSmoothing();
+                publish(0.0f);
+                ROS_WARN("No /sensors for %.0f ms, commanding zero torque", sensorTimeoutNs * 1e-6);
+            }
+        }
+
+        //Leaves the wheel with zero torque: over ROS at once, over shared memory as the control
+        //thread's last write, so the command slot keeps its single writer
+        void halt(){
+            if (shm) {
+                running = false;
+            } else if (ros::ok()) {
+                publish(0.0f);
+            }
+        }
+
+        bool sharedMemory() const{
+            return shm != nullptr;
+        }
+
+        const realtime::Config& realtimeConfig() const{
+            return rt;
+        }
+
+        ~PbcController(){
+            halt();
+            if (controlThread.joinable())
+                controlThread.join();
+            shm_channel::close(shm);
+        }
+
+        void publish(float torque, const std::string& echo = std::string()){
+            sensor_msgs::JointStatePtr msg = torqueMsgs.next();
+            msg->header.seq = ++torqueSeq;
+            msg->header.frame_id = echo;
+            msg->header.stamp = ros::Time::now();
+            msg->effort[0] = torque;
+            pub.publish(msg);
+            lastTorque = torque;
+        }
+
+    private:
+        float compute(float roll, float spoke, float rollRate, float spokeRate, const ros::Time& stamp){
+            if (predictor) {
+                //RimlessWheel's x = [stance spoke, torso, rates]; the stance angle is only
+                //needed for the dynamics, the spoke keeps its continuous angle plus the motion
+                float horizon = (float)((ros::Time::now() - stamp).toSec() + actuationDelay);
+                float x[4] = {RimlessWheelModel::wrapSpoke(spoke), roll, spokeRate, rollRate}, xp[4];
+                predictor->predict(x, lastTorque, horizon, xp);
+                spoke += RimlessWheelModel::wrapSpoke(xp[0] - x[0]);
+                roll = xp[1];
+                spokeRate = xp[2];
+                rollRate = xp[3];
+            }
+            //update_state! in evaluatePbc.jl: spoke 0 is measured from the upright contact
+            if (stance) {
+                float spokeStates[4] = {spoke, 0.0f, spokeRate, 0.0f};
+                stance->update(spokeStates);
+                spoke = stance->contactAngle();
+            }
+            Controller* controller = active.load(std::memory_order_acquire);
+            float torque = controller->control(roll, M_PI + spoke, rollRate, spokeRate);
+            return smoother ? smoother->filterIn(torque) : torque;
+        }
+
+        //Called on the thread that runs compute(), so the filter has a single user
+        void resetSmoothing(){
+            if (smoother)
+                smoother->flush();
+        }
+
+        void sampleReceived(){
+            lastSensorNs = ros::WallTime::now().toNSec();
+            if (sensorsStale) {
+                sensorsStale = false;
+                ROS_INFO("/sensors is back, resuming control");
+            }
+        }
+
+        //The shared-memory counterpart of sensorCb() and watchdog()
+        void controlLoop(){
+            if (rt.lockMemory) {
+                realtime::prefaultStack();
+            }
+            uint32_t lastSample = 0;
+            shm_channel::Sample sample;
+            while (running) {
+                //short waits so halt() is seen within 10 ms
+                if (shm->sample.wait(lastSample, sample, 10000000)) {
+                    ros::Time stamp;
+                    stamp.fromNSec(sample.stampNs);
+                    float torque = compute(sample.position[0], sample.position[1], sample.velocity[0], sample.velocity[1], stamp);
+                    writeCommand(torque, sample.seq);
+                    sampleReceived();
+                } else if (lastSensorNs != 0 && !sensorsStale && ros::WallTime::now().toNSec() - lastSensorNs > sensorTimeoutNs) {
+                    sensorsStale = true;
+                    resetSmoothing();
+                    writeCommand(0.0f, 0);
+                    ROS_WARN("No samples in shared memory for %.0f ms, commanding zero torque", sensorTimeoutNs * 1e-6);
+                }
+            }
+            writeCommand(0.0f, 0);
+        }
+
+        void writeCommand(float torque, uint32_t sampleSeq){
+            shm_channel::Command command = {++torqueSeq, sampleSeq, torque, 0};
+            shm->command.write(command);
+            lastTorque = torque;
+        }
+
+        struct Controller{
+            std::string name;
+            std::function<float(float, float, float, float)> control;
+        };
+
+        template<class Network>
+        void addNetwork(const std::string& name, ros::NodeHandle& pnh, double satu){
+            addNetwork<Network>(name, name, pnh, satu);
+        }
+
+        //network: the exported name, of its .pbcw; file: one already mapped, e.g. the posterior's
+        template<class Network>
+        void addNetwork(const std::string& name, const std::string& network, ros::NodeHandle& pnh, double satu,
+                        const weight_file::WeightFile* file = nullptr){
+            if (!file) {
+                file = mapWeights<typename Network::chain>(network, 0);
+            }
+            NeuralPBC<Network> pbc(pnh.param(name + "/satu", pnh.param("satu", satu)), file ? file->params() : Network::params());
+            controllers.push_back({name, [pbc](float q1, float q2, float w1, float w2) mutable { return pbc.control(q1, q2, w1, w2); }});
+        }
+
+        //~weights_dir/<network>.pbcw if it is there and fits Chain, else nullptr for the compiled-in weights
+        template<class Chain>
+        const weight_file::WeightFile* mapWeights(const std::string& network, int numSamples){
+            if (weightsDir.empty()) {
+                return nullptr;
+            }
+            std::string path = weightsDir + "/" + network + ".pbcw";
+            std::unique_ptr<weight_file::WeightFile> file(new weight_file::WeightFile());
+            std::string error;
+            if (!file->open<Chain>(path, numSamples, error)) {
+                ROS_WARN("%s, %s runs on its compiled-in weights", error.c_str(), network.c_str());
+                return nullptr;
+            }
+            ROS_INFO("%s: weights from %s", network.c_str(), path.c_str());
+            weightFiles.push_back(std::move(file));
+            return weightFiles.back().get();
+        }
+
+        ros::Publisher pub;
+        ros::Subscriber sub;
+        ros::WallTimer watchdogTimer;
+        MessagePool<sensor_msgs::JointState> torqueMsgs{[](sensor_msgs::JointState& msg){ msg.effort.resize(1); }};
+        uint32_t torqueSeq = 0;
+        int64_t sensorTimeoutNs;
+        int64_t lastSensorNs = 0;
+        bool sensorsStale = false;
+        std::unique_ptr<StatePredictor<RimlessWheel>> predictor;
+        double actuationDelay = 0.0;
+        float lastTorque = 0.0f; //held by the Teensy over the prediction horizon
+        std::unique_ptr<SosFilter<2>> smoother;
+        std::unique_ptr<StanceTracker<RimlessWheelModel>> stance;
+        std::unique_ptr<PosteriorBank<BayesianNetwork, BayesianNetwork::num_samples>> bank;
+        std::string weightsDir;
+        std::vector<std::unique_ptr<weight_file::WeightFile>> weightFiles; //mapped for the controllers' lifetime
+        std::vector<Controller> controllers; //not resized after construction, active points into it
+        std::atomic<Controller*> active{nullptr};
+        ros::Publisher activePub;
+        ros::Subscriber selectSub;
+        realtime::Config rt;
+        shm_channel::Region* shm = nullptr;
+        std::thread controlThread;
+        std::atomic<bool> running{false};
+};
+
+#endif //RASPI_PKG_PBC_CONTROLLER_H
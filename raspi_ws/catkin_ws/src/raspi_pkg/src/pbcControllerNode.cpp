@@ -0,0 +1,109 @@
+#include "ros/ros.h"
+#include <ros/callback_queue.h>
+#include <signal.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "pbcController.h"
+
+std::vector<PbcController*> controllers;
+std::atomic<bool> sigintReceived{false};
+
+//Only the flag: publishing and sleeping are not async-signal-safe
+void shutdownCb(int){
+    sigintReceived = true;
+}
+
+//Serves queue until SIGINT
+void spinUntilSigint(ros::CallbackQueue* queue){
+    while (ros::ok() && !sigintReceived) {
+        queue->callAvailable(ros::WallDuration(0.01));
+    }
+}
+
+//safe_shutdown_hack() of the Julia scripts: leave the wheels with zero torque. Only once no
+//thread serves the controllers' queues, so a torque computed after it cannot override it and
+//the controllers publish from one thread at a time
+void haltAndShutdown(){
+    for (PbcController* controller : controllers) {
+        controller->halt();
+    }
+    if (!controllers.empty()) {
+        ros::Duration(0.05).sleep();
+    }
+    ros::shutdown();
+}
+
+//One controller, or with ~robots (e.g. [wheel1, wheel2]) one per wheel: controller i listens on
+//robots[i]/sensors and answers on robots[i]/torso_command, with its parameters (controller,
+//satu, predict, shm, ...) in ~robots[i]/; each wheel needs its own shm channel name.
+//
+//Over ROS the controllers are served by a pool of ~threads workers (one per robot by default),
+//each with its own callback queue and controllers dealt round-robin onto them, so a
+//controller's callbacks never run concurrently and the wheels are computed in parallel. The
+//workers take the node's rt_priority and cpu_affinity. Over shared memory each controller has
+//its own control thread and the pool is not used.
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "nn_controller", ros::init_options::NoSigintHandler);
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+
+    std::vector<std::string> robots;
+    pnh.param("robots", robots, std::vector<std::string>());
+    std::vector<std::unique_ptr<PbcController>> owned;
+    if (robots.empty()) {
+        owned.emplace_back(new PbcController(nh, pnh));
+        controllers.push_back(owned.back().get());
+        if (!owned.back()->sharedMemory()) {
+            //sensorCb() runs on this thread
+            realtime::configureThread(pthread_self(), owned.back()->realtimeConfig(), "ROS spinner");
+        }
+        signal(SIGINT, shutdownCb);
+        spinUntilSigint(ros::getGlobalCallbackQueue());
+        haltAndShutdown();
+        controllers.clear();
+        return 0;
+    }
+
+    int threads = std::max(1, std::min(pnh.param("threads", (int)robots.size()), (int)robots.size()));
+    std::vector<std::unique_ptr<ros::CallbackQueue>> queues;
+    for (int i = 0; i < threads; ++i) {
+        queues.emplace_back(new ros::CallbackQueue);
+    }
+    for (size_t i = 0; i < robots.size(); ++i) {
+        ros::NodeHandle rnh(nh, robots[i]);
+        ros::NodeHandle rpnh(pnh, robots[i]);
+        rnh.setCallbackQueue(queues[i % threads].get());
+        rpnh.setCallbackQueue(queues[i % threads].get());
+        owned.emplace_back(new PbcController(rnh, rpnh));
+        controllers.push_back(owned.back().get());
+    }
+    signal(SIGINT, shutdownCb);
+
+    realtime::Config rt = realtime::Config::fromParams(pnh, 70);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        ros::CallbackQueue* queue = queues[i].get();
+        workers.emplace_back([queue, &rt](){
+            if (rt.lockMemory) {
+                realtime::prefaultStack();
+            }
+            spinUntilSigint(queue);
+        });
+        realtime::configureThread(workers.back().native_handle(), rt, "controller worker");
+    }
+    ROS_INFO("%zu controllers on %d worker threads", robots.size(), threads);
+    //the global queue has nothing of the controllers', only ROS's own housekeeping
+    spinUntilSigint(ros::getGlobalCallbackQueue());
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    haltAndShutdown();
+    controllers.clear();
+
+    return 0;
+}
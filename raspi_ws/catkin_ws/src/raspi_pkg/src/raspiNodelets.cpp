@@ -0,0 +1,84 @@
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <memory>
+#include "diagnosticsSummary.h"
+#include "gaitStats.h"
+#include "joystickRelay.h"
+#include "pbcController.h"
+#include "runRecorder.h"
+#include "sensorLogger.h"
+
+namespace raspi_pkg {
+
+//Nodelet wrappers so the whole Pi pipeline can share one manager with raspi_pkg/TeensyBridge,
+//passing /sensors and /torso_command as shared_ptrs instead of over TCPROS loopback.
+//Each uses the nodelet's own callback queue, so its callbacks never run concurrently.
+
+class JoystickRelayNodelet : public nodelet::Nodelet{
+
+    private:
+        void onInit() override {
+            relay.reset(new JoystickRelay(getNodeHandle(), getPrivateNodeHandle()));
+        }
+
+        std::unique_ptr<JoystickRelay> relay;
+};
+
+class PbcControllerNodelet : public nodelet::Nodelet{
+
+    private:
+        void onInit() override {
+            controller.reset(new PbcController(getNodeHandle(), getPrivateNodeHandle()));
+        }
+
+        std::unique_ptr<PbcController> controller;
+};
+
+class SensorLoggerNodelet : public nodelet::Nodelet{
+
+    private:
+        void onInit() override {
+            logger.reset(new SensorLogger(getNodeHandle(), getPrivateNodeHandle()));
+        }
+
+        std::unique_ptr<SensorLogger> logger;
+};
+
+class RunRecorderNodelet : public nodelet::Nodelet{
+
+    private:
+        void onInit() override {
+            recorder.reset(new RunRecorder(getNodeHandle(), getPrivateNodeHandle()));
+        }
+
+        std::unique_ptr<RunRecorder> recorder;
+};
+
+class GaitStatsNodelet : public nodelet::Nodelet{
+
+    private:
+        void onInit() override {
+            stats.reset(new GaitStats(getNodeHandle(), getPrivateNodeHandle()));
+        }
+
+        std::unique_ptr<GaitStats> stats;
+};
+
+class DiagnosticsSummaryNodelet : public nodelet::Nodelet{
+
+    private:
+        void onInit() override {
+            summary.reset(new DiagnosticsSummary(getNodeHandle(), getPrivateNodeHandle()));
+        }
+
+        std::unique_ptr<DiagnosticsSummary> summary;
+};
+
+} // namespace raspi_pkg
+
+PLUGINLIB_EXPORT_CLASS(raspi_pkg::JoystickRelayNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(raspi_pkg::PbcControllerNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(raspi_pkg::SensorLoggerNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(raspi_pkg::RunRecorderNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(raspi_pkg::GaitStatsNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(raspi_pkg::DiagnosticsSummaryNodelet, nodelet::Nodelet)
@@ -0,0 +1,153 @@
+#ifndef RASPI_PKG_REALTIME_H
+#define RASPI_PKG_REALTIME_H
+
+#include "ros/ros.h"
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Real-time setup shared by teensy_bridge and pbc_controller, from each node's private params:
+//  rt_priority   SCHED_FIFO priority of the node's control-path threads, 0 for SCHED_OTHER
+//  cpu_affinity  cores those threads may run on, e.g. [2, 3]; empty for any
+//  lock_memory   mlockall() the process and prefault each control-path thread's stack
+//  prealloc_mb   heap faulted in and kept by malloc, so later allocations take no page fault
+//  probe_latency seconds of a cyclictest-style wakeup probe at startup, 0 to skip
+//
+//The Pi has four cores shared with joy_node and the Julia runtime; pinning the bridge and
+//controller to cores the others are kept off (isolcpus=, or taskset for the rest) is what
+//bounds the latency, priority alone only orders the threads on one core.
+
+namespace realtime {
+
+struct Config{
+    int priority = 0;
+    std::vector<int> cpus;
+    bool lockMemory = false;
+    int preallocMb = 0;
+    double probeSeconds = 0.0;
+
+    static Config fromParams(ros::NodeHandle& pnh, int defaultPriority){
+        Config c;
+        pnh.param("rt_priority", c.priority, defaultPriority);
+        pnh.param("cpu_affinity", c.cpus, std::vector<int>());
+        pnh.param("lock_memory", c.lockMemory, false);
+        pnh.param("prealloc_mb", c.preallocMb, 0);
+        pnh.param("probe_latency", c.probeSeconds, 0.0);
+        return c;
+    }
+};
+
+inline int64_t monotonicNs(){
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+//SCHED_FIFO and the affinity for thread; name is for the warnings
+inline void configureThread(pthread_t thread, const Config& config, const char* name){
+    if (config.priority > 0) {
+        sched_param param;
+        param.sched_priority = config.priority;
+        int err = pthread_setschedparam(thread, SCHED_FIFO, &param);
+        if (err != 0) {
+            ROS_WARN("Could not give the %s SCHED_FIFO priority %d (%s); check the rtprio limit", name, config.priority, strerror(err));
+        }
+    }
+    if (!config.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : config.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+        if (err != 0) {
+            ROS_WARN("Could not pin the %s to its cpu_affinity (%s)", name, strerror(err));
+        }
+    }
+}
+
+//Touches the stack a control-path thread will use, so its first deep call does not fault;
+//call at the top of the thread with lock_memory set
+inline void prefaultStack(size_t bytes = 256 * 1024){
+    volatile unsigned char* stack = static_cast<volatile unsigned char*>(alloca(bytes));
+    for (size_t i = 0; i < bytes; i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+//mlockall() and the preallocated heap; once per process, before its threads start
+inline void lockMemory(const Config& config){
+    if (!config.lockMemory) {
+        return;
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        ROS_WARN("mlockall failed (%s); check the memlock limit", strerror(errno));
+        return;
+    }
+    if (config.preallocMb > 0) {
+        //freed memory stays in the heap instead of going back to the kernel, and no
+        //allocation gets its own mmap, so the pool below is reused rather than refaulted
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+        size_t bytes = (size_t)config.preallocMb << 20;
+        char* pool = static_cast<char*>(malloc(bytes));
+        if (pool) {
+            for (size_t i = 0; i < bytes; i += 4096) {
+                pool[i] = 0;
+            }
+            free(pool);
+        }
+    }
+}
+
+//Page faults of the process so far
+inline void faults(long& minor, long& major){
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    minor = usage.ru_minflt;
+    major = usage.ru_majflt;
+}
+
+//Wakeup latency of a thread with config's priority and affinity: it sleeps to absolute 1 ms
+//deadlines for probe_latency seconds, and the overshoot of each wakeup is what a control
+//thread waiting on a sample would see on top of the sample's own latency
+inline void probeLatency(const Config& config, const char* node){
+    long minor0, major0, minor1, major1;
+    faults(minor0, major0);
+    if (config.probeSeconds > 0.0) {
+        const int64_t periodNs = 1000000;
+        const int cycles = std::max(1, (int)(config.probeSeconds * 1e9 / periodNs));
+        int64_t maxNs = 0, sumNs = 0;
+        std::thread probe([&](){
+            configureThread(pthread_self(), config, "latency probe");
+            int64_t next = monotonicNs();
+            for (int i = 0; i < cycles; ++i) {
+                next += periodNs;
+                timespec deadline = {(time_t)(next / 1000000000), (long)(next % 1000000000)};
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+                int64_t late = monotonicNs() - next;
+                sumNs += late;
+                maxNs = std::max(maxNs, late);
+            }
+        });
+        probe.join();
+        ROS_INFO("%s: wakeup latency over %d ms at priority %d: mean %.1f us, max %.1f us",
+                 node, cycles, config.priority, sumNs * 1e-3 / cycles, maxNs * 1e-3);
+    }
+    faults(minor1, major1);
+    ROS_INFO("%s: page faults since start %ld minor, %ld major (%ld during the probe)%s", node,
+             minor1, major1, (minor1 - minor0) + (major1 - major0), config.lockMemory ? ", memory locked" : "");
+}
+
+} // namespace realtime
+
+#endif //RASPI_PKG_REALTIME_H
@@ -0,0 +1,203 @@
+#ifndef RASPI_PKG_ROSSERIAL_PROTOCOL_H
+#define RASPI_PKG_ROSSERIAL_PROTOCOL_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//Framing of the rosserial wire protocol (version 2, as in teensy/lib/ros_lib/ros/node_handle.h):
+//  0xff 0xfe | len u16 | 255 - (len bytes % 256) | topic u16 | payload[len] | 255 - (topic + payload % 256)
+//Topic ids below 100 are protocol messages, device publishers and subscribers start at 100.
+
+namespace rosserial_protocol {
+
+enum TopicId : uint16_t {
+    ID_PUBLISHER = 0,
+    ID_SUBSCRIBER = 1,
+    ID_SERVICE_SERVER = 2,
+    ID_SERVICE_CLIENT = 4,
+    ID_PARAMETER_REQUEST = 6,
+    ID_LOG = 7,
+    ID_TIME = 10,
+    ID_TX_STOP = 11,
+    FIRST_USER_TOPIC = 100,
+};
+
+const uint8_t SYNC_BYTE = 0xff;
+const uint8_t PROTOCOL_VER2 = 0xfe;
+
+inline void encodeFrame(uint16_t topic, const uint8_t* data, size_t length, std::vector<uint8_t>& out){
+    out.resize(length + 8);
+    out[0] = SYNC_BYTE;
+    out[1] = PROTOCOL_VER2;
+    out[2] = length & 0xff;
+    out[3] = (length >> 8) & 0xff;
+    out[4] = 255 - ((out[2] + out[3]) % 256);
+    out[5] = topic & 0xff;
+    out[6] = topic >> 8;
+    if (length > 0) {
+        memcpy(&out[7], data, length);
+    }
+    unsigned int checksum = out[5] + out[6];
+    for (size_t i = 0; i < length; ++i) {
+        checksum += data[i];
+    }
+    out[7 + length] = 255 - (checksum % 256);
+}
+
+//Byte-at-a-time frame parser; feed() returns true when a frame with a valid checksum is complete
+class FrameParser{
+
+    public:
+        explicit FrameParser(size_t maxLength = 4096) : maxLength(maxLength) {}
+
+        bool feed(uint8_t byte){
+            switch (state) {
+                case FIRST_FF:
+                    if (byte == SYNC_BYTE) state = PROTOCOL;
+                    return false;
+                case PROTOCOL:
+                    state = (byte == PROTOCOL_VER2) ? SIZE_L : FIRST_FF;
+                    return false;
+                case SIZE_L:
+                    length = byte;
+                    state = SIZE_H;
+                    return false;
+                case SIZE_H:
+                    length |= byte << 8;
+                    state = SIZE_CHECKSUM;
+                    return false;
+                case SIZE_CHECKSUM:
+                    if (((length & 0xff) + (length >> 8) + byte) % 256 != 255 || length > maxLength) {
+                        ++errors;
+                        state = FIRST_FF;
+                        return false;
+                    }
+                    state = TOPIC_L;
+                    return false;
+                case TOPIC_L:
+                    topicId = byte;
+                    checksum = byte;
+                    state = TOPIC_H;
+                    return false;
+                case TOPIC_H:
+                    topicId |= byte << 8;
+                    checksum += byte;
+                    payload.clear();
+                    state = length ? MESSAGE : MSG_CHECKSUM;
+                    return false;
+                case MESSAGE:
+                    payload.push_back(byte);
+                    checksum += byte;
+                    if (payload.size() == length) state = MSG_CHECKSUM;
+                    return false;
+                case MSG_CHECKSUM:
+                    state = FIRST_FF;
+                    if ((checksum + byte) % 256 != 255) {
+                        ++errors;
+                        return false;
+                    }
+                    return true;
+            }
+            return false;
+        }
+
+        //Drop a partial frame, e.g. after the port was reopened
+        void reset(){
+            state = FIRST_FF;
+            payload.clear();
+        }
+
+        uint16_t topic() const { return topicId; }
+        const std::vector<uint8_t>& data() const { return payload; }
+        unsigned long checksumErrors() const { return errors; }
+
+    private:
+        enum State { FIRST_FF, PROTOCOL, SIZE_L, SIZE_H, SIZE_CHECKSUM, TOPIC_L, TOPIC_H, MESSAGE, MSG_CHECKSUM };
+        State state = FIRST_FF;
+        size_t maxLength;
+        uint16_t length = 0;
+        uint16_t topicId = 0;
+        unsigned int checksum = 0;
+        std::vector<uint8_t> payload;
+        unsigned long errors = 0;
+};
+
+//Little-endian reader for the few protocol messages the bridge decodes itself
+class PayloadReader{
+
+    public:
+        PayloadReader(const std::vector<uint8_t>& data) : data(data) {}
+
+        bool u8(uint8_t& v){ return raw(&v, 1); }
+        bool u16(uint16_t& v){ return raw(&v, 2); }
+        bool u32(uint32_t& v){ return raw(&v, 4); }
+        bool string(std::string& s){
+            uint32_t length;
+            if (!u32(length) || offset + length > data.size()) return false;
+            s.assign(reinterpret_cast<const char*>(&data[offset]), length);
+            offset += length;
+            return true;
+        }
+
+    private:
+        bool raw(void* v, size_t n){
+            if (offset + n > data.size()) return false;
+            memcpy(v, &data[offset], n); // both ends are little-endian
+            offset += n;
+            return true;
+        }
+
+        const std::vector<uint8_t>& data;
+        size_t offset = 0;
+};
+
+//Its counterpart, for the device side of a test harness (bridge_benchmark)
+class PayloadWriter{
+
+    public:
+        explicit PayloadWriter(std::vector<uint8_t>& data) : data(data) { data.clear(); }
+
+        void u16(uint16_t v){ raw(&v, 2); }
+        void u32(uint32_t v){ raw(&v, 4); }
+        void string(const std::string& s){
+            u32(s.size());
+            raw(s.data(), s.size());
+        }
+
+    private:
+        void raw(const void* v, size_t n){
+            const uint8_t* b = static_cast<const uint8_t*>(v);
+            data.insert(data.end(), b, b + n);
+        }
+
+        std::vector<uint8_t>& data;
+};
+
+//rosserial_msgs/TopicInfo
+struct TopicInfo{
+    uint16_t topicId;
+    std::string topicName;
+    std::string messageType;
+    std::string md5sum;
+    uint32_t bufferSize;
+
+    bool parse(const std::vector<uint8_t>& data){
+        PayloadReader r(data);
+        return r.u16(topicId) && r.string(topicName) && r.string(messageType) && r.string(md5sum) && r.u32(bufferSize);
+    }
+
+    void serialize(std::vector<uint8_t>& data) const{
+        PayloadWriter w(data);
+        w.u16(topicId);
+        w.string(topicName);
+        w.string(messageType);
+        w.string(md5sum);
+        w.u32(bufferSize);
+    }
+};
+
+} // namespace rosserial_protocol
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef RASPI_PKG_RUN_RECORDER_H
+#define RASPI_PKG_RUN_RECORDER_H
+
+#include "ros/ros.h"
+#include <raspi_pkg/SensorState.h>
+#include <sensor_msgs/JointState.h>
+#include <std_msgs/String.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "FlightLogFormat.h"
+#include "odriveErrors.h"
+#include <RobotModel.h>
+
+//RunRecorder streams /sensors with its /torso_command and /odrive_errors to disk as a flight
+//log (teensy/lib/FlightRecorder/FlightLogFormat.h), so flightlog_to_bson turns it into
+//hardware_data BSON and the host replay and evaluate tools read it as it is. Unlike SensorLogger
+//nothing grows with the run: records go into a ring of preallocated blocks and a writer thread
+//appends each full block with one large sequential write (O_DIRECT unless ~direct is false), so
+//the callbacks never touch the disk and memory stays at ~buffer_blocks blocks however long the
+//run. If the card falls a whole ring behind, records are dropped and counted, not queued.
+//
+//Each record is one /sensors sample: stamp_us its header stamp in us (Pi time), the angles and
+//rates, and the /torso_command that echoed its seq in frame_id, with latency_us from the sample's
+//stamp to that command's arrival. A sample no command answered before the next one keeps the
+//previous torque and a latency of 0. errors are the /odrive_errors registers that are non-zero
+//and status the STATUS_* bits of the newest packed sample, when the bridge publishes one. gyro
+//and accel are not on the Pi and are NaN, so the host tools skip the attitude filter.
+//
+//Like the firmware's recorder, the log carries an event index (FlightEventRecords ahead of the
+//sample they happened at): a new stance spoke (value 0, the Pi has no impact detector), E-stop
+//edges of the packed status, changes of the /odrive_errors bits, and each controller the
+//latched ~controller_topic (default nn_controller/active) reports, by its index in
+//pbcController.h's list.
+//
+//Parameters (private): path (default run.BIN in the working directory, ~/.ros for roslaunch),
+//buffer_blocks (default 64 of FlightLogHeader::block_bytes), direct (default true),
+//period_us (the header's nominal tick, default 10000), controller_topic
+
+class RunRecorder{
+
+    public:
+        RunRecorder(ros::NodeHandle& nh, ros::NodeHandle& pnh){
+            pnh.param<std::string>("path", path, "run.BIN");
+            numBlocks = std::max(2, pnh.param("buffer_blocks", 64));
+            bool direct = pnh.param("direct", true);
+            if (!open(direct))
+                return;
+            //aligned for O_DIRECT, and touched now so no page fault lands in a callback
+            void* memory = nullptr;
+            if (posix_memalign(&memory, 4096, numBlocks*blockBytes) != 0) {
+                ROS_ERROR("Cannot allocate the %d record blocks", numBlocks);
+                ::close(fd);
+                fd = -1;
+                return;
+            }
+            ring = static_cast<uint8_t*>(memory);
+            memset(ring, 0, numBlocks*blockBytes);
+
+            FlightLogHeader header = {FlightLogHeader::MAGIC, FlightLogHeader::VERSION, sizeof(FlightRecord),
+                                      (uint32_t)pnh.param("period_us", 10000), (uint32_t)(ros::Time::now().toNSec()/1000000)};
+            memcpy(ring, &header, sizeof(header));
+            filled = 1;
+            writer = std::thread(&RunRecorder::writeLoop, this);
+
+            sensorSub = nh.subscribe("sensors", 10, &RunRecorder::sensorCb, this, ros::TransportHints().tcpNoDelay());
+            torqueSub = nh.subscribe("torso_command", 10, &RunRecorder::torqueCb, this, ros::TransportHints().tcpNoDelay());
+            errorSub = nh.subscribe("odrive_errors", 10, &RunRecorder::errorCb, this);
+            packedSub = nh.subscribe("sensors_packed", 10, &RunRecorder::packedCb, this);
+            activeSub = nh.subscribe(pnh.param<std::string>("controller_topic", "nn_controller/active"), 1,
+                                     &RunRecorder::activeCb, this);
+            ROS_INFO("Recording to %s%s", path.c_str(), directIo ? " (O_DIRECT)" : "");
+        }
+
+        ~RunRecorder(){
+            if (!ring)
+                return;
+            sensorSub.shutdown();
+            torqueSub.shutdown();
+            errorSub.shutdown();
+            packedSub.shutdown();
+            activeSub.shutdown();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (havePending) appendSample(pending);
+                //the last block goes out padded with zero records, which the readers skip
+                if (used > 0) seal();
+                stopping = true;
+            }
+            ready.notify_one();
+            writer.join();
+            fdatasync(fd);
+            ::close(fd);
+            free(ring);
+            ROS_INFO("Recorded %llu samples and %llu events to %s, %llu records dropped", (unsigned long long)samples,
+                     (unsigned long long)events, path.c_str(), (unsigned long long)dropped);
+        }
+
+        void sensorCb(const sensor_msgs::JointState::ConstPtr& msg){
+            if (msg->position.size() < 4 || msg->velocity.size() < 3)
+                return;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (havePending) appendSample(pending);
+            FlightRecord& r = pending;
+            r.stamp_us = (uint32_t)(msg->header.stamp.toNSec()/1000);
+            r.status = status;
+            r.errors = errors;
+            r.latency_us = 0;
+            for (int i = 0; i < 3; ++i) r.gyro[i] = r.accel[i] = NAN;
+            //JointState order: [roll, spoke 0, spoke 1, yaw], [roll rate, spoke 0 rate, spoke 1 rate]
+            r.spoke[0] = msg->position[1];
+            r.spoke[1] = msg->position[2];
+            r.spoke[2] = msg->velocity[1];
+            r.spoke[3] = msg->velocity[2];
+            r.torso[0] = msg->position[0];
+            r.torso[1] = msg->velocity[0];
+            r.torso[2] = msg->position[3];
+            r.torque = torque;
+            //a new stance spoke, except across the whole-spoke moves of the E-stop release and calibration
+            float stanceSpoke = RimlessWheelModel::spokeCount(r.spoke[0]);
+            if (status & (raspi_pkg::SensorState::STATUS_ESTOP | raspi_pkg::SensorState::STATUS_CALIBRATING |
+                          raspi_pkg::SensorState::STATUS_ODRIVE_RESET)) settling = 2;
+            else if (settling > 0) --settling;
+            else if (stanceSpoke != lastStanceSpoke) event(FlightEvent::IMPACT, 0);
+            lastStanceSpoke = stanceSpoke;
+            pendingSeq = msg->header.frame_id.empty() ? msg->header.seq : strtoul(msg->header.frame_id.c_str(), nullptr, 10);
+            pendingStamp = msg->header.stamp;
+            havePending = true;
+        }
+
+        void torqueCb(const sensor_msgs::JointState::ConstPtr& msg){
+            if (msg->effort.empty())
+                return;
+            std::lock_guard<std::mutex> lock(mutex);
+            torque = msg->effort[0];
+            if (havePending && !msg->header.frame_id.empty()
+                && strtoul(msg->header.frame_id.c_str(), nullptr, 10) == pendingSeq) {
+                pending.torque = torque;
+                double latency = (ros::Time::now() - pendingStamp).toSec()*1e6;
+                pending.latency_us = latency <= 0.0 ? 0 : latency >= 65535.0 ? 65535 : (uint16_t)latency;
+                appendSample(pending);
+                havePending = false;
+            }
+        }
+
+        void errorCb(const raspi_pkg::ODriveErrors::ConstPtr& msg){
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!errorCache.update(*msg, ros::WallTime::now().toNSec()))
+                return;
+            //the first eight registers, as FlightRecord::errors holds them
+            uint8_t bits = errorCache.nonzero() & 0xFF;
+            if (bits != errors) event(FlightEvent::ODRIVE_ERRORS, bits);
+            errors = bits;
+        }
+
+        void packedCb(const raspi_pkg::SensorState::ConstPtr& msg){
+            std::lock_guard<std::mutex> lock(mutex);
+            if ((msg->status ^ status) & raspi_pkg::SensorState::STATUS_ESTOP)
+                event(msg->status & raspi_pkg::SensorState::STATUS_ESTOP ? FlightEvent::ESTOP_ON : FlightEvent::ESTOP_OFF, 0);
+            status = msg->status;
+        }
+
+        void activeCb(const std_msgs::String::ConstPtr& msg){
+            //pbcController.h's order, which the host tools' controllers.h keeps too
+            static const char* const names[] = {"deterministic", "bayesian", "map", "deter2_hardware_even_1mpers",
+                                                "deterministic_hardware", "hardware_even_688771",
+                                                "hardware_even_deter_1mpers"};
+            uint16_t index = 0xFFFF;
+            for (uint16_t i = 0; i < sizeof(names)/sizeof(names[0]); ++i)
+                if (msg->data == names[i]) index = i;
+            std::lock_guard<std::mutex> lock(mutex);
+            event(FlightEvent::CONTROLLER, index);
+        }
+
+    private:
+        static constexpr size_t blockBytes = FlightLogHeader::block_bytes;
+        static constexpr size_t recordsPerBlock = blockBytes/sizeof(FlightRecord);
+
+        bool open(bool direct){
+            int flags = O_WRONLY | O_CREAT | O_TRUNC;
+            fd = direct ? ::open(path.c_str(), flags | O_DIRECT, 0644) : -1;
+            directIo = fd >= 0;
+            //tmpfs and some FUSE mounts refuse O_DIRECT; whole blocks are still written
+            if (fd < 0)
+                fd = ::open(path.c_str(), flags, 0644);
+            if (fd < 0) {
+                ROS_ERROR("Cannot write %s: %s", path.c_str(), strerror(errno));
+                return false;
+            }
+            return true;
+        }
+
+        //with the mutex held: queue an event for the next sample appended
+        void event(uint8_t kind, uint16_t value){
+            if (pendingEvents.count == FlightEventRecord::capacity)
+                return;
+            FlightEvent& e = pendingEvents.events[pendingEvents.count++];
+            e.kind = kind;
+            e.value = value;
+        }
+
+        //with the mutex held: the sample, after the record of its events
+        void appendSample(const FlightRecord& r){
+            if (pendingEvents.count > 0) {
+                pendingEvents.stamp_us = r.stamp_us;
+                pendingEvents.marker = FlightEventRecord::MARKER;
+                for (int i = 0; i < pendingEvents.count; ++i) pendingEvents.events[i].record = samples;
+                FlightRecord slot;
+                memcpy(&slot, &pendingEvents, sizeof(slot));
+                if (append(slot)) events += pendingEvents.count;
+                pendingEvents = FlightEventRecord();
+            }
+            if (append(r)) ++samples;
+        }
+
+        //with the mutex held
+        bool append(const FlightRecord& r){
+            //the block the writer has not taken yet is full: the card is a whole ring behind
+            if (filled - written >= (uint64_t)numBlocks) {
+                ++dropped;
+                return false;
+            }
+            //block 0 is the header's, so records start in block 1
+            uint8_t* block = ring + (filled % numBlocks)*blockBytes;
+            if (used == 0)
+                memset(block, 0, blockBytes);
+            memcpy(block + used*sizeof(FlightRecord), &r, sizeof(r));
+            if (++used == recordsPerBlock)
+                seal();
+            return true;
+        }
+
+        //with the mutex held: hand the current block to the writer
+        void seal(){
+            ++filled;
+            used = 0;
+            ready.notify_one();
+        }
+
+        void writeLoop(){
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                ready.wait(lock, [this]{ return stopping || written < filled; });
+                if (written == filled)
+                    return;
+                const uint8_t* block = ring + (written % numBlocks)*blockBytes;
+                lock.unlock();
+                bool good = writeBlock(block);
+                lock.lock();
+                if (!good && !failed) {
+                    ROS_ERROR("Writing %s failed: %s", path.c_str(), strerror(errno));
+                    failed = true;
+                }
+                ++written;
+            }
+        }
+
+        bool writeBlock(const uint8_t* block){
+            for (size_t done = 0; done < blockBytes;) {
+                ssize_t n = ::write(fd, block + done, blockBytes - done);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    return false;
+                done += n;
+            }
+            return true;
+        }
+
+        ros::Subscriber sensorSub;
+        ros::Subscriber torqueSub;
+        ros::Subscriber errorSub;
+        ros::Subscriber packedSub;
+        ros::Subscriber activeSub;
+        std::string path;
+        int fd = -1;
+        bool directIo = false;
+        int numBlocks = 64;
+        uint8_t* ring = nullptr;
+
+        //blocks are numbered from 0 (the header); filled blocks are ready, written ones on disk
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::thread writer;
+        uint64_t filled = 0, written = 0;
+        size_t used = 0;
+        bool stopping = false, failed = false;
+        uint64_t samples = 0, events = 0, dropped = 0;
+
+        FlightRecord pending = {};
+        bool havePending = false;
+        uint32_t pendingSeq = 0;
+        ros::Time pendingStamp;
+        float torque = 0.0f;
+        uint8_t errors = 0, status = 0;
+        ODriveErrorCache errorCache;
+        FlightEventRecord pendingEvents = {};
+        float lastStanceSpoke = 0.0f;
+        int settling = 2;
+};
+
+#endif //RASPI_PKG_RUN_RECORDER_H
@@ -0,0 +1,13 @@
+#include "ros/ros.h"
+#include "runRecorder.h"
+
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "run_recorder");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+    RunRecorder recorder(nh, pnh);
+    ros::spin();
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef RASPI_PKG_SENSOR_DELTA_H
+#define RASPI_PKG_SENSOR_DELTA_H
+
+#include <raspi_pkg/SensorBatch.h>
+#include <raspi_pkg/SensorDelta.h>
+#include <raspi_pkg/SensorState.h>
+#include <cstdint>
+#include <vector>
+#include "messagePool.h"
+
+//SensorDeltaDecoder turns raspi_pkg/SensorDelta frames back into SensorState samples, the
+//mirror of the firmware's lib/DeltaCodec: per channel a zig-zag varint added to the previous
+//sample's value, which a keyframe resets to zero.
+//
+//A gap in the frame counter means a frame was lost and the running values are wrong, so
+//frames are dropped, counted in skipped(), until the next keyframe. So is a frame that does
+//not decode to exactly count samples. The samples come from a MessagePool, so once the caller
+//has let go of the previous frame's they are reused.
+
+class SensorDeltaDecoder{
+
+    public:
+        typedef raspi_pkg::SensorDelta D;
+
+        //Appends the frame's samples to out; false if it was skipped
+        bool decode(const D& frame, std::vector<raspi_pkg::SensorStatePtr>& out){
+            if (synced && frame.frame != (uint16_t)(lastFrame + 1)) {
+                lost += (uint16_t)(frame.frame - lastFrame - 1);
+                synced = false;
+            }
+            lastFrame = frame.frame;
+            if (frame.flags & D::FLAG_KEYFRAME) {
+                for (int32_t& v : values) v = 0;
+                synced = true;
+            }
+            if (!synced) {
+                ++skippedFrames;
+                return false;
+            }
+
+            const uint8_t* p = frame.data.data();
+            const uint8_t* end = p + frame.data.size();
+            const size_t first = out.size();
+            const uint32_t stride = frame.stride ? frame.stride : 1;
+            for (uint32_t i = 0; i < frame.count; ++i) {
+                for (int32_t& v : values) {
+                    uint32_t zigzag;
+                    if (!varint(p, end, zigzag)) {
+                        out.resize(first);
+                        synced = false;
+                        ++skippedFrames;
+                        return false;
+                    }
+                    v = (int32_t)((uint32_t)v + (uint32_t)((int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1)));
+                }
+                raspi_pkg::SensorStatePtr s = pool.next();
+                s->seq = frame.seq + i*stride;
+                s->stamp_us = (uint32_t)values[D::CH_STAMP_US];
+                s->torso_roll = values[D::CH_TORSO_ROLL]*D::ANGLE_LSB;
+                s->torso_omega = values[D::CH_TORSO_OMEGA]*D::RATE_LSB;
+                s->yaw = values[D::CH_YAW]*D::ANGLE_LSB;
+                s->spoke_angle[0] = values[D::CH_SPOKE_ANGLE_0]*D::ANGLE_LSB;
+                s->spoke_angle[1] = values[D::CH_SPOKE_ANGLE_1]*D::ANGLE_LSB;
+                s->spoke_omega[0] = values[D::CH_SPOKE_OMEGA_0]*D::RATE_LSB;
+                s->spoke_omega[1] = values[D::CH_SPOKE_OMEGA_1]*D::RATE_LSB;
+                s->status = (uint8_t)values[D::CH_STATUS];
+                s->motor_current[0] = values[D::CH_MOTOR_CURRENT_0]*D::CURRENT_LSB;
+                s->motor_current[1] = values[D::CH_MOTOR_CURRENT_1]*D::CURRENT_LSB;
+                s->vbus_voltage = values[D::CH_VBUS_VOLTAGE]*D::VOLTAGE_LSB;
+                out.push_back(s);
+            }
+            if (p != end) {
+                out.resize(first);
+                synced = false;
+                ++skippedFrames;
+                return false;
+            }
+            return true;
+        }
+
+        //frames missing from the counter, and frames dropped while waiting for a keyframe
+        uint32_t lostFrames() const{ return lost; }
+        uint32_t skipped() const{ return skippedFrames; }
+
+    private:
+        static bool varint(const uint8_t*& p, const uint8_t* end, uint32_t& v){
+            v = 0;
+            for (int shift = 0; shift < 35 && p < end; shift += 7) {
+                uint8_t b = *p++;
+                v |= (uint32_t)(b & 0x7f) << shift;
+                if (!(b & 0x80)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        int32_t values[D::NUM_CHANNELS] = {};
+        bool synced = false;
+        uint16_t lastFrame = 0;
+        uint32_t lost = 0;
+        uint32_t skippedFrames = 0;
+        //a frame's samples, plus as many again queued on /sensors_packed
+        MessagePool<raspi_pkg::SensorState> pool{nullptr, 2*raspi_pkg::SensorBatch::MAX_SAMPLES};
+};
+
+#endif
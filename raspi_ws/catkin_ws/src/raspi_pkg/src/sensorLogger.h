@@ -0,0 +1,83 @@
+#ifndef RASPI_PKG_SENSOR_LOGGER_H
+#define RASPI_PKG_SENSOR_LOGGER_H
+
+#include "ros/ros.h"
+#include <sensor_msgs/JointState.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//SensorLogger records every /sensors sample with the latest /torso_command, as the Julia
+//controllers do with push!(sensorData, ...), and writes them as CSV when it is destroyed.
+//Rows go into memory reserved up front, so logging costs no I/O or allocation per sample.
+//
+//Parameters (private): path (default sensor_log.csv in the working directory, ~/.ros for
+//roslaunch), reserve (rows to preallocate, default one hour at 100 Hz)
+
+class SensorLogger{
+
+    public:
+        SensorLogger(ros::NodeHandle& nh, ros::NodeHandle& pnh){
+            pnh.param<std::string>("path", path, "sensor_log.csv");
+            rows.reserve(pnh.param("reserve", 360000));
+            sensorSub = nh.subscribe("sensors", 10, &SensorLogger::sensorCb, this, ros::TransportHints().tcpNoDelay());
+            torqueSub = nh.subscribe("torso_command", 10, &SensorLogger::torqueCb, this, ros::TransportHints().tcpNoDelay());
+        }
+
+        ~SensorLogger(){
+            write();
+        }
+
+        void sensorCb(const sensor_msgs::JointState::ConstPtr& msg){
+            if (msg->position.size() < 4 || msg->velocity.size() < 3)
+                return;
+            Row row;
+            row.stamp = msg->header.stamp.toSec();
+            row.seq = msg->header.seq;
+            for (int i = 0; i < 4; ++i) row.position[i] = msg->position[i];
+            for (int i = 0; i < 3; ++i) row.velocity[i] = msg->velocity[i];
+            row.torque = torque;
+            rows.push_back(row);
+        }
+
+        void torqueCb(const sensor_msgs::JointState::ConstPtr& msg){
+            if (!msg->effort.empty())
+                torque = msg->effort[0];
+        }
+
+        void write(){
+            if (rows.empty())
+                return;
+            FILE* file = fopen(path.c_str(), "w");
+            if (!file) {
+                ROS_ERROR("Cannot write %s", path.c_str());
+                return;
+            }
+            fprintf(file, "stamp,seq,torso_roll,spoke0,spoke1,yaw,torso_omega,spoke0_omega,spoke1_omega,torque\n");
+            for (const Row& r : rows) {
+                fprintf(file, "%.6f,%u,%g,%g,%g,%g,%g,%g,%g,%g\n", r.stamp, r.seq,
+                        r.position[0], r.position[1], r.position[2], r.position[3],
+                        r.velocity[0], r.velocity[1], r.velocity[2], r.torque);
+            }
+            fclose(file);
+            ROS_INFO("Wrote %zu samples to %s", rows.size(), path.c_str());
+            rows.clear();
+        }
+
+    private:
+        struct Row{
+            double stamp;
+            uint32_t seq;
+            float position[4];
+            float velocity[3];
+            float torque;
+        };
+
+        ros::Subscriber sensorSub;
+        ros::Subscriber torqueSub;
+        std::string path;
+        std::vector<Row> rows;
+        float torque = 0.0f;
+};
+
+#endif //RASPI_PKG_SENSOR_LOGGER_H
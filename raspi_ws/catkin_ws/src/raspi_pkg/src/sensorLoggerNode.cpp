@@ -0,0 +1,13 @@
+#include "ros/ros.h"
+#include "sensorLogger.h"
+
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "sensor_logger");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+    SensorLogger logger(nh, pnh);
+    ros::spin();
+
+    return 0;
+}
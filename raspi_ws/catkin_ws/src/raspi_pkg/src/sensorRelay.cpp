@@ -0,0 +1,170 @@
+#include "ros/ros.h"
+#include <sensor_msgs/JointState.h>
+#include <raspi_pkg/SensorState.h>
+#include <raspi_pkg/SensorBatch.h>
+#include <raspi_pkg/ClockSync.h>
+#include "clockSync.h"
+#include "sensorDelta.h"
+#include "messagePool.h"
+#include <algorithm>
+
+//SensorRelay expands the packed raspi_pkg/SensorState the Teensy publishes on /sensors_packed
+//back into the sensor_msgs/JointState layout on /sensors, so the controllers need no change.
+//position = [torso roll, spoke 0, spoke 1, yaw], velocity = [torso omega, spoke 0, spoke 1]
+//
+//header.stamp is the sample's stamp_us in Pi time, from TeensyClock fed by a /clock_sync_ping
+//exchange at ~ping_rate Hz; ros::Time::now() on arrival until the clock has synced. Through
+//rosserial_server the pings also cross its queues both ways, so the offset is only as good as
+//that path is symmetric; teensy_bridge stamps them on the wire instead.
+//
+//Firmware built with SENSOR_BATCH publishes raspi_pkg/SensorBatch on /sensors_batch instead: the
+//relay republishes every sample on /sensors_packed, for the recorder, and only the newest on
+///sensors; likewise for raspi_pkg/SensorDelta on /sensors_delta (SENSOR_DELTA). From the first
+//batch or delta frame on, what arrives on /sensors_packed is its own and is ignored. The
+//republished samples come from a MessagePool, /sensors from one preallocated JointState.
+
+class SensorRelay{
+
+    public:
+        SensorRelay(ros::NodeHandle& nh, ros::NodeHandle& pnh){
+            pub = nh.advertise<sensor_msgs::JointState>("sensors", 1);
+            sub = nh.subscribe("sensors_packed", 1, &SensorRelay::relay, this, ros::TransportHints().tcpNoDelay());
+            batchSub = nh.subscribe("sensors_batch", 1, &SensorRelay::relayBatch, this, ros::TransportHints().tcpNoDelay());
+            deltaSub = nh.subscribe("sensors_delta", 10, &SensorRelay::relayDelta, this, ros::TransportHints().tcpNoDelay());
+            packedPub = nh.advertise<raspi_pkg::SensorState>("sensors_packed", raspi_pkg::SensorBatch::MAX_SAMPLES);
+            pingPub = nh.advertise<raspi_pkg::ClockSync>("clock_sync_ping", 1);
+            pongSub = nh.subscribe("clock_sync_pong", 10, &SensorRelay::pong, this, ros::TransportHints().tcpNoDelay());
+            pingTimer = nh.createWallTimer(ros::WallDuration(1.0/pnh.param("ping_rate", 10.0)), &SensorRelay::ping, this);
+            jointState.position.resize(4);
+            jointState.velocity.resize(3);
+        }
+
+        void relay(const raspi_pkg::SensorState::ConstPtr& msg){
+            if (!batched) {
+                track(*msg, 1);
+                expand(*msg);
+            }
+        }
+
+        void relayBatch(const raspi_pkg::SensorBatch::ConstPtr& batch){
+            batched = true;
+            const uint32_t count = std::min<uint32_t>(batch->count, batch->samples.size());
+            const uint32_t stride = std::max<uint32_t>(batch->stride, 1);
+            samples.clear();
+            for (uint32_t i = 0; i < count; ++i) {
+                const raspi_pkg::SensorSample& sample = batch->samples[i];
+                raspi_pkg::SensorStatePtr msg = samplePool.next();
+                msg->seq = batch->seq + i*stride;
+                msg->stamp_us = batch->stamp_us + sample.offset_us;
+                msg->torso_roll = sample.torso_roll;
+                msg->torso_omega = sample.torso_omega;
+                msg->yaw = sample.yaw;
+                msg->spoke_angle = sample.spoke_angle;
+                msg->spoke_omega = sample.spoke_omega;
+                msg->status = sample.status;
+                msg->motor_current = sample.motor_current;
+                msg->vbus_voltage = sample.vbus_voltage;
+                samples.push_back(msg);
+            }
+            relaySamples(stride);
+        }
+
+        //a frame lost in transport drops the samples up to the next keyframe, which are
+        //counted as dropped when the seq resumes
+        void relayDelta(const raspi_pkg::SensorDelta::ConstPtr& frame){
+            batched = true;
+            samples.clear();
+            if (deltaDecoder.decode(*frame, samples)) {
+                relaySamples(std::max<uint32_t>(frame->stride, 1));
+            }
+        }
+
+        //every sample onto /sensors_packed, the newest onto /sensors
+        void relaySamples(uint32_t stride){
+            for (size_t i = 0; i < samples.size(); ++i) {
+                track(*samples[i], stride);
+                packedPub.publish(samples[i]);
+            }
+            if (!samples.empty()) {
+                expand(*samples.back());
+            }
+        }
+
+        void track(const raspi_pkg::SensorState& msg, uint32_t stride){
+            if (received && msg.seq != lastSeq + stride) {
+                dropped += (msg.seq - lastSeq)/stride - 1;
+                ROS_WARN_THROTTLE(1.0, "Dropped %u Teensy samples so far", dropped);
+            }
+            if (msg.status & ~lastStatus) {
+                ROS_WARN("Teensy status changed: 0x%02x", msg.status);
+            }
+            received = true;
+            lastSeq = msg.seq;
+            lastStatus = msg.status;
+        }
+
+        void expand(const raspi_pkg::SensorState& msg){
+            jointState.header.seq = msg.seq;
+            //rospy renumbers header.seq, so the controllers echo the seq from frame_id
+            jointState.header.frame_id = std::to_string(msg.seq);
+            if (clock.synced()) {
+                jointState.header.stamp.fromNSec(clock.toPiNs(msg.stamp_us));
+            } else {
+                jointState.header.stamp = ros::Time::now();
+            }
+            jointState.position[0] = msg.torso_roll;
+            jointState.position[1] = msg.spoke_angle[0];
+            jointState.position[2] = msg.spoke_angle[1];
+            jointState.position[3] = msg.yaw;
+            jointState.velocity[0] = msg.torso_omega;
+            jointState.velocity[1] = msg.spoke_omega[0];
+            jointState.velocity[2] = msg.spoke_omega[1];
+            pub.publish(jointState);
+        }
+
+        void ping(const ros::WallTimerEvent&){
+            raspi_pkg::ClockSync msg;
+            msg.id = ++pingId;
+            msg.pi_send = ros::Time::now();
+            pingPub.publish(msg);
+        }
+
+        void pong(const raspi_pkg::ClockSync::ConstPtr& msg){
+            int64_t received = ros::Time::now().toNSec();
+            clock.addExchange(msg->pi_send.toNSec(), msg->teensy_receive_us, msg->teensy_send_us, received);
+            ROS_INFO_THROTTLE(10.0, "Teensy clock: drift %.1f ppm, fastest round trip %.2f ms over %zu pings",
+                              clock.driftPpm(), clock.minRttNs()*1e-6, clock.exchangeCount());
+        }
+
+    private:
+        ros::Publisher pub;
+        ros::Subscriber sub;
+        ros::Subscriber batchSub;
+        ros::Subscriber deltaSub;
+        SensorDeltaDecoder deltaDecoder;
+        std::vector<raspi_pkg::SensorStatePtr> samples;
+        MessagePool<raspi_pkg::SensorState> samplePool{nullptr, 2*raspi_pkg::SensorBatch::MAX_SAMPLES};
+        ros::Publisher packedPub;
+        bool batched = false;
+        ros::Publisher pingPub;
+        ros::Subscriber pongSub;
+        ros::WallTimer pingTimer;
+        TeensyClock clock;
+        uint32_t pingId = 0;
+        sensor_msgs::JointState jointState;
+        bool received = false;
+        uint32_t lastSeq = 0;
+        uint8_t lastStatus = 0;
+        uint32_t dropped = 0;
+};
+
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "sensor_relay");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+    SensorRelay relay(nh, pnh);
+    ros::spin();
+
+    return 0;
+}
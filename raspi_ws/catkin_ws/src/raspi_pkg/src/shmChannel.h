@@ -0,0 +1,166 @@
+#ifndef RASPI_PKG_SHM_CHANNEL_H
+#define RASPI_PKG_SHM_CHANNEL_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+//ShmChannel is the control path between teensy_bridge and pbc_controller without ROS: a POSIX
+//shared-memory region (/dev/shm/<name>) holding the latest Teensy sample and the latest torque,
+//each in a seqlock'd slot.
+//
+//A slot has one writer, which never waits: the sequence goes odd, the words are stored, the
+//sequence goes even again. Readers copy the words and keep the copy only if the sequence was
+//the same even value before and after, so a reader can never stall the writer, and any number
+//of readers (the controller, the bridge's monitor thread) see whole values. Every write also
+//wakes the readers blocked in wait() through a futex on the sequence word, so a sample reaches
+//the controller with one context switch and no polling.
+//
+//Only the latest value is kept; a reader that falls behind skips to it, which is what a
+//controller wants. Both sides open the region with open(); whoever comes first creates it
+//zeroed, and a zero sequence reads as nothing written yet. The region is left in place on
+//exit so either side can restart.
+
+namespace shm_channel {
+
+//position = [torso roll, spoke 0, spoke 1, yaw], velocity = [torso omega, spoke 0, spoke 1],
+//as on /sensors
+struct Sample{
+    uint32_t seq;
+    uint32_t pad;
+    int64_t stampNs; //Pi time, from the bridge's clock sync
+    float position[4];
+    float velocity[3];
+    float pad2;
+};
+
+struct Command{
+    uint32_t seq;
+    uint32_t sampleSeq; //the Sample it answers, echoed for COMMAND_LATENCY; 0 for none
+    float torque;
+    uint32_t pad;
+};
+
+template<class T>
+class Slot{
+    static_assert(std::is_trivially_copyable<T>::value && sizeof(T) % 4 == 0, "a slot holds whole words");
+    static const size_t numWords = sizeof(T) / 4;
+
+    public:
+        void write(const T& value){
+            uint32_t words[numWords];
+            memcpy(words, &value, sizeof(T));
+            uint32_t s = sequence.load(std::memory_order_relaxed);
+            sequence.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < numWords; ++i) {
+                data[i].store(words[i], std::memory_order_relaxed);
+            }
+            sequence.store(s + 2, std::memory_order_release);
+            syscall(SYS_futex, &sequence, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+        }
+
+        //The latest value if one was written since last (a sequence from an earlier read)
+        bool tryRead(uint32_t& last, T& value) const{
+            for (;;) {
+                uint32_t s = sequence.load(std::memory_order_acquire);
+                if (s == last || s == 0) {
+                    return false;
+                }
+                if (s & 1) {
+                    continue; //the writer is mid-store, a few dozen ns
+                }
+                uint32_t words[numWords];
+                for (size_t i = 0; i < numWords; ++i) {
+                    words[i] = data[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == s) {
+                    memcpy(&value, words, sizeof(T));
+                    last = s;
+                    return true;
+                }
+            }
+        }
+
+        //tryRead(), blocking for up to timeoutNs for a new value
+        bool wait(uint32_t& last, T& value, int64_t timeoutNs) const{
+            int64_t deadline = monotonicNs() + timeoutNs;
+            for (;;) {
+                if (tryRead(last, value)) {
+                    return true;
+                }
+                int64_t remaining = deadline - monotonicNs();
+                if (remaining <= 0) {
+                    return false;
+                }
+                timespec timeout = {(time_t)(remaining / 1000000000), (long)(remaining % 1000000000)};
+                //returns at once if the sequence moved on since tryRead()
+                syscall(SYS_futex, &sequence, FUTEX_WAIT, last, &timeout, nullptr, 0);
+            }
+        }
+
+    private:
+        static int64_t monotonicNs(){
+            timespec t;
+            clock_gettime(CLOCK_MONOTONIC, &t);
+            return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+        }
+
+        mutable std::atomic<uint32_t> sequence;
+        std::atomic<uint32_t> data[numWords];
+};
+
+struct Region{
+    Slot<Sample> sample;
+    alignas(64) Slot<Command> command; //its own cache line, the two writers do not share one
+};
+
+//Maps /dev/shm/<name>, creating it if it does not exist; the mapping outlives the fd
+inline Region* open(const std::string& name, std::string& error){
+    std::string path = name.empty() || name[0] != '/' ? "/" + name : name;
+    int fd = shm_open(path.c_str(), O_RDWR | O_CREAT, 0660);
+    if (fd < 0) {
+        error = "shm_open " + path + ": " + strerror(errno);
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_size != 0 && st.st_size != (off_t)sizeof(Region))) {
+        error = path + " has the wrong size, remove it (a build with another layout left it)";
+        ::close(fd);
+        return nullptr;
+    }
+    if (st.st_size == 0 && ftruncate(fd, sizeof(Region)) != 0) {
+        error = "ftruncate " + path + ": " + strerror(errno);
+        ::close(fd);
+        return nullptr;
+    }
+    void* p = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        error = "mmap " + path + ": " + strerror(errno);
+        return nullptr;
+    }
+    //a fresh region is all zeros, which is a valid empty one
+    return static_cast<Region*>(p);
+}
+
+inline void close(Region* region){
+    if (region) {
+        munmap(region, sizeof(Region));
+    }
+}
+
+} // namespace shm_channel
+
+#endif //RASPI_PKG_SHM_CHANNEL_H
@@ -0,0 +1,638 @@
+#include "teensyBridge.h"
+#include <sensor_msgs/JointState.h>
+#include <sensor_msgs/Joy.h>
+#include <std_msgs/Int64MultiArray.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <raspi_pkg/SensorState.h>
+#include <raspi_pkg/SensorBatch.h>
+#include <raspi_pkg/SensorDelta.h>
+#include <raspi_pkg/ClockSync.h>
+#include <raspi_pkg/ODriveErrors.h>
+#include <raspi_pkg/Teleop.h>
+#include <raspi_pkg/Trajectory.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+using namespace rosserial_protocol;
+
+static speed_t toSpeed(int baud){
+    switch (baud) {
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return B1000000; // USB CDC ignores it anyway
+    }
+}
+
+static int64_t wallNowNs(){
+    return ros::WallTime::now().toNSec();
+}
+
+TeensyBridge::TeensyBridge(ros::NodeHandle& nh, ros::NodeHandle& pnh) : nh(nh){
+    pnh.param<std::string>("port", port, "/dev/ttyACM0");
+    pnh.param("baud", baud, 1000000);
+    rt = realtime::Config::fromParams(pnh, 80);
+    pnh.param<std::string>("device_prefix", devicePrefix, "");
+    pnh.param<std::string>("packed_topic", packedTopic, "/sensors_packed");
+    pnh.param<std::string>("batch_topic", batchTopic, "/sensors_batch");
+    pnh.param<std::string>("delta_topic", deltaTopic, "/sensors_delta");
+    pnh.param<std::string>("sensors_topic", sensorsTopic, "sensors");
+    pnh.param("ping_rate", pingRate, 10.0);
+    pnh.param<std::string>("shm", shmName, "");
+    pnh.param<std::string>("command_topic", commandTopic, "/torso_command");
+    label = nh.getNamespace() == "/" ? "Teensy" : "Teensy " + nh.getNamespace();
+}
+
+TeensyBridge::~TeensyBridge(){
+    stop();
+}
+
+bool TeensyBridge::start(){
+    if (!openPort()) {
+        return false;
+    }
+    if (!shmName.empty()) {
+        std::string error;
+        shm = shm_channel::open(shmName, error);
+        if (!shm) {
+            ROS_ERROR("%s, falling back to ROS topics", error.c_str());
+        } else {
+            monitorSensorsPub = nh.advertise<sensor_msgs::JointState>(sensorsTopic, 1);
+            monitorCommandPub = nh.advertise<sensor_msgs::JointState>(rosName(commandTopic), 1);
+            commandMsg.effort.resize(1);
+            ROS_INFO("Control path over shared memory %s; %s and %s are for monitoring", shmName.c_str(),
+                     monitorSensorsPub.getTopic().c_str(), monitorCommandPub.getTopic().c_str());
+        }
+    }
+    realtime::lockMemory(rt);
+    realtime::probeLatency(rt, label.c_str());
+    running = true;
+    reader = std::thread(&TeensyBridge::readLoop, this);
+    realtime::configureThread(reader.native_handle(), rt, "serial reader");
+    if (shm) {
+        commander = std::thread(&TeensyBridge::commandLoop, this);
+        realtime::configureThread(commander.native_handle(), rt, "command sender");
+        //monitoring stays at normal priority and off the pinned cores' run queue head
+        monitor = std::thread(&TeensyBridge::monitorLoop, this);
+    }
+
+    requestTopics();
+    watchdogTimer = nh.createWallTimer(ros::WallDuration(1.0), &TeensyBridge::watchdog, this);
+    pingTimer = nh.createWallTimer(ros::WallDuration(1.0/pingRate), &TeensyBridge::ping, this);
+    return true;
+}
+
+void TeensyBridge::stop(){
+    if (!running.exchange(false)) {
+        return;
+    }
+    watchdogTimer.stop();
+    pingTimer.stop();
+    if (reader.joinable()) {
+        reader.join();
+    }
+    if (commander.joinable()) {
+        commander.join();
+    }
+    if (monitor.joinable()) {
+        monitor.join();
+    }
+    shm_channel::close(shm);
+    shm = nullptr;
+    uint8_t none = 0;
+    send(ID_TX_STOP, &none, 0);
+    closePort();
+}
+
+//fd is swapped under writeMutex, so send() never writes to a closed or reused descriptor
+bool TeensyBridge::openPort(){
+    int portFd = open(port.c_str(), O_RDWR | O_NOCTTY);
+    if (portFd < 0) {
+        ROS_ERROR_THROTTLE(10.0, "Cannot open %s: %s", port.c_str(), strerror(errno));
+        return false;
+    }
+    termios tio;
+    tcgetattr(portFd, &tio);
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, toSpeed(baud));
+    cfsetospeed(&tio, toSpeed(baud));
+    tcsetattr(portFd, TCSANOW, &tio);
+    tcflush(portFd, TCIOFLUSH);
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        fd = portFd;
+    }
+    ROS_INFO("Teensy bridge on %s, topics under %s", port.c_str(), nh.getNamespace().c_str());
+    return true;
+}
+
+void TeensyBridge::closePort(){
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+//From the reader thread: reopen the port until it comes back or stop() is called
+void TeensyBridge::reconnect(){
+    closePort();
+    ROS_WARN("%s gone from %s, reopening", label.c_str(), port.c_str());
+    double backoff = 0.1;
+    while (running) {
+        //in slices, so stop() is not held up by the back-off
+        for (double slept = 0.0; running && slept < backoff; slept += 0.1) {
+            ros::WallDuration(0.1).sleep();
+        }
+        if (running && openPort()) {
+            break;
+        }
+        backoff = std::min(2.0*backoff, 2.0);
+    }
+    if (!running) {
+        return;
+    }
+    parser.reset();
+    seqValid = false;
+    lastFrameNs = wallNowNs();
+    requestTopics();
+}
+
+void TeensyBridge::readLoop(){
+    if (rt.lockMemory) {
+        realtime::prefaultStack();
+    }
+    uint8_t buffer[512];
+    pollfd pfd = {fd, POLLIN, 0};
+    while (running) {
+        // wake up now and then so stop() does not hang on a silent port
+        int ready = poll(&pfd, 1, 100);
+        if (ready <= 0) {
+            continue;
+        }
+        ssize_t n = 0;
+        if (!(pfd.revents & (POLLHUP | POLLERR | POLLNVAL))) {
+            n = read(fd, buffer, sizeof(buffer));
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+        }
+        //a hang-up, EOF or EIO: the device is gone, and the fd stays readable until closed
+        if (n <= 0) {
+            ROS_ERROR("Read from %s failed: %s", port.c_str(), n < 0 ? strerror(errno) : "hung up");
+            reconnect();
+            pfd.fd = fd;
+            continue;
+        }
+        for (ssize_t i = 0; i < n; ++i) {
+            if (parser.feed(buffer[i])) {
+                lastFrameNs = wallNowNs();
+                handleFrame(parser.topic(), parser.data());
+            }
+        }
+    }
+}
+
+void TeensyBridge::handleFrame(uint16_t topic, const std::vector<uint8_t>& data){
+    if (topic == ID_PUBLISHER || topic == ID_SUBSCRIBER) {
+        TopicInfo info;
+        if (!info.parse(data)) {
+            ROS_WARN("Malformed topic info from the Teensy");
+        } else if (topic == ID_PUBLISHER) {
+            registerPublisher(info);
+        } else {
+            registerSubscriber(info);
+        }
+    } else if (topic == ID_TIME) {
+        sendTime();
+    } else if (topic == ID_LOG) {
+        PayloadReader r(data);
+        uint8_t level;
+        std::string text;
+        if (r.u8(level) && r.string(text)) {
+            switch (level) {
+                case 0: ROS_DEBUG("%s: %s", label.c_str(), text.c_str()); break;
+                case 1: ROS_INFO("%s: %s", label.c_str(), text.c_str()); break;
+                case 2: ROS_WARN("%s: %s", label.c_str(), text.c_str()); break;
+                default: ROS_ERROR("%s: %s", label.c_str(), text.c_str()); break;
+            }
+        }
+    } else if (topic == ID_PARAMETER_REQUEST) {
+        ROS_WARN_ONCE("Teensy parameter requests are not supported by the bridge");
+    } else if (topic >= FIRST_USER_TOPIC) {
+        if (topic == packedTopicId) {
+            publishPacked(data);
+            return;
+        }
+        if (topic == batchTopicId) {
+            publishBatch(data);
+            return;
+        }
+        if (topic == deltaTopicId) {
+            publishDelta(data);
+            return;
+        }
+        if (topic == pongTopicId) {
+            //and forwarded as any other topic, for whoever else listens
+            handlePong(data, ros::Time::now().toNSec());
+        }
+        std::lock_guard<std::mutex> lock(topicsMutex);
+        auto it = publishers.find(topic);
+        if (it == publishers.end()) {
+            // the device publishes before we have its topic list after a reconnect
+            return;
+        }
+        boost::shared_ptr<topic_tools::ShapeShifter> msg = it->second.pool.next();
+        const TopicInfo& info = it->second.info;
+        msg->morph(info.md5sum, info.messageType, it->second.definition, "false");
+        ros::serialization::IStream stream(const_cast<uint8_t*>(data.data()), data.size());
+        msg->read(stream);
+        it->second.pub.publish(msg);
+    }
+}
+
+//The Teensy's topic name less device_prefix, e.g. /sensors; names the bridge matches on
+std::string TeensyBridge::deviceName(const std::string& topicName) const{
+    if (!devicePrefix.empty() && topicName.compare(0, devicePrefix.size(), devicePrefix) == 0) {
+        return topicName.substr(devicePrefix.size());
+    }
+    return topicName;
+}
+
+//A device name as a ROS topic in the bridge's namespace: /sensors is /wheel1/sensors under
+///wheel1, and stays /sensors in the root namespace
+std::string TeensyBridge::rosName(const std::string& device) const{
+    return nh.resolveName(!device.empty() && device[0] == '/' ? device.substr(1) : device);
+}
+
+void TeensyBridge::registerPublisher(const TopicInfo& info){
+    const std::string name = deviceName(info.topicName);
+    if (name == packedTopic && info.messageType == "raspi_pkg/SensorState") {
+        if (info.md5sum != ros::message_traits::md5sum<raspi_pkg::SensorState>()) {
+            ROS_ERROR("Teensy's raspi_pkg/SensorState does not match this build; regenerate the ros_lib header");
+            return;
+        }
+        if (packedTopicId != info.topicId) {
+            packedTopicId = info.topicId;
+            advertiseSensors(rosName(packedTopic));
+        }
+        return;
+    }
+    if (name == batchTopic && info.messageType == "raspi_pkg/SensorBatch") {
+        if (info.md5sum != ros::message_traits::md5sum<raspi_pkg::SensorBatch>()) {
+            ROS_ERROR("Teensy's raspi_pkg/SensorBatch does not match this build; regenerate the ros_lib header");
+            return;
+        }
+        if (batchTopicId != info.topicId) {
+            batchTopicId = info.topicId;
+            advertiseSensors(rosName(batchTopic));
+        }
+        return;
+    }
+    if (name == deltaTopic && info.messageType == "raspi_pkg/SensorDelta") {
+        if (info.md5sum != ros::message_traits::md5sum<raspi_pkg::SensorDelta>()) {
+            ROS_ERROR("Teensy's raspi_pkg/SensorDelta does not match this build; regenerate the ros_lib header");
+            return;
+        }
+        if (deltaTopicId != info.topicId) {
+            deltaTopicId = info.topicId;
+            advertiseSensors(rosName(deltaTopic));
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(topicsMutex);
+    if (publishers.count(info.topicId) && publishers[info.topicId].info.topicName == info.topicName) {
+        return;
+    }
+    if (name == "/clock_sync_pong" && info.messageType == "raspi_pkg/ClockSync") {
+        pongTopicId = info.topicId;
+    }
+    DeviceTopic& t = publishers[info.topicId];
+    t.info = info;
+    t.definition = definitionOf(info.messageType);
+    topic_tools::ShapeShifter shape;
+    shape.morph(info.md5sum, info.messageType, t.definition, "false");
+    t.pub = shape.advertise(nh, rosName(name), 1);
+    ROS_INFO("%s publishes %s [%s]", label.c_str(), t.pub.getTopic().c_str(), info.messageType.c_str());
+}
+
+void TeensyBridge::registerSubscriber(const TopicInfo& info){
+    const std::string name = deviceName(info.topicName);
+    std::lock_guard<std::mutex> lock(topicsMutex);
+    if (subscribers.count(info.topicId) && subscribers[info.topicId].info.topicName == info.topicName) {
+        return;
+    }
+    if (name == "/clock_sync_ping" && info.messageType == "raspi_pkg/ClockSync") {
+        pingTopicId = info.topicId;
+    }
+    DeviceTopic& t = subscribers[info.topicId];
+    t.info = info;
+    if (shm && name == commandTopic && info.messageType == "sensor_msgs/JointState") {
+        //commandLoop() feeds it; a ROS controller's torques would be a second writer
+        commandTopicId = info.topicId;
+        ROS_INFO("%s subscribes to %s, fed from shared memory", label.c_str(), rosName(name).c_str());
+        return;
+    }
+    //a trajectory arrives as a burst of uploads, each of which has to get through
+    const uint32_t queueSize = info.messageType == "raspi_pkg/Trajectory" ? 16 : 1;
+    t.sub = nh.subscribe<topic_tools::ShapeShifter>(rosName(name), queueSize,
+        boost::bind(&TeensyBridge::forwardToDevice, this, _1, info.topicId), ros::VoidConstPtr(),
+        ros::TransportHints().tcpNoDelay());
+    ROS_INFO("%s subscribes to %s [%s]", label.c_str(), t.sub.getTopic().c_str(), info.messageType.c_str());
+}
+
+//packedPub carries every sample, so a batch's worth can queue for the recorder
+void TeensyBridge::advertiseSensors(const std::string& from){
+    if (!shm) {
+        sensorsPub = nh.advertise<sensor_msgs::JointState>(sensorsTopic, 1);
+    }
+    packedPub = nh.advertise<raspi_pkg::SensorState>(rosName(packedTopic), raspi_pkg::SensorBatch::MAX_SAMPLES);
+    ROS_INFO("%s publishes %s, expanded onto %s", label.c_str(), from.c_str(), nh.resolveName(sensorsTopic).c_str());
+}
+
+void TeensyBridge::publishPacked(const std::vector<uint8_t>& data){
+    raspi_pkg::SensorStatePtr packed = packedMsgs.next();
+    ros::serialization::IStream stream(const_cast<uint8_t*>(data.data()), data.size());
+    try {
+        ros::serialization::deserialize(stream, *packed);
+    } catch (const ros::serialization::StreamOverrunException&) {
+        ROS_WARN_THROTTLE(1.0, "Short %s frame from the %s", packedTopic.c_str(), label.c_str());
+        return;
+    }
+    deliverSample(packed, 1, true);
+}
+
+//Each sample as the SensorState it was taken as
+void TeensyBridge::publishBatch(const std::vector<uint8_t>& data){
+    ros::serialization::IStream stream(const_cast<uint8_t*>(data.data()), data.size());
+    try {
+        ros::serialization::deserialize(stream, batch);
+    } catch (const ros::serialization::StreamOverrunException&) {
+        ROS_WARN_THROTTLE(1.0, "Short %s frame from the %s", batchTopic.c_str(), label.c_str());
+        return;
+    }
+    const uint32_t count = std::min<uint32_t>(batch.count, batch.samples.size());
+    const uint32_t stride = std::max<uint32_t>(batch.stride, 1);
+    for (uint32_t i = 0; i < count; ++i) {
+        const raspi_pkg::SensorSample& sample = batch.samples[i];
+        raspi_pkg::SensorStatePtr packed = packedMsgs.next();
+        packed->seq = batch.seq + i*stride;
+        packed->stamp_us = batch.stamp_us + sample.offset_us;
+        packed->torso_roll = sample.torso_roll;
+        packed->torso_omega = sample.torso_omega;
+        packed->yaw = sample.yaw;
+        packed->spoke_angle = sample.spoke_angle;
+        packed->spoke_omega = sample.spoke_omega;
+        packed->status = sample.status;
+        packed->motor_current = sample.motor_current;
+        packed->vbus_voltage = sample.vbus_voltage;
+        deliverSample(packed, stride, i + 1 == count);
+    }
+}
+
+void TeensyBridge::publishDelta(const std::vector<uint8_t>& data){
+    ros::serialization::IStream stream(const_cast<uint8_t*>(data.data()), data.size());
+    try {
+        ros::serialization::deserialize(stream, deltaFrame);
+    } catch (const ros::serialization::StreamOverrunException&) {
+        ROS_WARN_THROTTLE(1.0, "Short %s frame from the %s", deltaTopic.c_str(), label.c_str());
+        return;
+    }
+    deltaSamples.clear();
+    if (!deltaDecoder.decode(deltaFrame, deltaSamples)) {
+        ROS_WARN_THROTTLE(1.0, "%s: %u %s frames lost, %u skipped waiting for a keyframe", label.c_str(),
+                          deltaDecoder.lostFrames(), deltaTopic.c_str(), deltaDecoder.skipped());
+        //reported here, so the seq gap after the keyframe is not reported again
+        seqValid = false;
+        return;
+    }
+    const uint32_t stride = std::max<uint32_t>(deltaFrame.stride, 1);
+    for (size_t i = 0; i < deltaSamples.size(); ++i) {
+        deliverSample(deltaSamples[i], stride, i + 1 == deltaSamples.size());
+    }
+}
+
+//Every sample to packedPub; the newest of a batch, or every single one, to /sensors or shm
+void TeensyBridge::deliverSample(const raspi_pkg::SensorStatePtr& packed, uint32_t stride, bool newest){
+    if (seqValid && packed->seq != lastSeq + stride) {
+        ROS_WARN_THROTTLE(1.0, "%s samples dropped: %u", label.c_str(), (packed->seq - lastSeq)/stride - 1);
+    }
+    seqValid = true;
+    lastSeq = packed->seq;
+    if (!newest) {
+        if (packedPub.getNumSubscribers() > 0) {
+            packedPub.publish(packed);
+        }
+        return;
+    }
+
+    if (shm) {
+        shm_channel::Sample sample = {};
+        sample.seq = packed->seq;
+        {
+            std::lock_guard<std::mutex> lock(clockMutex);
+            sample.stampNs = clock.synced() ? clock.toPiNs(packed->stamp_us) : (int64_t)ros::Time::now().toNSec();
+        }
+        float position[4] = {packed->torso_roll, packed->spoke_angle[0], packed->spoke_angle[1], packed->yaw};
+        float velocity[3] = {packed->torso_omega, packed->spoke_omega[0], packed->spoke_omega[1]};
+        memcpy(sample.position, position, sizeof(position));
+        memcpy(sample.velocity, velocity, sizeof(velocity));
+        shm->sample.write(sample);
+        if (packedPub.getNumSubscribers() > 0) {
+            packedPub.publish(packed);
+        }
+        return;
+    }
+
+    // position = [torso roll, spoke 0, spoke 1, yaw], velocity = [torso omega, spoke 0, spoke 1]
+    sensor_msgs::JointStatePtr joints = sensorsMsgs.next();
+    joints->header.seq = packed->seq;
+    // as the Teensy's own JointState: the controllers echo frame_id for COMMAND_LATENCY
+    joints->header.frame_id = std::to_string(packed->seq);
+    {
+        std::lock_guard<std::mutex> lock(clockMutex);
+        if (clock.synced()) {
+            joints->header.stamp.fromNSec(clock.toPiNs(packed->stamp_us));
+        } else {
+            joints->header.stamp = ros::Time::now();
+        }
+    }
+    joints->position[0] = packed->torso_roll;
+    joints->position[1] = packed->spoke_angle[0];
+    joints->position[2] = packed->spoke_angle[1];
+    joints->position[3] = packed->yaw;
+    joints->velocity[0] = packed->torso_omega;
+    joints->velocity[1] = packed->spoke_omega[0];
+    joints->velocity[2] = packed->spoke_omega[1];
+    sensorsPub.publish(joints);
+    if (packedPub.getNumSubscribers() > 0) {
+        packedPub.publish(packed);
+    }
+}
+
+void TeensyBridge::forwardToDevice(const topic_tools::ShapeShifter::ConstPtr& msg, uint16_t topicId){
+    //per callback thread, so a torque command reuses the last one's buffer
+    static thread_local std::vector<uint8_t> data;
+    data.resize(msg->size());
+    ros::serialization::OStream stream(data.data(), data.size());
+    msg->write(stream);
+    {
+        //the Teensy drops a message longer than its input buffer without a word, e.g. a too long trajectory upload
+        std::lock_guard<std::mutex> lock(topicsMutex);
+        auto it = subscribers.find(topicId);
+        if (it != subscribers.end() && it->second.info.bufferSize > 0 && data.size() > it->second.info.bufferSize) {
+            ROS_WARN_THROTTLE(1.0, "%s: %zu byte message on %s exceeds the Teensy's %u byte input buffer, dropped",
+                label.c_str(), data.size(), it->second.info.topicName.c_str(), it->second.info.bufferSize);
+            return;
+        }
+    }
+    send(topicId, data.data(), data.size());
+}
+
+void TeensyBridge::sendTime(){
+    ros::Time now = ros::Time::now();
+    uint32_t t[2] = {now.sec, now.nsec};
+    send(ID_TIME, reinterpret_cast<const uint8_t*>(t), sizeof(t));
+}
+
+//The Teensy answers on /clock_sync_pong with its micros() on receipt and reply
+void TeensyBridge::ping(const ros::WallTimerEvent&){
+    if (pingTopicId == 0) {
+        return;
+    }
+    raspi_pkg::ClockSync msg;
+    msg.id = ++pingId;
+    std::vector<uint8_t> data(ros::serialization::serializationLength(msg));
+    //stamped as late as the serialization allows
+    msg.pi_send = ros::Time::now();
+    ros::serialization::OStream stream(data.data(), data.size());
+    ros::serialization::serialize(stream, msg);
+    send(pingTopicId, data.data(), data.size());
+}
+
+void TeensyBridge::handlePong(const std::vector<uint8_t>& data, int64_t receivedNs){
+    raspi_pkg::ClockSync pong;
+    ros::serialization::IStream stream(const_cast<uint8_t*>(data.data()), data.size());
+    try {
+        ros::serialization::deserialize(stream, pong);
+    } catch (const ros::serialization::StreamOverrunException&) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(clockMutex);
+    clock.addExchange(pong.pi_send.toNSec(), pong.teensy_receive_us, pong.teensy_send_us, receivedNs);
+    //throttled per bridge, ROS_INFO_THROTTLE would let one robot's clock hide the others'
+    if (receivedNs - lastClockLogNs >= 10000000000LL) {
+        lastClockLogNs = receivedNs;
+        ROS_INFO("%s clock: drift %.1f ppm, fastest round trip %.2f ms over %zu pings",
+                 label.c_str(), clock.driftPpm(), clock.minRttNs()*1e-6, clock.exchangeCount());
+    }
+}
+
+//Every torque the controller writes goes to the Teensy as its /torso_command JointState
+void TeensyBridge::commandLoop(){
+    if (rt.lockMemory) {
+        realtime::prefaultStack();
+    }
+    uint32_t lastCommand = 0;
+    shm_channel::Command command;
+    while (running) {
+        if (shm->command.wait(lastCommand, command, 100000000) && commandTopicId != 0) {
+            sendCommand(command);
+        }
+    }
+}
+
+void TeensyBridge::sendCommand(const shm_channel::Command& command){
+    //as the controller's message: the sample's seq echoed in frame_id, nothing for a zero
+    commandMsg.header.seq = command.seq;
+    commandMsg.header.stamp = ros::Time::now();
+    commandMsg.header.frame_id = command.sampleSeq ? std::to_string(command.sampleSeq) : std::string();
+    commandMsg.effort[0] = command.torque;
+    commandData.resize(ros::serialization::serializationLength(commandMsg));
+    ros::serialization::OStream stream(commandData.data(), commandData.size());
+    ros::serialization::serialize(stream, commandMsg);
+    send(commandTopicId, commandData.data(), commandData.size());
+}
+
+//Both slots onto ROS for monitoring; a sample or command it misses is skipped, never queued
+void TeensyBridge::monitorLoop(){
+    uint32_t lastSample = 0, lastCommand = 0;
+    shm_channel::Sample sample;
+    shm_channel::Command command;
+    while (running) {
+        if (shm->sample.wait(lastSample, sample, 100000000)) {
+            //with shm the reader thread never takes from sensorsMsgs
+            sensor_msgs::JointStatePtr joints = sensorsMsgs.next();
+            joints->header.seq = sample.seq;
+            joints->header.frame_id = std::to_string(sample.seq);
+            joints->header.stamp.fromNSec(sample.stampNs);
+            std::copy(sample.position, sample.position + 4, joints->position.begin());
+            std::copy(sample.velocity, sample.velocity + 3, joints->velocity.begin());
+            monitorSensorsPub.publish(joints);
+        }
+        //the torque for a sample lands after it, so it is published with the next one
+        if (shm->command.tryRead(lastCommand, command)) {
+            sensor_msgs::JointStatePtr torque = monitorCommandMsgs.next();
+            torque->header.seq = command.seq;
+            torque->header.stamp = ros::Time::now();
+            torque->header.frame_id = command.sampleSeq ? std::to_string(command.sampleSeq) : std::string();
+            torque->effort[0] = command.torque;
+            monitorCommandPub.publish(torque);
+        }
+    }
+}
+
+void TeensyBridge::requestTopics(){
+    send(ID_PUBLISHER, nullptr, 0);
+}
+
+void TeensyBridge::send(uint16_t topic, const uint8_t* data, size_t length){
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (fd < 0) {
+        return;
+    }
+    encodeFrame(topic, data, length, txFrame);
+    size_t sent = 0;
+    while (sent < txFrame.size()) {
+        ssize_t n = write(fd, txFrame.data() + sent, txFrame.size() - sent);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ROS_ERROR_THROTTLE(1.0, "Write to %s failed: %s", port.c_str(), strerror(errno));
+            return;
+        }
+        sent += n;
+    }
+}
+
+//Ask for the topic list again if the Teensy went quiet, e.g. after a reset
+void TeensyBridge::watchdog(const ros::WallTimerEvent&){
+    if (wallNowNs() - lastFrameNs > 2000000000LL) {
+        seqValid = false;
+        requestTopics();
+    }
+}
+
+std::string TeensyBridge::definitionOf(const std::string& type) const{
+    if (type == "sensor_msgs/JointState") return ros::message_traits::definition<sensor_msgs::JointState>();
+    if (type == "sensor_msgs/Joy") return ros::message_traits::definition<sensor_msgs::Joy>();
+    if (type == "std_msgs/Int64MultiArray") return ros::message_traits::definition<std_msgs::Int64MultiArray>();
+    if (type == "diagnostic_msgs/DiagnosticArray") return ros::message_traits::definition<diagnostic_msgs::DiagnosticArray>();
+    if (type == "raspi_pkg/SensorState") return ros::message_traits::definition<raspi_pkg::SensorState>();
+    if (type == "raspi_pkg/ClockSync") return ros::message_traits::definition<raspi_pkg::ClockSync>();
+    if (type == "raspi_pkg/ODriveErrors") return ros::message_traits::definition<raspi_pkg::ODriveErrors>();
+    if (type == "raspi_pkg/Teleop") return ros::message_traits::definition<raspi_pkg::Teleop>();
+    if (type == "raspi_pkg/Trajectory") return ros::message_traits::definition<raspi_pkg::Trajectory>();
+    return "";
+}
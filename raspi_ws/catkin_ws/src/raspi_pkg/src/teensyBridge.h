@@ -0,0 +1,171 @@
+#ifndef RASPI_PKG_TEENSY_BRIDGE_H
+#define RASPI_PKG_TEENSY_BRIDGE_H
+
+#include "ros/ros.h"
+#include <topic_tools/shape_shifter.h>
+#include <boost/bind.hpp>
+#include "rosserialProtocol.h"
+#include "clockSync.h"
+#include "shmChannel.h"
+#include "realtime.h"
+#include "sensorDelta.h"
+#include "messagePool.h"
+#include <sensor_msgs/JointState.h>
+#include <raspi_pkg/SensorState.h>
+#include <raspi_pkg/SensorBatch.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//TeensyBridge speaks the rosserial wire protocol on the Teensy's USB serial port,
+//replacing rosserial_python/serial_node.py.
+//
+//A reader thread at SCHED_FIFO priority parses frames as they arrive. The packed
+///sensors_packed sample is decoded and published on /sensors as a shared_ptr, so a
+//controller loaded into the same nodelet manager receives it without a copy. A /sensors_batch
+//raspi_pkg/SensorBatch, from firmware built with SENSOR_BATCH, is expanded: every sample onto
+///sensors_packed for the recorder, only the newest onto /sensors (or shm) for the controller;
+//so is a /sensors_delta raspi_pkg/SensorDelta (SENSOR_DELTA) once sensorDelta.h has decoded it.
+//Every other Teensy topic is forwarded as raw bytes through topic_tools::ShapeShifter,
+//in both directions. Every message the bridge publishes comes from a MessagePool (one per
+//forwarded topic, with its definition looked up once), and the batch and delta frames decode
+//into reused members, so after the first frames the reader thread does not allocate.
+//
+//A port that hangs up or fails a read (the Teensy was reset or unplugged) is closed and
+//reopened, as serial_node.py does, with a back-off of 0.1 s doubling to 2 s between attempts;
+//the topics are then requested again.
+//
+//The bridge also keeps the Teensy's clock (clockSync.h): it writes a /clock_sync_ping frame
+//at ping_rate Hz, stamped just before the write, and stamps each /clock_sync_pong frame as
+//it is parsed, so the exchange sees only the USB link. /sensors then carries each sample's
+//stamp_us in Pi time, or the arrival time until the clock has synced.
+//
+//With ~shm set to a channel name (shmChannel.h) the control path leaves ROS: each sample goes
+//into the channel's sample slot straight from the reader thread, and a second SCHED_FIFO
+//thread sends every torque from its command slot to the Teensy's ~command_topic subscriber,
+//which then gets no ROS subscription. A monitor thread at normal priority publishes both
+//slots on /sensors and /torso_command for rostopic and rosbag, off the control path.
+//
+//The reader and command threads take realtime.h's rt_priority (80 by default), cpu_affinity,
+//lock_memory and prealloc_mb; probe_latency reports the wakeup latency they can expect.
+//
+//The Teensy's topics are put in the bridge's namespace: its /sensors is /wheel1/sensors for a
+//bridge in /wheel1 and stays /sensors in the root namespace. device_prefix is stripped from the
+//Teensy's names first, for firmware built with a ROS_TOPIC_PREFIX; packed_topic, batch_topic,
+//delta_topic, command_topic and the clock sync topics are matched on the names without it. So several bridges, one per
+//serial port and each with its own reader thread, can run in one process (teensyBridgeNode.cpp,
+//~robots) or as nodelets, one wheel per namespace.
+//
+//Parameters (private): port, baud, rt_priority, cpu_affinity, lock_memory, prealloc_mb,
+//probe_latency, device_prefix, packed_topic, batch_topic, delta_topic, sensors_topic, ping_rate, shm, command_topic
+
+class TeensyBridge{
+
+    public:
+        TeensyBridge(ros::NodeHandle& nh, ros::NodeHandle& pnh);
+        ~TeensyBridge();
+
+        bool start();
+        void stop();
+
+    private:
+        struct DeviceTopic{
+            rosserial_protocol::TopicInfo info;
+            std::string definition;
+            ros::Publisher pub;
+            MessagePool<topic_tools::ShapeShifter> pool;
+            ros::Subscriber sub;
+        };
+
+        bool openPort();
+        void closePort();
+        void reconnect();
+        void readLoop();
+        void handleFrame(uint16_t topic, const std::vector<uint8_t>& data);
+        void registerPublisher(const rosserial_protocol::TopicInfo& info);
+        void registerSubscriber(const rosserial_protocol::TopicInfo& info);
+        void publishPacked(const std::vector<uint8_t>& data);
+        void publishBatch(const std::vector<uint8_t>& data);
+        void publishDelta(const std::vector<uint8_t>& data);
+        void deliverSample(const raspi_pkg::SensorStatePtr& packed, uint32_t stride, bool newest);
+        void advertiseSensors(const std::string& from);
+        void forwardToDevice(const topic_tools::ShapeShifter::ConstPtr& msg, uint16_t topicId);
+        void sendTime();
+        void requestTopics();
+        void send(uint16_t topic, const uint8_t* data, size_t length);
+        void watchdog(const ros::WallTimerEvent&);
+        void ping(const ros::WallTimerEvent&);
+        void handlePong(const std::vector<uint8_t>& data, int64_t receivedNs);
+        std::string definitionOf(const std::string& type) const;
+        std::string deviceName(const std::string& topicName) const;
+        std::string rosName(const std::string& device) const;
+        void commandLoop();
+        void monitorLoop();
+        void sendCommand(const shm_channel::Command& command);
+
+        ros::NodeHandle nh;
+        std::string label; //"Teensy", or "Teensy <namespace>" outside the root one
+        std::string port;
+        int baud;
+        realtime::Config rt;
+        std::string devicePrefix;
+        std::string packedTopic;
+        std::string batchTopic;
+        std::string deltaTopic;
+        std::string sensorsTopic;
+        double pingRate;
+        std::string shmName;
+        std::string commandTopic;
+
+        int fd = -1;
+        std::thread reader;
+        std::atomic<bool> running{false};
+        std::mutex writeMutex;
+        std::vector<uint8_t> txFrame;
+
+        std::mutex topicsMutex;
+        std::map<uint16_t, DeviceTopic> publishers;
+        std::map<uint16_t, DeviceTopic> subscribers;
+        uint16_t packedTopicId = 0;
+        uint16_t batchTopicId = 0;
+        uint16_t deltaTopicId = 0;
+        SensorDeltaDecoder deltaDecoder;
+        std::vector<raspi_pkg::SensorStatePtr> deltaSamples;
+        raspi_pkg::SensorBatch batch;
+        raspi_pkg::SensorDelta deltaFrame;
+        //the samples of a frame plus as many queued on packedPub, and the /sensors in flight
+        MessagePool<raspi_pkg::SensorState> packedMsgs{nullptr, 2*raspi_pkg::SensorBatch::MAX_SAMPLES};
+        MessagePool<sensor_msgs::JointState> sensorsMsgs{[](sensor_msgs::JointState& msg){
+            msg.position.resize(4);
+            msg.velocity.resize(3);
+        }};
+        ros::Publisher sensorsPub;
+        ros::Publisher packedPub;
+
+        std::atomic<int64_t> lastFrameNs{0};
+        ros::WallTimer watchdogTimer;
+        ros::WallTimer pingTimer;
+        std::atomic<uint16_t> pingTopicId{0};
+        std::atomic<uint16_t> pongTopicId{0};
+        uint32_t pingId = 0;
+        std::mutex clockMutex;
+        TeensyClock clock;
+        int64_t lastClockLogNs = 0;
+        rosserial_protocol::FrameParser parser;
+        uint32_t lastSeq = 0;
+        std::atomic<bool> seqValid{false};  //cleared by watchdog() too
+
+        shm_channel::Region* shm = nullptr;
+        std::thread commander;
+        std::thread monitor;
+        std::atomic<uint16_t> commandTopicId{0};
+        ros::Publisher monitorSensorsPub;
+        ros::Publisher monitorCommandPub;
+        MessagePool<sensor_msgs::JointState> monitorCommandMsgs{[](sensor_msgs::JointState& msg){ msg.effort.resize(1); }};
+        sensor_msgs::JointState commandMsg;
+        std::vector<uint8_t> commandData;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include "ros/ros.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include "teensyBridge.h"
+
+//One bridge, or with ~robots (e.g. [wheel1, wheel2]) one per wheel: bridge i has its topics in
+//the namespace robots[i] under the node's and its parameters in ~robots[i]/, e.g.
+//~wheel1/port, so each serial port gets its own reader thread and its own rt settings.
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "teensy_bridge");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+
+    std::vector<std::string> robots;
+    pnh.param("robots", robots, std::vector<std::string>());
+    std::vector<std::unique_ptr<TeensyBridge>> bridges;
+    if (robots.empty()) {
+        bridges.emplace_back(new TeensyBridge(nh, pnh));
+    } else {
+        for (const std::string& robot : robots) {
+            ros::NodeHandle rnh(nh, robot);
+            ros::NodeHandle rpnh(pnh, robot);
+            bridges.emplace_back(new TeensyBridge(rnh, rpnh));
+        }
+    }
+    for (auto& bridge : bridges) {
+        if (!bridge->start()) {
+            return 1;
+        }
+    }
+    //the bridges' ROS callbacks are forwards to their ports; one spinner thread per bridge
+    //keeps one wheel's torques from queueing behind another's
+    ros::MultiThreadedSpinner spinner(bridges.size());
+    spinner.spin();
+    for (auto& bridge : bridges) {
+        bridge->stop();
+    }
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <memory>
+#include "teensyBridge.h"
+
+namespace raspi_pkg {
+
+//Load into the controller's nodelet manager so /sensors and /torso_command are passed as pointers
+class TeensyBridgeNodelet : public nodelet::Nodelet{
+
+    private:
+        void onInit() override {
+            bridge.reset(new TeensyBridge(getMTNodeHandle(), getMTPrivateNodeHandle()));
+            if (!bridge->start()) {
+                NODELET_ERROR("Teensy bridge failed to start");
+            }
+        }
+
+        std::unique_ptr<TeensyBridge> bridge;
+};
+
+} // namespace raspi_pkg
+
+PLUGINLIB_EXPORT_CLASS(raspi_pkg::TeensyBridgeNodelet, nodelet::Nodelet)
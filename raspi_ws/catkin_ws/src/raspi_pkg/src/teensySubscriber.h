@@ -0,0 +1,104 @@
+#ifndef RASPI_PKG_TEENSY_SUBSCRIBER_H
+#define RASPI_PKG_TEENSY_SUBSCRIBER_H
+
+#include "ros/ros.h"
+#include <sensor_msgs/JointState.h>
+#include <cmath>
+#include <cstdint>
+#include "shmChannel.h"
+#include "yawTracker.h"
+
+//TeensySubscriberCallBack keeps the latest /sensors sample for readers on other threads: the
+//controller, the recorder, analytics such as isTurning(). getSensorStates() is the subscriber
+//callback and the only writer; it stores the sample in a shmChannel.h Slot, the seqlock the
+//shared-memory control path uses, here in ordinary memory. A reader never takes a lock or
+//stalls the callback, and always gets one whole sample, never half of two.
+//
+//Each State carries the sample's header.seq, its header.stamp and the wall time it was
+//received, so a reader can tell a stale sample and count the ones it skipped, and the heading,
+//yaw rate and turning flag of a YawTracker fed with the yaw (position[3]) on the way in, so the
+//analytics cost one update per sample on the writer and nothing on the readers. The torso angle
+//goes to the console at most once a second.
+//position = [torso roll, spoke 0, spoke 1, yaw], velocity = [torso omega, spoke 0, spoke 1]
+
+class TeensySubscriberCallBack{
+
+    public:
+        struct State{
+            uint32_t seq;
+            uint32_t pad;
+            int64_t stampNs;   //header.stamp
+            int64_t receiveNs; //ros::WallTime when the callback ran
+            float torsoState[2]; //angle, rate
+            float spokeState[4]; //spoke 0 and 1 angles, then their rates
+            float heading; //YawTracker's, rad unwrapped since the first sample
+            float yawRate; //rad/s
+            uint32_t turning;
+        };
+
+        explicit TeensySubscriberCallBack(const YawTracker& yaw = YawTracker()) : yaw(yaw) {}
+
+        void getSensorStates(const sensor_msgs::JointState &msg) {
+            if (msg.position.size() < 3 || msg.velocity.size() < 3) {
+                ROS_WARN_THROTTLE(1.0, "Short /sensors message");
+                return;
+            }
+            State state;
+            state.seq = msg.header.seq;
+            state.pad = 0;
+            state.stampNs = (int64_t)msg.header.stamp.toNSec();
+            state.receiveNs = (int64_t)ros::WallTime::now().toNSec();
+            state.torsoState[0] = msg.position[0];
+            state.torsoState[1] = msg.velocity[0];
+            state.spokeState[0] = msg.position[1];
+            state.spokeState[1] = msg.position[2];
+            state.spokeState[2] = msg.velocity[1];
+            state.spokeState[3] = msg.velocity[2];
+            if (msg.position.size() >= 4) {
+                //a publisher that leaves the stamp unset is timed by its arrival
+                yaw.update(state.stampNs ? state.stampNs : state.receiveNs, msg.position[3]);
+            }
+            state.heading = (float)yaw.smoothedHeading();
+            state.yawRate = (float)yaw.yawRate();
+            state.turning = yaw.turning();
+            slot.write(state);
+
+            ROS_INFO_THROTTLE(1.0, "Torso angle = %f", state.torsoState[0]);
+        }
+
+        //The latest sample; false until the first one
+        bool latest(State& state) const{
+            uint32_t last = 0;
+            return slot.tryRead(last, state);
+        }
+
+        //A sample newer than last (a sequence from an earlier call), once per sample
+        bool next(uint32_t& last, State& state) const{
+            return slot.tryRead(last, state);
+        }
+
+        //next(), blocking for up to timeoutNs for the sample
+        bool wait(uint32_t& last, State& state, int64_t timeoutNs) const{
+            return slot.wait(last, state, timeoutNs);
+        }
+
+        //The wheel yawing at the latest sample, with YawTracker's hysteresis
+        bool isTurning() const{
+            State state;
+            return latest(state) && state.turning;
+        }
+
+        //Either spoke turning faster than minRate rad/s at the latest sample
+        bool isRolling(float minRate = 0.1f) const{
+            State state;
+            if (!latest(state))
+                return false;
+            return std::fabs(state.spokeState[2]) > minRate || std::fabs(state.spokeState[3]) > minRate;
+        }
+
+    private:
+        YawTracker yaw;
+        shm_channel::Slot<State> slot{}; //zeroed, a zero sequence is nothing written yet
+};
+
+#endif //RASPI_PKG_TEENSY_SUBSCRIBER_H
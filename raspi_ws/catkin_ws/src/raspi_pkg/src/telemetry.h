@@ -0,0 +1,281 @@
+#ifndef RASPI_PKG_TELEMETRY_H
+#define RASPI_PKG_TELEMETRY_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+//Telemetry for live plots off the Pi without ROS on the viewer: each channel (torso angle,
+//spokes, torque, loop timing, see telemetryServer.h) is kept as a min/max pyramid, and a
+//UDP socket hands it out, so a viewer over WiFi gets a plot of any span in a few datagrams.
+//
+//LodPyramid: level 0 is the samples themselves, level l buckets of 4^l of them (with
+//factorShift 2), each a min and a max per channel, so a plot drawn from the buckets of any
+//level keeps every spike the samples had. Every level keeps its last capacity buckets in a
+//ring, and add() updates the open bucket of every level, so a sample costs levels compares
+//per channel and no allocation; NaN values are left out of a bucket (one of only NaN is NaN).
+//Buckets are numbered from the start at each level, so a viewer asks for "level l from
+//bucket n" and a reply says which ones it holds.
+//
+//Protocol, little-endian, one datagram each:
+//  viewer -> server port: Request {magic, type, level, count, first}
+//    DESCRIBE   reply: PacketHeader (level = levels, first = capacity, count = 0), then per
+//               channel "name unit\n"
+//    HISTORY    reply: up to count buckets of level from first (or the oldest still kept),
+//               in as many datagrams as that takes, at most maxReplyDatagrams
+//  server -> stream address (a multicast group by default): STREAM datagrams with the buckets
+//  of the stream level closed since the last one, at the server's stream rate
+//A bucket datagram is a PacketHeader followed by count x channels {min, max} floats, bucket
+//major. The stream is one send per period whatever the number of viewers, and a history
+//request is answered only when a viewer asks, so the control Pi's cost does not grow with
+//them; every socket call is non-blocking, made from the server's timer.
+
+namespace telemetry {
+
+struct Bucket{
+    float min;
+    float max;
+};
+
+class LodPyramid{
+
+    public:
+        LodPyramid(int channels, int levels, int factorShift, size_t capacity)
+            : channels(channels), levels(levels), factorShift(factorShift), capacity(capacity),
+              ring(levels, std::vector<Bucket>(capacity * channels)), open(levels * channels),
+              openCount(levels, 0), closedCount(levels, 0){
+            for (Bucket& b : open) b = {NAN, NAN};
+        }
+
+        //One sample, values[channels]
+        void add(const float* values){
+            for (int l = 0; l < levels; ++l) {
+                Bucket* b = &open[l * channels];
+                for (int c = 0; c < channels; ++c) {
+                    b[c].min = fminf(b[c].min, values[c]);
+                    b[c].max = fmaxf(b[c].max, values[c]);
+                }
+                if (++openCount[l] == samplesPerBucket(l)) {
+                    Bucket* slot = &ring[l][(closedCount[l] % capacity) * channels];
+                    for (int c = 0; c < channels; ++c) {
+                        slot[c] = b[c];
+                        b[c] = {NAN, NAN};
+                    }
+                    openCount[l] = 0;
+                    ++closedCount[l];
+                }
+            }
+        }
+
+        //Buckets closed so far at level, the number of the next one
+        uint32_t closed(int level) const{ return closedCount[level]; }
+        uint32_t oldest(int level) const{ return closedCount[level] > capacity ? closedCount[level] - (uint32_t)capacity : 0; }
+        uint32_t samplesPerBucket(int level) const{ return 1u << (factorShift * level); }
+
+        //Up to n buckets of level from first, moved up to the oldest kept, into out[i*channels + c];
+        //the count copied
+        size_t read(int level, uint32_t& first, size_t n, Bucket* out) const{
+            first = std::max(first, oldest(level));
+            size_t count = first < closedCount[level] ? std::min<size_t>(n, closedCount[level] - first) : 0;
+            for (size_t i = 0; i < count; ++i) {
+                const Bucket* slot = &ring[level][((first + i) % capacity) * channels];
+                std::copy(slot, slot + channels, out + i * channels);
+            }
+            return count;
+        }
+
+        const int channels;
+        const int levels;
+        const int factorShift;
+        const size_t capacity;
+
+    private:
+        std::vector<std::vector<Bucket>> ring;
+        std::vector<Bucket> open;
+        std::vector<uint32_t> openCount;
+        std::vector<uint32_t> closedCount;
+};
+
+const uint32_t MAGIC = 0x31545752; //"RWT1"
+
+enum Type : uint8_t { DESCRIBE = 1, HISTORY = 2, STREAM = 3 };
+
+struct Request{
+    uint32_t magic;
+    uint8_t type;
+    uint8_t level;
+    uint16_t count;
+    uint32_t first;
+};
+
+struct PacketHeader{
+    uint32_t magic;
+    uint8_t type;
+    uint8_t level;
+    uint8_t channels;
+    uint8_t count;
+    uint32_t first;            //number of the first bucket at level
+    uint32_t samplesPerBucket;
+    float samplePeriod;        //s, the measured mean between samples
+};
+
+static_assert(sizeof(Request) == 12 && sizeof(PacketHeader) == 20, "the layout is the protocol");
+
+class Server{
+
+    public:
+        struct Channel{
+            std::string name;
+            std::string unit;
+        };
+
+        //port: requests, 0 for none; streamAddress "a.b.c.d:port", empty for no stream
+        Server(const LodPyramid& pyramid, std::vector<Channel> names, size_t maxDatagram = 1400)
+            : pyramid(pyramid), names(std::move(names)),
+              bucketsPerDatagram(std::min<size_t>(255, (maxDatagram - sizeof(PacketHeader)) / (sizeof(Bucket) * pyramid.channels))),
+              buffer(maxDatagram){}
+
+        ~Server(){
+            if (fd >= 0) ::close(fd);
+        }
+
+        bool open(uint16_t port, const std::string& streamAddress, std::string& error){
+            fd = socket(AF_INET, SOCK_DGRAM, 0);
+            if (fd < 0 || fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+                error = std::string("socket: ") + strerror(errno);
+                return false;
+            }
+            sockaddr_in local = {};
+            local.sin_family = AF_INET;
+            local.sin_addr.s_addr = htonl(INADDR_ANY);
+            local.sin_port = htons(port);
+            if (port != 0 && bind(fd, (sockaddr*)&local, sizeof(local)) != 0) {
+                error = "bind port " + std::to_string(port) + ": " + strerror(errno);
+                return false;
+            }
+            if (!streamAddress.empty()) {
+                size_t colon = streamAddress.rfind(':');
+                stream = {};
+                stream.sin_family = AF_INET;
+                if (colon == std::string::npos || inet_pton(AF_INET, streamAddress.substr(0, colon).c_str(), &stream.sin_addr) != 1) {
+                    error = "stream address " + streamAddress + " is not a.b.c.d:port";
+                    return false;
+                }
+                stream.sin_port = htons((uint16_t)atoi(streamAddress.c_str() + colon + 1));
+                int on = 1;
+                unsigned char ttl = 1; //the field's network, not beyond the first router
+                setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+                setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+                streaming = true;
+            }
+            return true;
+        }
+
+        //Answers the requests waiting, at most maxRequests of them
+        void poll(float samplePeriod, int maxRequests = 16, int maxReplyDatagrams = 32){
+            for (int r = 0; r < maxRequests; ++r) {
+                Request request;
+                sockaddr_in from;
+                socklen_t fromSize = sizeof(from);
+                ssize_t n = recvfrom(fd, &request, sizeof(request), MSG_DONTWAIT, (sockaddr*)&from, &fromSize);
+                if (n < 0) {
+                    return;
+                }
+                if (n != (ssize_t)sizeof(request) || request.magic != MAGIC) {
+                    ++badRequests;
+                    continue;
+                }
+                ++requests;
+                if (request.type == DESCRIBE) {
+                    describe(from, samplePeriod);
+                } else if (request.type == HISTORY && request.level < pyramid.levels) {
+                    uint32_t first = request.first;
+                    size_t left = request.count;
+                    for (int d = 0; d < maxReplyDatagrams && left > 0; ++d) {
+                        size_t sent = sendBuckets(from, HISTORY, request.level, first, std::min(left, bucketsPerDatagram), samplePeriod);
+                        if (sent == 0) break;
+                        first += (uint32_t)sent;
+                        left -= sent;
+                    }
+                } else {
+                    ++badRequests;
+                }
+            }
+        }
+
+        //The stream level's buckets closed since the last call, to the stream address
+        void publish(uint8_t level, float samplePeriod, int maxDatagrams = 4){
+            if (!streaming) return;
+            if (!streamStarted) {
+                //a stream starts at the present, not with the ring
+                streamNext = pyramid.closed(level);
+                streamStarted = true;
+            }
+            //fallen behind the ring, read() skips to what is kept
+            for (int d = 0; d < maxDatagrams && streamNext < pyramid.closed(level); ++d) {
+                size_t sent = sendBuckets(stream, STREAM, level, streamNext, bucketsPerDatagram, samplePeriod);
+                streamNext += (uint32_t)sent;
+            }
+        }
+
+        uint64_t requests = 0;
+        uint64_t badRequests = 0;
+        uint64_t datagrams = 0;
+        uint64_t sendErrors = 0;
+
+    private:
+        //from first, moved up to the oldest kept as read() does, so a caller continues after the count sent
+        size_t sendBuckets(const sockaddr_in& to, Type type, uint8_t level, uint32_t& first, size_t n, float samplePeriod){
+            Bucket* buckets = reinterpret_cast<Bucket*>(buffer.data() + sizeof(PacketHeader));
+            size_t count = pyramid.read(level, first, n, buckets);
+            if (count == 0) return 0;
+            PacketHeader header = {MAGIC, (uint8_t)type, level, (uint8_t)pyramid.channels, (uint8_t)count, first,
+                                   pyramid.samplesPerBucket(level), samplePeriod};
+            memcpy(buffer.data(), &header, sizeof(header));
+            send(to, sizeof(header) + count * pyramid.channels * sizeof(Bucket));
+            return count;
+        }
+
+        void describe(const sockaddr_in& to, float samplePeriod){
+            PacketHeader header = {MAGIC, DESCRIBE, (uint8_t)pyramid.levels, (uint8_t)pyramid.channels, 0,
+                                   (uint32_t)pyramid.capacity, 1, samplePeriod};
+            std::string text;
+            for (const Channel& c : names) text += c.name + " " + c.unit + "\n";
+            size_t size = std::min(buffer.size(), sizeof(header) + text.size());
+            memcpy(buffer.data(), &header, sizeof(header));
+            memcpy(buffer.data() + sizeof(header), text.data(), size - sizeof(header));
+            send(to, size);
+        }
+
+        void send(const sockaddr_in& to, size_t size){
+            if (sendto(fd, buffer.data(), size, MSG_DONTWAIT, (const sockaddr*)&to, sizeof(to)) == (ssize_t)size) {
+                ++datagrams;
+            } else {
+                ++sendErrors; //a full socket buffer drops it, the viewer asks again
+            }
+        }
+
+        const LodPyramid& pyramid;
+        std::vector<Channel> names;
+        const size_t bucketsPerDatagram;
+        std::vector<uint8_t> buffer;
+        int fd = -1;
+        sockaddr_in stream = {};
+        bool streaming = false;
+        bool streamStarted = false;
+        uint32_t streamNext = 0;
+};
+
+} // namespace telemetry
+
+#endif //RASPI_PKG_TELEMETRY_H
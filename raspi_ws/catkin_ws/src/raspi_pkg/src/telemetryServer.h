@@ -0,0 +1,90 @@
+#ifndef RASPI_PKG_TELEMETRY_SERVER_H
+#define RASPI_PKG_TELEMETRY_SERVER_H
+
+#include "ros/ros.h"
+#include <sensor_msgs/JointState.h>
+#include <raspi_pkg/SensorState.h>
+#include <string>
+#include "telemetry.h"
+
+//TelemetryServer keeps /sensors_packed and /torso_command as telemetry.h's min/max pyramid and
+//serves it over UDP, so field engineers plot the wheel from a laptop without subscribing ROS
+//topics over WiFi. It subscribes on the Pi, where the topics cost a local copy; the viewers
+//only ever see the datagrams.
+//
+//Channels, one value per Teensy sample: torso_roll, torso_omega, spoke0, spoke1, torque (the
+//latest /torso_command), dt (ms between the Teensy's stamps, the loop timing) and overrun
+//(1 when the sample's STATUS_OVERRUN bit is set, so a bucket's max shows one in its span).
+//
+//Parameters (private): port (requests, default 9870), stream (multicast group or address of
+//the live stream, "239.255.87.1:9871" by default, empty for none), stream_level (1, buckets
+//of 4 samples at 100 Hz), stream_rate (Hz, 10), levels (8, the coarsest 4^7 samples a
+//bucket), capacity (buckets kept per level, 1024: 10 s of samples at level 0, 46 h at 7).
+
+class TelemetryServer{
+
+    public:
+        static const int CHANNELS = 7;
+
+        TelemetryServer(ros::NodeHandle& nh, ros::NodeHandle& pnh)
+            : pyramid(CHANNELS, clampLevels(pnh.param("levels", 8)), 2, (size_t)std::max(pnh.param("capacity", 1024), 16)),
+              server(pyramid, {{"torso_roll", "rad"}, {"torso_omega", "rad/s"}, {"spoke0", "rad"}, {"spoke1", "rad"},
+                               {"torque", "N*m"}, {"dt", "ms"}, {"overrun", "flag"}}){
+            int port = pnh.param("port", 9870);
+            std::string stream = pnh.param<std::string>("stream", "239.255.87.1:9871");
+            streamLevel = (uint8_t)std::min(std::max(pnh.param("stream_level", 1), 0), pyramid.levels - 1);
+            std::string error;
+            if (!server.open((uint16_t)port, stream, error)) {
+                ROS_ERROR("Telemetry: %s", error.c_str());
+            } else {
+                ROS_INFO("Telemetry on UDP port %d, streaming level %d to %s", port, streamLevel, stream.empty() ? "nowhere" : stream.c_str());
+            }
+            packedSub = nh.subscribe("sensors_packed", 10, &TelemetryServer::packedCb, this, ros::TransportHints().tcpNoDelay());
+            torqueSub = nh.subscribe("torso_command", 1, &TelemetryServer::torqueCb, this, ros::TransportHints().tcpNoDelay());
+            timer = nh.createWallTimer(ros::WallDuration(1.0 / std::max(pnh.param("stream_rate", 10.0), 0.1)), &TelemetryServer::tick, this);
+        }
+
+        void packedCb(const raspi_pkg::SensorState::ConstPtr& msg){
+            float dtMs = NAN;
+            if (samples > 0) {
+                dtMs = (int32_t)(msg->stamp_us - lastStampUs) * 1e-3f;
+                meanPeriod += 0.01f * (dtMs * 1e-3f - meanPeriod);
+            }
+            lastStampUs = msg->stamp_us;
+            ++samples;
+            const float values[CHANNELS] = {msg->torso_roll, msg->torso_omega, msg->spoke_angle[0], msg->spoke_angle[1], torque, dtMs,
+                                            (msg->status & raspi_pkg::SensorState::STATUS_OVERRUN) ? 1.0f : 0.0f};
+            pyramid.add(values);
+        }
+
+        void torqueCb(const sensor_msgs::JointState::ConstPtr& msg){
+            if (!msg->effort.empty())
+                torque = msg->effort[0];
+        }
+
+        void tick(const ros::WallTimerEvent&){
+            server.poll(meanPeriod);
+            server.publish(streamLevel, meanPeriod);
+            ROS_DEBUG_THROTTLE(10.0, "Telemetry: %lu samples, %lu requests (%lu bad), %lu datagrams, %lu send errors",
+                               (unsigned long)samples, (unsigned long)server.requests, (unsigned long)server.badRequests,
+                               (unsigned long)server.datagrams, (unsigned long)server.sendErrors);
+        }
+
+    private:
+        static int clampLevels(int levels){
+            return std::min(std::max(levels, 1), 16); //4^16 samples a bucket would not fit a uint32
+        }
+
+        telemetry::LodPyramid pyramid;
+        telemetry::Server server;
+        ros::Subscriber packedSub;
+        ros::Subscriber torqueSub;
+        ros::WallTimer timer;
+        uint8_t streamLevel = 1;
+        float torque = 0.0f;
+        float meanPeriod = 0.01f;
+        uint32_t lastStampUs = 0;
+        uint64_t samples = 0;
+};
+
+#endif //RASPI_PKG_TELEMETRY_SERVER_H
@@ -0,0 +1,13 @@
+#include "ros/ros.h"
+#include "telemetryServer.h"
+
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "telemetry_server");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+    TelemetryServer server(nh, pnh);
+    ros::spin();
+
+    return 0;
+}
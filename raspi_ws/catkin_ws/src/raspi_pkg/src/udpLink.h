@@ -0,0 +1,148 @@
+#ifndef RASPI_PKG_UDP_LINK_H
+#define RASPI_PKG_UDP_LINK_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+//The datagram and acceptance rules of udp_link (udpLinkNode.cpp), the latest-value transport
+//for /sensors and /torso_command between the Pi and a controller on a base-station PC.
+//
+//Over ROS's TCP a segment lost on WiFi holds back every message behind it until it is
+//resent, so the controller sees a stall and then a burst of old samples. Here each message is
+//one datagram on its own: a lost one is gone, a late one is dropped on arrival if a newer one
+//already came, and nothing ever waits for a retransmission. That is what a controller wants,
+//since only the newest sample (and the newest torque) matters.
+//
+//Each sender stamps its datagrams with a session (its start time) and a sequence number.
+//The receiver takes a datagram only if its sequence is after the last one taken from the same
+//session; a later session (the sender restarted) is taken at once, an earlier one only after
+//sessionTimeoutNs without anything from the current one (the sender's clock was set back).
+//Gaps in the sequence count as lost, datagrams at or before the last as stale. The Acceptor
+//only sees datagrams from the one peer address the node takes (~peer, or the first sender
+//pinned), so a new session is that peer restarting, never another host taking over.
+
+namespace udp_link {
+
+const uint32_t MAGIC = 0x31555752; //"RWU1"
+
+struct Datagram{
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t session;          //ns since the epoch when the sender started
+    int64_t stampNs;           //the message's header.stamp, the sender's clock
+    char frameId[16];          //header.frame_id, the Teensy sample seq the torque answers
+    uint8_t numPosition;
+    uint8_t numVelocity;
+    uint8_t numEffort;
+    uint8_t pad;
+    float values[8];           //position, then velocity, then effort
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Datagram) == 80, "the layout is the protocol");
+
+inline int64_t realtimeNs(){
+    timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+class Acceptor{
+
+    public:
+        explicit Acceptor(int64_t sessionTimeoutNs = 500000000) : sessionTimeoutNs(sessionTimeoutNs) {}
+
+        //Whether to deliver d, received at nowNs (any monotonic clock)
+        bool accept(const Datagram& d, int64_t nowNs){
+            if (started && d.session == session) {
+                int32_t ahead = (int32_t)(d.seq - seq);
+                if (ahead <= 0) {
+                    ++stale;
+                    return false;
+                }
+                lost += ahead - 1;
+            } else if (started && d.session < session && nowNs - lastNs < sessionTimeoutNs) {
+                ++stale; //a datagram of the sender's previous run, still in flight
+                return false;
+            } else {
+                if (started) ++sessions;
+                started = true;
+                session = d.session;
+            }
+            seq = d.seq;
+            lastNs = nowNs;
+            ++accepted;
+            return true;
+        }
+
+        uint64_t accepted = 0;
+        uint64_t stale = 0;
+        uint64_t lost = 0;
+        uint64_t sessions = 0; //restarts of the sender seen
+
+    private:
+        int64_t sessionTimeoutNs;
+        bool started = false;
+        uint64_t session = 0;
+        uint32_t seq = 0;
+        int64_t lastNs = 0;
+};
+
+//"host:port" into addr; false with the reason in error
+inline bool resolve(const std::string& hostPort, sockaddr_in& addr, std::string& error){
+    size_t colon = hostPort.rfind(':');
+    if (colon == std::string::npos) {
+        error = hostPort + " is not host:port";
+        return false;
+    }
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    int err = getaddrinfo(hostPort.substr(0, colon).c_str(), hostPort.c_str() + colon + 1, &hints, &result);
+    if (err != 0 || !result) {
+        error = hostPort + ": " + gai_strerror(err);
+        return false;
+    }
+    memcpy(&addr, result->ai_addr, sizeof(addr));
+    freeaddrinfo(result);
+    return true;
+}
+
+//A UDP socket bound to port, with a receive timeout so the reader can check for shutdown, and
+//the DSCP (46, expedited forwarding) that WiFi's WMM maps to its voice queue; -1 on error
+inline int openSocket(uint16_t port, int dscp, int timeoutMs, std::string& error){
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        error = std::string("socket: ") + strerror(errno);
+        return -1;
+    }
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (bind(fd, (sockaddr*)&local, sizeof(local)) != 0) {
+        error = "bind port " + std::to_string(port) + ": " + strerror(errno);
+        ::close(fd);
+        return -1;
+    }
+    timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int tos = dscp << 2;
+    if (dscp > 0 && setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) != 0) {
+        error = std::string("IP_TOS: ") + strerror(errno); //not fatal, the caller warns
+    }
+    return fd;
+}
+
+} // namespace udp_link
+
+#endif //RASPI_PKG_UDP_LINK_H
@@ -0,0 +1,212 @@
+#include "ros/ros.h"
+#include <sensor_msgs/JointState.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "realtime.h"
+#include "udpLink.h"
+
+//udp_link carries one JointState topic out and another in over UDP (udpLink.h), latest value
+//only. The same node runs at both ends: on the Pi it sends /sensors and publishes the torques
+//that come back on /torso_command for the bridge, on the base station it publishes /sensors
+//for the controller and sends its /torso_command back. The two ends run their own roscores.
+//
+//Parameters (private):
+//  port            local UDP port, 9880
+//  peer            "host:port" of the other end, the only address datagrams are taken from;
+//                  required where /torso_command comes in (send "sensors", the Pi). Empty on
+//                  the base station to answer the first sender taken, which is then pinned:
+//                  datagrams from any other address are refused until the node restarts
+//  send            topic sent, "sensors" (the Pi) or "torso_command" (the base station)
+//  receive         topic published, the other one
+//  restamp         (true) stamp what is published with the receive time here, as the clocks of
+//                  the two ends are not synced; false keeps the sender's stamp
+//  session_timeout s of silence after which a sender's earlier session is taken again, 0.5
+//  dscp            DiffServ code point of the datagrams, 46 (EF, WMM voice); 0 for none
+//and realtime.h's rt_priority (60), cpu_affinity and lock_memory for the receive thread, which
+//publishes each datagram as it comes in.
+
+class UdpLink{
+
+    public:
+        UdpLink(ros::NodeHandle& nh, ros::NodeHandle& pnh){
+            int port = pnh.param("port", 9880);
+            std::string peerAddress = pnh.param<std::string>("peer", "");
+            std::string sendTopic = pnh.param<std::string>("send", "sensors");
+            std::string receiveTopic = pnh.param<std::string>("receive", sendTopic == "sensors" ? "torso_command" : "sensors");
+            restamp = pnh.param("restamp", true);
+            acceptor = udp_link::Acceptor((int64_t)(pnh.param("session_timeout", 0.5) * 1e9));
+            session = (uint64_t)udp_link::realtimeNs();
+
+            std::string error;
+            fd = udp_link::openSocket((uint16_t)port, pnh.param("dscp", 46), 100, error);
+            if (fd < 0) {
+                ROS_ERROR("udp_link: %s", error.c_str());
+                return;
+            }
+            if (!error.empty()) {
+                ROS_WARN("udp_link: %s, sending without a DSCP", error.c_str());
+            }
+            if (!peerAddress.empty()) {
+                if (udp_link::resolve(peerAddress, peer, error)) {
+                    havePeer = true;
+                } else {
+                    ROS_ERROR("udp_link: %s", error.c_str());
+                }
+            }
+            if (!havePeer && receiveTopic == "torso_command") {
+                //anyone on the network could otherwise start a session and drive the motors
+                ROS_ERROR("udp_link: ~peer must be set where %s comes in", receiveTopic.c_str());
+                ::close(fd);
+                fd = -1;
+                return;
+            }
+            ROS_INFO("udp_link: %s out to %s, %s in on port %d", sendTopic.c_str(), peerAddress.empty() ? "the first sender" : peerAddress.c_str(),
+                     receiveTopic.c_str(), port);
+
+            pub = nh.advertise<sensor_msgs::JointState>(receiveTopic, 1);
+            sub = nh.subscribe(sendTopic, 1, &UdpLink::sendCb, this, ros::TransportHints().tcpNoDelay());
+            statsTimer = nh.createWallTimer(ros::WallDuration(60.0), &UdpLink::stats, this);
+
+            rt = realtime::Config::fromParams(pnh, 60);
+            realtime::lockMemory(rt);
+            running = true;
+            receiveThread = std::thread(&UdpLink::receiveLoop, this);
+            realtime::configureThread(receiveThread.native_handle(), rt, "receive thread");
+        }
+
+        ~UdpLink(){
+            running = false;
+            if (receiveThread.joinable()) {
+                receiveThread.join();
+            }
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+
+        //Each message out at once; a full socket buffer drops it, a newer one follows
+        void sendCb(const sensor_msgs::JointState::ConstPtr& msg){
+            sockaddr_in to;
+            {
+                std::lock_guard<std::mutex> lock(peerMutex);
+                if (!havePeer) {
+                    ++unsent;
+                    return;
+                }
+                to = peer;
+            }
+            udp_link::Datagram d = {};
+            d.magic = udp_link::MAGIC;
+            d.seq = ++seq;
+            d.session = session;
+            d.stampNs = (int64_t)msg->header.stamp.toNSec();
+            strncpy(d.frameId, msg->header.frame_id.c_str(), sizeof(d.frameId) - 1);
+            d.numPosition = (uint8_t)std::min<size_t>(msg->position.size(), 4);
+            d.numVelocity = (uint8_t)std::min<size_t>(msg->velocity.size(), 3);
+            d.numEffort = (uint8_t)std::min<size_t>(msg->effort.size(), 8 - d.numPosition - d.numVelocity);
+            float* v = d.values;
+            for (int i = 0; i < d.numPosition; ++i) *v++ = (float)msg->position[i];
+            for (int i = 0; i < d.numVelocity; ++i) *v++ = (float)msg->velocity[i];
+            for (int i = 0; i < d.numEffort; ++i) *v++ = (float)msg->effort[i];
+            if (sendto(fd, &d, sizeof(d), MSG_DONTWAIT, (const sockaddr*)&to, sizeof(to)) == (ssize_t)sizeof(d)) {
+                ++sent;
+            } else {
+                ++sendErrors;
+            }
+        }
+
+    private:
+        void receiveLoop(){
+            if (rt.lockMemory) {
+                realtime::prefaultStack();
+            }
+            sensor_msgs::JointState msg;
+            while (running) {
+                udp_link::Datagram d;
+                sockaddr_in from;
+                socklen_t fromSize = sizeof(from);
+                ssize_t n = recvfrom(fd, &d, sizeof(d), 0, (sockaddr*)&from, &fromSize);
+                if (n < 0) {
+                    continue; //the timeout, to see running
+                }
+                if (n != (ssize_t)sizeof(d) || d.magic != udp_link::MAGIC || d.numPosition + d.numVelocity + d.numEffort > 8) {
+                    ++malformed;
+                    continue;
+                }
+                //only this thread writes peer, so it reads it unlocked
+                if (havePeer && (from.sin_addr.s_addr != peer.sin_addr.s_addr || from.sin_port != peer.sin_port)) {
+                    ++foreign;
+                    continue;
+                }
+                bool taken = acceptor.accept(d, realtime::monotonicNs());
+                accepted = acceptor.accepted;
+                stale = acceptor.stale;
+                lost = acceptor.lost;
+                restarts = acceptor.sessions;
+                if (!taken) {
+                    continue;
+                }
+                if (!havePeer) {
+                    std::lock_guard<std::mutex> lock(peerMutex);
+                    peer = from;
+                    havePeer = true;
+                    ROS_INFO("udp_link: peer %s:%u", inet_ntoa(from.sin_addr), (unsigned)ntohs(from.sin_port));
+                }
+                if (restamp) {
+                    msg.header.stamp = ros::Time::now();
+                } else {
+                    msg.header.stamp.fromNSec((uint64_t)d.stampNs);
+                }
+                msg.header.frame_id.assign(d.frameId, strnlen(d.frameId, sizeof(d.frameId)));
+                const float* v = d.values;
+                msg.position.assign(v, v + d.numPosition);
+                v += d.numPosition;
+                msg.velocity.assign(v, v + d.numVelocity);
+                v += d.numVelocity;
+                msg.effort.assign(v, v + d.numEffort);
+                pub.publish(msg);
+            }
+        }
+
+        void stats(const ros::WallTimerEvent&){
+            ROS_INFO("udp_link: sent %lu (%lu errors, %lu with no peer), taken %lu, stale %lu, lost %lu, malformed %lu, "
+                     "not from the peer %lu, sender restarts %lu",
+                 (unsigned long)sent, (unsigned long)sendErrors, (unsigned long)unsent, (unsigned long)accepted.load(),
+                 (unsigned long)stale.load(), (unsigned long)lost.load(), (unsigned long)malformed.load(),
+                 (unsigned long)foreign.load(), (unsigned long)restarts.load());
+        }
+
+        ros::Publisher pub;
+        ros::Subscriber sub;
+        ros::WallTimer statsTimer;
+        realtime::Config rt;
+        int fd = -1;
+        std::mutex peerMutex; //the receive thread learns the peer, the callback sends to it
+        sockaddr_in peer = {};
+        bool havePeer = false; //once set, for good
+        bool restamp = true;
+        uint64_t session = 0;
+        uint32_t seq = 0;
+        uint64_t sent = 0;
+        uint64_t sendErrors = 0;
+        uint64_t unsent = 0;
+        udp_link::Acceptor acceptor; //the receive thread's, its counters copied out for stats()
+        std::atomic<uint64_t> accepted{0}, stale{0}, lost{0}, restarts{0}, malformed{0}, foreign{0};
+        std::thread receiveThread;
+        std::atomic<bool> running{false};
+};
+
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "udp_link");
+    ros::NodeHandle nh;
+    ros::NodeHandle pnh("~");
+    UdpLink link(nh, pnh);
+    ros::spin();
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#ifndef RASPI_PKG_WEIGHT_FILE_H
+#define RASPI_PKG_WEIGHT_FILE_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <NeuralPBC.h>
+
+//WeightFile maps a network's flat binary weights, the <name>.pbcw exportWeights.py writes next to
+//each header, so pbc_controller starts on new weights in the time of an mmap and a checksum,
+//without a rebuild or Julia's Pkg.activate / BSON.load. The architecture stays compile-time:
+//open() checks the file's widths, parameter count and posterior sample count against the
+//pbc::Chain the controller was built with, and a file for another shape is refused, so a
+//retrained network of the same widths is a file copy and another architecture a recompile.
+//
+//Layout, little-endian: Header at 0, then at dataOffset num_params floats (one network), or
+//for a Bayesian network the posterior mean's num_params followed by num_params*num_samples
+//samples, parameter-major as PosteriorBank::load() takes them. The mapping is read-only and
+//populated at open(), so the control loop takes no page fault on it. exportWeights.py replaces
+//a file by renaming a new one over it, which leaves a running controller on the old inode; a
+//file truncated in place under the mapping would fault it instead. It is unmapped with the
+//WeightFile, which must outlive the controllers reading it.
+
+namespace weight_file {
+
+struct Header{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t numWidths;
+    uint16_t widths[8]; //FastChain widths, input to output, the rest 0
+    uint32_t numParams; //per network, with the gains
+    uint32_t numSamples; //0 for one network
+    uint32_t dataOffset;
+    uint32_t checksum; //FNV-1a of the data
+    char name[24];
+    static const uint32_t MAGIC = 0x31574250; //"PBW1"
+    static const uint16_t VERSION = 1;
+};
+
+static_assert(sizeof(Header) == 64, "the header layout is exportWeights.py's");
+
+inline uint32_t fnv1a(const uint8_t* data, size_t size){
+    uint32_t h = 0x811C9DC5u;
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ data[i]) * 0x01000193u;
+    }
+    return h;
+}
+
+class WeightFile{
+    public:
+        WeightFile() = default;
+        WeightFile(const WeightFile&) = delete;
+        WeightFile& operator=(const WeightFile&) = delete;
+        ~WeightFile(){ close(); }
+
+        //Maps path and checks it against Chain with numSamples posterior samples (0 for one
+        //network); false with the reason in error if it cannot be used
+        template<class Chain>
+        bool open(const std::string& path, int numSamples, std::string& error){
+            close();
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                error = path + ": " + strerror(errno);
+                return false;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+                error = path + ": shorter than a weight file header";
+                ::close(fd);
+                return false;
+            }
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            ::close(fd); //the mapping outlives the fd
+            if (p == MAP_FAILED) {
+                error = "mmap " + path + ": " + strerror(errno);
+                return false;
+            }
+            map = p;
+            mapSize = st.st_size;
+            if (!validate<Chain>(path, numSamples, error)) {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        void close(){
+            if (map) {
+                munmap(map, mapSize);
+            }
+            map = nullptr;
+            mapSize = 0;
+        }
+
+        bool isOpen() const{ return map != nullptr; }
+        const Header& header() const{ return *static_cast<const Header*>(map); }
+
+        //The network's parameters, or the posterior mean
+        const float* params() const{
+            return reinterpret_cast<const float*>(static_cast<const uint8_t*>(map) + header().dataOffset);
+        }
+
+        //The posterior samples, parameter-major, after the mean
+        const float* samples() const{ return params() + header().numParams; }
+
+    private:
+        template<class Chain>
+        bool validate(const std::string& path, int numSamples, std::string& error) const{
+            const Header& h = header();
+            if (h.magic != Header::MAGIC) {
+                error = path + ": not a weight file";
+                return false;
+            }
+            if (h.version != Header::VERSION) {
+                error = path + ": weight file version " + std::to_string(h.version) + ", this build reads "
+                        + std::to_string(Header::VERSION);
+                return false;
+            }
+            uint16_t widths[Chain::num_widths];
+            Chain::widths(widths);
+            bool same = h.numWidths == Chain::num_widths;
+            for (int i = 0; same && i < Chain::num_widths; ++i) {
+                same = h.widths[i] == widths[i];
+            }
+            if (!same) {
+                error = path + ": widths " + describe(h.widths, h.numWidths < 8 ? h.numWidths : 8) + ", this build is "
+                        + describe(widths, Chain::num_widths);
+                return false;
+            }
+            const uint32_t numParams = Chain::num_params + pbc::num_features;
+            if (h.numParams != numParams || h.numSamples != (uint32_t)numSamples) {
+                error = path + ": " + std::to_string(h.numParams) + " parameters and " + std::to_string(h.numSamples)
+                        + " samples, this build needs " + std::to_string(numParams) + " and " + std::to_string(numSamples);
+                return false;
+            }
+            //the floats must be aligned in the page-aligned mapping and inside the file
+            const uint64_t bytes = (uint64_t)numParams * (1 + (uint64_t)numSamples) * sizeof(float);
+            if (h.dataOffset < sizeof(Header) || h.dataOffset % sizeof(float) != 0 || h.dataOffset + bytes > mapSize) {
+                error = path + ": truncated, or the data is not where the header says";
+                return false;
+            }
+            if (fnv1a(static_cast<const uint8_t*>(map) + h.dataOffset, bytes) != h.checksum) {
+                error = path + ": checksum mismatch, the file is damaged";
+                return false;
+            }
+            return true;
+        }
+
+        template<class T>
+        static std::string describe(const T* widths, int n){
+            std::string s;
+            for (int i = 0; i < n; ++i) {
+                s += (i ? "-" : "") + std::to_string(widths[i]);
+            }
+            return s;
+        }
+
+        void* map = nullptr;
+        size_t mapSize = 0;
+};
+
+} // namespace weight_file
+
+#endif //RASPI_PKG_WEIGHT_FILE_H
@@ -0,0 +1,101 @@
+#ifndef RASPI_PKG_YAW_TRACKER_H
+#define RASPI_PKG_YAW_TRACKER_H
+
+#include <cmath>
+#include <cstdint>
+
+//YawTracker follows the wheel's heading from the yaw of each /sensors sample (position[3]) in
+//O(1) per sample and no history: the yaw is unwrapped into a continuous heading, and the yaw
+//rate is the slope of a least-squares line through the heading, weighted exp(-age/tau). The
+//five sums of that regression are kept relative to the newest sample, so advancing them by one
+//sample is a decay and a shift, and they stay well conditioned however long the run and however
+//far the wheel has turned. Samples come at any spacing; a gap longer than resetGap (or time
+//going backwards) starts the window again.
+//
+//turning() is |yaw rate| above onRate, held until it falls below offRate, so noise on the yaw
+//does not make it chatter. One writer calls update(); the accessors are for the same thread.
+
+class YawTracker{
+
+    public:
+        explicit YawTracker(double tau = 0.2, double onRate = 0.3, double offRate = 0.15, double resetGap = 0.5)
+            : tau(tau), onRate(onRate), offRate(offRate), resetGap(resetGap) {}
+
+        //yaw in rad, wrapped or not; tNs the sample's time
+        void update(int64_t tNs, float yaw){
+            if (count == 0) {
+                restart(tNs, yaw);
+                return;
+            }
+            double dt = (tNs - lastNs) * 1e-9;
+            if (dt <= 0.0 || dt > resetGap) {
+                restart(tNs, yaw);
+                return;
+            }
+            double dy = wrap(yaw - lastYaw);
+            lastYaw = yaw;
+            lastNs = tNs;
+            heading_ += dy;
+
+            //t and y of the older samples, relative to this one: t -= dt, y -= dy
+            double decay = std::exp(-dt / tau);
+            sty = decay * (sty - dt * sy - dy * st + dt * dy * s0);
+            stt = decay * (stt - 2.0 * dt * st + dt * dt * s0);
+            st = decay * (st - dt * s0);
+            sy = decay * (sy - dy * s0);
+            s0 = decay * s0;
+            //and the new sample at t = y = 0
+            s0 += 1.0;
+            ++count;
+
+            //det / s0^2 is the weighted variance of the sample times, here at least (0.1 ms)^2
+            double det = s0 * stt - st * st;
+            if (count >= 3 && det > 1e-8 * s0 * s0) {
+                rate = (s0 * sty - st * sy) / det;
+                smoothed = heading_ + (sy - rate * st) / s0;
+            } else {
+                rate = dy / dt;
+                smoothed = heading_;
+            }
+            double r = std::fabs(rate);
+            if (r > onRate) turning_ = true;
+            else if (r < offRate) turning_ = false;
+        }
+
+        //The unwrapped heading since the first sample, rad
+        double heading() const{ return heading_; }
+        //The heading the regression puts at the newest sample, less noisy than heading()
+        double smoothedHeading() const{ return smoothed; }
+        //rad/s, positive for growing yaw
+        double yawRate() const{ return rate; }
+        bool turning() const{ return turning_; }
+
+    private:
+        static double wrap(double a){
+            return std::remainder(a, 2.0 * M_PI);
+        }
+
+        void restart(int64_t tNs, float yaw){
+            //the heading carries on across a restart, only the regression forgets
+            lastNs = tNs;
+            lastYaw = yaw;
+            s0 = 1.0;
+            st = sy = stt = sty = 0.0;
+            count = 1;
+            rate = 0.0;
+            smoothed = heading_;
+            turning_ = false;
+        }
+
+        double tau, onRate, offRate, resetGap;
+        int64_t lastNs = 0;
+        float lastYaw = 0.0f;
+        uint32_t count = 0;
+        double s0 = 0.0, st = 0.0, sy = 0.0, stt = 0.0, sty = 0.0;
+        double heading_ = 0.0;
+        double smoothed = 0.0;
+        double rate = 0.0;
+        bool turning_ = false;
+};
+
+#endif //RASPI_PKG_YAW_TRACKER_H
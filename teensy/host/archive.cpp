@@ -0,0 +1,227 @@
+/* archive: packs recorded runs into run archives (archive.h) and reads
+* windows of them back, so a few seconds around an impact or an E-stop of a
+* long run are at hand without parsing the whole log.
+*
+*     archive pack [--chunk n] [--raw] RUN.bson|FLIGHTnn.BIN OUT.rwa
+*     archive info RUN.rwa
+*     archive events RUN.rwa [impact|estop_on|estop_off|odrive_errors|controller]
+*     archive dump RUN.rwa [--from s | --event kind [n]] [--seconds s] [--channels a,b,...]
+*
+* pack writes chunks of --chunk samples (4096 by default), with the stamps
+* delta-coded unless --raw, and the run's event index: the flight log's own,
+* or the one runs::findEvents() finds in a hardware_data run or a version 2
+* log. info prints the index as "key value" lines and
+* each channel's bytes and encodings; events lists the indexed events, of one
+* kind if given. dump writes samples as CSV from --from seconds into the run,
+* or from the n-th (0 by default) event of a kind, for --seconds (1 by
+* default) and the channels named (all by default).
+*/
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "archive.h"
+#include "runs.h"
+
+namespace {
+
+int usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s pack [--chunk n] [--raw] RUN.bson|FLIGHTnn.BIN OUT.rwa\n"
+            "       %s info RUN.rwa\n"
+            "       %s events RUN.rwa [impact|estop_on|estop_off|odrive_errors|controller]\n"
+            "       %s dump RUN.rwa [--from s | --event kind [n]] [--seconds s] [--channels a,b,...]\n",
+            argv0, argv0, argv0, argv0);
+    return 2;
+}
+
+const char* encodingName(int e) {
+    return e == archive::CONSTANT ? "constant" : e == archive::DELTA16 ? "delta16" : "raw";
+}
+
+int pack(int argc, char** argv) {
+    uint32_t chunk = 4096;
+    bool delta = true;
+    std::vector<const char*> paths;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) chunk = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--raw") == 0) delta = false;
+        else if (argv[i][0] == '-') return usage(argv[0]);
+        else paths.push_back(argv[i]);
+    }
+    if (paths.size() != 2 || chunk == 0) return usage(argv[0]);
+
+    std::vector<uint8_t> bytes;
+    std::vector<runs::Sample> samples;
+    std::vector<runs::Event> events;
+    if (!runs::readFile(paths[0], bytes)) {
+        perror(paths[0]);
+        return 1;
+    }
+    uint32_t period_us = runs::bson_period_us;
+    FlightLogHeader header;
+    if (runs::loadFlightLog(bytes, samples, &events)) {
+        memcpy(&header, bytes.data(), sizeof(header));
+        period_us = header.period_us;
+    } else if (runs::loadBson(bytes, samples)) {
+        events = runs::findEvents(samples);
+    } else {
+        fprintf(stderr, "%s: not a flight log or hardware_data BSON\n", paths[0]);
+        return 1;
+    }
+    if (!archive::write(paths[1], samples, events, period_us, chunk, delta)) {
+        perror(paths[1]);
+        return 1;
+    }
+    archive::Reader reader;
+    if (!reader.open(paths[1])) {
+        fprintf(stderr, "%s: written but unreadable\n", paths[1]);
+        return 1;
+    }
+    printf("samples %u\n", reader.samples());
+    printf("input_bytes %zu\n", bytes.size());
+    printf("archive_bytes %zu\n", reader.bytes());
+    printf("chunks %u\n", reader.numChunks());
+    printf("events %u\n", reader.numEvents());
+    return 0;
+}
+
+int info(archive::Reader& run) {
+    printf("samples %u\n", run.samples());
+    printf("period_us %u\n", run.period_us());
+    printf("imu %d\n", run.imu() ? 1 : 0);
+    printf("bytes %zu\n", run.bytes());
+    printf("chunks %u\n", run.numChunks());
+    if (run.samples() > 0)
+        printf("duration_s %.3f\n",
+               (run.chunk(run.numChunks() - 1).last_stamp_us - run.chunk(0).first_stamp_us) * 1e-6);
+    uint32_t counts[FlightEvent::LINK_MODE + 1] = {};
+    for (uint32_t i = 0; i < run.numEvents(); ++i)
+        if (run.events()[i].kind <= FlightEvent::LINK_MODE) ++counts[run.events()[i].kind];
+    for (int k = FlightEvent::IMPACT; k <= FlightEvent::LINK_MODE; ++k)
+        printf("events_%s %u\n", runs::eventName(k), counts[k]);
+    printf("%-12s %10s %9s %8s %8s\n", "channel", "bytes", encodingName(archive::RAW), encodingName(archive::CONSTANT),
+           encodingName(archive::DELTA16));
+    for (int c = 0; c < archive::num_channels; ++c) {
+        uint64_t bytes = 0;
+        uint32_t n[3] = {};
+        for (uint32_t k = 0; k < run.numChunks(); ++k) {
+            const archive::Column& col = run.chunk(k).columns[c];
+            bytes += col.bytes;
+            ++n[col.encoding];
+        }
+        printf("%-12s %10lu %9u %8u %8u\n", archive::channelName(c), (unsigned long)bytes, n[archive::RAW],
+               n[archive::CONSTANT], n[archive::DELTA16]);
+    }
+    return 0;
+}
+
+int events(archive::Reader& run, int kind) {
+    printf("sample,stamp_us,event,value\n");
+    for (uint32_t i = 0; i < run.numEvents(); ++i) {
+        const archive::Event& e = run.events()[i];
+        if (kind == 0 || e.kind == kind) printf("%u,%u,%s,%u\n", e.sample, e.stamp_us, runs::eventName(e.kind), e.value);
+    }
+    return 0;
+}
+
+int dump(archive::Reader& run, int argc, char** argv) {
+    double from = 0.0, seconds = 1.0;
+    int kind = 0;
+    uint32_t nth = 0;
+    std::vector<int> channels;
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) from = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--event") == 0 && i + 1 < argc) {
+            kind = runs::findEventKind(argv[++i]);
+            if (kind == 0) return usage(argv[0]);
+            if (i + 1 < argc && argv[i + 1][0] != '-') nth = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            std::string list = argv[++i];
+            for (size_t at = 0; at <= list.size();) {
+                size_t comma = list.find(',', at);
+                if (comma == std::string::npos) comma = list.size();
+                const int c = archive::findChannel(list.substr(at, comma - at).c_str());
+                if (c == archive::num_channels) {
+                    fprintf(stderr, "unknown channel %s\n", list.substr(at, comma - at).c_str());
+                    return 2;
+                }
+                channels.push_back(c);
+                at = comma + 1;
+            }
+        } else return usage(argv[0]);
+    }
+    if (channels.empty())
+        for (int c = 0; c < archive::num_channels; ++c) channels.push_back(c);
+    if (run.samples() == 0) return 0;
+
+    uint32_t first;
+    const uint32_t start_us = run.chunk(0).first_stamp_us;
+    if (kind != 0) {
+        uint32_t seen = 0;
+        first = run.samples();
+        for (uint32_t i = 0; i < run.numEvents() && first == run.samples(); ++i)
+            if (run.events()[i].kind == kind && seen++ == nth) first = run.events()[i].sample;
+        if (first == run.samples()) {
+            fprintf(stderr, "no %s event %u\n", runs::eventName(kind), nth);
+            return 1;
+        }
+    } else {
+        first = run.seek(start_us + (uint32_t)llround(from * 1e6));
+    }
+    uint32_t firstStamp;
+    run.read(archive::STAMP, first, 1, &firstStamp);
+    const uint32_t end = run.seek(firstStamp + (uint32_t)llround(seconds * 1e6));
+    const uint32_t n = end > first ? end - first : 0;
+
+    // one column per channel, read straight from the chunks that hold the window
+    std::vector<std::vector<double>> columns(channels.size(), std::vector<double>(n));
+    std::vector<float> f(n);
+    std::vector<uint32_t> u(n);
+    for (size_t j = 0; j < channels.size(); ++j) {
+        const int c = channels[j];
+        if (archive::channelType(c) == archive::F32) {
+            run.read(c, first, n, f.data());
+            for (uint32_t i = 0; i < n; ++i) columns[j][i] = f[i];
+        } else {
+            run.read(c, first, n, u.data());
+            for (uint32_t i = 0; i < n; ++i) columns[j][i] = u[i];
+        }
+    }
+    printf("sample");
+    for (int c : channels) printf(",%s", archive::channelName(c));
+    printf("\n");
+    for (uint32_t i = 0; i < n; ++i) {
+        printf("%u", first + i);
+        for (size_t j = 0; j < channels.size(); ++j)
+            printf(archive::channelType(channels[j]) == archive::F32 ? ",%.9g" : ",%.0f", columns[j][i]);
+        printf("\n");
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) return usage(argv[0]);
+    const char* command = argv[1];
+    if (strcmp(command, "pack") == 0) return pack(argc, argv);
+
+    archive::Reader run;
+    if (!run.open(argv[2])) {
+        fprintf(stderr, "%s: not a run archive\n", argv[2]);
+        return 1;
+    }
+    if (strcmp(command, "info") == 0 && argc == 3) return info(run);
+    if (strcmp(command, "events") == 0 && argc <= 4) {
+        const int kind = argc == 4 ? runs::findEventKind(argv[3]) : 0;
+        if (argc == 4 && kind == 0) return usage(argv[0]);
+        return events(run, kind);
+    }
+    if (strcmp(command, "dump") == 0) return dump(run, argc, argv);
+    return usage(argv[0]);
+}
@@ -0,0 +1,464 @@
+#ifndef HOST_ARCHIVE_H
+#define HOST_ARCHIVE_H
+
+/* Run archives (.rwa): a recorded run as per-channel columns in chunks, with
+* a time and event index at the end, for tools that look at a few seconds of
+* a long run. A hardware_data .bson or a flight log has to be parsed front to
+* back before any sample is found; an archive is memory-mapped, the footer
+* says where every chunk of every channel lies, and a read decodes only the
+* chunks and channels it asks for.
+*
+* Layout, little-endian, every section 8-byte aligned:
+*
+*     Header
+*     chunk 0: column of channel 0, column of channel 1, ...
+*     chunk 1: ...
+*     Chunk[chunks]       time index: first sample, first and last stamp
+*                         and where each column is and how it is encoded
+*     Event[events]       the run's event index (runs.h): impacts, E-stop
+*                         edges, ODrive error changes and controller swaps,
+*                         by sample and stamp
+*     Trailer             footer offset, counts and the magic again, so a
+*                         reader finds the index from the end of the file
+*
+* A column is RAW (the values back to back), CONSTANT (one value, for the
+* channels a run never changes: a .bson's NaN torque and IMU, the status of
+* a clean run) or, for the stamps, DELTA16 (the first stamp, then each tick's
+* difference from the header's period as an int16, an eighth of RAW for a
+* tick that keeps its rate). Chunks fall back to RAW where a delta does not
+* fit. The values are stored exactly, so a run read back is the run written.
+*
+*     archive::Reader run;
+*     run.open("d_gain_1_4.rwa");
+*     uint32_t at = run.events()[0].sample;     // the first event
+*     std::vector<float> roll(100);
+*     run.read(archive::ROLL, at, 100, roll.data());
+*
+* archive.cpp packs runs into archives and dumps windows of them as CSV.
+*/
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "runs.h"
+
+namespace archive {
+
+enum Channel : uint8_t {
+    STAMP, ROLL, ROLL_RATE, YAW, SPOKE0, SPOKE1, SPOKE0_RATE, SPOKE1_RATE,
+    GYRO_X, GYRO_Y, GYRO_Z, ACCEL_X, ACCEL_Y, ACCEL_Z, TORQUE, STATUS, ERRORS,
+    num_channels
+};
+
+enum Type : uint8_t { F32, U32, U8 };
+enum Encoding : uint8_t { RAW, CONSTANT, DELTA16 };
+
+inline const char* channelName(int c) {
+    static const char* const names[num_channels] = {
+        "stamp_us", "roll", "roll_rate", "yaw", "spoke0", "spoke1", "spoke0_rate", "spoke1_rate",
+        "gyro_x", "gyro_y", "gyro_z", "accel_x", "accel_y", "accel_z", "torque", "status", "errors"};
+    return names[c];
+}
+inline Type channelType(int c) { return c == STAMP ? U32 : c >= STATUS ? U8 : F32; }
+inline size_t typeBytes(Type t) { return t == U8 ? 1 : 4; }
+
+// The channel called name, or num_channels
+inline int findChannel(const char* name) {
+    for (int c = 0; c < num_channels; ++c)
+        if (strcmp(channelName(c), name) == 0) return c;
+    return num_channels;
+}
+
+struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t channels;           // num_channels
+    uint8_t imu;                // gyro and accel were recorded
+    uint32_t chunk_samples;
+    uint32_t period_us;
+    static constexpr uint32_t MAGIC = 0x31415752; // "RWA1"
+    static constexpr uint16_t VERSION = 1;
+};
+
+struct Column {
+    uint64_t offset;            // from the start of the file
+    uint32_t bytes;
+    uint8_t encoding;
+    uint8_t pad[3];
+};
+
+struct Chunk {
+    uint32_t first_sample;
+    uint32_t samples;
+    uint32_t first_stamp_us;
+    uint32_t last_stamp_us;
+    Column columns[num_channels];
+};
+
+struct Event {
+    uint32_t sample;
+    uint32_t stamp_us;
+    uint8_t kind;               // FlightEvent::Kind
+    uint8_t pad;
+    uint16_t value;
+    uint32_t reserved;
+};
+
+struct Trailer {
+    uint64_t footer_offset;
+    uint32_t chunks;
+    uint32_t events;
+    uint32_t samples;
+    uint32_t magic;
+};
+
+static_assert(sizeof(Header) == 16 && sizeof(Column) == 16 && sizeof(Event) == 16 && sizeof(Trailer) == 24,
+              "the archive layout is part of the format");
+
+// The stored bits of channel c of x; floats by their bit pattern
+inline uint32_t valueBits(const runs::Sample& x, int c) {
+    float f;
+    switch (c) {
+        case STAMP: return x.stamp_us;
+        case STATUS: return x.status;
+        case ERRORS: return x.errors;
+        case ROLL: f = x.roll; break;
+        case ROLL_RATE: f = x.rollRate; break;
+        case YAW: f = x.yaw; break;
+        case SPOKE0: f = x.spoke[0]; break;
+        case SPOKE1: f = x.spoke[1]; break;
+        case SPOKE0_RATE: f = x.spokeRate[0]; break;
+        case SPOKE1_RATE: f = x.spokeRate[1]; break;
+        case GYRO_X: case GYRO_Y: case GYRO_Z: f = x.imu ? x.gyro[c - GYRO_X] : NAN; break;
+        case ACCEL_X: case ACCEL_Y: case ACCEL_Z: f = x.imu ? x.accel[c - ACCEL_X] : NAN; break;
+        default: f = x.torque; break;
+    }
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    return bits;
+}
+
+inline float bitsFloat(uint32_t bits) { float f; memcpy(&f, &bits, 4); return f; }
+
+// Appends one column of samples [first, first + n) to out, with its encoding
+inline Column encode(const std::vector<runs::Sample>& samples, size_t first, size_t n, int c, uint32_t period_us,
+                     bool delta, std::vector<uint8_t>& out) {
+    Column col = {};
+    col.offset = out.size();
+    const Type type = channelType(c);
+    const size_t size = typeBytes(type);
+    const uint32_t v0 = valueBits(samples[first], c);
+    bool constant = true, fits = delta && c == STAMP;
+    for (size_t i = first + 1; i < first + n; ++i) {
+        const uint32_t v = valueBits(samples[i], c);
+        constant = constant && v == v0;
+        const int64_t d = (int64_t)v - valueBits(samples[i - 1], c) - period_us;
+        fits = fits && d >= INT16_MIN && d <= INT16_MAX;
+    }
+    auto put = [&out](const void* p, size_t bytes) {
+        out.insert(out.end(), (const uint8_t*)p, (const uint8_t*)p + bytes);
+    };
+    if (constant) {
+        col.encoding = CONSTANT;
+        put(&v0, size);
+    } else if (fits) {
+        col.encoding = DELTA16;
+        put(&v0, 4);
+        for (size_t i = first + 1; i < first + n; ++i) {
+            const int16_t d = (int16_t)((int64_t)valueBits(samples[i], c) - valueBits(samples[i - 1], c) - period_us);
+            put(&d, 2);
+        }
+    } else {
+        col.encoding = RAW;
+        for (size_t i = first; i < first + n; ++i) {
+            const uint32_t v = valueBits(samples[i], c);
+            put(&v, size);
+        }
+    }
+    col.bytes = (uint32_t)(out.size() - col.offset);
+    out.resize((out.size() + 7) & ~size_t(7));
+    return col;
+}
+
+// Writes samples and their events as an archive of chunk_samples per chunk; delta off stores
+// the stamps RAW
+inline bool write(const char* path, const std::vector<runs::Sample>& samples, const std::vector<runs::Event>& index,
+                  uint32_t period_us, uint32_t chunk_samples = 4096, bool delta = true) {
+    if (samples.empty() || chunk_samples == 0) return false;
+    std::vector<uint8_t> out(sizeof(Header));
+    Header header = {Header::MAGIC, Header::VERSION, num_channels, (uint8_t)samples[0].imu, chunk_samples, period_us};
+    memcpy(out.data(), &header, sizeof(header));
+    out.resize((out.size() + 7) & ~size_t(7));
+
+    std::vector<Chunk> chunks;
+    for (size_t first = 0; first < samples.size(); first += chunk_samples) {
+        const size_t n = std::min<size_t>(chunk_samples, samples.size() - first);
+        Chunk chunk = {};
+        chunk.first_sample = (uint32_t)first;
+        chunk.samples = (uint32_t)n;
+        chunk.first_stamp_us = samples[first].stamp_us;
+        chunk.last_stamp_us = samples[first + n - 1].stamp_us;
+        for (int c = 0; c < num_channels; ++c)
+            chunk.columns[c] = encode(samples, first, n, c, period_us, delta, out);
+        chunks.push_back(chunk);
+    }
+    std::vector<Event> events;
+    for (const runs::Event& e : index) {
+        Event stored = {};
+        stored.sample = e.sample;
+        stored.stamp_us = e.stamp_us;
+        stored.kind = e.kind;
+        stored.value = e.value;
+        events.push_back(stored);
+    }
+    Trailer trailer = {out.size(), (uint32_t)chunks.size(), (uint32_t)events.size(), (uint32_t)samples.size(), Header::MAGIC};
+    const uint8_t* c = (const uint8_t*)chunks.data();
+    out.insert(out.end(), c, c + chunks.size()*sizeof(Chunk));
+    const uint8_t* e = (const uint8_t*)events.data();
+    out.insert(out.end(), e, e + events.size()*sizeof(Event));
+    const uint8_t* t = (const uint8_t*)&trailer;
+    out.insert(out.end(), t, t + sizeof(trailer));
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    const bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    return fclose(f) == 0 && ok;
+}
+
+// A memory-mapped archive, or one already in memory
+class Reader {
+public:
+    Reader() {}
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    ~Reader() { close(); }
+
+    bool open(const char* path) {
+        close();
+        const int fd = ::open(path, O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0 || info.st_size <= 0) {
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        mapped_ = true;
+        if (!attach((const uint8_t*)p, info.st_size)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // Reads the archive in bytes, which must outlive the reader
+    bool attach(const uint8_t* bytes, size_t size) {
+        base_ = bytes;
+        size_ = size;
+        if (size < sizeof(Header) + sizeof(Trailer)) return false;
+        memcpy(&header_, bytes, sizeof(header_));
+        memcpy(&trailer_, bytes + size - sizeof(Trailer), sizeof(trailer_));
+        if (header_.magic != Header::MAGIC || header_.version != Header::VERSION || header_.channels != num_channels
+            || trailer_.magic != Header::MAGIC)
+            return false;
+        const uint64_t end = trailer_.footer_offset + (uint64_t)trailer_.chunks*sizeof(Chunk) + (uint64_t)trailer_.events*sizeof(Event);
+        if (end + sizeof(Trailer) != size) return false;
+        chunks_ = (const Chunk*)(bytes + trailer_.footer_offset);
+        events_ = (const Event*)(bytes + trailer_.footer_offset + trailer_.chunks*sizeof(Chunk));
+        for (uint32_t k = 0; k < trailer_.chunks; ++k)
+            for (int c = 0; c < num_channels; ++c)
+                if (chunks_[k].columns[c].offset + chunks_[k].columns[c].bytes > trailer_.footer_offset) return false;
+        return true;
+    }
+
+    void close() {
+        if (mapped_ && base_) munmap(const_cast<uint8_t*>(base_), size_);
+        mapped_ = false;
+        base_ = nullptr;
+        size_ = 0;
+    }
+
+    uint32_t samples() const { return trailer_.samples; }
+    uint32_t period_us() const { return header_.period_us; }
+    bool imu() const { return header_.imu != 0; }
+    size_t bytes() const { return size_; }
+    uint32_t numChunks() const { return trailer_.chunks; }
+    const Chunk& chunk(uint32_t k) const { return chunks_[k]; }
+    uint32_t numEvents() const { return trailer_.events; }
+    const Event* events() const { return events_; }
+    // The event index as the other run formats load it
+    void events(std::vector<runs::Event>& out) const {
+        for (uint32_t i = 0; i < trailer_.events; ++i)
+            out.push_back({events_[i].sample, events_[i].stamp_us, events_[i].kind, events_[i].value});
+    }
+
+    // The first sample stamped at or after stamp_us (stamps rise through a run)
+    uint32_t seek(uint32_t stamp_us) const {
+        const Chunk* end = chunks_ + trailer_.chunks;
+        const Chunk* k = std::lower_bound(chunks_, end, stamp_us,
+                                          [](const Chunk& c, uint32_t t) { return c.last_stamp_us < t; });
+        if (k == end) return samples();
+        std::vector<uint32_t> stamps(k->samples);
+        decode(*k, STAMP, 0, k->samples, stamps.data());
+        return k->first_sample + (uint32_t)(std::lower_bound(stamps.begin(), stamps.end(), stamp_us) - stamps.begin());
+    }
+
+    // Channel c of samples [first, first + n) into out, as T (float, or uint32_t for the stamps
+    // and bits); only the chunks holding them are decoded
+    template<class T>
+    void read(int c, uint32_t first, uint32_t n, T* out) const {
+        if (first >= samples()) return;
+        n = std::min(n, samples() - first);
+        uint32_t k = first / header_.chunk_samples;
+        while (n > 0) {
+            const Chunk& chunk = chunks_[k++];
+            const uint32_t from = first - chunk.first_sample, count = std::min(n, chunk.samples - from);
+            decode(chunk, c, from, count, out);
+            out += count;
+            first += count;
+            n -= count;
+        }
+    }
+
+    // Samples [first, first + n) in full, as the other run formats load
+    void load(uint32_t first, uint32_t n, std::vector<runs::Sample>& out) const {
+        if (first >= samples()) return;
+        n = std::min(n, samples() - first);
+        std::vector<float> f(n);
+        std::vector<uint32_t> u(n);
+        const size_t at = out.size();
+        out.resize(at + n);
+        runs::Sample* x = &out[at];
+        read(STAMP, first, n, u.data());
+        for (uint32_t i = 0; i < n; ++i) x[i].stamp_us = u[i], x[i].imu = imu();
+        read(STATUS, first, n, u.data());
+        for (uint32_t i = 0; i < n; ++i) x[i].status = (uint8_t)u[i];
+        read(ERRORS, first, n, u.data());
+        for (uint32_t i = 0; i < n; ++i) x[i].errors = (uint8_t)u[i];
+        float runs::Sample::* const scalar[] = {&runs::Sample::roll, &runs::Sample::rollRate, &runs::Sample::yaw,
+                                                &runs::Sample::torque};
+        const int scalarChannel[] = {ROLL, ROLL_RATE, YAW, TORQUE};
+        for (int j = 0; j < 4; ++j) {
+            read(scalarChannel[j], first, n, f.data());
+            for (uint32_t i = 0; i < n; ++i) x[i].*scalar[j] = f[i];
+        }
+        for (int j = 0; j < 2; ++j) {
+            read(SPOKE0 + j, first, n, f.data());
+            for (uint32_t i = 0; i < n; ++i) x[i].spoke[j] = f[i];
+            read(SPOKE0_RATE + j, first, n, f.data());
+            for (uint32_t i = 0; i < n; ++i) x[i].spokeRate[j] = f[i];
+        }
+        for (int j = 0; j < 3; ++j) {
+            read(GYRO_X + j, first, n, f.data());
+            for (uint32_t i = 0; i < n; ++i) x[i].gyro[j] = f[i];
+            read(ACCEL_X + j, first, n, f.data());
+            for (uint32_t i = 0; i < n; ++i) x[i].accel[j] = f[i];
+        }
+    }
+
+private:
+    // stored bits to T: floats by pattern, the integer channels by value
+    template<class T>
+    static T value(int c, uint32_t bits) { return channelType(c) == F32 ? (T)bitsFloat(bits) : (T)bits; }
+
+    template<class T>
+    void decode(const Chunk& chunk, int c, uint32_t from, uint32_t n, T* out) const {
+        const Column& col = chunk.columns[c];
+        const uint8_t* p = base_ + col.offset;
+        const size_t size = typeBytes(channelType(c));
+        uint32_t v = 0;
+        if (col.encoding == CONSTANT) {
+            memcpy(&v, p, size);
+            std::fill(out, out + n, value<T>(c, v));
+        } else if (col.encoding == DELTA16) {
+            // the prefix up to from is summed; a chunk is a few thousand samples
+            memcpy(&v, p, 4);
+            for (uint32_t i = 0; i < from + n; ++i) {
+                if (i > 0) {
+                    int16_t d;
+                    memcpy(&d, p + 4 + 2*(i - 1), 2);
+                    v += header_.period_us + d;
+                }
+                if (i >= from) out[i - from] = value<T>(c, v);
+            }
+        } else {
+            for (uint32_t i = 0; i < n; ++i) {
+                v = 0;
+                memcpy(&v, p + (from + i)*size, size);
+                out[i] = value<T>(c, v);
+            }
+        }
+    }
+
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    Header header_ = {};
+    Trailer trailer_ = {};
+    const Chunk* chunks_ = nullptr;
+    const Event* events_ = nullptr;
+};
+
+// Any recorded run, read a window at a time: straight from the mapped chunks
+// for an archive, from the samples parsed whole for a .bson or flight log
+class Source {
+public:
+    bool open(const char* path) {
+        if (archive_.open(path)) {
+            archived_ = true;
+            period_us_ = archive_.period_us();
+            return archive_.samples() > 0;
+        }
+        std::vector<uint8_t> bytes;
+        if (!runs::readFile(path, bytes)) return false;
+        if (runs::loadFlightLog(bytes, all_)) {
+            FlightLogHeader header;
+            memcpy(&header, bytes.data(), sizeof(header));
+            period_us_ = header.period_us;
+            return true;
+        }
+        period_us_ = runs::bson_period_us;
+        return runs::loadBson(bytes, all_);
+    }
+
+    uint32_t samples() const { return archived_ ? archive_.samples() : (uint32_t)all_.size(); }
+    uint32_t period_us() const { return period_us_; }
+
+    void read(uint32_t first, uint32_t n, std::vector<runs::Sample>& out) const {
+        out.clear();
+        if (archived_) archive_.load(first, n, out);
+        else out.assign(all_.begin() + first, all_.begin() + std::min<size_t>(first + n, all_.size()));
+    }
+
+private:
+    Reader archive_;
+    bool archived_ = false;
+    std::vector<runs::Sample> all_;
+    uint32_t period_us_ = runs::bson_period_us;
+};
+
+// An archive in bytes, loaded whole as a run, with events its event index
+inline bool loadArchive(const std::vector<uint8_t>& bytes, std::vector<runs::Sample>& samples,
+                        std::vector<runs::Event>* events = nullptr) {
+    Reader reader;
+    if (!reader.attach(bytes.data(), bytes.size())) return false;
+    const size_t first = samples.size();
+    reader.load(0, reader.samples(), samples);
+    if (events) {
+        const size_t at = events->size();
+        reader.events(*events);
+        for (size_t i = at; i < events->size(); ++i) (*events)[i].sample += first;
+    }
+    reader.close();
+    return samples.size() > first;
+}
+
+} // namespace archive
+
+#endif //HOST_ARCHIVE_H
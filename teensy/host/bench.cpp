@@ -0,0 +1,25 @@
+/* Host run of the compute-core micro-benchmarks (src/bench/ComputeBenchmarks.h),
+* the same suite env:teensy40_bench runs on the Teensy.
+*
+*     bench [min_time_s] > host.json
+*
+* Writes Google Benchmark JSON to stdout; compare two reports with
+* benchmark's tools/compare.py benchmarks a.json b.json.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <bench/ComputeBenchmarks.h>
+
+static void writeStdout(const char* text) { fputs(text, stdout); }
+
+int main(int argc, char** argv) {
+    double min_time = argc > 1 ? atof(argv[1]) : microbench::Runner::default_min_time;
+    if (!(min_time > 0.0)) {
+        fprintf(stderr, "usage: %s [min_time_s]\n", argv[0]);
+        return 2;
+    }
+    microbench::Runner bench(writeStdout, "host", min_time);
+    compute_bench::runAll(bench);
+    bench.finish();
+    return 0;
+}
@@ -0,0 +1,160 @@
+#ifndef HOST_CONTROLLERS_H
+#define HOST_CONTROLLERS_H
+
+/* The neural PBCs pbc_controller can run, for the host tools (evaluate,
+* simulate): by its names and with its default saturations, each turning n
+* ticks of controller inputs into clamped torques in one call.
+*
+* A deterministic network runs batch ticks per forward pass: its parameters
+* are repeated parameter-major, the bank's layout, so Chain::tangentBatch()
+* evaluates batch inputs of the one network with unit-stride inner loops.
+* control() is const, so any number of threads can share one controller.
+*
+* Each deterministic network also runs as "<name>_sparse", its header's
+* pruned straight-line pass (SparsePBC.h), so evaluate --reference <name>
+* shows what the exporter's --prune cost on the recorded runs.
+*/
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <NeuralPBC.h>
+#include <SparsePBC.h>
+#include <weights/deter_hardware_even_1mpers.h>
+#include <weights/deter2_hardware_even_1mpers.h>
+#include <weights/deterministic_hardware.h>
+#include <weights/hardware_even_688771.h>
+#include <weights/hardware_even_deter_1mpers.h>
+#include <weights/rw_bayesian.h>
+
+namespace pbc_host {
+
+constexpr int batch = 8;
+
+// What the controller reads of one tick, as PbcController::compute()
+struct State {
+    float roll, spoke, rollRate, spokeRate;
+};
+
+class Controller {
+public:
+    Controller(const char* name, float saturation) : name_(name), saturation_(saturation) {}
+    virtual ~Controller() {}
+
+    // Clamped torques of n ticks into u; const, so any number of runs can share one
+    virtual void control(const State* x, size_t n, float* u) const = 0;
+
+    const char* name() const { return name_; }
+    float saturation() const { return saturation_; }
+    // The flat parameter vector of a single network and its length, for a warm start; null for a bank
+    virtual const float* params() const { return nullptr; }
+    virtual int numParams() const { return 0; }
+
+protected:
+    const char* name_;
+    float saturation_;
+};
+
+template<class Network>
+class BatchedNetwork : public Controller {
+public:
+    typedef typename Network::chain Chain;
+    static constexpr int num_params = Chain::num_params + pbc::num_features;
+
+    BatchedNetwork(const char* name, float saturation) : Controller(name, saturation), p_(num_params*batch) {
+        for (int k = 0; k < num_params; ++k)
+            for (int s = 0; s < batch; ++s)
+                p_[k*batch + s] = Network::params()[k];
+    }
+
+    void control(const State* x, size_t n, float* u) const override {
+        // the gains are the tangent of every pass, the same for the whole run
+        const float* gains = p_.data() + Chain::num_params*batch;
+        float xi[pbc::num_features], xb[pbc::num_features*batch], h[batch], dh[batch];
+        size_t i = 0;
+        for (; i + batch <= n; i += batch) {
+            for (int s = 0; s < batch; ++s) {
+                const State& y = x[i + s];
+                pbc::inputLayer(y.roll, y.spoke, y.rollRate, y.spokeRate, xi);
+                for (int f = 0; f < pbc::num_features; ++f)
+                    xb[f*batch + s] = xi[f];
+            }
+            Chain::template tangentBatch<batch>(p_.data(), xb, gains, dh, h);
+            for (int s = 0; s < batch; ++s)
+                u[i + s] = pbc::clamp(dh[s], saturation_);
+        }
+        for (; i < n; ++i) {
+            pbc::inputLayer(x[i].roll, x[i].spoke, x[i].rollRate, x[i].spokeRate, xi);
+            u[i] = pbc::clamp(pbc::control<Chain>(Network::params(), xi), saturation_);
+        }
+    }
+
+    const float* params() const override { return Network::params(); }
+    int numParams() const override { return num_params; }
+
+private:
+    std::vector<float> p_;
+};
+
+// The network's sparse pass (SparsePBC.h), a tick at a time: its weights are in the code
+template<class Network>
+class SparseNetwork : public Controller {
+public:
+    SparseNetwork(const char* name, float saturation) : Controller(name, saturation) {}
+
+    void control(const State* x, size_t n, float* u) const override {
+        float xi[pbc::num_features], dh;
+        for (size_t i = 0; i < n; ++i) {
+            pbc::inputLayer(x[i].roll, x[i].spoke, x[i].rollRate, x[i].spokeRate, xi);
+            Network::sparse::tangent(xi, &dh);
+            u[i] = pbc::clamp(dh, saturation_);
+        }
+    }
+};
+
+// PosteriorBank::control() on the exported samples, without the bank's state
+template<class Posterior>
+class MarginalNetwork : public Controller {
+public:
+    typedef typename Posterior::chain Chain;
+
+    MarginalNetwork(const char* name, float saturation) : Controller(name, saturation) {}
+
+    void control(const State* x, size_t n, float* u) const override {
+        float xi[pbc::num_features];
+        for (size_t i = 0; i < n; ++i) {
+            pbc::inputLayer(x[i].roll, x[i].spoke, x[i].rollRate, x[i].spokeRate, xi);
+            u[i] = pbc::clamp(pbc::marginalControl<Chain, Posterior::num_samples>(Posterior::samples(), xi, saturation_),
+                              saturation_);
+        }
+    }
+};
+
+// pbc_controller's, "deterministic" first
+inline std::vector<std::unique_ptr<Controller>> controllers() {
+    std::vector<std::unique_ptr<Controller>> controllers;
+    controllers.emplace_back(new BatchedNetwork<pbc_weights::deter_hardware_even_1mpers>("deterministic", 1.0f));
+    controllers.emplace_back(new MarginalNetwork<pbc_weights::rw_bayesian>("bayesian", 2.0f));
+    controllers.emplace_back(new BatchedNetwork<pbc_weights::rw_bayesian>("map", 2.0f));
+    controllers.emplace_back(new BatchedNetwork<pbc_weights::deter2_hardware_even_1mpers>("deter2_hardware_even_1mpers", 1.0f));
+    controllers.emplace_back(new BatchedNetwork<pbc_weights::deterministic_hardware>("deterministic_hardware", 1.0f));
+    controllers.emplace_back(new BatchedNetwork<pbc_weights::hardware_even_688771>("hardware_even_688771", 1.0f));
+    controllers.emplace_back(new BatchedNetwork<pbc_weights::hardware_even_deter_1mpers>("hardware_even_deter_1mpers", 1.0f));
+    controllers.emplace_back(new SparseNetwork<pbc_weights::deter_hardware_even_1mpers>("deterministic_sparse", 1.0f));
+    controllers.emplace_back(new SparseNetwork<pbc_weights::deter2_hardware_even_1mpers>("deter2_hardware_even_1mpers_sparse", 1.0f));
+    controllers.emplace_back(new SparseNetwork<pbc_weights::deterministic_hardware>("deterministic_hardware_sparse", 1.0f));
+    controllers.emplace_back(new SparseNetwork<pbc_weights::hardware_even_688771>("hardware_even_688771_sparse", 1.0f));
+    controllers.emplace_back(new SparseNetwork<pbc_weights::hardware_even_deter_1mpers>("hardware_even_deter_1mpers_sparse", 1.0f));
+    return controllers;
+}
+
+// The controller called name, or null
+inline const Controller* find(const std::vector<std::unique_ptr<Controller>>& controllers, const char* name) {
+    for (const auto& c : controllers)
+        if (strcmp(c->name(), name) == 0) return c.get();
+    return nullptr;
+}
+
+} // namespace pbc_host
+
+#endif //HOST_CONTROLLERS_H
@@ -0,0 +1,278 @@
+/* dataset: recorded runs as training data for the controller learning, the
+* features the networks see already computed, in one memory-mappable file of
+* float32 so a loader reads batches instead of parsing BSON logs.
+*
+*     dataset [--chunk n] [--seed n] [--max-rate r] OUT.rwd RUN.rwa|RUN.bson|FLIGHTnn.BIN|DIR ...
+*
+* Every tick becomes a row of columns float32 values:
+*
+*     0-5  inputLayer(): cos and sin of the torso angle, cos and sin of the
+*          spoke angle, torso rate, spoke rate
+*     6-7  the torso angle and the stance spoke's angle from the upright
+*          contact, the state inputLayer() was fed
+*     8    the torque recorded for the tick, NaN in a hardware_data .bson
+*     9    dt, s since the row before in the chunk (0 for its first)
+*
+* The spoke is spoke 0 through StanceTracker with main.cpp's hysteresis, as
+* the firmware's SPOKE_CONTACT_ANGLE and pbc_controller's ~contact_angle feed
+* the network. Ticks under E-stop or in the boot calibration are left out, as
+* are ticks with a non-finite value or a rate beyond --max-rate rad/s (100
+* by default, a glitch in the recording), and each of them ends a segment.
+*
+* The rows are cut into chunks of --chunk (256 by default) consecutive ticks
+* of one segment, so a chunk is a piece of trajectory, and the chunks are
+* written in an order shuffled by --seed (1 by default), so reading the file
+* front to back mixes runs. Layout, little-endian:
+*
+*     Header          64 bytes, see below
+*     float32[chunks][chunk_rows][columns] at data_offset, a short chunk
+*                     padded with NaN rows
+*     Chunk[chunks]   at table_offset: run, first sample and rows of each
+*     run names       runs NUL-terminated paths, in run order
+*
+* In Julia, column-major, the data is
+*
+*     Mmap.mmap(io, Array{Float32, 3}, (columns, chunk_rows, chunks), data_offset)
+*
+* A run archive is memory-mapped and read a window at a time, and the file is
+* written a chunk at a time where its shuffled place is, so memory does not
+* grow with the runs; a .bson or flight log is parsed whole first. The
+* summary is "key value" lines; the exit code is 1 if a run could not be
+* read or the file not written.
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <RobotModel.h>
+#include <StanceTracker.h>
+#include <NeuralPBC.h>
+#include "archive.h"
+#include "runs.h"
+
+namespace {
+
+using runs::Sample;
+
+typedef RimlessWheelModel Robot;
+
+constexpr int columns = pbc::num_features + 4;
+constexpr float stanceHysteresis = 0.01f;      // STANCE_HYSTERESIS
+constexpr uint8_t held = 1 | 16 | 64;           // SensorState::STATUS_ESTOP | STATUS_CALIBRATING | STATUS_ODRIVE_RESET, as runs::findEvents()
+constexpr uint32_t window = 4096;
+
+struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t columns;
+    uint32_t chunk_rows;
+    uint32_t chunks;
+    uint64_t rows;              // without the padding
+    uint64_t data_offset;
+    uint64_t table_offset;
+    uint32_t runs;
+    uint32_t seed;
+    uint8_t reserved[16];
+    static constexpr uint32_t MAGIC = 0x31445752; // "RWD1"
+    static constexpr uint16_t VERSION = 1;
+};
+
+struct Chunk {
+    uint32_t run;
+    uint32_t first_sample;
+    uint32_t rows;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 64 && sizeof(Chunk) == 16, "the dataset layout is part of the format");
+
+// Cuts one run into chunks: calls f(first_sample, rows) with every chunk's rows
+// (rows[i*columns + c]), in run order
+class Cutter {
+public:
+    Cutter(uint32_t chunkRows, float maxRate) : chunkRows_(chunkRows), maxRate_(maxRate) {}
+
+    template<class F>
+    void add(const Sample& x, uint32_t sample, F f) {
+        const bool usable = !(x.status & held) && std::isfinite(x.roll) && std::isfinite(x.rollRate)
+                            && std::isfinite(x.spoke[0]) && std::isfinite(x.spokeRate[0])
+                            && fabsf(x.rollRate) <= maxRate_ && fabsf(x.spokeRate[0]) <= maxRate_;
+        if (!usable) {
+            ++skipped_;
+            end(f);
+            segment_ = false;
+            return;
+        }
+        if (!segment_) {
+            // a new segment re-rounds the stance spoke, as after an E-stop
+            stance_.reset();
+            segment_ = true;
+        }
+        if (rows_.empty()) first_ = sample;
+        const float spokeStates[4] = {x.spoke[0], x.spoke[1], x.spokeRate[0], x.spokeRate[1]};
+        const float torsoStates[2] = {x.roll, x.rollRate};
+        stance_.update(spokeStates);
+        float state[4], row[columns];
+        stance_.features(torsoStates, state);
+        pbc::inputLayer(state[0], state[1], state[2], state[3], row);
+        row[pbc::num_features] = state[0];
+        row[pbc::num_features + 1] = state[1];
+        row[pbc::num_features + 2] = x.torque;
+        row[pbc::num_features + 3] = rows_.empty() ? 0.0f : (int32_t)(x.stamp_us - last_us_) * 1e-6f;
+        last_us_ = x.stamp_us;
+        rows_.insert(rows_.end(), row, row + columns);
+        if (rows_.size() == (size_t)chunkRows_*columns) end(f);
+    }
+
+    // The chunk so far goes out, e.g. at the end of the run
+    template<class F>
+    void end(F f) {
+        if (rows_.empty()) return;
+        f(first_, rows_);
+        rows_.clear();
+    }
+
+    uint32_t skipped() const { return skipped_; }
+
+private:
+    uint32_t chunkRows_;
+    float maxRate_;
+    StanceTracker<Robot> stance_{stanceHysteresis};
+    std::vector<float> rows_;
+    bool segment_ = false;
+    uint32_t first_ = 0;
+    uint32_t last_us_ = 0;
+    uint32_t skipped_ = 0;
+};
+
+// Every chunk of the run at path through f, false if it is not a run
+template<class F>
+bool cut(const std::string& path, uint32_t chunkRows, float maxRate, uint32_t& samples, uint32_t& skipped, F f) {
+    archive::Source source;
+    if (!source.open(path.c_str())) return false;
+    Cutter cutter(chunkRows, maxRate);
+    std::vector<Sample> batch;
+    for (uint32_t first = 0; first < source.samples(); first += window) {
+        source.read(first, window, batch);
+        for (size_t i = 0; i < batch.size(); ++i) cutter.add(batch[i], first + (uint32_t)i, f);
+    }
+    cutter.end(f);
+    samples = source.samples();
+    skipped = cutter.skipped();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int chunkRows = 256;
+    uint32_t seed = 1;
+    float maxRate = 100.0f;
+    const char* outPath = nullptr;
+    std::vector<std::string> paths;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) chunkRows = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--max-rate") == 0 && i + 1 < argc) maxRate = (float)atof(argv[++i]);
+        else if (argv[i][0] == '-') usage = true;
+        else if (!outPath) outPath = argv[i];
+        else runs::expand(argv[i], paths);
+    }
+    if (usage || !outPath || paths.empty() || chunkRows < 1 || !(maxRate > 0.0f)) {
+        fprintf(stderr, "usage: %s [--chunk n] [--seed n] [--max-rate r] OUT.rwd RUN.rwa|RUN.bson|FLIGHTnn.BIN|DIR ...\n",
+                argv[0]);
+        return 2;
+    }
+
+    // first pass: how many chunks each run has, so the shuffled order is known before any is written
+    std::vector<std::string> names;
+    std::vector<Chunk> table;
+    uint64_t samples = 0, skipped = 0, rows = 0;
+    bool ok = true;
+    for (const std::string& path : paths) {
+        uint32_t n = 0, s = 0;
+        const uint32_t run = (uint32_t)names.size();
+        if (!cut(path, chunkRows, maxRate, n, s, [&](uint32_t first, const std::vector<float>& r) {
+                table.push_back({run, first, (uint32_t)(r.size() / columns), 0});
+                rows += r.size() / columns;
+            })) {
+            fprintf(stderr, "%s: not a flight log, run archive or hardware_data BSON, skipped\n", path.c_str());
+            ok = false;
+            continue;
+        }
+        names.push_back(path);
+        samples += n;
+        skipped += s;
+    }
+    if (table.empty()) {
+        fprintf(stderr, "no usable samples\n");
+        return 1;
+    }
+    std::vector<uint32_t> order(table.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = (uint32_t)i;
+    std::mt19937 rng(seed);
+    std::shuffle(order.begin(), order.end(), rng);
+    // place[k] is where run-order chunk k goes
+    std::vector<uint32_t> place(table.size());
+    std::vector<Chunk> shuffled(table.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        place[order[i]] = (uint32_t)i;
+        shuffled[i] = table[order[i]];
+    }
+
+    Header header = {};
+    header.magic = Header::MAGIC;
+    header.version = Header::VERSION;
+    header.columns = columns;
+    header.chunk_rows = (uint32_t)chunkRows;
+    header.chunks = (uint32_t)table.size();
+    header.rows = rows;
+    header.data_offset = sizeof(Header);
+    const uint64_t chunkBytes = (uint64_t)chunkRows*columns*sizeof(float);
+    header.table_offset = header.data_offset + chunkBytes*table.size();
+    header.runs = (uint32_t)names.size();
+    header.seed = seed;
+
+    FILE* out = fopen(outPath, "wb");
+    if (!out) {
+        perror(outPath);
+        return 1;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    // second pass: each chunk into its place, padded to chunk_rows with NaN
+    std::vector<float> padded((size_t)chunkRows*columns);
+    uint32_t next = 0;
+    for (uint32_t run = 0; run < names.size() && written; ++run) {
+        uint32_t n, s;
+        cut(names[run], chunkRows, maxRate, n, s, [&](uint32_t, const std::vector<float>& r) {
+            std::fill(std::copy(r.begin(), r.end(), padded.begin()), padded.end(), NAN);
+            written = written && fseeko(out, (off_t)(header.data_offset + chunkBytes*place[next++]), SEEK_SET) == 0
+                      && fwrite(padded.data(), sizeof(float), padded.size(), out) == padded.size();
+        });
+    }
+    written = written && next == table.size() && fseeko(out, (off_t)header.table_offset, SEEK_SET) == 0
+              && fwrite(shuffled.data(), sizeof(Chunk), shuffled.size(), out) == shuffled.size();
+    for (const std::string& name : names)
+        written = written && fwrite(name.c_str(), 1, name.size() + 1, out) == name.size() + 1;
+    if (fclose(out) != 0 || !written) {
+        fprintf(stderr, "%s: write failed\n", outPath);
+        return 1;
+    }
+
+    printf("runs %zu\n", names.size());
+    printf("samples %lu\n", (unsigned long)samples);
+    printf("skipped %lu\n", (unsigned long)skipped);
+    printf("rows %lu\n", (unsigned long)rows);
+    printf("chunks %zu\n", table.size());
+    printf("chunk_rows %d\n", chunkRows);
+    printf("columns %d\n", columns);
+    printf("bytes %lu\n", (unsigned long)(header.table_offset + table.size()*sizeof(Chunk)));
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,442 @@
+/* distill: one small network trained to do what the Bayesian controller
+* does, so the Teensy can fly near-Bayesian torques at the cost of one
+* deterministic forward pass instead of one per posterior sample.
+*
+*     distill [--teacher name] [--warm name|none] [--widths 6,8,7,1] [--random n] [--jitter n]
+*             [--epochs n] [--batch n] [--lr r] [--holdout f] [--seed n] [--threads n] [--out FILE.bson]
+*             [RUN.bson|FLIGHTnn.BIN|RUN.rwa|DIR ...]
+*
+* The states are the recorded runs' (as evaluate feeds them), --jitter
+* copies of each with noise on the angles and rates, and --random more drawn
+* uniformly around the upright contact (the box exportWeights.py checks the
+* fixed-point pass on). The teacher, a controllers.h name ("bayesian", the
+* PosteriorBank mean over the exported samples, by default), labels all of
+* them through the batch engine on --threads workers.
+*
+* The student is a FastChain of --widths with elu hidden layers and the six
+* gains, the controller of evaluatePbc.jl, trained by minibatch Adam on the
+* squared torque error; a teacher torque at the saturation only pulls a
+* student beyond it back when it has the other sign. The gradient of
+* u = dHd/dxi . gains is a reverse sweep over the forward-mode pass
+* (NeuralPBC.h's tangent()), in double. --warm starts it from a controller's
+* parameters ("map", the posterior mean, by default) when the widths match,
+* otherwise or with "none" from a seeded Glorot draw.
+*
+* --holdout of the states are kept out of training; every epoch prints the
+* RMS clamped-torque error on both, and the summary the holdout's RMS, max
+* and sign-flip fraction against the teacher. The student is written as
+* BSON.@save does a Vector{Float32} under "param", so it goes into
+* saved_weights beside the trained networks: BSON.@load reads it into the
+* Julia scripts and exportWeights.py turns it into a lib/NeuralPBC/weights
+* header with its fixed-point copy. The exit code is 1 if a torque was not
+* finite or the file could not be written.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <RobotModel.h>
+#include "archive.h"
+#include "controllers.h"
+#include "parallel.h"
+#include "runs.h"
+
+namespace {
+
+typedef RimlessWheelModel Robot;
+typedef std::chrono::steady_clock Clock;
+
+using pbc_host::State;
+using pbc_host::Controller;
+
+constexpr int num_gains = pbc::num_features;
+
+// FastChain(FastDense(W0, W1, elu), ..., FastDense(Wn-1, 1)) over the flat
+// vector in NeuralPBC.h's layout, the gains last, with runtime widths
+class Student {
+public:
+    explicit Student(const std::vector<int>& widths) : widths_(widths) {
+        for (size_t l = 0; l + 1 < widths_.size(); ++l)
+            chain_params_ += widths_[l]*widths_[l + 1] + widths_[l + 1];
+    }
+
+    int numParams() const { return chain_params_ + num_gains; }
+    int numLayers() const { return (int)widths_.size() - 1; }
+    int width(int l) const { return widths_[l]; }
+
+    // u for inputs xi and, with grad, scale*du/dp added into grad
+    double control(const double* p, const double* xi, double* grad, double scale) const {
+        const int L = numLayers();
+        // per hidden layer: its input values and tangents, and its pre-activations' tangents and elu terms
+        double y[max_layers + 1][max_width], t[max_layers + 1][max_width];
+        double dz[max_layers][max_width], e1[max_layers][max_width], e2[max_layers][max_width];
+        for (int i = 0; i < widths_[0]; ++i) {
+            y[0][i] = xi[i];
+            t[0][i] = p[chain_params_ + i];
+        }
+        const double* w = p;
+        for (int l = 0; l + 1 < L; ++l) {
+            const int In = widths_[l], Out = widths_[l + 1];
+            const double* b = w + In*Out;
+            for (int o = 0; o < Out; ++o) {
+                double z = b[o], d = 0.0;
+                for (int i = 0; i < In; ++i) {
+                    z += w[i*Out + o]*y[l][i];
+                    d += w[i*Out + o]*t[l][i];
+                }
+                // elu and its first two derivatives
+                const double e = z > 0.0 ? 0.0 : exp(z);
+                y[l + 1][o] = z > 0.0 ? z : e - 1.0;
+                e1[l][o] = z > 0.0 ? 1.0 : e;
+                e2[l][o] = e;
+                dz[l][o] = d;
+                t[l + 1][o] = e1[l][o]*d;
+            }
+            w = b + Out;
+        }
+        const int In = widths_[L - 1];
+        double u = 0.0;
+        for (int i = 0; i < In; ++i)
+            u += w[i]*t[L - 1][i];
+        if (!grad) return u;
+
+        // reverse sweep; Hd itself does not enter u, so the output bias and values get nothing
+        double* gw = grad + (w - p);
+        double ty[max_width], tt[max_width];
+        for (int i = 0; i < In; ++i) {
+            gw[i] += scale*t[L - 1][i];
+            tt[i] = scale*w[i];
+            ty[i] = 0.0;
+        }
+        for (int l = L - 2; l >= 0; --l) {
+            const int In = widths_[l], Out = widths_[l + 1];
+            w -= In*Out + Out;
+            gw = grad + (w - p);
+            double gz[max_width], gdz[max_width];
+            for (int o = 0; o < Out; ++o) {
+                gdz[o] = tt[o]*e1[l][o];
+                gz[o] = ty[o]*e1[l][o] + tt[o]*dz[l][o]*e2[l][o];
+                gw[In*Out + o] += gz[o];
+            }
+            for (int i = 0; i < In; ++i) {
+                double sy = 0.0, st = 0.0;
+                for (int o = 0; o < Out; ++o) {
+                    gw[i*Out + o] += gz[o]*y[l][i] + gdz[o]*t[l][i];
+                    sy += w[i*Out + o]*gz[o];
+                    st += w[i*Out + o]*gdz[o];
+                }
+                ty[i] = sy;
+                tt[i] = st;
+            }
+        }
+        for (int i = 0; i < widths_[0]; ++i)
+            grad[chain_params_ + i] += tt[i];
+        return u;
+    }
+
+    static constexpr int max_layers = 8;
+    static constexpr int max_width = 64;
+
+private:
+    std::vector<int> widths_;
+    int chain_params_ = 0;
+};
+
+// BSON.@save's document for one Vector{Float32} under key
+std::vector<uint8_t> bsonVector(const char* key, const std::vector<float>& values) {
+    struct Doc {
+        std::vector<uint8_t> b = std::vector<uint8_t>(4);
+        void key(uint8_t type, const char* k) { b.push_back(type); b.insert(b.end(), k, k + strlen(k) + 1); }
+        void raw(const void* p, size_t n) { b.insert(b.end(), (const uint8_t*)p, (const uint8_t*)p + n); }
+        void string(const char* k, const char* v) {
+            key(0x02, k);
+            const int32_t n = (int32_t)strlen(v) + 1;
+            raw(&n, 4);
+            raw(v, n);
+        }
+        void doc(uint8_t type, const char* k, const Doc& d) { key(type, k); raw(d.b.data(), d.b.size()); }
+        Doc& done() {
+            b.push_back(0);
+            const int32_t n = (int32_t)b.size();
+            memcpy(b.data(), &n, 4);
+            return *this;
+        }
+    };
+    Doc params, name, size, type, array, top;
+    name.string("0", "Core");
+    name.string("1", "Float32");
+    type.string("tag", "datatype");
+    type.doc(0x04, "params", params.done());
+    type.doc(0x04, "name", name.done());
+    const int64_t count = (int64_t)values.size();
+    size.key(0x12, "0");
+    size.raw(&count, 8);
+    array.string("tag", "array");
+    array.doc(0x03, "type", type.done());
+    array.doc(0x04, "size", size.done());
+    array.key(0x05, "data");
+    const int32_t bytes = (int32_t)(values.size()*sizeof(float));
+    array.raw(&bytes, 4);
+    array.b.push_back(0x00);
+    array.raw(values.data(), bytes);
+    top.doc(0x03, key, array.done());
+    return top.done().b;
+}
+
+bool parseWidths(const char* text, std::vector<int>& widths) {
+    widths.clear();
+    for (const char* s = text; *s;) {
+        char* end;
+        long w = strtol(s, &end, 10);
+        if (end == s || w < 1 || w > Student::max_width) return false;
+        widths.push_back((int)w);
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return widths.size() >= 2 && (int)widths.size() <= Student::max_layers + 1
+           && widths.front() == pbc::num_features && widths.back() == 1;
+}
+
+bool load(const std::string& path, std::vector<State>& states) {
+    std::vector<uint8_t> bytes;
+    std::vector<runs::Sample> samples;
+    if (!runs::readFile(path.c_str(), bytes) || !(runs::loadFlightLog(bytes, samples) || archive::loadArchive(bytes, samples)
+                                                     || runs::loadBson(bytes, samples)))
+        return false;
+    for (const runs::Sample& x : samples)
+        if (std::isfinite(x.roll) && std::isfinite(x.spoke[0]) && std::isfinite(x.rollRate) && std::isfinite(x.spokeRate[0]))
+            states.push_back({x.roll, Robot::uprightSpokeAngle + x.spoke[0], x.rollRate, x.spokeRate[0]});
+    return true;
+}
+
+struct Fit {
+    double rms = 0.0, max = 0.0, flips = 0.0;
+    bool finite = true;
+};
+
+// The student's clamped torques against the teacher's over states[first, last)
+Fit evaluate(const Student& student, const std::vector<double>& p, const std::vector<State>& states,
+             const std::vector<float>& labels, const std::vector<size_t>& order, size_t first, size_t last,
+             float saturation) {
+    Fit fit;
+    double e2 = 0.0;
+    size_t flips = 0;
+    for (size_t k = first; k < last; ++k) {
+        const size_t i = order[k];
+        float xf[pbc::num_features];
+        pbc::inputLayer(states[i].roll, states[i].spoke, states[i].rollRate, states[i].spokeRate, xf);
+        double xi[pbc::num_features];
+        for (int f = 0; f < pbc::num_features; ++f) xi[f] = xf[f];
+        const double u = std::min(std::max(student.control(p.data(), xi, nullptr, 0.0), -(double)saturation), (double)saturation);
+        if (!std::isfinite(u)) fit.finite = false;
+        const double d = u - labels[i];
+        e2 += d*d;
+        fit.max = std::max(fit.max, fabs(d));
+        if (u*labels[i] < 0.0) ++flips;
+    }
+    const double n = last > first ? (double)(last - first) : NAN;
+    fit.rms = sqrt(e2 / n);
+    fit.flips = flips / n;
+    return fit;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* teacherName = "bayesian";
+    const char* warmName = "map";
+    const char* outPath = "distilled.bson";
+    std::vector<int> widths = {6, 8, 7, 1};
+    long randomStates = 65536, jitter = 1, epochs = 100, batchSize = 1024;
+    double lr = 1e-3, holdout = 0.1;
+    unsigned seed = 1;
+    int threads = (int)std::thread::hardware_concurrency();
+    std::vector<std::string> paths;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--teacher") == 0 && i + 1 < argc) teacherName = argv[++i];
+        else if (strcmp(argv[i], "--warm") == 0 && i + 1 < argc) warmName = argv[++i];
+        else if (strcmp(argv[i], "--widths") == 0 && i + 1 < argc) usage = usage || !parseWidths(argv[++i], widths);
+        else if (strcmp(argv[i], "--random") == 0 && i + 1 < argc) randomStates = atol(argv[++i]);
+        else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) jitter = atol(argv[++i]);
+        else if (strcmp(argv[i], "--epochs") == 0 && i + 1 < argc) epochs = atol(argv[++i]);
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) batchSize = atol(argv[++i]);
+        else if (strcmp(argv[i], "--lr") == 0 && i + 1 < argc) lr = atof(argv[++i]);
+        else if (strcmp(argv[i], "--holdout") == 0 && i + 1 < argc) holdout = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned)atol(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) outPath = argv[++i];
+        else if (argv[i][0] == '-') usage = true;
+        else runs::expand(argv[i], paths);
+    }
+    if (threads < 1) threads = 1;
+    if (batchSize < 1) batchSize = 1;
+    if (usage || randomStates < 0 || jitter < 0 || epochs < 0 || holdout < 0.0 || holdout >= 1.0) {
+        fprintf(stderr, "usage: %s [--teacher name] [--warm name|none] [--widths 6,8,7,1] [--random n] [--jitter n]\n"
+                        "       [--epochs n] [--batch n] [--lr r] [--holdout f] [--seed n] [--threads n] [--out FILE.bson]\n"
+                        "       [RUN.bson|FLIGHTnn.BIN|RUN.rwa|DIR ...]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::unique_ptr<Controller>> controllers = pbc_host::controllers();
+    const Controller* teacher = pbc_host::find(controllers, teacherName);
+    if (!teacher) {
+        fprintf(stderr, "unknown teacher controller %s\n", teacherName);
+        return 2;
+    }
+    const float saturation = teacher->saturation();
+    Student student(widths);
+    const int P = student.numParams();
+
+    // recorded states, their jittered copies and the uniform box
+    const auto start = Clock::now();
+    std::vector<State> states;
+    size_t recorded = 0;
+    for (const std::string& path : paths) {
+        if (!load(path, states))
+            fprintf(stderr, "%s: not a flight log, run archive or hardware_data BSON, skipped\n", path.c_str());
+    }
+    recorded = states.size();
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> angleNoise(0.0f, 0.02f), rateNoise(0.0f, 0.1f);
+    for (long j = 0; j < jitter; ++j)
+        for (size_t i = 0; i < recorded; ++i) {
+            const State& x = states[i];
+            states.push_back({x.roll + angleNoise(rng), x.spoke + angleNoise(rng), x.rollRate + rateNoise(rng),
+                              x.spokeRate + rateNoise(rng)});
+        }
+    std::uniform_real_distribution<float> roll(-0.5f, 0.5f), contact(-Robot::alpha, Robot::alpha), rate(-3.0f, 3.0f);
+    for (long j = 0; j < randomStates; ++j)
+        states.push_back({roll(rng), Robot::uprightSpokeAngle + contact(rng), rate(rng), rate(rng)});
+    if (states.empty()) {
+        fprintf(stderr, "no states: give runs or --random\n");
+        return 1;
+    }
+
+    // the teacher's torques, in chunks over the workers
+    const size_t chunk = 4096;
+    std::vector<float> labels(states.size());
+    const auto labelStart = Clock::now();
+    host::parallelFor((states.size() + chunk - 1)/chunk, threads, [&](size_t c) {
+        const size_t first = c*chunk, n = std::min(chunk, states.size() - first);
+        teacher->control(states.data() + first, n, labels.data() + first);
+    });
+    const double label_s = std::chrono::duration<double>(Clock::now() - labelStart).count();
+    for (float u : labels)
+        if (!std::isfinite(u)) {
+            fprintf(stderr, "teacher %s gave a non-finite torque\n", teacherName);
+            return 1;
+        }
+
+    // the parameters: the warm start if its vector fits, otherwise Glorot
+    std::vector<double> p(P);
+    const Controller* warm = strcmp(warmName, "none") == 0 ? nullptr : pbc_host::find(controllers, warmName);
+    if (strcmp(warmName, "none") != 0 && !warm) {
+        fprintf(stderr, "unknown warm-start controller %s\n", warmName);
+        return 2;
+    }
+    const bool warmStarted = warm && warm->params() && warm->numParams() == P;
+    if (warm && !warmStarted)
+        fprintf(stderr, "%s does not have the student's %d parameters, starting cold\n", warmName, P);
+    if (warmStarted) {
+        for (int k = 0; k < P; ++k) p[k] = warm->params()[k];
+    } else {
+        int k = 0;
+        for (int l = 0; l < student.numLayers(); ++l) {
+            const int In = student.width(l), Out = student.width(l + 1);
+            std::uniform_real_distribution<double> glorot(-sqrt(6.0/(In + Out)), sqrt(6.0/(In + Out)));
+            for (int j = 0; j < In*Out; ++j) p[k++] = glorot(rng);
+            for (int j = 0; j < Out; ++j) p[k++] = 0.0;
+        }
+        for (; k < P; ++k) p[k] = 1.0;
+    }
+
+    // holdout last, after one shuffle; training reshuffles its part every epoch
+    std::vector<size_t> order(states.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    const size_t train = std::max<size_t>(1, (size_t)(order.size()*(1.0 - holdout)));
+    const size_t held = order.size() - train;
+
+    std::vector<double> m(P, 0.0), v(P, 0.0), g(P);
+    std::vector<std::vector<double>> parts(threads, std::vector<double>(P));
+    const double beta1 = 0.9, beta2 = 0.999, eps = 1e-8;
+    long step = 0;
+    const auto trainStart = Clock::now();
+    printf("%6s %12s %12s\n", "epoch", "train_rms", "holdout_rms");
+    for (long epoch = 0; epoch < epochs; ++epoch) {
+        std::shuffle(order.begin(), order.begin() + train, rng);
+        for (size_t first = 0; first < train; first += batchSize) {
+            const size_t n = std::min<size_t>(batchSize, train - first);
+            const size_t per = (n + threads - 1)/threads;
+            host::parallelFor(threads, threads, [&](size_t w) {
+                std::vector<double>& gp = parts[w];
+                std::fill(gp.begin(), gp.end(), 0.0);
+                for (size_t k = first + w*per; k < first + std::min(n, (w + 1)*per); ++k) {
+                    const size_t i = order[k];
+                    float xf[pbc::num_features];
+                    pbc::inputLayer(states[i].roll, states[i].spoke, states[i].rollRate, states[i].spokeRate, xf);
+                    double xi[pbc::num_features];
+                    for (int f = 0; f < pbc::num_features; ++f) xi[f] = xf[f];
+                    const double u = student.control(p.data(), xi, nullptr, 0.0);
+                    const double t = labels[i];
+                    double r = u - t;
+                    // a saturated teacher only minds a student on the other side of zero
+                    if (fabs(t) >= saturation && u*t > 0.0 && fabs(u) >= fabs(t)) r = 0.0;
+                    if (r != 0.0) student.control(p.data(), xi, gp.data(), r / n);
+                }
+            });
+            std::fill(g.begin(), g.end(), 0.0);
+            for (const std::vector<double>& gp : parts)
+                for (int k = 0; k < P; ++k) g[k] += gp[k];
+            ++step;
+            const double c1 = 1.0 - pow(beta1, (double)step), c2 = 1.0 - pow(beta2, (double)step);
+            for (int k = 0; k < P; ++k) {
+                m[k] = beta1*m[k] + (1.0 - beta1)*g[k];
+                v[k] = beta2*v[k] + (1.0 - beta2)*g[k]*g[k];
+                p[k] -= lr*(m[k]/c1)/(sqrt(v[k]/c2) + eps);
+            }
+        }
+        if (epoch % 10 == 9 || epoch + 1 == epochs) {
+            const Fit t = evaluate(student, p, states, labels, order, 0, train, saturation);
+            const Fit h = evaluate(student, p, states, labels, order, train, order.size(), saturation);
+            printf("%6ld %12.5f %12.5f\n", epoch + 1, t.rms, h.rms);
+        }
+    }
+    const double train_s = std::chrono::duration<double>(Clock::now() - trainStart).count();
+
+    const Fit fit = evaluate(student, p, states, labels, order, held ? train : 0, held ? order.size() : train, saturation);
+    std::vector<float> out(p.begin(), p.end());
+    const std::vector<uint8_t> bson = bsonVector("param", out);
+    FILE* f = fopen(outPath, "wb");
+    const bool written = f && fwrite(bson.data(), 1, bson.size(), f) == bson.size();
+    if (f) fclose(f);
+    if (!written) perror(outPath);
+
+    std::string widthText;
+    for (size_t l = 0; l < widths.size(); ++l) widthText += (l ? "," : "") + std::to_string(widths[l]);
+    printf("threads %d\n", threads);
+    printf("teacher %s\n", teacherName);
+    printf("warm_start %s\n", warmStarted ? warmName : "none");
+    printf("widths %s\n", widthText.c_str());
+    printf("params %d\n", P);
+    printf("states %zu\n", states.size());
+    printf("recorded %zu\n", recorded);
+    printf("holdout %zu\n", held);
+    printf("label_ms %.1f\n", label_s * 1e3);
+    printf("train_ms %.1f\n", train_s * 1e3);
+    printf("total_ms %.1f\n", std::chrono::duration<double>(Clock::now() - start).count() * 1e3);
+    printf("holdout_rms %.5f\n", fit.rms);
+    printf("holdout_max %.5f\n", fit.max);
+    printf("holdout_sign_flip %.5f\n", fit.flips);
+    printf("out %s\n", outPath);
+    return fit.finite && written ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+/* evaluate: every exported neural PBC on every recorded run at once, to pick
+* among the saved_weights networks without rerunning evaluatePbc.jl on each
+* log in turn.
+*
+*     evaluate [--threads n] [--reference name] [--csv out.csv] RUN.bson|FLIGHTnn.BIN|RUN.rwa|DIR ...
+*
+* A directory stands for the .bson, .BIN and .rwa files in it, e.g. hardware_data.
+* The controllers are pbc_controller's, by its names and with its default
+* saturations: the exported deterministic networks, "map" (the posterior
+* mean) and "bayesian" (the PosteriorBank mean over the exported samples).
+* Each is fed the recorded [roll, spoke 0, rates] of every tick, as the
+* controller node would have been, and its torques are compared with the
+* reference controller's (deterministic unless --reference says otherwise)
+* and, for flight logs, with the torque the robot commanded.
+*
+* Runs are read in parallel, then runs x controllers are evaluated by a pool
+* of --threads workers (all cores by default), each deterministic network
+* batch ticks per forward pass (controllers.h).
+*
+* One row per run and controller, and an "all" row per controller over every
+* run weighted by samples:
+*
+*     samples      ticks evaluated
+*     torque_rms   RMS clamped torque
+*     diff_rms     RMS torque difference to the reference
+*     diff_max     largest |difference|
+*     sign_flip    fraction of ticks pushing the other way to the reference
+*     saturated    fraction of ticks at the saturation
+*     recorded_rms RMS difference to the commanded torque (flight logs)
+*
+* --csv writes the rows as CSV. The exit code is 1 if a torque was not finite
+* or no run could be read.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <RobotModel.h>
+#include "archive.h"
+#include "controllers.h"
+#include "parallel.h"
+#include "runs.h"
+
+namespace {
+
+typedef RimlessWheelModel Robot;
+typedef std::chrono::steady_clock Clock;
+
+using pbc_host::State;
+using pbc_host::Controller;
+
+struct Run {
+    std::string name;
+    std::vector<State> states;
+    std::vector<float> recorded;    // commanded torque, NAN for hardware_data
+};
+
+struct Stats {
+    uint64_t n = 0, flips = 0, saturated = 0, recorded = 0;
+    double torque2 = 0.0, diff2 = 0.0, diffMax = 0.0, recorded2 = 0.0;
+    bool finite = true;
+
+    void add(const Stats& o) {
+        n += o.n; flips += o.flips; saturated += o.saturated; recorded += o.recorded;
+        torque2 += o.torque2; diff2 += o.diff2; recorded2 += o.recorded2;
+        diffMax = std::max(diffMax, o.diffMax);
+        finite = finite && o.finite;
+    }
+};
+
+Stats compare(const float* u, const float* reference, const std::vector<float>& recorded, float saturation) {
+    Stats st;
+    st.n = recorded.size();
+    for (size_t i = 0; i < st.n; ++i) {
+        if (!std::isfinite(u[i])) {
+            st.finite = false;
+            continue;
+        }
+        const double d = u[i] - reference[i];
+        st.torque2 += (double)u[i]*u[i];
+        st.diff2 += d*d;
+        st.diffMax = std::max(st.diffMax, fabs(d));
+        if (u[i]*reference[i] < 0.0f) ++st.flips;
+        if (fabsf(u[i]) >= saturation) ++st.saturated;
+        if (std::isfinite(recorded[i])) {
+            const double e = u[i] - recorded[i];
+            st.recorded2 += e*e;
+            ++st.recorded;
+        }
+    }
+    return st;
+}
+
+void printRow(FILE* out, FILE* csv, const std::string& run, const char* controller, const Stats& st) {
+    const double n = st.n ? (double)st.n : NAN;
+    const double recorded = st.recorded ? sqrt(st.recorded2 / st.recorded) : NAN;
+    fprintf(out, "%-40s %-28s %9lu %10.5f %10.5f %10.5f %10.5f %10.5f %12.5f\n", run.c_str(), controller,
+            (unsigned long)st.n, sqrt(st.torque2 / n), sqrt(st.diff2 / n), st.diffMax, st.flips / n, st.saturated / n, recorded);
+    if (csv)
+        fprintf(csv, "%s,%s,%lu,%g,%g,%g,%g,%g,%g\n", run.c_str(), controller, (unsigned long)st.n, sqrt(st.torque2 / n),
+                sqrt(st.diff2 / n), st.diffMax, st.flips / n, st.saturated / n, recorded);
+}
+
+bool load(const std::string& path, Run& run) {
+    std::vector<uint8_t> bytes;
+    std::vector<runs::Sample> samples;
+    if (!runs::readFile(path.c_str(), bytes) || !(runs::loadFlightLog(bytes, samples) || archive::loadArchive(bytes, samples)
+                                                     || runs::loadBson(bytes, samples)))
+        return false;
+    const size_t slash = path.find_last_of('/');
+    run.name = slash == std::string::npos ? path : path.substr(slash + 1);
+    run.states.resize(samples.size());
+    run.recorded.resize(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const runs::Sample& x = samples[i];
+        // update_state! in evaluatePbc.jl: spoke 0 is measured from the upright contact
+        run.states[i] = {x.roll, Robot::uprightSpokeAngle + x.spoke[0], x.rollRate, x.spokeRate[0]};
+        run.recorded[i] = x.torque;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* csvPath = nullptr;
+    const char* referenceName = "deterministic";
+    int threads = (int)std::thread::hardware_concurrency();
+    std::vector<std::string> paths;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) csvPath = argv[++i];
+        else if (strcmp(argv[i], "--reference") == 0 && i + 1 < argc) referenceName = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (argv[i][0] == '-') usage = true;
+        else runs::expand(argv[i], paths);
+    }
+    if (threads < 1) threads = 1;
+    if (usage || paths.empty()) {
+        fprintf(stderr, "usage: %s [--threads n] [--reference name] [--csv out.csv] RUN.bson|FLIGHTnn.BIN|RUN.rwa|DIR ...\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::unique_ptr<pbc_host::Controller>> controllers = pbc_host::controllers();
+    size_t reference = controllers.size();
+    for (size_t c = 0; c < controllers.size(); ++c)
+        if (strcmp(controllers[c]->name(), referenceName) == 0) reference = c;
+    if (reference == controllers.size()) {
+        fprintf(stderr, "unknown reference controller %s\n", referenceName);
+        return 2;
+    }
+
+    FILE* csv = nullptr;
+    if (csvPath) {
+        csv = fopen(csvPath, "w");
+        if (!csv) {
+            perror(csvPath);
+            return 1;
+        }
+        fprintf(csv, "run,controller,samples,torque_rms,diff_rms,diff_max,sign_flip,saturated,recorded_rms\n");
+    }
+
+    const auto start = Clock::now();
+    std::vector<Run> all(paths.size());
+    std::vector<char> loaded(paths.size());
+    host::parallelFor(paths.size(), threads, [&](size_t i) { loaded[i] = load(paths[i], all[i]); });
+    std::vector<Run> runs;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (loaded[i]) runs.push_back(std::move(all[i]));
+        else fprintf(stderr, "%s: not a flight log, run archive or hardware_data BSON, skipped\n", paths[i].c_str());
+    }
+    if (runs.empty())
+        return 1;
+    const double load_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // torques[r*C + c] is controller c over run r
+    const size_t C = controllers.size();
+    std::vector<std::vector<float>> torques(runs.size()*C);
+    uint64_t ticks = 0;
+    for (const Run& run : runs) ticks += run.states.size();
+    const auto evalStart = Clock::now();
+    host::parallelFor(torques.size(), threads, [&](size_t job) {
+        const Run& run = runs[job / C];
+        std::vector<float>& u = torques[job];
+        u.resize(run.states.size());
+        controllers[job % C]->control(run.states.data(), run.states.size(), u.data());
+    });
+    const double eval_s = std::chrono::duration<double>(Clock::now() - evalStart).count();
+
+    printf("threads %d\n", threads);
+    printf("runs %zu\n", runs.size());
+    printf("samples %lu\n", (unsigned long)ticks);
+    printf("controllers %zu\n", C);
+    printf("reference %s\n", controllers[reference]->name());
+    printf("load_ms %.1f\n", load_s * 1e3);
+    printf("evaluate_ms %.1f\n", eval_s * 1e3);
+    printf("ticks_per_s %.0f\n", ticks * C / eval_s);
+    printf("%-40s %-28s %9s %10s %10s %10s %10s %10s %12s\n", "run", "controller", "samples", "torque_rms", "diff_rms",
+           "diff_max", "sign_flip", "saturated", "recorded_rms");
+    std::vector<Stats> totals(C);
+    bool finite = true;
+    for (size_t r = 0; r < runs.size(); ++r) {
+        const float* ref = torques[r*C + reference].data();
+        for (size_t c = 0; c < C; ++c) {
+            Stats st = compare(torques[r*C + c].data(), ref, runs[r].recorded, controllers[c]->saturation());
+            printRow(stdout, csv, runs[r].name, controllers[c]->name(), st);
+            totals[c].add(st);
+            finite = finite && st.finite;
+        }
+    }
+    for (size_t c = 0; c < C; ++c)
+        printRow(stdout, csv, "all", controllers[c]->name(), totals[c]);
+    if (csv) fclose(csv);
+    return finite ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+/* imu_bench: the firmware's IMU path against the emulated LSM6DSOX and LIS3MDL
+* of imu_sim.h, on the virtual clock, so the FIFO drain, the calibration and
+* the fusion run at many times real time on a workstation, the same each run.
+*
+*     imu_bench [--mode fifo|burst|data-ready|all] [--run file] [--seconds s]
+*               [--amplitude rad] [--hz f] [--rate-hz f] [--odr hz] [--no-timestamps]
+*               [--max-samples n] [--i2c-hz f] [--gyro-sigma rad/s] [--gyro-bias rad/s]
+*               [--accel-sigma m/s^2] [--seed n] [--batch-calibrate]
+*
+* The torso follows --run (a hardware_data .bson or a flight log, its gyro
+* and accel where it logged them) or else rocks --amplitude about the axle at
+* --hz for --seconds. The sensors are set up over the bus as setup_sensors(),
+* init_fifo() and init_data_ready() do; then at --rate-hz each tick runs
+* fuseImu()'s path for the mode:
+*
+*     fifo        IMU_MODE_FIFO: Lsm6dsFifo's drain at --odr (833 Hz, with
+*                 the sensor's timestamps unless --no-timestamps), the
+*                 magnetometer once, every sample through the transform and
+*                 TorsoEstimator<MahonyFilter>; with --batch-calibrate the
+*                 drain through imu_apply_batch() first (IMU_FIFO_BATCH_CALIBRATE)
+*     burst       IMU_MODE_BURST: the 12-byte burst from OUTX_L_G and the
+*                 magnetometer, one sample a tick at --odr (104 Hz)
+*     data-ready  IMU_MODE_DATA_READY: INT1's interrupt reads the burst at
+*                 each edge, the tick fuses the newest one if it is fresh
+*
+* Per mode, prefixed with its name:
+*
+*     realtime_factor   virtual seconds per wall-clock second, the estimator
+*                       included; the emulation's own cost is in it too
+*     ticks, samples    control ticks and IMU samples fused
+*     imu_*_us          virtual us of the tick's IMU path, i.e. its bus time:
+*                       mean, p99 and max
+*     i2c_transactions, i2c_bytes, bus_load
+*                       the whole bus, the interrupt's reads included
+*     fifo_overruns     drains that found the FIFO overrun, and the words the
+*                       sensor overwrote
+*     roll_rms_mrad, roll_max_mrad
+*                       the estimator's roll against the trajectory's at the tick
+*
+* The virtual clock counts bus time only: the drain's CPU time is the wall
+* clock's, and the Teensy's is bench.cpp's and env:teensy40_bench's. The
+* ROS publish is left out, its serialization is the link benchmark's.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Lsm6dsFifo.h>
+#include <ImuTransform.h>
+#include <MahonyFilter.h>
+#include <TorsoEstimator.h>
+#include "imu_sim.h"
+#include "runs.h"
+
+using namespace imu_sim;
+
+namespace {
+
+// --max-samples' bound, the samples of the LSM6DSOX's 512-word FIFO
+constexpr uint16_t maxBatch = 256;
+
+struct Options {
+    std::vector<std::string> modes{"fifo", "burst", "data-ready"};
+    const char* run = nullptr;
+    float seconds = 10.0f;
+    float amplitude = 0.2f;      // rad
+    float hz = 1.5f;
+    float rate_hz = 100.0f;      // FILTER_UPDATE_RATE_HZ of the UART profiles
+    float odr_hz = 0.0f;         // 0: the mode's default
+    bool timestamps = true;      // IMU_FIFO_TIMESTAMPS
+    bool batch = false;          // IMU_FIFO_BATCH_CALIBRATE
+    uint16_t max_samples = 32;   // IMU_FIFO_MAX_SAMPLES
+    uint32_t i2c_hz = 400000;    // Wire.setClock()
+    NoiseConfig noise;
+};
+
+// main.cpp's configuration, the period the tick's
+struct TorsoAhrs {
+    static constexpr float period = 0.01f;
+    static constexpr float two_kp = 2.0f*0.5f;
+    static constexpr float two_ki = 0.0f;
+};
+typedef TorsoEstimator<MahonyFilter<TorsoAhrs>> Torso;
+
+constexpr uint8_t LSM6DSOX_COUNTER_BDR_REG1 = 0x0B;
+constexpr uint8_t LSM6DSOX_INT1_CTRL = 0x0D;
+constexpr uint8_t LSM6DSOX_CTRL1_XL = 0x10;
+constexpr uint8_t LSM6DSOX_CTRL2_G = 0x11;
+constexpr uint8_t LSM6DSOX_OUTX_L_G = 0x22;
+constexpr uint8_t LIS3MDL_CTRL_REG1 = 0x20;
+constexpr uint8_t LIS3MDL_CTRL_REG2 = 0x21;
+constexpr uint8_t LIS3MDL_CTRL_REG3 = 0x22;
+constexpr uint8_t LIS3MDL_OUT_X_L = 0x28;
+constexpr uint8_t LIS3MDL_AUTO_INCREMENT = 0x80;
+
+// The slowest ODR code at or above hz, as imu_settings_from_units() picks it
+uint8_t odrCode(float hz) {
+    static const float rates[] = {12.5f, 26.0f, 52.0f, 104.0f, 208.0f, 416.0f, 833.0f, 1660.0f, 3330.0f, 6660.0f};
+    for (uint8_t i = 0; i < sizeof(rates)/sizeof(rates[0]); i++)
+        if (rates[i] >= hz) return i + 1;
+    return 0;
+}
+
+struct Result {
+    double simulated_s = 0.0, wall_s = 0.0;
+    uint32_t ticks = 0;
+    uint64_t samples = 0;
+    std::vector<double> imu_us;
+    BusStats bus;
+    uint32_t overruns = 0;
+    uint64_t overwritten = 0, data_ready = 0;
+    double roll2 = 0.0, roll_max = 0.0;
+    bool ok = true;
+};
+
+std::unique_ptr<Result> bench(const std::string& mode, const Trajectory& trajectory, const Options& o) {
+    std::unique_ptr<Result> r(new Result);
+    Clock::reset();
+    I2cBus bus(o.i2c_hz);
+    Lsm6dsoxSim imu(bus, trajectory, o.noise);
+    Lis3mdlSim mag(bus, trajectory, o.noise);
+    auto lsm6ds_read = [&](uint8_t reg, uint8_t* buffer, uint8_t length) {
+        return bus.read(Lsm6dsoxSim::address, reg, buffer, length);
+    };
+    auto lsm6ds_write = [&](uint8_t reg, uint8_t value) { return bus.write(Lsm6dsoxSim::address, reg, value); };
+
+    // setup_sensors(): 2 g, 250 dps; the LIS3MDL at 4 gauss, FAST_ODR in medium mode, continuous
+    const bool fifo = mode == "fifo";
+    const uint8_t odr = odrCode(o.odr_hz > 0.0f ? o.odr_hz : fifo ? 833.0f : 104.0f);
+    bool ok = lsm6ds_write(LSM6DSOX_CTRL1_XL, odr << 4) && lsm6ds_write(LSM6DSOX_CTRL2_G, odr << 4)
+           && bus.write(Lis3mdlSim::address, LIS3MDL_CTRL_REG1, 0x20 | 0x02)
+           && bus.write(Lis3mdlSim::address, LIS3MDL_CTRL_REG2, 0x00)
+           && bus.write(Lis3mdlSim::address, LIS3MDL_CTRL_REG3, 0x00);
+    if (fifo) {
+        // init_fifo()
+        uint8_t ctrl10 = 0;
+        ok = ok && lsm6ds_write(LSM6DSOX_FIFO_CTRL4, 0) && lsm6ds_write(LSM6DSOX_FIFO_CTRL3, (odr << 4) | odr);
+        if (o.timestamps)
+            ok = ok && lsm6ds_read(LSM6DSOX_CTRL10_C, &ctrl10, 1)
+                    && lsm6ds_write(LSM6DSOX_CTRL10_C, ctrl10 | LSM6DSOX_TIMESTAMP_EN);
+        ok = ok && lsm6ds_write(LSM6DSOX_FIFO_CTRL4, LSM6DSOX_FIFO_MODE_CONTINUOUS |
+                                                     (o.timestamps ? LSM6DSOX_DEC_TS_BATCH_1 : 0));
+    }
+
+    // imu_data_ready_isr() and its double buffer
+    struct { uint32_t seq; uint32_t stamp_us; int16_t gyro[3]; int16_t accel[3]; } latest = {};
+    if (mode == "data-ready") {
+        ok = ok && lsm6ds_write(LSM6DSOX_COUNTER_BDR_REG1, 0x80) && lsm6ds_write(LSM6DSOX_INT1_CTRL, 0x02);
+        imu.attachInterrupt([&]() {
+            const uint32_t stamp = (uint32_t)(Clock::now() / 1000);
+            uint8_t raw[12];
+            if (!lsm6ds_read(LSM6DSOX_OUTX_L_G, raw, sizeof(raw))) return;
+            for (int i = 0; i < 3; i++) {
+                latest.gyro[i] = (int16_t)(raw[2*i] | (raw[2*i + 1] << 8));
+                latest.accel[i] = (int16_t)(raw[6 + 2*i] | (raw[6 + 2*i + 1] << 8));
+            }
+            latest.stamp_us = stamp;
+            latest.seq++;
+        });
+    }
+    if (!ok) {
+        fprintf(stderr, "%s: sensor setup failed\n", mode.c_str());
+        r->ok = false;
+        return r;
+    }
+
+    // imu_build_transform() without a calibration file: the LSB scales of the ranges
+    ImuTransform transform;
+    imu_scale_transform(transform, imu.gyroLsb(), imu.accelLsb(), mag.lsb());
+    Lsm6dsFifo drain;
+    std::vector<ImuFifoSample> samples(o.max_samples);
+    std::unique_ptr<ImuBatch<maxBatch>> calibrated(new ImuBatch<maxBatch>);
+    Torso torso;
+    const float samplingTime = 1.0f / o.rate_hz;
+    const float odrPeriod = 1.0f / imu.odrHz();
+    const uint64_t period_ns = (uint64_t)(1e9 / o.rate_hz);
+    const uint64_t start_ns = Clock::now();
+    const uint64_t end_ns = start_ns + (uint64_t)(trajectory.duration()*1e9);
+    uint32_t lastFifoStamp_us = 0, lastSeq = 0, lastStamp_us = 0;
+    Vec3 gyro, accel, imuMag;
+
+    auto readMag = [&](int16_t m[3]) {
+        uint8_t raw[6];
+        if (!bus.read(Lis3mdlSim::address, LIS3MDL_OUT_X_L | LIS3MDL_AUTO_INCREMENT, raw, sizeof(raw))) return false;
+        for (int i = 0; i < 3; i++) m[i] = (int16_t)(raw[2*i] | (raw[2*i + 1] << 8));
+        return true;
+    };
+
+    const auto wall = std::chrono::steady_clock::now();
+    for (uint64_t tick_ns = start_ns + period_ns; tick_ns <= end_ns; tick_ns += period_ns) {
+        Clock::advanceTo(std::max(tick_ns, Clock::now()));
+        const uint64_t t0 = Clock::now();
+        int16_t m[3];
+        if (fifo) {
+            const uint16_t count = drain.drain(lsm6ds_read, samples.data(), o.max_samples);
+            if (count > 0 && readMag(m)) imuMag = imu_apply(transform.mag, m);
+            if (o.batch) imu_apply_batch(transform, samples.data(), count, *calibrated);
+            for (uint16_t n = 0; n < count; n++) {
+                float dt = odrPeriod;
+                if (o.timestamps) {
+                    uint32_t elapsed_us = samples[n].stamp_us - lastFifoStamp_us;
+                    if (lastFifoStamp_us != 0 && elapsed_us > 0 && elapsed_us < 4.0f*odrPeriod*1e6f) dt = elapsed_us * 1e-6f;
+                    lastFifoStamp_us = samples[n].stamp_us;
+                }
+                if (o.batch) {
+                    gyro = calibrated->gyroAt(n);
+                    accel = calibrated->accelAt(n);
+                } else {
+                    gyro = imu_apply(transform.gyro, samples[n].gyro);
+                    accel = imu_apply(transform.accel, samples[n].accel);
+                }
+                torso.fuse(gyro, &accel, imuMag, dt);
+            }
+            r->samples += count;
+        } else if (mode == "burst") {
+            uint8_t raw[12];
+            if (lsm6ds_read(LSM6DSOX_OUTX_L_G, raw, sizeof(raw))) {
+                int16_t g[3], a[3];
+                for (int i = 0; i < 3; i++) {
+                    g[i] = (int16_t)(raw[2*i] | (raw[2*i + 1] << 8));
+                    a[i] = (int16_t)(raw[6 + 2*i] | (raw[6 + 2*i + 1] << 8));
+                }
+                imu_apply_all(transform, g, a, readMag(m) ? m : nullptr, gyro, accel, imuMag);
+                torso.fuse(gyro, &accel, imuMag, samplingTime);
+                r->samples++;
+            }
+        } else if (latest.seq != lastSeq) {
+            // only fresh samples, integrated over the time between their edges
+            float dt = (latest.stamp_us - lastStamp_us) * 1e-6f;
+            if (lastSeq == 0 || dt > 10.0f*samplingTime) dt = samplingTime;
+            lastSeq = latest.seq;
+            lastStamp_us = latest.stamp_us;
+            imu_apply_all(transform, latest.gyro, latest.accel, readMag(m) ? m : nullptr, gyro, accel, imuMag);
+            torso.fuse(gyro, &accel, imuMag, dt);
+            r->samples++;
+        }
+        float states[3];
+        torso.states(states);
+        r->imu_us.push_back((Clock::now() - t0) * 1e-3);
+        const double err = states[0] - trajectory.at(tick_ns * 1e-9).roll;
+        r->roll2 += err*err;
+        r->roll_max = std::max(r->roll_max, fabs(err));
+        r->ticks++;
+    }
+    r->wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall).count();
+    r->simulated_s = (Clock::now() - start_ns) * 1e-9;
+    r->bus = bus.stats();
+    r->overruns = drain.overruns();
+    r->overwritten = imu.stats().overwritten;
+    r->data_ready = imu.stats().data_ready;
+    return r;
+}
+
+void print(const std::string& mode, Result& r) {
+    const char* m = mode.c_str();
+    std::sort(r.imu_us.begin(), r.imu_us.end());
+    double sum = 0.0;
+    for (double us : r.imu_us) sum += us;
+    const size_t n = r.imu_us.size();
+    printf("%s simulated_s %.3f\n", m, r.simulated_s);
+    printf("%s wall_s %.4f\n", m, r.wall_s);
+    printf("%s realtime_factor %.0f\n", m, r.wall_s > 0.0 ? r.simulated_s / r.wall_s : NAN);
+    printf("%s ticks %u\n", m, r.ticks);
+    printf("%s samples %llu\n", m, (unsigned long long)r.samples);
+    printf("%s imu_mean_us %.1f\n", m, n ? sum / n : NAN);
+    printf("%s imu_p99_us %.1f\n", m, n ? r.imu_us[std::min(n - 1, (size_t)(0.99*n))] : NAN);
+    printf("%s imu_max_us %.1f\n", m, n ? r.imu_us.back() : NAN);
+    printf("%s i2c_transactions %llu\n", m, (unsigned long long)r.bus.transactions);
+    printf("%s i2c_bytes %llu\n", m, (unsigned long long)r.bus.bytes);
+    printf("%s bus_load %.3f\n", m, r.simulated_s > 0.0 ? r.bus.busy_ns*1e-9 / r.simulated_s : NAN);
+    if (mode == "fifo") {
+        printf("%s fifo_overruns %u\n", m, r.overruns);
+        printf("%s words_overwritten %llu\n", m, (unsigned long long)r.overwritten);
+    }
+    if (mode == "data-ready") printf("%s interrupts %llu\n", m, (unsigned long long)r.data_ready);
+    printf("%s roll_rms_mrad %.2f\n", m, r.ticks ? 1e3*sqrt(r.roll2 / r.ticks) : NAN);
+    printf("%s roll_max_mrad %.2f\n", m, 1e3*r.roll_max);
+}
+
+bool parse(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; ++i) {
+        const bool more = i + 1 < argc;
+        if (strcmp(argv[i], "--mode") == 0 && more) {
+            std::string mode = argv[++i];
+            if (mode != "all") o.modes.assign(1, mode);
+        }
+        else if (strcmp(argv[i], "--run") == 0 && more) o.run = argv[++i];
+        else if (strcmp(argv[i], "--seconds") == 0 && more) o.seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--amplitude") == 0 && more) o.amplitude = atof(argv[++i]);
+        else if (strcmp(argv[i], "--hz") == 0 && more) o.hz = atof(argv[++i]);
+        else if (strcmp(argv[i], "--rate-hz") == 0 && more) o.rate_hz = atof(argv[++i]);
+        else if (strcmp(argv[i], "--odr") == 0 && more) o.odr_hz = atof(argv[++i]);
+        else if (strcmp(argv[i], "--no-timestamps") == 0) o.timestamps = false;
+        else if (strcmp(argv[i], "--batch-calibrate") == 0) o.batch = true;
+        else if (strcmp(argv[i], "--max-samples") == 0 && more) o.max_samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--i2c-hz") == 0 && more) o.i2c_hz = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--gyro-sigma") == 0 && more) o.noise.gyro_sigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--gyro-bias") == 0 && more) o.noise.gyro_bias = atof(argv[++i]);
+        else if (strcmp(argv[i], "--accel-sigma") == 0 && more) o.noise.accel_sigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && more) o.noise.seed = strtoull(argv[++i], nullptr, 10);
+        else return false;
+    }
+    for (const std::string& mode : o.modes)
+        if (mode != "fifo" && mode != "burst" && mode != "data-ready") return false;
+    return o.seconds > 0.0f && o.rate_hz > 0.0f && o.max_samples > 0 && o.max_samples <= maxBatch && o.i2c_hz > 0 &&
+           (o.odr_hz == 0.0f || odrCode(o.odr_hz) != 0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parse(argc, argv, o)) {
+        fprintf(stderr, "usage: %s [--mode fifo|burst|data-ready|all] [--run file] [--seconds s]\n"
+                        "       [--amplitude rad] [--hz f] [--rate-hz f] [--odr hz] [--no-timestamps]\n"
+                        "       [--max-samples n] [--i2c-hz f] [--gyro-sigma rad/s] [--gyro-bias rad/s]\n"
+                        "       [--accel-sigma m/s^2] [--seed n] [--batch-calibrate]\n", argv[0]);
+        return 2;
+    }
+    std::unique_ptr<Trajectory> trajectory;
+    if (o.run) {
+        std::vector<uint8_t> bytes;
+        std::vector<runs::Sample> samples;
+        std::unique_ptr<Recorded> recorded(new Recorded);
+        if (!runs::readFile(o.run, bytes) || !(runs::loadFlightLog(bytes, samples) || runs::loadBson(bytes, samples))
+            || !recorded->load(samples)) {
+            fprintf(stderr, "%s: not a run\n", o.run);
+            return 1;
+        }
+        printf("run %s\n", o.run);
+        printf("run_seconds %.2f\n", recorded->duration());
+        printf("run_logged_imu %zu\n", recorded->logged());
+        trajectory = std::move(recorded);
+    } else {
+        trajectory.reset(new Rocking(o.amplitude, o.hz, o.seconds));
+    }
+    bool ok = true;
+    for (const std::string& mode : o.modes) {
+        std::unique_ptr<Result> r = bench(mode, *trajectory, o);
+        if (r->ok) print(mode, *r);
+        ok = ok && r->ok;
+    }
+    return ok ? 0 : 1;
+}
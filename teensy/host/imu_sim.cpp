@@ -0,0 +1,403 @@
+#include "imu_sim.h"
+
+#include <algorithm>
+#include <Lsm6dsFifo.h>
+
+namespace imu_sim {
+
+// LSM6DSOX registers beyond Lsm6dsFifo.h's FIFO ones (datasheet section 9)
+constexpr uint8_t LSM6DSOX_INT1_CTRL = 0x0D;
+constexpr uint8_t LSM6DSOX_WHO_AM_I = 0x0F;
+constexpr uint8_t LSM6DSOX_CTRL1_XL = 0x10;
+constexpr uint8_t LSM6DSOX_CTRL2_G = 0x11;
+constexpr uint8_t LSM6DSOX_CTRL3_C = 0x12;
+constexpr uint8_t LSM6DSOX_STATUS_REG = 0x1E;
+constexpr uint8_t LSM6DSOX_OUTX_L_G = 0x22;
+constexpr uint8_t LSM6DSOX_OUTX_L_A = 0x28;
+constexpr uint8_t LSM6DSOX_FIFO_STATUS2 = 0x3B;
+constexpr uint8_t LSM6DSOX_TIMESTAMP0 = 0x40;
+constexpr uint8_t LSM6DSOX_TIMESTAMP2 = 0x42;
+constexpr uint8_t LSM6DSOX_FIFO_DATA_OUT_Z_H = 0x7E;
+constexpr uint8_t LSM6DSOX_IF_INC = 0x04;
+constexpr uint8_t LSM6DSOX_SW_RESET = 0x01;
+constexpr uint8_t LSM6DSOX_INT1_DRDY_G = 0x02;
+
+constexpr uint8_t LIS3MDL_WHO_AM_I = 0x0F;
+constexpr uint8_t LIS3MDL_CTRL_REG1 = 0x20;
+constexpr uint8_t LIS3MDL_CTRL_REG2 = 0x21;
+constexpr uint8_t LIS3MDL_CTRL_REG3 = 0x22;
+constexpr uint8_t LIS3MDL_STATUS_REG = 0x27;
+constexpr uint8_t LIS3MDL_OUT_X_L = 0x28;
+constexpr uint8_t LIS3MDL_AUTO_INCREMENT = 0x80;
+
+constexpr float gravity = 9.80665f;  // SENSORS_GRAVITY_STANDARD
+constexpr float dpsToRads = 0.017453292519943295f;
+// The field in the world frame, uT: roughly central Europe's, north along x and down -z
+const Vec3 earthField(20.0f, 0.0f, -44.0f);
+
+// Trajectories
+
+Motion Trajectory::rolled(float roll, float roll_rate) {
+    // the IMU turned by -roll about x: world vectors come out as R^T v
+    const float s = sinf(-roll), c = cosf(-roll);
+    Motion m;
+    m.gyro = Vec3(-roll_rate, 0.0f, 0.0f);
+    m.accel = Vec3(0.0f, gravity*s, gravity*c);
+    m.mag = Vec3(earthField.x, earthField.y*c + earthField.z*s, -earthField.y*s + earthField.z*c);
+    m.roll = roll;
+    return m;
+}
+
+Motion Rocking::at(double t_s) const {
+    const double w = 2.0*M_PI*hz_;
+    return rolled(amplitude_*(float)sin(w*t_s), amplitude_*(float)(w*cos(w*t_s)));
+}
+
+bool Recorded::load(const std::vector<runs::Sample>& samples) {
+    t_.clear();
+    motion_.clear();
+    logged_ = 0;
+    for (const runs::Sample& s : samples) {
+        const double t = (s.stamp_us - samples.front().stamp_us)*1e-6;
+        if (!t_.empty() && t <= t_.back()) continue; // a repeated or wrapped stamp
+        Motion m = rolled(s.roll, 0.0f);
+        m.logged = s.imu;
+        if (s.imu) {
+            m.gyro = Vec3(s.gyro[0], s.gyro[1], s.gyro[2]);
+            m.accel = Vec3(s.accel[0], s.accel[1], s.accel[2]);
+            ++logged_;
+        }
+        t_.push_back(t);
+        motion_.push_back(m);
+    }
+    return t_.size() >= 2;
+}
+
+Motion Recorded::at(double t_s) const {
+    if (t_s <= t_.front()) return motion_.front();
+    if (t_s >= t_.back()) return motion_.back();
+    const size_t i = std::upper_bound(t_.begin(), t_.end(), t_s) - t_.begin();
+    const float f = (float)((t_s - t_[i - 1]) / (t_[i] - t_[i - 1]));
+    const Motion &a = motion_[i - 1], &b = motion_[i];
+    const float roll = a.roll + (b.roll - a.roll)*f;
+    if (!a.logged || !b.logged) {
+        // the logged roll rate is filtered and the roll is not its integral, so the
+        // rate is the slope of the roll between the ticks, which keeps the two consistent
+        return rolled(roll, (float)((b.roll - a.roll) / (t_[i] - t_[i - 1])));
+    }
+    Motion m;
+    m.gyro = a.gyro + (b.gyro - a.gyro)*f;
+    m.accel = a.accel + (b.accel - a.accel)*f;
+    m.mag = a.mag + (b.mag - a.mag)*f;
+    m.roll = roll;
+    m.logged = true;
+    return m;
+}
+
+// I2cBus
+
+I2cTarget* I2cBus::find(uint8_t address) const {
+    for (const Entry& e : targets_)
+        if (e.address == address) return e.target;
+    return nullptr;
+}
+
+uint64_t I2cBus::claim(uint32_t bytes, bool restart) {
+    // 9 bits a byte (the ACK), the start and the stop, and a restart for a read
+    const uint64_t ns = (9ull*bytes + 2 + (restart ? 1 : 0))*bit_ns_;
+    const uint64_t start = std::max(Clock::now(), free_ns_);
+    free_ns_ = start + ns;
+    ++stats_.transactions;
+    stats_.bytes += bytes;
+    stats_.busy_ns += ns;
+    return start;
+}
+
+void I2cBus::wait(uint64_t t_ns) {
+    if (!Clock::servicing()) Clock::advanceTo(t_ns);
+}
+
+bool I2cBus::read(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length) {
+    I2cTarget* target = find(address);
+    if (!target) {
+        claim(1, false); // the NACKed address
+        wait(free_ns_);
+        ++stats_.nacks;
+        return false;
+    }
+    // the target answers from its registers as the bus reaches the data
+    const uint64_t start = claim(3 + length, true);
+    wait(start + (9ull*3 + 3)*bit_ns_);
+    target->read(reg, buffer, length);
+    wait(free_ns_);
+    return true;
+}
+
+bool I2cBus::write(uint8_t address, uint8_t reg, uint8_t value) {
+    I2cTarget* target = find(address);
+    claim(target ? 3 : 1, false);
+    wait(free_ns_);
+    if (!target) {
+        ++stats_.nacks;
+        return false;
+    }
+    target->write(reg, value);
+    return true;
+}
+
+// Lsm6dsoxSim
+
+// Hz of an ODR code of CTRL1_XL/CTRL2_G, as lsm6ds_rate_hz() has them; 0 is power-down
+static float lsm6dsRateHz(uint8_t code) {
+    static const float hz[] = {0.0f, 12.5f, 26.0f, 52.0f, 104.0f, 208.0f, 416.0f, 833.0f, 1660.0f, 3330.0f, 6660.0f};
+    return code < sizeof(hz)/sizeof(hz[0]) ? hz[code] : 0.0f;
+}
+
+Lsm6dsoxSim::Lsm6dsoxSim(I2cBus& bus, const Trajectory& trajectory, const NoiseConfig& noise)
+    : trajectory_(trajectory), noise_(noise), random_(noise.seed) {
+    write(LSM6DSOX_CTRL3_C, LSM6DSOX_SW_RESET);
+    bus.attach(address, this);
+    Clock::attach(this);
+}
+
+Lsm6dsoxSim::~Lsm6dsoxSim() { Clock::detach(this); }
+
+float Lsm6dsoxSim::odrHz() const {
+    // the firmware sets both together; the gyro's paces the samples
+    const float g = lsm6dsRateHz(regs_[LSM6DSOX_CTRL2_G] >> 4);
+    return g > 0.0f ? g : lsm6dsRateHz(regs_[LSM6DSOX_CTRL1_XL] >> 4);
+}
+
+float Lsm6dsoxSim::gyroLsb() const {
+    static const float mdps[] = {8.75f, 17.5f, 35.0f, 70.0f}; // FS_G 250, 500, 1000, 2000 dps
+    const uint8_t ctrl = regs_[LSM6DSOX_CTRL2_G];
+    return (ctrl & 0x02 ? 4.375f : mdps[(ctrl >> 2) & 3]) * 1e-3f * dpsToRads;
+}
+
+float Lsm6dsoxSim::accelLsb() const {
+    static const float mg[] = {0.061f, 0.488f, 0.122f, 0.244f}; // FS_XL 2, 16, 4, 8 g
+    return mg[(regs_[LSM6DSOX_CTRL1_XL] >> 2) & 3] * 1e-3f * gravity;
+}
+
+void Lsm6dsoxSim::put(uint8_t* out, const Vec3& v, float lsb) {
+    const float xyz[3] = {v.x, v.y, v.z};
+    for (int i = 0; i < 3; i++) {
+        const long counts = lroundf(xyz[i] / lsb);
+        const int16_t c = (int16_t)std::max(-32768L, std::min(32767L, counts));
+        out[2*i] = (uint8_t)(c & 0xFF);
+        out[2*i + 1] = (uint8_t)((uint16_t)c >> 8);
+    }
+}
+
+uint64_t Lsm6dsoxSim::next() const { return next_ns_; }
+
+void Lsm6dsoxSim::service(uint64_t now_ns) {
+    sample(now_ns);
+    const float hz = odrHz();
+    next_ns_ = hz > 0.0f ? next_ns_ + (uint64_t)(1e9 / hz) : UINT64_MAX;
+}
+
+void Lsm6dsoxSim::sample(uint64_t now_ns) {
+    truth_ = trajectory_.at(now_ns * 1e-9);
+    const Vec3 gyro = truth_.gyro + Vec3(noise_.gyro_bias + noise_.gyro_sigma*(float)random_.gaussian(),
+                                         noise_.gyro_bias + noise_.gyro_sigma*(float)random_.gaussian(),
+                                         noise_.gyro_bias + noise_.gyro_sigma*(float)random_.gaussian());
+    const Vec3 accel = truth_.accel + Vec3(noise_.accel_sigma*(float)random_.gaussian(),
+                                           noise_.accel_sigma*(float)random_.gaussian(),
+                                           noise_.accel_sigma*(float)random_.gaussian());
+    put(regs_ + LSM6DSOX_OUTX_L_G, gyro, gyroLsb());
+    put(regs_ + LSM6DSOX_OUTX_L_A, accel, accelLsb());
+    regs_[LSM6DSOX_STATUS_REG] |= 0x03; // GDA, XLDA
+    ++stats_.samples;
+
+    const uint8_t mode = regs_[LSM6DSOX_FIFO_CTRL4] & 0x07;
+    if (mode == 0x01 || mode == LSM6DSOX_FIFO_MODE_CONTINUOUS) {
+        // DEC_TS_BATCH: a timestamp word every 1, 8 or 32 batches
+        static const uint8_t every[] = {0, 1, 8, 32};
+        const uint8_t decimation = every[regs_[LSM6DSOX_FIFO_CTRL4] >> 6];
+        if (decimation && (regs_[LSM6DSOX_CTRL10_C] & LSM6DSOX_TIMESTAMP_EN) && stats_.samples % decimation == 0) {
+            uint8_t stamp[6] = {};
+            read(LSM6DSOX_TIMESTAMP0, stamp, 4);
+            push(LSM6DSOX_TAG_TIMESTAMP, stamp);
+        }
+        if (regs_[LSM6DSOX_FIFO_CTRL3] & 0x0F) push(LSM6DSOX_TAG_ACCEL, regs_ + LSM6DSOX_OUTX_L_A);
+        if (regs_[LSM6DSOX_FIFO_CTRL3] & 0xF0) push(LSM6DSOX_TAG_GYRO, regs_ + LSM6DSOX_OUTX_L_G);
+        tag_count_ = (tag_count_ + 1) & 0x03;
+    }
+    if ((regs_[LSM6DSOX_INT1_CTRL] & LSM6DSOX_INT1_DRDY_G) && isr_) {
+        ++stats_.data_ready;
+        isr_();
+    }
+}
+
+void Lsm6dsoxSim::push(uint8_t tag, const uint8_t* data) {
+    if (fifo_.size() >= fifo_words) {
+        ovr_latched_ = ovr_ia_ = true;
+        ++stats_.overwritten;
+        if ((regs_[LSM6DSOX_FIFO_CTRL4] & 0x07) != LSM6DSOX_FIFO_MODE_CONTINUOUS) return; // FIFO mode stops when full
+        fifo_.pop_front();
+    }
+    Word w;
+    w.tag = (uint8_t)((tag << 3) | (tag_count_ << 1));
+    memcpy(w.data, data, sizeof(w.data));
+    fifo_.push_back(w);
+    ++stats_.batched;
+}
+
+void Lsm6dsoxSim::pop() {
+    if (fifo_.empty()) {
+        memset(regs_ + LSM6DSOX_FIFO_DATA_OUT_TAG, 0, 7);
+        return;
+    }
+    regs_[LSM6DSOX_FIFO_DATA_OUT_TAG] = fifo_.front().tag;
+    memcpy(regs_ + LSM6DSOX_FIFO_DATA_OUT_TAG + 1, fifo_.front().data, 6);
+    fifo_.pop_front();
+    ovr_ia_ = false;
+}
+
+void Lsm6dsoxSim::read(uint8_t reg, uint8_t* buffer, uint8_t length) {
+    uint8_t addr = reg & 0x7F;
+    for (uint8_t i = 0; i < length; i++) {
+        if (addr == LSM6DSOX_FIFO_DATA_OUT_TAG) pop();
+        uint8_t value = regs_[addr];
+        switch (addr) {
+            case LSM6DSOX_FIFO_STATUS1: value = (uint8_t)(fifo_.size() & 0xFF); break;
+            case LSM6DSOX_FIFO_STATUS2:
+                value = (uint8_t)(((fifo_.size() >> 8) & 0x03) | (ovr_latched_ ? LSM6DSOX_FIFO_OVR_LATCHED : 0)
+                                  | (fifo_.size() >= fifo_words ? 0x20 : 0) | (ovr_ia_ ? LSM6DSOX_FIFO_OVR_IA : 0));
+                ovr_latched_ = false;
+                break;
+            case LSM6DSOX_TIMESTAMP0: case LSM6DSOX_TIMESTAMP0 + 1: case LSM6DSOX_TIMESTAMP0 + 2: case LSM6DSOX_TIMESTAMP0 + 3: {
+                const uint32_t ticks = (uint32_t)((Clock::now() - timestamp_origin_ns_) / (LSM6DSOX_TIMESTAMP_US*1000ull));
+                value = (uint8_t)(ticks >> (8*(addr - LSM6DSOX_TIMESTAMP0)));
+                break;
+            }
+            case LSM6DSOX_OUTX_L_G: regs_[LSM6DSOX_STATUS_REG] &= ~0x02; break;
+            case LSM6DSOX_OUTX_L_A: regs_[LSM6DSOX_STATUS_REG] &= ~0x01; break;
+            default: break;
+        }
+        buffer[i] = value;
+        // FIFO_DATA_OUT rolls back to its tag, everything else increments with IF_INC
+        if (addr >= LSM6DSOX_FIFO_DATA_OUT_TAG && addr <= LSM6DSOX_FIFO_DATA_OUT_Z_H)
+            addr = addr == LSM6DSOX_FIFO_DATA_OUT_Z_H ? LSM6DSOX_FIFO_DATA_OUT_TAG : addr + 1;
+        else if (regs_[LSM6DSOX_CTRL3_C] & LSM6DSOX_IF_INC)
+            addr = (addr + 1) & 0x7F;
+    }
+}
+
+void Lsm6dsoxSim::write(uint8_t reg, uint8_t value) {
+    reg &= 0x7F;
+    if (reg == LSM6DSOX_CTRL3_C && (value & LSM6DSOX_SW_RESET)) {
+        memset(regs_, 0, sizeof(regs_));
+        regs_[LSM6DSOX_WHO_AM_I] = 0x6C;
+        regs_[LSM6DSOX_CTRL3_C] = LSM6DSOX_IF_INC;
+        fifo_.clear();
+        ovr_latched_ = ovr_ia_ = false;
+        next_ns_ = UINT64_MAX;
+        return;
+    }
+    if (reg == LSM6DSOX_TIMESTAMP2 && value == 0xAA) { // resets the counter
+        timestamp_origin_ns_ = Clock::now();
+        return;
+    }
+    const uint8_t old = regs_[reg];
+    regs_[reg] = value;
+    switch (reg) {
+        case LSM6DSOX_CTRL1_XL:
+        case LSM6DSOX_CTRL2_G: {
+            const float hz = odrHz();
+            if ((old >> 4) != (value >> 4))
+                next_ns_ = hz > 0.0f ? Clock::now() + (uint64_t)(1e9 / hz) : UINT64_MAX;
+            break;
+        }
+        case LSM6DSOX_CTRL10_C:
+            if ((value & LSM6DSOX_TIMESTAMP_EN) && !(old & LSM6DSOX_TIMESTAMP_EN)) timestamp_origin_ns_ = Clock::now();
+            break;
+        case LSM6DSOX_FIFO_CTRL4:
+            if ((value & 0x07) == 0) { // bypass empties the FIFO
+                fifo_.clear();
+                ovr_latched_ = ovr_ia_ = false;
+            }
+            break;
+        case LSM6DSOX_WHO_AM_I:
+        case LSM6DSOX_STATUS_REG:
+        case LSM6DSOX_FIFO_STATUS1:
+        case LSM6DSOX_FIFO_STATUS2:
+            regs_[reg] = old; // read-only
+            break;
+        default:
+            break;
+    }
+}
+
+// Lis3mdlSim
+
+Lis3mdlSim::Lis3mdlSim(I2cBus& bus, const Trajectory& trajectory, const NoiseConfig& noise)
+    : trajectory_(trajectory), noise_(noise), random_(noise.seed ^ 0x4C4953ull) {
+    regs_[LIS3MDL_WHO_AM_I] = 0x3D;
+    regs_[LIS3MDL_CTRL_REG1] = 0x10; // 10 Hz
+    regs_[LIS3MDL_CTRL_REG3] = 0x03; // power-down
+    bus.attach(address, this);
+    Clock::attach(this);
+}
+
+Lis3mdlSim::~Lis3mdlSim() { Clock::detach(this); }
+
+float Lis3mdlSim::odrHz() const {
+    if ((regs_[LIS3MDL_CTRL_REG3] & 0x03) != 0) return 0.0f; // single-conversion and power-down are not modelled
+    const uint8_t ctrl = regs_[LIS3MDL_CTRL_REG1];
+    if (ctrl & 0x02) { // FAST_ODR: the performance mode sets the rate
+        static const float hz[] = {1000.0f, 560.0f, 300.0f, 155.0f};
+        return hz[(ctrl >> 5) & 3];
+    }
+    static const float hz[] = {0.625f, 1.25f, 2.5f, 5.0f, 10.0f, 20.0f, 40.0f, 80.0f};
+    return hz[(ctrl >> 2) & 7];
+}
+
+float Lis3mdlSim::lsb() const {
+    static const float per_gauss[] = {6842.0f, 3421.0f, 2281.0f, 1711.0f}; // 4, 8, 12, 16 gauss
+    return 100.0f / per_gauss[(regs_[LIS3MDL_CTRL_REG2] >> 5) & 3];
+}
+
+uint64_t Lis3mdlSim::next() const { return next_ns_; }
+
+void Lis3mdlSim::service(uint64_t now_ns) {
+    const Motion m = trajectory_.at(now_ns * 1e-9);
+    const Vec3 mag = m.mag + Vec3(noise_.mag_sigma*(float)random_.gaussian(), noise_.mag_sigma*(float)random_.gaussian(),
+                                  noise_.mag_sigma*(float)random_.gaussian());
+    const float per_count = lsb();
+    const float xyz[3] = {mag.x, mag.y, mag.z};
+    for (int i = 0; i < 3; i++) {
+        const int16_t c = (int16_t)std::max(-32768L, std::min(32767L, lroundf(xyz[i] / per_count)));
+        regs_[LIS3MDL_OUT_X_L + 2*i] = (uint8_t)(c & 0xFF);
+        regs_[LIS3MDL_OUT_X_L + 2*i + 1] = (uint8_t)((uint16_t)c >> 8);
+    }
+    regs_[LIS3MDL_STATUS_REG] |= 0x08; // ZYXDA
+    ++samples_;
+    const float hz = odrHz();
+    next_ns_ = hz > 0.0f ? next_ns_ + (uint64_t)(1e9 / hz) : UINT64_MAX;
+}
+
+void Lis3mdlSim::read(uint8_t reg, uint8_t* buffer, uint8_t length) {
+    // the sub-address' MSB turns on the increment
+    const bool increment = reg & LIS3MDL_AUTO_INCREMENT;
+    uint8_t addr = reg & 0x3F;
+    for (uint8_t i = 0; i < length; i++) {
+        buffer[i] = regs_[addr];
+        if (addr == LIS3MDL_OUT_X_L) regs_[LIS3MDL_STATUS_REG] &= ~0x08;
+        if (increment) addr = (addr + 1) & 0x3F;
+    }
+}
+
+void Lis3mdlSim::write(uint8_t reg, uint8_t value) {
+    reg &= 0x3F;
+    if (reg == LIS3MDL_WHO_AM_I || reg == LIS3MDL_STATUS_REG || (reg >= LIS3MDL_OUT_X_L && reg < LIS3MDL_OUT_X_L + 6))
+        return; // read-only
+    regs_[reg] = value;
+    if (reg == LIS3MDL_CTRL_REG1 || reg == LIS3MDL_CTRL_REG3) {
+        const float hz = odrHz();
+        next_ns_ = hz > 0.0f ? Clock::now() + (uint64_t)(1e9 / hz) : UINT64_MAX;
+    }
+}
+
+} // namespace imu_sim
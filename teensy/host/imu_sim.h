@@ -0,0 +1,216 @@
+#ifndef HOST_IMU_SIM_H
+#define HOST_IMU_SIM_H
+
+/* The torso's LSM6DSOX and LIS3MDL emulated on the host at register level,
+* for running the firmware's own IMU path (Lsm6dsFifo's drain, the register
+* bursts, ImuTransform's calibration, TorsoEstimator's fusion) without
+* hardware and faster than real time. Everything runs on the virtual clock of
+* sim_clock.h, so a run is the same run every time.
+*
+*     Trajectory what the torso does: Rocking, a sine about the axle, or
+*                Recorded, a hardware_data .bson or a flight log resampled
+*                to the sensor's rate (its gyro and accel where it logged
+*                them, made from the roll and its slope otherwise)
+*     I2cBus     one bus at clock_hz: a register read costs its address,
+*                register and data bytes at 9 bit times each plus the start,
+*                restart and stop, and holds the bus that long, so a
+*                data-ready read from the interrupt delays the loop's next
+*     Lsm6dsoxSim CTRL1_XL/CTRL2_G's rates and ranges, OUTX_L_G..OUTZ_H_A,
+*                STATUS_REG, the 25 us TIMESTAMP0..3, the FIFO in bypass or
+*                continuous mode (FIFO_CTRL3/4) with timestamp batching
+*                (CTRL10_C), FIFO_STATUS1/2 with the overrun flags and
+*                FIFO_DATA_OUT_TAG's rollover, and INT1's gyro data-ready
+*     Lis3mdlSim CTRL_REG1/2's rate and range, OUT_X_L..OUT_Z_H with the
+*                0x80 auto-increment, STATUS_REG
+*
+* Samples are the trajectory's motion quantized to the range's LSB, with
+* white noise and a gyro bias, and saturate at the full scale. The batch
+* rates of FIFO_CTRL3 are taken to be the ODR's, which is what init_fifo()
+* writes; the words of one batch come timestamp, accel, gyro.
+*/
+#include <deque>
+#include <functional>
+#include <vector>
+#include <Vec3.h>
+#include "runs.h"
+#include "sim_clock.h"
+
+namespace imu_sim {
+
+using sim::Clock;
+using sim::Device;
+using sim::Random;
+
+// What the sensors see, in the IMU's frame, and the roll it comes from
+struct Motion {
+    Vec3 gyro;            // rad/s
+    Vec3 accel;           // specific force, m/s^2
+    Vec3 mag;             // uT
+    float roll = 0.0f;    // rad, as TorsoEstimator::states() reports it
+    bool logged = false;  // gyro and accel are a run's, not made from the roll
+};
+
+class Trajectory {
+public:
+    virtual ~Trajectory() {}
+    virtual Motion at(double t_s) const = 0;
+    virtual double duration() const = 0;
+
+protected:
+    // The torso rolled by roll at roll_rate about the IMU's -x, at rest otherwise: gyro
+    // -roll_rate about x, gravity and the field turned into the IMU's frame
+    static Motion rolled(float roll, float roll_rate);
+};
+
+class Rocking : public Trajectory {
+public:
+    Rocking(float amplitude_rad, float hz, double seconds) : amplitude_(amplitude_rad), hz_(hz), seconds_(seconds) {}
+    Motion at(double t_s) const override;
+    double duration() const override { return seconds_; }
+
+private:
+    float amplitude_, hz_;
+    double seconds_;
+};
+
+class Recorded : public Trajectory {
+public:
+    // samples of one run, at their stamps; false if there are fewer than two
+    bool load(const std::vector<runs::Sample>& samples);
+    Motion at(double t_s) const override;
+    double duration() const override { return t_.empty() ? 0.0 : t_.back(); }
+    // Ticks whose gyro and accel were logged, i.e. not made from the roll
+    size_t logged() const { return logged_; }
+
+private:
+    std::vector<double> t_;
+    std::vector<Motion> motion_;
+    size_t logged_ = 0;
+};
+
+// What a register access does on the device's side; the bus does the timing
+class I2cTarget {
+public:
+    virtual ~I2cTarget() {}
+    virtual void read(uint8_t reg, uint8_t* buffer, uint8_t length) = 0;
+    virtual void write(uint8_t reg, uint8_t value) = 0;
+};
+
+struct BusStats {
+    uint64_t transactions = 0, bytes = 0, busy_ns = 0, nacks = 0;
+};
+
+class I2cBus {
+public:
+    explicit I2cBus(uint32_t clock_hz = 400000) : bit_ns_(1000000000ull / clock_hz) {}
+    void attach(uint8_t address, I2cTarget* target) { targets_.push_back({address, target}); }
+
+    // Wire's register read and write: false on a NACK. The caller waits for the bus
+    // and the transfer, unless it runs from a device's event (an interrupt), whose
+    // transfer holds the bus for the next caller instead.
+    bool read(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length);
+    bool write(uint8_t address, uint8_t reg, uint8_t value);
+
+    const BusStats& stats() const { return stats_; }
+
+private:
+    I2cTarget* find(uint8_t address) const;
+    // The bus for bytes from when it is free; the start
+    uint64_t claim(uint32_t bytes, bool restart);
+    // Until t_ns, except in an interrupt, which cannot wait
+    void wait(uint64_t t_ns);
+
+    uint64_t bit_ns_;
+    uint64_t free_ns_ = 0;
+    BusStats stats_;
+    struct Entry { uint8_t address; I2cTarget* target; };
+    std::vector<Entry> targets_;
+};
+
+struct NoiseConfig {
+    float gyro_sigma = 0.003f;  // rad/s per sample, white
+    float gyro_bias = 0.002f;   // rad/s on each axis
+    float accel_sigma = 0.02f;  // m/s^2
+    float mag_sigma = 0.3f;     // uT
+    uint64_t seed = 1;
+};
+
+struct Lsm6dsoxStats {
+    uint64_t samples = 0, batched = 0, overwritten = 0, data_ready = 0;
+};
+
+class Lsm6dsoxSim : public I2cTarget, public Device {
+public:
+    static constexpr uint8_t address = 0x6A; // LSM6DS_I2CADDR_DEFAULT
+    static constexpr uint16_t fifo_words = 512;
+
+    Lsm6dsoxSim(I2cBus& bus, const Trajectory& trajectory, const NoiseConfig& noise = NoiseConfig());
+    ~Lsm6dsoxSim();
+
+    void read(uint8_t reg, uint8_t* buffer, uint8_t length) override;
+    void write(uint8_t reg, uint8_t value) override;
+    uint64_t next() const override;
+    void service(uint64_t now_ns) override;
+
+    // INT1 as attachInterrupt() would see it: isr runs at each rising edge
+    void attachInterrupt(std::function<void()> isr) { isr_ = isr; }
+
+    // The LSB scales of the configured ranges, rad/s and m/s^2 per count
+    float gyroLsb() const;
+    float accelLsb() const;
+    float odrHz() const;
+    // The motion of the latest sample, for scoring against
+    const Motion& truth() const { return truth_; }
+    uint16_t fifoLevel() const { return (uint16_t)fifo_.size(); }
+    const Lsm6dsoxStats& stats() const { return stats_; }
+
+private:
+    struct Word { uint8_t tag; uint8_t data[6]; };
+    void sample(uint64_t now_ns);
+    void push(uint8_t tag, const uint8_t* data);
+    void pop(); // the next word into FIFO_DATA_OUT_TAG..Z_H
+    static void put(uint8_t* out, const Vec3& v, float lsb);
+
+    const Trajectory& trajectory_;
+    NoiseConfig noise_;
+    Random random_;
+    uint8_t regs_[128] = {};
+    std::deque<Word> fifo_; // front is the oldest
+    uint8_t tag_count_ = 0;
+    bool ovr_latched_ = false, ovr_ia_ = false;
+    uint64_t next_ns_ = UINT64_MAX;
+    uint64_t timestamp_origin_ns_ = 0;
+    Motion truth_;
+    Lsm6dsoxStats stats_;
+    std::function<void()> isr_;
+};
+
+class Lis3mdlSim : public I2cTarget, public Device {
+public:
+    static constexpr uint8_t address = 0x1C; // LIS3MDL_I2CADDR_DEFAULT
+
+    Lis3mdlSim(I2cBus& bus, const Trajectory& trajectory, const NoiseConfig& noise = NoiseConfig());
+    ~Lis3mdlSim();
+
+    void read(uint8_t reg, uint8_t* buffer, uint8_t length) override;
+    void write(uint8_t reg, uint8_t value) override;
+    uint64_t next() const override;
+    void service(uint64_t now_ns) override;
+
+    // uT per count of the configured range
+    float lsb() const;
+    float odrHz() const;
+    uint64_t samples() const { return samples_; }
+
+private:
+    const Trajectory& trajectory_;
+    NoiseConfig noise_;
+    Random random_;
+    uint8_t regs_[64] = {};
+    uint64_t next_ns_ = UINT64_MAX;
+    uint64_t samples_ = 0;
+};
+
+} // namespace imu_sim
+
+#endif
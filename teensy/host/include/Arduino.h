@@ -0,0 +1,17 @@
+#ifndef HostArduino_h
+#define HostArduino_h
+
+/* The part of Arduino.h the compute libraries use, for host builds only:
+* the fixed-width types and libm. Anything touching hardware has no host
+* definition on purpose, so it fails to link rather than silently running.
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef PI
+    #define PI 3.1415926535897932384626433832795
+#endif
+
+#endif //HostArduino_h
@@ -0,0 +1,351 @@
+/* odrive_bench: the firmware's ODrive drivers end to end against the emulated
+* ODrive of odrive_sim.h, on its virtual clock, so what a transport costs the
+* control loop is measured without hardware and comes out the same each run.
+*
+*     odrive_bench [--transport uart-ascii|uart-binary|can|all] [--seconds s] [--rate-hz f]
+*                  [--baud n] [--latency-us t] [--jitter-us t] [--drop p] [--corrupt p] [--seed n]
+*                  [--poll-ns t] [--electrical] [--state-ms t] [--boards n]
+*                  [--fault axis:ms:axis|motor|encoder|controller:code]...
+*
+* Per transport, as main.cpp drives it: begin(), both axes into closed
+* loop, then at --rate-hz one requestFeedback(), readFeedback() and
+* setTorques() per tick, the torques a PD on a 1 Hz sine so the model moves,
+* and every --state-ms a readState() of both axes. A second phase runs the
+* same exchange back to back for --seconds to find the transport's ceiling.
+*
+* --boards runs the UART transports as a MotorBank of n emulated ODrives,
+* a UART each, so the exchange's growth with the actuator count shows: the
+* ASCII feedback is requested from all before it is waited for on any, the
+* binary batch is not. CAN stays one board, the emulated bus has one ODrive.
+* The faults go to the first board.
+*
+*     exchange_*_us   requestFeedback() to the end of setTorques(), virtual us
+*     overruns        ticks whose exchange did not end before the next tick
+*     failed          readFeedback() that returned false
+*     timeouts, crc_errors, parse_errors, send_failures, stale_reads
+*                     the driver's own counters
+*     back_to_back_hz exchanges per virtual second in the second phase; on CAN
+*                     the feedback is broadcast, so it is the bus that limits
+*     tracking_rms    turns between the target and the axes' feedback
+*     fault_seen_ms   per --fault: from the fault to the readState() that saw
+*                     the axis out of closed loop, -1 if none did
+*
+* Replies leave the ODrive --latency-us (+ uniform --jitter-us) after their
+* request's last byte, or CAN remote frame; --drop and --corrupt lose a
+* reply or flip one of its bits. micros() and millis() cost --poll-ns of
+* virtual time per call, the driver's busy-waits included.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <ODriveArduino.h>
+#include <ODriveBinary.h>
+#include <ODriveCANDriver.h>
+#include <MotorDriver.h>
+#include <MotorBank.h>
+#include "odrive_sim.h"
+
+using namespace odrive_sim;
+
+namespace {
+
+struct Options {
+    std::vector<std::string> transports{"uart-ascii", "uart-binary", "can"};
+    float seconds = 2.0f;
+    float rate_hz = 100.0f; // FILTER_UPDATE_RATE_HZ of the UART profiles
+    LinkConfig link;
+    CanConfig can;
+    uint32_t poll_ns = 50;
+    bool electrical = false;
+    uint32_t state_ms = 10;
+    int boards = 1;
+    std::vector<Fault> faults;
+};
+
+struct Result {
+    uint32_t ticks = 0, overruns = 0, failed = 0;
+    int axes = 2;
+    std::vector<float> exchange_us;
+    double back_to_back_hz = 0.0;
+    double tracking2 = 0.0;
+    uint32_t timeouts = 0, crc_errors = 0, parse_errors = 0, send_failures = 0, stale_reads = 0;
+    std::vector<double> fault_seen_ms;
+    LinkStats link;
+    CanStats can;
+    uint64_t bytes_to = 0, bytes_from = 0;
+    bool armed = false;
+};
+
+// The q-quantile of v, sorted in place
+float quantile(std::vector<float>& v, float q) {
+    if (v.empty()) return NAN;
+    std::sort(v.begin(), v.end());
+    return v[(size_t)lroundf(q*(v.size() - 1))];
+}
+
+// One exchange as main.cpp's controlStep() does it, over every board of the bank
+bool exchange(MotorBank& bank, float target, float* position, float* velocity, double& tracking2) {
+    bank.requestFeedback();
+    bool ok = bank.readFeedback(position, velocity);
+    float torque[2*MotorBank::max_boards];
+    for (int axis = 0; axis < bank.axes(); ++axis) {
+        torque[axis] = 0.5f*(target - position[axis]) - 0.01f*velocity[axis];
+        const double e = target - position[axis];
+        tracking2 += e*e;
+    }
+    bank.setTorques(torque);
+    if (ok) {
+        float current[2], vbus;
+        for (uint8_t i = 0; i < bank.boards(); ++i)
+            bank.board(i).readElectrical(current, vbus);
+    }
+    return ok;
+}
+
+bool armed(MotorBank& bank) {
+    for (uint8_t i = 0; i < bank.boards(); ++i)
+        for (int axis = 0; axis < 2; ++axis)
+            if (bank.board(i).readState(axis) != AXIS_STATE_CLOSED_LOOP_CONTROL) return false;
+    return true;
+}
+
+void run(MotorBank& bank, ODriveSim& odrive, const CanBus* bus, const Options& o, Result& r) {
+    MotorDriver& driver = bank.board(0);
+    r.axes = bank.axes();
+    if (!bank.begin()) {
+        fprintf(stderr, "%s: begin() failed\n", driver.name());
+        return;
+    }
+    for (uint8_t i = 0; i < bank.boards(); ++i) {
+        if (o.electrical && !bank.board(i).sampleElectrical(true))
+            fprintf(stderr, "%s: no electrical sampling on this transport\n", driver.name());
+        for (int axis = 0; axis < 2; ++axis)
+            bank.board(i).runState(axis, AXIS_STATE_CLOSED_LOOP_CONTROL, false);
+    }
+    // CAN reads the state from the heartbeat, so give it a few
+    for (uint32_t waited = 0; waited <= 1000 && !r.armed; waited += 10) {
+        r.armed = armed(bank);
+        if (!r.armed) delay(10);
+    }
+
+    // the faults count from the start of the paced phase
+    const uint64_t start_ns = Clock::now();
+    for (Fault f : o.faults) {
+        f.at_us += start_ns/1000;
+        odrive.inject(f);
+    }
+    r.fault_seen_ms.assign(o.faults.size(), -1.0);
+
+    const uint64_t period_ns = (uint64_t)(1e9 / o.rate_hz);
+    const uint64_t ticks = (uint64_t)(o.seconds*o.rate_hz);
+    const uint64_t state_every = std::max<uint64_t>(1, (uint64_t)(o.state_ms*1e6 / period_ns));
+    float position[2*MotorBank::max_boards] = {}, velocity[2*MotorBank::max_boards] = {};
+    for (uint64_t k = 0; k < ticks; ++k) {
+        const uint64_t tick_ns = start_ns + k*period_ns;
+        if (Clock::now() < tick_ns)
+            Clock::advanceTo(tick_ns);
+        else if (k)
+            ++r.overruns;
+        const float t = (Clock::now() - start_ns)*1e-9f;
+        const float target = 0.25f*sinf(2.0f*(float)PI*t);
+        const uint64_t begin = Clock::now();
+        if (!exchange(bank, target, position, velocity, r.tracking2))
+            ++r.failed;
+        r.exchange_us.push_back((Clock::now() - begin)*1e-3f);
+        ++r.ticks;
+
+        if (k % state_every == 0) {
+            for (size_t i = 0; i < o.faults.size(); ++i) {
+                const uint64_t at_ns = start_ns + o.faults[i].at_us*1000;
+                if (r.fault_seen_ms[i] >= 0.0 || Clock::now() < at_ns) continue;
+                if (driver.readState(o.faults[i].axis) != AXIS_STATE_CLOSED_LOOP_CONTROL)
+                    r.fault_seen_ms[i] = (Clock::now() - at_ns)*1e-6;
+            }
+        }
+    }
+
+    // the ceiling: the same exchange back to back, on CAN each once its frames are on the bus
+    const uint64_t b2b_start = Clock::now();
+    const uint64_t b2b_end = b2b_start + (uint64_t)(o.seconds*1e9);
+    uint64_t exchanges = 0;
+    double ignored = 0.0;
+    while (Clock::now() < b2b_end) {
+        exchange(bank, 0.0f, position, velocity, ignored);
+        ++exchanges;
+        while (bus && bus->hostWaiting() && Clock::now() < b2b_end)
+            Clock::poll();
+    }
+    r.back_to_back_hz = exchanges / ((Clock::now() - b2b_start)*1e-9);
+}
+
+std::unique_ptr<Result> bench(const std::string& transport, const Options& o) {
+    Clock::reset();
+    Clock::setPollCost(o.poll_ns);
+    std::unique_ptr<Result> r(new Result);
+    if (transport == "can") {
+        ODriveSim odrive;
+        CanBus bus(odrive, o.can);
+        ODriveCANDriver driver(o.can.node[0], o.can.node[1], o.can.baud, 3000*o.can.encoder_ms);
+        MotorDriver* const boards[1] = {&driver};
+        MotorBank bank(boards, 1);
+        run(bank, odrive, &bus, o, *r);
+        r->stale_reads = driver.staleReads();
+        r->send_failures = driver.sendFailures();
+        r->can = bus.stats();
+        return r;
+    }
+
+    // a UART per board, each seeded apart
+    std::vector<std::unique_ptr<ODriveSim>> odrives;
+    std::vector<std::unique_ptr<Uart>> uarts;
+    std::vector<std::unique_ptr<ODriveArduino>> ascii;
+    std::vector<std::unique_ptr<ODriveBinary>> binary;
+    std::vector<std::unique_ptr<MotorDriver>> drivers;
+    std::vector<MotorDriver*> boards;
+    for (int i = 0; i < o.boards; ++i) {
+        LinkConfig link = o.link;
+        link.seed += i;
+        odrives.emplace_back(new ODriveSim);
+        uarts.emplace_back(new Uart(*odrives.back(), link));
+        if (transport == "uart-ascii") {
+            ascii.emplace_back(new ODriveArduino(*uarts.back()));
+            drivers.emplace_back(new ODriveAsciiDriver(*ascii.back()));
+        } else {
+            binary.emplace_back(new ODriveBinary(*uarts.back()));
+            binary.back()->setTorqueConstant(odrives.back()->axis[0].config.torque_constant);
+            drivers.emplace_back(new ODriveBinaryDriver(*binary.back()));
+        }
+        boards.push_back(drivers.back().get());
+    }
+    MotorBank bank(boards.data(), (uint8_t)boards.size());
+    run(bank, *odrives[0], nullptr, o, *r);
+    for (const std::unique_ptr<ODriveArduino>& odrive : ascii) {
+        r->timeouts += odrive->replyTimeouts();
+        r->parse_errors += odrive->parseErrors();
+    }
+    for (const std::unique_ptr<ODriveBinary>& odrive : binary) {
+        r->timeouts += odrive->timeouts();
+        r->crc_errors += odrive->crcErrors();
+    }
+    for (const std::unique_ptr<Uart>& uart : uarts) {
+        const LinkStats& link = uart->stats();
+        r->link.requests += link.requests;
+        r->link.replies += link.replies;
+        r->link.dropped += link.dropped;
+        r->link.corrupted += link.corrupted;
+        r->link.rejected += link.rejected;
+        r->bytes_to += uart->bytesToODrive();
+        r->bytes_from += uart->bytesFromODrive();
+    }
+    return r;
+}
+
+void print(const std::string& transport, Result& r, const Options& o) {
+    const char* t = transport.c_str();
+    printf("%s armed %d\n", t, r.armed ? 1 : 0);
+    printf("%s axes %d\n", t, r.axes);
+    printf("%s ticks %u\n", t, r.ticks);
+    double sum = 0.0;
+    for (float us : r.exchange_us) sum += us;
+    printf("%s exchange_mean_us %.1f\n", t, r.exchange_us.empty() ? NAN : sum / r.exchange_us.size());
+    // quantile() sorts, so the last is the largest
+    const float p50 = quantile(r.exchange_us, 0.5f), p99 = quantile(r.exchange_us, 0.99f);
+    printf("%s exchange_p50_us %.1f\n", t, p50);
+    printf("%s exchange_p99_us %.1f\n", t, p99);
+    printf("%s exchange_max_us %.1f\n", t, r.exchange_us.empty() ? NAN : r.exchange_us.back());
+    printf("%s overruns %u\n", t, r.overruns);
+    printf("%s failed %u\n", t, r.failed);
+    printf("%s back_to_back_hz %.0f\n", t, r.back_to_back_hz);
+    printf("%s tracking_rms %.4f\n", t, r.ticks ? sqrt(r.tracking2 / ((double)r.axes*r.ticks)) : NAN);
+    if (transport == "can") {
+        printf("%s stale_reads %u\n", t, r.stale_reads);
+        printf("%s send_failures %u\n", t, r.send_failures);
+        printf("%s frames_to_odrive %llu\n", t, (unsigned long long)r.can.from_host);
+        printf("%s frames_from_odrive %llu\n", t, (unsigned long long)r.can.from_odrive);
+        printf("%s frames_dropped %llu\n", t, (unsigned long long)r.can.dropped);
+        printf("%s bus_load %.3f\n", t, r.can.busy_ns*1e-9 / (2.0*o.seconds));
+    } else {
+        printf("%s timeouts %u\n", t, r.timeouts);
+        printf("%s crc_errors %u\n", t, r.crc_errors);
+        printf("%s parse_errors %u\n", t, r.parse_errors);
+        printf("%s bytes_to_odrive %llu\n", t, (unsigned long long)r.bytes_to);
+        printf("%s bytes_from_odrive %llu\n", t, (unsigned long long)r.bytes_from);
+        printf("%s replies_dropped %llu\n", t, (unsigned long long)r.link.dropped);
+        printf("%s replies_corrupted %llu\n", t, (unsigned long long)r.link.corrupted);
+        printf("%s requests_rejected %llu\n", t, (unsigned long long)r.link.rejected);
+    }
+    for (size_t i = 0; i < r.fault_seen_ms.size(); ++i)
+        printf("%s fault_seen_ms %.1f\n", t, r.fault_seen_ms[i]);
+}
+
+bool parseFault(const char* spec, Fault& f) {
+    char source[16];
+    double ms;
+    char code[24];
+    if (sscanf(spec, "%d:%lf:%15[a-z]:%23s", &f.axis, &ms, source, code) != 4 || f.axis < 0 || f.axis > 1 || ms < 0.0)
+        return false;
+    f.at_us = (uint64_t)(ms*1000.0);
+    f.code = strtoull(code, nullptr, 0);
+    if (strcmp(source, "axis") == 0) f.source = AXIS_ERROR_WORD;
+    else if (strcmp(source, "motor") == 0) f.source = MOTOR_ERROR_WORD;
+    else if (strcmp(source, "encoder") == 0) f.source = ENCODER_ERROR_WORD;
+    else if (strcmp(source, "controller") == 0) f.source = CONTROLLER_ERROR_WORD;
+    else return false;
+    return f.code != 0;
+}
+
+bool parse(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; ++i) {
+        const bool more = i + 1 < argc;
+        if (strcmp(argv[i], "--transport") == 0 && more) {
+            std::string t = argv[++i];
+            if (t != "all") o.transports.assign(1, t);
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && more) o.seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--rate-hz") == 0 && more) o.rate_hz = atof(argv[++i]);
+        else if (strcmp(argv[i], "--baud") == 0 && more) o.link.baud = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--latency-us") == 0 && more) o.link.reply_latency_us = o.can.reply_latency_us = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--jitter-us") == 0 && more) o.link.jitter_us = o.can.jitter_us = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--drop") == 0 && more) o.link.drop = o.can.drop = atof(argv[++i]);
+        else if (strcmp(argv[i], "--corrupt") == 0 && more) o.link.corrupt = atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && more) o.link.seed = o.can.seed = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--poll-ns") == 0 && more) o.poll_ns = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--electrical") == 0) o.electrical = true;
+        else if (strcmp(argv[i], "--state-ms") == 0 && more) o.state_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--boards") == 0 && more) o.boards = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--fault") == 0 && more) {
+            Fault f;
+            if (!parseFault(argv[++i], f)) return false;
+            o.faults.push_back(f);
+        }
+        else return false;
+    }
+    for (const std::string& t : o.transports)
+        if (t != "uart-ascii" && t != "uart-binary" && t != "can") return false;
+    return o.seconds > 0.0f && o.rate_hz > 0.0f && o.boards >= 1 && o.boards <= MotorBank::max_boards && o.link.baud > 0 && o.poll_ns > 0 && o.state_ms > 0 &&
+           o.link.drop >= 0.0 && o.link.drop < 1.0 && o.link.corrupt >= 0.0 && o.link.corrupt < 1.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parse(argc, argv, o)) {
+        fprintf(stderr, "usage: %s [--transport uart-ascii|uart-binary|can|all] [--seconds s] [--rate-hz f]\n"
+                        "       [--baud n] [--latency-us t] [--jitter-us t] [--drop p] [--corrupt p] [--seed n]\n"
+                        "       [--poll-ns t] [--electrical] [--state-ms t] [--boards n]\n"
+                        "       [--fault axis:ms:axis|motor|encoder|controller:code]...\n", argv[0]);
+        return 2;
+    }
+    bool armed = true;
+    for (const std::string& t : o.transports) {
+        std::unique_ptr<Result> r = bench(t, o);
+        print(t, *r, o);
+        armed = armed && r->armed;
+    }
+    return armed ? 0 : 1;
+}
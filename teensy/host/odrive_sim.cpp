@@ -0,0 +1,724 @@
+#include "odrive_sim.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <ODriveBinary.h>
+#include <ODriveCANDriver.h>
+#include <odrive_endpoints.h>
+
+namespace odrive_sim {
+
+// Axis
+
+void Axis::reset() {
+    state = AXIS_STATE_IDLE;
+    requested_state = AXIS_STATE_UNDEFINED;
+    mode = TORQUE;
+    input_torque = input_vel = input_pos = 0.0f;
+    error = 0;
+    motor_error = 0;
+    encoder_error = controller_error = 0;
+    integrator_ = torque_ = 0.0f;
+}
+
+void Axis::step(float dt) {
+    float torque = 0.0f;
+    if (armed()) {
+        // the ODrive's cascade: position to velocity to torque, each term optional by mode
+        float vel_setpoint = mode == POSITION ? config.pos_gain*(input_pos - pos_) + input_vel : input_vel;
+        vel_setpoint = fmaxf(-config.vel_limit, fminf(config.vel_limit, vel_setpoint));
+        if (mode == TORQUE) {
+            torque = input_torque;
+            integrator_ = 0.0f;
+        } else {
+            const float error = vel_setpoint - vel_;
+            integrator_ += config.vel_integrator_gain*error*dt;
+            torque = config.vel_gain*error + integrator_ + input_torque;
+        }
+        // torque mode's velocity limiting, as controller.config.enable_torque_mode_vel_limit
+        if (mode == TORQUE && fabsf(vel_) > config.vel_limit && torque*vel_ > 0.0f)
+            torque = 0.0f;
+        torque = fmaxf(-config.torque_lim, fminf(config.torque_lim, torque));
+        if (fabsf(vel_) > 1.2f*config.vel_limit) {
+            controller_error |= CONTROLLER_ERROR_OVERSPEED;
+            state = AXIS_STATE_IDLE;
+            torque = 0.0f;
+        }
+    }
+    torque_ = torque;
+
+    // rigid inertia, viscous and Coulomb friction, semi-implicit Euler in rad
+    const float omega = 2.0f*(float)PI*vel_;
+    float net = torque - config.damping*omega;
+    const float coulomb = config.friction;
+    if (fabsf(omega) > 1e-3f) {
+        net -= omega > 0.0f ? coulomb : -coulomb;
+    } else if (fabsf(net) <= coulomb) {
+        net = 0.0f; // stiction holds a shaft at rest
+        vel_ = 0.0f;
+    } else {
+        net -= net > 0.0f ? coulomb : -coulomb;
+    }
+    const float omega_next = omega + net/config.inertia*dt;
+    // Coulomb friction stops a shaft rather than turning it round
+    vel_ = (omega != 0.0f && omega*omega_next < 0.0f ? 0.0f : omega_next) / (2.0f*(float)PI);
+    pos_ += vel_*dt;
+}
+
+// ODriveSim
+
+ODriveSim::ODriveSim(const MotorConfig& config, float vbus)
+    : axis{Axis(config), Axis(config)}, vbus(vbus) {
+    Clock::attach(this);
+    next_step_ns_ = (Clock::now() / control_period_ns + 1)*control_period_ns;
+}
+
+ODriveSim::~ODriveSim() { Clock::detach(this); }
+
+uint64_t ODriveSim::next() const {
+    return faults_.empty() ? next_step_ns_ : std::min(next_step_ns_, faults_.front().at_us*1000);
+}
+
+void ODriveSim::service(uint64_t now_ns) {
+    while (!faults_.empty() && faults_.front().at_us*1000 <= now_ns) {
+        apply(faults_.front());
+        faults_.erase(faults_.begin());
+    }
+    while (next_step_ns_ <= now_ns) {
+        for (Axis& a : axis) {
+            if (a.state_until_ns && next_step_ns_ >= a.state_until_ns) {
+                a.state = AXIS_STATE_IDLE;
+                a.state_until_ns = 0;
+            }
+            a.step(control_period_ns*1e-9f);
+        }
+        next_step_ns_ += control_period_ns;
+    }
+}
+
+void ODriveSim::requestState(int index, int state) {
+    Axis& a = axis[index];
+    a.requested_state = state;
+    a.state_until_ns = 0;
+    switch (state) {
+        case AXIS_STATE_IDLE:
+            a.state = AXIS_STATE_IDLE;
+            break;
+        case AXIS_STATE_CLOSED_LOOP_CONTROL:
+            // an axis with an error refuses to arm, and says so
+            if (a.failed()) {
+                a.error |= AXIS_ERROR_INVALID_STATE;
+                a.state = AXIS_STATE_IDLE;
+            } else {
+                a.state = AXIS_STATE_CLOSED_LOOP_CONTROL;
+            }
+            break;
+        case AXIS_STATE_FULL_CALIBRATION_SEQUENCE:
+        case AXIS_STATE_MOTOR_CALIBRATION:
+        case AXIS_STATE_ENCODER_INDEX_SEARCH:
+        case AXIS_STATE_ENCODER_OFFSET_CALIBRATION:
+        case AXIS_STATE_ENCODER_DIR_FIND:
+            if (a.failed()) {
+                a.error |= AXIS_ERROR_INVALID_STATE;
+                break;
+            }
+            a.state = state;
+            a.state_until_ns = Clock::now() + calibration_ns_;
+            break;
+        default:
+            a.error |= AXIS_ERROR_INVALID_STATE;
+            a.state = AXIS_STATE_IDLE;
+            break;
+    }
+}
+
+void ODriveSim::clearErrors() {
+    for (Axis& a : axis) {
+        a.error = 0;
+        a.motor_error = 0;
+        a.encoder_error = a.controller_error = 0;
+    }
+}
+
+void ODriveSim::reboot() {
+    for (Axis& a : axis) a.reset();
+}
+
+void ODriveSim::inject(const Fault& fault) {
+    auto at = std::upper_bound(faults_.begin(), faults_.end(), fault,
+                               [](const Fault& a, const Fault& b) { return a.at_us < b.at_us; });
+    faults_.insert(at, fault);
+}
+
+void ODriveSim::apply(const Fault& fault) {
+    Axis& a = axis[fault.axis];
+    switch (fault.source) {
+        case AXIS_ERROR_WORD:       a.error |= (uint32_t)fault.code; break;
+        case MOTOR_ERROR_WORD:      a.motor_error |= fault.code; break;
+        case ENCODER_ERROR_WORD:    a.encoder_error |= (uint32_t)fault.code; break;
+        case CONTROLLER_ERROR_WORD: a.controller_error |= (uint32_t)fault.code; break;
+    }
+    if (a.failed()) {
+        a.state = AXIS_STATE_IDLE;
+        a.state_until_ns = 0;
+    }
+    ++faults_applied;
+}
+
+// Wire
+
+void Wire::send(const uint8_t* data, size_t length, uint64_t start_ns) {
+    uint64_t t = std::max(start_ns, free_ns_);
+    for (size_t i = 0; i < length; ++i) {
+        t += byte_ns_;
+        bytes_.push_back({t, data[i]});
+    }
+    free_ns_ = t;
+    total_ += length;
+}
+
+size_t Wire::arrived(uint64_t now_ns) const {
+    size_t n = 0;
+    for (const Byte& b : bytes_) {
+        if (b.arrive_ns > now_ns) break;
+        ++n;
+    }
+    return n;
+}
+
+int Wire::read(uint64_t now_ns) {
+    if (bytes_.empty() || bytes_.front().arrive_ns > now_ns) return -1;
+    uint8_t c = bytes_.front().value;
+    bytes_.pop_front();
+    return c;
+}
+
+int Wire::peek(uint64_t now_ns) const {
+    if (bytes_.empty() || bytes_.front().arrive_ns > now_ns) return -1;
+    return bytes_.front().value;
+}
+
+// Uart
+
+static constexpr uint8_t PACKET_PREFIX = 0xAA;
+static constexpr uint8_t CRC8_INIT = 0x42;
+static constexpr uint16_t CRC16_INIT = 0x1337;
+static constexpr uint16_t ACK_FLAG = 0x8000;
+
+Uart::Uart(ODriveSim& odrive, const LinkConfig& config)
+    : odrive_(odrive), config_(config), random_(config.seed), to_odrive_(config.baud), from_odrive_(config.baud) {
+    Clock::attach(this);
+}
+
+Uart::~Uart() { Clock::detach(this); }
+
+int Uart::available() {
+    Clock::poll();
+    return (int)from_odrive_.arrived(Clock::now());
+}
+
+int Uart::read() { return from_odrive_.read(Clock::now()); }
+
+int Uart::peek() { return from_odrive_.peek(Clock::now()); }
+
+size_t Uart::write(const uint8_t* buffer, size_t size) {
+    // a full transmit ring blocks the writer until the wire has taken enough of it
+    while (to_odrive_.inFlight(Clock::now()) + size > config_.tx_buffer && to_odrive_.inFlight(Clock::now()))
+        Clock::advance(to_odrive_.byteNs());
+    to_odrive_.send(buffer, size, Clock::now());
+    return size;
+}
+
+void Uart::service(uint64_t now_ns) {
+    int c;
+    while ((c = to_odrive_.read(now_ns)) >= 0)
+        receive((uint8_t)c, now_ns);
+}
+
+void Uart::receive(uint8_t c, uint64_t now_ns) {
+    if (in_frame_) {
+        frame_.push_back(c);
+        // [prefix][len][crc8] first, then len bytes and the crc16
+        if (frame_.size() == 3 && frame_[2] != ODriveBinary::crc8(CRC8_INIT, frame_.data(), 2)) {
+            ++stats_.rejected;
+            in_frame_ = false;
+        } else if (frame_.size() >= 3 && frame_.size() == 3u + frame_[1] + 2u) {
+            in_frame_ = false;
+            binaryFrame(now_ns);
+        }
+        return;
+    }
+    if (c == PACKET_PREFIX && line_.empty()) {
+        in_frame_ = true;
+        frame_.assign(1, c);
+        return;
+    }
+    if (c == '\n' || c == '\r') {
+        if (!line_.empty()) asciiLine(now_ns);
+        line_.clear();
+        return;
+    }
+    if (line_.size() < 256) line_ += (char)c;
+}
+
+void Uart::reply(const uint8_t* data, size_t length, uint64_t now_ns) {
+    ++stats_.replies;
+    if (config_.drop > 0.0 && random_.uniform() < config_.drop) {
+        ++stats_.dropped;
+        return;
+    }
+    std::vector<uint8_t> out(data, data + length);
+    if (config_.corrupt > 0.0 && random_.uniform() < config_.corrupt && length) {
+        out[random_.next() % length] ^= 1u << (random_.next() % 8);
+        ++stats_.corrupted;
+    }
+    uint64_t latency_ns = config_.reply_latency_us*1000ull;
+    if (config_.jitter_us) latency_ns += (uint64_t)(random_.uniform()*config_.jitter_us*1000.0);
+    from_odrive_.send(out.data(), out.size(), now_ns + latency_ns);
+}
+
+static std::string formatFloat(double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.6f", value);
+    return text;
+}
+
+static std::string formatInt(long long value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%lld", value);
+    return text;
+}
+
+// "axis<n>." off the front of path, the axis in axis; -1 for a path of the ODrive itself
+static int splitAxis(const char*& path) {
+    if (strncmp(path, "axis", 4) == 0 && (path[4] == '0' || path[4] == '1') && path[5] == '.') {
+        int n = path[4] - '0';
+        path += 6;
+        return n;
+    }
+    return -1;
+}
+
+std::string Uart::readPath(const char* path) {
+    const char* p = path;
+    int n = splitAxis(p);
+    if (n < 0) {
+        if (strcmp(p, "vbus_voltage") == 0) return formatFloat(odrive_.vbus);
+    } else {
+        const Axis& a = odrive_.axis[n];
+        if (strcmp(p, "current_state") == 0) return formatInt(a.state);
+        if (strcmp(p, "requested_state") == 0) return formatInt(a.requested_state);
+        if (strcmp(p, "error") == 0) return formatInt(a.error);
+        if (strcmp(p, "motor.error") == 0) return formatInt((long long)a.motor_error);
+        if (strcmp(p, "encoder.error") == 0) return formatInt(a.encoder_error);
+        if (strcmp(p, "controller.error") == 0) return formatInt(a.controller_error);
+        if (strcmp(p, "encoder.pos_estimate") == 0) return formatFloat(a.posEstimate());
+        if (strcmp(p, "encoder.vel_estimate") == 0) return formatFloat(a.velEstimate());
+        if (strcmp(p, "motor.current_control.Iq_measured") == 0) return formatFloat(a.iqMeasured());
+        if (strcmp(p, "motor.current_control.Iq_setpoint") == 0) return formatFloat(a.iqMeasured());
+        if (strcmp(p, "controller.input_torque") == 0) return formatFloat(a.input_torque);
+        if (strcmp(p, "controller.input_vel") == 0) return formatFloat(a.input_vel);
+        if (strcmp(p, "controller.input_pos") == 0) return formatFloat(a.input_pos);
+        if (strcmp(p, "controller.config.control_mode") == 0) return formatInt(a.mode);
+    }
+    auto stored = odrive_.properties.find(path);
+    return formatFloat(stored == odrive_.properties.end() ? 0.0 : stored->second);
+}
+
+bool Uart::writePath(const char* path, const char* value) {
+    char* end;
+    double v = strtod(value, &end);
+    if (end == value) return false;
+    const char* p = path;
+    int n = splitAxis(p);
+    // everything is kept, so "r" reads back what was written
+    odrive_.properties[path] = v;
+    if (n < 0) return true;
+    Axis& a = odrive_.axis[n];
+    MotorConfig& c = a.config;
+    if (strcmp(p, "requested_state") == 0) odrive_.requestState(n, (int)v);
+    else if (strcmp(p, "controller.input_torque") == 0) a.input_torque = v;
+    else if (strcmp(p, "controller.input_vel") == 0) a.input_vel = v;
+    else if (strcmp(p, "controller.input_pos") == 0) a.input_pos = v;
+    else if (strcmp(p, "controller.config.control_mode") == 0) a.mode = (uint8_t)v;
+    else if (strcmp(p, "error") == 0) a.error = (uint32_t)v;
+    else if (strcmp(p, "motor.error") == 0) a.motor_error = (uint64_t)v;
+    else if (strcmp(p, "encoder.error") == 0) a.encoder_error = (uint32_t)v;
+    else if (strcmp(p, "controller.error") == 0) a.controller_error = (uint32_t)v;
+    else if (strcmp(p, "motor.config.torque_constant") == 0 && v > 0.0) c.torque_constant = v;
+    else if (strcmp(p, "motor.config.current_lim") == 0) c.torque_lim = v*c.torque_constant;
+    else if (strcmp(p, "controller.config.vel_limit") == 0) c.vel_limit = v;
+    else if (strcmp(p, "controller.config.pos_gain") == 0) c.pos_gain = v;
+    else if (strcmp(p, "controller.config.vel_gain") == 0) c.vel_gain = v;
+    else if (strcmp(p, "controller.config.vel_integrator_gain") == 0) c.vel_integrator_gain = v;
+    return true;
+}
+
+// The ASCII protocol's commands the firmware sends; anything else is answered as the ODrive does
+void Uart::asciiLine(uint64_t now_ns) {
+    ++stats_.requests;
+    char line[260];
+    snprintf(line, sizeof(line), "%s", line_.c_str());
+    // a trailing " *<checksum>" is accepted and ignored
+    if (char* star = strchr(line, '*')) *star = '\0';
+
+    char* args[6] = {};
+    int count = 0;
+    for (char* s = strtok(line, " "); s && count < 6; s = strtok(nullptr, " "))
+        args[count++] = s;
+    if (!count) return;
+    const char* cmd = args[0];
+    auto number = [&](int i) { return i < count ? (float)atof(args[i]) : 0.0f; };
+    auto axisArg = [&]() -> int {
+        int n = count > 1 ? atoi(args[1]) : -1;
+        return n == 0 || n == 1 ? n : -1;
+    };
+
+    if (strcmp(cmd, "w") == 0) {
+        if (count < 3 || !writePath(args[1], args[2])) {
+            ++stats_.rejected;
+            reply(std::string("invalid command format\r\n"), now_ns);
+        }
+    } else if (strcmp(cmd, "r") == 0) {
+        if (count < 2) {
+            ++stats_.rejected;
+            reply(std::string("invalid command format\r\n"), now_ns);
+            return;
+        }
+        reply(readPath(args[1]) + "\r\n", now_ns);
+    } else if (strcmp(cmd, "f") == 0) {
+        int n = axisArg();
+        if (n < 0) {
+            reply(std::string("invalid motor\r\n"), now_ns);
+            return;
+        }
+        const Axis& a = odrive_.axis[n];
+        reply(formatFloat(a.posEstimate()) + " " + formatFloat(a.velEstimate()) + "\r\n", now_ns);
+    } else if (strcmp(cmd, "c") == 0 || strcmp(cmd, "v") == 0 || strcmp(cmd, "p") == 0 || strcmp(cmd, "t") == 0) {
+        int n = axisArg();
+        if (n < 0) {
+            reply(std::string("invalid motor\r\n"), now_ns);
+            return;
+        }
+        Axis& a = odrive_.axis[n];
+        if (cmd[0] == 'c') {
+            a.mode = Axis::TORQUE;
+            a.input_torque = number(2)*a.config.torque_constant;
+        } else if (cmd[0] == 'v') {
+            a.mode = Axis::VELOCITY;
+            a.input_vel = number(2);
+            a.input_torque = number(3);
+        } else if (cmd[0] == 'p') {
+            a.mode = Axis::POSITION;
+            a.input_pos = number(2);
+            a.input_vel = number(3);
+            a.input_torque = number(4);
+        } else {
+            a.mode = Axis::POSITION;
+            a.input_pos = number(2);
+            a.input_vel = a.input_torque = 0.0f;
+        }
+    } else if (strcmp(cmd, "sc") == 0) {
+        odrive_.clearErrors();
+    } else if (strcmp(cmd, "sr") == 0) {
+        odrive_.reboot();
+    } else if (strcmp(cmd, "ss") == 0 || strcmp(cmd, "se") == 0 || strcmp(cmd, "u") == 0) {
+        // saved, erased, the watchdog fed: nothing the model keeps
+    } else {
+        ++stats_.rejected;
+        reply(std::string("unknown command\r\n"), now_ns);
+    }
+}
+
+void Uart::binaryFrame(uint64_t now_ns) {
+    ++stats_.requests;
+    const size_t length = frame_[1];
+    const uint8_t* payload = frame_.data() + 3;
+    uint16_t crc = (payload[length] << 8) | payload[length + 1];
+    if (length < 8 || crc != ODriveBinary::crc16(CRC16_INIT, payload, length)) {
+        ++stats_.rejected;
+        return;
+    }
+    uint16_t seq, endpoint, reply_length, json_crc;
+    memcpy(&seq, payload, 2);
+    memcpy(&endpoint, payload + 2, 2);
+    memcpy(&reply_length, payload + 4, 2);
+    memcpy(&json_crc, payload + length - 2, 2);
+    // the ODrive ignores requests for another endpoint table
+    if (json_crc != odrive::json_crc || reply_length > ODriveBinary::max_payload) {
+        ++stats_.rejected;
+        return;
+    }
+    const bool ack = endpoint & ACK_FLAG;
+    endpoint &= ~ACK_FLAG;
+    const size_t tx_length = length - 8;
+    if (tx_length) writeEndpoint(endpoint, payload + 6, tx_length);
+
+    if (!ack) return;
+    uint8_t out[3 + 2 + ODriveBinary::max_payload + 2];
+    uint8_t* p = out + 3;
+    uint16_t reply_seq = seq | ACK_FLAG;
+    memcpy(p, &reply_seq, 2);
+    memset(p + 2, 0, reply_length);
+    if (reply_length && !readEndpoint(endpoint, p + 2, reply_length)) ++stats_.rejected;
+    size_t n = 2 + reply_length;
+    out[0] = PACKET_PREFIX;
+    out[1] = n;
+    out[2] = ODriveBinary::crc8(CRC8_INIT, out, 2);
+    uint16_t reply_crc = ODriveBinary::crc16(CRC16_INIT, p, n);
+    p[n++] = reply_crc >> 8;
+    p[n++] = reply_crc & 0xff;
+    reply(out, 3 + n, now_ns);
+}
+
+template<class T> static bool put(uint8_t* out, size_t length, T value) {
+    if (length < sizeof(T)) return false;
+    memcpy(out, &value, sizeof(T));
+    return true;
+}
+
+// The endpoints ODriveBinary and ODriveBinaryDriver use, positions and velocities in turns
+bool Uart::readEndpoint(uint16_t id, uint8_t* out, size_t length) {
+    if (id == odrive::VBUS_VOLTAGE) return put(out, length, odrive_.vbus);
+    if (id < odrive::AXIS__ERROR) return false;
+    const int n = (id - odrive::AXIS__ERROR) / odrive::per_axis_offset;
+    if (n > 1) return false;
+    const Axis& a = odrive_.axis[n];
+    switch (id - n*odrive::per_axis_offset) {
+        case odrive::AXIS__ERROR:             return put(out, length, (uint16_t)a.error);
+        case odrive::AXIS__CURRENT_STATE:     return put(out, length, a.state);
+        case odrive::AXIS__REQUESTED_STATE:   return put(out, length, a.requested_state);
+        case odrive::AXIS__MOTOR__CURRENT_CONTROL__IQ_MEASURED: return put(out, length, a.iqMeasured());
+        case odrive::AXIS__CONTROLLER__POS_SETPOINT:     return put(out, length, a.input_pos);
+        case odrive::AXIS__CONTROLLER__VEL_SETPOINT:     return put(out, length, a.input_vel);
+        case odrive::AXIS__CONTROLLER__CURRENT_SETPOINT:
+            return put(out, length, a.input_torque / a.config.torque_constant);
+        case odrive::AXIS__ENCODER__POS_ESTIMATE: return put(out, length, a.posEstimate());
+        case odrive::AXIS__ENCODER__PLL_VEL:      return put(out, length, a.velEstimate());
+        default: return false;
+    }
+}
+
+void Uart::writeEndpoint(uint16_t id, const uint8_t* in, size_t length) {
+    if (id < odrive::AXIS__ERROR) return;
+    const int n = (id - odrive::AXIS__ERROR) / odrive::per_axis_offset;
+    if (n > 1) return;
+    Axis& a = odrive_.axis[n];
+    const uint16_t base = id - n*odrive::per_axis_offset;
+    float value = 0.0f;
+    if (length == sizeof(float)) memcpy(&value, in, sizeof(value));
+    // the table predates control_mode writes: the first setpoint of a burst sets the mode, the
+    // ones after it are its feed-forwards, as ODriveBinaryDriver writes them
+    const uint16_t last = last_write_[n];
+    switch (base) {
+        case odrive::AXIS__REQUESTED_STATE:
+            if (length >= 1) odrive_.requestState(n, in[0]);
+            break;
+        case odrive::AXIS__ERROR:
+            if (length >= 2) a.error = in[0] | (in[1] << 8);
+            break;
+        case odrive::AXIS__CONTROLLER__POS_SETPOINT:
+            a.mode = Axis::POSITION;
+            a.input_pos = value;
+            a.input_vel = a.input_torque = 0.0f;
+            break;
+        case odrive::AXIS__CONTROLLER__VEL_SETPOINT:
+            if (last != odrive::AXIS__CONTROLLER__POS_SETPOINT) {
+                a.mode = Axis::VELOCITY;
+                a.input_torque = 0.0f;
+            }
+            a.input_vel = value;
+            break;
+        case odrive::AXIS__CONTROLLER__CURRENT_SETPOINT:
+            if (last != odrive::AXIS__CONTROLLER__POS_SETPOINT && last != odrive::AXIS__CONTROLLER__VEL_SETPOINT)
+                a.mode = Axis::TORQUE;
+            a.input_torque = value*a.config.torque_constant;
+            break;
+        default:
+            return;
+    }
+    last_write_[n] = base;
+}
+
+// CanBus
+
+CanBus* CanBus::current = nullptr;
+
+CanBus::CanBus(ODriveSim& odrive, const CanConfig& config)
+    : odrive_(odrive), config_(config), random_(config.seed) {
+    current = this;
+    next_heartbeat_ns_ = next_encoder_ns_ = Clock::now();
+    Clock::attach(this);
+}
+
+CanBus::~CanBus() {
+    Clock::detach(this);
+    if (current == this) current = nullptr;
+}
+
+// The worst case of a standard frame: 47 bits of overhead and the data, stuffed one bit in four
+uint64_t CanBus::frameNs(const CAN_message_t& msg) const {
+    const uint32_t data = msg.flags.remote ? 0 : 8u*msg.len;
+    const uint32_t bits = 47 + data + (34 + data - 1)/4;
+    return bits*1000000000ull / config_.baud;
+}
+
+size_t CanBus::hostWaiting() const {
+    size_t waiting = busy_ && on_wire_.from_host;
+    for (const Frame& f : pending_) waiting += f.from_host;
+    return waiting;
+}
+
+int CanBus::write(const CAN_message_t& msg) {
+    size_t waiting = 0;
+    for (const Frame& f : pending_) waiting += f.from_host;
+    if (waiting >= 16) {
+        ++stats_.tx_full;
+        return 0;
+    }
+    pending_.push_back({Clock::now(), true, msg});
+    ++stats_.from_host;
+    return 1;
+}
+
+uint64_t CanBus::next() const {
+    uint64_t n = std::min(next_heartbeat_ns_, next_encoder_ns_);
+    if (busy_) return std::min(n, wire_done_ns_);
+    for (const Frame& f : pending_) n = std::min(n, f.ready_ns);
+    return n;
+}
+
+void CanBus::fromODrive(int axis, uint8_t command, const void* data, uint64_t ready_ns) {
+    CAN_message_t msg;
+    msg.id = (config_.node[axis] << 5) | command;
+    msg.len = 8;
+    memcpy(msg.buf, data, 8);
+    if (config_.drop > 0.0 && random_.uniform() < config_.drop) {
+        ++stats_.dropped;
+        return;
+    }
+    pending_.push_back({ready_ns, false, msg});
+    ++stats_.from_odrive;
+}
+
+void CanBus::broadcast(uint64_t now_ns) {
+    while (next_heartbeat_ns_ <= now_ns) {
+        for (int n = 0; n < 2; ++n) {
+            uint8_t data[8] = {};
+            uint32_t error = odrive_.axis[n].error;
+            memcpy(data, &error, 4);
+            data[4] = odrive_.axis[n].state;
+            fromODrive(n, ODriveCANDriver::HEARTBEAT, data, next_heartbeat_ns_);
+        }
+        next_heartbeat_ns_ += config_.heartbeat_ms*1000000ull;
+    }
+    while (next_encoder_ns_ <= now_ns) {
+        for (int n = 0; n < 2; ++n) {
+            float data[2] = {odrive_.axis[n].posEstimate(), odrive_.axis[n].velEstimate()};
+            fromODrive(n, ODriveCANDriver::GET_ENCODER_ESTIMATES, data, next_encoder_ns_);
+        }
+        next_encoder_ns_ += config_.encoder_ms*1000000ull;
+    }
+}
+
+void CanBus::service(uint64_t now_ns) {
+    broadcast(now_ns);
+    if (busy_ && wire_done_ns_ <= now_ns) {
+        busy_ = false;
+        deliver(on_wire_, wire_done_ns_);
+    }
+    if (busy_) return;
+    // arbitration among the frames ready: the lowest id wins
+    auto winner = pending_.end();
+    for (auto f = pending_.begin(); f != pending_.end(); ++f)
+        if (f->ready_ns <= now_ns && (winner == pending_.end() || f->msg.id < winner->msg.id))
+            winner = f;
+    if (winner == pending_.end()) return;
+    on_wire_ = *winner;
+    pending_.erase(winner);
+    busy_ = true;
+    const uint64_t length = frameNs(on_wire_.msg);
+    wire_done_ns_ = now_ns + length;
+    stats_.busy_ns += length;
+}
+
+void CanBus::deliver(const Frame& frame, uint64_t now_ns) {
+    if (!frame.from_host) {
+        if (handler_) handler_(frame.msg);
+        return;
+    }
+    int n = -1;
+    for (int i = 0; i < 2; ++i)
+        if ((frame.msg.id >> 5) == config_.node[i]) n = i;
+    if (n < 0) return;
+    Axis& a = odrive_.axis[n];
+    const uint8_t* d = frame.msg.buf;
+    uint64_t latency_ns = config_.reply_latency_us*1000ull;
+    if (config_.jitter_us) latency_ns += (uint64_t)(random_.uniform()*config_.jitter_us*1000.0);
+    float f[2];
+    memcpy(f, d, 8);
+    switch (frame.msg.id & 0x1f) {
+        case ODriveCANDriver::ESTOP:
+            a.error |= AXIS_ERROR_ESTOP_REQUESTED;
+            a.state = AXIS_STATE_IDLE;
+            break;
+        case ODriveCANDriver::SET_AXIS_REQUESTED_STATE: {
+            uint32_t state;
+            memcpy(&state, d, 4);
+            odrive_.requestState(n, (int)state);
+            break;
+        }
+        case ODriveCANDriver::SET_INPUT_POS: {
+            int16_t ff[2];
+            memcpy(ff, d + 4, 4);
+            a.mode = Axis::POSITION;
+            a.input_pos = f[0];
+            a.input_vel = ff[0]*0.001f;
+            a.input_torque = ff[1]*0.001f;
+            break;
+        }
+        case ODriveCANDriver::SET_INPUT_VEL:
+            a.mode = Axis::VELOCITY;
+            a.input_vel = f[0];
+            a.input_torque = f[1];
+            break;
+        case ODriveCANDriver::SET_INPUT_TORQUE:
+            a.mode = Axis::TORQUE;
+            a.input_torque = f[0];
+            break;
+        case ODriveCANDriver::CLEAR_ERRORS:
+            odrive_.clearErrors();
+            break;
+        case ODriveCANDriver::GET_ENCODER_ESTIMATES: {
+            if (!frame.msg.flags.remote) break;
+            float data[2] = {a.posEstimate(), a.velEstimate()};
+            fromODrive(n, ODriveCANDriver::GET_ENCODER_ESTIMATES, data, now_ns + latency_ns);
+            break;
+        }
+        case ODriveCANDriver::GET_IQ: {
+            if (!frame.msg.flags.remote) break;
+            float data[2] = {a.iqMeasured(), a.iqMeasured()};
+            fromODrive(n, ODriveCANDriver::GET_IQ, data, now_ns + latency_ns);
+            break;
+        }
+        case ODriveCANDriver::GET_VBUS_VOLTAGE: {
+            if (!frame.msg.flags.remote) break;
+            float data[2] = {odrive_.vbus, 0.0f};
+            fromODrive(n, ODriveCANDriver::GET_VBUS_VOLTAGE, data, now_ns + latency_ns);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void canAttach(_MB_ptr handler, uint32_t baud_rate) {
+    (void)baud_rate; // the bus runs at its CanConfig's rate
+    if (CanBus::current) CanBus::current->attach(handler);
+}
+
+int canWrite(const CAN_message_t& msg) {
+    return CanBus::current ? CanBus::current->write(msg) : 0;
+}
+
+} // namespace odrive_sim
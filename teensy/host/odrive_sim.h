@@ -0,0 +1,289 @@
+#ifndef HOST_ODRIVE_SIM_H
+#define HOST_ODRIVE_SIM_H
+
+/* A two-axis ODrive (firmware 0.5) emulated on the host, for running the
+* firmware's own drivers (ODriveArduino, ODriveBinary, ODriveCANDriver)
+* against it without hardware. Everything runs on one virtual clock
+* (sim_clock.h, what sim/Arduino.h's micros() reads), so a run is the same
+* run every time.
+*
+*     Axis      a motor on a rigid inertia with viscous and Coulomb friction,
+*               integrated at the ODrive's 8 kHz; torque, velocity and
+*               position control like the ODrive's controller (torque_lim
+*               and vel_limit included), current_state and the four error
+*               words of ODriveEnums.h
+*     ODriveSim both axes, the requested_state transitions (the calibration
+*               states take calibration_ms, then IDLE) and injected faults
+*     Uart      the ODrive's UART as a Stream: bytes take 10 bit times each
+*               way, ASCII lines and native frames are told apart by the
+*               0xAA prefix as the ODrive does, and each reply leaves after
+*               reply_latency_us (+ jitter); replies can be dropped or have
+*               a bit flipped
+*     CanBus    CANSimple on a 1 Mbit/s bus: lowest id wins arbitration,
+*               frames take their worst-case stuffed length, the heartbeat
+*               and encoder estimates are broadcast at their rates and the
+*               remote frames for Iq and vbus answered after the latency
+*
+* Injected faults are ODriveEnums.h codes: at their time they are or-ed into
+* the axis', motor's, encoder's or controller's error and the axis drops to
+* IDLE, as the ODrive disarms; clear_errors (or "sc") clears them.
+*/
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <FlexCAN_T4.h>
+#include <ODriveEnums.h>
+#include "sim_clock.h"
+
+namespace odrive_sim {
+
+using sim::Clock;
+using sim::Device;
+using sim::Random;
+
+struct MotorConfig {
+    float inertia = 2.0e-4f;          // kg m^2 at the motor shaft, the gear and the wheel reflected
+    float damping = 1.0e-4f;          // Nm per rad/s
+    float friction = 5.0e-3f;         // Nm of Coulomb friction
+    float torque_constant = 8.23f/210.0f; // Nm/A, RobotModel's
+    float torque_lim = 0.8f;          // Nm, current_lim times the torque constant
+    float vel_limit = 20.0f;          // turns/s
+    float pos_gain = 20.0f;           // (turns/s)/turn
+    float vel_gain = 0.02f;           // Nm/(turns/s)
+    float vel_integrator_gain = 0.1f; // Nm/turn
+    int cpr = 8192;                   // counts per turn the position estimate is quantized to
+};
+
+enum ErrorSource : uint8_t { AXIS_ERROR_WORD, MOTOR_ERROR_WORD, ENCODER_ERROR_WORD, CONTROLLER_ERROR_WORD };
+
+// An injected fault: at at_us, code into the error word of source on axis
+struct Fault {
+    uint64_t at_us;
+    int axis;
+    ErrorSource source;
+    uint64_t code;
+};
+
+class Axis {
+public:
+    enum Mode : uint8_t { TORQUE = CONTROL_MODE_TORQUE_CONTROL, VELOCITY = CONTROL_MODE_VELOCITY_CONTROL,
+                          POSITION = CONTROL_MODE_POSITION_CONTROL };
+
+    explicit Axis(const MotorConfig& config) : config(config) {}
+
+    // One control period of dt seconds
+    void step(float dt);
+    void reset();
+
+    bool armed() const { return state == AXIS_STATE_CLOSED_LOOP_CONTROL; }
+    bool failed() const { return error || motor_error || encoder_error || controller_error; }
+    float torque() const { return torque_; }
+    float iqMeasured() const { return torque_ / config.torque_constant; }
+    // The estimates as the encoder reports them, position quantized to the cpr
+    float posEstimate() const { return floorf(pos_*config.cpr) / config.cpr; }
+    float velEstimate() const { return vel_; }
+
+    MotorConfig config;
+    uint8_t state = AXIS_STATE_IDLE;
+    uint8_t requested_state = AXIS_STATE_UNDEFINED;
+    uint64_t state_until_ns = 0;  // end of a calibration state
+    uint8_t mode = TORQUE;
+    float input_torque = 0.0f, input_vel = 0.0f, input_pos = 0.0f;
+    uint32_t error = 0;
+    uint64_t motor_error = 0;
+    uint32_t encoder_error = 0;
+    uint32_t controller_error = 0;
+
+private:
+    float pos_ = 0.0f;        // turns
+    float vel_ = 0.0f;        // turns/s
+    float integrator_ = 0.0f; // Nm
+    float torque_ = 0.0f;     // Nm, last applied
+};
+
+class ODriveSim : public Device {
+public:
+    static constexpr uint32_t control_period_ns = 125000;
+
+    explicit ODriveSim(const MotorConfig& config = MotorConfig(), float vbus = 24.0f);
+    ~ODriveSim();
+
+    uint64_t next() const override;
+    void service(uint64_t now_ns) override;
+
+    void requestState(int axis, int state);
+    void clearErrors();
+    // The power cycle "sr" asks for: errors, states and setpoints gone, the stored properties kept
+    void reboot();
+    void inject(const Fault& fault);
+    void setCalibrationTime(uint32_t ms) { calibration_ns_ = ms*1000000ull; }
+
+    Axis axis[2];
+    float vbus;
+    // Properties the model does not interpret, as written ("r" reads them back, 0 if never written)
+    std::map<std::string, double> properties;
+    uint32_t faults_applied = 0;
+
+private:
+    void apply(const Fault& fault);
+
+    uint64_t next_step_ns_ = control_period_ns;
+    uint64_t calibration_ns_ = 500000000ull;
+    std::vector<Fault> faults_; // by time
+};
+
+// One direction of a UART in flight: bytes with the ns they are in the receiver's FIFO
+class Wire {
+public:
+    explicit Wire(uint32_t baud) : byte_ns_(10000000000ull / baud) {}
+    // Queue bytes on the wire from start_ns on, back to back after whatever is still going out
+    void send(const uint8_t* data, size_t length, uint64_t start_ns);
+    // Bytes in the FIFO by now_ns
+    size_t arrived(uint64_t now_ns) const;
+    // Bytes whose last bit is not through by now_ns
+    size_t inFlight(uint64_t now_ns) const { return bytes_.size() - arrived(now_ns); }
+    int read(uint64_t now_ns);
+    int peek(uint64_t now_ns) const;
+    uint64_t firstArrival() const { return bytes_.empty() ? UINT64_MAX : bytes_.front().arrive_ns; }
+    uint64_t byteNs() const { return byte_ns_; }
+    uint64_t bytes() const { return total_; }
+
+private:
+    struct Byte {
+        uint64_t arrive_ns;
+        uint8_t value;
+    };
+    uint64_t byte_ns_;
+    uint64_t free_ns_ = 0;
+    uint64_t total_ = 0;
+    std::deque<Byte> bytes_;
+};
+
+struct LinkConfig {
+    uint32_t baud = 921600;        // the UART's, ODRIVE_BAUD
+    uint32_t tx_buffer = 64 + 2048; // Serial1's ring and ODRIVE_SERIAL_TX_BUFFER: write() blocks past it
+    uint32_t reply_latency_us = 50; // from the last byte of a request to the first of its reply
+    uint32_t jitter_us = 0;         // uniform extra latency
+    double drop = 0.0;              // probability a reply is never sent
+    double corrupt = 0.0;           // probability one bit of a reply is flipped
+    uint64_t seed = 1;
+};
+
+struct LinkStats {
+    uint64_t requests = 0;
+    uint64_t replies = 0;
+    uint64_t dropped = 0;   // replies dropped by injection
+    uint64_t corrupted = 0; // replies with a flipped bit
+    uint64_t rejected = 0;  // lines or frames the ODrive could not parse or check
+};
+
+// The Teensy's Serial1 wired to an emulated ODrive's UART
+class Uart : public Stream, public Device {
+public:
+    Uart(ODriveSim& odrive, const LinkConfig& config = LinkConfig());
+    ~Uart();
+
+    // The Teensy's side
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    uint64_t next() const override { return to_odrive_.firstArrival(); }
+    void service(uint64_t now_ns) override;
+
+    const LinkStats& stats() const { return stats_; }
+    uint64_t bytesToODrive() const { return to_odrive_.bytes(); }
+    uint64_t bytesFromODrive() const { return from_odrive_.bytes(); }
+
+private:
+    void receive(uint8_t c, uint64_t now_ns);
+    void asciiLine(uint64_t now_ns);
+    void binaryFrame(uint64_t now_ns);
+    void reply(const uint8_t* data, size_t length, uint64_t now_ns);
+    void reply(const std::string& text, uint64_t now_ns) { reply((const uint8_t*)text.data(), text.size(), now_ns); }
+    bool readEndpoint(uint16_t id, uint8_t* out, size_t length);
+    void writeEndpoint(uint16_t id, const uint8_t* in, size_t length);
+    std::string readPath(const char* path);
+    bool writePath(const char* path, const char* value);
+
+    ODriveSim& odrive_;
+    LinkConfig config_;
+    Random random_;
+    Wire to_odrive_, from_odrive_;
+    LinkStats stats_;
+    std::string line_;
+    std::vector<uint8_t> frame_;
+    bool in_frame_ = false;
+    uint16_t last_write_[2] = {}; // each axis' last setpoint endpoint, for which of them is the feed-forward
+};
+
+struct CanConfig {
+    uint32_t baud = 1000000;
+    uint8_t node[2] = {0, 1};
+    uint32_t heartbeat_ms = 100;
+    uint32_t encoder_ms = 1;        // ODRIVE_CAN_ENCODER_RATE_MS
+    uint32_t reply_latency_us = 50; // reception to the reply of a remote frame
+    uint32_t jitter_us = 0;
+    double drop = 0.0;              // probability a frame from the ODrive is lost
+    uint64_t seed = 1;
+};
+
+struct CanStats {
+    uint64_t from_host = 0;
+    uint64_t from_odrive = 0;
+    uint64_t dropped = 0;
+    uint64_t tx_full = 0; // host writes refused with 16 frames waiting
+    uint64_t busy_ns = 0; // bus time taken by frames
+};
+
+// The bus between the Teensy's FlexCAN1 and an emulated ODrive's two CANSimple nodes
+class CanBus : public Device {
+public:
+    CanBus(ODriveSim& odrive, const CanConfig& config = CanConfig());
+    ~CanBus();
+
+    // FlexCAN_T4.h's end
+    void attach(_MB_ptr handler) { handler_ = handler; }
+    int write(const CAN_message_t& msg);
+
+    uint64_t next() const override;
+    void service(uint64_t now_ns) override;
+
+    const CanStats& stats() const { return stats_; }
+    // Frames from the host still waiting for the bus or on it
+    size_t hostWaiting() const;
+    // The bus in use, for FlexCAN_T4.h; null if none
+    static CanBus* current;
+
+private:
+    struct Frame {
+        uint64_t ready_ns;
+        bool from_host;
+        CAN_message_t msg;
+    };
+
+    uint64_t frameNs(const CAN_message_t& msg) const;
+    void deliver(const Frame& frame, uint64_t now_ns);
+    void fromODrive(int axis, uint8_t command, const void* data, uint64_t ready_ns);
+    void broadcast(uint64_t now_ns);
+
+    ODriveSim& odrive_;
+    CanConfig config_;
+    Random random_;
+    _MB_ptr handler_ = nullptr;
+    std::vector<Frame> pending_;
+    bool busy_ = false;
+    Frame on_wire_{};
+    uint64_t wire_done_ns_ = 0;
+    uint64_t next_heartbeat_ns_ = 0;
+    uint64_t next_encoder_ns_ = 0;
+    CanStats stats_;
+};
+
+} // namespace odrive_sim
+
+#endif //HOST_ODRIVE_SIM_H
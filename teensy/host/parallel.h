@@ -0,0 +1,27 @@
+#ifndef HOST_PARALLEL_H
+#define HOST_PARALLEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace host {
+
+// f(i) for i in [0, count) on up to threads workers
+template<class F>
+void parallelFor(size_t count, int threads, F f) {
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads && (size_t)t < count; ++t)
+        workers.emplace_back([&] {
+            for (size_t i; (i = next++) < count;)
+                f(i);
+        });
+    for (std::thread& w : workers)
+        w.join();
+}
+
+} // namespace host
+
+#endif //HOST_PARALLEL_H
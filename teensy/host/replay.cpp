@@ -0,0 +1,480 @@
+/* replay: recorded runs through the firmware's estimators, impact map and
+* controller on the host, as fast as they go, with what they output and how
+* long every stage took.
+*
+*     replay [--csv out.csv] [--repeat n] [--event kind [n]] [--seconds s] [--resume n] RUN.bson|FLIGHTnn.BIN|RUN.rwa ...
+*
+* A hardware_data .bson is the 100 Hz sensorData the Julia controllers
+* logged, [roll, pi + spoke 0, roll rate, spoke 0 rate, pi + spoke 1, spoke 1
+* rate, yaw], as the firmware published it: the attitude filter was already
+* applied and there are no stamps, so samples are taken 10 ms apart. A flight
+* recorder log (FlightLogFormat.h) adds the stamps, the raw gyro and accel and
+* the torque commanded, so the attitude filter and the controller are checked
+* against the robot as well. A run archive (archive.h) replays as the run it
+* was packed from.
+*
+* --event replays only a window of each run around its n-th (0 by default)
+* event of a kind (impact, estop_on, estop_off, odrive_errors, controller)
+* from the run's event index (runs.h): a second before it, for the filters
+* to settle, and --seconds (1 by default) after. A run without that event is
+* skipped.
+*
+* --resume n also snapshots the estimators (EstimatorSnapshot.h) before the
+* n-th sample of the last repeat, restores them into fresh ones and replays
+* from there, and counts the samples whose outputs differ by a bit from the
+* uninterrupted run's: resume_mismatches should be 0, or some estimator has
+* state the snapshot does not carry.
+*
+* The stages run in controlStep()'s order with main.cpp's defaults:
+*
+*     attitude    TorsoEstimator with MahonyFilter on gyro and accel (flight
+*                 logs only)
+*     velocity    VelocityEstimator tracking and Savitzky-Golay, and the
+*                 differenced angle through the SpokeRate low-pass, on spoke 0
+*     impact      ImpactDetector on the spoke 0 angle and rate
+*     impact_map  ImpactMap table at each detected impact, against the rate
+*                 measured one sample later
+*     terrain     TerrainEstimator on the spoke 0 angle, fed the detected
+*                 impacts' touchdown times
+*     ekf         HybridEKF<RimlessWheel> predict, detector jump and correct
+*     pbc         NeuralPBC deter_hardware_even_1mpers, as ONBOARD_PBC
+*     pbc_bayes   PosteriorBank rw_bayesian over its 10 exported samples
+*
+* Errors are RMS against the recorded value, n/a where no sample had one (a
+* .bson run records no torque or roll); timings are per call, with the
+* clock's own overhead subtracted. The summary is one "key value" per line so
+* two builds can be diffed; --csv writes every sample's outputs. The exit code
+* is 1 if any stage produced a non-finite value.
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <FlightLogFormat.h>
+#include <RobotModel.h>
+#include <ImpactMap.h>
+#include <HybridEKF.h>
+#include <ImpactDetector.h>
+#include <TerrainEstimator.h>
+#include <VelocityEstimator.h>
+#include <MahonyFilter.h>
+#include <TorsoEstimator.h>
+#include <EstimatorSnapshot.h>
+#include <NeuralPBC.h>
+#include <PosteriorBank.h>
+#include <weights/deter_hardware_even_1mpers.h>
+#include <weights/rw_bayesian.h>
+#include <filters_bank.h>
+#include "RimlessWheelModel.h"
+#include "archive.h"
+#include "runs.h"
+
+namespace {
+
+using runs::Sample;
+using runs::readFile;
+using runs::loadBson;
+using runs::loadFlightLog;
+using archive::loadArchive;
+
+typedef RimlessWheelModel Robot;
+
+constexpr uint32_t period_us = 10000;           // FILTER_UPDATE_RATE_HZ
+constexpr float samplingTime = period_us * 1e-6f;
+
+// main.cpp's configuration
+struct TorsoAhrs {
+    static constexpr float period = samplingTime;
+    static constexpr float two_kp = 2.0f*0.5f;
+    static constexpr float two_ki = 0.0f;
+};
+struct SpokeRate {
+    static constexpr IIR::ORDER order = IIR::ORDER::OD3;
+    static constexpr IIR::TYPE  type  = IIR::TYPE::LOWPASS;
+    static constexpr float_t    hz    = 30.0;
+    static constexpr float_t    ts    = samplingTime;
+};
+constexpr float trackingBandwidth_hz = 30.0f;   // SPOKE_VEL_TRACKING_BANDWIDTH_HZ
+constexpr uint8_t savgolWindow = 6, savgolDegree = 2;
+constexpr uint8_t torsoAlphaWindow = 5;          // TORSO_ALPHA_SAVGOL_WINDOW
+constexpr float impactAccelSpike = 15.0f, impactRateJump = 1.5f;
+constexpr float pbcSaturation = 1.0f;           // ONBOARD_PBC_SATURATION
+
+// ---- measurement ----
+
+enum Stage { ATTITUDE, VELOCITY, IMPACT, IMPACT_MAP, TERRAIN, EKF, PBC, PBC_BAYES, NUM_STAGES };
+const char* const stageNames[NUM_STAGES] = {"attitude", "velocity", "impact", "impact_map", "terrain", "ekf", "pbc", "pbc_bayes"};
+
+typedef std::chrono::steady_clock Clock;
+
+struct Timing {
+    uint64_t calls = 0;
+    double total_ns = 0.0;
+    double max_ns = 0.0;
+};
+
+struct Rms {
+    double sum2 = 0.0;
+    uint64_t n = 0;
+    void add(double error) { sum2 += error*error; ++n; }
+    double value() const { return n ? sqrt(sum2 / n) : NAN; }
+    // "n/a" without a sample, so a run without the recorded value parses
+    void print(const char* key) const {
+        if (n) printf("%s %.6f\n", key, value());
+        else printf("%s n/a\n", key);
+    }
+};
+
+double clockOverhead_ns() {
+    double best = 1e9;
+    for (int i = 0; i < 1000; ++i) {
+        auto a = Clock::now();
+        auto b = Clock::now();
+        double ns = std::chrono::duration<double, std::nano>(b - a).count();
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+class Replay {
+public:
+    Replay(double overhead_ns, FILE* csv) : overhead_ns_(overhead_ns), csv_(csv) {
+        bank_.load(pbc_weights::rw_bayesian::samples());
+    }
+
+    // Every sample's outputs, for comparing two replays bit for bit
+    struct Output {
+        float roll, tracked, savgol, lpf, ekf[RimlessWheel::num_states], torque, bayes;
+        bool impact;
+    };
+
+    // From sample from on, with the state before sample snapshotAt kept and
+    // the outputs appended to outputs when given
+    void run(const std::vector<Sample>& samples, size_t from = 0, size_t snapshotAt = SIZE_MAX,
+             std::vector<Output>* outputs = nullptr) {
+        outputs_ = outputs;
+        for (size_t i = from; i < samples.size(); ++i) {
+            if (i == snapshotAt)
+                snapshot_.take(samples[i].stamp_us, torso_, tracking_, savgol_, lowPass_, detector_, terrain_, ekf_,
+                               started_, last_us_, lastSpoke_, lastSpokeRate_, lastRollRate_, lastTorque_);
+            step(samples[i], i + 1 < samples.size() ? &samples[i + 1] : nullptr);
+        }
+        outputs_ = nullptr;
+    }
+
+    // Carries on from other's snapshot; false if it took none
+    bool resume(const Replay& other) {
+        return other.snapshot_.restore(torso_, tracking_, savgol_, lowPass_, detector_, terrain_, ekf_,
+                                       started_, last_us_, lastSpoke_, lastSpokeRate_, lastRollRate_, lastTorque_);
+    }
+
+    static constexpr uint32_t snapshotBytes() { return Snapshot::bytes(); }
+
+    void report(const char* name, size_t samples, double wall_s, double robot_s) const {
+        printf("run %s\n", name);
+        printf("samples %zu\n", samples);
+        printf("robot_s %.2f\n", robot_s);
+        printf("wall_ms %.3f\n", wall_s * 1e3);
+        printf("speedup %.0f\n", robot_s / wall_s);
+        rollError_.print("roll_rms");
+        trackingError_.print("vel_tracking_rms");
+        savgolError_.print("vel_savgol_rms");
+        lpfError_.print("vel_lpf_rms");
+        printf("impacts %u\n", impacts_);
+        impactMapError_.print("impact_map_rms");
+        printf("terrain_impacts %u\n", terrain_.impacts());
+        printf("terrain_rejected %u\n", terrain_.rejected());
+        printf("terrain_obstacles %u\n", terrain_.obstacles());
+        printf("terrain_incline %.6f\n", terrain_.incline());
+        printf("terrain_roughness %.6f\n", terrain_.roughness());
+        printf("terrain_stride_s %.4f\n", terrain_.stride_s());
+        printf("ekf_events %lu\n", ekf_.events());
+        ekfSpokeRateError_.print("ekf_spoke_rate_rms");
+        ekfTorsoRateError_.print("ekf_torso_rate_rms");
+        pbcTorque_.print("pbc_torque_rms");
+        pbcRecordedError_.print("pbc_recorded_rms");
+        bayesTorque_.print("pbc_bayes_torque_rms");
+        printf("non_finite %u\n", nonFinite_);
+        for (int s = 0; s < NUM_STAGES; ++s) {
+            const Timing& t = timing_[s];
+            if (!t.calls) continue;
+            printf("time_%s_ns mean %.1f max %.1f calls %lu\n", stageNames[s],
+                   t.total_ns / t.calls, t.max_ns, (unsigned long)t.calls);
+        }
+    }
+
+    bool finite() const { return nonFinite_ == 0; }
+
+private:
+    template<class F>
+    void timed(Stage stage, F f) {
+        auto start = Clock::now();
+        f();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() - overhead_ns_;
+        if (ns < 0.0) ns = 0.0;
+        Timing& t = timing_[stage];
+        ++t.calls;
+        t.total_ns += ns;
+        if (ns > t.max_ns) t.max_ns = ns;
+    }
+
+    void check(float v) { if (!std::isfinite(v)) ++nonFinite_; }
+
+    void step(const Sample& x, const Sample* next) {
+        const float dt = started_ ? (int32_t)(x.stamp_us - last_us_) * 1e-6f : samplingTime;
+
+        // attitude, as fuseImuSample() and readIMU(); the log has no magnetometer
+        if (x.imu) {
+            float torso[3];
+            const Vec3 accel = Vec3::from(x.accel);
+            timed(ATTITUDE, [&] {
+                torso_.fuse(Vec3::from(x.gyro), &accel, Vec3(), dt > 0.0f ? dt : samplingTime);
+                torso_.states(torso);
+            });
+            check(torso[0]);
+            rollError_.add(torso[0] - x.roll);
+        }
+
+        // spoke 0 velocity three ways
+        float tracked = 0.0f, savgol = 0.0f, lpf[2];
+        timed(VELOCITY, [&] {
+            if (!started_) {
+                tracking_.reset(x.spoke[0], x.stamp_us);
+                savgol_.reset(x.spoke[0], x.stamp_us);
+                lastSpoke_[0] = x.spoke[0];
+                lastSpoke_[1] = x.spoke[1];
+            }
+            tracked = tracking_.update(x.spoke[0], x.stamp_us);
+            savgol = savgol_.update(x.spoke[0], x.stamp_us);
+            float rates[2] = {(x.spoke[0] - lastSpoke_[0]) / samplingTime, (x.spoke[1] - lastSpoke_[1]) / samplingTime};
+            lowPass_.filterIn(rates, lpf);
+            lastSpoke_[0] = x.spoke[0];
+            lastSpoke_[1] = x.spoke[1];
+        });
+        check(tracked); check(savgol); check(lpf[0]);
+        if (started_) {
+            trackingError_.add(tracked - x.spokeRate[0]);
+            savgolError_.add(savgol - x.spokeRate[0]);
+            lpfError_.add(lpf[0] - x.spokeRate[0]);
+        }
+
+        // the model torque is the one held over the last tick
+        const float modelTorque = started_ ? lastTorque_ : 0.0f;
+        if (started_) {
+            timed(EKF, [&] { ekf_.predict(modelTorque, dt > 0.0f ? dt : samplingTime); });
+        }
+
+        bool impact = false;
+        timed(IMPACT, [&] { impact = detector_.encoderSample(x.spoke[0], x.spokeRate[0], x.stamp_us); });
+        timed(TERRAIN, [&] {
+            terrain_.update(x.spoke[0], x.spokeRate[0], x.stamp_us);
+            if (impact) terrain_.impact(detector_.touchdownTime_us());
+        });
+        check(terrain_.predicted());
+        if (impact) {
+            ++impacts_;
+            // pre-impact rates from the sample before, post-impact measured one sample after
+            if (started_ && next) {
+                ImpactMap<RimlessWheelModel>::Velocities post;
+                timed(IMPACT_MAP, [&] { post = impactMap_.map(x.roll, lastSpokeRate_, lastRollRate_); });
+                check(post.thetadot);
+                impactMapError_.add(post.thetadot - next->spokeRate[0]);
+            }
+            if (started_) {
+                float late_dt = (int32_t)(x.stamp_us - detector_.impactTime_us()) * 1e-6f;
+                late_dt = late_dt < 0.0f ? 0.0f : (late_dt > 2.0f*samplingTime ? 2.0f*samplingTime : late_dt);
+                timed(EKF, [&] { ekf_.jump(modelTorque, late_dt); });
+            }
+        }
+
+        float z[RimlessWheel::num_measurements] = {x.spoke[0], x.roll, x.spokeRate[0], x.rollRate};
+        timed(EKF, [&] {
+            if (!started_) {
+                z[0] = Robot::wrapSpoke(z[0]);
+                ekf_.reset(z, 0.1f);
+            } else {
+                ekf_.correct(z);
+            }
+        });
+        for (int i = 0; i < RimlessWheel::num_states; ++i) check(ekf_.state(i));
+        ekfSpokeRateError_.add(ekf_.state(2) - x.spokeRate[0]);
+        ekfTorsoRateError_.add(ekf_.state(3) - x.rollRate);
+
+        float torque = 0.0f, bayes = 0.0f;
+        const float spokeAngle = Robot::uprightSpokeAngle + x.spoke[0];
+        timed(PBC, [&] { torque = pbc_.control(x.roll, spokeAngle, x.rollRate, x.spokeRate[0]); });
+        timed(PBC_BAYES, [&] { bayes = bank_.control(x.roll, spokeAngle, x.rollRate, x.spokeRate[0]); });
+        check(torque); check(bayes);
+        pbcTorque_.add(torque);
+        bayesTorque_.add(bayes);
+        if (std::isfinite(x.torque)) pbcRecordedError_.add(torque - x.torque);
+
+        if (csv_) {
+            fprintf(csv_, "%u,%g,%g,%g,%g,%g,%g,%g,%d,%g,%g,%g,%g,%g,%g\n", x.stamp_us, x.roll, x.spoke[0], x.spokeRate[0],
+                    tracked, savgol, lpf[0], x.rollRate, impact ? 1 : 0,
+                    ekf_.state(0), ekf_.state(1), ekf_.state(2), ekf_.state(3), torque, bayes);
+        }
+        if (outputs_) {
+            // zeroed first, so the padding compares too
+            Output out;
+            memset(&out, 0, sizeof(out));
+            float torso[3];
+            torso_.states(torso);
+            out.roll = torso[0];
+            out.tracked = tracked;
+            out.savgol = savgol;
+            out.lpf = lpf[0];
+            for (int i = 0; i < RimlessWheel::num_states; ++i) out.ekf[i] = ekf_.state(i);
+            out.torque = torque;
+            out.bayes = bayes;
+            out.impact = impact;
+            outputs_->push_back(out);
+        }
+
+        lastTorque_ = torque;
+        lastSpokeRate_ = x.spokeRate[0];
+        lastRollRate_ = x.rollRate;
+        last_us_ = x.stamp_us;
+        started_ = true;
+    }
+
+    double overhead_ns_;
+    FILE* csv_;
+    Timing timing_[NUM_STAGES];
+
+    TorsoEstimator<MahonyFilter<TorsoAhrs>> torso_{VelocityEstimator::savitzkyGolay(torsoAlphaWindow, 2)};
+    VelocityEstimator tracking_ = VelocityEstimator::tracking(trackingBandwidth_hz);
+    VelocityEstimator savgol_ = VelocityEstimator::savitzkyGolay(savgolWindow, savgolDegree);
+    FixedFilterBank<2, SpokeRate> lowPass_;
+    ImpactDetector detector_{Robot::alpha, impactAccelSpike, impactRateJump};
+    ImpactMap<RimlessWheelModel> impactMap_;
+    TerrainEstimator<Robot> terrain_;
+    HybridEKF<RimlessWheel> ekf_;
+    NeuralPBC<pbc_weights::deter_hardware_even_1mpers> pbc_{pbcSaturation};
+    PosteriorBank<pbc_weights::rw_bayesian, pbc_weights::rw_bayesian::num_samples> bank_{2.0f};
+
+    bool started_ = false;
+    uint32_t last_us_ = 0;
+    float lastSpoke_[2] = {0.0f, 0.0f};
+    float lastSpokeRate_ = 0.0f, lastRollRate_ = 0.0f, lastTorque_ = 0.0f;
+    uint32_t impacts_ = 0;
+    uint32_t nonFinite_ = 0;
+
+    typedef EstimatorSnapshot<decltype(torso_), decltype(tracking_), decltype(savgol_), decltype(lowPass_),
+                              decltype(detector_), decltype(terrain_), decltype(ekf_), bool, uint32_t, float[2],
+                              float, float, float> Snapshot;
+    Snapshot snapshot_;
+    std::vector<Output>* outputs_ = nullptr;
+
+    Rms rollError_, trackingError_, savgolError_, lpfError_, impactMapError_;
+    Rms ekfSpokeRateError_, ekfTorsoRateError_, pbcTorque_, pbcRecordedError_, bayesTorque_;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* csvPath = nullptr;
+    int repeat = 1;
+    int eventKind = 0;
+    uint32_t eventIndex = 0;
+    double seconds = 1.0;
+    long resumeAt = -1;
+    std::vector<const char*> runs;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) csvPath = argv[++i];
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc) resumeAt = atol(argv[++i]);
+        else if (strcmp(argv[i], "--event") == 0 && i + 1 < argc) {
+            eventKind = runs::findEventKind(argv[++i]);
+            if (eventKind == 0) usage = true;
+            if (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9') eventIndex = atoi(argv[++i]);
+        }
+        else if (argv[i][0] == '-') usage = true;
+        else runs.push_back(argv[i]);
+    }
+    if (usage || runs.empty() || repeat < 1) {
+        fprintf(stderr, "usage: %s [--csv out.csv] [--repeat n] [--event kind [n]] [--seconds s] [--resume n] "
+                        "RUN.bson|FLIGHTnn.BIN|RUN.rwa ...\n",
+                argv[0]);
+        return 2;
+    }
+
+    FILE* csv = nullptr;
+    if (csvPath) {
+        csv = fopen(csvPath, "w");
+        if (!csv) {
+            perror(csvPath);
+            return 1;
+        }
+        fprintf(csv, "stamp_us,roll,spoke0,spoke0_rate,vel_tracking,vel_savgol,vel_lpf,roll_rate,impact,"
+                     "ekf_theta,ekf_phi,ekf_thetadot,ekf_phidot,pbc_torque,pbc_bayes_torque\n");
+    }
+
+    const double overhead_ns = clockOverhead_ns();
+    printf("clock_overhead_ns %.1f\n", overhead_ns);
+    bool finite = true;
+    for (const char* path : runs) {
+        std::vector<uint8_t> bytes;
+        std::vector<Sample> samples;
+        std::vector<runs::Event> events;
+        if (!readFile(path, bytes)
+            || !(loadFlightLog(bytes, samples, &events) || loadArchive(bytes, samples, &events) || loadBson(bytes, samples))) {
+            fprintf(stderr, "%s: not a flight log, run archive or hardware_data BSON\n", path);
+            finite = false;
+            continue;
+        }
+        if (eventKind != 0) {
+            if (events.empty()) events = runs::findEvents(samples);
+            size_t e = runs::nextEvent(events, eventKind);
+            for (uint32_t n = 0; n < eventIndex && e < events.size(); ++n) e = runs::nextEvent(events, eventKind, events[e].sample + 1);
+            if (e == events.size()) {
+                fprintf(stderr, "%s: no %s event %u, skipped\n", path, runs::eventName(eventKind), eventIndex);
+                continue;
+            }
+            const uint32_t at_us = events[e].stamp_us;
+            size_t from = events[e].sample, to = events[e].sample;
+            while (from > 0 && at_us - samples[from - 1].stamp_us <= 1000000u) --from;
+            while (to < samples.size() && samples[to].stamp_us - at_us < (uint32_t)(seconds * 1e6)) ++to;
+            samples = std::vector<Sample>(samples.begin() + from, samples.begin() + to);
+            printf("event %s %u at sample %u, samples %zu from %zu\n", runs::eventName(eventKind), eventIndex,
+                   events[e].sample, samples.size(), from);
+        }
+        // every repeat starts from fresh filters; the report is of the last one,
+        // the wall time the best, which is the least disturbed by the host
+        double best_s = 1e9;
+        for (int r = 0; r < repeat; ++r) {
+            const bool lastRepeat = r + 1 == repeat;
+            const bool resume = lastRepeat && resumeAt >= 0 && (size_t)resumeAt < samples.size();
+            std::vector<Replay::Output> outputs;
+            Replay replay(overhead_ns, lastRepeat ? csv : nullptr);
+            auto start = Clock::now();
+            replay.run(samples, 0, resume ? (size_t)resumeAt : SIZE_MAX, resume ? &outputs : nullptr);
+            double wall_s = std::chrono::duration<double>(Clock::now() - start).count();
+            if (wall_s < best_s) best_s = wall_s;
+            if (r + 1 == repeat) {
+                double robot_s = (uint32_t)(samples.back().stamp_us - samples.front().stamp_us) * 1e-6 + samplingTime;
+                replay.report(path, samples.size(), best_s, robot_s);
+                finite = finite && replay.finite();
+            }
+            if (resume) {
+                Replay resumed(overhead_ns, nullptr);
+                std::vector<Replay::Output> tail;
+                resumed.resume(replay);
+                resumed.run(samples, (size_t)resumeAt, SIZE_MAX, &tail);
+                size_t mismatches = 0;
+                for (size_t i = 0; i < tail.size(); ++i)
+                    if (memcmp(&tail[i], &outputs[resumeAt + i], sizeof(Replay::Output)) != 0) ++mismatches;
+                printf("resume_from %ld\n", resumeAt);
+                printf("resume_snapshot_bytes %u\n", Replay::snapshotBytes());
+                printf("resume_mismatches %zu\n", mismatches);
+            }
+        }
+    }
+    if (csv) fclose(csv);
+    return finite ? 0 : 1;
+}
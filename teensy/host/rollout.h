@@ -0,0 +1,187 @@
+#ifndef HOST_ROLLOUT_H
+#define HOST_ROLLOUT_H
+
+/* The rimless wheel as a plant for the host's closed-loop tools (simulate,
+* tune): src/RimlessWheelModel.h's hybrid model with its terms as runtime
+* values, so every lane of a Block can be its own perturbed wheel.
+*
+* Block<W> is W wheels in lockstep, structure of arrays so the stance step
+* vectorizes: step() is the midpoint rule, impacts() the guard and the
+* ImpactMap closed form with the switch to the next spoke. modelCheck()
+* holds the unperturbed block to RimlessWheel::step() and
+* ImpactMap::evaluate(). Rng is the generator every rollout seeds its own
+* stream of, so a rollout is the same wheel whatever else runs.
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ImpactMap.h>
+#include <RobotModel.h>
+#include "RimlessWheelModel.h"
+
+namespace rollout {
+
+typedef RimlessWheelModel Robot;
+
+// splitmix64, one stream per rollout
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed) {}
+    uint64_t next() {
+        uint64_t z = (s += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+    float uniform() { return (next() >> 40) * (1.0f / 16777216.0f); }
+    float gaussian() {
+        const float u = 1.0f - uniform(), v = uniform();
+        return sqrtf(-2.0f*logf(u)) * cosf(2.0f*(float)M_PI*v);
+    }
+    float exponential(float mean) { return -mean*logf(1.0f - uniform()); }
+};
+
+// One rollout's robot, RobotModel's fields
+struct Wheel {
+    float m1, m2, l1, l2, I1, I2, incline;
+
+    static Wheel nominal() { return {Robot::m1, Robot::m2, Robot::l1, Robot::l2, Robot::I1, Robot::I2, Robot::incline}; }
+
+    Wheel perturbed(Rng& rng, float massSigma, float lengthSigma, float inclineSigma) const {
+        const float s1 = 1.0f + massSigma*rng.gaussian(), s2 = 1.0f + massSigma*rng.gaussian();
+        const float r1 = 1.0f + lengthSigma*rng.gaussian(), r2 = 1.0f + lengthSigma*rng.gaussian();
+        // the inertias scale with their body, I2 = m2 l2^2/3 as in RobotModel
+        return {m1*s1, m2*s2, l1*r1, l2*r2, I1*s1*r1*r1, I2*s2*r2*r2, incline + inclineSigma*rng.gaussian()};
+    }
+};
+
+// W wheels in lockstep, the plant as arrays over the lanes
+template<int W>
+struct Block {
+    // RobotModel's derived terms and ImpactMap's coefficients, per lane
+    float M11[W], M22[W], M12[W], det0[W], det1[W], G1[W], G2[W], incline[W];
+    float D0[W], D1[W], N0[W], N1[W], P[W], Q[W];
+    // x = [theta, phi, thetadot, phidot], the torque acting and the whole spokes rolled
+    float theta[W], phi[W], thetadot[W], phidot[W], u[W];
+    int spokes[W];
+    bool alive[W];
+
+    // RobotModel's and ImpactMap's formulas on runtime parameters
+    void setWheel(int l, const Wheel& w) {
+        const float mt = w.m1 + w.m2;
+        M11[l] = w.I1 + mt*w.l1*w.l1;
+        M22[l] = w.I2 + w.m2*w.l2*w.l2;
+        M12[l] = w.m2*w.l1*w.l2;
+        det0[l] = -M11[l]*M22[l];
+        det1[l] = M12[l]*M12[l];
+        G1[l] = Robot::g*mt*w.l1;
+        G2[l] = Robot::g*w.m2*w.l2;
+        incline[l] = w.incline;
+        const float ca = cosf(Robot::alpha), sa = sinf(Robot::alpha), c2a = cosf(2.0f*Robot::alpha);
+        D0[l] = w.I1*w.I2 + w.I1*w.m2*w.l2*w.l2 + w.I2*mt*w.l1*w.l1 + w.m2*w.l1*w.l1*w.l2*w.l2*w.m1;
+        D1[l] = M12[l]*M12[l];
+        N0[l] = (w.I1*w.I2 + w.I1*w.m2*w.l2*w.l2) + (w.I2*mt*w.l1*w.l1 + w.m2*w.l1*w.l1*w.l2*w.l2*(w.m1 + 0.5f*w.m2))*c2a;
+        N1[l] = 0.5f*M12[l]*M12[l];
+        P[l] = M12[l]*mt*w.l1*w.l1*ca*(c2a - 1.0f);
+        Q[l] = M12[l]*(2.0f*w.I1*sa + mt*w.l1*w.l1*sa*(c2a + 1.0f));
+    }
+
+    // RimlessWheel::accelerations() over the lanes
+    void accelerations(const float* th, const float* ph, const float* thd, const float* phd, float* a0, float* a1) const {
+        for (int l = 0; l < W; ++l) {
+            const float s = sinf(th[l] - ph[l]), c = cosf(th[l] - ph[l]);
+            const float b0 = -u[l] + M12[l]*s*phd[l]*phd[l] + G1[l]*sinf(th[l] - incline[l]);
+            const float b1 = u[l] - M12[l]*s*thd[l]*thd[l] - G2[l]*sinf(ph[l] - incline[l]);
+            const float inv = 1.0f/(det0[l] + det1[l]*c*c);
+            a0[l] = inv*(-M22[l]*b0 - M12[l]*c*b1);
+            a1[l] = inv*(-M12[l]*c*b0 - M11[l]*b1);
+        }
+    }
+
+    // RimlessWheel::step(), the midpoint rule; fallen lanes stay where they fell
+    void step(float dt) {
+        float a0[W], a1[W], mth[W], mph[W], mthd[W], mphd[W];
+        accelerations(theta, phi, thetadot, phidot, a0, a1);
+        for (int l = 0; l < W; ++l) {
+            mth[l] = theta[l] + 0.5f*dt*thetadot[l];
+            mph[l] = phi[l] + 0.5f*dt*phidot[l];
+            mthd[l] = thetadot[l] + 0.5f*dt*a0[l];
+            mphd[l] = phidot[l] + 0.5f*dt*a1[l];
+        }
+        accelerations(mth, mph, mthd, mphd, a0, a1);
+        for (int l = 0; l < W; ++l) {
+            const float k = alive[l] ? dt : 0.0f;
+            theta[l] += k*mthd[l];
+            phi[l] += k*mphd[l];
+            thetadot[l] += k*a0[l];
+            phidot[l] += k*a1[l];
+        }
+    }
+
+    // ImpactMap::evaluate() with this lane's coefficients
+    void gains(int l, float ph, float& g1, float& g2) const {
+        const float c = cosf(ph), s = sinf(ph);
+        const float sd = sinf(Robot::alpha)*c - cosf(Robot::alpha)*s;
+        const float inv = 1.0f/(D0[l] + D1[l]*sd*sd);
+        g1 = (N0[l] - N1[l]*(c*c - s*s))*inv;
+        g2 = (P[l]*c + Q[l]*s)*inv;
+    }
+
+    // RimlessWheel::guard() and jump(); the impacts of this substep
+    unsigned impacts() {
+        unsigned hit = 0;
+        for (int l = 0; l < W; ++l) {
+            const bool forward = theta[l] >= Robot::alpha && thetadot[l] > 0.0f;
+            if (!alive[l] || !(forward || (theta[l] < -Robot::alpha && thetadot[l] < 0.0f)))
+                continue;
+            float g1, g2;
+            gains(l, phi[l], g1, g2);
+            theta[l] += forward ? -Robot::spokeSpacing : Robot::spokeSpacing;
+            spokes[l] += forward ? 1 : -1;
+            phidot[l] += g2*thetadot[l];
+            thetadot[l] *= g1;
+            hit |= 1u << l;
+        }
+        return hit;
+    }
+
+    // The wheel's angle since the start, what the encoder turns with
+    float spokeAngle(int l) const { return theta[l] + spokes[l]*Robot::spokeSpacing; }
+};
+
+// Largest difference of the unperturbed block to the EKF model, over random states
+template<int W>
+float modelCheck() {
+    Block<W> b;
+    Rng rng(12345);
+    float err = 0.0f;
+    for (int trial = 0; trial < 64; ++trial) {
+        float x[W][4];
+        for (int l = 0; l < W; ++l) {
+            b.setWheel(l, Wheel::nominal());
+            x[l][0] = (2.0f*rng.uniform() - 1.0f)*Robot::alpha;
+            x[l][1] = (2.0f*rng.uniform() - 1.0f)*1.2f;
+            x[l][2] = 4.0f*rng.gaussian();
+            x[l][3] = 4.0f*rng.gaussian();
+            b.theta[l] = x[l][0]; b.phi[l] = x[l][1]; b.thetadot[l] = x[l][2]; b.phidot[l] = x[l][3];
+            b.u[l] = 2.0f*rng.gaussian();
+            b.alive[l] = true;
+        }
+        b.step(1e-3f);
+        for (int l = 0; l < W; ++l) {
+            float next[4];
+            RimlessWheel::step(x[l], b.u[l], 1e-3f, next);
+            err = std::max({err, fabsf(next[0] - b.theta[l]), fabsf(next[1] - b.phi[l]),
+                            fabsf(next[2] - b.thetadot[l]), fabsf(next[3] - b.phidot[l])});
+            float g1, g2;
+            b.gains(l, x[l][1], g1, g2);
+            const ImpactMap<Robot>::Gains g = ImpactMap<Robot>::evaluate(x[l][1]);
+            err = std::max({err, fabsf(g1 - g.a1), fabsf(g2 - g.a2)});
+        }
+    }
+    return err;
+}
+
+} // namespace rollout
+
+#endif //HOST_ROLLOUT_H
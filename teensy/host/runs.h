@@ -0,0 +1,247 @@
+#ifndef HOST_RUNS_H
+#define HOST_RUNS_H
+
+/* Recorded runs for the host tools (replay, evaluate): a hardware_data .bson
+* of the Julia controllers or a flight recorder log, read into one Sample per
+* control tick. See replay.cpp for what each format holds.
+*
+* A run's events (impacts, E-stop edges, ODrive error changes, controller
+* swaps) come from the flight log's event index where it has one (version 3,
+* FlightLogFormat.h) and are otherwise found in the samples by findEvents().
+*/
+#include <dirent.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <FlightLogFormat.h>
+#include <RobotModel.h>
+
+namespace runs {
+
+constexpr uint32_t bson_period_us = 10000;      // the Julia loop_rate, 100 Hz
+
+struct Sample {
+    uint32_t stamp_us;
+    float roll, rollRate, yaw;
+    float spoke[2], spokeRate[2];
+    bool imu;                   // gyro and accel are recorded
+    float gyro[3], accel[3];
+    float torque;
+    uint8_t status, errors;     // FlightRecord's; 0 for hardware_data
+};
+
+// An event at sample, of FlightEvent::Kind kind
+struct Event {
+    uint32_t sample;
+    uint32_t stamp_us;
+    uint8_t kind;
+    uint16_t value;
+};
+
+inline const char* eventName(int kind) {
+    static const char* const names[] = {"none", "impact", "estop_on", "estop_off", "odrive_errors", "controller", "benchmark",
+                                         "link_mode"};
+    return kind >= 0 && kind <= FlightEvent::LINK_MODE ? names[kind] : "unknown";
+}
+
+// The kind called name, or 0
+inline int findEventKind(const char* name) {
+    for (int k = FlightEvent::IMPACT; k <= FlightEvent::LINK_MODE; ++k)
+        if (strcmp(eventName(k), name) == 0) return k;
+    return 0;
+}
+
+// The events a recorder would have indexed, for runs without an index: a new stance spoke
+// (except right after an E-stop or the calibration, which move the angle by whole spokes),
+// E-stop edges and changes of the ODrive error bits. Controller swaps are not in the samples.
+inline std::vector<Event> findEvents(const std::vector<Sample>& samples) {
+    std::vector<Event> events;
+    auto add = [&](size_t i, uint8_t kind, uint16_t value) {
+        events.push_back({(uint32_t)i, samples[i].stamp_us, kind, value});
+    };
+    int settling = 2;
+    for (size_t i = 1; i < samples.size(); ++i) {
+        const Sample &a = samples[i - 1], &b = samples[i];
+        const uint8_t held = 1 | 16 | 64; // SensorState::STATUS_ESTOP | STATUS_CALIBRATING | STATUS_ODRIVE_RESET
+        if (b.status & held) settling = 2;
+        else if (settling > 0) --settling;
+        else if (RimlessWheelModel::spokeCount(b.spoke[0]) != RimlessWheelModel::spokeCount(a.spoke[0]))
+            add(i, FlightEvent::IMPACT, 0);
+        if ((a.status ^ b.status) & 1) add(i, b.status & 1 ? FlightEvent::ESTOP_ON : FlightEvent::ESTOP_OFF, 0);
+        if (a.errors != b.errors) add(i, FlightEvent::ODRIVE_ERRORS, b.errors);
+    }
+    return events;
+}
+
+// The first event of kind from sample on, or events.size()
+inline size_t nextEvent(const std::vector<Event>& events, int kind, uint32_t sample = 0) {
+    for (size_t i = 0; i < events.size(); ++i)
+        if (events[i].kind == kind && events[i].sample >= sample) return i;
+    return events.size();
+}
+
+inline bool endsWith(const std::string& s, const char* suffix) {
+    const size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// The path itself, or the .bson, .BIN and .rwa files of a directory in name order
+inline void expand(const char* path, std::vector<std::string>& files) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        files.push_back(path);
+        return;
+    }
+    std::vector<std::string> found;
+    while (dirent* e = readdir(dir)) {
+        std::string name = e->d_name;
+        if (endsWith(name, ".bson") || endsWith(name, ".BIN") || endsWith(name, ".rwa"))
+            found.push_back(std::string(path) + "/" + name);
+    }
+    closedir(dir);
+    std::sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+}
+
+inline bool readFile(const char* path, std::vector<uint8_t>& bytes) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    bytes.resize(size > 0 ? size : 0);
+    bool ok = size > 0 && fread(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    fclose(f);
+    return ok;
+}
+
+inline int32_t int32At(const uint8_t* p) { int32_t v; memcpy(&v, p, 4); return v; }
+
+// Length of the BSON value of type t at p, or -1 for a type this reader does not know
+inline int32_t bsonValueBytes(uint8_t t, const uint8_t* p) {
+    switch (t) {
+        case 0x01: case 0x09: case 0x11: case 0x12: return 8;
+        case 0x02: return 4 + int32At(p);
+        case 0x03: case 0x04: return int32At(p);
+        case 0x05: return 5 + int32At(p);
+        case 0x08: return 1;
+        case 0x0A: return 0;
+        case 0x10: return 4;
+        default: return -1;
+    }
+}
+
+// Calls f(type, key, value) for each element of the document at doc
+template<class F>
+bool bsonEach(const uint8_t* doc, const uint8_t* end, F f) {
+    if (end - doc < 5) return false;
+    int32_t length = int32At(doc);
+    if (length < 5 || length > end - doc) return false;
+    const uint8_t* p = doc + 4;
+    const uint8_t* stop = doc + length - 1;
+    while (p < stop) {
+        uint8_t t = *p++;
+        const char* key = (const char*)p;
+        p += strnlen(key, stop - p) + 1;
+        int32_t n = p < stop ? bsonValueBytes(t, p) : -1;
+        if (n < 0 || n > stop - p) return false;
+        f(t, key, p);
+        p += n;
+    }
+    return true;
+}
+
+// sensorData as BSON.jl writes a Vector{Vector{Float32}}
+inline bool loadBson(const std::vector<uint8_t>& bytes, std::vector<Sample>& samples) {
+    const uint8_t* end = bytes.data() + bytes.size();
+    const uint8_t* array = nullptr;
+    if (!bsonEach(bytes.data(), end, [&](uint8_t t, const char* key, const uint8_t* v) {
+            if (t == 0x04 && strcmp(key, "sensorData") == 0) array = v;
+        }) || !array)
+        return false;
+    bool ok = true;
+    uint32_t index = 0;
+    bsonEach(array, end, [&](uint8_t t, const char*, const uint8_t* element) {
+        if (t != 0x03) return;
+        bsonEach(element, end, [&](uint8_t t, const char* key, const uint8_t* v) {
+            if (t != 0x05 || strcmp(key, "data") != 0) return;
+            if (int32At(v) != 7*(int32_t)sizeof(float)) {
+                ok = false;
+                return;
+            }
+            float s[7];
+            memcpy(s, v + 5, sizeof(s));
+            Sample x = {};
+            x.stamp_us = index++ * bson_period_us;
+            x.roll = s[0];
+            x.spoke[0] = s[1] - RimlessWheelModel::uprightSpokeAngle;
+            x.rollRate = s[2];
+            x.spokeRate[0] = s[3];
+            x.spoke[1] = s[4] - RimlessWheelModel::uprightSpokeAngle;
+            x.spokeRate[1] = s[5];
+            x.yaw = s[6];
+            x.torque = NAN;
+            samples.push_back(x);
+        });
+    });
+    return ok && !samples.empty();
+}
+
+// A flight log's samples, and with events its event index (found by findEvents() in a
+// version 2 log, which has none)
+inline bool loadFlightLog(const std::vector<uint8_t>& bytes, std::vector<Sample>& samples,
+                          std::vector<Event>* events = nullptr) {
+    FlightLogHeader header;
+    if (bytes.size() < FlightLogHeader::block_bytes) return false;
+    memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != FlightLogHeader::MAGIC || header.version < FlightLogHeader::FIRST_VERSION
+        || header.version > FlightLogHeader::VERSION || header.record_size != sizeof(FlightRecord))
+        return false;
+    const size_t first = samples.size();
+    std::vector<Event> indexed;
+    for (size_t at = FlightLogHeader::block_bytes; at + sizeof(FlightRecord) <= bytes.size(); at += sizeof(FlightRecord)) {
+        FlightRecord r;
+        memcpy(&r, &bytes[at], sizeof(r));
+        if (r.stamp_us == 0 && r.status == 0) continue;     // block padding
+        if (r.stamp_us == 0xFFFFFFFFu) continue;            // erased flash
+        if (r.status == FlightEventRecord::MARKER) {
+            FlightEventRecord e;
+            memcpy(&e, &bytes[at], sizeof(e));
+            for (int i = 0; i < e.count && i < FlightEventRecord::capacity; ++i)
+                indexed.push_back({(uint32_t)first + e.events[i].record, e.stamp_us, e.events[i].kind, e.events[i].value});
+            continue;
+        }
+        if (r.status == FlightHealthRecord::MARKER) continue; // the firmware's counters, not a sample
+        Sample x;
+        x.stamp_us = r.stamp_us;
+        x.roll = r.torso[0];
+        x.rollRate = r.torso[1];
+        x.yaw = r.torso[2];
+        memcpy(x.spoke, r.spoke, sizeof(x.spoke));
+        memcpy(x.spokeRate, r.spoke + 2, sizeof(x.spokeRate));
+        x.imu = std::isfinite(r.gyro[0]) && std::isfinite(r.accel[0]); // NaN in a Pi run_recorder log
+        memcpy(x.gyro, r.gyro, sizeof(x.gyro));
+        memcpy(x.accel, r.accel, sizeof(x.accel));
+        x.torque = r.torque;
+        x.status = r.status;
+        x.errors = r.errors;
+        samples.push_back(x);
+    }
+    if (events) {
+        if (header.version < 3) {
+            const std::vector<Sample> run(samples.begin() + first, samples.end());
+            indexed = findEvents(run);
+            for (Event& e : indexed) e.sample += first;
+        }
+        events->insert(events->end(), indexed.begin(), indexed.end());
+    }
+    return samples.size() > first;
+}
+
+} // namespace runs
+
+#endif //HOST_RUNS_H
@@ -0,0 +1,66 @@
+#ifndef SimArduino_h
+#define SimArduino_h
+
+/* Arduino.h for the drivers run against the emulated devices (odrive_bench,
+* imu_bench): the host types and libm of include/Arduino.h, plus Print and
+* Stream and a virtual clock. micros() and millis() advance the clock a
+* little on every call, as the busy-wait of a polling loop would, and delay()
+* by the whole wait; the emulated ODrives and IMUs run in that time
+* (sim_clock.h). The compute core never sees this header, so anything else
+* touching hardware still fails to link there.
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef PI
+    #define PI 3.1415926535897932384626433832795
+#endif
+
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+// The emulated interrupts only run inside micros(), millis() and delay(), so there is nothing to mask
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n) { return printf_("%d", n); }
+    size_t print(unsigned n) { return printf_("%u", n); }
+    size_t print(long n) { return printf_("%ld", n); }
+    size_t print(unsigned long n) { return printf_("%lu", n); }
+    size_t print(double n, int digits = 2) { return printf_("%.*f", digits, n); }
+    template<class T> size_t println(T value) { return print(value) + print("\r\n"); }
+    size_t println() { return print("\r\n"); }
+
+private:
+    template<class... A> size_t printf_(const char* format, A... args) {
+        char text[40];
+        int n = snprintf(text, sizeof(text), format, args...);
+        return write((const uint8_t*)text, n < (int)sizeof(text) ? n : sizeof(text) - 1);
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+#endif //SimArduino_h
@@ -0,0 +1,53 @@
+#ifndef SimFlexCAN_T4_h
+#define SimFlexCAN_T4_h
+
+/* The part of FlexCAN_T4 ODriveCANDriver uses, wired to odrive_sim's bus:
+* write() queues a frame for the bus (0 once 16 wait, as the TX mailboxes
+* run out), and frames from the emulated nodes reach the onReceive()
+* callback when their last bit is on the wire, as the FIFO interrupt would.
+*/
+#include "Arduino.h"
+
+enum CAN_DEV_TABLE { CAN1, CAN2, CAN3 };
+enum FLEXCAN_RXQUEUE_TABLE { RX_SIZE_2 = 2, RX_SIZE_4 = 4, RX_SIZE_8 = 8, RX_SIZE_16 = 16, RX_SIZE_32 = 32 };
+enum FLEXCAN_TXQUEUE_TABLE { TX_SIZE_2 = 2, TX_SIZE_4 = 4, TX_SIZE_8 = 8, TX_SIZE_16 = 16, TX_SIZE_32 = 32 };
+
+struct CAN_message_t {
+    uint32_t id = 0;
+    uint16_t timestamp = 0;
+    struct {
+        bool extended = 0;
+        bool remote = 0;
+        bool overrun = 0;
+        bool reserved = 0;
+    } flags;
+    uint8_t len = 8;
+    uint8_t buf[8] = {0};
+};
+
+typedef void (*_MB_ptr)(const CAN_message_t& msg);
+
+namespace odrive_sim {
+    // odrive_sim.cpp: the host end of the bus the emulated nodes are on
+    void canAttach(_MB_ptr handler, uint32_t baud_rate);
+    int canWrite(const CAN_message_t& msg);
+}
+
+template<CAN_DEV_TABLE _bus, FLEXCAN_RXQUEUE_TABLE _rxSize = RX_SIZE_16, FLEXCAN_TXQUEUE_TABLE _txSize = TX_SIZE_16>
+class FlexCAN_T4 {
+public:
+    void begin() {}
+    void setBaudRate(uint32_t baud) { baud_ = baud; odrive_sim::canAttach(handler_, baud_); }
+    void setMaxMB(uint8_t) {}
+    void enableFIFO(bool = 1) {}
+    void enableFIFOInterrupt(bool = 1) {}
+    void onReceive(_MB_ptr handler) { handler_ = handler; odrive_sim::canAttach(handler_, baud_); }
+    int write(const CAN_message_t& msg) { return odrive_sim::canWrite(msg); }
+    int events() { return 0; }
+
+private:
+    _MB_ptr handler_ = nullptr;
+    uint32_t baud_ = 1000000;
+};
+
+#endif //SimFlexCAN_T4_h
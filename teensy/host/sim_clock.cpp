@@ -0,0 +1,65 @@
+#include "sim_clock.h"
+
+#include <algorithm>
+#include <Arduino.h>
+
+namespace sim {
+
+uint64_t Clock::now_ = 0;
+uint32_t Clock::poll_ns_ = 50;
+bool Clock::servicing_ = false;
+std::vector<Device*> Clock::devices_;
+
+void Clock::advanceTo(uint64_t t_ns) {
+    if (servicing_) return;
+    servicing_ = true;
+    for (;;) {
+        Device* due = nullptr;
+        uint64_t first = UINT64_MAX;
+        for (Device* d : devices_) {
+            uint64_t n = d->next();
+            if (n < first) {
+                first = n;
+                due = d;
+            }
+        }
+        if (!due || first > t_ns) break;
+        if (first > now_) now_ = first;
+        due->service(now_);
+    }
+    if (t_ns > now_) now_ = t_ns;
+    servicing_ = false;
+}
+
+void Clock::poll() {
+    if (!servicing_) advanceTo(now_ + poll_ns_);
+}
+
+void Clock::attach(Device* device) { devices_.push_back(device); }
+
+void Clock::detach(Device* device) {
+    devices_.erase(std::remove(devices_.begin(), devices_.end(), device), devices_.end());
+}
+
+void Clock::reset() {
+    now_ = 0;
+    servicing_ = false;
+    devices_.clear();
+}
+
+} // namespace sim
+
+// sim/Arduino.h's clock
+uint32_t micros() {
+    sim::Clock::poll();
+    return (uint32_t)(sim::Clock::now() / 1000);
+}
+
+uint32_t millis() {
+    sim::Clock::poll();
+    return (uint32_t)(sim::Clock::now() / 1000000);
+}
+
+void delay(uint32_t ms) { sim::Clock::advance(ms*1000000ull); }
+
+void delayMicroseconds(uint32_t us) { sim::Clock::advance(us*1000ull); }
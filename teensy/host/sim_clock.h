@@ -0,0 +1,75 @@
+#ifndef HOST_SIM_CLOCK_H
+#define HOST_SIM_CLOCK_H
+
+/* The virtual clock the host's emulated devices (odrive_sim.h, imu_sim.h)
+* share, and what sim/Arduino.h's micros(), millis() and delay() read. Time
+* is in ns and only moves when the code under test polls or waits, so a run
+* is the same run every time.
+*
+*     Clock     discrete-event time: advanceTo() services every Device whose
+*               next event falls before the target, in order; the polling
+*               calls (micros(), millis()) advance it by poll_ns each
+*     Random    xorshift64*, so injected jitter, noise and faults repeat with
+*               the seed
+*/
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+namespace sim {
+
+// Anything with events on the virtual clock
+class Device {
+public:
+    virtual ~Device() {}
+    // ns of the next event, UINT64_MAX if none
+    virtual uint64_t next() const = 0;
+    // Run everything due by now_ns
+    virtual void service(uint64_t now_ns) = 0;
+};
+
+class Clock {
+public:
+    static uint64_t now() { return now_; }
+    // Run every device's events up to t_ns in time order, then set the time to t_ns
+    static void advanceTo(uint64_t t_ns);
+    static void advance(uint64_t ns) { advanceTo(now_ + ns); }
+    // What micros() and millis() cost, i.e. how far a polling loop gets per call
+    static void setPollCost(uint32_t ns) { poll_ns_ = ns; }
+    static void attach(Device* device);
+    static void detach(Device* device);
+    // Back to 0 with nothing attached
+    static void reset();
+    // A call from the code under test: advances by the poll cost unless a device is being serviced
+    static void poll();
+    // In a device's event, e.g. an emulated interrupt, where time cannot advance
+    static bool servicing() { return servicing_; }
+
+private:
+    static uint64_t now_;
+    static uint32_t poll_ns_;
+    static bool servicing_;
+    static std::vector<Device*> devices_;
+};
+
+class Random {
+public:
+    explicit Random(uint64_t seed) : state_(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+    uint64_t next() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 2685821657736338717ull;
+    }
+    // Uniform in [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    // Standard normal, Box-Muller
+    double gaussian() { return sqrt(-2.0*log(1.0 - uniform())) * cos(6.283185307179586*uniform()); }
+
+private:
+    uint64_t state_;
+};
+
+} // namespace sim
+
+#endif
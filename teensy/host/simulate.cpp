@@ -0,0 +1,631 @@
+/* simulate: Monte-Carlo rollouts of the rimless wheel under a neural PBC, with
+* the firmware's own sense step in the loop, to validate a controller over
+* thousands of perturbed robots before it gets hardware time.
+*
+*     simulate [--rollouts n] [--seconds s] [--threads n] [--seed n] [--controller name] [--csv out.csv]
+*              [--mass-sigma r] [--length-sigma r] [--incline-sigma rad] [--init-sigma rad]
+*              [--gyro-sigma rad/s] [--gyro-bias rad/s] [--accel-sigma m/s^2] [--encoder-cpr n]
+*              [--substeps n] [--contact-angle]
+*              [--latency min_ms max_ms | --latency-bins bin_us:c0,c1,... | --pipeline]
+*              [--loop-ms q] [--rosserial-ms base tail] [--drop p] [--controller-hz f] [--compute-ms c]
+*              [--odrive-ms base tail] [--command-timeout-ms t] [--interpolate]
+*
+* The plant is src/RimlessWheelModel.h's hybrid model with WHEEL_SPOKES
+* spokes: the stance ODE by the midpoint rule in --substeps steps per 10 ms
+* tick, and at the guard the ImpactMap closed form and the switch to the next
+* spoke. Each rollout draws its own wheel, m1, m2 (and the inertias with
+* them) and l1, l2 scaled by 1 + N(0, sigma), the ground incline and the gyro
+* bias, so the plant's terms
+* (RobotModel's M11..G2 and ImpactMap's D0..Q) are runtime values here; a
+* check at startup holds the unperturbed wheel to RimlessWheel::step() and
+* ImpactMap::evaluate() and prints the largest difference as model_check.
+*
+* Every tick runs what controlStep() runs, per rollout:
+*
+*     encoder  the spoke angle as motor turns quantized to --encoder-cpr,
+*              through SpokeEstimator (SpokeTracker and the tracking
+*              VelocityEstimator, main.cpp's defaults)
+*     imu      gyro = -phidot + bias + noise, accel = gravity in the torso
+*              frame + noise (the hub's own acceleration is left out),
+*              through TorsoEstimator with MahonyFilter
+*     pbc      the controller of controllers.h, pbc_controller's names, on
+*              the angle since the start or with --contact-angle the stance
+*              spoke's, as SPOKE_CONTACT_ANGLE
+*
+* and the torque reaches the motor by one of three latency models:
+*
+*     --latency      min max: one latency per rollout, uniform in [min, max]
+*                    ms (2 8 by default), as an on-board controller and a
+*                    slow bus
+*     --latency-bins a sample-to-applied histogram measured on the robot,
+*                    command_latency's "bins" value on /diagnostics
+*                    (COMMAND_LATENCY), drawn per command
+*     --pipeline     the off-board loop hop by hop: loop() publishes the
+*                    sample within --loop-ms, rosserial carries it to the Pi
+*                    and the torque back (--rosserial-ms, a base plus an
+*                    exponential tail of that mean, losing --drop of the
+*                    messages), the controller answers on arrival as
+*                    pbc_controller or with --controller-hz at its own Rate
+*                    and a random phase, after --compute-ms; loop() pushes
+*                    the torque into the firmware's CommandQueue (timeout and
+*                    --interpolate as main.cpp), the next control step
+*                    samples it and the ODrive takes it --odrive-ms later
+*
+* Each stage can be set to what a transport or scheduling change would make
+* it, and the summary gives the sample-to-motor latency the rollouts saw
+* beside what it did to them. Message times are kept exactly; the motor
+* changes torque at the next substep.
+*
+* Rollouts run in blocks of pbc_host::batch lanes: the plant state and terms
+* are arrays over the lanes (structure of arrays, so the stance step
+* vectorizes) and a block is one batched forward pass per tick. Blocks are
+* dealt to --threads workers (all cores by default); every rollout seeds its
+* own generator from --seed and its index, so the results do not depend on
+* the thread count.
+*
+* A rollout has fallen once |phi| passes pi/2, and stops there. The summary
+* is one "key value" per line; speeds are the signed distance (whole steps
+* times the step length 2 l1 sin(alpha)) over the time the rollout stood.
+* --csv writes one row per rollout. The exit code is 1 if the model check
+* failed or a state was not finite.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <RobotModel.h>
+#include <CommandQueue.h>
+#include <ImpactMap.h>
+#include <MahonyFilter.h>
+#include <SpokeEstimator.h>
+#include <TorsoEstimator.h>
+#include <VelocityEstimator.h>
+#include <filters_bank.h>
+#include "controllers.h"
+#include "parallel.h"
+#include "rollout.h"
+
+namespace {
+
+typedef RimlessWheelModel Robot;
+typedef std::chrono::steady_clock Clock;
+using rollout::Rng;
+using rollout::Wheel;
+typedef rollout::Block<pbc_host::batch> Block;
+
+constexpr int W = pbc_host::batch;              // lanes per block
+constexpr uint32_t period_us = 10000;           // FILTER_UPDATE_RATE_HZ
+constexpr float samplingTime = period_us * 1e-6f;
+constexpr int max_pending = 16;                 // messages in flight per hop and lane
+
+// main.cpp's configuration
+struct TorsoAhrs {
+    static constexpr float period = samplingTime;
+    static constexpr float two_kp = 2.0f*0.5f;
+    static constexpr float two_ki = 0.0f;
+};
+struct SpokeRate {
+    static constexpr IIR::ORDER order = IIR::ORDER::OD3;
+    static constexpr IIR::TYPE  type  = IIR::TYPE::LOWPASS;
+    static constexpr float_t    hz    = 30.0;
+    static constexpr float_t    ts    = samplingTime;
+};
+constexpr float trackingBandwidth_hz = 30.0f;   // SPOKE_VEL_TRACKING_BANDWIDTH_HZ
+constexpr uint8_t torsoAlphaWindow = 5;         // TORSO_ALPHA_SAVGOL_WINDOW
+constexpr float spokeDirection = 1.0f;          // SPOKE0_DIRECTION
+
+typedef SpokeEstimator<SpokeRate> Spokes;
+typedef TorsoEstimator<MahonyFilter<TorsoAhrs>> Torso;
+
+// How a sample's torque reaches the motor
+struct Latency {
+    enum Mode { FIXED, HISTOGRAM, PIPELINE };
+    Mode mode = FIXED;
+    // FIXED: one latency per rollout, uniform in [min, max]
+    float min_ms = 2.0f, max_ms = 8.0f;
+    // HISTOGRAM: drawn per command from command_latency's bins
+    float bin_ms = 1.0f;
+    std::vector<double> cdf;
+    // PIPELINE, hop by hop; a hop is base + an exponential tail of that mean
+    float loop_ms = 1.0f;                        // the loop() iteration a sample or command waits out
+    float serialBase_ms = 1.0f, serialTail_ms = 0.5f;   // rosserial, each way
+    float drop = 0.0f;                           // per rosserial message
+    float controllerHz = 0.0f;                   // 0: computed on arrival, as pbc_controller
+    float compute_ms = 0.2f;
+    float odriveBase_ms = 0.5f, odriveTail_ms = 0.2f;
+    float timeout_ms = 50.0f;                    // COMMAND_TIMEOUT_US
+    bool interpolate = false;                    // COMMAND_INTERPOLATE
+
+    // "bin_us:c0,c1,..." as command_latency's bins on /diagnostics
+    bool parseBins(const char* text) {
+        char* end;
+        const double bin_us = strtod(text, &end);
+        if (*end != ':' || !(bin_us > 0.0)) return false;
+        double total = 0.0;
+        cdf.clear();
+        do {
+            total += strtod(end + 1, &end);
+            cdf.push_back(total);
+        } while (*end == ',');
+        if (*end || !(total > 0.0)) return false;
+        for (double& c : cdf) c /= total;
+        bin_ms = (float)(bin_us * 1e-3);
+        mode = HISTOGRAM;
+        return true;
+    }
+};
+
+struct Options {
+    int rollouts = 4096;
+    float seconds = 10.0f;
+    int threads = (int)std::thread::hardware_concurrency();
+    uint64_t seed = 1;
+    const char* controller = "deterministic";
+    const char* csv = nullptr;
+    float massSigma = 0.05f, lengthSigma = 0.02f, inclineSigma = 0.0f, initSigma = 0.05f;
+    float gyroSigma = 0.01f, gyroBias = 0.005f, accelSigma = 0.2f;
+    int encoderCpr = 8192;
+    Latency latency;
+    int substeps = 10;
+    bool contactAngle = false;
+};
+
+// Sample-to-motor latencies in 0.1 ms bins, the last one everything from 100 ms
+struct LatencyHistogram {
+    static constexpr int num_bins = 1001;
+    static constexpr float bin_ms = 0.1f;
+    uint64_t bins[num_bins] = {};
+    uint64_t n = 0;
+    double sum_ms = 0.0, max_ms = 0.0;
+
+    void add(float ms) {
+        ++bins[std::min(num_bins - 1, (int)(ms / bin_ms))];
+        ++n;
+        sum_ms += ms;
+        max_ms = std::max(max_ms, (double)ms);
+    }
+    void add(const LatencyHistogram& o) {
+        for (int i = 0; i < num_bins; ++i) bins[i] += o.bins[i];
+        n += o.n;
+        sum_ms += o.sum_ms;
+        max_ms = std::max(max_ms, o.max_ms);
+    }
+    // Fraction q, interpolated within its bin and never past the largest seen
+    float quantile(float q) const {
+        const double rank = q*n;
+        uint64_t seen = 0;
+        for (int i = 0; i < num_bins; ++i) {
+            if (bins[i] == 0 || seen + bins[i] < rank) {
+                seen += bins[i];
+                continue;
+            }
+            const double ms = (i + (rank - seen)/bins[i])*bin_ms;
+            return (float)std::min(ms, max_ms);
+        }
+        return NAN;
+    }
+};
+
+// The messages in flight on one hop, torques with the stamp of the sample they came from
+class Link {
+public:
+    struct Message {
+        double at, stamp;
+        float torque;
+    };
+
+    // a full hop loses its oldest message
+    void push(double at, float torque, double stamp) {
+        if (n_ == max_pending)
+            take(std::min_element(m_, m_ + n_, [](const Message& a, const Message& b) { return a.at < b.at; }) - m_);
+        m_[n_++] = {at, stamp, torque};
+    }
+    // The messages arrived by t into out, in arrival order; their count
+    int receive(double t, Message* out) {
+        int k = 0;
+        for (int i = 0; i < n_;)
+            if (m_[i].at <= t) out[k++] = take(i);
+            else ++i;
+        std::sort(out, out + k, [](const Message& a, const Message& b) { return a.at < b.at; });
+        return k;
+    }
+    // Only the last of them
+    bool latest(double t, Message& out) {
+        Message arrived[max_pending];
+        const int k = receive(t, arrived);
+        if (k) out = arrived[k - 1];
+        return k > 0;
+    }
+
+private:
+    Message take(int i) {
+        const Message m = m_[i];
+        m_[i] = m_[--n_];
+        return m;
+    }
+
+    Message m_[max_pending];
+    int n_ = 0;
+};
+
+// One rollout's way from the control step to the motor. FIXED and HISTOGRAM
+// delay the step's own torque; PIPELINE is the off-board loop: loop()
+// publishes the sample, rosserial carries it to the Pi, the controller
+// answers on arrival or at its own Rate (with this rollout's phase),
+// rosserial carries the torque back, loop() pushes it into the firmware's
+// CommandQueue and the next control step samples that and writes it to the
+// ODrive.
+class Delivery {
+public:
+    Delivery(const Latency& model, uint64_t seed)
+        : m_(model), rng_(seed), queue_((uint32_t)lroundf(model.timeout_ms*1e3f), model.interpolate) {
+        fixed_s_ = (m_.min_ms + (m_.max_ms - m_.min_ms)*rng_.uniform())*1e-3;
+        nextControl_s_ = m_.controllerHz > 0.0f ? rng_.uniform()/m_.controllerHz : 0.0;
+    }
+
+    // The control step at t; torque is the controller's on the step's sample
+    void controlStep(double t, float torque) {
+        if (m_.mode == Latency::FIXED) {
+            motor_.push(t + fixed_s_, torque, t);
+        } else if (m_.mode == Latency::HISTOGRAM) {
+            motor_.push(t + drawBin(), torque, t);
+        } else {
+            advance(t);
+            send(up_, t + loopWait(), torque, t);
+            const float u = queue_.sample((uint32_t)llround(t*1e6));
+            // a timed-out zero has no sample behind it
+            const double stamp = queue_.seq() && !queue_.timedOut() ? stamps_[queue_.seq() % CommandQueue::ring_size] : -1.0;
+            motor_.push(t + hop(m_.odriveBase_ms, m_.odriveTail_ms), u, stamp);
+        }
+    }
+
+    // Every hop up to t; the torque acting on the motor at t
+    float torque(double t, LatencyHistogram& latencies) {
+        if (m_.mode == Latency::PIPELINE)
+            advance(t);
+        Link::Message m;
+        if (motor_.latest(t, m)) {
+            u_ = m.torque;
+            if (m.stamp >= 0.0 && m.stamp != lastStamp_) {
+                const float ms = (float)((m.at - m.stamp)*1e3);
+                latencies.add(ms);
+                sum_ms_ += ms;
+                ++applied_;
+            }
+            lastStamp_ = m.stamp;
+        }
+        return u_;
+    }
+
+    // Mean sample-to-motor latency of the commands applied
+    float meanLatency_ms() const { return applied_ ? (float)(sum_ms_ / applied_) : NAN; }
+    uint32_t sent() const { return sent_; }
+    uint32_t dropped() const { return dropped_; }
+    uint32_t timeouts() const { return queue_.timeouts(); }
+
+private:
+    double hop(float base_ms, float tail_ms) { return (base_ms + rng_.exponential(tail_ms))*1e-3; }
+
+    double drawBin() {
+        const double u = rng_.uniform();
+        const size_t bin = std::lower_bound(m_.cdf.begin(), m_.cdf.end(), u) - m_.cdf.begin();
+        return (std::min(bin, m_.cdf.size() - 1) + rng_.uniform())*m_.bin_ms*1e-3;
+    }
+
+    double loopWait() { return rng_.uniform()*m_.loop_ms*1e-3; }
+
+    // a rosserial message, lost or delivered after its hop
+    void send(Link& link, double t, float torque, double stamp) {
+        ++sent_;
+        if (rng_.uniform() < m_.drop) ++dropped_;
+        else link.push(t + hop(m_.serialBase_ms, m_.serialTail_ms), torque, stamp);
+    }
+
+    void advance(double t) {
+        Link::Message arrived[max_pending];
+        if (m_.controllerHz > 0.0f) {
+            // a Rate loop answers with the newest sample it has, new or not
+            for (; nextControl_s_ <= t; nextControl_s_ += 1.0/m_.controllerHz) {
+                Link::Message m;
+                if (up_.latest(nextControl_s_, m)) pi_ = m, havePi_ = true;
+                if (havePi_) send(down_, nextControl_s_ + m_.compute_ms*1e-3 + loopWait(), pi_.torque, pi_.stamp);
+            }
+        } else {
+            const int k = up_.receive(t, arrived);
+            for (int i = 0; i < k; ++i)
+                send(down_, arrived[i].at + m_.compute_ms*1e-3 + loopWait(), arrived[i].torque, arrived[i].stamp);
+        }
+        // the hop back includes loop() getting to it, so arrival is when push() stamps it
+        const int k = down_.receive(t, arrived);
+        for (int i = 0; i < k; ++i) {
+            stamps_[(queue_.seq() + 1) % CommandQueue::ring_size] = arrived[i].stamp;
+            queue_.push(arrived[i].torque, (uint32_t)llround(arrived[i].at*1e6));
+        }
+    }
+
+    const Latency& m_;
+    Rng rng_;
+    CommandQueue queue_;
+    double stamps_[CommandQueue::ring_size] = {};
+    Link up_, down_, motor_;
+    Link::Message pi_ = {};
+    bool havePi_ = false;
+    double fixed_s_, nextControl_s_;
+    float u_ = 0.0f;
+    double lastStamp_ = -1.0, sum_ms_ = 0.0;
+    uint32_t applied_ = 0, sent_ = 0, dropped_ = 0;
+};
+
+
+struct Result {
+    Wheel wheel;
+    float latency_ms = 0.0f;
+    bool fell = false, finite = true;
+    float stood_s = 0.0f;
+    int steps = 0, impacts = 0;
+    uint32_t sent = 0, dropped = 0, timeouts = 0;
+    float distance = 0.0f, speed = 0.0f, saturated = 0.0f, torqueRms = 0.0f;
+};
+
+
+// Rollouts [first, first + W) of the Monte Carlo, lanes past count unused
+void simulateBlock(int first, int count, const Options& o, const pbc_host::Controller& controller, Result* results,
+                   LatencyHistogram& latencies) {
+    const int ticks = (int)lroundf(o.seconds / samplingTime);
+    const float dt = samplingTime / o.substeps;
+    const float countsPerTurn = (float)o.encoderCpr;
+    Block b;
+    std::vector<Rng> rng;
+    std::vector<Spokes> spokes;
+    std::vector<Torso> torso;
+    std::vector<Delivery> delivery;
+    float bias[W];
+    int saturated[W] = {};
+    double torque2[W] = {};
+    for (int l = 0; l < W; ++l) {
+        rng.emplace_back(o.seed*0x100000001b3ull + (uint64_t)(first + l));
+        Rng& r = rng.back();
+        Result& res = results[l];
+        res.wheel = Wheel::nominal().perturbed(r, o.massSigma, o.lengthSigma, o.inclineSigma);
+        delivery.emplace_back(o.latency, r.next());
+        b.setWheel(l, res.wheel);
+        b.theta[l] = 0.5f*Robot::alpha*(2.0f*r.uniform() - 1.0f);
+        b.phi[l] = o.initSigma*r.gaussian();
+        b.thetadot[l] = b.phidot[l] = b.u[l] = 0.0f;
+        b.spokes[l] = 0;
+        b.alive[l] = l < count;
+        bias[l] = o.gyroBias*r.gaussian();
+        spokes.emplace_back(VelocityEstimator::tracking(trackingBandwidth_hz), Spokes::RATE_ESTIMATOR,
+                            VelocityEstimator::tracking(trackingBandwidth_hz), Spokes::RATE_ESTIMATOR,
+                            spokeDirection, spokeDirection);
+        torso.emplace_back(VelocityEstimator::savitzkyGolay(torsoAlphaWindow, 2));
+    }
+
+    pbc_host::State x[W];
+    float command[W];
+    long n = 0;                                  // substeps since the start
+    for (int tick = 0; tick < ticks; ++tick) {
+        const uint32_t t_us = tick*period_us;
+        for (int l = 0; l < W; ++l) {
+            Rng& r = rng[l];
+            // the driver's turns, to the encoder's count
+            const float turns = roundf(b.spokeAngle(l)/(spokeDirection*Robot::turnToSpoke)*countsPerTurn)/countsPerTurn;
+            const float pos[2] = {turns, turns}, vel[2] = {0.0f, 0.0f};
+            float spokeStates[4], torsoStates[3];
+            spokes[l].update(pos, vel, false, t_us, spokeStates);
+            // the torso turns about -x of the IMU
+            const Vec3 gyro(-b.phidot[l] + bias[l] + o.gyroSigma*r.gaussian(), o.gyroSigma*r.gaussian(), o.gyroSigma*r.gaussian());
+            const Vec3 accel(o.accelSigma*r.gaussian(), -Robot::g*sinf(b.phi[l]) + o.accelSigma*r.gaussian(),
+                             Robot::g*cosf(b.phi[l]) + o.accelSigma*r.gaussian());
+            torso[l].fuse(gyro, &accel, Vec3(), samplingTime);
+            torso[l].states(torsoStates);
+            const float spokeAngle = o.contactAngle ? spokes[l].contactAngle(0) : spokeStates[0];
+            x[l] = {torsoStates[0], Robot::uprightSpokeAngle + spokeAngle, torsoStates[1], spokeStates[2]};
+        }
+        controller.control(x, W, command);
+        for (int l = 0; l < W; ++l) {
+            if (!b.alive[l]) continue;
+            if (fabsf(command[l]) >= controller.saturation()) ++saturated[l];
+            torque2[l] += (double)command[l]*command[l];
+            delivery[l].controlStep(n*(double)dt, command[l]);
+        }
+        for (int s = 0; s < o.substeps; ++s, ++n) {
+            for (int l = 0; l < W; ++l)
+                if (b.alive[l]) b.u[l] = delivery[l].torque(n*(double)dt, latencies);
+            b.step(dt);
+            const unsigned hit = b.impacts();
+            for (int l = 0; l < W; ++l) {
+                if (hit & (1u << l)) ++results[l].impacts;
+                if (b.alive[l] && !(fabsf(b.phi[l]) < 0.5f*(float)M_PI)) {
+                    b.alive[l] = false;
+                    results[l].fell = true;
+                    results[l].stood_s = (n + 1)*dt;
+                    results[l].finite = std::isfinite(b.phi[l]);
+                }
+            }
+        }
+    }
+
+    const float stepLength = 2.0f*sinf(Robot::alpha);
+    for (int l = 0; l < count; ++l) {
+        Result& res = results[l];
+        if (!res.fell) res.stood_s = ticks*samplingTime;
+        const float ticksStood = std::max(1.0f, res.stood_s / samplingTime);
+        res.steps = b.spokes[l];
+        res.distance = res.steps*stepLength*res.wheel.l1;
+        res.speed = res.stood_s > 0.0f ? res.distance / res.stood_s : 0.0f;
+        res.saturated = saturated[l] / ticksStood;
+        res.torqueRms = (float)sqrt(torque2[l] / ticksStood);
+        res.finite = res.finite && std::isfinite(b.theta[l]) && std::isfinite(b.thetadot[l]);
+        res.latency_ms = delivery[l].meanLatency_ms();
+        res.sent = delivery[l].sent();
+        res.dropped = delivery[l].dropped();
+        res.timeouts = delivery[l].timeouts();
+    }
+}
+
+// The q-quantile of v, sorted in place
+float quantile(std::vector<float>& v, float q) {
+    if (v.empty()) return NAN;
+    std::sort(v.begin(), v.end());
+    return v[(size_t)lroundf(q*(v.size() - 1))];
+}
+
+bool parse(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; ++i) {
+        const bool more = i + 1 < argc;
+        if (strcmp(argv[i], "--rollouts") == 0 && more) o.rollouts = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && more) o.seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && more) o.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && more) o.seed = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--controller") == 0 && more) o.controller = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0 && more) o.csv = argv[++i];
+        else if (strcmp(argv[i], "--mass-sigma") == 0 && more) o.massSigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--length-sigma") == 0 && more) o.lengthSigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--incline-sigma") == 0 && more) o.inclineSigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--init-sigma") == 0 && more) o.initSigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--gyro-sigma") == 0 && more) o.gyroSigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--gyro-bias") == 0 && more) o.gyroBias = atof(argv[++i]);
+        else if (strcmp(argv[i], "--accel-sigma") == 0 && more) o.accelSigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--encoder-cpr") == 0 && more) o.encoderCpr = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--substeps") == 0 && more) o.substeps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--contact-angle") == 0) o.contactAngle = true;
+        else if (strcmp(argv[i], "--latency") == 0 && i + 2 < argc) {
+            o.latency.mode = Latency::FIXED;
+            o.latency.min_ms = atof(argv[++i]);
+            o.latency.max_ms = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--latency-bins") == 0 && more) {
+            if (!o.latency.parseBins(argv[++i])) return false;
+        }
+        else if (strcmp(argv[i], "--pipeline") == 0) o.latency.mode = Latency::PIPELINE;
+        else if (strcmp(argv[i], "--loop-ms") == 0 && more) o.latency.loop_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--rosserial-ms") == 0 && i + 2 < argc) {
+            o.latency.serialBase_ms = atof(argv[++i]);
+            o.latency.serialTail_ms = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--drop") == 0 && more) o.latency.drop = atof(argv[++i]);
+        else if (strcmp(argv[i], "--controller-hz") == 0 && more) o.latency.controllerHz = atof(argv[++i]);
+        else if (strcmp(argv[i], "--compute-ms") == 0 && more) o.latency.compute_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--odrive-ms") == 0 && i + 2 < argc) {
+            o.latency.odriveBase_ms = atof(argv[++i]);
+            o.latency.odriveTail_ms = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--command-timeout-ms") == 0 && more) o.latency.timeout_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--interpolate") == 0) o.latency.interpolate = true;
+        else return false;
+    }
+    if (o.threads < 1) o.threads = 1;
+    const Latency& l = o.latency;
+    return o.rollouts > 0 && o.seconds > 0.0f && o.substeps > 0 && o.encoderCpr > 0 &&
+           l.min_ms >= 0.0f && l.min_ms <= l.max_ms && l.loop_ms >= 0.0f && l.serialBase_ms >= 0.0f &&
+           l.serialTail_ms >= 0.0f && l.odriveBase_ms >= 0.0f && l.odriveTail_ms >= 0.0f && l.compute_ms >= 0.0f &&
+           l.drop >= 0.0f && l.drop < 1.0f && l.controllerHz >= 0.0f;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parse(argc, argv, o)) {
+        fprintf(stderr, "usage: %s [--rollouts n] [--seconds s] [--threads n] [--seed n] [--controller name] [--csv out.csv]\n"
+                        "       [--mass-sigma r] [--length-sigma r] [--incline-sigma rad] [--init-sigma rad]\n"
+                        "       [--gyro-sigma rad/s] [--gyro-bias rad/s] [--accel-sigma m/s^2] [--encoder-cpr n]\n"
+                        "       [--substeps n] [--contact-angle]\n"
+                        "       [--latency min_ms max_ms | --latency-bins bin_us:c0,c1,... | --pipeline]\n"
+                        "       [--loop-ms q] [--rosserial-ms base tail] [--drop p] [--controller-hz f] [--compute-ms c]\n"
+                        "       [--odrive-ms base tail] [--command-timeout-ms t] [--interpolate]\n", argv[0]);
+        return 2;
+    }
+    std::vector<std::unique_ptr<pbc_host::Controller>> controllers = pbc_host::controllers();
+    const pbc_host::Controller* controller = pbc_host::find(controllers, o.controller);
+    if (!controller) {
+        fprintf(stderr, "unknown controller %s\n", o.controller);
+        return 2;
+    }
+
+    const float check = rollout::modelCheck<W>();
+    const size_t blocks = (o.rollouts + W - 1) / W;
+    std::vector<Result> results(blocks*W);
+    std::vector<LatencyHistogram> blockLatencies(blocks);
+    const auto start = Clock::now();
+    host::parallelFor(blocks, o.threads, [&](size_t k) {
+        const int first = (int)k*W;
+        simulateBlock(first, std::min(W, o.rollouts - first), o, *controller, &results[first], blockLatencies[k]);
+    });
+    const double wall_s = std::chrono::duration<double>(Clock::now() - start).count();
+    results.resize(o.rollouts);
+    LatencyHistogram latencies;
+    for (const LatencyHistogram& h : blockLatencies) latencies.add(h);
+
+    int fell = 0;
+    bool finite = true;
+    double steps = 0.0, impacts = 0.0, saturated = 0.0, torque = 0.0, sent = 0.0, dropped = 0.0, timeouts = 0.0;
+    std::vector<float> speeds, falls;
+    for (const Result& r : results) {
+        fell += r.fell;
+        finite = finite && r.finite;
+        steps += r.steps;
+        impacts += r.impacts;
+        saturated += r.saturated;
+        torque += r.torqueRms;
+        sent += r.sent;
+        dropped += r.dropped;
+        timeouts += r.timeouts;
+        speeds.push_back(r.speed);
+        if (r.fell) falls.push_back(r.stood_s);
+    }
+    const double n = o.rollouts;
+    printf("controller %s\n", controller->name());
+    printf("rollouts %d\n", o.rollouts);
+    printf("seconds %g\n", o.seconds);
+    printf("threads %d\n", o.threads);
+    printf("model_check %.3g\n", check);
+    printf("wall_s %.3f\n", wall_s);
+    printf("rollouts_per_s %.1f\n", n / wall_s);
+    printf("realtime_factor %.0f\n", n*o.seconds / wall_s);
+    printf("fell %.4f\n", fell / n);
+    printf("fall_s_median %.3f\n", quantile(falls, 0.5f));
+    printf("steps_mean %.2f\n", steps / n);
+    printf("impacts_mean %.2f\n", impacts / n);
+    double speedSum = 0.0;
+    for (float v : speeds) speedSum += v;
+    printf("speed_mean %.4f\n", speedSum / n);
+    printf("speed_p10 %.4f\n", quantile(speeds, 0.1f));
+    printf("speed_p50 %.4f\n", quantile(speeds, 0.5f));
+    printf("speed_p90 %.4f\n", quantile(speeds, 0.9f));
+    printf("saturated %.4f\n", saturated / n);
+    printf("torque_rms %.4f\n", torque / n);
+    static const char* const modes[] = {"fixed", "histogram", "pipeline"};
+    printf("latency %s\n", modes[o.latency.mode]);
+    printf("latency_mean_ms %.3f\n", latencies.n ? latencies.sum_ms / latencies.n : NAN);
+    printf("latency_p50_ms %.3f\n", latencies.quantile(0.5f));
+    printf("latency_p99_ms %.3f\n", latencies.quantile(0.99f));
+    printf("latency_max_ms %.3f\n", latencies.max_ms);
+    printf("dropped %.4f\n", sent > 0.0 ? dropped / sent : 0.0);
+    printf("timeouts_mean %.2f\n", timeouts / n);
+
+    if (o.csv) {
+        FILE* csv = fopen(o.csv, "w");
+        if (!csv) {
+            perror(o.csv);
+            return 1;
+        }
+        fprintf(csv, "rollout,m1,m2,l1,l2,incline,latency_ms,fell,stood_s,steps,impacts,distance,speed,saturated,torque_rms,"
+                     "dropped,timeouts\n");
+        for (int i = 0; i < o.rollouts; ++i) {
+            const Result& r = results[i];
+            fprintf(csv, "%d,%g,%g,%g,%g,%g,%g,%d,%g,%d,%d,%g,%g,%g,%g,%u,%u\n", i, r.wheel.m1, r.wheel.m2, r.wheel.l1,
+                    r.wheel.l2, r.wheel.incline, r.latency_ms, r.fell ? 1 : 0, r.stood_s, r.steps, r.impacts, r.distance,
+                    r.speed, r.saturated, r.torqueRms, r.dropped, r.timeouts);
+        }
+        fclose(csv);
+    }
+    return check < 1e-4f && finite ? 0 : 1;
+}
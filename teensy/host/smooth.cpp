@@ -0,0 +1,373 @@
+/* smooth: the best state estimate of recorded runs for training data, from
+* the whole run rather than the causal one the robot had: the firmware's
+* HybridEKF<RimlessWheel> forward, as replay runs it, then a
+* Rauch-Tung-Striebel pass backward over its estimates.
+*
+*     smooth [--threads n] [--lag s] [--window n] [--out DIR] RUN.bson|FLIGHTnn.BIN|RUN.rwa|DIR ...
+*
+* The forward pass is replay's ekf stage: predict under the torque recorded
+* for the tick before (none in a hardware_data .bson, whose torques were not
+* logged, so the rates' process noise takes the controller), an ImpactDetector
+* jump and a correction on [spoke 0, roll, spoke 0 rate, roll rate]. The EKF
+* keeps the linearization of each tick's state map (HybridEKF's Smoothing),
+* guard and detector jumps included, so the backward pass carries the
+* smoothed state across impacts as the filter did. Where a glitch in the
+* recording makes the filter's estimate non-finite, it restarts from the
+* measurement and the backward pass does not reach across the restart.
+*
+* Memory is bounded by the window: the forward estimates of --window samples
+* (4096 by default) and --lag seconds (5 by default) after them are kept,
+* the backward pass runs from the end of the lag, which starts it from the
+* filter's estimate instead of the smoothed one, and the window's first
+* --window samples are written and dropped. What that start costs decays
+* over the lag: on hardware_data the rates are within 5e-5 rad/s of the
+* full-run smoother's at 5 s, 5e-3 at 2 s. The run's last window is exact. A run archive is memory-mapped
+* and read a window at a time; a .bson or flight log is parsed whole first,
+* as it has to be.
+*
+* Runs are smoothed in parallel on --threads workers (all cores by default).
+* With --out, each run goes to DIR/<run>.smooth.csv, one row per sample:
+* the measurement, the filtered and smoothed [theta, phi, thetadot, phidot]
+* (theta the stance spoke's angle in [-alpha, alpha), as the EKF has it) and
+* the smoothed standard deviations. The summary is replay's "key value" lines
+* per run: how far the smoother moved the filtered rates and how far the
+* smoothed rates are from the measured ones. The exit code is 1 if a run could
+* not be read or written, or an estimate was not finite.
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <FlightLogFormat.h>
+#include <RobotModel.h>
+#include <ImpactMap.h>
+#include <HybridEKF.h>
+#include <ImpactDetector.h>
+#include "RimlessWheelModel.h"
+#include "archive.h"
+#include "parallel.h"
+#include "runs.h"
+
+namespace {
+
+using runs::Sample;
+
+typedef RimlessWheelModel Robot;
+typedef HybridEKF<RimlessWheel, true> Filter;
+typedef std::chrono::steady_clock Clock;
+
+constexpr int N = Filter::N;
+constexpr float impactAccelSpike = 15.0f, impactRateJump = 1.5f;   // main.cpp's, as replay
+
+// One tick of the forward pass
+struct Step {
+    uint32_t sample, stamp_us;
+    float z[RimlessWheel::num_measurements];
+    bool linked;                // predicted from the step before; false at the reset
+    float xp[N], Pp[N*N];       // before the correction
+    float A[N*N];               // d xp / d (the step before's xf)
+    float xf[N], Pf[N*N];       // after it
+};
+
+// x = P^-1 B for symmetric positive definite P (N x N) and B (N x N), false if P is not
+bool solve(const double* P, const double* B, double* X) {
+    double L[N*N] = {};
+    for (int j = 0; j < N; ++j) {
+        double d = P[j*N + j];
+        for (int k = 0; k < j; ++k) d -= L[j*N + k] * L[j*N + k];
+        if (!(d > 0.0)) return false;
+        L[j*N + j] = sqrt(d);
+        for (int i = j + 1; i < N; ++i) {
+            double s = P[i*N + j];
+            for (int k = 0; k < j; ++k) s -= L[i*N + k] * L[j*N + k];
+            L[i*N + j] = s / L[j*N + j];
+        }
+    }
+    for (int c = 0; c < N; ++c) {
+        double y[N];
+        for (int i = 0; i < N; ++i) {
+            double s = B[i*N + c];
+            for (int k = 0; k < i; ++k) s -= L[i*N + k] * y[k];
+            y[i] = s / L[i*N + i];
+        }
+        for (int i = N - 1; i >= 0; --i) {
+            double s = y[i];
+            for (int k = i + 1; k < N; ++k) s -= L[k*N + i] * X[k*N + c];
+            X[i*N + c] = s / L[i*N + i];
+        }
+    }
+    return true;
+}
+
+struct Rms {
+    double sum2 = 0.0;
+    uint64_t n = 0;
+    void add(double error) { sum2 += error*error; ++n; }
+    double value() const { return n ? sqrt(sum2 / n) : NAN; }
+};
+
+struct Result {
+    bool read = false, written = true;
+    uint32_t samples = 0, windows = 0;
+    unsigned long events = 0;
+    uint32_t restarts = 0;      // forward resets after a non-finite estimate
+    uint32_t unlinked = 0;      // backward steps with a predicted covariance that would not invert
+    uint32_t nonFinite = 0;
+    double seconds = 0.0;
+    Rms moveThetadot, movePhidot, residualThetadot, residualPhidot;
+};
+
+class Smoother {
+public:
+    Smoother(uint32_t window, uint32_t lag, FILE* csv, Result& result)
+        : window_(window), lag_(lag), csv_(csv), result_(result) {}
+
+    void add(const Sample& x) {
+        const float period = period_s_;
+        const float dt = started_ ? (int32_t)(x.stamp_us - last_us_) * 1e-6f : period;
+        const float u = started_ && std::isfinite(lastTorque_) ? lastTorque_ : 0.0f;
+        Step s;
+        s.sample = sample_++;
+        s.stamp_us = x.stamp_us;
+        s.linked = started_;
+        if (started_) ekf_.predict(u, dt > 0.0f ? dt : period);
+        if (detector_.encoderSample(x.spoke[0], x.spokeRate[0], x.stamp_us) && started_) {
+            float late_dt = (int32_t)(x.stamp_us - detector_.impactTime_us()) * 1e-6f;
+            late_dt = late_dt < 0.0f ? 0.0f : (late_dt > 2.0f*period ? 2.0f*period : late_dt);
+            ekf_.jump(u, late_dt);
+        }
+        memcpy(s.xp, ekf_.state(), sizeof(s.xp));
+        memcpy(s.Pp, ekf_.covariance(), sizeof(s.Pp));
+        memcpy(s.A, ekf_.transition(), sizeof(s.A));
+        float z[RimlessWheel::num_measurements] = {x.spoke[0], x.roll, x.spokeRate[0], x.rollRate};
+        memcpy(s.z, z, sizeof(s.z));
+        if (started_) ekf_.correct(z);
+        bool finite = true;
+        for (int i = 0; i < N; ++i) finite = finite && std::isfinite(ekf_.state(i));
+        // a glitch in the recording (a rate of thousands of rad/s) can blow the filter up;
+        // it starts over from the measurement, and the smoother from there
+        if (!started_ || !finite) {
+            if (started_) ++result_.restarts;
+            s.linked = false;
+            z[0] = Robot::wrapSpoke(z[0]);
+            ekf_.reset(z, 0.1f);
+        }
+        memcpy(s.xf, ekf_.state(), sizeof(s.xf));
+        memcpy(s.Pf, ekf_.covariance(), sizeof(s.Pf));
+        steps_.push_back(s);
+
+        lastTorque_ = x.torque;
+        last_us_ = x.stamp_us;
+        started_ = true;
+        if (steps_.size() >= (size_t)window_ + lag_) {
+            backward();
+            flush(window_);
+        }
+    }
+
+    void finish() {
+        if (steps_.empty()) return;
+        backward();
+        flush(steps_.size());
+        result_.events = ekf_.events();
+    }
+
+    void setPeriod(uint32_t period_us) { period_s_ = period_us * 1e-6f; }
+
+private:
+    // Rauch-Tung-Striebel over the kept steps, from the newest one's filtered estimate:
+    // C = Pf A^T Pp'^-1, xs = xf + C (xs' - xp'), Ps = Pf + C (Ps' - Pp') C^T
+    void backward() {
+        const size_t n = steps_.size();
+        xs_.resize(n*N);
+        Ps_.resize(n*N*N);
+        for (int i = 0; i < N; ++i) xs_[(n - 1)*N + i] = steps_[n - 1].xf[i];
+        for (int i = 0; i < N*N; ++i) Ps_[(n - 1)*N*N + i] = steps_[n - 1].Pf[i];
+        for (size_t k = n - 1; k-- > 0;) {
+            const Step &s = steps_[k], &next = steps_[k + 1];
+            double* xs = &xs_[k*N];
+            double* Ps = &Ps_[k*N*N];
+            double APf[N*N], Pp[N*N], X[N*N];
+            for (int i = 0; i < N; ++i)
+                for (int j = 0; j < N; ++j) {
+                    double a = 0.0;
+                    for (int m = 0; m < N; ++m) a += (double)next.A[i*N + m] * s.Pf[m*N + j];
+                    APf[i*N + j] = a;
+                    Pp[i*N + j] = next.Pp[i*N + j];
+                }
+            // X = Pp'^-1 A Pf is C^T
+            if (!next.linked || !solve(Pp, APf, X)) {
+                if (next.linked) ++result_.unlinked;
+                for (int i = 0; i < N; ++i) xs[i] = s.xf[i];
+                for (int i = 0; i < N*N; ++i) Ps[i] = s.Pf[i];
+                continue;
+            }
+            const double* xsNext = &xs_[(k + 1)*N];
+            const double* PsNext = &Ps_[(k + 1)*N*N];
+            double d[N];
+            for (int i = 0; i < N; ++i) d[i] = xsNext[i] - next.xp[i];
+            d[0] = Robot::wrapSpoke((float)d[0]);   // as RimlessWheel::residual()
+            for (int i = 0; i < N; ++i) {
+                double v = s.xf[i];
+                for (int j = 0; j < N; ++j) v += X[j*N + i] * d[j];
+                xs[i] = v;
+            }
+            // C (Ps' - Pp') C^T
+            double D[N*N], CD[N*N];
+            for (int i = 0; i < N*N; ++i) D[i] = PsNext[i] - next.Pp[i];
+            for (int i = 0; i < N; ++i)
+                for (int j = 0; j < N; ++j) {
+                    double v = 0.0;
+                    for (int m = 0; m < N; ++m) v += X[m*N + i] * D[m*N + j];
+                    CD[i*N + j] = v;
+                }
+            for (int i = 0; i < N; ++i)
+                for (int j = 0; j < N; ++j) {
+                    double v = s.Pf[i*N + j];
+                    for (int m = 0; m < N; ++m) v += CD[i*N + m] * X[m*N + j];
+                    Ps[i*N + j] = v;
+                }
+        }
+    }
+
+    // Writes the first count steps and drops them; the rest are the next window's lag
+    void flush(size_t count) {
+        for (size_t k = 0; k < count; ++k) {
+            const Step& s = steps_[k];
+            const double* xs = &xs_[k*N];
+            const double* Ps = &Ps_[k*N*N];
+            for (int i = 0; i < N; ++i)
+                if (!std::isfinite(xs[i])) ++result_.nonFinite;
+            result_.moveThetadot.add(xs[2] - s.xf[2]);
+            result_.movePhidot.add(xs[3] - s.xf[3]);
+            result_.residualThetadot.add(xs[2] - s.z[2]);
+            result_.residualPhidot.add(xs[3] - s.z[3]);
+            if (csv_) {
+                fprintf(csv_, "%u,%u,%.7g,%.7g,%.7g,%.7g", s.sample, s.stamp_us, s.z[0], s.z[1], s.z[2], s.z[3]);
+                for (int i = 0; i < N; ++i) fprintf(csv_, ",%.7g", s.xf[i]);
+                for (int i = 0; i < N; ++i) fprintf(csv_, ",%.7g", xs[i]);
+                for (int i = 0; i < N; ++i) fprintf(csv_, ",%.7g", sqrt(Ps[i*N + i] > 0.0 ? Ps[i*N + i] : 0.0));
+                fprintf(csv_, "\n");
+            }
+        }
+        steps_.erase(steps_.begin(), steps_.begin() + count);
+        result_.samples += (uint32_t)count;
+        ++result_.windows;
+    }
+
+    uint32_t window_, lag_;
+    FILE* csv_;
+    Result& result_;
+    float period_s_ = runs::bson_period_us * 1e-6f;
+
+    Filter ekf_;
+    ImpactDetector detector_{Robot::alpha, impactAccelSpike, impactRateJump};
+    bool started_ = false;
+    uint32_t sample_ = 0;
+    uint32_t last_us_ = 0;
+    float lastTorque_ = NAN;
+
+    std::vector<Step> steps_;
+    std::vector<double> xs_, Ps_;
+};
+
+std::string baseName(const std::string& path) {
+    const size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    const size_t dot = name.find_last_of('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+void smoothRun(const std::string& path, const char* outDir, uint32_t window, double lag_s, Result& result) {
+    const auto start = Clock::now();
+    archive::Source source;
+    if (!source.open(path.c_str())) return;
+    result.read = true;
+    FILE* csv = nullptr;
+    if (outDir) {
+        const std::string out = std::string(outDir) + "/" + baseName(path) + ".smooth.csv";
+        csv = fopen(out.c_str(), "w");
+        if (!csv) {
+            perror(out.c_str());
+            result.written = false;
+            return;
+        }
+        fprintf(csv, "sample,stamp_us,spoke0,roll,spoke0_rate,roll_rate,"
+                     "filtered_theta,filtered_phi,filtered_thetadot,filtered_phidot,"
+                     "theta,phi,thetadot,phidot,theta_sd,phi_sd,thetadot_sd,phidot_sd\n");
+    }
+    const uint32_t lag = (uint32_t)ceil(lag_s * 1e6 / source.period_us());
+    Smoother smoother(window, lag, csv, result);
+    smoother.setPeriod(source.period_us());
+    std::vector<Sample> batch;
+    for (uint32_t first = 0; first < source.samples(); first += window) {
+        source.read(first, window, batch);
+        for (const Sample& x : batch) smoother.add(x);
+    }
+    smoother.finish();
+    if (csv && fclose(csv) != 0) result.written = false;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* outDir = nullptr;
+    int threads = (int)std::thread::hardware_concurrency();
+    double lag_s = 5.0;
+    int window = 4096;
+    std::vector<std::string> paths;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) outDir = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--lag") == 0 && i + 1 < argc) lag_s = atof(argv[++i]);
+        else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) window = atoi(argv[++i]);
+        else if (argv[i][0] == '-') usage = true;
+        else runs::expand(argv[i], paths);
+    }
+    if (threads < 1) threads = 1;
+    if (usage || paths.empty() || window < 1 || !(lag_s >= 0.0)) {
+        fprintf(stderr, "usage: %s [--threads n] [--lag s] [--window n] [--out DIR] RUN.bson|FLIGHTnn.BIN|RUN.rwa|DIR ...\n",
+                argv[0]);
+        return 2;
+    }
+
+    const auto start = Clock::now();
+    std::vector<Result> results(paths.size());
+    host::parallelFor(paths.size(), threads, [&](size_t i) {
+        smoothRun(paths[i], outDir, (uint32_t)window, lag_s, results[i]);
+    });
+    const double wall_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("threads %d\n", threads);
+    printf("wall_ms %.1f\n", wall_s * 1e3);
+    bool ok = true;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        const Result& r = results[i];
+        if (!r.read) {
+            fprintf(stderr, "%s: not a flight log, run archive or hardware_data BSON\n", paths[i].c_str());
+            ok = false;
+            continue;
+        }
+        printf("run %s\n", paths[i].c_str());
+        printf("samples %u\n", r.samples);
+        printf("windows %u\n", r.windows);
+        printf("smooth_ms %.1f\n", r.seconds * 1e3);
+        printf("ekf_events %lu\n", r.events);
+        printf("restarts %u\n", r.restarts);
+        printf("unlinked %u\n", r.unlinked);
+        printf("move_thetadot_rms %.6f\n", r.moveThetadot.value());
+        printf("move_phidot_rms %.6f\n", r.movePhidot.value());
+        printf("residual_thetadot_rms %.6f\n", r.residualThetadot.value());
+        printf("residual_phidot_rms %.6f\n", r.residualPhidot.value());
+        printf("non_finite %u\n", r.nonFinite);
+        ok = ok && r.written && r.nonFinite == 0;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,621 @@
+/* tune: a sweep of the loop's rates and filters and the Bayesian controller's
+* sample count over closed-loop rollouts, reporting the Pareto front of
+* compute cost against how well the wheel is controlled, so each of
+* main.cpp's settings can be picked from data.
+*
+*     tune [--rates hz,...] [--odrs hz,...] [--filters f,...] [--cutoffs hz,...] [--samples n,...]
+*          [--controller name] [--rollouts n] [--seconds s] [--threads n] [--seed n] [--csv out.csv]
+*          [--objective torque|fell|speed] [--target-speed m/s] [--latency-ms l] [--plant-hz f]
+*          [--cost-ticks n] [--mass-sigma r] [--length-sigma r] [--gyro-sigma rad/s] [--accel-sigma m/s^2]
+*
+* A configuration is one of each axis:
+*
+*     rate     the control step, FILTER_UPDATE_RATE_HZ (100, 200, 500, 1000)
+*     odr      the IMU's gyro and accel rate, IMU_DATA_RATE (104, 416, 1660);
+*              a tick fuses the mean of the samples since the last one, or
+*              the last one's again when none came
+*     filter   the spoke rate: "tracking", the VelocityEstimator loop of
+*              SPOKE_VEL_TRACKING at the cutoff as its bandwidth, or "lpfN",
+*              the difference over the tick through libFilter's order N
+*              low-pass, as SPOKE_VEL_DIFF_LPF (IIR::ORDER::OD3 is lpf3)
+*     cutoff   that filter's Hz (15, 30, 60); above half the rate it is
+*              skipped
+*     samples  the Bayesian controller's posterior samples a tick (0, 2, 4,
+*              6, 10), a PosteriorBank through setAdaptive(0, n, n); 0 is
+*              the posterior mean alone, "map". Only for --controller
+*              bayesian, the default; another of controllers.h's ignores it
+*
+* with main.cpp's own settings (100 Hz, 104 Hz, tracking at 30 Hz, 10
+* samples) always among them.
+*
+* Every configuration runs the same --rollouts wheels: rollout i draws its
+* masses and lengths (rollout.h), initial state, IMU phase, gyro bias and
+* noise from --seed and i alone, so two configurations differ by their
+* settings and not by their luck. The plant steps at --plant-hz, which every
+* rate divides; the encoder and the torso are sensed as simulate does, the
+* per-sample noise growing with the square root of the odr from
+* --gyro-sigma and --accel-sigma at 104 Hz, and each torque reaches the
+* motor --latency-ms after its tick.
+*
+* Performance is --objective, smaller better:
+*
+*     torque   the RMS difference of the configuration's torque to the same
+*              controller's on the plant's exact state (with all of the
+*              bank's samples for bayesian), over every tick the wheel
+*              stood: what the sensing and the sampling cost the controller
+*     fell     the fraction of rollouts that fell
+*     speed    |mean speed - --target-speed|
+*
+* Cost is the host's time for one tick of the sense and control chain on a
+* single lane, timed apart from the sweep on one thread (the best of three
+* runs of --cost-ticks) and times the rate: microseconds of compute per
+* second of robot time. It ranks configurations the way the Teensy would
+* but is not its time; bench and the on-target suite give that. The IMU's
+* bus traffic is not in it.
+*
+* Configurations x rollout blocks are dealt to --threads workers (all cores
+* by default). The summary is one "key value" per line: the grid, then a
+* "front" line per configuration on the Pareto front by cost, and a
+* "default" line for main.cpp's with how many configurations beat it on
+* both. --csv writes every configuration. The exit code is 1 if the model
+* check failed or a state was not finite.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <MahonyFilter.h>
+#include <PosteriorBank.h>
+#include <TorsoEstimator.h>
+#include <VelocityEstimator.h>
+#include <filters.h>
+#include <weights/rw_bayesian.h>
+#include "controllers.h"
+#include "parallel.h"
+#include "rollout.h"
+
+namespace {
+
+using rollout::Rng;
+using rollout::Wheel;
+using pbc_host::State;
+
+typedef RimlessWheelModel Robot;
+typedef std::chrono::steady_clock Clock;
+
+constexpr int W = pbc_host::batch;              // lanes per block
+constexpr int max_pending = 64;                 // torques in flight per lane
+constexpr float nominalOdr_hz = 104.0f;         // where --gyro-sigma and --accel-sigma hold
+constexpr uint8_t torsoAlphaWindow = 5;         // TORSO_ALPHA_SAVGOL_WINDOW
+constexpr float spokeDirection = 1.0f;          // SPOKE0_DIRECTION
+
+// main.cpp's configuration; the period is the nominal one, fuse() is given the real dt
+struct TorsoAhrs {
+    static constexpr float period = 0.01f;
+    static constexpr float two_kp = 2.0f*0.5f;
+    static constexpr float two_ki = 0.0f;
+};
+typedef TorsoEstimator<MahonyFilter<TorsoAhrs>> Torso;
+typedef PosteriorBank<pbc_weights::rw_bayesian, pbc_weights::rw_bayesian::num_samples, pbc::ExactElu, pbc::ExactTrig, 1>
+    Bank;
+
+enum Objective { TORQUE, FELL, SPEED };
+const char* const objectiveNames[] = {"torque", "fell", "speed"};
+
+struct Config {
+    float rate_hz, odr_hz;
+    int filter;                                 // 0 tracking, else the low-pass order
+    float cutoff_hz;
+    int samples;
+
+    bool operator==(const Config& o) const {
+        return rate_hz == o.rate_hz && odr_hz == o.odr_hz && filter == o.filter && cutoff_hz == o.cutoff_hz &&
+               samples == o.samples;
+    }
+};
+
+const Config mainConfig = {100.0f, 104.0f, 0, 30.0f, 10};
+
+struct Options {
+    std::vector<float> rates = {100.0f, 200.0f, 500.0f, 1000.0f};
+    std::vector<float> odrs = {104.0f, 416.0f, 1660.0f};
+    std::vector<int> filters = {0, 2, 3};
+    std::vector<float> cutoffs = {15.0f, 30.0f, 60.0f};
+    std::vector<int> samples = {0, 2, 4, 6, 10};
+    const char* controller = "bayesian";
+    int rollouts = 32;
+    float seconds = 5.0f;
+    int threads = (int)std::thread::hardware_concurrency();
+    uint64_t seed = 1;
+    const char* csv = nullptr;
+    Objective objective = TORQUE;
+    float targetSpeed = 1.0f;
+    float latency_ms = 0.5f;
+    float plant_hz = 4000.0f;
+    int costTicks = 2000;
+    float massSigma = 0.05f, lengthSigma = 0.02f, initSigma = 0.05f;
+    float gyroSigma = 0.01f, gyroBias = 0.005f, accelSigma = 0.2f;
+    int encoderCpr = 8192;
+};
+
+// The firmware's sense step at one configuration's rates and filters, one lane
+class Sense {
+public:
+    Sense(const Config& c)
+        : period_(1.0f / c.rate_hz), filter_(c.filter), tracking_(VelocityEstimator::tracking(c.cutoff_hz)),
+          lpf_(c.cutoff_hz, 1.0f / c.rate_hz, (IIR::ORDER)(c.filter > 0 ? c.filter - 1 : 0)),
+          torso_(VelocityEstimator::savitzkyGolay(torsoAlphaWindow, 2)) {}
+
+    // One IMU sample, drained at the next tick
+    void imuSample(const Vec3& gyro, const Vec3& accel) {
+        gyroSum_ = gyroSum_ + gyro;
+        accelSum_ = accelSum_ + accel;
+        ++n_;
+    }
+
+    // The tick at t_us on the encoder's turns; what the controller reads
+    State tick(float turns, uint32_t t_us) {
+        if (n_ > 0) {
+            gyro_ = gyroSum_ * (1.0f / n_);
+            accel_ = accelSum_ * (1.0f / n_);
+            gyroSum_ = accelSum_ = Vec3();
+            n_ = 0;
+        }
+        const float angle = spokeDirection*turns*Robot::turnToSpoke;
+        float rate;
+        if (!started_) {
+            tracking_.reset(angle, t_us);
+            last_ = angle;
+        }
+        if (filter_ == 0) {
+            rate = tracking_.update(angle, t_us);
+        } else {
+            rate = lpf_.filterIn((angle - last_) / period_);
+        }
+        last_ = angle;
+        started_ = true;
+        float torso[3];
+        torso_.fuse(gyro_, &accel_, Vec3(), period_);
+        torso_.states(torso);
+        return {torso[0], Robot::uprightSpokeAngle + angle, torso[1], rate};
+    }
+
+private:
+    float period_;
+    int filter_;
+    VelocityEstimator tracking_;
+    Filter lpf_;
+    Torso torso_;
+    Vec3 gyroSum_, accelSum_, gyro_, accel_;
+    int n_ = 0;
+    float last_ = 0.0f;
+    bool started_ = false;
+};
+
+// The configuration's controller and the reference it is held to
+class Policy {
+public:
+    // network: one of controllers.h's, or null for the bank at samples
+    Policy(const pbc_host::Controller* network, int samples) : network_(network) {
+        if (network_) return;
+        bank_.load(pbc_weights::rw_bayesian::samples());
+        bank_.setAdaptive(0.0f, samples, samples);
+        reference_.load(pbc_weights::rw_bayesian::samples());
+        if (samples == 0) map_.reset(new pbc_host::BatchedNetwork<pbc_weights::rw_bayesian>("map", 2.0f));
+    }
+
+    void control(const State* x, size_t n, float* u) {
+        if (network_) {
+            network_->control(x, n, u);
+        } else if (map_) {
+            map_->control(x, n, u);
+        } else {
+            for (size_t i = 0; i < n; ++i) u[i] = bank_.control(x[i].roll, x[i].spoke, x[i].rollRate, x[i].spokeRate);
+        }
+    }
+
+    void reference(const State* x, size_t n, float* u) {
+        if (network_) {
+            network_->control(x, n, u);
+        } else {
+            for (size_t i = 0; i < n; ++i)
+                u[i] = reference_.control(x[i].roll, x[i].spoke, x[i].rollRate, x[i].spokeRate);
+        }
+    }
+
+    float saturation() const { return network_ ? network_->saturation() : 2.0f; }
+
+private:
+    const pbc_host::Controller* network_;
+    std::unique_ptr<pbc_host::Controller> map_;
+    Bank bank_{2.0f}, reference_{2.0f};
+};
+
+// The torques one lane has in flight, oldest first
+struct Pending {
+    double at[max_pending];
+    float torque[max_pending];
+    int head = 0, n = 0;
+
+    void push(double t, float u) {
+        if (n == max_pending) { head = (head + 1) % max_pending; --n; }
+        const int i = (head + n++) % max_pending;
+        at[i] = t;
+        torque[i] = u;
+    }
+    // The torque acting at t, current if none arrived
+    float take(double t, float current) {
+        while (n > 0 && at[head] <= t) {
+            current = torque[head];
+            head = (head + 1) % max_pending;
+            --n;
+        }
+        return current;
+    }
+};
+
+// One configuration's rollouts in a block, summed
+struct Outcome {
+    double error2 = 0.0;
+    uint64_t ticks = 0;
+    int rollouts = 0, fell = 0;
+    double speed = 0.0, stood_s = 0.0;
+    bool finite = true;
+
+    void add(const Outcome& o) {
+        error2 += o.error2;
+        ticks += o.ticks;
+        rollouts += o.rollouts;
+        fell += o.fell;
+        speed += o.speed;
+        stood_s += o.stood_s;
+        finite = finite && o.finite;
+    }
+};
+
+// Rollouts [first, first + count) at configuration c
+Outcome rollBlock(int first, int count, const Config& c, const Options& o, const pbc_host::Controller* network) {
+    const int substeps = (int)lroundf(o.plant_hz / c.rate_hz);
+    const float dt = 1.0f / o.plant_hz;
+    const int ticks = (int)lroundf(o.seconds * c.rate_hz);
+    const float noise = sqrtf(c.odr_hz / nominalOdr_hz);
+    const double odrPeriod = 1.0 / c.odr_hz, latency_s = o.latency_ms * 1e-3;
+
+    rollout::Block<W> b;
+    std::vector<Rng> rng;
+    std::vector<Sense> sense;
+    Pending pending[W];
+    float bias[W];
+    double nextImu[W];
+    float stood[W];
+    Wheel wheel[W];
+    for (int l = 0; l < W; ++l) {
+        rng.emplace_back(o.seed*0x100000001b3ull + (uint64_t)(first + l));
+        Rng& r = rng.back();
+        wheel[l] = Wheel::nominal().perturbed(r, o.massSigma, o.lengthSigma, 0.0f);
+        b.setWheel(l, wheel[l]);
+        b.theta[l] = 0.5f*Robot::alpha*(2.0f*r.uniform() - 1.0f);
+        b.phi[l] = o.initSigma*r.gaussian();
+        b.thetadot[l] = b.phidot[l] = b.u[l] = 0.0f;
+        b.spokes[l] = 0;
+        b.alive[l] = l < count;
+        bias[l] = o.gyroBias*r.gaussian();
+        nextImu[l] = r.uniform()*odrPeriod;
+        stood[l] = o.seconds;
+        sense.emplace_back(c);
+    }
+    Policy policy(network, c.samples);
+
+    Outcome out;
+    State x[W], truth[W];
+    float u[W], uref[W];
+    long n = 0;                                  // plant steps since the start
+    for (int tick = 0; tick < ticks; ++tick) {
+        const double t = n*(double)dt;
+        const uint32_t t_us = (uint32_t)llround(t*1e6);
+        for (int l = 0; l < W; ++l) {
+            const float turns = roundf(b.spokeAngle(l)/(spokeDirection*Robot::turnToSpoke)*o.encoderCpr)/o.encoderCpr;
+            x[l] = sense[l].tick(turns, t_us);
+            truth[l] = {b.phi[l], Robot::uprightSpokeAngle + b.spokeAngle(l), b.phidot[l], b.thetadot[l]};
+        }
+        policy.control(x, W, u);
+        if (o.objective == TORQUE) policy.reference(truth, W, uref);
+        for (int l = 0; l < count; ++l) {
+            if (!b.alive[l]) continue;
+            if (o.objective == TORQUE) {
+                out.error2 += (double)(u[l] - uref[l])*(u[l] - uref[l]);
+                ++out.ticks;
+            }
+            pending[l].push(t + latency_s, u[l]);
+        }
+        for (int s = 0; s < substeps; ++s, ++n) {
+            const double now = n*(double)dt;
+            for (int l = 0; l < W; ++l)
+                if (b.alive[l]) b.u[l] = pending[l].take(now, b.u[l]);
+            b.step(dt);
+            b.impacts();
+            const double after = (n + 1)*(double)dt;
+            for (int l = 0; l < W; ++l) {
+                if (b.alive[l] && !(fabsf(b.phi[l]) < 0.5f*(float)M_PI)) {
+                    b.alive[l] = false;
+                    stood[l] = (float)after;
+                    if (l < count) {
+                        ++out.fell;
+                        out.finite = out.finite && std::isfinite(b.phi[l]);
+                    }
+                }
+                // the torso turns about -x of the IMU
+                Rng& r = rng[l];
+                for (; nextImu[l] <= after; nextImu[l] += odrPeriod) {
+                    const Vec3 gyro(-b.phidot[l] + bias[l] + noise*o.gyroSigma*r.gaussian(), noise*o.gyroSigma*r.gaussian(),
+                                    noise*o.gyroSigma*r.gaussian());
+                    const Vec3 accel(noise*o.accelSigma*r.gaussian(), -Robot::g*sinf(b.phi[l]) + noise*o.accelSigma*r.gaussian(),
+                                     Robot::g*cosf(b.phi[l]) + noise*o.accelSigma*r.gaussian());
+                    sense[l].imuSample(gyro, accel);
+                }
+            }
+        }
+    }
+
+    const float stepLength = 2.0f*sinf(Robot::alpha);
+    for (int l = 0; l < count; ++l) {
+        ++out.rollouts;
+        out.stood_s += stood[l];
+        out.speed += stood[l] > 0.0f ? b.spokes[l]*stepLength*wheel[l].l1 / stood[l] : 0.0f;
+        out.finite = out.finite && std::isfinite(b.theta[l]) && std::isfinite(b.thetadot[l]);
+    }
+    return out;
+}
+
+// ns of one tick of the sense and control chain on one lane, the best of three runs
+double tickCost_ns(const Config& c, const Options& o, const pbc_host::Controller* network) {
+    Sense sense(c);
+    Policy policy(network, c.samples);
+    const int imuPerTick = std::max(1, (int)lroundf(c.odr_hz / c.rate_hz));
+    const float period = 1.0f / c.rate_hz;
+    double best = 1e30;
+    volatile float sink = 0.0f;
+    for (int run = 0, tick = 0; run < 3; ++run) {
+        const auto start = Clock::now();
+        for (int k = 0; k < o.costTicks; ++k, ++tick) {
+            // a wheel rocking a step back and forth, the torso swaying
+            const float t = tick*period;
+            const float phi = 0.3f*sinf(2.0f*t), phidot = 0.6f*cosf(2.0f*t);
+            for (int i = 0; i < imuPerTick; ++i)
+                sense.imuSample(Vec3(-phidot, 0.0f, 0.0f), Vec3(0.0f, -Robot::g*sinf(phi), Robot::g*cosf(phi)));
+            const float turns = Robot::alpha*sinf(3.0f*t)/(spokeDirection*Robot::turnToSpoke);
+            const State x = sense.tick(turns, (uint32_t)(t*1e6f));
+            float u;
+            policy.control(&x, 1, &u);
+            sink = sink + u;
+        }
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / o.costTicks;
+        best = std::min(best, ns);
+    }
+    return best;
+}
+
+struct Row {
+    Config c;
+    double cost_us_per_s;
+    double torqueError, fell, speed;
+    bool finite;
+
+    double objective(const Options& o) const {
+        return o.objective == TORQUE ? torqueError : o.objective == FELL ? fell : fabs(speed - o.targetSpeed);
+    }
+};
+
+const char* filterName(int filter) {
+    static const char* const names[] = {"tracking", "lpf1", "lpf2", "lpf3", "lpf4"};
+    return names[filter];
+}
+
+void printRow(const char* key, const Row& r) {
+    printf("%s rate_hz %g odr_hz %g filter %s cutoff_hz %g samples %d cost_us_per_s %.1f torque_error %.5f fell %.4f "
+           "speed_mean %.4f\n", key, r.c.rate_hz, r.c.odr_hz, filterName(r.c.filter), r.c.cutoff_hz, r.c.samples,
+           r.cost_us_per_s, r.torqueError, r.fell, r.speed);
+}
+
+template<class T, class F>
+bool parseList(const char* text, std::vector<T>& out, F parse) {
+    out.clear();
+    for (const char* p = text; *p;) {
+        const char* end = strchr(p, ',');
+        const std::string item(p, end ? end - p : strlen(p));
+        T v;
+        if (!parse(item.c_str(), v)) return false;
+        out.push_back(v);
+        p = end ? end + 1 : p + item.size();
+    }
+    return !out.empty();
+}
+
+bool parseFloat(const char* s, float& v) {
+    char* end;
+    v = strtof(s, &end);
+    return end != s && !*end && v > 0.0f;
+}
+
+bool parseSamples(const char* s, int& v) {
+    char* end;
+    v = (int)strtol(s, &end, 10);
+    return end != s && !*end && v >= 0 && v <= pbc_weights::rw_bayesian::num_samples;
+}
+
+bool parseFilter(const char* s, int& v) {
+    for (v = 0; v <= 4; ++v)
+        if (strcmp(s, filterName(v)) == 0) return true;
+    return false;
+}
+
+bool parse(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; ++i) {
+        const bool more = i + 1 < argc;
+        if (strcmp(argv[i], "--rates") == 0 && more) { if (!parseList(argv[++i], o.rates, parseFloat)) return false; }
+        else if (strcmp(argv[i], "--odrs") == 0 && more) { if (!parseList(argv[++i], o.odrs, parseFloat)) return false; }
+        else if (strcmp(argv[i], "--filters") == 0 && more) { if (!parseList(argv[++i], o.filters, parseFilter)) return false; }
+        else if (strcmp(argv[i], "--cutoffs") == 0 && more) { if (!parseList(argv[++i], o.cutoffs, parseFloat)) return false; }
+        else if (strcmp(argv[i], "--samples") == 0 && more) { if (!parseList(argv[++i], o.samples, parseSamples)) return false; }
+        else if (strcmp(argv[i], "--controller") == 0 && more) o.controller = argv[++i];
+        else if (strcmp(argv[i], "--rollouts") == 0 && more) o.rollouts = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && more) o.seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && more) o.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && more) o.seed = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--csv") == 0 && more) o.csv = argv[++i];
+        else if (strcmp(argv[i], "--objective") == 0 && more) {
+            const char* name = argv[++i];
+            int k = 0;
+            while (k < 3 && strcmp(name, objectiveNames[k]) != 0) ++k;
+            if (k == 3) return false;
+            o.objective = (Objective)k;
+        }
+        else if (strcmp(argv[i], "--target-speed") == 0 && more) o.targetSpeed = atof(argv[++i]);
+        else if (strcmp(argv[i], "--latency-ms") == 0 && more) o.latency_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--plant-hz") == 0 && more) o.plant_hz = atof(argv[++i]);
+        else if (strcmp(argv[i], "--cost-ticks") == 0 && more) o.costTicks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--mass-sigma") == 0 && more) o.massSigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--length-sigma") == 0 && more) o.lengthSigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--gyro-sigma") == 0 && more) o.gyroSigma = atof(argv[++i]);
+        else if (strcmp(argv[i], "--accel-sigma") == 0 && more) o.accelSigma = atof(argv[++i]);
+        else return false;
+    }
+    if (o.threads < 1) o.threads = 1;
+    // the plant steps a whole number of times a tick
+    for (float rate : o.rates)
+        if (fabsf(o.plant_hz / rate - roundf(o.plant_hz / rate)) > 1e-3f || o.plant_hz < rate) return false;
+    return o.rollouts > 0 && o.seconds > 0.0f && o.latency_ms >= 0.0f && o.costTicks > 0 &&
+           o.plant_hz >= mainConfig.rate_hz && fmodf(o.plant_hz, mainConfig.rate_hz) == 0.0f;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parse(argc, argv, o)) {
+        fprintf(stderr, "usage: %s [--rates hz,...] [--odrs hz,...] [--filters f,...] [--cutoffs hz,...] [--samples n,...]\n"
+                        "       [--controller name] [--rollouts n] [--seconds s] [--threads n] [--seed n] [--csv out.csv]\n"
+                        "       [--objective torque|fell|speed] [--target-speed m/s] [--latency-ms l] [--plant-hz f]\n"
+                        "       [--cost-ticks n] [--mass-sigma r] [--length-sigma r] [--gyro-sigma rad/s] [--accel-sigma m/s^2]\n"
+                        "filters: tracking, lpf1..lpf4; the plant rate a multiple of every rate and of 100 Hz\n", argv[0]);
+        return 2;
+    }
+    std::vector<std::unique_ptr<pbc_host::Controller>> controllers = pbc_host::controllers();
+    const bool bayesian = strcmp(o.controller, "bayesian") == 0;
+    const pbc_host::Controller* network = bayesian ? nullptr : pbc_host::find(controllers, o.controller);
+    if (!bayesian && !network) {
+        fprintf(stderr, "unknown controller %s\n", o.controller);
+        return 2;
+    }
+    if (!bayesian) o.samples = {mainConfig.samples};
+
+    // the grid, main.cpp's settings among it; a low-pass at or past Nyquist is no filter
+    std::vector<Config> configs;
+    int skipped = 0;
+    for (float rate : o.rates)
+        for (float odr : o.odrs)
+            for (int filter : o.filters)
+                for (float cutoff : o.cutoffs)
+                    for (int samples : o.samples) {
+                        if (cutoff >= 0.5f*rate) { ++skipped; continue; }
+                        configs.push_back({rate, odr, filter, cutoff, samples});
+                    }
+    if (std::find(configs.begin(), configs.end(), mainConfig) == configs.end())
+        configs.push_back(mainConfig);
+
+    const float check = rollout::modelCheck<W>();
+    const size_t blocks = (o.rollouts + W - 1) / W;
+    std::vector<Outcome> outcomes(configs.size()*blocks);
+    const auto start = Clock::now();
+    host::parallelFor(outcomes.size(), o.threads, [&](size_t task) {
+        const Config& c = configs[task / blocks];
+        const int first = (int)(task % blocks)*W;
+        outcomes[task] = rollBlock(first, std::min(W, o.rollouts - first), c, o, network);
+    });
+    const double sweep_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // the chain's cost depends on the filter, the samples and the IMU samples a tick only
+    std::map<std::tuple<int, int, int>, double> tickCosts;
+    const auto costStart = Clock::now();
+    std::vector<Row> rows;
+    bool finite = true;
+    for (size_t k = 0; k < configs.size(); ++k) {
+        const Config& c = configs[k];
+        Outcome total;
+        for (size_t j = 0; j < blocks; ++j) total.add(outcomes[k*blocks + j]);
+        const auto key = std::make_tuple(c.filter, c.samples, std::max(1, (int)lroundf(c.odr_hz / c.rate_hz)));
+        auto cost = tickCosts.find(key);
+        if (cost == tickCosts.end()) cost = tickCosts.emplace(key, tickCost_ns(c, o, network)).first;
+        Row r;
+        r.c = c;
+        r.cost_us_per_s = cost->second*1e-3*c.rate_hz;
+        r.torqueError = total.ticks ? sqrt(total.error2 / total.ticks) : NAN;
+        r.fell = (double)total.fell / total.rollouts;
+        r.speed = total.speed / total.rollouts;
+        r.finite = total.finite;
+        finite = finite && total.finite;
+        rows.push_back(r);
+    }
+    const double cost_s = std::chrono::duration<double>(Clock::now() - costStart).count();
+
+    // the front: cheapest first, each strictly better than every cheaper one
+    std::vector<size_t> order(rows.size());
+    for (size_t k = 0; k < order.size(); ++k) order[k] = k;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (rows[a].cost_us_per_s != rows[b].cost_us_per_s) return rows[a].cost_us_per_s < rows[b].cost_us_per_s;
+        return rows[a].objective(o) < rows[b].objective(o);
+    });
+    std::vector<size_t> front;
+    double best = INFINITY;
+    for (size_t k : order)
+        if (rows[k].objective(o) < best) {
+            best = rows[k].objective(o);
+            front.push_back(k);
+        }
+    const size_t mine = std::find_if(rows.begin(), rows.end(), [](const Row& r) { return r.c == mainConfig; }) - rows.begin();
+    int beaten = 0;
+    for (const Row& r : rows)
+        if (r.cost_us_per_s < rows[mine].cost_us_per_s && r.objective(o) < rows[mine].objective(o)) ++beaten;
+
+    printf("controller %s\n", o.controller);
+    printf("objective %s\n", objectiveNames[o.objective]);
+    printf("configs %zu\n", configs.size());
+    printf("skipped %d\n", skipped);
+    printf("rollouts %d\n", o.rollouts);
+    printf("seconds %g\n", o.seconds);
+    printf("threads %d\n", o.threads);
+    printf("model_check %.3g\n", check);
+    printf("sweep_s %.3f\n", sweep_s);
+    printf("cost_s %.3f\n", cost_s);
+    printf("front_size %zu\n", front.size());
+    for (size_t k : front) printRow("front", rows[k]);
+    printRow("default", rows[mine]);
+    printf("default_beaten_by %d\n", beaten);
+
+    if (o.csv) {
+        FILE* csv = fopen(o.csv, "w");
+        if (!csv) {
+            perror(o.csv);
+            return 1;
+        }
+        fprintf(csv, "rate_hz,odr_hz,filter,cutoff_hz,samples,cost_us_per_s,torque_error,fell,speed_mean,front\n");
+        std::vector<bool> onFront(rows.size(), false);
+        for (size_t k : front) onFront[k] = true;
+        for (size_t k = 0; k < rows.size(); ++k) {
+            const Row& r = rows[k];
+            fprintf(csv, "%g,%g,%s,%g,%d,%g,%g,%g,%g,%d\n", r.c.rate_hz, r.c.odr_hz, filterName(r.c.filter), r.c.cutoff_hz,
+                    r.c.samples, r.cost_us_per_s, r.torqueError, r.fell, r.speed, onFront[k] ? 1 : 0);
+        }
+        fclose(csv);
+    }
+    return check < 1e-4f && finite ? 0 : 1;
+}
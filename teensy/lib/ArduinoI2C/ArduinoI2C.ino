@@ -27,6 +27,34 @@ bool I2C_transaction(uint8_t slave_addr, const uint8_t * tx_buffer, size_t tx_le
   return true;
 }
 
+// See odrive.h for a description
+bool I2C_transactions(uint8_t slave_addr, const I2C_segment * segments, size_t count) {
+  for (size_t s = 0; s < count; ++s) {
+    const I2C_segment& segment = segments[s];
+    bool last = s + 1 == count;
+
+    // transmit, a repeated start instead of a stop unless this is the end
+    if (segment.tx_buffer) {
+      Wire.beginTransmission(slave_addr);
+      if (Wire.write(segment.tx_buffer, segment.tx_length) != segment.tx_length)
+        return false;
+      if (Wire.endTransmission(last && !segment.rx_buffer) != 0)
+        return false;
+    }
+
+    // receive
+    if (segment.rx_buffer) {
+      while(Wire.available()) Wire.read(); // flush input buffer
+      if (Wire.requestFrom(slave_addr, (uint8_t)segment.rx_length, (uint8_t)last) != segment.rx_length)
+        return false;
+      for (size_t i = 0; i < segment.rx_length; ++i)
+        segment.rx_buffer[i] = Wire.read();
+    }
+  }
+
+  return true;
+}
+
 
 int set_and_save_configuration(uint8_t odrive_num, uint8_t axis_num) {
   bool success;
@@ -2,10 +2,15 @@
 * ODrive I2C communication library
 * This file implements I2C communication with the ODrive.
 *
-*   - Implement the C function I2C_transaction to provide low level I2C access.
+*   - Implement the C function I2C_transaction to provide low level I2C access,
+*     and I2C_transactions for the batched accesses.
 *   - Use read_property<PropertyId>() to read properties from the ODrive.
 *   - Use write_property<PropertyId>() to modify properties on the ODrive.
 *   - Use trigger<PropertyId>() to trigger a function (such as reboot or save_configuration)
+*   - Use read_properties<PropertyIds...>() and write_properties<PropertyIds...>()
+*     for several endpoints in one bus operation (I2C_transactions()).
+*   - Use read_batch<PropertyIds...> and write_batch<PropertyIds...> to encode the
+*     same bus operation for a transport that runs it asynchronously.
 *   - Use endpoint_type_t<PropertyId> to retrieve the underlying type
 *     of a given property.
 *   - Refer to PropertyId for a list of available properties.
@@ -28,6 +33,8 @@
 #include "type_traits.h"
 #else
 #include <type_traits>
+#include <tuple>
+#include <utility>
 #endif
 
 
@@ -51,6 +58,30 @@ extern "C" {
 */
 bool I2C_transaction(uint8_t slave_addr, const uint8_t * tx_buffer, size_t tx_length, uint8_t * rx_buffer, size_t rx_length);
 
+/* @brief One endpoint access of an I2C_transactions() sequence, the
+* arguments of one I2C_transaction()
+*/
+struct I2C_segment {
+    const uint8_t * tx_buffer;
+    size_t tx_length;
+    uint8_t * rx_buffer;
+    size_t rx_length;
+};
+
+/* @brief Carry out several I2C_transaction()s to one slave as one bus operation
+*
+* The same sequence as I2C_transaction() for each segment, except that only
+* the first START arbitrates for the bus: every later segment begins with a
+* REPEATED START, and the only STOP is after the last one. The endpoint
+* accesses stay separate on the ODrive; what the batch saves is the STOP,
+* the bus-free time and the arbitration between them, and the caller holds
+* the bus throughout.
+*
+* @param slave_addr: 7-bit slave address (the MSB is ignored)
+* @return true if every segment was transmitted and received as requested, false otherwise
+*/
+bool I2C_transactions(uint8_t slave_addr, const struct I2C_segment * segments, size_t count);
+
 }
 
 
@@ -95,7 +126,7 @@ namespace odrive {
     }
 
     template<typename T>
-    typename std::enable_if<std::is_floating_point<T>::value, T>::type
+    typename std::enable_if<std::is_floating_point<T>::value, void>::type
     write_le(uint8_t buffer[byte_width<T>::value], T value) {
         using T_Int = typename unsigned_int_of_size<bit_width<T>::value>::type;
         write_le<T_Int>(buffer, *reinterpret_cast<T_Int*>(&value));
@@ -175,8 +206,166 @@ namespace odrive {
     }
 
 
+#ifndef __AVR__
+    /* @brief The values of several endpoints, in the order of the ids */
+    template<int... IPropertyIds>
+    using properties_t = std::tuple<endpoint_type_t<IPropertyIds>...>;
+
+    namespace detail {
+        template<int... IPropertyIds> struct ids {};
+
+        constexpr size_t max_of(size_t a) { return a; }
+        template<typename... T>
+        constexpr size_t max_of(size_t a, size_t b, T... rest) { return max_of(a > b ? a : b, rest...); }
+
+        template<int... IPropertyIds, size_t... I>
+        void decode(ids<IPropertyIds...>, std::index_sequence<I...>, const uint8_t* rx, size_t stride,
+                    properties_t<IPropertyIds...>& values) {
+            using expand = int[];
+            (void)expand{0, ((std::get<I>(values) = read_le<endpoint_type_t<IPropertyIds>>(rx + I * stride)), 0)...};
+        }
+
+        template<typename T>
+        void encode(uint8_t* tx, uint16_t address, T value, I2C_segment& segment) {
+            write_le<uint16_t>(tx, address);
+            write_le<T>(tx + 2, value);
+            write_le<uint16_t>(tx + 2 + byte_width<T>::value, json_crc);
+            segment = {tx, 4 + byte_width<T>::value, nullptr, 0};
+        }
+
+        template<int... IPropertyIds, size_t... I>
+        void encode(ids<IPropertyIds...>, std::index_sequence<I...>, uint8_t* tx, size_t stride,
+                    const uint16_t* addresses, I2C_segment* segments, endpoint_type_t<IPropertyIds>... values) {
+            using expand = int[];
+            (void)expand{0, (encode(tx + I * stride, addresses[I], values, segments[I]), 0)...};
+        }
+    }
+
+    /* @brief The buffers and segments of a read_properties_at(), for a transport
+    * that carries out the I2C_transactions() itself, e.g. from an interrupt.
+    *
+    * prepare() encodes the requests, once if the addresses stay the same;
+    * the segments then go on the bus, and decode() takes the replies.
+    */
+    template<int... IPropertyIds>
+    struct read_batch {
+        static constexpr size_t count = sizeof...(IPropertyIds);
+        static_assert(count > 0, "at least one endpoint");
+        static constexpr size_t stride = detail::max_of(byte_width<endpoint_type_t<IPropertyIds>>::value...);
+
+        uint8_t tx[count][4];
+        uint8_t rx[count][stride];
+        I2C_segment segments[count];
+
+        void prepare(const uint16_t (&addresses)[count]) {
+            constexpr size_t widths[count] = {byte_width<endpoint_type_t<IPropertyIds>>::value...};
+            for (size_t i = 0; i < count; ++i) {
+                write_le<uint16_t>(tx[i], addresses[i]);
+                write_le<uint16_t>(tx[i] + 2, json_crc);
+                segments[i] = {tx[i], sizeof(tx[i]), rx[i], widths[i]};
+            }
+        }
+
+        void decode(properties_t<IPropertyIds...>* values) const {
+            if (values)
+                detail::decode(detail::ids<IPropertyIds...>(), std::make_index_sequence<count>(),
+                               &rx[0][0], stride, *values);
+        }
+    };
+
+    /* @brief The buffer and segments of a write_properties_at(); encode() fills both */
+    template<int... IPropertyIds>
+    struct write_batch {
+        static constexpr size_t count = sizeof...(IPropertyIds);
+        static_assert(count > 0, "at least one endpoint");
+        static constexpr size_t stride = 4 + detail::max_of(byte_width<endpoint_type_t<IPropertyIds>>::value...);
+
+        uint8_t tx[count][stride];
+        I2C_segment segments[count];
+
+        void encode(const uint16_t (&addresses)[count], endpoint_type_t<IPropertyIds>... values) {
+            detail::encode(detail::ids<IPropertyIds...>(), std::make_index_sequence<count>(),
+                           &tx[0][0], stride, addresses, segments, values...);
+        }
+    };
+
+    /* @brief Read several endpoints, at the given addresses, in one bus operation.
+    * read_properties() and read_axis_properties() are the usual forms.
+    *
+    * Usage example, the encoder estimates of both axes:
+    *   using namespace odrive;
+    *   const uint16_t addresses[4] = {AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL,
+    *       AXIS__ENCODER__POS_ESTIMATE + per_axis_offset, AXIS__ENCODER__PLL_VEL + per_axis_offset};
+    *   properties_t<AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL,
+    *                AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL> feedback;
+    *   success = read_properties_at<AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL,
+    *                                AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL>(0, addresses, &feedback);
+    *   float pos1 = std::get<2>(feedback);
+    *
+    * @param values Left as they were unless every read succeeded
+    * @return true if the I2C transactions succeeded, false otherwise
+    */
+    template<int... IPropertyIds>
+    bool read_properties_at(uint8_t num, const uint16_t (&addresses)[sizeof...(IPropertyIds)],
+                            properties_t<IPropertyIds...>* values) {
+        read_batch<IPropertyIds...> batch;
+        batch.prepare(addresses);
+        if (!I2C_transactions(i2c_addr + num, batch.segments, batch.count))
+            return false;
+        batch.decode(values);
+        return true;
+    }
+
+    /* @brief Write several endpoints, at the given addresses, in one bus operation */
+    template<int... IPropertyIds>
+    bool write_properties_at(uint8_t num, const uint16_t (&addresses)[sizeof...(IPropertyIds)],
+                             endpoint_type_t<IPropertyIds>... values) {
+        write_batch<IPropertyIds...> batch;
+        batch.encode(addresses, values...);
+        return I2C_transactions(i2c_addr + num, batch.segments, batch.count);
+    }
+
+    /* @brief read_property() of several endpoints in one bus operation
+    *
+    * Usage example:
+    *   odrive::properties_t<odrive::VBUS_VOLTAGE, odrive::USER_CONFIG_LOADED> values;
+    *   success = odrive::read_properties<odrive::VBUS_VOLTAGE, odrive::USER_CONFIG_LOADED>(0, &values);
+    */
+    template<int... IPropertyIds>
+    bool read_properties(uint8_t num, properties_t<IPropertyIds...>* values) {
+        const uint16_t addresses[sizeof...(IPropertyIds)] = {static_cast<uint16_t>(IPropertyIds)...};
+        return read_properties_at<IPropertyIds...>(num, addresses, values);
+    }
+
+    template<int... IPropertyIds>
+    bool write_properties(uint8_t num, endpoint_type_t<IPropertyIds>... values) {
+        const uint16_t addresses[sizeof...(IPropertyIds)] = {static_cast<uint16_t>(IPropertyIds)...};
+        return write_properties_at<IPropertyIds...>(num, addresses, values...);
+    }
+
+    /* @brief read_properties() of axis specific endpoints, all of one axis */
+    template<int... IPropertyIds>
+    bool read_axis_properties(uint8_t num, uint8_t axis, properties_t<IPropertyIds...>* values) {
+        const uint16_t addresses[sizeof...(IPropertyIds)] = {static_cast<uint16_t>(IPropertyIds + axis * per_axis_offset)...};
+        return read_properties_at<IPropertyIds...>(num, addresses, values);
+    }
+
+    template<int... IPropertyIds>
+    bool write_axis_properties(uint8_t num, uint8_t axis, endpoint_type_t<IPropertyIds>... values) {
+        const uint16_t addresses[sizeof...(IPropertyIds)] = {static_cast<uint16_t>(IPropertyIds + axis * per_axis_offset)...};
+        return write_properties_at<IPropertyIds...>(num, addresses, values...);
+    }
+#endif
+
+
     /* @brief Checks if the axis is in the requested state and the error register is clear */
-    bool check_axis_state(uint8_t num, uint8_t axis, uint8_t state) {
+    inline bool check_axis_state(uint8_t num, uint8_t axis, uint8_t state) {
+#ifndef __AVR__
+        properties_t<odrive::AXIS__CURRENT_STATE, odrive::AXIS__ERROR> observed(0, 0);
+        if (!read_axis_properties<odrive::AXIS__CURRENT_STATE, odrive::AXIS__ERROR>(num, axis, &observed))
+            return false;
+        return (std::get<1>(observed) == 0) && (std::get<0>(observed) == state);
+#else
         endpoint_type_t<odrive::AXIS__CURRENT_STATE> observed_state = 0;
         endpoint_type_t<odrive::AXIS__ERROR> observed_error = 0;
         if (!read_axis_property<odrive::AXIS__CURRENT_STATE>(num, axis, &observed_state))
@@ -184,10 +373,15 @@ namespace odrive {
         if (!read_axis_property<odrive::AXIS__ERROR>(num, axis, &observed_error))
             return false;
         return (observed_error == 0) && (observed_state == state);
+#endif
     }
 
     /* @brief Clears any error state of the specified axis */
-    bool clear_errors(uint8_t num, uint8_t axis) {
+    inline bool clear_errors(uint8_t num, uint8_t axis) {
+#ifndef __AVR__
+        return write_axis_properties<odrive::AXIS__ERROR, odrive::AXIS__MOTOR__ERROR, odrive::AXIS__ENCODER__ERROR>(
+            num, axis, 0, 0, 0);
+#else
         if (!write_axis_property<odrive::AXIS__ERROR>(num, axis, 0))
             return false;
         if (!write_axis_property<odrive::AXIS__MOTOR__ERROR>(num, axis, 0))
@@ -195,5 +389,6 @@ namespace odrive {
         if (!write_axis_property<odrive::AXIS__ENCODER__ERROR>(num, axis, 0))
             return false;
         return true;
+#endif
     }
 }
@@ -0,0 +1,350 @@
+#include "Arduino.h"
+#include "AsyncI2C.h"
+
+// One interrupt vector per LPI2C module in use
+static constexpr uint8_t max_ports = 4;
+static AsyncI2C* instances[max_ports] = {};
+
+static constexpr uint32_t error_flags = LPI2C_MSR_NDF | LPI2C_MSR_ALF | LPI2C_MSR_FEF | LPI2C_MSR_PLTF;
+static constexpr uint32_t tx_fifo_depth = 4;
+
+// Interrupts off, and back to the caller's state: submit() also runs in callbacks and under wait()
+static inline uint32_t irqSave() {
+    uint32_t primask;
+    __asm__ volatile("mrs %0, primask" : "=r"(primask));
+    __disable_irq();
+    return primask;
+}
+
+static inline void irqRestore(uint32_t primask) {
+    if (!primask)
+        __enable_irq();
+}
+
+AsyncI2C::AsyncI2C(IMXRT_LPI2C_t& port, IRQ_NUMBER_t irq, uint8_t priority)
+    : port_(port), irq_(irq), priority_(priority) {}
+
+template<uint8_t N> void AsyncI2C::isr() {
+    instances[N]->service();
+}
+
+void AsyncI2C::begin() {
+    static void (* const vectors[max_ports])() = {isr<0>, isr<1>, isr<2>, isr<3>};
+    uint8_t slot = 0;
+    while (slot < max_ports && instances[slot] && instances[slot] != this)
+        ++slot;
+    if (slot == max_ports)
+        return;
+    instances[slot] = this;
+    port_.MIER = 0;
+    attachInterruptVector(irq_, vectors[slot]);
+    NVIC_SET_PRIORITY(irq_, priority_);
+    NVIC_ENABLE_IRQ(irq_);
+}
+
+void AsyncI2C::setBudget(uint8_t device, uint16_t budget_us) {
+    if (device < max_devices)
+        budget_us_[device] = budget_us;
+}
+
+uint32_t AsyncI2C::estimate_us(const Transaction& transaction) const {
+    // 9 clocks a byte with its acknowledge, an address byte per START, and the STOP
+    uint32_t bits = 2;
+    for (uint8_t s = 0; s < transaction.count; ++s) {
+        const Segment& segment = transaction.segments[s];
+        if (segment.tx && segment.tx_length)
+            bits += 9u * (1 + segment.tx_length);
+        if (segment.rx && segment.rx_length)
+            bits += 9u * (1 + segment.rx_length);
+    }
+    return (bits * 1000000u + clock_hz_ - 1) / clock_hz_;
+}
+
+bool AsyncI2C::submit(Transaction& transaction) {
+    if (transaction.pending() || transaction.count == 0 || !transaction.segments)
+        return false;
+    uint32_t cost = estimate_us(transaction);
+    transaction.cost_us_ = cost > 0xFFFF ? 0xFFFF : cost;
+
+    uint32_t primask = irqSave();
+    bool idle = !current_ && !stopping_;
+    uint8_t device = transaction.device;
+    // before the first beginTick() (setup) nothing is refused
+    bool budgeted = ticking_ && device < max_devices && budget_us_[device] != 0;
+    bool ok = false;
+    uint8_t slot = 0;
+    while (slot < queue_depth && slots_[slot])
+        ++slot;
+    if (budgeted && transaction.priority != URGENT && used_us_[device] != 0 &&
+        used_us_[device] + transaction.cost_us_ > budget_us_[device]) {
+        ++rejected_;
+    } else if (slot == queue_depth) {
+        ++overflows_;
+    } else if (!idle || !(port_.MSR & (LPI2C_MSR_MBF | LPI2C_MSR_BBF))) {
+        if (device < max_devices)
+            used_us_[device] += transaction.cost_us_;
+        transaction.status = Status::queued;
+        transaction.order_ = order_++;
+        slots_[slot] = &transaction;
+        if (idle)
+            startNext();
+        ok = true;
+    }
+    irqRestore(primask);
+    return ok;
+}
+
+void AsyncI2C::beginTick() {
+    uint32_t now = micros();
+    uint32_t primask = irqSave();
+    if (ticking_) {
+        last_.period_us = now - tick_start_us_;
+        last_.busy_us = busy_us_;
+        last_.busy_permille = last_.period_us ? (uint16_t)((uint64_t)busy_us_ * 1000 / last_.period_us) : 0;
+        last_.transactions = transactions_;
+        for (uint8_t d = 0; d < max_devices; ++d)
+            last_.device_us[d] = used_us_[d];
+        if (last_.busy_permille > max_permille_)
+            max_permille_ = last_.busy_permille;
+    }
+    ticking_ = true;
+    tick_start_us_ = now;
+    busy_us_ = 0;
+    transactions_ = 0;
+    for (uint8_t d = 0; d < max_devices; ++d)
+        used_us_[d] = 0;
+    irqRestore(primask);
+}
+
+void AsyncI2C::usage(Usage& out) const {
+    uint32_t primask = irqSave();
+    out = last_;
+    out.max_permille = max_permille_;
+    irqRestore(primask);
+}
+
+bool AsyncI2C::wait(Transaction& transaction, uint32_t timeout_us) {
+    if (transaction.status == Status::idle)
+        return false;
+    uint32_t start = micros();
+    while (transaction.pending()) {
+        if (micros() - start > timeout_us) {
+            uint32_t primask = irqSave();
+            if (stopping_) {
+                // the abort's STOP never came out; give the bus back to the queue
+                stopping_ = false;
+                port_.MIER = 0;
+            }
+            if (current_ == &transaction) {
+                abort();
+            } else if (transaction.status == Status::queued) {
+                // startNext() skips it
+                transaction.status = Status::failed;
+                ++failures_;
+                if (transaction.done)
+                    transaction.done(transaction, false);
+            }
+            if (!current_ && !stopping_)
+                startNext();
+            irqRestore(primask);
+            break;
+        }
+    }
+    bool ok = transaction.status == Status::done;
+    transaction.status = Status::idle;
+    return ok;
+}
+
+bool AsyncI2C::startRead(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length,
+                         Callback done, void* context) {
+    if (read_.pending() || length == 0 || length > max_length)
+        return false;
+    read_reg_ = reg;
+    read_segment_ = {&read_reg_, 1, buffer, length};
+    read_.address = address;
+    read_.segments = &read_segment_;
+    read_.count = 1;
+    read_.done = done;
+    read_.context = context;
+    read_.priority = URGENT;
+    return submit(read_);
+}
+
+bool AsyncI2C::finish(uint32_t timeout_us) {
+    return wait(read_, timeout_us);
+}
+
+// With interrupts off or from the interrupt: the oldest of the highest class
+void AsyncI2C::startNext() {
+    uint8_t best = queue_depth;
+    for (uint8_t slot = 0; slot < queue_depth; ++slot) {
+        Transaction* candidate = slots_[slot];
+        if (!candidate)
+            continue;
+        if (candidate->status != Status::queued) {
+            slots_[slot] = nullptr; // dropped by wait()
+            continue;
+        }
+        if (best == queue_depth || candidate->priority < slots_[best]->priority ||
+            (candidate->priority == slots_[best]->priority && (int16_t)(candidate->order_ - slots_[best]->order_) < 0))
+            best = slot;
+    }
+    if (best == queue_depth)
+        return;
+    Transaction* next = slots_[best];
+    slots_[best] = nullptr;
+    start(*next);
+}
+
+void AsyncI2C::start(Transaction& transaction) {
+    current_ = &transaction;
+    transaction.status = Status::running;
+    started_us_ = micros();
+    cmd_segment_ = 0;
+    cmd_step_ = 0;
+    cmd_byte_ = 0;
+    stop_queued_ = false;
+    rx_segment_ = 0;
+    rx_byte_ = 0;
+    rx_remaining_ = 0;
+    for (uint8_t s = 0; s < transaction.count; ++s)
+        if (transaction.segments[s].rx)
+            rx_remaining_ += transaction.segments[s].rx_length;
+
+    port_.MCR |= LPI2C_MCR_RTF | LPI2C_MCR_RRF;
+    port_.MSR = LPI2C_MSR_EPF | LPI2C_MSR_SDF | error_flags;
+    // refill at one word left, so a long write keeps the FIFO from running dry
+    port_.MFCR = LPI2C_MFCR_TXWATER(1) | LPI2C_MFCR_RXWATER(0);
+
+    uint32_t word;
+    while ((port_.MFSR & 0x07) < tx_fifo_depth && nextCommand(word))
+        port_.MTDR = word;
+    port_.MIER = (stop_queued_ ? 0 : LPI2C_MIER_TDIE) | LPI2C_MIER_RDIE | LPI2C_MIER_SDIE |
+                 LPI2C_MIER_NDIE | LPI2C_MIER_ALIE | LPI2C_MIER_FEIE | LPI2C_MIER_PLTIE;
+}
+
+// The next transmit FIFO word of the running transaction; false once the STOP is queued
+bool AsyncI2C::nextCommand(uint32_t& word) {
+    const Transaction& transaction = *current_;
+    const uint32_t address = transaction.address << 1;
+    while (cmd_segment_ < transaction.count) {
+        const Segment& segment = transaction.segments[cmd_segment_];
+        uint8_t tx_length = segment.tx ? segment.tx_length : 0;
+        uint8_t rx_length = segment.rx ? segment.rx_length : 0;
+        switch (cmd_step_) {
+        case 0:
+            cmd_step_ = 1;
+            cmd_byte_ = 0;
+            if (tx_length) {
+                word = LPI2C_MTDR_CMD_START | address;
+                return true;
+            }
+            // fall through
+        case 1:
+            if (cmd_byte_ < tx_length) {
+                word = LPI2C_MTDR_CMD_TRANSMIT | segment.tx[cmd_byte_++];
+                return true;
+            }
+            cmd_step_ = 2;
+            // fall through
+        case 2:
+            cmd_step_ = 3;
+            if (rx_length) {
+                word = LPI2C_MTDR_CMD_START | address | 1;
+                return true;
+            }
+            // fall through
+        default:
+            cmd_step_ = 0;
+            ++cmd_segment_;
+            if (rx_length) {
+                word = LPI2C_MTDR_CMD_RECEIVE | (rx_length - 1);
+                return true;
+            }
+        }
+    }
+    if (stop_queued_)
+        return false;
+    stop_queued_ = true;
+    word = LPI2C_MTDR_CMD_STOP;
+    return true;
+}
+
+void AsyncI2C::service() {
+    uint32_t status = port_.MSR;
+    if (stopping_) {
+        if (status & LPI2C_MSR_SDF) {
+            port_.MSR = LPI2C_MSR_SDF | error_flags;
+            port_.MIER = 0;
+            stopping_ = false;
+            startNext();
+        }
+        return;
+    }
+    Transaction* transaction = current_;
+    if (!transaction) {
+        port_.MIER = 0;
+        return;
+    }
+    if (status & error_flags) {
+        abort();
+        return;
+    }
+
+    while (rx_remaining_) {
+        uint32_t data = port_.MRDR;
+        if (data & LPI2C_MRDR_RXEMPTY)
+            break;
+        const Segment* segment = &transaction->segments[rx_segment_];
+        while (!segment->rx || rx_byte_ >= segment->rx_length) {
+            segment = &transaction->segments[++rx_segment_];
+            rx_byte_ = 0;
+        }
+        segment->rx[rx_byte_++] = data & 0xFF;
+        --rx_remaining_;
+    }
+
+    if (!stop_queued_ && (status & LPI2C_MSR_TDF)) {
+        uint32_t word;
+        while ((port_.MFSR & 0x07) < tx_fifo_depth && nextCommand(word))
+            port_.MTDR = word;
+        if (stop_queued_)
+            port_.MIER &= ~LPI2C_MIER_TDIE;
+    }
+
+    if (status & LPI2C_MSR_SDF) {
+        port_.MSR = LPI2C_MSR_SDF;
+        port_.MIER = 0;
+        complete(stop_queued_ && rx_remaining_ == 0);
+    }
+}
+
+// End the running transaction, call its callback and go on with the queue
+void AsyncI2C::complete(bool ok) {
+    Transaction* transaction = current_;
+    current_ = nullptr;
+    busy_us_ += micros() - started_us_;
+    ++transactions_;
+    transaction->status = ok ? Status::done : Status::failed;
+    if (!ok)
+        ++failures_;
+    if (transaction->done)
+        transaction->done(*transaction, ok);
+    // the callback may have submitted, and so started, the next one itself
+    if (!current_ && !stopping_)
+        startNext();
+}
+
+// Flush the FIFOs and end the transfer with a STOP; the queue goes on once it is out,
+// and a TwoWire call after the queue drains finds a clean master
+void AsyncI2C::abort() {
+    port_.MIER = 0;
+    port_.MCR |= LPI2C_MCR_RTF | LPI2C_MCR_RRF;
+    port_.MSR = LPI2C_MSR_EPF | LPI2C_MSR_SDF | error_flags;
+    if (port_.MSR & LPI2C_MSR_MBF) {
+        port_.MTDR = LPI2C_MTDR_CMD_STOP;
+        stopping_ = true;
+        port_.MIER = LPI2C_MIER_SDIE;
+    }
+    complete(false);
+}
@@ -0,0 +1,178 @@
+#ifndef AsyncI2C_h
+#define AsyncI2C_h
+
+#include "Arduino.h"
+
+/* Non-blocking transactions on an i.MX RT LPI2C master, queued per bus, so
+* several devices share it and the control step never waits on the wire.
+*
+* A Transaction is a slave address and a list of Segments, each an optional
+* write and an optional read, the same sequence as odrive.h's
+* I2C_transactions(): one START arbitrates, every later write or read begins
+* with a REPEATED START, and the STOP follows the last segment. submit()
+* queues it and returns; the LPI2C interrupt feeds the 4-word transmit FIFO
+* from the segments, drains the receive FIFO into them, calls the
+* transaction's callback on the STOP and starts the next one in the queue.
+* The LPI2C has a single DMA request per module for both FIFOs, so this
+* drives the FIFOs from the interrupt instead of two DMA channels; at the
+* watermarks used that is one interrupt per 1-4 bytes.
+*
+* Transactions, their segments and buffers are the caller's and must stay
+* put until the callback (or wait()) has seen them finish; one Transaction
+* is in the queue at most once. Callbacks run in the interrupt: they copy
+* or decode the bytes, set a flag, or submit() the next transfer, nothing
+* that waits.
+*
+* startRead()/finish() are the single register burst on top of it, with
+* wait() as the bounded join for code that needs the result now.
+*
+* Scheduling, for devices sharing one bus within a control period:
+*  - Priority: the queue starts the highest class first, in submission order
+*    within one; URGENT is what the control step joins the same tick (IMU
+*    burst, ODrive feedback and setpoints), NORMAL the slower sensors,
+*    BACKGROUND state and error polls. A running transaction is not preempted.
+*  - Budget: setBudget() gives a device a share of bus time per tick, in us
+*    estimated from the segment lengths at setClock()'s rate. submit()
+*    refuses a NORMAL or BACKGROUND transaction that would overrun its
+*    device's share (rejected()), so a poll skips a tick rather than
+*    pushing the next step's traffic back; URGENT ones are charged, never
+*    refused, and the first transaction of a device in a tick always goes.
+*    Until the first beginTick() nothing is refused, so setup() runs unlimited.
+*  - beginTick(), at the top of the control step, closes the tick: bus busy
+*    time as measured from START to STOP against the tick's length, and each
+*    device's charged time, for usage(); and clears the shares.
+*
+* The port is the one a TwoWire is using (begin() and setClock() on it
+* configure pins and timing); while transactions are queued, no call on that
+* TwoWire may run. The interrupt must preempt whatever waits, e.g. the
+* control step at priority 192.
+*/
+class AsyncI2C {
+public:
+    static constexpr uint8_t max_length = 32;
+    static constexpr uint8_t queue_depth = 8;
+    static constexpr uint8_t max_devices = 4;
+    static constexpr uint8_t no_device = 0xFF;
+
+    enum class Status : uint8_t { idle, queued, running, done, failed };
+    enum Priority : uint8_t { URGENT, NORMAL, BACKGROUND, NUM_PRIORITIES };
+
+    struct Segment {
+        const uint8_t* tx;   // nullptr or tx_length 0: no write
+        uint8_t tx_length;
+        uint8_t* rx;         // nullptr or rx_length 0: no read
+        uint8_t rx_length;
+    };
+
+    struct Transaction;
+    // From the LPI2C interrupt; ok is false on NACK, arbitration loss or abort
+    typedef void (*Callback)(Transaction& transaction, bool ok);
+
+    struct Transaction {
+        uint8_t address = 0;
+        const Segment* segments = nullptr;
+        uint8_t count = 0;
+        Callback done = nullptr;
+        void* context = nullptr;
+        Priority priority = NORMAL;
+        uint8_t device = no_device; // below max_devices to count against a budget
+        volatile Status status = Status::idle;
+
+        bool pending() const { return status == Status::queued || status == Status::running; }
+
+    private:
+        friend class AsyncI2C;
+        uint16_t order_ = 0;
+        uint16_t cost_us_ = 0;
+    };
+
+    // The last closed tick, with maxima since resetUsage()
+    struct Usage {
+        uint32_t period_us;
+        uint32_t busy_us;
+        uint16_t busy_permille;
+        uint16_t max_permille;
+        uint16_t transactions;
+        uint16_t device_us[max_devices];
+    };
+
+    AsyncI2C(IMXRT_LPI2C_t& port, IRQ_NUMBER_t irq, uint8_t priority = 128);
+
+    // After the TwoWire's begin() and setClock()
+    void begin();
+    // The bus rate behind the budget's estimates
+    void setClock(uint32_t clock_hz) { clock_hz_ = clock_hz; }
+    // 0: no limit
+    void setBudget(uint8_t device, uint16_t budget_us);
+    void beginTick();
+    void usage(Usage& out) const;
+    void resetUsage() { max_permille_ = 0; }
+    // Bus time of a transaction at setClock()'s rate, STARTs and acknowledges included
+    uint32_t estimate_us(const Transaction& transaction) const;
+
+    // false if the transaction is still pending, empty, over its device's budget,
+    // the queue is full, or the bus is held by someone else while the queue is idle
+    bool submit(Transaction& transaction);
+    // Wait for a submitted transaction; on timeout it is aborted or dropped from the queue
+    bool wait(Transaction& transaction, uint32_t timeout_us = 2000);
+
+    // One register burst, URGENT: write reg, repeated START, read length bytes
+    bool startRead(uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t length,
+                   Callback done = nullptr, void* context = nullptr);
+    bool busy() const { return read_.pending(); }
+    // Wait for the burst; false on NACK, arbitration loss or timeout
+    bool finish(uint32_t timeout_us = 2000);
+
+    uint32_t failures() const { return failures_; }
+    uint32_t overflows() const { return overflows_; }
+    uint32_t rejected() const { return rejected_; }
+
+private:
+    template<uint8_t N> static void isr();
+    void service();
+    void start(Transaction& transaction);
+    void startNext();
+    bool nextCommand(uint32_t& word);
+    void complete(bool ok);
+    void abort();
+
+    IMXRT_LPI2C_t& port_;
+    IRQ_NUMBER_t irq_;
+    uint8_t priority_;
+
+    Transaction* slots_[queue_depth] = {};
+    uint16_t order_ = 0;
+    Transaction* volatile current_ = nullptr;
+    volatile bool stopping_ = false; // an abort's STOP is still going out
+
+    // transmit side: the segment and step whose command goes in the FIFO next
+    uint8_t cmd_segment_ = 0;
+    uint8_t cmd_step_ = 0;
+    uint8_t cmd_byte_ = 0;
+    bool stop_queued_ = false;
+    // receive side
+    uint8_t rx_segment_ = 0;
+    uint8_t rx_byte_ = 0;
+    uint16_t rx_remaining_ = 0;
+
+    Transaction read_;
+    Segment read_segment_ = {};
+    uint8_t read_reg_ = 0;
+
+    uint32_t clock_hz_ = 400000;
+    uint16_t budget_us_[max_devices] = {};
+    uint16_t used_us_[max_devices] = {};
+    uint32_t started_us_ = 0;
+    uint32_t busy_us_ = 0;
+    uint16_t transactions_ = 0;
+    bool ticking_ = false;
+    uint32_t tick_start_us_ = 0;
+    Usage last_ = {};
+    uint16_t max_permille_ = 0;
+
+    volatile uint32_t failures_ = 0;
+    uint32_t overflows_ = 0;
+    uint32_t rejected_ = 0;
+};
+
+#endif //AsyncI2C_h
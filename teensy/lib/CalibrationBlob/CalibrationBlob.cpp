@@ -0,0 +1,35 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <string.h>
+#include "CalibrationBlob.h"
+#include <Placement.h>
+
+COLD_CODE bool CalibrationBlob::valid() const {
+    return magic == MAGIC && version == VERSION && size == sizeof(CalibrationBlob) &&
+           crc == crc32(this, offsetof(CalibrationBlob, crc));
+}
+
+// Reflected CRC-32 (0xEDB88320), bitwise: it runs once per boot over 84 bytes
+COLD_CODE uint32_t CalibrationBlob::crc32(const void* data, size_t length) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= p[i];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+COLD_CODE void CalibrationBlob::read(CalibrationBlob& blob) {
+    uint8_t* p = reinterpret_cast<uint8_t*>(&blob);
+    for (size_t i = 0; i < sizeof(blob); ++i)
+        p[i] = EEPROM.read(EEPROM_ADDRESS + i);
+}
+
+COLD_CODE void CalibrationBlob::write(const CalibrationBlob& blob) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&blob);
+    // update() skips the bytes that already match
+    for (size_t i = 0; i < sizeof(blob); ++i)
+        EEPROM.update(EEPROM_ADDRESS + i, p[i]);
+}
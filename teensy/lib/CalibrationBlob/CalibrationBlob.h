@@ -0,0 +1,104 @@
+#ifndef CalibrationBlob_h
+#define CalibrationBlob_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* The IMU calibration as a packed, CRC-checked struct in the Teensy's
+* EEPROM (emulated in on-chip flash), so a boot reads 88 bytes instead of
+* mounting the SD card and parsing the JSON file with ArduinoJson.
+*
+* The fields are Adafruit_Sensor_Calibration's, in its units. load() copies
+* a blob whose magic, version, size and CRC-32 all check out into the
+* calibration; anything else (never written, an older layout, a torn write)
+* is rejected and the SD file stays the source. store() writes the blob
+* only if it differs from what is there, so importing the same file again
+* costs no flash wear.
+*
+*     if (!CalibrationBlob::load(cal) && cal.begin() && cal.loadCalibration())
+*         CalibrationBlob::store(cal);
+*/
+struct CalibrationBlob {
+    uint32_t magic;             // CalibrationBlob::MAGIC
+    uint16_t version;
+    uint16_t size;              // sizeof(CalibrationBlob)
+    float mag_hardiron[3];      // uT
+    float mag_softiron[9];      // row-major
+    float mag_field;            // uT
+    float gyro_zerorate[3];     // rad/s
+    float accel_zerog[3];       // m/s^2
+    uint32_t crc;               // CRC-32 of everything before it
+
+    static constexpr uint32_t MAGIC = 0x314C4143; // "CAL1"
+    static constexpr uint16_t VERSION = 1;
+    // past the 68 bytes Adafruit_Sensor_Calibration_EEPROM keeps at address 0
+    static constexpr int EEPROM_ADDRESS = 128;
+
+    // The blob of a calibration, and back; unpack() is false on any mismatch
+    template<class Calibration> static CalibrationBlob pack(const Calibration& cal);
+    template<class Calibration> bool unpack(Calibration& cal) const;
+    bool valid() const;
+
+    // From and to EEPROM_ADDRESS
+    template<class Calibration> static bool load(Calibration& cal);
+    // true if the blob was written, false if the EEPROM already held it
+    template<class Calibration> static bool store(const Calibration& cal);
+
+    static uint32_t crc32(const void* data, size_t length);
+    static void read(CalibrationBlob& blob);
+    static void write(const CalibrationBlob& blob);
+};
+
+static_assert(sizeof(CalibrationBlob) == 88, "the blob layout is stored in EEPROM");
+
+template<class Calibration>
+CalibrationBlob CalibrationBlob::pack(const Calibration& cal) {
+    CalibrationBlob blob;
+    blob.magic = MAGIC;
+    blob.version = VERSION;
+    blob.size = sizeof(CalibrationBlob);
+    for (int i = 0; i < 3; ++i) {
+        blob.mag_hardiron[i] = cal.mag_hardiron[i];
+        blob.gyro_zerorate[i] = cal.gyro_zerorate[i];
+        blob.accel_zerog[i] = cal.accel_zerog[i];
+    }
+    for (int i = 0; i < 9; ++i)
+        blob.mag_softiron[i] = cal.mag_softiron[i];
+    blob.mag_field = cal.mag_field;
+    blob.crc = crc32(&blob, offsetof(CalibrationBlob, crc));
+    return blob;
+}
+
+template<class Calibration>
+bool CalibrationBlob::unpack(Calibration& cal) const {
+    if (!valid())
+        return false;
+    for (int i = 0; i < 3; ++i) {
+        cal.mag_hardiron[i] = mag_hardiron[i];
+        cal.gyro_zerorate[i] = gyro_zerorate[i];
+        cal.accel_zerog[i] = accel_zerog[i];
+    }
+    for (int i = 0; i < 9; ++i)
+        cal.mag_softiron[i] = mag_softiron[i];
+    cal.mag_field = mag_field;
+    return true;
+}
+
+template<class Calibration>
+bool CalibrationBlob::load(Calibration& cal) {
+    CalibrationBlob blob;
+    read(blob);
+    return blob.unpack(cal);
+}
+
+template<class Calibration>
+bool CalibrationBlob::store(const Calibration& cal) {
+    CalibrationBlob blob = pack(cal), current;
+    read(current);
+    if (current.valid() && current.crc == blob.crc)
+        return false;
+    write(blob);
+    return true;
+}
+
+#endif //CalibrationBlob_h
@@ -0,0 +1,40 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "CalibrationBlob.h"
+#include "ReferenceBlob.h"
+#include <Placement.h>
+
+COLD_CODE ReferenceBlob ReferenceBlob::pack(const float* spoke_zero, float yaw_zero) {
+    ReferenceBlob blob;
+    blob.magic = MAGIC;
+    blob.version = VERSION;
+    blob.size = sizeof(ReferenceBlob);
+    blob.spoke_zero[0] = spoke_zero[0];
+    blob.spoke_zero[1] = spoke_zero[1];
+    blob.yaw_zero = yaw_zero;
+    blob.crc = CalibrationBlob::crc32(&blob, offsetof(ReferenceBlob, crc));
+    return blob;
+}
+
+COLD_CODE bool ReferenceBlob::valid() const {
+    return magic == MAGIC && version == VERSION && size == sizeof(ReferenceBlob) &&
+           crc == CalibrationBlob::crc32(this, offsetof(ReferenceBlob, crc));
+}
+
+COLD_CODE bool ReferenceBlob::load(ReferenceBlob& blob) {
+    uint8_t* p = reinterpret_cast<uint8_t*>(&blob);
+    for (size_t i = 0; i < sizeof(blob); ++i)
+        p[i] = EEPROM.read(EEPROM_ADDRESS + i);
+    return blob.valid();
+}
+
+COLD_CODE bool ReferenceBlob::store(const ReferenceBlob& blob) {
+    ReferenceBlob current;
+    if (load(current) && current.crc == blob.crc)
+        return false;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&blob);
+    // update() skips the bytes that already match
+    for (size_t i = 0; i < sizeof(blob); ++i)
+        EEPROM.update(EEPROM_ADDRESS + i, p[i]);
+    return true;
+}
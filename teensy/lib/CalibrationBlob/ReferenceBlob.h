@@ -0,0 +1,43 @@
+#ifndef ReferenceBlob_h
+#define ReferenceBlob_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* The spoke and heading zeros as a CRC-checked struct in EEPROM, next to
+* the CalibrationBlob, so a boot can take the references of an earlier one
+* instead of the pose the wheel happens to stand in.
+*
+* A spoke zero is the ODrive position (motor turns) that reads spoke angle
+* zero. It only means the same thing on the next boot if the position is
+* absolute, i.e. the axis found its encoder index, so main.cpp stores and
+* applies it only for indexed axes. The heading zero is the attitude
+* filter's yaw with the magnetometer fused, absolute up to the mag's
+* calibration. load() rejects a blob with anything off, as CalibrationBlob
+* does; store() writes only what differs from what is there.
+*/
+struct ReferenceBlob {
+    uint32_t magic;             // ReferenceBlob::MAGIC
+    uint16_t version;
+    uint16_t size;              // sizeof(ReferenceBlob)
+    float spoke_zero[2];        // motor turns of each axis at spoke angle 0
+    float yaw_zero;             // rad, the filter heading that reads 0
+    uint32_t crc;               // CRC-32 of everything before it
+
+    static constexpr uint32_t MAGIC = 0x31464552; // "REF1"
+    static constexpr uint16_t VERSION = 1;
+    // past the CalibrationBlob's 88 bytes at 128
+    static constexpr int EEPROM_ADDRESS = 256;
+
+    static ReferenceBlob pack(const float* spoke_zero, float yaw_zero);
+    bool valid() const;
+
+    // From and to EEPROM_ADDRESS; load() is false without a valid blob
+    static bool load(ReferenceBlob& blob);
+    // true if the blob was written, false if the EEPROM already held it
+    static bool store(const ReferenceBlob& blob);
+};
+
+static_assert(sizeof(ReferenceBlob) == 24, "the blob layout is stored in EEPROM");
+
+#endif //ReferenceBlob_h
@@ -0,0 +1,130 @@
+#ifndef BootSelfTest_h
+#define BootSelfTest_h
+
+#include <stdint.h>
+
+/* The session's performance envelope, measured once at boot: how long the
+* ODrive takes to answer over each transport the wiring has, how long the
+* IMU's reads take, and what rosserial carries once the Pi is connected.
+*
+* setup() runs each probe a few times through run(), which times every call
+* and stops once the self-test's budget is spent, so an ODrive or a sensor
+* that stops answering costs one timeout past the budget, not one a call:
+*
+*     BootSelfTest test(BOOT_SELF_TEST_BUDGET_MS*1000ul);
+*     test.begin(micros());
+*     test.run(BootSelfTest::ODRIVE_ASCII, 16, micros, [&] { return ascii.readFeedback(p, v); });
+*
+* The link can only be measured once rosserial is in sync, so loop() opens
+* a window at the first connected pass with linkStart() and closes it
+* with linkEnd() a while later: the bytes written over it (all of the
+* firmware's traffic, the sensor stream included, not a synthetic burst)
+* and the sensor frames dropped for a full USB buffer. The report goes out
+* then, once.
+*
+* fastestOdrive() is the working ODrive transport with the lowest mean, of
+* those run; the drivers are fixed at compile time (MOTOR_DRIVER), so it is
+* a recommendation for the next build, not a switch.
+*/
+class BootSelfTest {
+public:
+    enum Probe : uint8_t {
+        ODRIVE_PROPERTY,    // "r vbus_voltage" over the ASCII protocol, the connect check
+        ODRIVE_ASCII,       // ODriveAsciiDriver's pipelined "f 0" "f 1"
+        ODRIVE_BINARY,      // ODriveBinaryDriver's four-read batch
+        ODRIVE_DRIVER,      // the build's own driver when it is neither: I2C, or CAN's broadcast
+        IMU_BURST,          // gyro and accel, 12 bytes
+        MAG_READ,           // the magnetometer, 6 bytes
+        NUM_PROBES
+    };
+
+    struct Timing {
+        uint16_t runs, ok;
+        uint32_t min_us, max_us;
+        uint32_t total_us;      // of the successful runs
+
+        uint32_t mean_us() const { return ok ? total_us / ok : 0; }
+    };
+
+    explicit BootSelfTest(uint32_t budget_us) : budget_us_(budget_us) {}
+
+    void begin(uint32_t now_us) { start_us_ = last_us_ = now_us; }
+
+    // runs calls of f, each timed with clock (micros), until the budget is spent; f returns
+    // whether the call succeeded. The number that did
+    template<class Clock, class F>
+    uint16_t run(uint8_t probe, uint16_t runs, Clock&& clock, F&& f) {
+        if (probe >= NUM_PROBES) return 0;
+        Timing& t = timings_[probe];
+        for (uint16_t i = 0; i < runs; ++i) {
+            uint32_t t0 = clock();
+            if (t0 - start_us_ >= budget_us_) {
+                over_budget_ = true;
+                break;
+            }
+            bool ok = f();
+            uint32_t t1 = clock();
+            last_us_ = t1;
+            ++t.runs;
+            if (!ok) continue;
+            uint32_t elapsed = t1 - t0;
+            if (t.ok == 0 || elapsed < t.min_us) t.min_us = elapsed;
+            if (elapsed > t.max_us) t.max_us = elapsed;
+            t.total_us += elapsed;
+            ++t.ok;
+        }
+        return t.ok;
+    }
+
+    // now_ms from boot (millis), so the start is also how long the sync took
+    void linkStart(uint32_t now_ms, uint32_t written, uint32_t dropped) {
+        link_start_ms_ = now_ms;
+        written_ = written;
+        dropped_ = dropped;
+        link_started_ = true;
+    }
+    void linkEnd(uint32_t now_ms, uint32_t written, uint32_t dropped) {
+        uint32_t span_ms = now_ms - link_start_ms_;
+        link_bytes_per_s_ = span_ms ? (uint32_t)((uint64_t)(written - written_) * 1000u / span_ms) : 0;
+        link_dropped_ = dropped - dropped_;
+        link_done_ = true;
+    }
+    bool linkStarted() const { return link_started_; }
+    bool linkDone() const { return link_done_; }
+
+    const Timing& timing(uint8_t probe) const { return timings_[probe < NUM_PROBES ? probe : 0]; }
+    // Of the setup() probes, all of them
+    uint32_t elapsed_us() const { return last_us_ - start_us_; }
+    bool overBudget() const { return over_budget_; }
+    uint32_t syncMs() const { return link_start_ms_; }
+    uint32_t linkBytesPerS() const { return link_bytes_per_s_; }
+    uint32_t linkDropped() const { return link_dropped_; }
+
+    // ODRIVE_ASCII, ODRIVE_BINARY or ODRIVE_DRIVER; NUM_PROBES when none answered
+    uint8_t fastestOdrive() const {
+        uint8_t best = NUM_PROBES;
+        for (uint8_t p = ODRIVE_ASCII; p <= ODRIVE_DRIVER; ++p) {
+            if (timings_[p].ok == 0) continue;
+            if (best == NUM_PROBES || timings_[p].mean_us() < timings_[best].mean_us()) best = p;
+        }
+        return best;
+    }
+
+    static const char* name(uint8_t probe) {
+        static const char* const names[NUM_PROBES] = {"odrive_property", "odrive_ascii", "odrive_binary",
+                                                      "odrive_driver", "imu_burst", "mag_read"};
+        return probe < NUM_PROBES ? names[probe] : "?";
+    }
+
+private:
+    uint32_t budget_us_;
+    uint32_t start_us_ = 0, last_us_ = 0;
+    bool over_budget_ = false;
+    Timing timings_[NUM_PROBES] = {};
+    bool link_started_ = false, link_done_ = false;
+    uint32_t link_start_ms_ = 0;
+    uint32_t written_ = 0, dropped_ = 0;
+    uint32_t link_bytes_per_s_ = 0, link_dropped_ = 0;
+};
+
+#endif //BootSelfTest_h
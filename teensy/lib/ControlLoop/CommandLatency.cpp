@@ -0,0 +1,74 @@
+#include "Arduino.h"
+#include "CommandLatency.h"
+
+void CommandLatency::sent(uint32_t seq, uint32_t stamp_us) {
+    Sample& s = ring_[seq % ring_size];
+    if (s.pending) ++window_.lost;
+    s.seq = seq;
+    s.stamp_us = stamp_us;
+    s.pending = true;
+}
+
+bool CommandLatency::echoed(uint32_t seq, uint32_t now_us) {
+    Sample& s = ring_[seq % ring_size];
+    if (!s.pending || s.seq != seq) {
+        ++window_.unmatched;
+        return false;
+    }
+    s.pending = false;
+    uint32_t rtt = now_us - s.stamp_us;
+    last_rtt_us_ = rtt;
+    ++window_.echoed;
+    rtt_total_us_ += rtt;
+    if (rtt > window_.max_rtt_us) window_.max_rtt_us = rtt;
+
+    noInterrupts();
+    echo_stamp_us_ = s.stamp_us;
+    echo_pending_ = true;
+    interrupts();
+    return true;
+}
+
+void CommandLatency::applied(uint32_t now_us) {
+    if (!echo_pending_) return;
+    echo_pending_ = false;
+    uint32_t latency = now_us - echo_stamp_us_;
+    ++window_.applied;
+    applied_total_us_ += latency;
+    if (latency < window_.min_us) window_.min_us = latency;
+    if (latency > window_.max_us) window_.max_us = latency;
+    uint32_t bin = latency / bin_us_;
+    ++window_.bins[bin < num_bins ? bin : num_bins - 1];
+}
+
+void CommandLatency::snapshot(Window& window) {
+    noInterrupts();
+    window = window_;
+    window.mean_rtt_us = window.echoed ? rtt_total_us_ / window.echoed : 0;
+    window.mean_us = window.applied ? applied_total_us_ / window.applied : 0;
+    clear();
+    interrupts();
+    if (window.applied == 0)
+        window.min_us = 0;
+}
+
+uint32_t CommandLatency::quantile_us(const Window& window, float q) const {
+    if (window.applied == 0) return 0;
+    uint32_t target = (uint32_t)ceilf(q * window.applied);
+    uint32_t seen = 0;
+    for (uint8_t bin = 0; bin < num_bins; ++bin) {
+        seen += window.bins[bin];
+        if (seen >= target) {
+            uint32_t edge = (bin + 1) * bin_us_;
+            return edge < window.max_us ? edge : window.max_us;
+        }
+    }
+    return window.max_us;
+}
+
+void CommandLatency::clear() {
+    memset(&window_, 0, sizeof(window_));
+    window_.min_us = UINT32_MAX;
+    rtt_total_us_ = 0;
+    applied_total_us_ = 0;
+}
@@ -0,0 +1,71 @@
+#ifndef CommandLatency_h
+#define CommandLatency_h
+
+#include "Arduino.h"
+
+/* Latency from a published sensor sample to the torque an off-board
+* controller computed from it, measured on the Teensy's micros() alone, so the
+* Pi's clock and every hop in between (rosserial, relays, the controller's own
+* loop) are inside the number.
+*
+* sent(seq, stamp_us) is called when the sample taken at stamp_us goes out as
+* /sensors sample seq; the controller echoes seq in its /torso_command and
+* echoed(seq, now) matches it (the round trip). applied(now) is called by the
+* control step once it has written that torque to the ODrive. Samples are kept
+* in a ring of ring_size; an echo of a sample no longer in the ring, or a
+* second echo of one, is unmatched, and a sample that leaves the ring without
+* an echo is lost.
+*
+* The histogram is of sample-to-applied latency in num_bins bins of bin_us
+* from zero, the last bin collecting everything beyond. sent() and echoed()
+* run in loop(), applied() in the control interrupt; snapshot() copies the
+* window with interrupts off and starts a new one.
+*/
+class CommandLatency {
+public:
+    static constexpr uint8_t num_bins = 16;
+    static constexpr uint8_t ring_size = 64;
+
+    struct Window {
+        uint32_t echoed, unmatched, lost;
+        uint32_t mean_rtt_us, max_rtt_us;
+        uint32_t applied;
+        uint32_t min_us, mean_us, max_us;
+        uint32_t bins[num_bins];
+    };
+
+    explicit CommandLatency(uint32_t bin_us = 1000) : bin_us_(bin_us) { clear(); }
+
+    void sent(uint32_t seq, uint32_t stamp_us);
+    bool echoed(uint32_t seq, uint32_t now_us);
+    void applied(uint32_t now_us);
+
+    void snapshot(Window& window);
+
+    // The round trip of the newest matched echo
+    uint32_t lastRtt_us() const { return last_rtt_us_; }
+    uint32_t bin_us() const { return bin_us_; }
+    // Upper edge of the bin holding fraction q of the applied samples
+    uint32_t quantile_us(const Window& window, float q) const;
+
+private:
+    struct Sample {
+        uint32_t seq;
+        uint32_t stamp_us;
+        bool pending;
+    };
+
+    void clear();
+
+    uint32_t bin_us_;
+    Sample ring_[ring_size] = {};
+    Window window_;
+    uint64_t rtt_total_us_ = 0;
+    uint32_t last_rtt_us_ = 0;
+    uint64_t applied_total_us_ = 0;
+    // the newest echo, handed to the control interrupt
+    volatile bool echo_pending_ = false;
+    uint32_t echo_stamp_us_ = 0;
+};
+
+#endif //CommandLatency_h
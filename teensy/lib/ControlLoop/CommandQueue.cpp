@@ -0,0 +1,53 @@
+#include "Arduino.h"
+#include "CommandQueue.h"
+#include "Placement.h"
+#include <atomic>
+
+// The slot written is neither of the two sample() reads, and count_ moves to it
+// only once it is complete
+void CommandQueue::push(const Setpoint& setpoint, uint32_t now_us) {
+    uint32_t seq = count_ + 1;
+    Command& c = ring_[seq % ring_size];
+    c.seq = seq;
+    c.received_us = now_us;
+    c.setpoint = setpoint;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    count_ = seq;
+}
+
+HOT_CODE const CommandQueue::Command* CommandQueue::fresh(uint32_t n, uint32_t now_us) {
+    const Command& newest = ring_[n % ring_size];
+    if (now_us - newest.received_us > timeout_us_) {
+        if (!timed_out_) ++timeouts_;
+        timed_out_ = true;
+        return nullptr;
+    }
+    timed_out_ = false;
+    return &newest;
+}
+
+HOT_CODE float CommandQueue::sample(uint32_t now_us) {
+    uint32_t n = count_;
+    if (n == 0) return 0.0f;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    const Command* newest = fresh(n, now_us);
+    if (!newest) return 0.0f;
+    float torque = newest->setpoint.torque;
+    if (!interpolate_ || n < 2) return torque;
+
+    const Command& previous = ring_[(n - 1) % ring_size];
+    uint32_t age = now_us - newest->received_us;
+    uint32_t interval = newest->received_us - previous.received_us;
+    if (interval == 0 || interval > timeout_us_ || age >= interval) return torque;
+    return previous.setpoint.torque + (torque - previous.setpoint.torque) * ((float)age / interval);
+}
+
+HOT_CODE bool CommandQueue::newest(Setpoint& out, uint32_t now_us) {
+    uint32_t n = count_;
+    if (n == 0) return false;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    const Command* newest = fresh(n, now_us);
+    if (!newest) return false;
+    out = newest->setpoint;
+    return true;
+}
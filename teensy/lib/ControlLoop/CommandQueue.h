@@ -0,0 +1,84 @@
+#ifndef CommandQueue_h
+#define CommandQueue_h
+
+#include "Arduino.h"
+
+/* The off-board torque commands, numbered and stamped on arrival, between
+* the /torso_command callback and the control step.
+*
+* push() runs in loop() for every command received; sample() runs in the
+* control interrupt and returns the torque to apply at now_us, so the step
+* keeps its own rate whatever the Pi's is:
+*  - zero before the first command,
+*  - zero once the newest command is older than timeout_us (the Pi, its
+*    controller or the link stopped), counted in timeouts() and reported by
+*    timedOut() until a command arrives again,
+*  - with interpolate, a ramp from the previous command to the newest over
+*    the interval they arrived apart, so a controller slower than the step
+*    gives a continuous torque at the cost of that interval's delay; a pair
+*    more than timeout_us apart is stepped,
+*  - otherwise the newest command, held.
+*
+* Commands are numbered from 1 in arrival order rather than by the header's
+* seq, which each publisher on the topic (the controller, the joystick's
+* zero fallbacks) counts on its own. The last ring_size are kept; push()
+* fills the slot after the newest and only then publishes it, so sample(),
+* which reads the newest two and cannot be preempted by loop(), never sees
+* half of one and push() never turns interrupts off.
+*
+* With SUPERVISED_CONTROL a command is a Setpoint for the on-board torso
+* stabilizer (TorsoStabilizer.h) rather than a torque alone: newest() hands
+* the step the whole of the newest one, unramped, under the same timeout.
+*/
+class CommandQueue {
+public:
+    static constexpr uint8_t ring_size = 4;
+
+    // The feed-forward torque, and the torso target the stabilizer holds with
+    // the gains kp, kd; both gains 0 for a plain torque command
+    struct Setpoint {
+        float torque;
+        float angle;
+        float rate;
+        float kp;
+        float kd;
+    };
+
+    struct Command {
+        uint32_t seq;
+        uint32_t received_us;
+        Setpoint setpoint;
+    };
+
+    CommandQueue(uint32_t timeout_us, bool interpolate)
+        : timeout_us_(timeout_us), interpolate_(interpolate) {}
+
+    void push(float torque, uint32_t now_us) { push(Setpoint{torque, 0.0f, 0.0f, 0.0f, 0.0f}, now_us); }
+    void push(const Setpoint& setpoint, uint32_t now_us);
+    float sample(uint32_t now_us);
+    // The newest setpoint into out; false before the first and once timed out
+    bool newest(Setpoint& out, uint32_t now_us);
+
+    // Number of the newest command, 0 for none yet; a change means a fresh one
+    uint32_t seq() const { return count_; }
+    // Since the newest command arrived, UINT32_MAX before the first
+    uint32_t age_us(uint32_t now_us) const {
+        uint32_t n = count_;
+        return n ? now_us - ring_[n % ring_size].received_us : UINT32_MAX;
+    }
+    bool timedOut() const { return timed_out_; }
+    uint32_t timeouts() const { return timeouts_; }
+
+private:
+    // The newest command if it is within the timeout, counting the timeouts; null otherwise
+    const Command* fresh(uint32_t n, uint32_t now_us);
+
+    uint32_t timeout_us_;
+    bool interpolate_;
+    Command ring_[ring_size] = {};
+    volatile uint32_t count_ = 0;
+    bool timed_out_ = false;
+    uint32_t timeouts_ = 0;
+};
+
+#endif //CommandQueue_h
@@ -0,0 +1,85 @@
+
+#include "Arduino.h"
+#include "ControlScheduler.h"
+#include "Placement.h"
+
+static ControlScheduler* active_scheduler = nullptr;
+
+ControlScheduler::ControlScheduler(uint32_t period_us, uint8_t priority)
+    : period_us_(period_us), priority_(priority) {}
+
+bool ControlScheduler::begin(Step step) {
+    step_ = step;
+    active_scheduler = this;
+    resetStats();
+    paused_ = 0;
+    resume();
+    return running_;
+}
+
+void ControlScheduler::end() {
+    pause();
+    step_ = nullptr;
+}
+
+void ControlScheduler::pause() {
+    ++paused_;
+    timer_.end();
+    running_ = false;
+}
+
+void ControlScheduler::resume() {
+    if (paused_ > 0 && --paused_ > 0)
+        return;
+    if (running_ || !step_)
+        return;
+    late_ = false;
+    timer_.priority(priority_);
+    running_ = timer_.begin(isr, period_us_);
+}
+
+void ControlScheduler::setPeriod(uint32_t period_us) {
+    period_us_ = period_us;
+    if (running_)
+        timer_.update(period_us_);
+}
+
+void ControlScheduler::resetStats() {
+    noInterrupts();
+    ticks_ = 0;
+    overruns_ = 0;
+    skipped_ = 0;
+    last_duration_us_ = 0;
+    max_duration_us_ = 0;
+    interrupts();
+}
+
+HOT_CODE void ControlScheduler::isr() {
+    if (active_scheduler)
+        active_scheduler->tick();
+}
+
+HOT_CODE void ControlScheduler::tick() {
+    uint32_t start = micros();
+    // the tick latched while the previous step overran fires right after it returns
+    if (late_ && start - last_end_us_ < period_us_ / 2) {
+        late_ = false;
+        ++skipped_;
+        return;
+    }
+    late_ = false;
+
+    step_();
+
+    uint32_t end = micros();
+    uint32_t duration = end - start;
+    last_duration_us_ = duration;
+    if (duration > max_duration_us_)
+        max_duration_us_ = duration;
+    if (duration >= period_us_) {
+        ++overruns_;
+        late_ = true;
+    }
+    last_end_us_ = end;
+    ++ticks_;
+}
@@ -0,0 +1,64 @@
+#ifndef ControlScheduler_h
+#define ControlScheduler_h
+
+#include "Arduino.h"
+
+/* Fixed-period control step driven by an IntervalTimer (PIT) interrupt.
+*
+* The step runs inside the timer interrupt at a low NVIC priority, so the
+* UART, CAN, USB and systick interrupts still preempt it and millis()/micros()
+* keep working. Anything that blocks for long or talks to ROS belongs in
+* loop(); hand data across with the snapshot helpers in main.cpp.
+*
+* When a step takes longer than the period the PIT has already latched the
+* next tick. That tick is skipped instead of run back to back, so steps stay
+* on the period grid. Only one scheduler can be active at a time.
+*/
+class ControlScheduler {
+public:
+    typedef void (*Step)();
+
+    // Lower NVIC numbers are more urgent; 192 sits below the Teensy core's peripherals
+    explicit ControlScheduler(uint32_t period_us, uint8_t priority = 192);
+
+    bool begin(Step step);
+    void end();
+    // Stop and restart the timer, e.g. while loop() owns the ODrive for calibration; pauses
+    // nest, so a short one inside a background job's long one does not end it early
+    void pause();
+    void resume();
+    bool running() const { return running_; }
+    // A new period, e.g. for StepBenchmark's rate sweep; takes effect at the next tick
+    void setPeriod(uint32_t period_us);
+
+    uint32_t period_us() const { return period_us_; }
+    uint32_t ticks() const { return ticks_; }
+    // Steps that ran longer than the period, and ticks dropped because of them
+    uint32_t overruns() const { return overruns_; }
+    uint32_t skipped() const { return skipped_; }
+    uint32_t lastDuration_us() const { return last_duration_us_; }
+    uint32_t maxDuration_us() const { return max_duration_us_; }
+    // micros() at the end of the last step, e.g. to find the gap before the next
+    uint32_t lastEnd_us() const { return last_end_us_; }
+    void resetStats();
+
+private:
+    static void isr();
+    void tick();
+
+    IntervalTimer timer_;
+    Step step_ = nullptr;
+    uint32_t period_us_;
+    uint8_t priority_;
+    volatile bool running_ = false;
+    volatile uint32_t ticks_ = 0;
+    volatile uint32_t overruns_ = 0;
+    volatile uint32_t skipped_ = 0;
+    volatile uint32_t last_duration_us_ = 0;
+    volatile uint32_t max_duration_us_ = 0;
+    volatile uint32_t last_end_us_ = 0;
+    bool late_ = false;
+    uint8_t paused_ = 0;
+};
+
+#endif //ControlScheduler_h
@@ -0,0 +1,34 @@
+#include "Arduino.h"
+#include "CpuClock.h"
+
+// cores/teensy4/clockspeed.c and tempmon.c
+extern "C" uint32_t set_arm_clock(uint32_t frequency);
+extern "C" float tempmonGetTemp(void);
+
+CpuClock::CpuClock(uint32_t idle_hz, uint32_t nominal_hz, uint32_t boost_hz,
+                   float max_temp_c, float hysteresis_c)
+    : hz_{idle_hz, nominal_hz, boost_hz}, max_temp_c_(max_temp_c), hysteresis_c_(hysteresis_c) {}
+
+bool CpuClock::update() {
+    temperature_c_ = tempmonGetTemp();
+    if (temperature_c_ >= max_temp_c_) throttled_ = true;
+    else if (temperature_c_ < max_temp_c_ - hysteresis_c_) throttled_ = false;
+
+    Mode target = requested_;
+    if (target == BOOST && throttled_) target = NOMINAL;
+    if (target == mode_) return false;
+
+    set_arm_clock(hz_[target]);
+    mode_ = target;
+    ++switches_;
+    return true;
+}
+
+const char* CpuClock::name(Mode mode) {
+    switch (mode) {
+        case IDLE: return "idle";
+        case NOMINAL: return "nominal";
+        case BOOST: return "boost";
+        default: return "?";
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef CpuClock_h
+#define CpuClock_h
+
+#include "Arduino.h"
+
+/* ARM core clock profiles: a reduced clock while nothing needs the cycles
+* (the E-stop), the nominal 600 MHz, and a boosted one for heavier on-board
+* inference, switched with the core's set_arm_clock(), which also moves the
+* core voltage.
+*
+* request() names the mode wanted, from any context. update() switches to it
+* and belongs in loop() at a safe point: during the switch the core runs from
+* the 24 MHz oscillator while the ARM PLL relocks, so it has to land in the
+* gap after a control step, not in one. The PIT, the UARTs, LPI2C and CAN run
+* from clocks of their own and keep their rates; what counts cycles does not,
+* so after a switch the caller hands the new F_CPU_ACTUAL to LoopTiming and
+* the RateTasks and resets the CycleProfiler windows.
+*
+* BOOST is only run while the die is below max_temp_c; above it update()
+* falls back to NOMINAL until the die is hysteresis_c cooler, and throttled()
+* reports it.
+*/
+class CpuClock {
+public:
+    enum Mode : uint8_t { IDLE, NOMINAL, BOOST, NUM_MODES };
+
+    CpuClock(uint32_t idle_hz, uint32_t nominal_hz, uint32_t boost_hz,
+             float max_temp_c, float hysteresis_c = 5.0f);
+
+    void request(Mode mode) { requested_ = mode; }
+    // A switch may be due: another mode requested, or BOOST, which the die can end
+    bool due() const { return requested_ != mode_ || mode_ == BOOST; }
+    // loop(), in the gap after a step: true if the clock changed
+    bool update();
+
+    Mode requested() const { return requested_; }
+    Mode mode() const { return mode_; }
+    uint32_t hz() const { return F_CPU_ACTUAL; }
+    uint32_t hz(Mode mode) const { return hz_[mode]; }
+    // Core cycles in one period_us at the current clock
+    uint32_t budgetCycles(uint32_t period_us) const { return period_us * (F_CPU_ACTUAL / 1000000); }
+    bool throttled() const { return throttled_; }
+    float temperature_c() const { return temperature_c_; }
+    uint32_t switches() const { return switches_; }
+
+    static const char* name(Mode mode);
+
+private:
+    uint32_t hz_[NUM_MODES];
+    float max_temp_c_;
+    float hysteresis_c_;
+    volatile Mode requested_ = NOMINAL;
+    Mode mode_ = NOMINAL;
+    bool throttled_ = false;
+    float temperature_c_ = 0.0f;
+    uint32_t switches_ = 0;
+};
+
+#endif //CpuClock_h
@@ -0,0 +1,58 @@
+#include "Arduino.h"
+#include "CpuLoad.h"
+
+CpuLoad::CpuLoad(uint32_t window_us, uint32_t margin_us)
+    : window_us_(window_us), margin_us_(margin_us) {
+    setClock(F_CPU_ACTUAL);
+}
+
+void CpuLoad::setClock(uint32_t hz) {
+    uint32_t cycles_per_us = hz / 1000000;
+    window_cycles_ = window_us_ * cycles_per_us;
+    margin_cycles_ = margin_us_ * cycles_per_us;
+    // the window across the change mixes two clocks' cycles
+    floor_ = UINT32_MAX;
+    started_ = false;
+    current_ = {};
+}
+
+void CpuLoad::pass() {
+    uint32_t now = ARM_DWT_CYCCNT;
+    uint32_t interrupt = interrupt_cycles_;
+    if (!started_) {
+        started_ = true;
+        last_cycles_ = now;
+        last_interrupt_ = interrupt;
+        return;
+    }
+    uint32_t elapsed = now - last_cycles_;
+    uint32_t preempted = interrupt - last_interrupt_;
+    last_cycles_ = now;
+    last_interrupt_ = interrupt;
+    if (preempted > elapsed) preempted = elapsed;
+    uint32_t own = elapsed - preempted;
+
+    if (own < floor_) floor_ = own;
+    current_.cycles += elapsed;
+    current_.interrupt_cycles += preempted;
+    ++current_.passes;
+    if (own <= floor_ + margin_cycles_) {
+        current_.idle_cycles += own;
+        ++current_.idle_passes;
+    } else {
+        current_.work_cycles += own;
+    }
+
+    if (current_.cycles >= window_cycles_) {
+        current_.floor_cycles = floor_;
+        last_ = current_;
+        current_ = {};
+    }
+}
+
+bool CpuLoad::allows(uint16_t max_permille) {
+    if (loadPermille() <= max_permille)
+        return true;
+    ++deferred_;
+    return false;
+}
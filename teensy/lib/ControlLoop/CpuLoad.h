@@ -0,0 +1,85 @@
+#ifndef CpuLoad_h
+#define CpuLoad_h
+
+#include "Arduino.h"
+
+/* How busy the core is: the share of each window spent in the control step,
+* in loop() passes that did something, and in passes that only polled,
+* measured with the DWT cycle counter.
+*
+* pass() is called once at the end of every loop() pass and the control step
+* charges its own cycles through a CpuLoadScope, so a pass's own time is
+* the time since the previous pass less the steps that preempted it. The
+* cheapest pass seen since the last clock change is what polling costs; a
+* pass within margin_us of it did no work and counts as idle, everything
+* else is load. Other interrupts (UART, CAN, USB) land in the pass they
+* preempted.
+*
+* A window closes in pass() once window_us have gone by, so load() is always
+* the last whole window's, published or not. allows() is the check for
+* optional background work: it answers from that window and counts the
+* passes it turned away.
+*/
+class CpuLoad {
+public:
+    struct Window {
+        uint32_t cycles;            // the window's length
+        uint32_t interrupt_cycles;  // in the control step
+        uint32_t work_cycles;       // in loop() passes that did something
+        uint32_t idle_cycles;       // in loop() passes that only polled
+        uint32_t passes, idle_passes;
+        uint32_t floor_cycles;      // the cheapest pass, the polling cost
+    };
+
+    CpuLoad(uint32_t window_us = 1000000, uint32_t margin_us = 5);
+
+    // The control step's cycles, from the interrupt
+    inline void chargeInterrupt(uint32_t cycles) { interrupt_cycles_ += cycles; }
+    void pass();
+    // The cycle counter's rate after a CPU clock change; the polling cost is measured over again
+    void setClock(uint32_t hz);
+
+    // The last whole window, all zero before the first
+    const Window& last() const { return last_; }
+    // Of the last window in per mille: everything but the idle passes, and parts of it
+    uint16_t loadPermille() const { return permille(last_.cycles - last_.idle_cycles); }
+    uint16_t interruptPermille() const { return permille(last_.interrupt_cycles); }
+    uint16_t workPermille() const { return permille(last_.work_cycles); }
+    // Whether optional work may run in this pass: the last window no busier than max_permille
+    bool allows(uint16_t max_permille);
+    uint32_t deferred() const { return deferred_; }
+
+private:
+    uint16_t permille(uint32_t cycles) const {
+        return last_.cycles ? (uint16_t)((uint64_t)cycles * 1000 / last_.cycles) : 0;
+    }
+
+    uint32_t window_us_;
+    uint32_t margin_us_;
+    uint32_t window_cycles_;
+    uint32_t margin_cycles_;
+    volatile uint32_t interrupt_cycles_ = 0;
+    bool started_ = false;
+    uint32_t last_cycles_ = 0;
+    uint32_t last_interrupt_ = 0;
+    uint32_t floor_ = UINT32_MAX;
+    uint32_t deferred_ = 0;
+    Window current_ = {};
+    Window last_ = {};
+};
+
+// Charges the enclosing scope to CpuLoad as control step time
+class CpuLoadScope {
+public:
+    explicit CpuLoadScope(CpuLoad& load) : load_(load), start_(ARM_DWT_CYCCNT) {}
+    ~CpuLoadScope() { load_.chargeInterrupt(ARM_DWT_CYCCNT - start_); }
+
+    CpuLoadScope(const CpuLoadScope&) = delete;
+    CpuLoadScope& operator=(const CpuLoadScope&) = delete;
+
+private:
+    CpuLoad& load_;
+    uint32_t start_;
+};
+
+#endif //CpuLoad_h
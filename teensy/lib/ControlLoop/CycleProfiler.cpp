@@ -0,0 +1,76 @@
+
+#include "Arduino.h"
+#include "CycleProfiler.h"
+
+CycleProfiler::CycleProfiler(const char* const* names, uint8_t count)
+    : names_(names), count_(count < max_sections ? count : max_sections) {
+    reset();
+}
+
+void CycleProfiler::begin() {
+#if defined(ARM_DWT_CTRL_CYCCNTENA)
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+bool CycleProfiler::snapshot(uint8_t section, Stats& stats, bool reset) {
+    if (section >= count_)
+        return false;
+    Section& s = sections_[section];
+
+    noInterrupts();
+    stats.count = s.count;
+    uint64_t total = s.total;
+    uint32_t min = s.min, max = s.max;
+    // walk the histogram from the top until 1% of the samples are above the bin
+    uint32_t tail = s.count / 100, above = 0;
+    uint8_t p99_bin = 0;
+    for (int bin = num_bins - 1; bin >= 0; --bin) {
+        above += s.bins[bin];
+        if (above > tail) {
+            p99_bin = bin;
+            break;
+        }
+    }
+    if (reset)
+        clear(s);
+    interrupts();
+
+    if (stats.count == 0) {
+        stats.min_us = stats.mean_us = stats.max_us = stats.p99_us = 0.0f;
+        return true;
+    }
+    stats.min_us = toMicros(min);
+    stats.max_us = toMicros(max);
+    stats.mean_us = toMicros(total / stats.count);
+    uint32_t p99 = binUpperEdge(p99_bin);
+    stats.p99_us = toMicros(p99 < max ? p99 : max);
+    return true;
+}
+
+void CycleProfiler::reset() {
+    for (uint8_t i = 0; i < max_sections; ++i) {
+        noInterrupts();
+        clear(sections_[i]);
+        interrupts();
+    }
+}
+
+// Inverse of binOf(): the largest cycle count that still falls in the bin
+uint32_t CycleProfiler::binUpperEdge(uint8_t bin) {
+    if (bin < 4) return bin;
+    uint8_t octave = bin / 4 + 1;
+    uint32_t sub = bin % 4;
+    uint64_t lower = (uint64_t)(4 + sub) << (octave - 2);
+    uint64_t upper = lower + ((uint64_t)1 << (octave - 2)) - 1;
+    return upper > UINT32_MAX ? UINT32_MAX : (uint32_t)upper;
+}
+
+void CycleProfiler::clear(Section& s) {
+    s.count = 0;
+    s.total = 0;
+    s.min = UINT32_MAX;
+    s.max = 0;
+    memset(s.bins, 0, sizeof(s.bins));
+}
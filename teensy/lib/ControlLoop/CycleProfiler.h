@@ -0,0 +1,86 @@
+#ifndef CycleProfiler_h
+#define CycleProfiler_h
+
+#include "Arduino.h"
+
+/* Per-section timing from the Cortex-M7 DWT cycle counter (ARM_DWT_CYCCNT).
+*
+* Each section keeps count/total/min/max and a log histogram with four bins
+* per octave, so p99 is accurate to about 20%. Recording is a couple of loads,
+* a clz and an increment, cheap enough to leave on in production runs.
+*
+* Sections are recorded from whichever context runs them (the control
+* interrupt or loop()); snapshot() copies a section with interrupts off and
+* can reset it, so statistics cover one publish window.
+*/
+class CycleProfiler {
+public:
+    static constexpr uint8_t max_sections = 12;
+    static constexpr uint8_t num_bins = 128;
+
+    struct Stats {
+        uint32_t count;
+        float min_us, mean_us, max_us, p99_us;
+    };
+
+    CycleProfiler(const char* const* names, uint8_t count);
+
+    // Enables the cycle counter if the core has not done so already
+    void begin();
+
+    void record(uint8_t section, uint32_t cycles) {
+        Section& s = sections_[section];
+        ++s.count;
+        s.total += cycles;
+        if (cycles < s.min) s.min = cycles;
+        if (cycles > s.max) s.max = cycles;
+        ++s.bins[binOf(cycles)];
+    }
+
+    bool snapshot(uint8_t section, Stats& stats, bool reset = true);
+    void reset();
+
+    uint8_t count() const { return count_; }
+    const char* name(uint8_t section) const { return names_[section]; }
+
+    static uint32_t now() { return ARM_DWT_CYCCNT; }
+    static float toMicros(uint32_t cycles) { return cycles * (1e6f / F_CPU_ACTUAL); }
+
+private:
+    struct Section {
+        uint32_t count;
+        uint64_t total;
+        uint32_t min, max;
+        uint32_t bins[num_bins];
+    };
+
+    static uint8_t binOf(uint32_t cycles) {
+        if (cycles < 4) return cycles;
+        uint8_t octave = 31 - __builtin_clz(cycles);
+        return (octave - 1) * 4 + ((cycles >> (octave - 2)) & 3);
+    }
+    static uint32_t binUpperEdge(uint8_t bin);
+    static void clear(Section& s);
+
+    const char* const* names_;
+    uint8_t count_;
+    Section sections_[max_sections];
+};
+
+// Times the enclosing scope into one profiler section
+class ProfileScope {
+public:
+    ProfileScope(CycleProfiler& profiler, uint8_t section)
+        : profiler_(profiler), section_(section), start_(CycleProfiler::now()) {}
+    ~ProfileScope() { profiler_.record(section_, CycleProfiler::now() - start_); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    CycleProfiler& profiler_;
+    uint8_t section_;
+    uint32_t start_;
+};
+
+#endif //CycleProfiler_h
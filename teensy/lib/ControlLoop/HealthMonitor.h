@@ -0,0 +1,147 @@
+#ifndef HealthMonitor_h
+#define HealthMonitor_h
+
+#include <stdint.h>
+#include <string.h>
+#include "FlightLogFormat.h"
+
+/* The firmware's performance counters of the last second in one place: the
+* control step's stages, loop timing, CPU load, link queues, bus use,
+* command latency and the ODrive's errors, as one FlightHealthRecord.
+*
+* The counters already have publishers, each taking its own window and most
+* resetting it. So the summary takes none: each publisher hands the figures
+* of the window it just took to the matching call below, with its status
+* through level(), and take() closes the summary's window. Figures from a
+* publisher that did not run in the window are left out of sources and
+* zero. Totals that only grow (link drops, overruns) are handed in as they
+* are and turned into the window's increase here.
+*
+*     health.step(stats.mean_us, stats.p99_us, stats.max_us);   // publishProfile()
+*     health.level(status.level, status.name);
+*     FlightHealthRecord record;
+*     health.take(record);                                       // once a second
+*
+* Everything is for loop() only; no Arduino headers, so the host reads the
+* record the same way.
+*/
+class HealthMonitor {
+public:
+    // diagnostic_msgs::DiagnosticStatus levels
+    enum Level : uint8_t { OK = 0, WARN = 1, ERROR = 2 };
+
+    void step(float mean_us, float p99_us, float max_us) {
+        record_.step_mean_dus = saturate(mean_us * 10.0f);
+        record_.step_p99_dus = saturate(p99_us * 10.0f);
+        record_.step_max_dus = saturate(max_us * 10.0f);
+        record_.sources |= FlightHealthRecord::STEP;
+    }
+    void imu(float max_us) { record_.imu_max_us = saturate(max_us); }
+    // the ODrive exchange, what a step waits on the ODrive
+    void encoder(float p99_us, float max_us) {
+        record_.encoder_p99_us = saturate(p99_us);
+        record_.encoder_max_us = saturate(max_us);
+    }
+    void loop(uint32_t samples, uint32_t misses, uint32_t min_period_us, uint32_t max_period_us,
+              uint32_t mean_latency_us, uint32_t max_latency_us) {
+        record_.misses = saturate(misses);
+        record_.jitter_us = samples > 1 ? saturate(max_period_us - min_period_us) : 0;
+        record_.latency_mean_us = saturate(mean_latency_us);
+        record_.latency_max_us = saturate(max_latency_us);
+        record_.sources |= FlightHealthRecord::LOOP;
+    }
+    void cpu(uint16_t load_permille, uint16_t control_permille) {
+        record_.load_permille = load_permille;
+        record_.control_permille = control_permille;
+        record_.sources |= FlightHealthRecord::CPU;
+    }
+    // frames queued now, and the drop totals since boot
+    void link(uint32_t status_depth, uint32_t telemetry_depth, uint32_t dropped, uint32_t sensor_dropped) {
+        record_.queue_depth[0] = status_depth > 255 ? 255 : (uint8_t)status_depth;
+        record_.queue_depth[1] = telemetry_depth > 255 ? 255 : (uint8_t)telemetry_depth;
+        record_.link_dropped = saturate(dropped - link_dropped_);
+        record_.sensor_dropped = saturate(sensor_dropped - sensor_dropped_);
+        link_dropped_ = dropped;
+        sensor_dropped_ = sensor_dropped;
+        record_.sources |= FlightHealthRecord::LINK;
+    }
+    // bus 0 Wire, 1 Wire1
+    void bus(uint8_t index, uint16_t max_permille) {
+        if (index > 1) return;
+        record_.bus_max_permille[index] = max_permille;
+        record_.sources |= FlightHealthRecord::I2C;
+    }
+    void command(uint32_t p50_us, uint32_t p99_us, uint32_t lost) {
+        record_.command_p50_us = saturate(p50_us);
+        record_.command_p99_us = saturate(p99_us);
+        record_.command_lost = saturate(lost);
+        record_.sources |= FlightHealthRecord::COMMAND;
+    }
+    // bit i: ODriveErrorMonitor register i is non-zero; kept until it changes. The record has
+    // the first eight, as FlightRecord::errors
+    void odrive(uint16_t error_bits) {
+        odrive_errors_ = error_bits;
+        odrive_seen_ = true;
+    }
+    // ControlScheduler's total
+    void overruns(uint32_t total) {
+        record_.overruns = saturate(total - overruns_);
+        overruns_ = total;
+    }
+    // one job's slices over budget in its window; the jobs add up
+    void background(uint32_t over_slice) {
+        record_.over_slice = saturate(record_.over_slice + over_slice);
+        record_.sources |= FlightHealthRecord::BACKGROUND;
+    }
+    void memory(uint32_t stack_used) {
+        record_.stack_used = stack_used;
+        record_.sources |= FlightHealthRecord::MEMORY;
+    }
+
+    // A publisher's status; the window keeps the worst and the first to reach it
+    void level(uint8_t level, const char* name) {
+        if (level > level_) {
+            level_ = level;
+            worst_ = name;
+        }
+    }
+
+    // Close the window into out, stamp and marker left to the recorder, and start the next
+    void take(FlightHealthRecord& out) {
+        if (odrive_seen_) {
+            record_.odrive_errors = (uint8_t)odrive_errors_;
+            record_.sources |= FlightHealthRecord::ODRIVE;
+            if (odrive_errors_) level(WARN, "odrive_errors");
+        }
+        // loop timing goes out as an array, and no status reports an overrun as it happens
+        if (record_.misses) level(WARN, "loop_timing");
+        if (record_.overruns) level(WARN, "overruns");
+        record_.level = level_;
+        out = record_;
+        last_level_ = level_;
+        last_worst_ = worst_;
+        memset(&record_, 0, sizeof(record_));
+        level_ = OK;
+        worst_ = "";
+    }
+
+    // Of the window take() closed last: its level, and the status that set it ("" for OK)
+    uint8_t lastLevel() const { return last_level_; }
+    const char* lastWorst() const { return last_worst_; }
+
+private:
+    static uint16_t saturate(float v) { return v <= 0.0f ? 0 : v >= 65535.0f ? 65535 : (uint16_t)(v + 0.5f); }
+    static uint16_t saturate(uint32_t v) { return v > 65535 ? 65535 : (uint16_t)v; }
+
+    FlightHealthRecord record_ = {};
+    uint8_t level_ = OK;
+    const char* worst_ = "";
+    uint8_t last_level_ = OK;
+    const char* last_worst_ = "";
+    uint32_t link_dropped_ = 0, sensor_dropped_ = 0;
+    uint32_t overruns_ = 0;
+    uint16_t odrive_errors_ = 0;
+    bool odrive_seen_ = false;
+};
+
+#endif //HealthMonitor_h
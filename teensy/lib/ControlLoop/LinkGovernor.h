@@ -0,0 +1,122 @@
+#ifndef LinkGovernor_h
+#define LinkGovernor_h
+
+#include <stdint.h>
+
+/* Steps the firmware down through degraded modes as the link to the Pi
+* falls behind, and back up once it has kept up for a while, so an
+* overloaded link sheds load first and ends in the brake, never in a
+* torque computed from a sample long gone.
+*
+*     NORMAL    everything as built
+*     REDUCED   telemetry cut to one second in the firmware's divider
+*     QUIET     and no debug text onto the shared USB port
+*     FALLBACK  and the Pi's torque replaced by the on-board fallback
+*     BRAKE     and the motors braked, as under the E-stop
+*
+* update() runs in the control step with three measures of the link:
+*  - command_age_us, since the newest /torso_command arrived,
+*  - round_trip_us, from the sample the newest command was computed from
+*    to its arrival, 0 where the controller does not echo the seq,
+*  - backlog_bytes, rosserial's unread input and the output still queued.
+* A round trip or backlog over its reduce or quiet threshold asks for that
+* mode; a command older than fallback_us, or one computed from a sample
+* more than fallback_us old, asks for FALLBACK. A worse mode is taken at
+* once. FALLBACK held for brake_after_us without the commands coming back
+* becomes BRAKE. Back up is one mode at a time, each after recover_us in
+* which nothing asked for the mode or a worse one.
+*
+* Every change is counted; last() is the newest, with the measure that
+* caused it, for loop() to log (copy it with interrupts off). Before the
+* first command the age is not held against the link: nothing was sent.
+*/
+class LinkGovernor {
+public:
+    enum Mode : uint8_t { NORMAL, REDUCED, QUIET, FALLBACK, BRAKE, NUM_MODES };
+    enum Reason : uint8_t { RECOVERED, BACKLOG, ROUND_TRIP, STALE_COMMAND, HELD_FALLBACK };
+
+    struct Config {
+        uint32_t reduce_round_trip_us, quiet_round_trip_us;
+        uint32_t reduce_backlog_bytes, quiet_backlog_bytes;
+        uint32_t fallback_us;
+        uint32_t brake_after_us;
+        uint32_t recover_us;
+    };
+
+    struct Transition {
+        uint32_t stamp_us;
+        uint8_t from, to;
+        uint8_t reason;
+        uint32_t value;         // the measure: us, bytes, or the time held
+    };
+
+    explicit LinkGovernor(const Config& config) : config_(config) {}
+
+    // From the control step; true when the mode changed
+    bool update(uint32_t now_us, uint32_t command_age_us, uint32_t round_trip_us, uint32_t backlog_bytes) {
+        uint8_t reason = RECOVERED;
+        uint32_t value = 0;
+        uint8_t wanted = NORMAL;
+        auto ask = [&](uint8_t mode, uint8_t why, uint32_t measure) {
+            if (mode > wanted) {
+                wanted = mode;
+                reason = why;
+                value = measure;
+            }
+        };
+        if (backlog_bytes >= config_.quiet_backlog_bytes) ask(QUIET, BACKLOG, backlog_bytes);
+        else if (backlog_bytes >= config_.reduce_backlog_bytes) ask(REDUCED, BACKLOG, backlog_bytes);
+        if (round_trip_us >= config_.quiet_round_trip_us) ask(QUIET, ROUND_TRIP, round_trip_us);
+        else if (round_trip_us >= config_.reduce_round_trip_us) ask(REDUCED, ROUND_TRIP, round_trip_us);
+        bool commanded = command_age_us != UINT32_MAX;
+        if (commanded && command_age_us > config_.fallback_us) ask(FALLBACK, STALE_COMMAND, command_age_us);
+        if (commanded && round_trip_us > config_.fallback_us) ask(FALLBACK, ROUND_TRIP, round_trip_us);
+
+        if (mode_ == FALLBACK && wanted == FALLBACK && now_us - since_us_ >= config_.brake_after_us)
+            return change(BRAKE, HELD_FALLBACK, now_us - since_us_, now_us);
+        if (mode_ == BRAKE && wanted == FALLBACK)
+            wanted = BRAKE;     // the brake holds until the commands are back
+        if (wanted > mode_)
+            return change(wanted, reason, value, now_us);
+        if (wanted == mode_) {
+            calm_us_ = now_us;
+            return false;
+        }
+        if (now_us - calm_us_ < config_.recover_us)
+            return false;
+        return change(mode_ - 1, RECOVERED, now_us - calm_us_, now_us);
+    }
+
+    Mode mode() const { return (Mode)mode_; }
+    // Since the mode was entered
+    uint32_t held_us(uint32_t now_us) const { return now_us - since_us_; }
+    uint32_t transitions() const { return transitions_; }
+    const Transition& last() const { return last_; }
+
+    static const char* name(uint8_t mode) {
+        static const char* const names[NUM_MODES] = {"normal", "reduced", "quiet", "fallback", "brake"};
+        return mode < NUM_MODES ? names[mode] : "?";
+    }
+    static const char* reasonName(uint8_t reason) {
+        static const char* const names[] = {"recovered", "backlog", "round_trip", "stale_command", "held_fallback"};
+        return reason <= HELD_FALLBACK ? names[reason] : "?";
+    }
+
+private:
+    bool change(uint8_t to, uint8_t reason, uint32_t value, uint32_t now_us) {
+        last_ = {now_us, mode_, to, reason, value};
+        mode_ = to;
+        since_us_ = calm_us_ = now_us;
+        transitions_ = transitions_ + 1;
+        return true;
+    }
+
+    Config config_;
+    volatile uint8_t mode_ = NORMAL;
+    uint32_t since_us_ = 0;
+    uint32_t calm_us_ = 0;
+    volatile uint32_t transitions_ = 0;
+    Transition last_ = {0, NORMAL, NORMAL, RECOVERED, 0};
+};
+
+#endif //LinkGovernor_h
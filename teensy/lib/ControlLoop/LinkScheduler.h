@@ -0,0 +1,121 @@
+#ifndef LinkScheduler_h
+#define LinkScheduler_h
+
+#include "Arduino.h"
+
+/* Outgoing rosserial frames by priority, so bulk telemetry never takes the
+* link from the control-critical ones.
+*
+* The critical frames (/sensors and the clock pong) keep the direct path,
+* publishFixed(), which drops a frame rather than wait for the transmit
+* buffer. Everything else is framed once into its class's byte queue by
+* enqueue(), in priority order 0 (the first drained) to Classes-1, and
+* service() in loop() writes the frames out oldest first, highest class
+* first, but only while
+*
+*     - the class has the bytes in its budget, a token bucket of rate bytes
+*       a second up to burst bytes, so one class cannot fill the link, and
+*     - the transmit buffer keeps reserve bytes free after the frame, the
+*       room the next critical frame needs.
+*
+* A frame that does not fit its queue is dropped and counted; depth(),
+* maxUsedBytes() and dropped() per class are what the link diagnostics report.
+* Nothing here waits and nothing allocates; loop() is the only caller.
+*/
+template<uint8_t Classes, uint16_t QueueBytes>
+class LinkScheduler {
+public:
+    struct Budget {
+        uint32_t rate;  // bytes/s; 0 for no limit
+        uint32_t burst; // bytes, at least the largest frame of the class
+    };
+
+    LinkScheduler(const Budget (&budgets)[Classes], uint16_t reserve) : reserve_(reserve) {
+        for (uint8_t c = 0; c < Classes; ++c) {
+            queues_[c].budget = budgets[c];
+            queues_[c].tokens = budgets[c].burst;
+        }
+    }
+
+    // A whole frame into class c's queue; false, and counted, if it has no room
+    bool enqueue(uint8_t c, const uint8_t* frame, uint16_t length) {
+        Queue& q = queues_[c];
+        if (length == 0 || length + 2u > (uint32_t)(QueueBytes - q.used)) {
+            ++q.dropped;
+            return false;
+        }
+        put(q, (uint8_t)(length & 0xff));
+        put(q, (uint8_t)(length >> 8));
+        for (uint16_t i = 0; i < length; ++i) put(q, frame[i]);
+        ++q.frames;
+        if (q.used > q.max_used) q.max_used = q.used;
+        return true;
+    }
+
+    // Writes what the budgets and the link allow; returns the frames sent
+    template<class Link>
+    uint32_t service(Link& link, uint32_t now_us) {
+        uint32_t dt = now_us - last_us_;
+        last_us_ = now_us;
+        uint32_t sent = 0;
+        for (uint8_t c = 0; c < Classes; ++c) {
+            Queue& q = queues_[c];
+            if (q.budget.rate > 0) {
+                uint64_t tokens = q.tokens + (uint64_t)q.budget.rate*dt/1000000u;
+                q.tokens = tokens > q.budget.burst ? q.budget.burst : (uint32_t)tokens;
+            }
+            while (q.frames > 0) {
+                uint16_t length = peekLength(q);
+                if (q.budget.rate > 0 && q.tokens < length) break;
+                if (link.availableForWrite() < (int)length + reserve_) return sent;
+                // the frame may wrap, then it goes out in two writes
+                uint16_t start = (uint16_t)((q.head + 2) % QueueBytes);
+                uint16_t first = QueueBytes - start < length ? QueueBytes - start : length;
+                link.write(q.bytes + start, first);
+                if (first < length) link.write(q.bytes, length - first);
+                q.head = (uint16_t)((start + length) % QueueBytes);
+                q.used -= length + 2;
+                --q.frames;
+                if (q.budget.rate > 0) q.tokens -= length;
+                q.sent_bytes += length;
+                ++sent;
+            }
+        }
+        return sent;
+    }
+
+    uint16_t depth(uint8_t c) const { return queues_[c].frames; }
+    uint16_t usedBytes(uint8_t c) const { return queues_[c].used; }
+    uint16_t maxUsedBytes(uint8_t c) const { return queues_[c].max_used; }
+    uint32_t dropped(uint8_t c) const { return queues_[c].dropped; }
+    uint32_t sentBytes(uint8_t c) const { return queues_[c].sent_bytes; }
+    uint16_t reserve() const { return reserve_; }
+
+private:
+    struct Queue {
+        Budget budget;
+        uint32_t tokens;
+        uint8_t bytes[QueueBytes];
+        uint16_t head = 0; // the oldest frame's length bytes
+        uint16_t used = 0;
+        uint16_t max_used = 0;
+        uint16_t frames = 0;
+        uint32_t dropped = 0;
+        uint32_t sent_bytes = 0;
+    };
+
+    static void put(Queue& q, uint8_t b) {
+        q.bytes[(q.head + q.used) % QueueBytes] = b;
+        ++q.used;
+    }
+
+    static uint16_t peekLength(const Queue& q) {
+        return q.bytes[q.head] | (uint16_t)q.bytes[(q.head + 1) % QueueBytes] << 8;
+    }
+
+    Queue queues_[Classes];
+    uint16_t reserve_;
+    uint32_t last_us_ = 0;
+};
+
+#endif //LinkScheduler_h
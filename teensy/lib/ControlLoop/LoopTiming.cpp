@@ -0,0 +1,68 @@
+
+#include "Arduino.h"
+#include "LoopTiming.h"
+#include "Placement.h"
+
+LoopTiming::LoopTiming(uint32_t period_us, uint32_t bin_us, uint32_t tolerance_us)
+    : period_us_(period_us), bin_us_(bin_us), tolerance_us_(tolerance_us),
+      cycles_per_us_(F_CPU_ACTUAL / 1000000) {
+    clear();
+}
+
+HOT_CODE void LoopTiming::markSample() {
+    uint32_t now = ARM_DWT_CYCCNT;
+    if (!have_last_) {
+        have_last_ = true;
+        last_sample_cycles_ = now;
+        return;
+    }
+    uint32_t period = (now - last_sample_cycles_) / cycles_per_us_;
+    last_sample_cycles_ = now;
+    last_period_us_ = period;
+
+    ++window_.samples;
+    if (period < window_.min_period_us) window_.min_period_us = period;
+    if (period > window_.max_period_us) window_.max_period_us = period;
+    if (period > period_us_ + tolerance_us_) {
+        ++window_.misses;
+        ++total_misses_;
+    }
+
+    int32_t bin = ((int32_t)period - firstBin_us()) / (int32_t)bin_us_;
+    if (bin < 0) bin = 0;
+    if (bin >= num_bins) bin = num_bins - 1;
+    ++window_.bins[bin];
+}
+
+HOT_CODE void LoopTiming::markActuate() {
+    uint32_t latency = (ARM_DWT_CYCCNT - sense_cycles_) / cycles_per_us_;
+    last_latency_us_ = latency;
+    if (latency > window_.max_latency_us) window_.max_latency_us = latency;
+    latency_total_us_ += latency;
+    ++latency_count_;
+}
+
+void LoopTiming::snapshot(Window& window) {
+    noInterrupts();
+    window = window_;
+    window.mean_latency_us = latency_count_ ? latency_total_us_ / latency_count_ : 0;
+    clear();
+    interrupts();
+    if (window.samples == 0)
+        window.min_period_us = 0;
+}
+
+void LoopTiming::setPeriod(uint32_t period_us) {
+    noInterrupts();
+    period_us_ = period_us;
+    have_last_ = false;
+    clear();
+    interrupts();
+}
+
+void LoopTiming::clear() {
+    memset(&window_, 0, sizeof(window_));
+    window_.min_period_us = UINT32_MAX;
+    latency_total_us_ = 0;
+    latency_count_ = 0;
+}
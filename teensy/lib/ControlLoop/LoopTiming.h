@@ -0,0 +1,72 @@
+#ifndef LoopTiming_h
+#define LoopTiming_h
+
+#include "Arduino.h"
+
+/* Inter-sample period, deadline misses and sense-to-actuate latency of the
+* control loop, measured with the DWT cycle counter.
+*
+* markSample() is called at the start of every control step, markSense() right
+* before the IMU is read and markActuate() once the torque has been written.
+* The period histogram has num_bins bins of bin_us around the nominal period;
+* the first and last bins also collect everything beyond them. A deadline
+* miss is a period longer than nominal + tolerance_us.
+*
+* Statistics are per window: snapshot() copies them with interrupts off and
+* starts a new window.
+*/
+class LoopTiming {
+public:
+    static constexpr uint8_t num_bins = 16;
+
+    struct Window {
+        uint32_t samples;
+        uint32_t misses;
+        uint32_t min_period_us, max_period_us;
+        uint32_t max_latency_us, mean_latency_us;
+        uint32_t bins[num_bins];
+    };
+
+    LoopTiming(uint32_t period_us, uint32_t bin_us = 20, uint32_t tolerance_us = 500);
+
+    void markSample();
+    void markSense() { sense_cycles_ = ARM_DWT_CYCCNT; }
+    void markActuate();
+    // Forget the previous sample, e.g. after the scheduler was paused
+    void restart() { have_last_ = false; }
+    // The cycle counter's rate after a CPU clock change; the period across it is dropped
+    void setClock(uint32_t hz) { cycles_per_us_ = hz / 1000000; have_last_ = false; }
+    // A new nominal period, the scheduler's; starts a new window and drops the period across it
+    void setPeriod(uint32_t period_us);
+
+    void snapshot(Window& window);
+
+    uint32_t period_us() const { return period_us_; }
+    uint32_t bin_us() const { return bin_us_; }
+    // Lower edge of bin 0 in microseconds
+    int32_t firstBin_us() const { return (int32_t)period_us_ - (int32_t)(bin_us_ * num_bins / 2); }
+    uint32_t totalMisses() const { return total_misses_; }
+    // The most recent tick, e.g. for a per-tick log
+    uint32_t lastPeriod_us() const { return last_period_us_; }
+    uint32_t lastLatency_us() const { return last_latency_us_; }
+
+private:
+    void clear();
+
+    uint32_t period_us_;
+    uint32_t bin_us_;
+    uint32_t tolerance_us_;
+    uint32_t cycles_per_us_;
+
+    uint32_t last_sample_cycles_ = 0;
+    volatile bool have_last_ = false;
+    uint32_t sense_cycles_ = 0;
+    uint64_t latency_total_us_ = 0;
+    uint32_t latency_count_ = 0;
+    volatile uint32_t total_misses_ = 0;
+    uint32_t last_period_us_ = 0;
+    uint32_t last_latency_us_ = 0;
+    Window window_;
+};
+
+#endif //LoopTiming_h
@@ -0,0 +1,119 @@
+#include "Arduino.h"
+#include "MemoryBudget.h"
+#include "Placement.h"
+#include <malloc.h>
+#include <reent.h>
+
+// imxrt1062.ld; _itcm_block_count is a value, its address
+extern "C" {
+    extern unsigned long _stext, _etext, _sdata, _edata, _sbss, _ebss, _estack;
+    extern unsigned long _heap_start, _heap_end, _itcm_block_count;
+    extern char* __brkval;
+}
+
+static constexpr uint32_t ram2_origin = 0x20200000;
+static constexpr uint32_t flexram_block = 32768;
+
+static volatile bool armed = false;
+static MemoryBudget::Allocations counts = {};
+
+COLD_CODE void MemoryBudget::layout(Layout& out) {
+    out.itcm_code = (uint32_t)&_etext - (uint32_t)&_stext;
+    out.itcm_size = (uint32_t)&_itcm_block_count * flexram_block;
+    out.dtcm_data = (uint32_t)&_edata - (uint32_t)&_sdata;
+    out.dtcm_bss = (uint32_t)&_ebss - (uint32_t)&_sbss;
+    out.stack_size = (uint32_t)&_estack - (uint32_t)&_ebss;
+    out.ram2_dma = (uint32_t)&_heap_start - ram2_origin;
+    out.heap_size = (uint32_t)&_heap_end - (uint32_t)&_heap_start;
+}
+
+// Stops short of its own frame, a few calls deep at the top of setup()
+COLD_CODE __attribute__((noinline)) void MemoryBudget::paintStack() {
+    uint32_t* sp;
+    __asm__ volatile("mov %0, sp" : "=r"(sp));
+    for (uint32_t* p = (uint32_t*)&_ebss; p < sp - 64; ++p) *p = stack_paint;
+}
+
+uint32_t MemoryBudget::stackUsed() {
+    const uint32_t* p = (const uint32_t*)&_ebss;
+    const uint32_t* top = (const uint32_t*)&_estack;
+    while (p < top && *p == stack_paint) ++p;
+    return (uint32_t)(top - p) * 4;
+}
+
+uint32_t MemoryBudget::heapUsed() {
+    return mallinfo().uordblks;
+}
+
+uint32_t MemoryBudget::heapFree() {
+    return (uint32_t)&_heap_end - (uint32_t)__brkval;
+}
+
+void MemoryBudget::arm() {
+    armed = true;
+}
+
+bool MemoryBudget::guarded() {
+#if defined(HEAP_GUARD)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MemoryBudget::allocations(Allocations& out) {
+    noInterrupts();
+    out = counts;
+    interrupts();
+}
+
+void MemoryBudget::allocated(size_t size, void* caller) {
+    ++counts.total;
+    if (!armed) return;
+#if defined(HEAP_GUARD_TRAP)
+    __builtin_trap();
+#endif
+    uint32_t ipsr;
+    __asm__ volatile("mrs %0, ipsr" : "=r"(ipsr));
+    if (counts.after_arm == 0) counts.first_caller = (uint32_t)caller;
+    ++counts.after_arm;
+    if (ipsr != 0) ++counts.interrupt;
+    counts.bytes_after_arm += size;
+}
+
+#if defined(HEAP_GUARD)
+// -Wl,--wrap for all six in the env's build_flags. The public three go
+// straight to the reentrant allocator, so one allocation is counted once
+// with the return address into its caller, and newlib's own calls (printf's
+// dtoa buffers, ...) are caught on the reentrant three.
+extern "C" {
+    void* __real__malloc_r(struct _reent* r, size_t size);
+    void* __real__calloc_r(struct _reent* r, size_t n, size_t size);
+    void* __real__realloc_r(struct _reent* r, void* p, size_t size);
+
+    void* __wrap_malloc(size_t size) {
+        MemoryBudget::allocated(size, __builtin_return_address(0));
+        return __real__malloc_r(_REENT, size);
+    }
+    void* __wrap_calloc(size_t n, size_t size) {
+        MemoryBudget::allocated(n*size, __builtin_return_address(0));
+        return __real__calloc_r(_REENT, n, size);
+    }
+    void* __wrap_realloc(void* p, size_t size) {
+        MemoryBudget::allocated(size, __builtin_return_address(0));
+        return __real__realloc_r(_REENT, p, size);
+    }
+    void* __wrap__malloc_r(struct _reent* r, size_t size) {
+        MemoryBudget::allocated(size, __builtin_return_address(0));
+        return __real__malloc_r(r, size);
+    }
+    void* __wrap__calloc_r(struct _reent* r, size_t n, size_t size) {
+        MemoryBudget::allocated(n*size, __builtin_return_address(0));
+        return __real__calloc_r(r, n, size);
+    }
+    void* __wrap__realloc_r(struct _reent* r, void* p, size_t size) {
+        MemoryBudget::allocated(size, __builtin_return_address(0));
+        return __real__realloc_r(r, p, size);
+    }
+}
+#endif
@@ -0,0 +1,67 @@
+#ifndef MemoryBudget_h
+#define MemoryBudget_h
+
+#include "Arduino.h"
+
+/* Where the firmware's RAM goes on the Teensy 4.0, read at run time from the
+* linker's symbols, and a guard on the heap.
+*
+* RAM1 is the 512 KiB FlexRAM, tightly coupled: ITCM holds the code that is
+* not FLASHMEM in 32 KiB blocks, DTCM the rest, .data and .bss from the
+* bottom and the one stack, shared by loop() and every interrupt, from the
+* top. RAM2 (OCRAM) holds the DMAMEM buffers and the heap above them. Which
+* module takes how much of each is in the link map, which
+* scripts/memory_report.py prints after every build.
+*
+* paintStack(), first thing in setup(), fills the free stack with a pattern;
+* stackUsed() finds the deepest word overwritten since, so the figure covers
+* the control interrupt at its deepest. It reads the whole free stack, a
+* loop()-side call.
+*
+* heapUsed() is the allocator's bytes in use. With HEAP_GUARD (env
+* teensy40_heapguard, which links with the allocator wrapped) every malloc,
+* calloc and realloc is counted too, by whether it ran in an interrupt, the
+* control step's context, and arm() at the end of setup() starts the count of
+* the ones there should be none of. The first after arm() keeps its return
+* address into the caller, for addr2line on firmware.elf; with
+* HEAP_GUARD_TRAP it stops the firmware there instead.
+*/
+class MemoryBudget {
+public:
+    static constexpr uint32_t stack_paint = 0xA5A5A5A5;
+
+    struct Layout {
+        uint32_t itcm_code;   // bytes of code in ITCM
+        uint32_t itcm_size;   // the whole 32 KiB blocks given to it
+        uint32_t dtcm_data;   // .data
+        uint32_t dtcm_bss;    // .bss
+        uint32_t stack_size;  // the rest of DTCM
+        uint32_t ram2_dma;    // DMAMEM
+        uint32_t heap_size;   // the rest of RAM2
+    };
+
+    struct Allocations {
+        uint32_t total;          // since boot
+        uint32_t after_arm;
+        uint32_t interrupt;      // after arm(), from an interrupt
+        uint32_t bytes_after_arm;
+        uint32_t first_caller;   // return address of the first after arm(), 0 for none
+    };
+
+    static void layout(Layout& out);
+
+    static void paintStack();
+    static uint32_t stackUsed();
+
+    static uint32_t heapUsed();
+    static uint32_t heapFree(); // above the break, never handed out yet
+
+    static void arm();
+    static bool guarded();      // built with HEAP_GUARD
+    static void allocations(Allocations& out);
+
+    // from the allocator wrappers
+    static void allocated(size_t size, void* caller);
+};
+
+#endif //MemoryBudget_h
@@ -0,0 +1,41 @@
+#ifndef Placement_h
+#define Placement_h
+
+/* Where the firmware's code goes on the Teensy 4.0.
+*
+* The i.MX RT1062 runs code from ITCM in one cycle, and from the QSPI flash
+* through a 32 KiB instruction cache, which costs tens of cycles a line on a
+* miss. The core's linker script already puts all code in ITCM unless it is
+* FLASHMEM, and all data, const tables included, in DTCM unless it is
+* DMAMEM or PROGMEM; but ITCM is taken from the same 512 KiB FlexRAM in 32 KiB
+* blocks, so every block of code there is a block less of DTCM for .bss and
+* the stack (scripts/memory_report.py prints the count).
+*
+*  - HOT_CODE: the control step and the out-of-line functions it calls
+*    (IMU fusion, the encoder exchange, the command formatting and parsing,
+*    the torque and setpoint output, the estimators). Pinned to ITCM, so they
+*    stay there whatever the default.
+*  - COLD_CODE: code that only runs in setup() or once per boot (ODrive
+*    and sensor configuration, calibration import, the memory layout). In
+*    flash, where a cache miss costs nothing that matters.
+*  - Everything else stays in ITCM by default; only mark code cold that
+*    provably never runs from controlStep().
+*
+* Header-only templates (the filters, MahonyFilter, NeuralPBC, ImpactMap,
+* HybridEKF) are inlined into their caller and go wherever it goes.
+* The placement/ benchmarks of src/bench time the same code from each side,
+* with the instruction cache warm and flushed.
+*
+* Elsewhere, on the host or another board, both are empty.
+*/
+
+#if defined(__IMXRT1062__)
+    #include "Arduino.h"
+    #define HOT_CODE FASTRUN
+    #define COLD_CODE FLASHMEM
+#else
+    #define HOT_CODE
+    #define COLD_CODE
+#endif
+
+#endif //Placement_h
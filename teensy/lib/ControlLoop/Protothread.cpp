@@ -0,0 +1,33 @@
+#include "Arduino.h"
+#include "Protothread.h"
+
+BackgroundRunner::BackgroundRunner(Protothread* const* threads, uint8_t count)
+    : threads_(threads), count_(count), cycles_per_us_(F_CPU_ACTUAL / 1000000) {}
+
+void BackgroundRunner::pass() {
+    for (uint8_t i = 0; i < count_; ++i) {
+        Protothread& pt = *threads_[i];
+        uint32_t start = ARM_DWT_CYCCNT;
+        Protothread::State state = pt.body_(pt);
+        uint32_t duration = (ARM_DWT_CYCCNT - start) / cycles_per_us_;
+
+        // a wait can follow work done since the last yield, so it is timed too
+        Protothread::Window& window = pt.window_;
+        ++window.slices;
+        if (state == Protothread::WAITING) ++window.waits;
+        pt.window_total_us_ += duration;
+        if (duration > window.max_us) window.max_us = duration;
+        if (duration > pt.slice_us_) {
+            ++window.over_slice;
+            ++pt.total_over_slice_;
+        }
+    }
+}
+
+void BackgroundRunner::snapshot(uint8_t i, Protothread::Window& window) {
+    Protothread& pt = *threads_[i];
+    window = pt.window_;
+    window.mean_us = pt.window_.slices ? (uint32_t)(pt.window_total_us_ / pt.window_.slices) : 0;
+    pt.window_ = {0, 0, 0, 0, 0};
+    pt.window_total_us_ = 0;
+}
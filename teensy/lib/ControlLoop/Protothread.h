@@ -0,0 +1,102 @@
+#ifndef Protothread_h
+#define Protothread_h
+
+#include "Arduino.h"
+
+/* Stackless coroutines for the background work in loop(), so a job that has
+* to wait (an ODrive reboot, a slow publish) gives the pass back instead of
+* holding it, and each job's slice is bounded and measured.
+*
+* A job is a function Protothread::State body(Protothread& pt) written
+* between PT_BEGIN(pt) and PT_END(pt). PT_YIELD(pt) returns and the next
+* pass resumes after it; PT_WAIT_UNTIL(pt, c) returns until c holds;
+* PT_SLEEP_MS(pt, ms) waits on millis() without delay(). At PT_END the body
+* starts over from the top on the next pass, so a periodic job needs no loop
+* of its own.
+*
+*     Protothread::State blink(Protothread& pt) {
+*       PT_BEGIN(pt);
+*       digitalWrite(LED_BUILTIN, HIGH);
+*       PT_SLEEP_MS(pt, 100);
+*       digitalWrite(LED_BUILTIN, LOW);
+*       PT_SLEEP_MS(pt, 900);
+*       PT_END(pt);
+*     }
+*
+* The resume point is the line of the last yield, switched on as in Duff's
+* device: locals do not survive a yield (keep state in statics or globals,
+* declared above PT_BEGIN), nothing may yield from inside a switch
+* statement of its own, and one line holds at most one yield.
+*
+* BackgroundRunner runs its jobs once each per pass() in order, timing every
+* slice with the DWT cycle counter against the job's slice_us. A slice over
+* it is counted, not cut short: the bound is the job's own, from where it
+* yields. Statistics are per window, as in RateTask: snapshot() copies them
+* and starts a new one. Everything here runs from loop() only.
+*/
+class Protothread {
+public:
+    enum State : uint8_t { WAITING, YIELDED, ENDED };
+    typedef State (*Body)(Protothread& pt);
+
+    struct Window {
+        uint32_t slices;     // runs of the body
+        uint32_t waits;      // of them, ended on a condition still false
+        uint32_t over_slice;
+        uint32_t max_us;
+        uint32_t mean_us;
+    };
+
+    Protothread(const char* name, Body body, uint32_t slice_us)
+        : name_(name), body_(body), slice_us_(slice_us) {}
+
+    // Back to PT_BEGIN on the next run
+    void restart() { line = 0; }
+
+    const char* name() const { return name_; }
+    uint32_t slice_us() const { return slice_us_; }
+    uint32_t overSlice() const { return total_over_slice_; }
+
+    // For the PT_ macros
+    uint16_t line = 0;
+    uint32_t wake_ms = 0;
+
+private:
+    friend class BackgroundRunner;
+
+    const char* name_;
+    Body body_;
+    uint32_t slice_us_;
+    uint32_t total_over_slice_ = 0;
+    uint64_t window_total_us_ = 0;
+    Window window_ = {0, 0, 0, 0, 0};
+};
+
+#define PT_BEGIN(pt) switch ((pt).line) { case 0:
+#define PT_YIELD(pt) do { (pt).line = __LINE__; return Protothread::YIELDED; case __LINE__:; } while (0)
+#define PT_WAIT_UNTIL(pt, condition) do { (pt).line = __LINE__; case __LINE__: \
+    if (!(condition)) return Protothread::WAITING; } while (0)
+#define PT_SLEEP_MS(pt, ms) do { (pt).wake_ms = millis() + (ms); \
+    PT_WAIT_UNTIL(pt, (int32_t)(millis() - (pt).wake_ms) >= 0); } while (0)
+#define PT_END(pt) } (pt).line = 0; return Protothread::ENDED
+
+class BackgroundRunner {
+public:
+    BackgroundRunner(Protothread* const* threads, uint8_t count);
+
+    // One slice of every job, in order
+    void pass();
+    // The cycle counter's rate after a CPU clock change, between passes
+    void setClock(uint32_t hz) { cycles_per_us_ = hz / 1000000; }
+
+    uint8_t count() const { return count_; }
+    Protothread& thread(uint8_t i) const { return *threads_[i]; }
+    void snapshot(uint8_t i, Protothread::Window& window);
+
+private:
+    Protothread* const* threads_;
+    uint8_t count_;
+    uint32_t cycles_per_us_;
+};
+
+#endif //Protothread_h
@@ -0,0 +1,29 @@
+#include "Arduino.h"
+#include "RateTask.h"
+
+RateTask::RateTask(const char* name, uint16_t divider, uint16_t phase, uint32_t budget_us)
+    : name_(name), divider_(divider ? divider : 1), phase_(phase % (divider ? divider : 1)),
+      budget_us_(budget_us), cycles_per_us_(F_CPU_ACTUAL / 1000000) {}
+
+void RateTask::finish() {
+    uint32_t duration = run_cycles_ / cycles_per_us_;
+    run_cycles_ = 0;
+    last_us_ = duration;
+
+    ++window_.runs;
+    window_total_us_ += duration;
+    if (duration > window_.max_us) window_.max_us = duration;
+    if (duration > budget_us_) {
+        ++window_.over_budget;
+        ++total_over_budget_;
+    }
+}
+
+void RateTask::snapshot(Window& window) {
+    noInterrupts();
+    window = window_;
+    window.mean_us = window_.runs ? (uint32_t)(window_total_us_ / window_.runs) : 0;
+    window_ = {0, 0, 0, 0};
+    window_total_us_ = 0;
+    interrupts();
+}
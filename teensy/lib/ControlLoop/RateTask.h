@@ -0,0 +1,60 @@
+#ifndef RateTask_h
+#define RateTask_h
+
+#include "Arduino.h"
+
+/* One rate of the multi-rate control step: due every divider-th tick at the
+* given phase, with its own time budget.
+*
+* Time is measured with the DWT cycle counter between start() and stop(); a
+* task that is interleaved with others can start and stop several times in
+* a tick, and finish() closes the run, compares it to the budget and updates
+* the statistics. Phases spread slower tasks over different ticks so their
+* bus time does not pile up on one step.
+*
+* Statistics are per window, as in LoopTiming: snapshot() copies them with
+* interrupts off and starts a new window.
+*/
+class RateTask {
+public:
+    struct Window {
+        uint32_t runs;
+        uint32_t over_budget;
+        uint32_t max_us;
+        uint32_t mean_us;
+    };
+
+    RateTask(const char* name, uint16_t divider, uint16_t phase, uint32_t budget_us);
+
+    bool due(uint32_t tick) const { return tick % divider_ == phase_; }
+
+    void start() { start_cycles_ = ARM_DWT_CYCCNT; }
+    void stop() { run_cycles_ += ARM_DWT_CYCCNT - start_cycles_; }
+    void finish();
+    // The cycle counter's rate after a CPU clock change, between ticks
+    void setClock(uint32_t hz) { cycles_per_us_ = hz / 1000000; }
+
+    void snapshot(Window& window);
+
+    const char* name() const { return name_; }
+    uint16_t divider() const { return divider_; }
+    uint32_t budget_us() const { return budget_us_; }
+    uint32_t lastDuration_us() const { return last_us_; }
+    // Runs over budget since boot
+    uint32_t overBudget() const { return total_over_budget_; }
+
+private:
+    const char* name_;
+    uint16_t divider_;
+    uint16_t phase_;
+    uint32_t budget_us_;
+    uint32_t cycles_per_us_;
+    uint32_t start_cycles_ = 0;
+    uint32_t run_cycles_ = 0;
+    uint32_t last_us_ = 0;
+    uint32_t total_over_budget_ = 0;
+    uint64_t window_total_us_ = 0;
+    Window window_ = {0, 0, 0, 0};
+};
+
+#endif //RateTask_h
@@ -0,0 +1,61 @@
+#ifndef SampleBatcher_h
+#define SampleBatcher_h
+
+#include "Arduino.h"
+#include "SeqSnapshot.h"
+
+/* Consecutive samples of T gathered into batches of up to N, so a control
+* rate faster than the link takes one message per sample still gets every
+* sample off the board, in a fraction of the messages.
+*
+* add() runs in the control interrupt with every tick's sample and keeps one
+* of every stride (decimation); each size-th kept sample closes the batch,
+* which is published through a SeqSnapshot. read() takes it from loop(),
+* which has size*stride ticks to do so before the next one replaces it; a
+* batch it misses is gone, seen as a gap in the samples' seq.
+*
+* An urgent sample (a touchdown) closes the batch early, short, so it goes
+* out now rather than up to size*stride ticks later; off the stride it is
+* not kept, so the next kept sample closes it, and the samples stay on the
+* seq + i*stride grid the receiver expects.
+*/
+template<class T, uint8_t N>
+class SampleBatcher {
+public:
+    struct Batch {
+        uint8_t count;
+        T samples[N];
+    };
+
+    SampleBatcher(uint8_t size, uint8_t stride)
+        : size_(size < 1 ? 1 : (size > N ? N : size)), stride_(stride < 1 ? 1 : stride) {}
+
+    void add(const T& sample, bool urgent = false) {
+        urgent_ |= urgent;
+        if (++skipped_ < stride_) return;
+        skipped_ = 0;
+        building_.samples[building_.count++] = sample;
+        if (building_.count < size_ && !urgent_) return;
+        urgent_ = false;
+        batches_.write(building_);
+        building_.count = 0;
+    }
+
+    // The latest closed batch if there was one since last, a sequence from an earlier read()
+    bool read(uint32_t& last, Batch& batch) const { return batches_.read(last, batch); }
+
+    // Batches closed so far
+    uint32_t seq() const { return batches_.seq(); }
+    uint8_t size() const { return size_; }
+    uint8_t stride() const { return stride_; }
+
+private:
+    uint8_t size_;
+    uint8_t stride_;
+    uint8_t skipped_ = 0;
+    bool urgent_ = false;
+    Batch building_ = {};
+    SeqSnapshot<Batch> batches_;
+};
+
+#endif //SampleBatcher_h
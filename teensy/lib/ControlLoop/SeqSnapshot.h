@@ -0,0 +1,54 @@
+#ifndef SeqSnapshot_h
+#define SeqSnapshot_h
+
+#include "Arduino.h"
+#include <atomic>
+
+/* Versioned latest value of T, written by one context (the control
+* interrupt) and read from any other without turning interrupts off.
+*
+* Two slots: write() fills the one readers are not pointed at and then
+* bumps the sequence, which flips them over. read() copies the slot of the
+* sequence it loaded and keeps the copy if the sequence has not moved: a
+* reader that preempts the writer (a higher-priority interrupt) always
+* succeeds first time, since the slot being written is never its own, and
+* a reader the writer preempts (loop()) retries. Only a reader held off for
+* a whole period while the writer ran twice could spin, which the fixed
+* control rate rules out.
+*
+* The sequence counts writes from 1; read() reports whether there was one
+* since the sequence it was given, so each reader keeps its own place.
+*/
+template<class T>
+class SeqSnapshot {
+public:
+    void write(const T& value) {
+        uint32_t next = seq_ + 1;
+        slot_[next & 1] = value;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        seq_ = next;
+    }
+
+    // The latest value if one was written since last, a sequence from an earlier read()
+    bool read(uint32_t& last, T& value) const {
+        uint32_t seq;
+        do {
+            seq = seq_;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            if (seq == last) return false;
+            value = slot_[seq & 1];
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } while (seq_ != seq);
+        last = seq;
+        return true;
+    }
+
+    // Writes so far
+    uint32_t seq() const { return seq_; }
+
+private:
+    volatile uint32_t seq_ = 0;
+    T slot_[2] = {};
+};
+
+#endif //SeqSnapshot_h
@@ -0,0 +1,157 @@
+#include "Arduino.h"
+#include "StepBenchmark.h"
+#include "Placement.h"
+
+// +amplitude, 0, -amplitude, 0
+static const float step_targets[StepBenchmark::num_steps] = {1.0f, 0.0f, -1.0f, 0.0f};
+
+StepBenchmark::StepBenchmark(const uint32_t* rates_hz, uint8_t count, uint32_t home_hz, float amplitude,
+                             uint32_t settle_us, uint32_t step_us, float band, float torque_constant)
+    : count_(count < max_rates ? count : max_rates), home_hz_(home_hz), amplitude_(amplitude),
+      settle_us_(settle_us), step_us_(step_us), band_(band), torque_constant_(torque_constant) {
+    for (uint8_t i = 0; i < count_; ++i)
+        rates_[i] = rates_hz[i];
+    memset(&result_, 0, sizeof(result_));
+}
+
+void StepBenchmark::start() {
+    if (phase_ != IDLE || count_ == 0)
+        return;
+    index_ = 0;
+    have_result_ = false;
+    pending_hz_ = rates_[0];
+    phase_ = SWITCHING;
+}
+
+void StepBenchmark::abort() {
+    if (phase_ == IDLE || (phase_ == SWITCHING && index_ >= count_))
+        return;
+    // the rate under way has no result; the scheduler goes home
+    ++aborted_;
+    index_ = count_;
+    command_[0] = command_[1] = 0.0f;
+    pending_hz_ = home_hz_;
+    phase_ = SWITCHING;
+}
+
+void StepBenchmark::rateApplied() {
+    pending_hz_ = 0;
+    if (index_ >= count_) {
+        phase_ = IDLE;
+        return;
+    }
+    memset(&result_, 0, sizeof(result_));
+    result_.rate_hz = rates_[index_];
+    result_.min_period_us = UINT32_MAX;
+    period_total_us_ = 0;
+    latency_total_us_ = 0;
+    error_total_ = 0.0;
+    settle_total_us_ = 0;
+    settle_steps_ = 0;
+    begun_ = false;
+    phase_ = SETTLE;
+}
+
+bool StepBenchmark::takeResult(Result& result) {
+    if (!have_result_)
+        return false;
+    result = result_;
+    have_result_ = false;
+    return true;
+}
+
+HOT_CODE float StepBenchmark::command(uint32_t now_us) {
+    if (phase_ != SETTLE && phase_ != STEPS)
+        return 0.0f;
+    if (!begun_) {
+        begun_ = true;
+        start_us_ = now_us;
+    }
+    uint32_t elapsed = now_us - start_us_;
+    if (phase_ == SETTLE) {
+        if (elapsed < settle_us_)
+            return 0.0f;
+        phase_ = STEPS;
+        step_ = 0;
+        step_ticks_ = 0;
+        settled_ = false;
+    }
+    uint32_t step = (elapsed - settle_us_) / step_us_;
+    if (step != step_) {
+        finishStep();
+        if (step >= num_steps) {
+            finishRate();
+            return 0.0f;
+        }
+        step_ = (uint8_t)step;
+        step_ticks_ = 0;
+        settled_ = false;
+    }
+    return step_targets[step_] * amplitude_;
+}
+
+HOT_CODE void StepBenchmark::commanded(const float motor[2]) {
+    command_[0] = motor[0];
+    command_[1] = motor[1];
+}
+
+HOT_CODE void StepBenchmark::measure(uint32_t period_us, uint32_t latency_us, const float* current) {
+    if (phase_ == STEPS) {
+        Result& r = result_;
+        ++r.samples;
+        if (period_us < r.min_period_us) r.min_period_us = period_us;
+        if (period_us > r.max_period_us) r.max_period_us = period_us;
+        period_total_us_ += period_us;
+        if (2 * period_us > 3 * (1000000 / r.rate_hz)) ++r.late;
+        if (latency_us > r.max_latency_us) r.max_latency_us = latency_us;
+        latency_total_us_ += latency_us;
+        if (current) {
+            // this tick's currents answer the previous tick's command
+            float e0 = fabsf(previous_[0] - torque_constant_ * current[0]);
+            float e1 = fabsf(previous_[1] - torque_constant_ * current[1]);
+            ++r.tracked;
+            error_total_ += (double)e0 * e0 + (double)e1 * e1;
+            float e = e0 > e1 ? e0 : e1;
+            if (e > r.max_error) r.max_error = e;
+            // not on a step's first tick, which still answers the step before
+            if (!settled_ && step_ticks_ > 0 && e <= band_) {
+                settled_ = true;
+                addSettle((uint32_t)((uint64_t)step_ticks_ * 1000000u / r.rate_hz));
+            }
+        }
+        ++step_ticks_;
+    }
+    previous_[0] = command_[0];
+    previous_[1] = command_[1];
+}
+
+void StepBenchmark::addSettle(uint32_t settle_us) {
+    settle_total_us_ += settle_us;
+    ++settle_steps_;
+    if (settle_us > result_.max_settle_us) result_.max_settle_us = settle_us;
+}
+
+void StepBenchmark::finishStep() {
+    if (result_.tracked > 0 && !settled_)
+        addSettle(step_us_);
+}
+
+void StepBenchmark::finishRate() {
+    Result& r = result_;
+    if (r.samples > 0) {
+        r.mean_period_us = (uint32_t)(period_total_us_ / r.samples);
+        r.mean_latency_us = (uint32_t)(latency_total_us_ / r.samples);
+    } else {
+        r.min_period_us = 0;
+    }
+    if (r.tracked > 0)
+        r.rms_error = (float)sqrt(error_total_ / (2.0 * r.tracked));
+    if (settle_steps_ > 0)
+        r.mean_settle_us = (uint32_t)(settle_total_us_ / settle_steps_);
+    have_result_ = true;
+    ++completed_;
+    ++index_;
+    command_[0] = command_[1] = 0.0f;
+    pending_hz_ = index_ < count_ ? rates_[index_] : home_hz_;
+    phase_ = SWITCHING;
+}
@@ -0,0 +1,105 @@
+#ifndef StepBenchmark_h
+#define StepBenchmark_h
+
+#include "Arduino.h"
+
+/* A scripted torque step response, run at a list of control rates, for an
+* on-robot benchmark that is the same every time: of a transport, of the
+* scheduler, of the control step's cost.
+*
+* Each rate is held settle_us at zero torque, then four steps of step_us
+* each, +amplitude, 0, -amplitude, 0, in place of the controller's torque.
+* Over the steps measure() keeps the control period's min/mean/max and the
+* ticks late by half a period, the sense-to-actuate latency, and, with the
+* motor currents, the tracking error: each motor torque commanded against
+* Kt*Iq a tick later, as RMS and maximum, and per step the time until both
+* motors are within band of their command.
+*
+* The rate changes happen in loop(): when a rate is done, or the script is
+* aborted, pendingRate() is the one the scheduler should run at next (the
+* home rate after the last), and the step gets zero torque until loop() has
+* paused the scheduler, set the period, called rateApplied() and resumed it.
+* start(), rateApplied() and takeResult() are for loop() with the scheduler
+* paused; command(), commanded() and measure() for the control step, and
+* abort() for either.
+*/
+class StepBenchmark {
+public:
+    static constexpr uint8_t max_rates = 8;
+    static constexpr uint8_t num_steps = 4;
+
+    struct Result {
+        uint32_t rate_hz;
+        uint32_t samples;
+        uint32_t min_period_us, mean_period_us, max_period_us;
+        uint32_t late;                  // periods over 1.5 times the rate's
+        uint32_t mean_latency_us, max_latency_us;
+        uint32_t tracked;               // samples with the motor currents
+        float rms_error, max_error;     // Nm, per motor
+        uint32_t mean_settle_us, max_settle_us; // step_us for a step that never settled
+    };
+
+    // rates_hz: up to max_rates; home_hz: the rate to go back to; band: Nm per motor
+    StepBenchmark(const uint32_t* rates_hz, uint8_t count, uint32_t home_hz, float amplitude,
+                  uint32_t settle_us, uint32_t step_us, float band, float torque_constant);
+
+    void start();
+    void abort();
+    // The scheduler period the step should run at next, 0 for none
+    uint32_t pendingRate() const { return pending_hz_; }
+    void rateApplied();
+    // The last rate's result, once; false if none is waiting
+    bool takeResult(Result& result);
+
+    // The torque for this tick, in place of the controller's
+    float command(uint32_t now_us);
+    // The motor torques that went out for it
+    void commanded(const float motor[2]);
+    // After the actuation; current: the motors' Iq read this tick, nullptr without
+    void measure(uint32_t period_us, uint32_t latency_us, const float* current);
+
+    bool active() const { return phase_ != IDLE; }
+    // The rate being benchmarked, 0 while idle or between rates
+    uint32_t rateHz() const { return phase_ == SETTLE || phase_ == STEPS ? rates_[index_] : 0; }
+    uint32_t completed() const { return completed_; }
+    uint32_t aborted() const { return aborted_; }
+
+private:
+    enum Phase : uint8_t { IDLE, SWITCHING, SETTLE, STEPS };
+
+    void addSettle(uint32_t settle_us);
+    void finishStep();
+    void finishRate();
+
+    uint32_t rates_[max_rates];
+    uint8_t count_;
+    uint32_t home_hz_;
+    float amplitude_;
+    uint32_t settle_us_;
+    uint32_t step_us_;
+    float band_;
+    float torque_constant_;
+
+    volatile Phase phase_ = IDLE;
+    volatile uint32_t pending_hz_ = 0;
+    uint8_t index_ = 0;
+    bool begun_ = false;            // the rate's first tick came
+    uint32_t start_us_ = 0;
+    uint8_t step_ = 0;
+    uint32_t step_ticks_ = 0;
+    bool settled_ = false;
+    float command_[2] = {0.0f, 0.0f};   // this tick's
+    float previous_[2] = {0.0f, 0.0f};  // what the currents answer
+
+    Result result_;
+    uint64_t period_total_us_ = 0;
+    uint64_t latency_total_us_ = 0;
+    double error_total_ = 0.0;
+    uint64_t settle_total_us_ = 0;
+    uint32_t settle_steps_ = 0;
+    volatile bool have_result_ = false;
+    uint32_t completed_ = 0;
+    uint32_t aborted_ = 0;
+};
+
+#endif //StepBenchmark_h
@@ -0,0 +1,110 @@
+#ifndef TeleopShaper_h
+#define TeleopShaper_h
+
+#include <math.h>
+#include <stdint.h>
+
+/* One joystick axis to a command, on the firmware, so the Pi's relay only
+* forwards the stick and the wheel answers it however busy the Pi is.
+*
+* target() takes the stick in [-1, 1] as it arrives and shapes it:
+*  - deadband: |stick| under it is 0, and the rest is stretched back over
+*    [0, 1] so the output starts from 0 at its edge instead of jumping,
+*  - expo: (1 - expo) x + expo x^3, fine control near the centre with the
+*    full range kept,
+*  - curve: with points > 1, |x| through a table of points values at
+*    0, 1/(points - 1), ... 1, interpolated and mirrored for x < 0,
+*  - scale: the output at full stick, negative to flip the axis.
+* update() runs in the control step and moves the output toward the target
+* by at most rate_limit a second (none at 0). A stick not heard for
+* timeout_us (none at 0) targets 0, so a relay gone quiet ramps the wheel
+* down instead of holding its last speed.
+*
+*     TeleopShaper shaper({0.08f, 0.4f, MOTOR_VELOCITY_LIMIT, 100.0f, 250000, 0, {}});
+*     shaper.target(msg.velocity[1], micros());                  // subscriber
+*     velocity = shaper.update(micros());                        // control step
+*
+* target() is for loop(), update() for the control step; the target is one
+* aligned float and the stamp one word, each written whole.
+*/
+class TeleopShaper {
+public:
+    static constexpr uint8_t MAX_POINTS = 9;
+
+    struct Config {
+        float deadband;                 // of the stick, [0, 1)
+        float expo;                     // [0, 1]
+        float scale;                    // output at full stick
+        float rate_limit;               // output per second, 0 for none
+        uint32_t timeout_us;            // 0 for none
+        uint8_t points;                 // of curve, 0 or 1 for none
+        float curve[MAX_POINTS];        // from 0 at the centre to 1 at full stick
+    };
+
+    explicit TeleopShaper(const Config& config) : config_(config) {
+        if (config_.points > MAX_POINTS) config_.points = MAX_POINTS;
+    }
+
+    // The stick's output before the rate limit
+    float shape(float stick) const {
+        if (!(stick == stick)) return 0.0f;     // NaN
+        float x = fabsf(stick);
+        if (x > 1.0f) x = 1.0f;
+        if (x <= config_.deadband) return 0.0f;
+        x = (x - config_.deadband) / (1.0f - config_.deadband);
+        x = (1.0f - config_.expo) * x + config_.expo * x * x * x;
+        if (config_.points > 1) {
+            float position = x * (config_.points - 1);
+            uint8_t i = (uint8_t)position;
+            if (i >= config_.points - 1) i = config_.points - 2;
+            float fraction = position - i;
+            x = config_.curve[i] + fraction * (config_.curve[i + 1] - config_.curve[i]);
+        }
+        return copysignf(x, stick) * config_.scale;
+    }
+
+    // A new stick position
+    void target(float stick, uint32_t now_us) {
+        target_ = shape(stick);
+        stamp_us_ = now_us;
+        heard_ = true;
+    }
+
+    // The output this step
+    float update(uint32_t now_us) {
+        float target = target_;
+        if (!heard_ || (config_.timeout_us && now_us - stamp_us_ > config_.timeout_us)) target = 0.0f;
+        if (!started_) {
+            last_us_ = now_us;  // from rest
+            started_ = true;
+        }
+        if (config_.rate_limit > 0.0f) {
+            float step = config_.rate_limit * (float)(now_us - last_us_) * 1e-6f;
+            if (target > output_ + step) target = output_ + step;
+            else if (target < output_ - step) target = output_ - step;
+        }
+        output_ = target;
+        last_us_ = now_us;
+        return output_;
+    }
+
+    // At rest, the stick forgotten: after an E-stop or a brake, so the release ramps from 0
+    void reset() {
+        heard_ = false;
+        output_ = 0.0f;
+        started_ = false;
+    }
+
+    float output() const { return output_; }
+
+private:
+    Config config_;
+    volatile float target_ = 0.0f;
+    volatile uint32_t stamp_us_ = 0;
+    volatile bool heard_ = false;
+    float output_ = 0.0f;
+    uint32_t last_us_ = 0;
+    bool started_ = false;
+};
+
+#endif //TeleopShaper_h
@@ -0,0 +1,55 @@
+#ifndef TorqueLimiter_h
+#define TorqueLimiter_h
+
+#include <math.h>
+
+/* The last stage before the motors: whatever the controller or the Pi
+* asked for, the pair of motor torques leaves within fixed limits.
+*
+* Limits is a config type with static constexpr members, like a
+* FixedFilterBank config:
+*
+*     max         Nm at the motor, |torque| <= max; 0 for none
+*     fade_speed  rad/s of spoke; the limit falls linearly from max at rest
+*                 to zero at this speed, the torque-speed line of a motor
+*                 against its supply; 0 for a flat max
+*     slew        Nm/s; the torque moves at most slew*ts per step; 0 for none
+*     ts          s, the step period
+*
+* Each limit is a min/max pair (vminnm/vmaxnm on the M7), so apply() has no
+* branch on the data, and a limit set to 0 folds away at compile time. The
+* slew runs from the last torque apply() returned; reset() says the motors
+* were set to zero behind its back (a brake), so the next command ramps up
+* from there.
+*/
+template<class Limits>
+class TorqueLimiter {
+public:
+    static_assert(Limits::fade_speed <= 0 || Limits::max > 0, "a speed-dependent limit needs a max");
+
+    // torque in place; speed the two spokes' rates, rad/s
+    inline void apply(float torque[2], const float speed[2]) {
+        for (int i = 0; i < 2; ++i) {
+            float t = torque[i];
+            if (Limits::max > 0) {
+                float limit = Limits::max;
+                if (Limits::fade_speed > 0)
+                    limit *= fmaxf(0.0f, 1.0f - fabsf(speed[i])*(1.0f/Limits::fade_speed));
+                t = fminf(fmaxf(t, -limit), limit);
+            }
+            if (Limits::slew > 0) {
+                constexpr float step = Limits::slew*Limits::ts;
+                t = fminf(fmaxf(t, last_[i] - step), last_[i] + step);
+            }
+            last_[i] = t;
+            torque[i] = t;
+        }
+    }
+
+    void reset() { last_[0] = last_[1] = 0.0f; }
+
+private:
+    float last_[2] = {0.0f, 0.0f};
+};
+
+#endif //TorqueLimiter_h
@@ -0,0 +1,31 @@
+#include "Arduino.h"
+#include "TorqueOutput.h"
+#include "Placement.h"
+
+HOT_CODE bool TorqueOutput::update(float torque0, float torque1, uint32_t now_us) {
+    if (valid_ && fabsf(torque0 - last_[0]) <= epsilon_ && fabsf(torque1 - last_[1]) <= epsilon_
+        && now_us - stamp_us_ < keepalive_us_) {
+        ++suppressed_;
+        return false;
+    }
+    last_[0] = torque0;
+    last_[1] = torque1;
+    stamp_us_ = now_us;
+    valid_ = true;
+    ++sent_;
+    return true;
+}
+
+HOT_CODE bool TorqueOutput::update(const float setpoint[2], const float feedforward[2], uint32_t now_us) {
+    if (valid_ && fabsf(feedforward[0] - last_feedforward_[0]) <= feedforward_epsilon_
+        && fabsf(feedforward[1] - last_feedforward_[1]) <= feedforward_epsilon_) {
+        if (!update(setpoint[0], setpoint[1], now_us))
+            return false;
+    } else {
+        invalidate();
+        update(setpoint[0], setpoint[1], now_us);
+    }
+    last_feedforward_[0] = feedforward[0];
+    last_feedforward_[1] = feedforward[1];
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef TorqueOutput_h
+#define TorqueOutput_h
+
+#include "Arduino.h"
+
+/* Delta suppression for the two-axis torque command.
+*
+* update() is given the torques the step wants on the axes and says whether
+* they need to go out: when either differs from the last pair sent by more
+* than epsilon, when keepalive_us passed since the last send (so a lost
+* command or an ODrive that came back from a reset gets the value again),
+* or after invalidate(). Anything else that writes the axes, a brake or a
+* calibration, calls invalidate() so the next command is not taken as sent.
+*
+* Without torque control the same stage carries a velocity or position pair
+* and its torque feed-forward: the pair is compared with epsilon and the
+* feed-forward with feedforward_epsilon, and both go out if either moved.
+*/
+class TorqueOutput {
+public:
+    TorqueOutput(float epsilon, uint32_t keepalive_us, float feedforward_epsilon = 0.0f)
+        : epsilon_(epsilon), feedforward_epsilon_(feedforward_epsilon), keepalive_us_(keepalive_us) {}
+
+    // True if torque0 and torque1 should be sent now; they count as sent
+    bool update(float torque0, float torque1, uint32_t now_us);
+    // True if the setpoint pair and its feed-forward should be sent now
+    bool update(const float setpoint[2], const float feedforward[2], uint32_t now_us);
+    void invalidate() { valid_ = false; }
+
+    // Since boot
+    uint32_t sent() const { return sent_; }
+    uint32_t suppressed() const { return suppressed_; }
+
+private:
+    float epsilon_;
+    float feedforward_epsilon_;
+    uint32_t keepalive_us_;
+    float last_[2] = {0.0f, 0.0f};
+    float last_feedforward_[2] = {0.0f, 0.0f};
+    uint32_t stamp_us_ = 0;
+    bool valid_ = false;
+    uint32_t sent_ = 0;
+    uint32_t suppressed_ = 0;
+};
+
+#endif //TorqueOutput_h
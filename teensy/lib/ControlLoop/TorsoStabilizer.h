@@ -0,0 +1,66 @@
+#ifndef TorsoStabilizer_h
+#define TorsoStabilizer_h
+
+#include <math.h>
+#include "CommandQueue.h"
+
+/* The inner loop of SUPERVISED_CONTROL: a PD law on the torso run every
+* control step on the Teensy, around the setpoint the Pi's controller sends
+* at its own, slower rate on /torso_command (CommandQueue::Setpoint):
+*
+*     u = torque + kp*(angle - phi) + kd*(rate - omega)
+*
+* so the loop that keeps the torso up closes at the step's rate and the
+* Pi's latency only delays the setpoint. The gains are clamped to
+* [0, max_kp] and [0, max_kd], so a bad message cannot make the inner loop
+* unstable. A setpoint with both gains 0 is a plain torque.
+*
+* control() takes the newest setpoint, or null when CommandQueue::newest()
+* has none. Before the first engaged setpoint that is zero torque, as a
+* timed-out torque command is; after one, the torso is held at the last
+* target angle with the fallback gains (the feed-forward dropped) until the
+* Pi's setpoints come back, so a dropout of the link does not drop the
+* torso. Nothing here touches hardware.
+*/
+class TorsoStabilizer {
+public:
+    TorsoStabilizer(float fallback_kp, float fallback_kd, float max_kp, float max_kd)
+        : fallback_kp_(fallback_kp), fallback_kd_(fallback_kd), max_kp_(max_kp), max_kd_(max_kd) {}
+
+    // The hip torque for the torso at phi, rad, turning at omega, rad/s
+    inline float control(const CommandQueue::Setpoint* setpoint, float phi, float omega) {
+        if (setpoint) {
+            float kp = fminf(fmaxf(setpoint->kp, 0.0f), max_kp_);
+            float kd = fminf(fmaxf(setpoint->kd, 0.0f), max_kd_);
+            engaged_ = kp > 0.0f || kd > 0.0f;
+            holding_ = false;
+            if (engaged_) hold_angle_ = setpoint->angle;
+            return setpoint->torque + kp*(setpoint->angle - phi) + kd*(setpoint->rate - omega);
+        }
+        holding_ = engaged_;
+        if (!engaged_) return 0.0f;
+        return fallback_kp_*(hold_angle_ - phi) - fallback_kd_*omega;
+    }
+
+    // Whether the last control() held the torso on the fallback gains
+    bool holding() const { return holding_; }
+    // The angle the fallback holds, rad
+    float holdAngle() const { return hold_angle_; }
+
+    // Forget the target, e.g. after an E-stop; zero torque until the next engaged setpoint
+    void reset() {
+        engaged_ = false;
+        holding_ = false;
+    }
+
+private:
+    float fallback_kp_;
+    float fallback_kd_;
+    float max_kp_;
+    float max_kd_;
+    bool engaged_ = false;
+    bool holding_ = false;
+    float hold_angle_ = 0.0f;
+};
+
+#endif //TorsoStabilizer_h
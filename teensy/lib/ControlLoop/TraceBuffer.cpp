@@ -0,0 +1,57 @@
+#include "Arduino.h"
+#include "TraceBuffer.h"
+
+TraceBuffer::TraceBuffer(Event* ring, uint32_t capacity, const char* const* names, uint8_t count)
+    : ring_(ring), mask_(capacity - 1), names_(names), count_(count) {}
+
+void TraceBuffer::trigger(uint8_t reason, uint32_t post) {
+    if (triggered_) return;
+    triggered_ = true;
+    record(reason, TRIGGER);
+    noInterrupts();
+    uint32_t recorded = head_.load(std::memory_order_relaxed) - start_;
+    if (recorded + post < stop_) stop_ = recorded + post;
+    interrupts();
+}
+
+void TraceBuffer::arm() {
+    noInterrupts();
+    start_ = head_.load(std::memory_order_relaxed);
+    stop_ = UINT32_MAX;
+    triggered_ = false;
+    interrupts();
+}
+
+bool TraceBuffer::serveDump(Stream& port) {
+    if (!port.available())
+        return false;
+    char command = port.peek();
+    if (command != 'T' && command != 'R')
+        return false;
+    port.read();
+    if (command == 'R') {
+        arm();
+        port.println("OK");
+        return true;
+    }
+
+    // whatever post-trigger events are still due, the ring stops here
+    trigger(0, 0);
+    noInterrupts();
+    uint32_t recorded = head_.load(std::memory_order_relaxed) - start_;
+    if (recorded > stop_) recorded = stop_;
+    stop_ = recorded;
+    interrupts();
+    uint32_t events = recorded < capacity() ? recorded : capacity();
+    uint32_t first = start_ + recorded - events;
+
+    port.print("TRACE "); port.print(events);
+    port.print(' '); port.print(F_CPU_ACTUAL);
+    port.print(' '); port.println(count_);
+    for (uint8_t section = 0; section < count_; ++section)
+        port.println(names_[section]);
+    for (uint32_t i = 0; i < events; ++i)
+        port.write(reinterpret_cast<const uint8_t*>(&ring_[(first + i) & mask_]), sizeof(Event));
+    port.flush();
+    return true;
+}
@@ -0,0 +1,109 @@
+#ifndef TraceBuffer_h
+#define TraceBuffer_h
+
+#include "Arduino.h"
+#include <atomic>
+
+/* Begin and end events of the control step's stages, stamped with the DWT
+* cycle counter, in a ring of fixed size: where CycleProfiler keeps each
+* section's statistics, this keeps the last capacity events themselves, so
+* the ticks before a failure can be read stage by stage.
+*
+* Sections are CycleProfiler's (the same names table), recorded from both
+* the control interrupt and loop(); each event says which it came from, as
+* loop()'s stages are preempted by the step. A slot is taken with one atomic
+* increment, so an interrupt between two halves of a loop() event only puts
+* its own events in between, with stamps a few cycles out of order.
+*
+* trigger() freezes the ring after a number of further events, so the
+* failing tick is finished and the ones before it are not overwritten; a
+* marker event records when and why (the caller's reason byte, e.g. the
+* /sensors status bits). arm() starts recording over again.
+*
+* serveDump() answers scripts/pull_trace.py on a Stream, between ticks:
+*
+*     'T'  "TRACE <events> <cpu_hz> <sections>\n", a name per line, then the
+*          frozen ring oldest first as 8-byte Events (little-endian); the
+*          ring is frozen first if nobody triggered it
+*     'R'  arm(), replied to with "OK"
+*
+* Stamps are cycles at the clock of the dump's cpu_hz; with CpuClock's
+* switches the times of other clocks' ticks are scaled wrong.
+*/
+class TraceBuffer {
+public:
+    enum Phase : uint8_t { BEGIN = 0, END = 1, TRIGGER = 2 };
+    enum Context : uint8_t { LOOP = 0, INTERRUPT = 1 };
+
+    struct Event {
+        uint32_t cycles;
+        uint8_t section;  // the reason byte for a TRIGGER
+        uint8_t phase;
+        uint8_t context;
+        uint8_t reserved;
+    };
+
+    // ring: capacity Events, a power of two, e.g. in DMAMEM; names as CycleProfiler's
+    TraceBuffer(Event* ring, uint32_t capacity, const char* const* names, uint8_t count);
+
+    inline void record(uint8_t section, uint8_t phase) {
+        uint32_t cycles = ARM_DWT_CYCCNT;
+        uint32_t n = head_.fetch_add(1, std::memory_order_relaxed);
+        if (n - start_ >= stop_) return;
+        Event& e = ring_[n & mask_];
+        e.cycles = cycles;
+        e.section = section;
+        e.phase = phase;
+        e.context = context();
+        e.reserved = 0;
+    }
+
+    // Freeze the ring after post more events; the first trigger since arm() wins
+    void trigger(uint8_t reason, uint32_t post);
+    bool triggered() const { return triggered_; }
+    // Record over again, dropping what the ring holds
+    void arm();
+
+    bool serveDump(Stream& port);
+
+    uint32_t capacity() const { return mask_ + 1; }
+
+private:
+    static inline uint8_t context() {
+#if defined(__arm__)
+        uint32_t ipsr;
+        asm volatile("mrs %0, ipsr" : "=r"(ipsr));
+        return ipsr ? INTERRUPT : LOOP;
+#else
+        return LOOP;
+#endif
+    }
+
+    Event* ring_;
+    uint32_t mask_;
+    const char* const* names_;
+    uint8_t count_;
+    std::atomic<uint32_t> head_{0};
+    // events from start_ on are kept, up to stop_ of them
+    volatile uint32_t start_ = 0;
+    volatile uint32_t stop_ = UINT32_MAX;
+    volatile bool triggered_ = false;
+};
+
+// Records the enclosing scope's begin and end into one trace section
+class TraceScope {
+public:
+    TraceScope(TraceBuffer& trace, uint8_t section) : trace_(trace), section_(section) {
+        trace_.record(section_, TraceBuffer::BEGIN);
+    }
+    ~TraceScope() { trace_.record(section_, TraceBuffer::END); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    TraceBuffer& trace_;
+    uint8_t section_;
+};
+
+#endif //TraceBuffer_h
@@ -0,0 +1,88 @@
+#include "Arduino.h"
+#include "TrajectoryBuffer.h"
+#include "Placement.h"
+#include <atomic>
+
+void TrajectoryBuffer::begin(bool replace) {
+    // an append with nothing to append to starts a trajectory
+    replace_ = replace || generation_ == 0;
+    pending_start_ = replace_ ? end_ : (uint16_t)((commit_ >> 12) & index_mask);
+    pending_end_ = end_;
+    last_time_ = committed_time_;
+}
+
+bool TrajectoryBuffer::add(float time, float position, float velocity, float torque) {
+    // the slots from the one being played to the last queued are in use
+    bool full = ((pending_end_ - cursor_) & index_mask) >= ring_size;
+    bool first = pending_end_ == pending_start_;
+    if (full || (!first && !(time > last_time_))) {
+        ++dropped_;
+        return false;
+    }
+    Point& p = ring_[pending_end_ & (ring_size - 1)];
+    p.time = time;
+    p.position = position;
+    p.velocity = velocity;
+    p.torque = torque;
+    last_time_ = time;
+    pending_end_ = (pending_end_ + 1) & index_mask;
+    return true;
+}
+
+// One store publishes the points, and with a new generation the restart
+void TrajectoryBuffer::commit() {
+    if (replace_) generation_ = generation_ == 0xFF ? 1 : generation_ + 1;
+    end_ = pending_end_;
+    committed_time_ = last_time_;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    commit_ = pack(generation_, pending_start_, end_);
+}
+
+HOT_CODE bool TrajectoryBuffer::sample(uint32_t now_us, Point& out) {
+    uint32_t c = commit_;
+    uint8_t generation = c >> 24;
+    if (generation == 0) return false;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    uint16_t end = c & index_mask;
+    uint16_t cursor = cursor_;
+    if (generation != playing_) {
+        playing_ = generation;
+        cursor = (c >> 12) & index_mask;
+        start_us_ = now_us;
+    }
+    if (cursor == end) {
+        // a replace with no points stops the playback
+        cursor_ = cursor;
+        finished_ = false;
+        return false;
+    }
+    float t = (now_us - start_us_) * 1e-6f;
+    uint16_t next = (cursor + 1) & index_mask;
+    while (next != end && at(next).time <= t) {
+        cursor = next;
+        next = (cursor + 1) & index_mask;
+    }
+    cursor_ = cursor;
+
+    const Point& a = at(cursor);
+    if (next == end || t < a.time) {
+        // held: before the first point, or past the last
+        out = a;
+        out.velocity = 0.0f;
+        finished_ = next == end && t >= a.time;
+        return true;
+    }
+    finished_ = false;
+    const Point& b = at(next);
+    float h = b.time - a.time;
+    float s = (t - a.time) / h;
+    float s2 = s*s;
+    float s3 = s2*s;
+    out.time = t;
+    out.position = (2.0f*s3 - 3.0f*s2 + 1.0f)*a.position + (s3 - 2.0f*s2 + s)*h*a.velocity
+                 + (3.0f*s2 - 2.0f*s3)*b.position + (s3 - s2)*h*b.velocity;
+    out.velocity = 6.0f*(s2 - s)*(a.position - b.position)/h + (3.0f*s2 - 4.0f*s + 1.0f)*a.velocity
+                 + (3.0f*s2 - 2.0f*s)*b.velocity;
+    out.torque = a.torque + (b.torque - a.torque)*s;
+    return true;
+}
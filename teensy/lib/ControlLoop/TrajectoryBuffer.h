@@ -0,0 +1,85 @@
+#ifndef TrajectoryBuffer_h
+#define TrajectoryBuffer_h
+
+#include "Arduino.h"
+
+/* A hip trajectory uploaded in bulk (raspi_pkg/Trajectory), played back by
+* the control step.
+*
+* loop() queues the points of one upload with begin(), add() for each and
+* commit(); sample() runs in the control interrupt and returns the setpoint
+* at now_us:
+*  - between two points, position as the cubic Hermite through both points'
+*    positions and velocities, velocity as its derivative, so the two agree,
+*    and the torque feed-forward linear,
+*  - before the first point, the first point,
+*  - past the last one queued, the last position held at zero velocity,
+*    reported by finished() until an append extends it,
+*  - false before any trajectory, or after a replace with no points.
+* A replace restarts the clock at the first sample() that sees it; an append
+* continues the trajectory being played, its times from the same start.
+*
+* The ring holds ring_size points. commit() publishes a whole upload with one
+* store, the generation, start and end of the queued points packed into a
+* word, so sample(), which cannot be preempted by loop(), never sees half of
+* one, and neither side turns interrupts off. add() refuses a point that
+* would overwrite the one being played or the one after it, or that is not
+* later than the point before it; those are counted in dropped().
+*/
+class TrajectoryBuffer {
+public:
+    static constexpr uint16_t ring_size = 256;
+
+    struct Point {
+        float time;     // s from the trajectory's start
+        float position; // turns
+        float velocity; // turns/s
+        float torque;   // Nm
+    };
+
+    // loop(): an upload
+    void begin(bool replace);
+    bool add(float time, float position, float velocity, float torque);
+    void commit();
+
+    // control interrupt: the setpoint at now_us, false if there is none
+    bool sample(uint32_t now_us, Point& out);
+
+    bool finished() const { return finished_; }
+    uint32_t dropped() const { return dropped_; }
+    // Points queued and not yet played past
+    uint16_t queued() const { return (end_ - cursor_) & index_mask; }
+
+private:
+    // indices run modulo index_mask + 1, a multiple of ring_size, so the free
+    // space is a difference and a whole ring never looks empty
+    static constexpr uint16_t index_mask = 0xFFF;
+    static_assert((ring_size & (ring_size - 1)) == 0 && ring_size <= index_mask / 2,
+                  "ring_size is a power of two within the index range");
+
+    static uint32_t pack(uint8_t generation, uint16_t start, uint16_t end) {
+        return ((uint32_t)generation << 24) | ((uint32_t)start << 12) | end;
+    }
+    const Point& at(uint16_t index) const { return ring_[index & (ring_size - 1)]; }
+
+    Point ring_[ring_size] = {};
+    volatile uint32_t commit_ = 0; // generation, start, end; generation 0 is no trajectory
+
+    // loop()'s side
+    uint16_t end_ = 0;             // after the last committed point
+    uint16_t pending_start_ = 0;
+    uint16_t pending_end_ = 0;
+    uint8_t generation_ = 0;
+    bool replace_ = false;
+    float last_time_ = 0.0f;
+    float committed_time_ = 0.0f;
+    uint32_t dropped_ = 0;
+
+    // sample()'s side
+    volatile uint16_t cursor_ = 0;  // the point being played from
+    uint8_t playing_ = 0;           // generation of the trajectory being played
+    uint32_t start_us_ = 0;
+    volatile bool finished_ = false;
+};
+
+#endif //TrajectoryBuffer_h
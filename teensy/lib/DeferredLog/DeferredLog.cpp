@@ -0,0 +1,92 @@
+#include "DeferredLog.h"
+
+namespace {
+    // Decimal digits of v at the end of buf; returns the first
+    char* digits(uint32_t v, char* end) {
+        do {
+            *--end = '0' + v % 10;
+            v /= 10;
+        } while (v);
+        return end;
+    }
+
+    size_t append(char* line, size_t n, const char* s, size_t length) {
+        if (length > DeferredLog::max_line - n) length = DeferredLog::max_line - n;
+        memcpy(line + n, s, length);
+        return n + length;
+    }
+
+    // As Print::print(float): two decimals, "nan", "inf" and "ovf"
+    size_t appendFloat(char* line, size_t n, float v) {
+        if (isnan(v)) return append(line, n, "nan", 3);
+        if (isinf(v)) return append(line, n, v < 0.0f ? "-inf" : "inf", v < 0.0f ? 4 : 3);
+        if (v > 4294967040.0f || v < -4294967040.0f) return append(line, n, "ovf", 3);
+        char buf[16];
+        char* end = buf + sizeof(buf);
+        bool negative = v < 0.0f;
+        if (negative) v = -v;
+        uint32_t hundredths = (uint32_t)((double)v * 100.0 + 0.5);
+        char* p = digits(hundredths % 100 + 100, end);   // keep the leading zero
+        *p = '.';
+        p = digits(hundredths / 100, p);
+        if (negative) *--p = '-';
+        return append(line, n, p, end - p);
+    }
+}
+
+size_t DeferredLog::format(const Entry& e, char* line) {
+    size_t n = 0;
+    int arg = 0;
+    for (const char* f = e.format; *f && n < max_line; ++f) {
+        if (f[0] != '{' || f[1] != '}' || arg >= e.count) {
+            line[n++] = *f;
+            continue;
+        }
+        ++f;
+        const Arg& a = e.args[arg];
+        char buf[12];
+        char* end = buf + sizeof(buf);
+        char* p;
+        switch ((e.types >> (2*arg)) & 3) {
+            case INT:
+                p = digits(a.i < 0 ? 0u - (uint32_t)a.i : (uint32_t)a.i, end);
+                if (a.i < 0) *--p = '-';
+                n = append(line, n, p, end - p);
+                break;
+            case UINT:
+                p = digits(a.u, end);
+                n = append(line, n, p, end - p);
+                break;
+            case FLOAT:
+                n = appendFloat(line, n, a.f);
+                break;
+            default:
+                n = append(line, n, a.s ? a.s : "(null)", a.s ? strlen(a.s) : 6);
+                break;
+        }
+        ++arg;
+    }
+    return n;
+}
+
+uint32_t DeferredLog::service(uint32_t max_entries) {
+    uint32_t done = 0;
+    while (done < max_entries) {
+        if (line_length_ == 0) {
+            uint32_t tail = tail_;
+            const Entry& e = ring_[tail & (ring_entries - 1)];
+            // not yet logged, or claimed and still being filled
+            if (__atomic_load_n(&e.sequence, __ATOMIC_ACQUIRE) != tail + 1)
+                break;
+            line_length_ = format(e, line_);
+            __atomic_store_n(&tail_, tail + 1, __ATOMIC_RELEASE);
+        }
+        // whole lines only, so this never waits and lines never interleave
+        if (out_.availableForWrite() < (int)line_length_)
+            break;
+        out_.write((const uint8_t*)line_, line_length_);
+        line_length_ = 0;
+        ++done;
+    }
+    return done;
+}
@@ -0,0 +1,109 @@
+#ifndef DeferredLog_h
+#define DeferredLog_h
+
+#include "Arduino.h"
+
+/* Debug text that costs the caller a copy, not a print.
+*
+* log() stores the format pointer and the raw argument values in a RAM ring
+* and returns; service() in loop() formats the oldest entries and writes each
+* one only when the port reports room for the whole line (availableForWrite),
+* so neither the caller nor loop() ever waits on the USB or UART.
+*
+*     debugLog.log("Axis{}: Requesting state {}\n", axis, state);
+*
+* The format is a string literal and doubles as the entry's ID: nothing is
+* parsed until service(). Each {} takes the next argument, printed in its own
+* type: integers in decimal, floats with two decimals like Print::print, and
+* C strings, which must outlive the entry (literals, name() strings).
+*
+* Any context may log, interrupts included: a slot is claimed with a
+* compare-and-swap on the head and published by its sequence stamp once
+* filled, so a producer preempted mid-entry only holds back the lines after
+* it. When the ring is full the new entry is dropped and counted.
+*/
+class DeferredLog {
+public:
+    static constexpr uint32_t ring_entries = 128;  // power of two
+    static constexpr int max_args = 8;
+    static constexpr size_t max_line = 160;        // longer lines are cut
+    static_assert((ring_entries & (ring_entries - 1)) == 0, "the ring index wraps with a mask");
+
+    explicit DeferredLog(Print& out) : out_(out) {}
+
+    // false if the ring was full
+    template<class... Args>
+    bool log(const char* format, Args... args) {
+        static_assert(sizeof...(Args) <= max_args, "too many arguments for one entry");
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+        do {
+            if (head - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE) >= ring_entries) {
+                __atomic_fetch_add(&dropped_, 1, __ATOMIC_RELAXED);
+                return false;
+            }
+        } while (!__atomic_compare_exchange_n(&head_, &head, head + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+        Entry& e = ring_[head & (ring_entries - 1)];
+        e.format = format;
+        e.count = 0;
+        e.types = 0;
+        store(e, args...);
+        __atomic_store_n(&e.sequence, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // From loop(): write out entries while the port has room; returns how many
+    uint32_t service(uint32_t max_entries = ring_entries);
+
+    uint32_t logged() const { return head_; }
+    uint32_t dropped() const { return dropped_; }
+    uint32_t pending() const { return head_ - tail_; }
+
+private:
+    enum Type : uint8_t { INT, UINT, FLOAT, STRING };
+
+    union Arg {
+        int32_t i;
+        uint32_t u;
+        float f;
+        const char* s;
+    };
+
+    struct Entry {
+        const char* format;
+        uint32_t sequence;      // index + 1 once complete
+        uint16_t types;         // two bits per argument
+        uint8_t count;
+        Arg args[max_args];
+    };
+
+    static void store(Entry&) {}
+    template<class T, class... Rest>
+    static void store(Entry& e, T first, Rest... rest) {
+        put(e, first);
+        store(e, rest...);
+    }
+    static void put(Entry& e, float v) { e.args[e.count].f = v; tag(e, FLOAT); }
+    static void put(Entry& e, double v) { put(e, (float)v); }
+    static void put(Entry& e, const char* v) { e.args[e.count].s = v; tag(e, STRING); }
+    static void put(Entry& e, char* v) { put(e, (const char*)v); }
+    // int32_t is long on the Teensy and int on a host, so both are spelled out
+    static void put(Entry& e, int v) { e.args[e.count].i = v; tag(e, INT); }
+    static void put(Entry& e, unsigned v) { e.args[e.count].u = v; tag(e, UINT); }
+    static void put(Entry& e, long v) { put(e, (int)v); }
+    static void put(Entry& e, unsigned long v) { put(e, (unsigned)v); }
+    static void put(Entry& e, bool v) { put(e, (int)v); }
+    static void tag(Entry& e, Type t) { e.types |= (uint16_t)t << (2*e.count); ++e.count; }
+
+    // The entry as text into line, at most max_line bytes; returns the length
+    static size_t format(const Entry& e, char* line);
+
+    Print& out_;
+    uint32_t head_ = 0;         // claimed by log()
+    uint32_t tail_ = 0;         // advanced by service() only
+    uint32_t dropped_ = 0;
+    char line_[max_line];
+    size_t line_length_ = 0;    // formatted, waiting for room on the port
+    Entry ring_[ring_entries];
+};
+
+#endif //DeferredLog_h
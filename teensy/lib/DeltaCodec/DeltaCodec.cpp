@@ -0,0 +1,44 @@
+#include "DeltaCodec.h"
+#include <math.h>
+#include <string.h>
+
+DeltaEncoder::DeltaEncoder(uint8_t channels, uint16_t keyframe_interval)
+    : channels_(channels > max_channels ? max_channels : channels),
+      keyframe_interval_(keyframe_interval < 1 ? 1 : keyframe_interval) {}
+
+bool DeltaEncoder::beginFrame() {
+    if (since_keyframe_ >= keyframe_interval_) keyframe_due_ = true;
+    if (!keyframe_due_) return false;
+    memset(previous_, 0, sizeof(previous_));
+    since_keyframe_ = 0;
+    keyframe_due_ = false;
+    ++keyframes_;
+    return true;
+}
+
+bool DeltaEncoder::add(const int32_t* values, uint8_t*& out, const uint8_t* end) {
+    if ((size_t)(end - out) < maxSampleBytes()) return false;
+    for (uint8_t c = 0; c < channels_; ++c) {
+        out = putVarint(zigzag((int32_t)((uint32_t)values[c] - (uint32_t)previous_[c])), out);
+        previous_[c] = values[c];
+    }
+    if (since_keyframe_ < keyframe_interval_) ++since_keyframe_;
+    return true;
+}
+
+int32_t DeltaEncoder::quantize(float value, float lsb) {
+    float q = roundf(value / lsb);
+    if (q != q) return 0;
+    if (q <= -2147483520.0f) return INT32_MIN;
+    if (q >= 2147483520.0f) return INT32_MAX;
+    return (int32_t)q;
+}
+
+uint8_t* DeltaEncoder::putVarint(uint32_t v, uint8_t* out) {
+    while (v >= 0x80) {
+        *out++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *out++ = (uint8_t)v;
+    return out;
+}
@@ -0,0 +1,58 @@
+#ifndef DeltaCodec_h
+#define DeltaCodec_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Delta coding of integer channel samples, for telemetry whose values move
+* little from one tick to the next.
+*
+* Each sample is channels int32 values, already quantized (quantize()). A
+* channel goes out as its change from the previous sample, zig-zag mapped
+* (0, -1, 1, -2, ... to 0, 1, 2, 3, ...) and written as a little-endian
+* base-128 varint, so a small step of either sign takes one or two bytes.
+* Differences wrap modulo 2^32, so a micros() stamp can be a channel too.
+*
+* A frame is one or more samples. beginFrame() makes it a keyframe every
+* keyframe_interval samples, or after reset(): the previous sample is taken
+* as all zeros, so its first sample is absolute and a decoder that lost a
+* frame (a gap in its frame count) is whole again from it on. The decoder
+* mirrors this: zeros on a keyframe, then each varint added to its channel.
+*
+* No Arduino dependency.
+*/
+class DeltaEncoder {
+public:
+    static constexpr uint8_t max_channels = 16;
+    static constexpr uint8_t max_varint = 5; // bytes of a zig-zag int32
+
+    DeltaEncoder(uint8_t channels, uint16_t keyframe_interval);
+
+    // Start a frame; true if it is a keyframe
+    bool beginFrame();
+    // Append one sample at out, moved past it; false, and nothing written, if end is
+    // closer than maxSampleBytes()
+    bool add(const int32_t* values, uint8_t*& out, const uint8_t* end);
+    // Make the next frame a keyframe
+    void reset() { keyframe_due_ = true; }
+
+    uint8_t channels() const { return channels_; }
+    size_t maxSampleBytes() const { return (size_t)channels_ * max_varint; }
+    uint32_t keyframes() const { return keyframes_; }
+
+    // value/lsb rounded, saturated to the int32 range; NaN is 0
+    static int32_t quantize(float value, float lsb);
+    static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+    static int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+    static uint8_t* putVarint(uint32_t v, uint8_t* out);
+
+private:
+    uint8_t channels_;
+    uint16_t keyframe_interval_;
+    uint16_t since_keyframe_ = 0;
+    bool keyframe_due_ = true;
+    uint32_t keyframes_ = 0;
+    int32_t previous_[max_channels] = {};
+};
+
+#endif //DeltaCodec_h
@@ -0,0 +1,62 @@
+#ifndef ConstexprMath_h
+#define ConstexprMath_h
+
+/* constexpr stand-ins for the libm calls of constants, so a filter design
+* with a fixed cutoff and rate (libFilter) or the impact map's terms of the
+* wheel's parameters (ImpactMap) fold at compile time instead of running
+* libm in a constructor. Double precision throughout; the callers round to
+* float once, at the end:
+*
+*     static constexpr float cos_alpha = cx::cos(alpha);
+*
+* Not for run time: the loops cost far more than libm or fastmath. Well
+* under float precision over the arguments the callers fold, a few turns
+* for sin and cos, a few tens for exp.
+*/
+namespace cx {
+    constexpr double fabs(double x) { return x < 0.0 ? -x : x; }
+
+    // Wrapped to [-pi, pi], where 14 Taylor terms reach double precision
+    constexpr double wrap(double x) {
+        while (x > 3.14159265358979324) x -= 6.28318530717958648;
+        while (x < -3.14159265358979324) x += 6.28318530717958648;
+        return x;
+    }
+
+    constexpr double sin(double x) {
+        x = wrap(x);
+        double term = x, sum = x;
+        for (int k = 1; k < 14; k++) {
+            term *= -x*x/((2.0*k)*(2.0*k + 1.0));
+            sum += term;
+        }
+        return sum;
+    }
+    constexpr double cos(double x) {
+        x = wrap(x);
+        double term = 1.0, sum = 1.0;
+        for (int k = 1; k < 14; k++) {
+            term *= -x*x/((2.0*k - 1.0)*(2.0*k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Halve the argument below 1/2, Taylor series, square back up
+    constexpr double exp(double x) {
+        int halvings = 0;
+        while (fabs(x) > 0.5) {
+            x *= 0.5;
+            halvings++;
+        }
+        double term = 1.0, sum = 1.0;
+        for (int k = 1; k < 16; k++) {
+            term *= x/k;
+            sum += term;
+        }
+        while (halvings-- > 0) sum *= sum;
+        return sum;
+    }
+}
+
+#endif //ConstexprMath_h
@@ -0,0 +1,134 @@
+#ifndef FastMath_h
+#define FastMath_h
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Float elementary functions with bounded error and the same bits on the
+* Teensy's M7 and on the host, so a replay of the firmware's arithmetic on
+* the host or the Pi is the firmware's arithmetic.
+*
+* libm is not that: newlib's sinf, atan2f and expm1f and glibc's round
+* differently, and GCC contracts a*b + c into a fused multiply-add on the
+* M7's FPU (-ffp-contract=fast is the GNU default) but not on an x86 without
+* FMA, so one polynomial gives two answers. Here every multiply-add is an
+* explicit fmaf(), a single vfma.f32 on the M7 and libm's correctly rounded
+* fmaf on the host, and nothing else in an expression is left for the
+* compiler to fuse. Division and sqrtf (vsqrt.f32) are correctly rounded on
+* both. None of it holds under -ffast-math.
+*
+* Bounds against the double-precision functions, over the ranges the wheel
+* sees, from the host's exhaustive sweeps:
+*
+*     sincos(x)    9.2e-8 absolute for |x| <= 100, Cody-Waite reduction to
+*                  a quarter turn, the cephes sinf/cosf polynomials
+*     exp2(x)      3.5e-6 relative, a quartic on the fraction through the
+*                  Chebyshev nodes of [0, 1] and 2^n in the exponent bits;
+*                  exp(x) 4.6e-6 relative and expm1(x) 3.5e-6 absolute
+*                  for x <= 0 are built on it
+*     atan2(y, x)  2.8e-7 rad, octant reduction to |t| <= tan(pi/8) and
+*                  cephes' atanf polynomial; asin(x) is atan2(x, sqrt(1 - x^2))
+*     sqrt(x)      sqrtf, exact
+*
+* Inputs are finite: there is no NaN or infinity handling beyond what falls
+* out, and exp2() saturates to 0 below -126 and to infinity above 128.
+*/
+
+namespace fastmath {
+
+constexpr float pi = 3.14159265f;
+constexpr float half_pi = 1.57079633f;
+constexpr float quarter_pi = 0.785398163f;
+
+inline float sqrt(float x) { return sqrtf(x); }
+
+inline void sincos(float x, float& s, float& c) {
+    // x = k pi/2 + r with |r| <= pi/4, pi/2 split in three so r is exact up to |x| ~ 1e4
+    const int k = (int)fmaf(x, 0.636619772f, x < 0.0f ? -0.5f : 0.5f);
+    const float kf = (float)k;
+    const float r = fmaf(-kf, 7.54978995489e-8f, fmaf(-kf, 4.83751296997e-4f, fmaf(-kf, 1.5703125f, x)));
+    const float z = r*r;
+    const float sr = fmaf(r*z, fmaf(fmaf(-1.9515295891e-4f, z, 8.3321608736e-3f), z, -1.6666654611e-1f), r);
+    const float cr = fmaf(z*z, fmaf(fmaf(2.443315711809948e-5f, z, -1.388731625493765e-3f), z, 4.166664568298827e-2f),
+                          fmaf(-0.5f, z, 1.0f));
+    switch (k & 3) {
+    case 0: s = sr; c = cr; break;
+    case 1: s = cr; c = -sr; break;
+    case 2: s = -sr; c = -cr; break;
+    default: s = -cr; c = sr; break;
+    }
+}
+
+inline float sin(float x) { float s, c; sincos(x, s, c); return s; }
+inline float cos(float x) { float s, c; sincos(x, s, c); return c; }
+
+namespace detail {
+
+// 2^f for f in [0, 1)
+inline float exp2Fraction(float f) {
+    return fmaf(fmaf(fmaf(fmaf(0.0136703095f, f, 0.0517449978f), f, 0.241604357f), f, 0.692972922f), f, 1.00000349f);
+}
+
+// 2^n straight into the exponent field, n in [-126, 127]
+inline float exp2Integer(float n) {
+    const int32_t bits = ((int32_t)n + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return scale;
+}
+
+} // namespace detail
+
+inline float exp2(float x) {
+    const float n = floorf(x);
+    if (n < -126.0f) return 0.0f;
+    if (n > 127.0f) return INFINITY;
+    return detail::exp2Fraction(x - n)*detail::exp2Integer(n);
+}
+
+// x log2(e) = n + f, the fraction taken from the unrounded product so there
+// is no separate multiply for the compiler to contract one way or the other
+inline float exp(float x) {
+    const float n = floorf(x*1.44269504f);
+    if (n < -126.0f) return 0.0f;
+    if (n > 127.0f) return INFINITY;
+    return detail::exp2Fraction(fmaf(x, 1.44269504f, -n))*detail::exp2Integer(n);
+}
+
+// exp(x) - 1, elu's negative branch, the -1 fused into the scaling
+inline float expm1(float x) {
+    const float n = floorf(x*1.44269504f);
+    if (n < -126.0f) return -1.0f;
+    if (n > 127.0f) return INFINITY;
+    return fmaf(detail::exp2Fraction(fmaf(x, 1.44269504f, -n)), detail::exp2Integer(n), -1.0f);
+}
+
+inline float atan2(float y, float x) {
+    const float ax = fabsf(x), ay = fabsf(y);
+    const bool steep = ay > ax;
+    const float hi = steep ? ay : ax, lo = steep ? ax : ay;
+    if (hi == 0.0f)
+        return signbit(x) ? copysignf(pi, y) : y;
+    // atan(t) for t in [0, 1], past tan(pi/8) as pi/4 + atan((t - 1)/(t + 1))
+    float t = lo / hi, a = 0.0f;
+    if (t > 0.414213562f) {
+        t = (t - 1.0f) / (t + 1.0f);
+        a = quarter_pi;
+    }
+    const float z = t*t;
+    const float p = fmaf(fmaf(fmaf(8.05374449538e-2f, z, -1.38776856032e-1f), z, 1.99777106478e-1f), z,
+                         -3.33329491539e-1f);
+    a += fmaf(t*z, p, t);
+    if (steep) a = half_pi - a;
+    if (signbit(x)) a = pi - a;
+    return copysignf(a, y);
+}
+
+inline float atan(float x) { return atan2(x, 1.0f); }
+
+inline float asin(float x) { return atan2(x, sqrtf(fmaf(-x, x, 1.0f))); }
+
+} // namespace fastmath
+
+#endif //FastMath_h
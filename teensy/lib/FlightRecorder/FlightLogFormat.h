@@ -0,0 +1,131 @@
+#ifndef FlightLogFormat_h
+#define FlightLogFormat_h
+
+#include <stdint.h>
+
+/* On-medium layout of a flight log, shared by the firmware (FlightRecorder)
+* and the host tools (raspi_pkg flightlog_to_bson), so no Arduino headers.
+*
+* A log is one FlightLogHeader, padded with zeros to a whole block of
+* FlightLogHeader::block_bytes, followed by FlightRecords back to back. Both
+* are little-endian and laid out without padding. Blocks padded at the end of
+* a run hold zero records, stamp and status 0. The tick period is the
+* difference of consecutive stamps.
+*
+* From version 3 the records are interleaved with FlightEventRecords, told
+* apart by FlightEventRecord::MARKER in the status byte (no STATUS_* bits
+* reach it). One precedes the sample record its events happened at and
+* indexes it by record, the count of sample records before it in the log, so
+* a reader can list impacts, E-stops, ODrive faults, controller swaps,
+* benchmark rates and link modes and go to them without decoding the samples in between. Version 2 logs are the
+* same without event records.
+*
+* From version 4 a FlightHealthRecord, FlightHealthRecord::MARKER in the
+* same byte, comes about once a second: the firmware's performance counters
+* over the last second (HealthMonitor), so a log says how the loop kept up
+* without the diagnostics that went over the link. A version 3 reader would
+* take them for samples.
+*/
+struct FlightRecord {
+    uint32_t stamp_us;      // sample time, micros()
+    uint8_t status;         // SensorState::STATUS_* bits
+    uint8_t errors;         // bit i: ODriveErrorMonitor register i is non-zero
+    uint16_t latency_us;    // sense to actuate
+    float gyro[3];          // rad/s, calibrated
+    float accel[3];         // m/s^2, calibrated
+    float spoke[4];         // spoke 0/1 angle, spoke 0/1 rate
+    float torso[3];         // roll, roll rate, yaw
+    float torque;           // commanded hip torque, Nm
+};
+
+struct FlightEvent {
+    enum Kind : uint8_t {
+        IMPACT = 1,         // value: ImpactDetector::cues(), 0 for a spoke count change
+        ESTOP_ON,
+        ESTOP_OFF,
+        ODRIVE_ERRORS,      // value: the new FlightRecord::errors bits
+        CONTROLLER,         // value: index in pbc_controller's controller list
+        BENCHMARK,          // value: the StepBenchmark rate starting, Hz; 0 when it ends
+        LINK_MODE,          // value: the LinkGovernor mode entered
+    };
+    uint32_t record;        // sample records before the one it happened at
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t value;
+};
+
+struct FlightEventRecord {
+    uint32_t stamp_us;      // of the sample record that follows
+    uint8_t marker;         // FlightEventRecord::MARKER, in FlightRecord::status
+    uint8_t count;          // events used
+    uint16_t reserved;
+    FlightEvent events[7];
+    static constexpr uint8_t MARKER = 0xE5;
+    static constexpr uint8_t capacity = 7;
+};
+
+// Counters of one window, normally a second; a field whose source is not in
+// sources is zero. Times over UINT16_MAX saturate
+struct FlightHealthRecord {
+    enum Source : uint16_t {
+        STEP = 1 << 0,      // CycleProfiler: step_*, imu_max_us, encoder_*
+        LOOP = 1 << 1,      // LoopTiming
+        CPU = 1 << 2,       // CpuLoad
+        LINK = 1 << 3,      // LinkScheduler
+        I2C = 1 << 4,       // AsyncI2C, bus_max_permille
+        COMMAND = 1 << 5,   // CommandLatency
+        ODRIVE = 1 << 6,    // ODriveErrorMonitor
+        BACKGROUND = 1 << 7,
+        MEMORY = 1 << 8,
+    };
+    uint32_t stamp_us;      // of the sample record that follows
+    uint8_t marker;         // FlightHealthRecord::MARKER, in FlightRecord::status
+    uint8_t level;          // the worst diagnostic_msgs::DiagnosticStatus level of the window
+    uint16_t sources;       // Source bits of the fields filled in
+    uint16_t step_mean_dus; // control step, 0.1 us
+    uint16_t step_p99_dus;
+    uint16_t step_max_dus;
+    uint16_t imu_max_us;    // the IMU read's longest
+    uint16_t encoder_p99_us;// the ODrive exchange, its p99 and longest
+    uint16_t encoder_max_us;
+    uint16_t misses;        // ticks LoopTiming counted late
+    uint16_t jitter_us;     // longest less shortest tick period
+    uint16_t latency_mean_us;
+    uint16_t latency_max_us;
+    uint16_t load_permille; // CpuLoad: the whole core, and the control step's part
+    uint16_t control_permille;
+    uint8_t queue_depth[2]; // LinkScheduler frames queued, status and telemetry
+    uint16_t link_dropped;  // frames either queue dropped in the window
+    uint16_t sensor_dropped;// sensor frames dropped for a full USB buffer in the window
+    uint16_t bus_max_permille[2]; // Wire and Wire1, the busiest tick
+    uint16_t command_p50_us;// sensor seq to echoed /torso_command
+    uint16_t command_p99_us;
+    uint16_t command_lost;
+    uint16_t overruns;      // control steps ControlScheduler found still running, in the window
+    uint16_t over_slice;    // background slices over their budget, all jobs
+    uint8_t odrive_errors;  // FlightRecord::errors bits now
+    uint8_t reserved[3];
+    uint32_t stack_used;    // MemoryBudget's stack high-water, bytes
+    uint32_t reserved2;
+    static constexpr uint8_t MARKER = 0xE6;
+};
+
+struct FlightLogHeader {
+    uint32_t magic;         // FlightLogHeader::MAGIC
+    uint16_t version;
+    uint16_t record_size;   // sizeof(FlightRecord)
+    uint32_t period_us;     // nominal tick
+    uint32_t start_ms;      // millis() at begin()
+    static constexpr uint32_t MAGIC = 0x31574652; // "RFW1"
+    static constexpr uint16_t VERSION = 4;
+    static constexpr uint16_t FIRST_VERSION = 2;    // oldest readers still take, no events
+    static constexpr uint32_t block_bytes = 8192;
+};
+
+static_assert(sizeof(FlightRecord) == 64, "records are packed 8 to a 512-byte sector");
+static_assert(sizeof(FlightEvent) == 8 && sizeof(FlightEventRecord) == sizeof(FlightRecord),
+              "event records take a record's slot");
+static_assert(sizeof(FlightHealthRecord) == sizeof(FlightRecord), "health records take a record's slot");
+static_assert(sizeof(FlightLogHeader) == 16, "the header layout is part of the log format");
+
+#endif //FlightLogFormat_h
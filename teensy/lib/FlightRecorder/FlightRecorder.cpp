@@ -0,0 +1,159 @@
+#include "Arduino.h"
+#include "FlightRecorder.h"
+
+constexpr uint32_t FlightLogHeader::MAGIC;
+constexpr uint16_t FlightLogHeader::VERSION;
+constexpr uint16_t FlightLogHeader::FIRST_VERSION;
+constexpr uint8_t FlightEventRecord::MARKER;
+constexpr uint8_t FlightEventRecord::capacity;
+constexpr uint8_t FlightHealthRecord::MARKER;
+constexpr uint32_t FlightLogHeader::block_bytes;
+constexpr uint32_t FlightRecorder::block_records;
+constexpr uint32_t FlightRecorder::ring_blocks;
+constexpr uint32_t FlightRecorder::ring_records;
+constexpr uint32_t FlightRecorder::block_bytes;
+
+FlightRecorder::FlightRecorder(FlightLogSink& sink, uint32_t sync_every)
+    : sink_(sink), sync_every_(sync_every) {}
+
+bool FlightRecorder::begin(uint32_t period_us, uint32_t capacity) {
+    active_ = false;
+    head_ = tail_ = 0;
+    dropped_ = 0;
+    written_ = 0;
+    samples_ = 0;
+    events_ = events_dropped_ = 0;
+    pending_.count = 0;
+    health_pending_ = false;
+    health_records_ = 0;
+    offset_ = 0;
+    capacity_ = capacity - capacity % block_bytes;
+    if (capacity_ < 2 * block_bytes || !sink_.open(capacity_))
+        return false;
+
+    // the header takes the first block so records stay block aligned; the
+    // ring is still empty, so its first block is the scratch buffer
+    uint8_t* block = (uint8_t*)ring_;
+    memset(block, 0, block_bytes);
+    FlightLogHeader header;
+    header.magic = FlightLogHeader::MAGIC;
+    header.version = FlightLogHeader::VERSION;
+    header.record_size = sizeof(FlightRecord);
+    header.period_us = period_us;
+    header.start_ms = millis();
+    memcpy(block, &header, sizeof(header));
+    if (!writeBlock(block) || !sink_.sync()) {
+        sink_.close();
+        return false;
+    }
+    active_ = true;
+    return true;
+}
+
+void FlightRecorder::event(uint8_t kind, uint16_t value) {
+    if (!active_)
+        return;
+    if (pending_.count == FlightEventRecord::capacity) {
+        ++events_dropped_;
+        return;
+    }
+    FlightEvent& e = pending_.events[pending_.count++];
+    e.kind = kind;
+    e.reserved = 0;
+    e.value = value;
+}
+
+void FlightRecorder::health(const FlightHealthRecord& h) {
+    if (!active_)
+        return;
+    noInterrupts();
+    pending_health_ = h;
+    health_pending_ = true;
+    interrupts();
+}
+
+bool FlightRecorder::record(const FlightRecord& r) {
+    if (!active_)
+        return false;
+    uint32_t head = head_;
+    uint32_t slots = 1 + (pending_.count ? 1 : 0) + (health_pending_ ? 1 : 0);
+    if (head - tail_ + slots > ring_records) {
+        dropped_ = dropped_ + 1;
+        return false;
+    }
+    if (pending_.count) {
+        // the events index this sample, the next one in the log
+        pending_.stamp_us = r.stamp_us;
+        pending_.marker = FlightEventRecord::MARKER;
+        pending_.reserved = 0;
+        for (uint8_t i = 0; i < pending_.count; ++i) pending_.events[i].record = samples_;
+        memset(pending_.events + pending_.count, 0, (FlightEventRecord::capacity - pending_.count) * sizeof(FlightEvent));
+        memcpy(&ring_[head % ring_records], &pending_, sizeof(pending_));
+        events_ += pending_.count;
+        pending_.count = 0;
+        ++head;
+    }
+    if (health_pending_) {
+        pending_health_.stamp_us = r.stamp_us;
+        pending_health_.marker = FlightHealthRecord::MARKER;
+        memcpy(&ring_[head % ring_records], &pending_health_, sizeof(pending_health_));
+        health_pending_ = false;
+        ++health_records_;
+        ++head;
+    }
+    ring_[head % ring_records] = r;
+    ++samples_;
+    head_ = head + 1;
+    return true;
+}
+
+bool FlightRecorder::service() {
+    if (!active_ || head_ - tail_ < block_records)
+        return false;
+    uint32_t tail = tail_;
+    if (offset_ + block_bytes > capacity_) {
+        // full: keep what is on the medium, stop recording
+        active_ = false;
+        sink_.sync();
+        sink_.close();
+        return false;
+    }
+    bool ok = writeBlock((const uint8_t*)&ring_[tail % ring_records]);
+    tail_ = tail + block_records;
+    if (ok) written_ += block_records;
+    if (sync_every_ && (offset_ / block_bytes) % sync_every_ == 0)
+        sink_.sync();
+    return ok;
+}
+
+void FlightRecorder::stop() {
+    if (!active_)
+        return;
+    while (service()) {}
+    noInterrupts();
+    active_ = false;
+    uint32_t tail = tail_, left = head_ - tail;
+    interrupts();
+    if (left > 0 && offset_ + block_bytes <= capacity_) {
+        // the partial block is padded with zero records (stamp 0, status 0)
+        FlightRecord* block = &ring_[tail % ring_records];
+        memset(block + left, 0, (block_records - left) * sizeof(FlightRecord));
+        if (writeBlock((const uint8_t*)block)) written_ += left;
+        tail_ = tail + left;
+    }
+    sink_.sync();
+    sink_.close();
+}
+
+bool FlightRecorder::writeBlock(const uint8_t* data) {
+    uint32_t start = micros();
+    bool ok = sink_.write(data, block_bytes);
+    uint32_t elapsed = micros() - start;
+    if (elapsed > max_write_us_) max_write_us_ = elapsed;
+    if (!ok) {
+        ++write_errors_;
+        return false;
+    }
+    offset_ += block_bytes;
+    return true;
+}
@@ -0,0 +1,105 @@
+#ifndef FlightRecorder_h
+#define FlightRecorder_h
+
+#include "Arduino.h"
+#include "FlightLogFormat.h"
+
+/* Binary flight recorder: one fixed-size record per control tick into a RAM
+* ring, written out in large blocks from loop().
+*
+* record() is called from the control tick and only copies 64 bytes into the
+* ring; it never touches the storage. service() runs in the background and,
+* whenever a whole block of records is buffered, hands it to the sink in one
+* contiguous write. Blocks are a multiple of 512 bytes, so a card or flash
+* page is never written partially, and the ring is a whole number of blocks,
+* so a block is never split at the wrap. If the background falls behind by a
+* whole ring the newest records are dropped and counted, the tick never waits.
+*
+* event() queues an impact, E-stop edge or fault from the tick; its events go
+* out as one FlightEventRecord ahead of the tick's record(), indexed by it.
+* health() hands a FlightHealthRecord over from loop() the same way; the
+* next record() puts it ahead of its sample, so head_ keeps one writer.
+*
+* The record and header layout is in FlightLogFormat.h.
+*/
+
+// Where the blocks go; writes are whole blocks at increasing offsets
+class FlightLogSink {
+public:
+    virtual ~FlightLogSink() {}
+
+    // Prepare for up to capacity bytes; false if the medium is not there
+    virtual bool open(uint32_t capacity) = 0;
+    virtual bool write(const uint8_t* data, uint32_t length) = 0;
+    // Make what was written so far survive a power loss
+    virtual bool sync() { return true; }
+    virtual void close() {}
+    virtual const char* name() const = 0;
+};
+
+class FlightRecorder {
+public:
+    static constexpr uint32_t block_records = 128;          // 8 KiB per write
+    static constexpr uint32_t ring_blocks = 4;              // 32 KiB, 5 s at 100 Hz
+    static constexpr uint32_t ring_records = block_records * ring_blocks;
+    static constexpr uint32_t block_bytes = block_records * sizeof(FlightRecord);
+    static_assert(block_bytes == FlightLogHeader::block_bytes, "the header pads to one ring block");
+
+    // sync_every: blocks between sync() calls, 0 for only at stop()
+    explicit FlightRecorder(FlightLogSink& sink, uint32_t sync_every = 4);
+
+    // Open the sink for capacity bytes and write the header
+    bool begin(uint32_t period_us, uint32_t capacity);
+    // From the control tick, before the record() of the sample it happened at
+    void event(uint8_t kind, uint16_t value = 0);
+    // From loop(): a window's counters, for the next record(); a newer one replaces one not yet taken
+    void health(const FlightHealthRecord& h);
+    // From the control tick; false if the record was dropped (its events stay queued)
+    bool record(const FlightRecord& r);
+    // From loop(): write at most one full block; true if one was written
+    bool service();
+    // Write what is buffered, padded to a block, and close the sink
+    void stop();
+
+    bool active() const { return active_; }
+    uint32_t recorded() const { return head_; }
+    uint32_t dropped() const { return dropped_; }
+    uint32_t events() const { return events_; }
+    uint32_t eventsDropped() const { return events_dropped_; }
+    uint32_t healthRecords() const { return health_records_; }
+    uint32_t written() const { return written_; }
+    uint32_t writeErrors() const { return write_errors_; }
+    uint32_t maxWrite_us() const { return max_write_us_; }
+
+private:
+    bool writeBlock(const uint8_t* data);
+
+    FlightLogSink& sink_;
+    uint32_t sync_every_;
+    uint32_t capacity_ = 0;
+    uint32_t offset_ = 0;
+    bool active_ = false;
+
+    // head_ is advanced only by record(), tail_ only by service(); both count
+    // records since begin() and index the ring modulo ring_records
+    volatile uint32_t head_ = 0;
+    volatile uint32_t tail_ = 0;
+    volatile uint32_t dropped_ = 0;
+
+    // events of the coming sample record, and the sample records so far
+    FlightEventRecord pending_ = {};
+    uint32_t samples_ = 0;
+    uint32_t events_ = 0;
+    uint32_t events_dropped_ = 0;
+    // written by health() with interrupts off, taken by record()
+    FlightHealthRecord pending_health_ = {};
+    volatile bool health_pending_ = false;
+    uint32_t health_records_ = 0;
+    uint32_t written_ = 0;
+    uint32_t write_errors_ = 0;
+    uint32_t max_write_us_ = 0;
+
+    FlightRecord ring_[ring_records] __attribute__((aligned(32)));
+};
+
+#endif //FlightRecorder_h
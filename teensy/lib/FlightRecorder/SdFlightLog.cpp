@@ -0,0 +1,48 @@
+#include "Arduino.h"
+#include "SdFlightLog.h"
+
+bool SdFlightLog::open(uint32_t capacity) {
+    if (!mounted_) {
+        #if defined(BUILTIN_SDCARD) && defined(HAS_SDIO_CLASS)
+            if (cs_pin_ == BUILTIN_SDCARD)
+                mounted_ = sd_.begin(SdioConfig(FIFO_SDIO));
+            else
+        #endif
+        mounted_ = sd_.begin(SdSpiConfig(cs_pin_, DEDICATED_SPI, SD_SCK_MHZ(spi_mhz_)));
+        if (!mounted_)
+            return false;
+    }
+
+    for (int n = 0; n < 100; ++n) {
+        snprintf(path_, sizeof(path_), "FLIGHT%02d.BIN", n);
+        if (!sd_.exists(path_))
+            break;
+        if (n == 99)
+            return false;
+    }
+    if (!file_.open(&sd_, path_, O_RDWR | O_CREAT | O_TRUNC))
+        return false;
+    if (!file_.preAllocate(capacity)) {
+        file_.close();
+        sd_.remove(path_);
+        return false;
+    }
+    written_ = 0;
+    return true;
+}
+
+bool SdFlightLog::write(const uint8_t* data, uint32_t length) {
+    if (!file_.isOpen())
+        return false;
+    size_t n = file_.write(data, length);
+    written_ += n;
+    return n == length;
+}
+
+void SdFlightLog::close() {
+    if (!file_.isOpen())
+        return;
+    // give back the pre-allocated clusters that were never written
+    file_.truncate(written_);
+    file_.close();
+}
@@ -0,0 +1,41 @@
+#ifndef SdFlightLog_h
+#define SdFlightLog_h
+
+#include "Arduino.h"
+#include <SdFat.h>
+#include "FlightRecorder.h"
+
+/* FlightLogSink on an SD card through SdFat.
+*
+* open() picks the next free name (FLIGHT00.BIN, FLIGHT01.BIN, ...) and
+* pre-allocates the whole capacity as one contiguous extent, so a block write
+* is a plain multi-sector write with no FAT lookups or cluster allocation in
+* it; sync() commits the directory entry so a crash loses at most the blocks
+* since the last sync. close() truncates to what was written.
+*
+* cs_pin is the SPI chip select, or BUILTIN_SDCARD for the Teensy 4.1 SDIO
+* slot.
+*/
+class SdFlightLog final : public FlightLogSink {
+public:
+    explicit SdFlightLog(uint8_t cs_pin, uint8_t spi_mhz = 25) : cs_pin_(cs_pin), spi_mhz_(spi_mhz) {}
+
+    bool open(uint32_t capacity) override;
+    bool write(const uint8_t* data, uint32_t length) override;
+    bool sync() override { return file_.isOpen() && file_.sync(); }
+    void close() override;
+    const char* name() const override { return "sd"; }
+
+    const char* path() const { return path_; }
+
+private:
+    uint8_t cs_pin_;
+    uint8_t spi_mhz_;
+    bool mounted_ = false;
+    uint32_t written_ = 0;
+    char path_[16] = "";
+    SdFs sd_;
+    FsFile file_;
+};
+
+#endif //SdFlightLog_h
@@ -0,0 +1,153 @@
+#include "Arduino.h"
+#include "SpiFlashLog.h"
+
+constexpr uint32_t SpiFlashLog::erase_bytes;
+
+namespace {
+    const uint32_t block_bytes = FlightRecorder::block_bytes;
+    const uint16_t max_runs = 64;
+    const uint32_t dump_chunk = 512;
+}
+
+bool SpiFlashLog::mount() {
+    if (mounted_)
+        return true;
+    if (!flash_.begin())
+        return false;
+    size_ = flash_.size() - flash_.size() % erase_bytes;
+    mounted_ = size_ >= 4 * erase_bytes;
+    return mounted_;
+}
+
+// A block is written if its first 16 bytes are not all erased; a record
+// starts with its stamp and status, a header with the magic
+bool SpiFlashLog::used(uint32_t address) {
+    uint32_t word[4];
+    flash_.readBuffer(address, (uint8_t*)word, sizeof(word));
+    return (word[0] & word[1] & word[2] & word[3]) != 0xFFFFFFFF;
+}
+
+uint32_t SpiFlashLog::findEnd() {
+    const uint32_t blocks = size_ / block_bytes;
+    bool previous = used((blocks - 1) * block_bytes);
+    for (uint32_t i = 0; i < blocks; ++i) {
+        bool current = used(i * block_bytes);
+        if (previous && !current)
+            return i * block_bytes;
+        previous = current;
+    }
+    // a blank chip, or no gap at all (never seen with erase-ahead): start over
+    return 0;
+}
+
+uint16_t SpiFlashLog::scanRuns(Run* runs, uint16_t max) {
+    const uint32_t blocks = size_ / block_bytes;
+    uint32_t end = findEnd() / block_bytes;
+    uint16_t count = 0;
+    // oldest data is just past the erased gap after the end
+    for (uint32_t n = 1; n <= blocks; ++n) {
+        uint32_t address = ((end + n) % blocks) * block_bytes;
+        uint32_t magic = 0;
+        flash_.readBuffer(address, (uint8_t*)&magic, sizeof(magic));
+        if (magic == FlightLogHeader::MAGIC) {
+            if (count == max) {
+                // keep the newest
+                memmove(runs, runs + 1, (max - 1) * sizeof(Run));
+                --count;
+            }
+            runs[count].address = address;
+            runs[count].bytes = 0;
+            ++count;
+        } else if (!used(address)) {
+            continue;
+        }
+        if (count > 0) runs[count - 1].bytes += block_bytes;
+    }
+    return count;
+}
+
+bool SpiFlashLog::open(uint32_t capacity) {
+    if (!mount())
+        return false;
+    flash_.waitUntilReady();
+    start_ = findEnd();
+    written_ = 0;
+    // the rest of the erase block holding the end was cleared with it
+    erased_ = (erase_bytes - start_ % erase_bytes) % erase_bytes;
+    // never run into the erase-ahead window of this run's own start
+    uint32_t limit = size_ - (erase_ahead_ + 1) * erase_bytes;
+    capacity_ = capacity < limit ? capacity : limit;
+    while (erased_ < (uint32_t)erase_ahead_ * erase_bytes) {
+        if (!eraseNext())
+            return false;
+        flash_.waitUntilReady();
+    }
+    open_ = true;
+    return true;
+}
+
+bool SpiFlashLog::eraseNext() {
+    uint32_t address = physical(erased_);
+    if (!flash_.eraseBlock(address / erase_bytes))
+        return false;
+    erased_ += erase_bytes;
+    return true;
+}
+
+bool SpiFlashLog::write(const uint8_t* data, uint32_t length) {
+    if (!open_ || written_ + length > capacity_ || written_ + length > erased_)
+        return false;
+    // the page programs wait for a pending erase themselves
+    uint32_t address = physical(written_);
+    uint32_t first = length;
+    if (address + length > size_) first = size_ - address;
+    bool ok = flash_.writeBuffer(address, data, first) == first;
+    if (ok && first < length)
+        ok = flash_.writeBuffer(0, data + first, length - first) == length - first;
+    written_ += length;
+    // start the next erase and let it run until the next block
+    if (erased_ - written_ < (uint32_t)erase_ahead_ * erase_bytes && erased_ < capacity_ + erase_bytes)
+        eraseNext();
+    return ok;
+}
+
+bool SpiFlashLog::serveDump(Stream& port) {
+    if (!port.available())
+        return false;
+    // peeked, so another command's server on the same port can take it
+    char command = port.peek();
+    if (command != 'L' && command != 'D')
+        return false;
+    port.read();
+    if (!mount()) {
+        port.println("ERR no flash");
+        return true;
+    }
+    flash_.waitUntilReady();
+    static Run runs[max_runs];
+    uint16_t count = scanRuns(runs, max_runs);
+
+    if (command == 'L') {
+        for (uint16_t n = 0; n < count; ++n) {
+            port.print("run "); port.print(n);
+            port.print(' '); port.print(runs[n].address);
+            port.print(' '); port.println(runs[n].bytes);
+        }
+        port.println("END");
+        return true;
+    }
+
+    long n = port.parseInt();
+    if (n < 0 || n >= count) {
+        port.println("ERR no such run");
+        return true;
+    }
+    port.print("BIN "); port.println(runs[n].bytes);
+    uint8_t chunk[dump_chunk];
+    for (uint32_t offset = 0; offset < runs[n].bytes; offset += dump_chunk) {
+        flash_.readBuffer((runs[n].address + offset) % size_, chunk, dump_chunk);
+        port.write(chunk, dump_chunk);
+    }
+    port.flush();
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef SpiFlashLog_h
+#define SpiFlashLog_h
+
+#include "Arduino.h"
+#include <Adafruit_SPIFlash.h>
+#include "FlightRecorder.h"
+
+/* FlightLogSink on a raw SPI/QSPI NOR flash through Adafruit SPIFlash, no
+* file system.
+*
+* The whole chip is one circular, append-only log: a run starts right where
+* the previous one ended and wraps at the end of the chip, overwriting the
+* oldest runs, so every erase block wears at the same rate. Each run starts
+* with its FlightLogHeader block; open() finds the end of the newest run as
+* the one written block followed by an erased one, so nothing but the data
+* itself is kept on the chip.
+*
+* Flash has to be erased before it is programmed, and a 64 KiB erase takes
+* 0.2-2 s. Erases are kept erase_ahead blocks ahead of the write pointer:
+* open() clears the first ones up front, then each write() issues at most
+* one erase and returns without waiting for it, so it runs on the chip while
+* the next records are buffered. A block write is then only page programs,
+* about 20 ms per 8 KiB, which at 500 Hz still leaves the loop most of the
+* 256 ms between blocks.
+*
+* serveDump() is a small command interface for pulling runs over USB:
+*
+*     L        one line per run, oldest first: "run <n> <address> <bytes>"
+*     D<n>     "BIN <bytes>\n" and the raw run, header block first
+*/
+class SpiFlashLog final : public FlightLogSink {
+public:
+    static constexpr uint32_t erase_bytes = 64 * 1024;
+
+    explicit SpiFlashLog(Adafruit_SPIFlash& flash, uint8_t erase_ahead = 2)
+        : flash_(flash), erase_ahead_(erase_ahead) {}
+
+    bool open(uint32_t capacity) override;
+    bool write(const uint8_t* data, uint32_t length) override;
+    void close() override { flash_.waitUntilReady(); open_ = false; }
+    const char* name() const override { return "spiflash"; }
+
+    // Reads a command from port if one is waiting; true if one was served
+    bool serveDump(Stream& port);
+
+    uint32_t size() const { return size_; }
+    uint32_t start() const { return start_; }
+
+private:
+    struct Run {
+        uint32_t address;
+        uint32_t bytes;
+    };
+
+    bool mount();
+    bool used(uint32_t address);
+    uint32_t findEnd();
+    // Runs from the oldest; returns how many were found, at most max
+    uint16_t scanRuns(Run* runs, uint16_t max);
+    bool eraseNext();
+    uint32_t physical(uint32_t offset) const { return (start_ + offset) % size_; }
+
+    Adafruit_SPIFlash& flash_;
+    uint8_t erase_ahead_;
+    bool mounted_ = false;
+    bool open_ = false;
+    uint32_t size_ = 0;         // whole erase blocks
+    uint32_t start_ = 0;        // address of this run's header
+    uint32_t capacity_ = 0;
+    uint32_t written_ = 0;      // bytes from start_
+    uint32_t erased_ = 0;       // bytes from start_ known to be erased
+};
+
+#endif //SpiFlashLog_h
@@ -0,0 +1,262 @@
+#ifndef HybridEKF_h
+#define HybridEKF_h
+
+#include <math.h>
+#include <string.h>
+
+/* Extended Kalman filter for a hybrid system: continuous dynamics between
+* events and a discrete jump map at them, e.g. the rimless wheel's stance
+* phase and impact.
+*
+* Model is a struct with compile-time sizes and static functions:
+*
+*     static constexpr int num_states, num_measurements;
+*     // x' = x + integral of the dynamics over dt under input u
+*     static void step(const float* x, float u, float dt, float* next);
+*     // true once x has crossed the event surface, jump() maps it across
+*     static bool guard(const float* x);
+*     static void jump(const float* x, float* next);  // also for jump(u, late_dt)
+*     // zhat = h(x) and the innovation z - zhat (e.g. with angle wrapping)
+*     static void measure(const float* x, float* z);
+*     static void residual(const float* z, const float* zhat, float* y);
+*     // diagonal noise: process per second, measurement per sample
+*     static const float* processNoise();
+*     static const float* measurementNoise();
+*
+* Jacobians of step(), jump() and measure() come from forward differences,
+* so the model is written once; all sizes are template constants and the
+* matrix loops have fixed trip counts the compiler unrolls. The innovation
+* covariance is inverted with a Cholesky factorization, which is how the M
+* (4 here) measurements stay cheaper than a general inverse.
+*
+* Smoothing also keeps transition(), the product of the linearizations the
+* covariance went through since predict() began, for an offline smoother
+* (host/smooth.cpp); the firmware's filter does not pay for it.
+*/
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 8
+  #define EKF_UNROLL _Pragma("GCC unroll 8")
+#else
+  #define EKF_UNROLL
+#endif
+
+template<class Model, bool Smoothing = false>
+class HybridEKF {
+public:
+    static constexpr int N = Model::num_states;
+    static constexpr int M = Model::num_measurements;
+
+    HybridEKF() { reset(nullptr, 1.0f); }
+
+    // State x0 (zero if null) with covariance p0 * I
+    void reset(const float* x0, float p0) {
+        if (x0) memcpy(x_, x0, sizeof(x_));
+        else memset(x_, 0, sizeof(x_));
+        memset(P_, 0, sizeof(P_));
+        for (int i = 0; i < N; ++i) P_[i*N + i] = p0;
+        if (Smoothing) identity(A_);
+    }
+
+    // Propagate over dt under input u; returns true if an event was crossed
+    bool predict(float u, float dt) {
+        if (Smoothing) identity(A_);
+        float next[N], F[N*N];
+        Model::step(x_, u, dt, next);
+        jacobian<N>([u, dt](const float* x, float* out) { Model::step(x, u, dt, out); }, x_, next, F);
+        memcpy(x_, next, sizeof(x_));
+        propagate(F);
+        const float* q = Model::processNoise();
+        for (int i = 0; i < N; ++i) P_[i*N + i] += q[i] * dt;
+
+        if (!Model::guard(x_))
+            return false;
+        float J[N*N];
+        Model::jump(x_, next);
+        jacobian<N>([](const float* x, float* out) { Model::jump(x, out); }, x_, next, J);
+        memcpy(x_, next, sizeof(x_));
+        propagate(J);
+        ++events_;
+        return true;
+    }
+
+    // Event declared from outside (e.g. a sensed impact the guard missed) that
+    // happened late_dt seconds before the current state: the state is rolled
+    // back to the event, mapped across and brought forward again under u; one
+    // linearization of the whole composite carries P
+    void jump(float u, float late_dt) {
+        auto composite = [u, late_dt](const float* x, float* out) {
+            float back[N], mapped[N];
+            Model::step(x, u, -late_dt, back);
+            Model::jump(back, mapped);
+            Model::step(mapped, u, late_dt, out);
+        };
+        float next[N], J[N*N];
+        composite(x_, next);
+        jacobian<N>(composite, x_, next, J);
+        memcpy(x_, next, sizeof(x_));
+        propagate(J);
+        ++events_;
+    }
+
+    // Measurement update; false (and no change) if the innovation covariance is not positive definite
+    bool correct(const float* z) {
+        float zhat[M], y[M], H[M*N];
+        Model::measure(x_, zhat);
+        jacobian<M>([](const float* x, float* out) { Model::measure(x, out); }, x_, zhat, H);
+        Model::residual(z, zhat, y);
+
+        // PHt = P H^T (N x M), S = H P H^T + R (M x M)
+        float PHt[N*M], S[M*M];
+        EKF_UNROLL
+        for (int i = 0; i < N; ++i)
+            EKF_UNROLL
+            for (int j = 0; j < M; ++j) {
+                float s = 0.0f;
+                EKF_UNROLL
+                for (int k = 0; k < N; ++k) s += P_[i*N + k] * H[j*N + k];
+                PHt[i*M + j] = s;
+            }
+        const float* r = Model::measurementNoise();
+        EKF_UNROLL
+        for (int i = 0; i < M; ++i)
+            EKF_UNROLL
+            for (int j = 0; j < M; ++j) {
+                float s = i == j ? r[i] : 0.0f;
+                EKF_UNROLL
+                for (int k = 0; k < N; ++k) s += H[i*N + k] * PHt[k*M + j];
+                S[i*M + j] = s;
+            }
+        if (!cholesky(S))
+            return false;
+
+        // K = PHt S^-1, one solve per state row
+        float K[N*M];
+        for (int i = 0; i < N; ++i)
+            cholSolve(S, PHt + i*M, K + i*M);
+
+        EKF_UNROLL
+        for (int i = 0; i < N; ++i) {
+            float s = 0.0f;
+            EKF_UNROLL
+            for (int j = 0; j < M; ++j) s += K[i*M + j] * y[j];
+            x_[i] += s;
+        }
+        // P -= K (H P) = K PHt^T, then symmetrize against rounding
+        float P[N*N];
+        memcpy(P, P_, sizeof(P));
+        EKF_UNROLL
+        for (int i = 0; i < N; ++i)
+            EKF_UNROLL
+            for (int j = 0; j < N; ++j) {
+                float s = 0.0f;
+                EKF_UNROLL
+                for (int k = 0; k < M; ++k) s += K[i*M + k] * PHt[j*M + k];
+                P[i*N + j] -= s;
+            }
+        for (int i = 0; i < N; ++i)
+            for (int j = 0; j < N; ++j)
+                P_[i*N + j] = 0.5f * (P[i*N + j] + P[j*N + i]);
+        return true;
+    }
+
+    const float* state() const { return x_; }
+    float state(int i) const { return x_[i]; }
+    float covariance(int i, int j) const { return P_[i*N + j]; }
+    const float* covariance() const { return P_; }
+    // With Smoothing: d state / d state at the start of the last predict(), through any
+    // event and jump() since, row-major; the cross-covariance with that state is A P
+    const float* transition() const { return A_; }
+    unsigned long events() const { return events_; }
+
+private:
+    // J[i*N + k] = d out_i / d x_k around x, where f(x) = fx
+    template<int Rows, class F>
+    static void jacobian(F f, const float* x, const float* fx, float* J) {
+        float xp[N], out[Rows];
+        memcpy(xp, x, sizeof(xp));
+        for (int k = 0; k < N; ++k) {
+            const float h = 1e-3f * (1.0f + fabsf(x[k]));
+            xp[k] = x[k] + h;
+            f(xp, out);
+            xp[k] = x[k];
+            EKF_UNROLL
+            for (int i = 0; i < Rows; ++i) J[i*N + k] = (out[i] - fx[i]) / h;
+        }
+    }
+
+    // P = A P A^T
+    void propagate(const float* A) {
+        float AP[N*N];
+        EKF_UNROLL
+        for (int i = 0; i < N; ++i)
+            EKF_UNROLL
+            for (int j = 0; j < N; ++j) {
+                float s = 0.0f;
+                EKF_UNROLL
+                for (int k = 0; k < N; ++k) s += A[i*N + k] * P_[k*N + j];
+                AP[i*N + j] = s;
+            }
+        EKF_UNROLL
+        for (int i = 0; i < N; ++i)
+            EKF_UNROLL
+            for (int j = 0; j < N; ++j) {
+                float s = 0.0f;
+                EKF_UNROLL
+                for (int k = 0; k < N; ++k) s += AP[i*N + k] * A[j*N + k];
+                P_[i*N + j] = s;
+            }
+        if (!Smoothing) return;
+        float A0[N*N];
+        memcpy(A0, A_, sizeof(A0));
+        for (int i = 0; i < N; ++i)
+            for (int j = 0; j < N; ++j) {
+                float s = 0.0f;
+                for (int k = 0; k < N; ++k) s += A[i*N + k] * A0[k*N + j];
+                A_[i*N + j] = s;
+            }
+    }
+
+    static void identity(float* A) {
+        for (int i = 0; i < N*N; ++i) A[i] = i % (N + 1) == 0 ? 1.0f : 0.0f;
+    }
+
+    // S = L L^T in place (lower triangle), false if not positive definite
+    static bool cholesky(float* S) {
+        for (int j = 0; j < M; ++j) {
+            float d = S[j*M + j];
+            for (int k = 0; k < j; ++k) d -= S[j*M + k] * S[j*M + k];
+            if (!(d > 0.0f))
+                return false;
+            d = sqrtf(d);
+            S[j*M + j] = d;
+            for (int i = j + 1; i < M; ++i) {
+                float s = S[i*M + j];
+                for (int k = 0; k < j; ++k) s -= S[i*M + k] * S[j*M + k];
+                S[i*M + j] = s / d;
+            }
+        }
+        return true;
+    }
+
+    // x = (L L^T)^-1 b
+    static void cholSolve(const float* L, const float* b, float* x) {
+        float y[M];
+        for (int i = 0; i < M; ++i) {
+            float s = b[i];
+            for (int k = 0; k < i; ++k) s -= L[i*M + k] * y[k];
+            y[i] = s / L[i*M + i];
+        }
+        for (int i = M - 1; i >= 0; --i) {
+            float s = y[i];
+            for (int k = i + 1; k < M; ++k) s -= L[k*M + i] * x[k];
+            x[i] = s / L[i*M + i];
+        }
+    }
+
+    float x_[N];
+    float P_[N*N];
+    float A_[Smoothing ? N*N : 1];
+    unsigned long events_ = 0;
+};
+
+#endif //HybridEKF_h
@@ -0,0 +1,110 @@
+#include <math.h>
+#include "ImpactDetector.h"
+#include <Placement.h>
+
+namespace {
+    const float baseline_tau_s = 0.05f;
+
+    uint8_t cueSlot(uint8_t cue) { return cue == ImpactDetector::CUE_ACCEL ? 0 : (cue == ImpactDetector::CUE_CROSSING ? 1 : 2); }
+}
+
+ImpactDetector::ImpactDetector(float alpha, float accel_spike, float rate_jump,
+                               uint32_t window_us, uint32_t refractory_us)
+    : alpha_(alpha), accel_spike_(accel_spike), rate_jump_(rate_jump),
+      window_us_(window_us), refractory_us_(refractory_us) {}
+
+void ImpactDetector::reset() {
+    accel_started_ = false;
+    encoder_started_ = false;
+    pending_ = 0;
+    fired_ = false;
+    peak_ = 0.0f;
+}
+
+int32_t ImpactDetector::spokeIndex(float theta) const {
+    // spoke k is in stance for theta in [(2k-1) alpha, (2k+1) alpha)
+    return (int32_t)floorf((theta + alpha_) / (2.0f * alpha_));
+}
+
+bool ImpactDetector::recent(uint8_t cue, uint32_t now_us) const {
+    return (pending_ & cue) && (int32_t)(now_us - cue_us_[cueSlot(cue)]) <= (int32_t)window_us_;
+}
+
+HOT_CODE void ImpactDetector::accelSample(float ax, float ay, float az, uint32_t t_us) {
+    float magnitude = sqrtf(ax*ax + ay*ay + az*az);
+    if (!accel_started_) {
+        accel_started_ = true;
+        baseline_ = magnitude;
+        last_accel_us_ = t_us;
+        return;
+    }
+    float dt = (t_us - last_accel_us_) * 1e-6f;
+    last_accel_us_ = t_us;
+
+    float excess = magnitude - baseline_;
+    bool quiet = fired_ && (int32_t)(t_us - impact_us_) < (int32_t)refractory_us_;
+    if (!quiet && excess > accel_spike_) {
+        // keep the time of the largest sample of the spike
+        if (!recent(CUE_ACCEL, t_us) || excess > peak_) {
+            peak_ = excess;
+            cue_us_[cueSlot(CUE_ACCEL)] = t_us;
+        }
+        pending_ |= CUE_ACCEL;
+    } else {
+        // the spike stays out of the baseline
+        float w = dt > baseline_tau_s ? 1.0f : dt / baseline_tau_s;
+        baseline_ += w * excess;
+    }
+}
+
+HOT_CODE bool ImpactDetector::encoderSample(float theta, float thetadot, uint32_t t_us) {
+    if (!encoder_started_) {
+        encoder_started_ = true;
+        last_theta_ = theta;
+        last_rate_ = thetadot;
+        last_encoder_us_ = t_us;
+        return false;
+    }
+
+    int32_t before = spokeIndex(last_theta_), after = spokeIndex(theta);
+    if (after != before && theta != last_theta_) {
+        // interpolate to the boundary between the two spokes
+        float boundary = (2.0f * (after > before ? after : before) - 1.0f) * alpha_;
+        float f = (boundary - last_theta_) / (theta - last_theta_);
+        f = f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+        cue_us_[cueSlot(CUE_CROSSING)] = last_encoder_us_ + (uint32_t)(f * (float)(t_us - last_encoder_us_));
+        pending_ |= CUE_CROSSING;
+    }
+    if (fabsf(thetadot - last_rate_) > rate_jump_) {
+        cue_us_[cueSlot(CUE_RATE_JUMP)] = t_us;
+        jump_from_us_ = last_encoder_us_;
+        pending_ |= CUE_RATE_JUMP;
+    }
+    last_theta_ = theta;
+    last_rate_ = thetadot;
+    last_encoder_us_ = t_us;
+
+    // drop stale cues, and everything inside the refractory period
+    uint8_t live = 0;
+    for (uint8_t cue = CUE_ACCEL; cue <= CUE_RATE_JUMP; cue <<= 1)
+        if (recent(cue, t_us)) live |= cue;
+    pending_ = live;
+    if (fired_ && (int32_t)(t_us - impact_us_) < (int32_t)refractory_us_) {
+        pending_ = 0;
+        return false;
+    }
+
+    uint8_t votes = ((live & CUE_ACCEL) ? 1 : 0) + ((live & CUE_CROSSING) ? 1 : 0) + ((live & CUE_RATE_JUMP) ? 1 : 0);
+    if (votes < 2)
+        return false;
+
+    if (live & CUE_ACCEL) impact_us_ = cue_us_[cueSlot(CUE_ACCEL)];
+    else if (live & CUE_CROSSING) impact_us_ = cue_us_[cueSlot(CUE_CROSSING)];
+    else impact_us_ = t_us;
+    impact_cues_ = live;
+    fired_ = true;
+    ++impacts_;
+    pending_ = 0;
+    peak_ = 0.0f;
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef ImpactDetector_h
+#define ImpactDetector_h
+
+#include <stdint.h>
+
+/* Touchdown of the next spoke from three cues, any two of which within
+* window_us declare an impact:
+*
+*   CUE_ACCEL     the accel magnitude jumps above its running baseline by
+*                 accel_spike; fed per sample, so with the FIFO the peak is
+*                 timed to the sensor ODR rather than the control tick
+*   CUE_CROSSING  the spoke angle crosses an odd multiple of alpha (the
+*                 stance spoke passing the next touchdown), timed by
+*                 interpolating between encoder samples
+*   CUE_RATE_JUMP the spoke rate changes by more than rate_jump between
+*                 encoder samples, the velocity discontinuity of the impact
+*
+* The impact is stamped with the accel peak if that cue took part, else with
+* the crossing, else with the encoder sample; times are micros() and may
+* wrap. After an impact the detector ignores cues for refractory_us, which
+* also covers the ringing after touchdown.
+*
+* The crossing is where a flat floor's touchdown would be, not where this
+* one was, so touchdownTime_us() times the contact from the other two cues
+* alone, for TerrainEstimator: the accel peak, else halfway between the rate
+* jump's encoder sample and the one before it.
+*/
+class ImpactDetector {
+public:
+    enum Cue : uint8_t { CUE_ACCEL = 1, CUE_CROSSING = 2, CUE_RATE_JUMP = 4 };
+
+    // alpha in rad, accel_spike in m/s^2, rate_jump in rad/s
+    ImpactDetector(float alpha, float accel_spike, float rate_jump,
+                   uint32_t window_us = 15000, uint32_t refractory_us = 80000);
+
+    // One accelerometer sample, m/s^2
+    void accelSample(float ax, float ay, float az, uint32_t t_us);
+    // Stance spoke angle and rate once per tick; true when an impact is declared
+    bool encoderSample(float theta, float thetadot, uint32_t t_us);
+
+    void reset();
+
+    // Time and cues of the last declared impact
+    uint32_t impactTime_us() const { return impact_us_; }
+    uint8_t cues() const { return impact_cues_; }
+    uint32_t impacts() const { return impacts_; }
+    // The contact itself, without the crossing; on the tick the impact is declared
+    uint32_t touchdownTime_us() const {
+        if (impact_cues_ & CUE_ACCEL) return cue_us_[0];
+        return jump_from_us_ + (cue_us_[2] - jump_from_us_) / 2;
+    }
+
+private:
+    int32_t spokeIndex(float theta) const;
+    bool recent(uint8_t cue, uint32_t now_us) const;
+
+    float alpha_;
+    float accel_spike_;
+    float rate_jump_;
+    uint32_t window_us_;
+    uint32_t refractory_us_;
+
+    // accel baseline, an exponential average over ~50 ms
+    bool accel_started_ = false;
+    float baseline_ = 0.0f;
+    uint32_t last_accel_us_ = 0;
+    float peak_ = 0.0f;
+
+    bool encoder_started_ = false;
+    float last_theta_ = 0.0f;
+    float last_rate_ = 0.0f;
+    uint32_t last_encoder_us_ = 0;
+
+    // pending cues and when each was seen
+    uint8_t pending_ = 0;
+    uint32_t cue_us_[3] = {0, 0, 0};
+    uint32_t jump_from_us_ = 0; // the encoder sample before the rate jump's
+
+    bool fired_ = false;
+    uint32_t impact_us_ = 0;
+    uint8_t impact_cues_ = 0;
+    uint32_t impacts_ = 0;
+};
+
+#endif //ImpactDetector_h
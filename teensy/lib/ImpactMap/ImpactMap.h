@@ -0,0 +1,148 @@
+#ifndef ImpactMap_h
+#define ImpactMap_h
+
+#include <math.h>
+#include <ConstexprMath.h>
+
+/* Plastic-impact map of the rimless wheel, thetadot+ = a1(phi) thetadot-,
+* phidot+ = a2(phi) thetadot- + phidot-, from impactMap() of the former
+* setup/motorEncoderImuWithImpactMap.cpp (env:teensy40_impact_map now).
+*
+* With c = cos(phi), s = sin(phi) the map reduces to
+*
+*     det = D0 + D1 sin^2(alpha - phi)
+*     a1  = (N0 - N1 (c^2 - s^2)) / det
+*     a2  = (P c + Q s) / det
+*
+* where D0..Q depend only on the wheel, so they are folded at compile time
+* and evaluate() costs one sin/cos pair and a division. lookup() replaces
+* even that with a linear interpolation in a table of N+1 points over
+* [phi_min, phi_max], and series() with a Chebyshev expansion of Degree
+* terms; both are multiply-adds only, no libm call and a fixed instruction
+* count, so they can run in an ISR. Outside the range both clamp to the end
+* values. a2 swings from -2.2 to 2.2 within about a radian near phi = alpha,
+* so the defaults are sized for it: over +-pi/2 with the main.cpp wheel,
+* lookup() is within 5e-4 and series() within 2e-5 of the closed form.
+*
+* apply() and map() return the post-impact rates by value and keep no state,
+* so the estimator, replay tools and tests can call them at any rate.
+*
+* Params supplies static constexpr I1, I2, m1, m2, l1, l2 and alpha, e.g.
+*
+*     struct Wheel { static constexpr float I1 = ..., ..., alpha = ...; };
+*     ImpactMap<Wheel> impactTable;
+*/
+template<class Params, int N = 128, int Degree = 24>
+class ImpactMap {
+public:
+    struct Gains {
+        float a1;
+        float a2;
+    };
+
+    // Post-impact rates
+    struct Velocities {
+        float thetadot;
+        float phidot;
+    };
+
+    static constexpr float I1 = Params::I1, I2 = Params::I2, m1 = Params::m1, m2 = Params::m2;
+    static constexpr float l1 = Params::l1, l2 = Params::l2, alpha = Params::alpha;
+    static constexpr float mt = m1 + m2;
+
+    static constexpr float cos_alpha = cx::cos(alpha);
+    static constexpr float sin_alpha = cx::sin(alpha);
+    static constexpr float cos_2alpha = cx::cos(2.0*alpha);
+
+    static constexpr float D0 = I1*I2 + I1*m2*l2*l2 + I2*mt*l1*l1 + m2*l1*l1*l2*l2*m1;
+    static constexpr float D1 = (m2*l1*l2)*(m2*l1*l2);
+    static constexpr float N0 = (I1*I2 + I1*m2*l2*l2) + (I2*mt*l1*l1 + m2*l1*l1*l2*l2*(m1 + 0.5f*m2))*cos_2alpha;
+    static constexpr float N1 = 0.5f*(m2*l1*l2)*(m2*l1*l2);
+    // m2 l1 l2 (I1 (cos(alpha-phi) - cos(alpha+phi)) + mt l1^2 (cos 2alpha cos(alpha-phi) - cos(alpha+phi)))
+    static constexpr float P = m2*l1*l2*mt*l1*l1*cos_alpha*(cos_2alpha - 1.0f);
+    static constexpr float Q = m2*l1*l2*(2.0f*I1*sin_alpha + mt*l1*l1*sin_alpha*(cos_2alpha + 1.0f));
+
+    static_assert(N >= 1 && Degree >= 1, "table and series need at least one interval and term");
+
+    explicit ImpactMap(float phi_min = -M_PI_2, float phi_max = M_PI_2)
+        : phi_min_(phi_min), phi_max_(phi_max), scale_(N / (phi_max - phi_min)) {
+        for (int i = 0; i <= N; ++i)
+            table_[i] = evaluate(phi_min + i / scale_);
+
+        // c_k = 2/M sum_j f(x_j) T_k(x_j) over the M = Degree Chebyshev nodes
+        for (int k = 0; k < Degree; ++k) {
+            cheb_a1_[k] = 0.0f;
+            cheb_a2_[k] = 0.0f;
+        }
+        for (int j = 0; j < Degree; ++j) {
+            float theta = (float)M_PI * (j + 0.5f) / Degree;
+            Gains f = evaluate(0.5f*(phi_max + phi_min) + 0.5f*(phi_max - phi_min)*cosf(theta));
+            for (int k = 0; k < Degree; ++k) {
+                float t = cosf(k * theta);
+                cheb_a1_[k] += 2.0f / Degree * f.a1 * t;
+                cheb_a2_[k] += 2.0f / Degree * f.a2 * t;
+            }
+        }
+    }
+
+    // The closed form with the folded constants
+    static Gains evaluate(float phi) {
+        float c = cosf(phi), s = sinf(phi);
+        float sd = sin_alpha*c - cos_alpha*s;
+        float inv_det = 1.0f / (D0 + D1*sd*sd);
+        return Gains{(N0 - N1*(c*c - s*s)) * inv_det, (P*c + Q*s) * inv_det};
+    }
+
+    // Linear interpolation in the table
+    Gains lookup(float phi) const {
+        float x = (phi - phi_min_) * scale_;
+        if (x <= 0.0f) return table_[0];
+        if (x >= (float)N) return table_[N];
+        int i = (int)x;
+        float w = x - i;
+        return Gains{table_[i].a1 + w*(table_[i + 1].a1 - table_[i].a1),
+                     table_[i].a2 + w*(table_[i + 1].a2 - table_[i].a2)};
+    }
+
+    // Chebyshev series by Clenshaw's recurrence
+    Gains series(float phi) const {
+        float x = (2.0f*phi - phi_max_ - phi_min_) / (phi_max_ - phi_min_);
+        if (x < -1.0f) x = -1.0f;
+        if (x > 1.0f) x = 1.0f;
+        float b1a = 0.0f, b2a = 0.0f, b1b = 0.0f, b2b = 0.0f;
+        for (int k = Degree - 1; k >= 1; --k) {
+            float ta = 2.0f*x*b1a - b2a + cheb_a1_[k];
+            float tb = 2.0f*x*b1b - b2b + cheb_a2_[k];
+            b2a = b1a; b1a = ta;
+            b2b = b1b; b1b = tb;
+        }
+        return Gains{x*b1a - b2a + 0.5f*cheb_a1_[0], x*b1b - b2b + 0.5f*cheb_a2_[0]};
+    }
+
+    // The map itself, pure and by value: the closed form, or the table
+    static Velocities apply(float phi, float thetadot, float phidot) { return apply(evaluate(phi), thetadot, phidot); }
+    Velocities map(float phi, float thetadot, float phidot) const { return apply(lookup(phi), thetadot, phidot); }
+    static Velocities apply(const Gains& gains, float thetadot, float phidot) {
+        return Velocities{gains.a1*thetadot, gains.a2*thetadot + phidot};
+    }
+
+    float phiMin() const { return phi_min_; }
+    float phiMax() const { return phi_max_; }
+
+private:
+    float phi_min_;
+    float phi_max_;
+    float scale_;
+    Gains table_[N + 1];
+    float cheb_a1_[Degree];
+    float cheb_a2_[Degree];
+};
+
+template<class Params, int N, int Degree> constexpr float ImpactMap<Params, N, Degree>::D0;
+template<class Params, int N, int Degree> constexpr float ImpactMap<Params, N, Degree>::D1;
+template<class Params, int N, int Degree> constexpr float ImpactMap<Params, N, Degree>::N0;
+template<class Params, int N, int Degree> constexpr float ImpactMap<Params, N, Degree>::N1;
+template<class Params, int N, int Degree> constexpr float ImpactMap<Params, N, Degree>::P;
+template<class Params, int N, int Degree> constexpr float ImpactMap<Params, N, Degree>::Q;
+
+#endif //ImpactMap_h
@@ -0,0 +1,195 @@
+#ifndef MahonyFilter_h
+#define MahonyFilter_h
+
+#include <math.h>
+#include <FastMath.h>
+
+/* Mahony AHRS specialized for the torso estimator: the algorithm of
+* Adafruit_Mahony, but gyro in rad/s in and angles in radians out, so there
+* is no deg/s round trip, and the sample period and gains are compile-time
+* constants of Config:
+*
+*     struct TorsoAhrs {
+*         static constexpr float period = 0.01f; // s
+*         static constexpr float two_kp = 1.0f;  // 2 * proportional gain
+*         static constexpr float two_ki = 0.0f;  // 2 * integral gain
+*     };
+*     MahonyFilter<TorsoAhrs> filter;
+*
+* update(..., dt) is for callers with a variable period (FIFO, data-ready).
+* Norms use the M7's vsqrt.f32 and one divide rather than the invSqrt bit
+* trick. The quaternion products are shared between the error and the
+* integration and written out so the FPU issues them as fused multiply-adds.
+* A zero accel skips the feedback and only integrates the gyro, a zero mag
+* drops the magnetometer term, as in Adafruit_Mahony. The angles come from
+* FastMath's atan2 and asin with explicit fmaf()s, so they match the host's
+* replay to the bit for the same quaternion; 0.5 - a^2 - b^2 is fused the
+* same way on both.
+*/
+
+namespace mahony {
+
+inline float sqrt(float x) {
+#if defined(__ARM_FP) && (__ARM_FP & 4)
+    float r;
+    asm("vsqrt.f32 %0, %1" : "=t"(r) : "t"(x));
+    return r;
+#else
+    return sqrtf(x);
+#endif
+}
+
+inline float rsqrt(float x) { return 1.0f / mahony::sqrt(x); }
+
+} // namespace mahony
+
+template<class Config>
+class MahonyFilter {
+public:
+    static constexpr float period = Config::period;
+    static constexpr float two_kp = Config::two_kp;
+    static constexpr float two_ki = Config::two_ki;
+
+    MahonyFilter() { reset(); }
+
+    void reset() {
+        q0_ = 1.0f;
+        q1_ = q2_ = q3_ = 0.0f;
+        ix_ = iy_ = iz_ = 0.0f;
+        angles_valid_ = false;
+    }
+
+    // Straight to the attitude the accel gives, as if the filter had long
+    // converged on it: roll and pitch from gravity, the yaw kept, the
+    // integral cleared. A zero accel leaves the filter as it is.
+    void seed(float ax, float ay, float az) {
+        if (ax == 0.0f && ay == 0.0f && az == 0.0f)
+            return;
+        const float yaw = this->yaw();
+        const float roll = fastmath::atan2(ay, az);
+        const float pitch = fastmath::atan2(-ax, mahony::sqrt(fmaf(ay, ay, az * az)));
+        float sr, cr, sp, cp, sy, cy;
+        fastmath::sincos(0.5f * roll, sr, cr);
+        fastmath::sincos(0.5f * pitch, sp, cp);
+        fastmath::sincos(0.5f * yaw, sy, cy);
+        q0_ = fmaf(cr * cp, cy, sr * sp * sy);
+        q1_ = fmaf(sr * cp, cy, -cr * sp * sy);
+        q2_ = fmaf(cr * sp, cy, sr * cp * sy);
+        q3_ = fmaf(cr * cp, sy, -sr * sp * cy);
+        ix_ = iy_ = iz_ = 0.0f;
+        angles_valid_ = false;
+    }
+
+    void update(float gx, float gy, float gz, float ax, float ay, float az,
+                float mx, float my, float mz) {
+        update(gx, gy, gz, ax, ay, az, mx, my, mz, period);
+    }
+
+    void update(float gx, float gy, float gz, float ax, float ay, float az,
+                float mx, float my, float mz, float dt) {
+        if (!(ax == 0.0f && ay == 0.0f && az == 0.0f)) {
+            float r = mahony::rsqrt(ax * ax + ay * ay + az * az);
+            ax *= r;
+            ay *= r;
+            az *= r;
+
+            const float q0q1 = q0_ * q1_, q0q2 = q0_ * q2_, q0q3 = q0_ * q3_;
+            const float q1q1 = q1_ * q1_, q1q2 = q1_ * q2_, q1q3 = q1_ * q3_;
+            const float q2q2 = q2_ * q2_, q2q3 = q2_ * q3_, q3q3 = q3_ * q3_;
+
+            // half the estimated gravity direction
+            const float vx = q1q3 - q0q2;
+            const float vy = q0q1 + q2q3;
+            const float vz = 0.5f - q1q1 - q2q2;
+
+            float ex = ay * vz - az * vy;
+            float ey = az * vx - ax * vz;
+            float ez = ax * vy - ay * vx;
+
+            if (!(mx == 0.0f && my == 0.0f && mz == 0.0f)) {
+                r = mahony::rsqrt(mx * mx + my * my + mz * mz);
+                mx *= r;
+                my *= r;
+                mz *= r;
+
+                // earth-frame field, then half the estimated field direction
+                const float hx = 2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+                const float hy = 2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+                const float bx = mahony::sqrt(hx * hx + hy * hy);
+                const float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+                const float wx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+                const float wy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+                const float wz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+
+                ex += my * wz - mz * wy;
+                ey += mz * wx - mx * wz;
+                ez += mx * wy - my * wx;
+            }
+
+            if (two_ki > 0.0f) {
+                ix_ += two_ki * dt * ex;
+                iy_ += two_ki * dt * ey;
+                iz_ += two_ki * dt * ez;
+                gx += ix_;
+                gy += iy_;
+                gz += iz_;
+            }
+            gx += two_kp * ex;
+            gy += two_kp * ey;
+            gz += two_kp * ez;
+        }
+
+        // qdot = q * (0, g) / 2
+        const float h = 0.5f * dt;
+        gx *= h;
+        gy *= h;
+        gz *= h;
+        const float a = q0_, b = q1_, c = q2_, d = q3_;
+        q0_ = a - b * gx - c * gy - d * gz;
+        q1_ = b + a * gx + c * gz - d * gy;
+        q2_ = c + a * gy - b * gz + d * gx;
+        q3_ = d + a * gz + b * gy - c * gx;
+
+        const float r = mahony::rsqrt(q0_ * q0_ + q1_ * q1_ + q2_ * q2_ + q3_ * q3_);
+        q0_ *= r;
+        q1_ *= r;
+        q2_ *= r;
+        q3_ *= r;
+        angles_valid_ = false;
+    }
+
+    // Euler angles in radians, as Adafruit_Mahony's getRoll()/getPitch()/getYaw() in degrees
+    float roll() { computeAngles(); return roll_; }
+    float pitch() { computeAngles(); return pitch_; }
+    float yaw() { computeAngles(); return yaw_; }
+
+    void getQuaternion(float* w, float* x, float* y, float* z) const {
+        *w = q0_;
+        *x = q1_;
+        *y = q2_;
+        *z = q3_;
+    }
+
+private:
+    void computeAngles() {
+        if (angles_valid_)
+            return;
+        roll_ = fastmath::atan2(fmaf(q0_, q1_, q2_ * q3_), fmaf(-q2_, q2_, fmaf(-q1_, q1_, 0.5f)));
+        // a quaternion a rounding off unit length can put the sine past 1
+        const float sp = -2.0f * fmaf(q1_, q3_, -q0_ * q2_);
+        pitch_ = fastmath::asin(sp > 1.0f ? 1.0f : sp < -1.0f ? -1.0f : sp);
+        yaw_ = fastmath::atan2(fmaf(q1_, q2_, q0_ * q3_), fmaf(-q3_, q3_, fmaf(-q2_, q2_, 0.5f)));
+        angles_valid_ = true;
+    }
+
+    float q0_, q1_, q2_, q3_;
+    float ix_, iy_, iz_;
+    float roll_ = 0.0f, pitch_ = 0.0f, yaw_ = 0.0f;
+    bool angles_valid_ = false;
+};
+
+template<class Config> constexpr float MahonyFilter<Config>::period;
+template<class Config> constexpr float MahonyFilter<Config>::two_kp;
+template<class Config> constexpr float MahonyFilter<Config>::two_ki;
+
+#endif //MahonyFilter_h
@@ -0,0 +1,99 @@
+#ifndef JointStateView_h
+#define JointStateView_h
+
+#include <stdint.h>
+#include <string.h>
+
+/* sensor_msgs/JointState read in place from the NodeHandle's input buffer,
+* for the /torso_command subscriber that only wants effort[0] and the
+* header's frame_id.
+*
+* ros_lib's JointState::deserialize() reallocs its arrays, converts every
+* float64 with deserializeAvrFloat64() and shifts each string down a byte
+* to NUL-terminate it. deserialize() here only walks the lengths to find
+* where each field starts; an element is decoded when it is read. It has
+* the interface ros::Subscriber expects of a message, so
+*
+*     ros::Subscriber<JointStateView> motors("/torso_command", &receiveJointState);
+*
+* with receiveJointState(const JointStateView&). The view points into the
+* buffer, which the next message overwrites: read it in the callback only.
+*/
+class JointStateView {
+public:
+    int deserialize(unsigned char* inbuffer) {
+        data_ = inbuffer;
+        int offset = 12;                       // seq, stamp.sec, stamp.nsec
+        frame_id_length_ = word(offset);
+        offset += 4;
+        frame_id_ = offset;
+        offset += frame_id_length_;
+        uint32_t names = word(offset);
+        offset += 4;
+        for (uint32_t i = 0; i < names; ++i)
+            offset += 4 + word(offset);
+        for (int a = 0; a < 3; ++a) {
+            length_[a] = word(offset);
+            offset += 4;
+            array_[a] = offset;
+            offset += 8*length_[a];
+        }
+        return offset;
+    }
+
+    const char* getType() { return "sensor_msgs/JointState"; }
+    const char* getMD5() { return "3066dcd76a6cfaef579bd0f34173e9fd"; }
+
+    uint32_t seq() const { return word(0); }
+
+    // frame_id, not NUL-terminated
+    const char* frameId(uint32_t& length) const {
+        length = frame_id_length_;
+        return (const char*)data_ + frame_id_;
+    }
+
+    // frame_id as a decimal number, e.g. the /sensors seq a controller echoes; false if it is not one
+    bool frameIdNumber(uint32_t& value) const {
+        if (frame_id_length_ == 0) return false;
+        value = 0;
+        for (uint32_t i = 0; i < frame_id_length_; ++i) {
+            unsigned char c = data_[frame_id_ + i];
+            if (c < '0' || c > '9') return false;
+            value = value*10 + (c - '0');
+        }
+        return true;
+    }
+
+    uint32_t positionLength() const { return length_[0]; }
+    uint32_t velocityLength() const { return length_[1]; }
+    uint32_t effortLength() const { return length_[2]; }
+
+    // Element i, 0 past the end
+    float position(uint32_t i) const { return element(0, i); }
+    float velocity(uint32_t i) const { return element(1, i); }
+    float effort(uint32_t i) const { return element(2, i); }
+
+private:
+    static_assert(sizeof(double) == 8, "float64 is read as a double");
+
+    // little-endian uint32 at an unaligned offset
+    uint32_t word(int offset) const {
+        const unsigned char* p = data_ + offset;
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    float element(int a, uint32_t i) const {
+        if (i >= length_[a]) return 0.0f;
+        double value;
+        memcpy(&value, data_ + array_[a] + 8*i, sizeof(value));
+        return (float)value;
+    }
+
+    const unsigned char* data_ = nullptr;
+    uint32_t frame_id_length_ = 0;
+    int frame_id_ = 0;
+    uint32_t length_[3] = {0, 0, 0};
+    int array_[3] = {0, 0, 0};
+};
+
+#endif //JointStateView_h
@@ -0,0 +1,70 @@
+#ifndef TrajectoryView_h
+#define TrajectoryView_h
+
+#include <stdint.h>
+#include <string.h>
+
+/* raspi_pkg/Trajectory read in place from the NodeHandle's input buffer, the
+* way JointStateView reads /torso_command: deserialize() only finds where the
+* four arrays start, and a point is decoded when it is read, so a bulk upload
+* is copied once, into the TrajectoryBuffer, with no realloc on the way.
+*
+* The view points into the buffer, which the next message overwrites: read it
+* in the callback only.
+*/
+class TrajectoryView {
+public:
+    enum Mode : uint8_t { MODE_REPLACE = 0, MODE_APPEND = 1 };
+
+    int deserialize(unsigned char* inbuffer) {
+        data_ = inbuffer;
+        mode_ = inbuffer[0];
+        int offset = 1;
+        for (int a = 0; a < 4; ++a) {
+            length_[a] = word(offset);
+            offset += 4;
+            array_[a] = offset;
+            offset += 4*length_[a];
+        }
+        return offset;
+    }
+
+    const char* getType() { return "raspi_pkg/Trajectory"; }
+    const char* getMD5() { return "d05fd65bc1f21b706c29f4dac1dd7bba"; }
+
+    uint8_t mode() const { return mode_; }
+    // Points with all four fields; a shorter array cuts the trajectory there
+    uint32_t points() const {
+        uint32_t n = length_[0];
+        for (int a = 1; a < 4; ++a)
+            if (length_[a] < n) n = length_[a];
+        return n;
+    }
+
+    // Element i, 0 past the end
+    float time(uint32_t i) const { return element(0, i); }
+    float position(uint32_t i) const { return element(1, i); }
+    float velocity(uint32_t i) const { return element(2, i); }
+    float torque(uint32_t i) const { return element(3, i); }
+
+private:
+    // little-endian uint32 at an unaligned offset
+    uint32_t word(int offset) const {
+        const unsigned char* p = data_ + offset;
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    float element(int a, uint32_t i) const {
+        if (i >= length_[a]) return 0.0f;
+        float value;
+        memcpy(&value, data_ + array_[a] + 4*i, sizeof(value));
+        return value;
+    }
+
+    const unsigned char* data_ = nullptr;
+    uint8_t mode_ = MODE_REPLACE;
+    uint32_t length_[4] = {0, 0, 0, 0};
+    int array_[4] = {0, 0, 0, 0};
+};
+
+#endif //TrajectoryView_h
@@ -0,0 +1,50 @@
+#ifndef WeightChunkView_h
+#define WeightChunkView_h
+
+#include <stdint.h>
+#include <string.h>
+
+/* raspi_pkg/WeightChunk read in place from the NodeHandle's input buffer, the
+* way TrajectoryView reads an upload: deserialize() decodes the four words
+* and finds where the bytes start, and data() points at them in the buffer,
+* so a chunk is copied once, into WeightUpload's staging.
+*
+* The view points into the buffer, which the next message overwrites: read it
+* in the callback only.
+*/
+class WeightChunkView {
+public:
+    static constexpr uint16_t MAX_DATA = 448;
+
+    int deserialize(unsigned char* inbuffer) {
+        data_ = inbuffer;
+        upload_ = word(0);
+        offset_ = word(4);
+        size_ = word(8);
+        crc_ = word(12);
+        length_ = word(16);
+        return 20 + length_;
+    }
+
+    const char* getType() { return "raspi_pkg/WeightChunk"; }
+    const char* getMD5() { return "00cf85306ab8bfd280c7e6c056aea448"; }
+
+    uint32_t upload() const { return upload_; }
+    uint32_t offset() const { return offset_; }
+    uint32_t size() const { return size_; }
+    uint32_t crc() const { return crc_; }
+    const uint8_t* data() const { return data_ + 20; }
+    uint32_t length() const { return length_; }
+
+private:
+    // little-endian uint32 at an unaligned offset
+    uint32_t word(int offset) const {
+        const unsigned char* p = data_ + offset;
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    const unsigned char* data_ = nullptr;
+    uint32_t upload_ = 0, offset_ = 0, size_ = 0, crc_ = 0, length_ = 0;
+};
+
+#endif //WeightChunkView_h
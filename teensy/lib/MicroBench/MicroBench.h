@@ -0,0 +1,132 @@
+#ifndef MicroBench_h
+#define MicroBench_h
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* A minimal Google Benchmark-style harness that runs the same benchmark code
+* on the host and on the Teensy.
+*
+*     microbench::Runner bench(write, "host");
+*     bench.run("impact_map/evaluate", [&](uint32_t i) {
+*         microbench::doNotOptimize(ImpactMap<Robot>::evaluate(phi[i & 63]));
+*     });
+*     bench.finish();
+*
+* Each benchmark runs a warm-up pass, then grows its iteration count until
+* one timed pass lasts min_time seconds. The body gets the iteration index, so
+* it can walk a table of inputs and the compiler cannot fold the work away.
+* The clock is the DWT cycle counter on the Teensy, which also gives cycles per
+* iteration, and steady_clock elsewhere. The empty loop's time is measured
+* once and subtracted.
+*
+* The report is Google Benchmark's JSON layout, with "context" and a
+* "benchmarks" array of name, iterations, real_time, cpu_time and time_unit,
+* so its compare.py tooling works on two reports. write() receives the text
+* in pieces: Serial.print on the Teensy, fputs to stdout on the host.
+*/
+
+#if defined(ARDUINO)
+    #include "Arduino.h"
+#else
+    #include <chrono>
+#endif
+
+namespace microbench {
+
+// Keeps value and everything that computed it, without a store
+template<class T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Memory the compiler must assume was read and written
+inline void clobberMemory() {
+    asm volatile("" : : : "memory");
+}
+
+class Runner {
+public:
+    typedef void (*Write)(const char* text);
+
+    Runner(Write write, const char* target, double min_time = default_min_time)
+        : write_(write), min_time_(min_time) {
+        char line[160];
+        snprintf(line, sizeof(line), "{\n  \"context\": {\"target\": \"%s\", \"mhz\": %.0f, \"min_time\": %.3f},\n  \"benchmarks\": [",
+                 target, ticksPerSecond() * 1e-6, min_time_);
+        write_(line);
+        overhead_ = 0.0;
+        overhead_ = perIteration([](uint32_t) {});
+    }
+
+    template<class Body>
+    void run(const char* name, Body body) {
+        uint32_t iterations = 0;
+        double ticks = perIteration(body, &iterations) - overhead_;
+        if (ticks < 0.0) ticks = 0.0;
+        double ns = ticks * 1e9 / ticksPerSecond();
+        char line[200];
+        snprintf(line, sizeof(line),
+                 "%s\n    {\"name\": \"%s\", \"iterations\": %lu, \"real_time\": %.2f, \"cpu_time\": %.2f, \"time_unit\": \"ns\"",
+                 count_ ? "," : "", name, (unsigned long)iterations, ns, ns);
+        write_(line);
+        if (cycleCounter()) {
+            snprintf(line, sizeof(line), ", \"cycles\": %.1f", ticks);
+            write_(line);
+        }
+        write_("}");
+        ++count_;
+    }
+
+    void finish() { write_("\n  ]\n}\n"); }
+
+    static constexpr double default_min_time = 0.05;   // s per timed pass
+
+private:
+#if defined(ARDUINO)
+    static uint32_t now() { return ARM_DWT_CYCCNT; }
+    static double ticksPerSecond() { return F_CPU_ACTUAL; }
+    static bool cycleCounter() { return true; }
+    // a 32-bit counter: passes stay well under its 7 s period at 600 MHz
+    static double elapsed(uint32_t start, uint32_t stop) { return (double)(uint32_t)(stop - start); }
+    typedef uint32_t Stamp;
+#else
+    typedef std::chrono::steady_clock::time_point Stamp;
+    static Stamp now() { return std::chrono::steady_clock::now(); }
+    static double ticksPerSecond() { return 1e9; }
+    static bool cycleCounter() { return false; }
+    static double elapsed(Stamp start, Stamp stop) { return std::chrono::duration<double, std::nano>(stop - start).count(); }
+#endif
+
+    // Ticks per iteration of the first pass that lasts min_time
+    template<class Body>
+    double perIteration(Body body, uint32_t* iterations_out = nullptr) {
+        const double min_ticks = min_time_ * ticksPerSecond();
+        for (uint32_t i = 0; i < 64; ++i) body(i);
+        uint32_t iterations = 64;
+        for (;;) {
+            Stamp start = now();
+            for (uint32_t i = 0; i < iterations; ++i) {
+                body(i);
+                clobberMemory();
+            }
+            double ticks = elapsed(start, now());
+            if (ticks >= min_ticks || iterations >= (1u << 30)) {
+                if (iterations_out) *iterations_out = iterations;
+                return ticks / iterations;
+            }
+            // aim just past min_time, at most 10x per step
+            double scale = ticks > 0.0 ? 1.2 * min_ticks / ticks : 10.0;
+            iterations = (uint32_t)(iterations * (scale > 10.0 ? 10.0 : (scale < 2.0 ? 2.0 : scale)));
+        }
+    }
+
+    Write write_;
+    double min_time_;
+    double overhead_;
+    uint32_t count_ = 0;
+};
+
+} // namespace microbench
+
+#endif //MicroBench_h
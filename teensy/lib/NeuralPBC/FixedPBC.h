@@ -0,0 +1,152 @@
+#ifndef FixedPBC_h
+#define FixedPBC_h
+
+#include <math.h>
+#include <stdint.h>
+#include "NeuralPBC.h"
+
+/* Integer inference of the neural PBC, for on-device rates of 1 kHz and
+* more: NeuralPBC.h's fused forward pass of values and their tangent along
+* the gains, in Q16 activations and int16 weights, with no float operation
+* between inputLayer() and the torque.
+*
+* exportWeights.py quantizes each network into a nested struct fixed of its
+* header: params() is the flat parameter vector as int16, layer l (W and b)
+* scaled by 2^shifts()[l] and the gains by the last shift, each shift the
+* largest that keeps the layer in range. Products accumulate in 64 bits and
+* are shifted back to Q16, so only the int16 rounding of the weights and the
+* Q16 rounding of the activations are lost; the exporter runs the same
+* integer pass against a float64 reference and writes the error it found
+* into the header.
+*
+* elu's exp(z) - 1 for z < 0 is 2^(z log2 e) as a quartic on the fraction
+* (the coefficients of pbc::FastElu in Q16) shifted by the whole part, and
+* -1 below z = -16, within 5e-5 of expm1.
+*
+*     FixedPBC<pbc_weights::deter_hardware_even_1mpers> pbc(1.0f);
+*/
+namespace pbc {
+namespace fixed {
+
+constexpr int frac_bits = 16;
+constexpr int32_t one = int32_t(1) << frac_bits;
+
+inline int32_t toFixed(float x) { return (int32_t)lroundf(x * one); }
+inline float toFloat(int32_t x) { return x * (1.0f / one); }
+
+// exp(z) - 1 for z <= 0 in Q16, and exp(z) (elu's derivative) into e
+inline int32_t expm1(int32_t z, int32_t& e) {
+    if (z <= -16*one) {
+        e = 0;
+        return -one;
+    }
+    int32_t t = (int32_t)(((int64_t)z * 94548) >> frac_bits); // z log2(e)
+    int32_t n = t >> frac_bits;                                // floor, <= 0
+    int64_t f = t - n*one;                                     // [0, one)
+    int64_t p = 896;
+    p = 3391 + ((p*f) >> frac_bits);
+    p = 15834 + ((p*f) >> frac_bits);
+    p = 45415 + ((p*f) >> frac_bits);
+    p = 65536 + ((p*f) >> frac_bits);                          // 2^f
+    e = (int32_t)(p >> -n);
+    return e - one;
+}
+
+inline int32_t fromShift(int32_t v, int s) {
+    return s <= frac_bits ? v << (frac_bits - s) : v >> (s - frac_bits);
+}
+
+template<class ChainType> struct Layers;
+
+// Output layer, In -> 1, linear: Hd and its derivative along t into dh
+template<int In> struct Layers<Chain<In, 1>> {
+    static inline int32_t tangent(const int16_t* p, const int8_t* shift, const int32_t* x, const int32_t* t, int32_t* dh) {
+        const int s = shift[0];
+        int64_t h = (int64_t)p[In] << frac_bits, d = 0;
+        PBC_UNROLL
+        for (int i = 0; i < In; ++i) {
+            h += (int64_t)p[i] * x[i];
+            d += (int64_t)p[i] * t[i];
+        }
+        *dh = (int32_t)(d >> s);
+        return (int32_t)(h >> s);
+    }
+};
+
+// Hidden layer, In -> Out with elu
+template<int In, int Out, int... Rest> struct Layers<Chain<In, Out, Rest...>> {
+    typedef Layers<Chain<Out, Rest...>> Next;
+
+    static inline int32_t tangent(const int16_t* p, const int8_t* shift, const int32_t* x, const int32_t* t, int32_t* dh) {
+        const int s = shift[0];
+        const int16_t* w = p;
+        const int16_t* b = p + In*Out;
+        int32_t y[Out], dy[Out];
+        PBC_UNROLL
+        for (int o = 0; o < Out; ++o) {
+            int64_t acc = (int64_t)b[o] << frac_bits, dacc = 0;
+            PBC_UNROLL
+            for (int i = 0; i < In; ++i) {
+                acc += (int64_t)w[i*Out + o] * x[i];
+                dacc += (int64_t)w[i*Out + o] * t[i];
+            }
+            int32_t z = (int32_t)(acc >> s);
+            int32_t dz = (int32_t)(dacc >> s);
+            if (z > 0) {
+                y[o] = z;
+                dy[o] = dz;
+            } else {
+                int32_t e;
+                y[o] = expm1(z, e);
+                dy[o] = (int32_t)(((int64_t)dz * e) >> frac_bits);
+            }
+        }
+        return Next::tangent(p + In*Out + Out, shift + 1, y, dy, dh);
+    }
+};
+
+} // namespace fixed
+} // namespace pbc
+
+template<class Network, class Trig = pbc::ExactTrig>
+class FixedPBC {
+public:
+    typedef typename Network::chain Chain;
+    typedef typename Network::fixed Quantized;
+    static constexpr int num_inputs = pbc::num_features;
+    static constexpr int num_params = Chain::num_params + num_inputs;
+    static_assert(Network::num_params == num_params, "parameter count does not match the layer widths");
+
+    explicit FixedPBC(float saturation = 1.0f) : saturation_(saturation) {}
+
+    // Torque for the spoke in contact, clamped to +-saturation
+    float control(float torso_angle, float spoke_angle, float torso_rate, float spoke_rate) {
+        float xf[num_inputs];
+        int32_t xi[num_inputs], gains[num_inputs], u;
+        pbc::inputLayer<Trig>(torso_angle, spoke_angle, torso_rate, spoke_rate, xf);
+        const int16_t* p = Quantized::params();
+        const int8_t* shifts = Quantized::shifts();
+        for (int i = 0; i < num_inputs; ++i) {
+            xi[i] = pbc::fixed::toFixed(xf[i]);
+            gains[i] = pbc::fixed::fromShift(p[Chain::num_params + i], shifts[Quantized::num_shifts - 1]);
+        }
+        int32_t hd = pbc::fixed::Layers<Chain>::tangent(p, shifts, xi, gains, &u);
+        last_control_ = pbc::fixed::toFloat(u);
+        last_hamiltonian_ = pbc::fixed::toFloat(hd);
+        return pbc::clamp(last_control_, saturation_);
+    }
+
+    void setSaturation(float saturation) { saturation_ = saturation; }
+    float saturation() const { return saturation_; }
+
+    // Unclamped output and Hd of the last control() call
+    float lastControl() const { return last_control_; }
+    float lastHamiltonian() const { return last_hamiltonian_; }
+
+private:
+    float saturation_;
+    float last_control_ = 0.0f;
+    float last_hamiltonian_ = 0.0f;
+};
+
+#endif //FixedPBC_h
@@ -0,0 +1,438 @@
+#ifndef NeuralPBC_h
+#define NeuralPBC_h
+
+#include <math.h>
+#include <stdint.h>
+#include <FastMath.h>
+
+/* Passivity-based controller with a learned Hamiltonian, evaluated on the
+* Teensy instead of in julia_pkg/src/evaluatePbc.jl.
+*
+* Hd is a FastChain of FastDense layers, elu on the hidden layers and linear
+* on the scalar output, fed with inputLayer(x) = [cos x1, sin x1, cos x2,
+* sin x2, x3, x4] where x1/x3 are the torso angle and rate and x2/x4 the spoke
+* angle (pi at the upright contact) and rate. As in MLBasedESC.controller the
+* control is u = dot(dHd/dxi, gains), the gains the last 6 entries of the
+* parameter vector. That is the derivative of Hd along the gains, so it
+* comes out of one forward-mode pass: each layer carries its values and
+* their tangent (seeded with the gains) together, W x and W t share the
+* weight loads, and nothing is kept for a backward sweep. evaluate() still
+* has the analytic backward pass for the full gradient.
+*
+* The network is a compile-time type generated from saved_weights by
+* julia_pkg/src/exportWeights.py (see weights/), e.g.
+*
+*     NeuralPBC<pbc_weights::deter_hardware_even_1mpers> pbc(1.0f);
+*
+* so every loop has a constant trip count and is unrolled. Swapping
+* architectures is a recompile; new weights for the same widths can also be
+* handed in at run time (a second constructor argument), as the Pi's
+* pbc_controller does with exportWeights.py's .pbcw files. No Arduino
+* dependency, so the Pi can use it too.
+*
+* The elu's exp is a policy: pbc::ExactElu calls expm1f, pbc::FastElu is
+* FastMath's expm1, within 4e-6 of it and with no libm call, e.g.
+* NeuralPBC<Network, pbc::FastElu>. So are the input layer's sines and
+* cosines: pbc::ExactTrig calls sinf and cosf, pbc::FastTrig is FastMath's
+* sincos, within 1e-7 for the angles the wheel sees, e.g.
+* NeuralPBC<Network, pbc::FastElu, pbc::FastTrig>. The fast policies give
+* the same bits on the Teensy and the host; libm's do not.
+* FixedPBC.h has the integer version of the whole pass.
+*/
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 8
+  #define PBC_UNROLL _Pragma("GCC unroll 16")
+#else
+  #define PBC_UNROLL
+#endif
+
+namespace pbc {
+
+struct ExactElu {
+    static inline float expm1(float z) { return expm1f(z); }
+};
+
+// FastMath's expm1: a quartic for 2^f and the exponent bits for 2^n, every
+// multiply-add an explicit fmaf so the Teensy and the host agree to the bit
+struct FastElu {
+    static inline float expm1(float z) { return fastmath::expm1(z); }
+};
+
+struct ExactTrig {
+    static inline void sincos(float x, float& s, float& c) {
+        s = sinf(x);
+        c = cosf(x);
+    }
+};
+
+// FastMath's sincos: a quarter-turn reduction and the cephes polynomials
+struct FastTrig {
+    static inline void sincos(float x, float& s, float& c) { fastmath::sincos(x, s, c); }
+};
+
+// FastChain(FastDense(W0,W1,elu), ..., FastDense(Wn-1,1)) over the flat DiffEqFlux
+// parameter vector; each FastDense stores W (out x in) column-major, then b.
+//
+// evaluateBatch() runs N networks at once on a parameter-major bank,
+// p[k*N + s] is parameter k of network s, with activations stored the same
+// way (x[i*N + s]). Every inner loop then runs over s with unit stride and N
+// independent accumulators, which the compiler turns into NEON lanes on the
+// Pi and keeps the M7's FPU pipeline full on the Teensy.
+template<int... Widths> struct Chain;
+
+// Output layer, In -> 1, linear
+template<int In> struct Chain<In, 1> {
+    static constexpr int num_inputs = In;
+    static constexpr int num_params = In + 1;
+    static constexpr int num_widths = 2;
+
+    // The FastChain widths, input to output, into w[num_widths]
+    template<class T>
+    static inline void widths(T* w) {
+        w[0] = In;
+        w[1] = 1;
+    }
+
+    // Hd(x) and, if dx is not null, dHd/dx
+    template<class Elu = ExactElu>
+    static inline float evaluate(const float* p, const float* x, float* dx) {
+        float h = p[In];
+        PBC_UNROLL
+        for (int i = 0; i < In; ++i)
+            h += p[i] * x[i];
+        if (dx) {
+            PBC_UNROLL
+            for (int i = 0; i < In; ++i)
+                dx[i] = p[i];
+        }
+        return h;
+    }
+
+    // Hd(x), and into dh its derivative along the tangent t of x
+    template<class Elu = ExactElu>
+    static inline float tangent(const float* p, const float* x, const float* t, float* dh) {
+        float h = p[In], d = 0.0f;
+        PBC_UNROLL
+        for (int i = 0; i < In; ++i) {
+            h += p[i] * x[i];
+            d += p[i] * t[i];
+        }
+        *dh = d;
+        return h;
+    }
+
+    // tangent() of all N networks, x and t as x[i*N + s], into h[N] and dh[N]
+    template<int N, class Elu = ExactElu>
+    static inline void tangentBatch(const float* p, const float* x, const float* t, float* dh, float* h) {
+        for (int s = 0; s < N; ++s) {
+            h[s] = p[In*N + s];
+            dh[s] = 0.0f;
+        }
+        PBC_UNROLL
+        for (int i = 0; i < In; ++i)
+            for (int s = 0; s < N; ++s) {
+                h[s] += p[i*N + s] * x[i*N + s];
+                dh[s] += p[i*N + s] * t[i*N + s];
+            }
+    }
+
+    // Hd of all N networks into h[N] and dHd/dx into dx[In*N]
+    template<int N, class Elu = ExactElu>
+    static inline void evaluateBatch(const float* p, const float* x, float* dx, float* h) {
+        for (int s = 0; s < N; ++s)
+            h[s] = p[In*N + s];
+        PBC_UNROLL
+        for (int i = 0; i < In; ++i)
+            for (int s = 0; s < N; ++s)
+                h[s] += p[i*N + s] * x[i*N + s];
+        for (int k = 0; k < In*N; ++k)
+            dx[k] = p[k];
+    }
+};
+
+// Hidden layer, In -> Out with elu, followed by the rest of the chain
+template<int In, int Out, int... Rest> struct Chain<In, Out, Rest...> {
+    typedef Chain<Out, Rest...> Next;
+    static constexpr int num_inputs = In;
+    static constexpr int num_params = In*Out + Out + Next::num_params;
+    static constexpr int num_widths = 1 + Next::num_widths;
+
+    template<class T>
+    static inline void widths(T* w) {
+        w[0] = In;
+        Next::widths(w + 1);
+    }
+
+    template<class Elu = ExactElu>
+    static inline float tangent(const float* p, const float* x, const float* t, float* dh) {
+        const float* w = p;
+        const float* b = p + In*Out;
+        float y[Out], dy[Out];
+        PBC_UNROLL
+        for (int o = 0; o < Out; ++o) {
+            float z = b[o], dz = 0.0f;
+            PBC_UNROLL
+            for (int i = 0; i < In; ++i) {
+                z += w[i*Out + o] * x[i];
+                dz += w[i*Out + o] * t[i];
+            }
+            if (z > 0.0f) {
+                y[o] = z;
+                dy[o] = dz;
+            } else {
+                y[o] = Elu::expm1(z);
+                dy[o] = (y[o] + 1.0f) * dz;
+            }
+        }
+        return Next::template tangent<Elu>(p + In*Out + Out, y, dy, dh);
+    }
+
+    // tangentBatch() with one input x[In] shared by the N networks, the first
+    // layer of a posterior bank: only the tangents (each network's gains)
+    // are per network
+    template<int N, class Elu = ExactElu>
+    static inline void tangentShared(const float* p, const float* x, const float* t, float* dh, float* h) {
+        const float* w = p;
+        const float* b = p + In*Out*N;
+        float y[Out*N], dy[Out*N];
+        PBC_UNROLL
+        for (int o = 0; o < Out; ++o) {
+            float* z = y + o*N;
+            float* dz = dy + o*N;
+            for (int s = 0; s < N; ++s) {
+                z[s] = b[o*N + s];
+                dz[s] = 0.0f;
+            }
+            PBC_UNROLL
+            for (int i = 0; i < In; ++i) {
+                const float* wio = w + (i*Out + o)*N;
+                const float xi = x[i];
+                const float* ti = t + i*N;
+                for (int s = 0; s < N; ++s) {
+                    z[s] += wio[s] * xi;
+                    dz[s] += wio[s] * ti[s];
+                }
+            }
+            for (int s = 0; s < N; ++s) {
+                float e = Elu::expm1(z[s] < 0.0f ? z[s] : 0.0f);
+                dz[s] *= z[s] > 0.0f ? 1.0f : e + 1.0f;
+                z[s] = z[s] > 0.0f ? z[s] : e;
+            }
+        }
+        Next::template tangentBatch<N, Elu>(p + (In*Out + Out)*N, y, dy, dh, h);
+    }
+
+    template<int N, class Elu = ExactElu>
+    static inline void tangentBatch(const float* p, const float* x, const float* t, float* dh, float* h) {
+        const float* w = p;
+        const float* b = p + In*Out*N;
+        float y[Out*N], dy[Out*N];
+        PBC_UNROLL
+        for (int o = 0; o < Out; ++o) {
+            float* z = y + o*N;
+            float* dz = dy + o*N;
+            for (int s = 0; s < N; ++s) {
+                z[s] = b[o*N + s];
+                dz[s] = 0.0f;
+            }
+            PBC_UNROLL
+            for (int i = 0; i < In; ++i) {
+                const float* wio = w + (i*Out + o)*N;
+                const float* xi = x + i*N;
+                const float* ti = t + i*N;
+                for (int s = 0; s < N; ++s) {
+                    z[s] += wio[s] * xi[s];
+                    dz[s] += wio[s] * ti[s];
+                }
+            }
+            for (int s = 0; s < N; ++s) {
+                float e = Elu::expm1(z[s] < 0.0f ? z[s] : 0.0f);
+                dz[s] *= z[s] > 0.0f ? 1.0f : e + 1.0f;
+                z[s] = z[s] > 0.0f ? z[s] : e;
+            }
+        }
+        Next::template tangentBatch<N, Elu>(p + (In*Out + Out)*N, y, dy, dh, h);
+    }
+
+    template<class Elu = ExactElu>
+    static inline float evaluate(const float* p, const float* x, float* dx) {
+        const float* w = p;
+        const float* b = p + In*Out;
+        float y[Out], dy[Out];
+        PBC_UNROLL
+        for (int o = 0; o < Out; ++o) {
+            float z = b[o];
+            PBC_UNROLL
+            for (int i = 0; i < In; ++i)
+                z += w[i*Out + o] * x[i];
+            // elu'(z) = 1 above zero and elu(z) + 1 below
+            if (z > 0.0f) {
+                y[o] = z;
+                dy[o] = 1.0f;
+            } else {
+                y[o] = Elu::expm1(z);
+                dy[o] = y[o] + 1.0f;
+            }
+        }
+
+        float g[Out];
+        float h = Next::template evaluate<Elu>(p + In*Out + Out, y, dx ? g : nullptr);
+        if (dx) {
+            PBC_UNROLL
+            for (int o = 0; o < Out; ++o)
+                g[o] *= dy[o];
+            PBC_UNROLL
+            for (int i = 0; i < In; ++i) {
+                float s = 0.0f;
+                PBC_UNROLL
+                for (int o = 0; o < Out; ++o)
+                    s += w[i*Out + o] * g[o];
+                dx[i] = s;
+            }
+        }
+        return h;
+    }
+
+    template<int N, class Elu = ExactElu>
+    static inline void evaluateBatch(const float* p, const float* x, float* dx, float* h) {
+        const float* w = p;
+        const float* b = p + In*Out*N;
+        float y[Out*N], dy[Out*N];
+        PBC_UNROLL
+        for (int o = 0; o < Out; ++o) {
+            float* z = y + o*N;
+            for (int s = 0; s < N; ++s)
+                z[s] = b[o*N + s];
+            PBC_UNROLL
+            for (int i = 0; i < In; ++i) {
+                const float* wio = w + (i*Out + o)*N;
+                const float* xi = x + i*N;
+                for (int s = 0; s < N; ++s)
+                    z[s] += wio[s] * xi[s];
+            }
+            for (int s = 0; s < N; ++s) {
+                float e = Elu::expm1(z[s] < 0.0f ? z[s] : 0.0f);
+                dy[o*N + s] = z[s] > 0.0f ? 1.0f : e + 1.0f;
+                z[s] = z[s] > 0.0f ? z[s] : e;
+            }
+        }
+
+        float g[Out*N];
+        Next::template evaluateBatch<N, Elu>(p + (In*Out + Out)*N, y, g, h);
+        for (int k = 0; k < Out*N; ++k)
+            g[k] *= dy[k];
+        PBC_UNROLL
+        for (int i = 0; i < In; ++i) {
+            float* d = dx + i*N;
+            for (int s = 0; s < N; ++s)
+                d[s] = 0.0f;
+            PBC_UNROLL
+            for (int o = 0; o < Out; ++o) {
+                const float* wio = w + (i*Out + o)*N;
+                const float* go = g + o*N;
+                for (int s = 0; s < N; ++s)
+                    d[s] += wio[s] * go[s];
+            }
+        }
+    }
+};
+
+constexpr int num_features = 6;
+
+// inputLayer() of evaluatePbc.jl, once per tick however many networks read it
+template<class Trig = ExactTrig>
+inline void inputLayer(float torso_angle, float spoke_angle, float torso_rate, float spoke_rate,
+                       float xi[num_features]) {
+    Trig::sincos(torso_angle, xi[1], xi[0]);
+    Trig::sincos(spoke_angle, xi[3], xi[2]);
+    xi[4] = torso_rate;
+    xi[5] = spoke_rate;
+}
+
+inline float clamp(float u, float limit) {
+    if (u > limit) return limit;
+    if (u < -limit) return -limit;
+    return u;
+}
+
+// Unclamped u = dot(dHd/dxi, gains) for the parameters at p, Hd's derivative
+// along the gains in one forward pass
+template<class ChainType, class Elu = ExactElu>
+inline float control(const float* p, const float xi[num_features], float* hamiltonian = nullptr) {
+    static_assert(ChainType::num_inputs == num_features, "inputLayer produces 6 features");
+    const float* gains = p + ChainType::num_params;
+    float u;
+    float hd = ChainType::template tangent<Elu>(p, xi, gains, &u);
+    if (hamiltonian) *hamiltonian = hd;
+    return u;
+}
+
+// Unclamped u of each of the N networks of a parameter-major bank into u[N]
+template<class ChainType, int N, class Elu = ExactElu>
+inline void batchControl(const float* p, const float xi[num_features], float u[N]) {
+    static_assert(ChainType::num_inputs == num_features, "inputLayer produces 6 features");
+    float hd[N];
+    // the gains of sample s are its tangent, already parameter-major
+    const float* gains = p + ChainType::num_params*N;
+    ChainType::template tangentShared<N, Elu>(p, xi, gains, u, hd);
+}
+
+// Mean over the N networks of a parameter-major bank of clamp(u, limit), the
+// clamp and the average fused into the gain product
+template<class ChainType, int N, class Elu = ExactElu>
+inline float marginalControl(const float* p, const float xi[num_features], float limit) {
+    float u[N];
+    batchControl<ChainType, N, Elu>(p, xi, u);
+    float effort = 0.0f;
+    for (int s = 0; s < N; ++s)
+        effort += u[s] > limit ? limit : (u[s] < -limit ? -limit : u[s]);
+    return effort * (1.0f / N);
+}
+
+} // namespace pbc
+
+template<class Network, class Elu = pbc::ExactElu, class Trig = pbc::ExactTrig>
+class NeuralPBC {
+public:
+    typedef typename Network::chain Chain;
+    static constexpr int num_inputs = pbc::num_features;
+    static constexpr int num_params = Chain::num_params + num_inputs;
+    static_assert(Network::num_params == num_params, "parameter count does not match the layer widths");
+
+    // params: the flat vector, num_params floats, the compiled-in Network::params() by
+    // default; it is not copied and must outlive the controller
+    explicit NeuralPBC(float saturation = 1.0f, const float* params = Network::params())
+        : saturation_(saturation), params_(params) {}
+
+    // Torque for the spoke in contact, clamped to +-saturation
+    float control(float torso_angle, float spoke_angle, float torso_rate, float spoke_rate) {
+        float xi[num_inputs];
+        pbc::inputLayer<Trig>(torso_angle, spoke_angle, torso_rate, spoke_rate, xi);
+        last_control_ = pbc::control<Chain, Elu>(params_, xi, &last_hamiltonian_);
+        return pbc::clamp(last_control_, saturation_);
+    }
+
+    // Hd(xi) and, if grad is not null, dHd/dxi
+    float hamiltonian(const float xi[num_inputs], float grad[num_inputs] = nullptr) const {
+        return Chain::template evaluate<Elu>(params_, xi, grad);
+    }
+
+    const float* params() const { return params_; }
+    // Run on other weights from the next control() on, e.g. a WeightUpload's; not copied either
+    void setParams(const float* params) { params_ = params; }
+
+    void setSaturation(float saturation) { saturation_ = saturation; }
+    float saturation() const { return saturation_; }
+
+    // Unclamped output and Hd of the last control() call
+    float lastControl() const { return last_control_; }
+    float lastHamiltonian() const { return last_hamiltonian_; }
+
+private:
+    float saturation_;
+    const float* params_;
+    float last_control_ = 0.0f;
+    float last_hamiltonian_ = 0.0f;
+};
+
+#endif //NeuralPBC_h
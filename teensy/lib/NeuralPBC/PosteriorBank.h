@@ -0,0 +1,226 @@
+#ifndef PosteriorBank_h
+#define PosteriorBank_h
+
+#include <stdint.h>
+#include <string.h>
+#include "NeuralPBC.h"
+
+/* Fixed bank of posterior weight samples for the Bayesian controller.
+*
+* marginalize() in bayesianPBC.jl draws a fresh weight vector from
+* q = MvNormal(mu, softplus(sigma)) for every sample of every tick. Here the
+* N draws are made once, either offline by exportWeights.py (load()) or at
+* startup from the exported mean and standard deviation (draw()), and
+* control() averages the clamped controls of all of them, as marginalize()
+* does. The bank is stored parameter-major, w[k*N + s] is parameter k of
+* sample s, which is the layout pbc::Chain::tangentBatch() works on, so the
+* N fused forward passes run as one batch. The input layer is computed once
+* per control() and read by all N first layers (tangentShared()).
+*
+* Posterior is a generated struct with chain, num_params, mean() and stddev(),
+* e.g. pbc_weights::rw_bayesian. N*num_params floats live in the object.
+*
+* The sample count can adapt per tick. The bank is split into N/Chunk
+* chunks, each parameter-major on its own, run one batch at a time; after
+* each, once min_samples have run, a tick stops when the standard error of
+* the running mean torque is within tolerance, and in any case at
+* max_samples. An urgent control() (an impact coming) runs the whole bank
+* whatever the spread. The chunks are iid draws too, so a prefix of them is
+* a smaller Monte Carlo estimate of the same mean. With Chunk == N, the
+* default, or a tolerance of 0 every tick runs all N, as marginalize() does.
+*
+* drawQuasi() fills the bank with lower-variance draws than draw(): the
+* standard normals come from a scrambled Halton point set (one prime base
+* per parameter, the digits of each base through a seeded affine
+* permutation, so the high bases do not move in lockstep over the first
+* points) through the Gaussian quantile, and they come in antithetic pairs,
+* sample 2j + 1 the mirror of sample 2j about the mean. The pairs cancel the
+* odd part of the control's dependence on the weights and the point set
+* spreads the rest evenly, so a mean over few samples lands nearer the
+* posterior's than with iid draws. The pairs sit in one chunk when Chunk is
+* even, so an early stop never splits one.
+*/
+template<class Posterior, int N, class Elu = pbc::ExactElu, class Trig = pbc::ExactTrig, int Chunk = N>
+class PosteriorBank {
+public:
+    typedef typename Posterior::chain Chain;
+    static constexpr int num_samples = N;
+    static constexpr int chunk = Chunk;
+    static constexpr int num_chunks = N / Chunk;
+    static constexpr int num_params = Chain::num_params + pbc::num_features;
+    static_assert(Posterior::num_params == num_params, "parameter count does not match the layer widths");
+    static_assert(N > 0, "at least one sample");
+    static_assert(Chunk > 0 && N % Chunk == 0, "the chunks split the bank evenly");
+
+    explicit PosteriorBank(float saturation = 1.0f) : saturation_(saturation) {
+        for (int k = 0; k < num_params; ++k)
+            for (int s = 0; s < N; ++s)
+                w_[index(k, s)] = Posterior::mean()[k];
+    }
+
+    // Samples exported parameter-major, e.g. Posterior::samples() when N == Posterior::num_samples
+    void load(const float* samples) {
+        if (Chunk == N) {
+            memcpy(w_, samples, sizeof(w_));
+            return;
+        }
+        for (int k = 0; k < num_params; ++k)
+            for (int s = 0; s < N; ++s)
+                w_[index(k, s)] = samples[k*N + s];
+    }
+
+    // tolerance: standard error of the mean torque to stop at, 0 to run every sample;
+    // min_samples and max_samples round up to whole chunks
+    void setAdaptive(float tolerance, int min_samples, int max_samples) {
+        tolerance_ = tolerance;
+        min_chunks_ = (min_samples + Chunk - 1) / Chunk;
+        max_chunks_ = (max_samples + Chunk - 1) / Chunk;
+        if (min_chunks_ < 1) min_chunks_ = 1;
+        if (max_chunks_ > num_chunks) max_chunks_ = num_chunks;
+        if (max_chunks_ < min_chunks_) max_chunks_ = min_chunks_;
+    }
+
+    // mean + stddev .* randn with a xorshift/Box-Muller generator; not a real-time call
+    void draw(uint32_t seed) {
+        uint32_t state = seed ? seed : 0x9e3779b9u;
+        for (int k = 0; k < num_params; ++k) {
+            float mean = Posterior::mean()[k];
+            float stddev = Posterior::stddev()[k];
+            for (int s = 0; s < N; ++s)
+                w_[index(k, s)] = mean + stddev * gaussian(state);
+        }
+    }
+
+    // mean + stddev .* z with z scrambled Halton normals in antithetic pairs; not a real-time call
+    void drawQuasi(uint32_t seed) {
+        uint32_t state = seed ? seed : 0x9e3779b9u;
+        uint32_t base = 1;
+        for (int k = 0; k < num_params; ++k) {
+            base = nextPrime(base);
+            // the digit permutation d -> (a d + b) mod base, a != 0
+            uint32_t a = 1 + (uint32_t)(uniform(state)*(base - 1)) % (base - 1);
+            uint32_t b = (uint32_t)(uniform(state)*base) % base;
+            float mean = Posterior::mean()[k];
+            float stddev = Posterior::stddev()[k];
+            for (int s = 0; s < N; s += 2) {
+                float z = quantile(scrambledRadicalInverse(s/2 + 1, base, a, b));
+                w_[index(k, s)] = mean + stddev*z;
+                if (s + 1 < N) w_[index(k, s + 1)] = mean - stddev*z;
+            }
+        }
+    }
+
+    // Mean of the clamped sample controls, clamped again as in marginalize()
+    float control(float torso_angle, float spoke_angle, float torso_rate, float spoke_rate, bool urgent = false) {
+        float xi[pbc::num_features];
+        pbc::inputLayer<Trig>(torso_angle, spoke_angle, torso_rate, spoke_rate, xi);
+        if (num_chunks == 1) {
+            last_control_ = pbc::marginalControl<Chain, N, Elu>(w_, xi, saturation_);
+            last_samples_ = N;
+            return pbc::clamp(last_control_, saturation_);
+        }
+
+        const int chunks = urgent ? num_chunks : max_chunks_;
+        const float tolerance2 = tolerance_*tolerance_;
+        float sum = 0.0f, sum2 = 0.0f;
+        int n = 0;
+        for (int c = 0; c < chunks; ++c) {
+            float u[Chunk];
+            pbc::batchControl<Chain, Chunk, Elu>(w_ + c*num_params*Chunk, xi, u);
+            for (int s = 0; s < Chunk; ++s) {
+                float v = pbc::clamp(u[s], saturation_);
+                sum += v;
+                sum2 += v*v;
+            }
+            n += Chunk;
+            // the mean's variance, var/n, against the tolerance; never on one sample
+            if (!urgent && c + 1 >= min_chunks_ && n > 1 && tolerance2 > 0.0f) {
+                float mean = sum / n;
+                float variance = (sum2 - sum*mean) / (n - 1);
+                if (variance <= tolerance2*n) break;
+            }
+        }
+        last_control_ = sum / n;
+        last_samples_ = (uint16_t)n;
+        return pbc::clamp(last_control_, saturation_);
+    }
+
+    // Parameter k of sample s
+    float weight(int k, int s) const { return w_[index(k, s)]; }
+
+    void setSaturation(float saturation) { saturation_ = saturation; }
+    float saturation() const { return saturation_; }
+    float lastControl() const { return last_control_; }
+    // Samples the last control() ran
+    int lastSamples() const { return last_samples_; }
+
+private:
+    // Chunk-major, parameter-major within a chunk: k*N + s when Chunk == N
+    static constexpr int index(int k, int s) { return ((s / Chunk)*num_params + k)*Chunk + s % Chunk; }
+
+    static float uniform(uint32_t& state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return ((state >> 8) + 0.5f) * (1.0f / 16777216.0f);
+    }
+
+    static float gaussian(uint32_t& state) {
+        float u1 = uniform(state);
+        float u2 = uniform(state);
+        return sqrtf(-2.0f * logf(u1)) * cosf(6.28318531f * u2);
+    }
+
+    static uint32_t nextPrime(uint32_t n) {
+        for (uint32_t p = n + 1;; ++p) {
+            bool prime = p > 1;
+            for (uint32_t d = 2; d*d <= p && prime; ++d) prime = p % d != 0;
+            if (prime) return p;
+        }
+    }
+
+    // The digits of i in base, each permuted, mirrored behind the point; half
+    // the last digit's weight on top keeps it off 0 and 1
+    static float scrambledRadicalInverse(uint32_t i, uint32_t base, uint32_t a, uint32_t b) {
+        float u = 0.0f, weight = 1.0f/base;
+        float last = weight;
+        for (; i > 0; i /= base) {
+            u += ((a*(i % base) + b) % base)*weight;
+            last = weight;
+            weight /= base;
+        }
+        return u + 0.5f*last;
+    }
+
+    // Acklam's rational approximation of the standard normal quantile, relative error 1.2e-9
+    static float quantile(float p) {
+        static const float a[] = {-3.969683028665376e+01f, 2.209460984245205e+02f, -2.759285104469687e+02f,
+                                  1.383577518672690e+02f, -3.066479806614716e+01f, 2.506628277459239e+00f};
+        static const float b[] = {-5.447609879822406e+01f, 1.615858368580409e+02f, -1.556989798598866e+02f,
+                                  6.680131188771972e+01f, -1.328068155288572e+01f};
+        static const float c[] = {-7.784894002430293e-03f, -3.223964580411365e-01f, -2.400758277161838e+00f,
+                                  -2.549732539343734e+00f, 4.374664141464968e+00f, 2.938163982698783e+00f};
+        static const float d[] = {7.784695709041462e-03f, 3.224671290700398e-01f, 2.445134137142996e+00f,
+                                  3.754408661907416e+00f};
+        const float low = 0.02425f;
+        if (p < low || p > 1.0f - low) {
+            float q = sqrtf(-2.0f*logf(p < low ? p : 1.0f - p));
+            float x = (((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q + c[5]) /
+                      ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1.0f);
+            return p < low ? x : -x;
+        }
+        float q = p - 0.5f, r = q*q;
+        return (((((a[0]*r + a[1])*r + a[2])*r + a[3])*r + a[4])*r + a[5])*q /
+               (((((b[0]*r + b[1])*r + b[2])*r + b[3])*r + b[4])*r + 1.0f);
+    }
+
+    float w_[num_params*N];
+    float saturation_;
+    float tolerance_ = 0.0f;
+    int min_chunks_ = 1;
+    int max_chunks_ = num_chunks;
+    float last_control_ = 0.0f;
+    uint16_t last_samples_ = 0;
+};
+
+#endif //PosteriorBank_h
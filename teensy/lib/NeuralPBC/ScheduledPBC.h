@@ -0,0 +1,90 @@
+#ifndef ScheduledPBC_h
+#define ScheduledPBC_h
+
+#include <stdint.h>
+#include "NeuralPBC.h"
+
+/* Gain scheduling over several trained controllers, e.g. the ones trained
+* and flown at different gains or speeds, blended from one scheduling
+* variable (forward speed, terrain roughness, ...).
+*
+* Each network has a knot, the value of the scheduling variable at which it
+* is used alone; the knots ascend. control() places the variable between two
+* neighbouring knots and blends the two networks' clamped controls linearly,
+* holding the end networks beyond the first and last knot. The input layer
+* is computed once and shared, and only the (at most two) networks with a
+* weight are run, so a network added to the schedule costs its parameters in
+* flash and nothing per tick while the variable is elsewhere.
+*
+* The networks are compile-time types from exportWeights.py, like
+* NeuralPBC's, and may have different widths:
+*
+*     ScheduledPBC<pbc::ExactElu, pbc::ExactTrig, NetSlow, NetFast> pbc(knots, 1.0f);
+*/
+template<class Elu, class Trig, class... Networks>
+class ScheduledPBC {
+public:
+    static constexpr int num_networks = sizeof...(Networks);
+    static constexpr int num_inputs = pbc::num_features;
+    static_assert(num_networks >= 2, "a schedule blends at least two networks");
+
+    ScheduledPBC(const float (&knots)[num_networks], float saturation = 1.0f) : saturation_(saturation) {
+        for (int i = 0; i < num_networks; ++i) knots_[i] = knots[i];
+    }
+
+    // Torque for the spoke in contact at this value of the scheduling variable, clamped to +-saturation
+    float control(float schedule, float torso_angle, float spoke_angle, float torso_rate, float spoke_rate) {
+        float xi[num_inputs];
+        pbc::inputLayer<Trig>(torso_angle, spoke_angle, torso_rate, spoke_rate, xi);
+
+        int i = 0;
+        while (i < num_networks - 2 && schedule >= knots_[i + 1]) ++i;
+        float w = (schedule - knots_[i]) / (knots_[i + 1] - knots_[i]);
+        w = w < 0.0f ? 0.0f : (w > 1.0f ? 1.0f : w);
+
+        float u = 0.0f;
+        if (w < 1.0f) u += (1.0f - w)*pbc::clamp(Dispatch<0, Networks...>::control(i, xi), saturation_);
+        if (w > 0.0f) u += w*pbc::clamp(Dispatch<0, Networks...>::control(i + 1, xi), saturation_);
+        segment_ = (uint8_t)i;
+        blend_ = w;
+        last_control_ = u;
+        return u;
+    }
+
+    void setSaturation(float saturation) { saturation_ = saturation; }
+    float saturation() const { return saturation_; }
+    float knot(int i) const { return knots_[i]; }
+
+    // The last control(): the output, and network segment() blended with segment() + 1 by blend()
+    float lastControl() const { return last_control_; }
+    uint8_t segment() const { return segment_; }
+    float blend() const { return blend_; }
+
+private:
+    // The unclamped control of network j, with the pack unrolled at compile time
+    template<int J, class Network, class... Rest>
+    struct Dispatch {
+        static_assert(Network::num_params == Network::chain::num_params + pbc::num_features,
+                      "parameter count does not match the layer widths");
+        static inline float control(int j, const float* xi) {
+            if (j == J) return pbc::control<typename Network::chain, Elu>(Network::params(), xi);
+            return Dispatch<J + 1, Rest...>::control(j, xi);
+        }
+    };
+    template<int J, class Network>
+    struct Dispatch<J, Network> {
+        static_assert(Network::num_params == Network::chain::num_params + pbc::num_features,
+                      "parameter count does not match the layer widths");
+        static inline float control(int, const float* xi) {
+            return pbc::control<typename Network::chain, Elu>(Network::params(), xi);
+        }
+    };
+
+    float knots_[num_networks];
+    float saturation_;
+    float last_control_ = 0.0f;
+    uint8_t segment_ = 0;
+    float blend_ = 0.0f;
+};
+
+#endif //ScheduledPBC_h
@@ -0,0 +1,56 @@
+#ifndef SparsePBC_h
+#define SparsePBC_h
+
+#include "NeuralPBC.h"
+
+/* The neural PBC as straight-line code generated per network: NeuralPBC.h's
+* fused forward pass of values and their tangent along the gains, with every
+* weight a literal and only the multiply-adds of the weights left after
+* pruning emitted.
+*
+* exportWeights.py writes it into a nested struct sparse of each header,
+* dropping the weights below --prune in magnitude (by default only exact
+* zeros) and the neurons nothing reads once they are gone. The first layer's
+* tangent is the gains times constant weights, so it is folded into one
+* constant per neuron. The exporter runs the pruned network against the
+* dense one and writes the torque error it found into the header; teensy/host's
+* evaluate runs it on recorded runs as the "<name>_sparse" controllers.
+*
+* The weights live in the instruction stream, so there are no parameter
+* loads, and nothing can be handed in at run time: new weights are a
+* re-export and a recompile.
+*
+*     SparsePBC<pbc_weights::deter_hardware_even_1mpers> pbc(1.0f);
+*/
+template<class Network, class Elu = pbc::ExactElu, class Trig = pbc::ExactTrig>
+class SparsePBC {
+public:
+    typedef typename Network::chain Chain;
+    typedef typename Network::sparse Pruned;
+    static constexpr int num_inputs = pbc::num_features;
+    static_assert(Chain::num_inputs == num_inputs, "inputLayer produces 6 features");
+
+    explicit SparsePBC(float saturation = 1.0f) : saturation_(saturation) {}
+
+    // Torque for the spoke in contact, clamped to +-saturation
+    float control(float torso_angle, float spoke_angle, float torso_rate, float spoke_rate) {
+        float xi[num_inputs];
+        pbc::inputLayer<Trig>(torso_angle, spoke_angle, torso_rate, spoke_rate, xi);
+        last_hamiltonian_ = Pruned::template tangent<Elu>(xi, &last_control_);
+        return pbc::clamp(last_control_, saturation_);
+    }
+
+    void setSaturation(float saturation) { saturation_ = saturation; }
+    float saturation() const { return saturation_; }
+
+    // Unclamped output and Hd of the last control() call
+    float lastControl() const { return last_control_; }
+    float lastHamiltonian() const { return last_hamiltonian_; }
+
+private:
+    float saturation_;
+    float last_control_ = 0.0f;
+    float last_hamiltonian_ = 0.0f;
+};
+
+#endif //SparsePBC_h
@@ -0,0 +1,157 @@
+#ifndef WeightUpload_h
+#define WeightUpload_h
+
+#include <stdint.h>
+#include <string.h>
+#include "NeuralPBC.h"
+
+/* New weights for an on-board NeuralPBC, received as an exportWeights.py
+* .pbcw file in chunks (raspi_pkg/WeightChunk) and staged beside the ones the
+* controller runs on.
+*
+* add() takes the chunks in order, each with a CRC-32 of its bytes; one that
+* repeats bytes already taken (a resend after a lost acknowledgement) is
+* accepted and dropped, one past them refused, and a chunk at offset 0 with a
+* new upload id starts over. Once the file is whole it is checked the way
+* raspi_pkg's weightFile.h checks one: magic, version, the Chain's widths,
+* one network's parameter count and the FNV-1a checksum of the data. Only
+* then does add() return COMPLETE, and take() hands out the staged vector for
+* NeuralPBC::setParams().
+*
+* There are two staging vectors and take() moves the next upload to the
+* other one, so the vector the controller was handed is never written. The
+* swap is a pointer store from loop(), which the control interrupt preempts
+* and never the other way round: every step runs on the old weights or the
+* new ones. No Arduino dependency.
+*/
+template<class Network>
+class WeightUpload {
+public:
+    typedef typename Network::chain Chain;
+    static constexpr int num_params = Chain::num_params + pbc::num_features;
+    // weightFile.h's Header, then the floats
+    static constexpr uint32_t header_size = 64;
+    static constexpr uint32_t file_size = header_size + num_params*sizeof(float);
+    static constexpr uint32_t magic = 0x31574250; // "PBW1"
+    static constexpr uint16_t version = 1;
+
+    enum Result : uint8_t { ACCEPTED, COMPLETE, BAD_CRC, OUT_OF_ORDER, WRONG_SIZE, BAD_HEADER, BAD_CHECKSUM };
+
+    Result add(uint32_t upload, uint32_t offset, uint32_t size, uint32_t crc, const uint8_t* data, uint32_t length) {
+        last_ = add_(upload, offset, size, crc, data, length);
+        return last_;
+    }
+
+    // The vector add() completed, for the controller; the next upload stages into the other one
+    const float* take() {
+        const float* params = params_[staging_];
+        staging_ ^= 1;
+        ++swaps_;
+        memcpy(name_, header_ + 40, sizeof(name_) - 1);
+        return params;
+    }
+
+    uint32_t upload() const { return upload_; }
+    uint32_t received() const { return received_; }
+    Result last() const { return last_; }
+    uint32_t swaps() const { return swaps_; }
+    // The name in the header of the weights taken last, "" before any
+    const char* name() const { return name_; }
+
+    static const char* describe(Result result) {
+        switch (result) {
+            case ACCEPTED: return "accepted";
+            case COMPLETE: return "complete";
+            case BAD_CRC: return "chunk crc mismatch";
+            case OUT_OF_ORDER: return "chunk out of order";
+            case WRONG_SIZE: return "file size is not this build's network";
+            case BAD_HEADER: return "not a weight file for this build's widths";
+            case BAD_CHECKSUM: return "weight checksum mismatch";
+        }
+        return "";
+    }
+
+    static uint32_t crc32(const uint8_t* data, uint32_t length) {
+        uint32_t crc = 0xFFFFFFFF;
+        for (uint32_t i = 0; i < length; ++i) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+        return ~crc;
+    }
+
+private:
+    Result add_(uint32_t upload, uint32_t offset, uint32_t size, uint32_t crc, const uint8_t* data, uint32_t length) {
+        if (crc32(data, length) != crc)
+            return BAD_CRC;
+        if (offset == 0 && (upload != upload_ || received_ == 0)) {
+            if (size != file_size)
+                return WRONG_SIZE;
+            upload_ = upload;
+            received_ = 0;
+        }
+        if (upload != upload_ || size != file_size || offset > received_)
+            return OUT_OF_ORDER;
+        if (offset + length <= received_ || received_ == file_size)
+            return ACCEPTED;
+        if (offset + length > file_size)
+            return WRONG_SIZE;
+        // only the part past what is already staged
+        uint32_t skip = received_ - offset;
+        for (uint32_t i = skip; i < length; ++i)
+            store(offset + i, data[i]);
+        received_ = offset + length;
+        if (received_ < file_size)
+            return ACCEPTED;
+        Result checked = check();
+        if (checked != COMPLETE)
+            received_ = 0;
+        return checked;
+    }
+
+    void store(uint32_t at, uint8_t byte) {
+        if (at < header_size)
+            header_[at] = byte;
+        else
+            reinterpret_cast<uint8_t*>(params_[staging_])[at - header_size] = byte;
+    }
+
+    uint32_t word(int at) const {
+        uint32_t w;
+        memcpy(&w, header_ + at, sizeof(w));
+        return w;
+    }
+    uint16_t half(int at) const {
+        uint16_t h;
+        memcpy(&h, header_ + at, sizeof(h));
+        return h;
+    }
+
+    Result check() const {
+        // magic, version, numWidths, widths[8], numParams, numSamples, dataOffset, checksum, name
+        uint16_t widths[Chain::num_widths];
+        Chain::widths(widths);
+        bool same = word(0) == magic && half(4) == version && half(6) == Chain::num_widths;
+        for (int i = 0; same && i < Chain::num_widths; ++i)
+            same = half(8 + 2*i) == widths[i];
+        if (!same || word(24) != (uint32_t)num_params || word(28) != 0 || word(32) != header_size)
+            return BAD_HEADER;
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(params_[staging_]);
+        uint32_t h = 0x811C9DC5u;
+        for (uint32_t i = 0; i < num_params*sizeof(float); ++i)
+            h = (h ^ p[i]) * 0x01000193u;
+        return h == word(36) ? COMPLETE : BAD_CHECKSUM;
+    }
+
+    uint8_t header_[header_size] = {};
+    float params_[2][num_params] = {};
+    uint8_t staging_ = 0;
+    uint32_t upload_ = 0;
+    uint32_t received_ = 0;
+    uint32_t swaps_ = 0;
+    Result last_ = ACCEPTED;
+    char name_[24] = {};
+};
+
+#endif //WeightUpload_h
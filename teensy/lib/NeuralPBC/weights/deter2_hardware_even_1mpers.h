@@ -0,0 +1,176 @@
+// Generated by julia_pkg/src/exportWeights.py from saved_weights/deter2_hardware_even_1mpers_6-8-8-7-7-1_elu.bson, do not edit.
+#ifndef PbcWeights_deter2_hardware_even_1mpers_h
+#define PbcWeights_deter2_hardware_even_1mpers_h
+
+#include "NeuralPBC.h"
+
+namespace pbc_weights {
+
+// deter2_hardware_even_1mpers_6-8-8-7-7-1_elu.bson
+struct deter2_hardware_even_1mpers {
+    typedef pbc::Chain<6, 8, 7, 1> chain;
+    static constexpr int num_params = 133;
+    static const float* params() {
+        static const float values[num_params] = {
+            -1.50720739f, 0.384009331f, 1.45295382f, -0.931562185f, -0.765527904f, -0.587349832f,
+            0.448976278f, -1.00851488f, -1.07922471f, 0.831700802f, 0.284042507f, -0.841266274f,
+            0.721823931f, 0.963882089f, -2.92314386f, 0.968797624f, -0.0621010512f, 0.0653073937f,
+            0.222544581f, 0.291652292f, -0.112361111f, 0.705441475f, 0.142964482f, -0.0230681822f,
+            -0.137477472f, 0.196120501f, -0.422346175f, 0.783180118f, 0.211929113f, -0.469790846f,
+            -0.288505286f, 0.0637383908f, -0.630449355f, -0.515619636f, 0.143265083f, -1.24061835f,
+            -0.0358633623f, 0.319745332f, -0.224271446f, 0.255822599f, -0.846928477f, -0.776132941f,
+            1.77108192f, 0.56433785f, -0.271799386f, -0.393468082f, -0.0629133582f, 0.724841177f,
+            -0.501492441f, -0.0528996438f, -0.77393198f, 0.526882172f, 0.0147042861f, -0.534169197f,
+            -0.0460167676f, -1.23829401f, 0.190642595f, 0.0677773431f, 0.320093483f, 0.746352613f,
+            -0.0892397687f, -0.395220041f, 1.01789236f, -1.21734548f, -1.54367745f, -0.439480454f,
+            0.6755898f, 0.327721208f, 0.296842784f, 0.576398969f, 0.363565028f, -0.634442568f,
+            0.423182607f, 0.0688398331f, 0.977393925f, 0.584844232f, 0.30697155f, -0.497052461f,
+            0.0836407542f, 0.63167274f, 0.304776281f, -0.681779563f, -0.216573104f, 0.457816184f,
+            -0.0807108432f, -0.297770888f, 0.202521622f, -0.0312393904f, -0.172194213f, 0.186366871f,
+            0.401938736f, 0.0829176605f, -1.21654582f, -0.0933403745f, 0.653405905f, -0.616349816f,
+            -0.155299008f, 0.69279635f, -0.788950741f, 0.430651993f, 1.17565131f, -0.515880167f,
+            -0.350637436f, -0.472012669f, 0.0727971941f, -0.308101773f, -0.769192755f, 1.02698553f,
+            1.76069021f, -0.582218111f, -0.178922176f, 1.36495876f, 0.308431029f, 0.406627238f,
+            0.0338012725f, -0.594313383f, 0.803564906f, 0.69237411f, -0.3937096f, 0.467799544f,
+            -0.755529583f, -1.22230315f, -0.553330839f, 1.18950069f, 0.681600809f, -0.818445265f,
+            0.254948169f, 0.459364504f, 0.899003148f, 0.257186502f, -0.627179325f, 0.694900453f,
+            0.72661984f,
+        };
+        return values;
+    }
+
+    // int16 for FixedPBC.h, layer l scaled by 2^shifts()[l] and the gains by the last;
+    // against float64 over 4096 states: max |u error| 1.42e-03, rms 3.72e-04
+    struct fixed {
+        static constexpr int num_shifts = 4;
+        static const int8_t* shifts() {
+            static const int8_t values[num_shifts] = {13, 14, 14, 15};
+            return values;
+        }
+        static const int16_t* params() {
+            static const int16_t values[num_params] = {
+                -12347, 3146, 11903, -7631, -6271, -4812, 3678, -8262, -8841, 6813, 2327, -6892,
+                5913, 7896, -23946, 7936, -509, 535, 1823, 2389, -920, 5779, 1171, -189,
+                -1126, 1607, -3460, 6416, 1736, -3849, -2363, 522, -5165, -4224, 1174, -10163,
+                -294, 2619, -1837, 2096, -6938, -6358, 14509, 4623, -2227, -3223, -515, 5938,
+                -4108, -433, -6340, 4316, 120, -4376, -377, -10144, 3123, 1110, 5244, 12228,
+                -1462, -6475, 16677, -19945, -25292, -7200, 11069, 5369, 4863, 9444, 5957, -10395,
+                6933, 1128, 16014, 9582, 5029, -8144, 1370, 10349, 4993, -11170, -3548, 7501,
+                -1322, -4879, 3318, -512, -2821, 3053, 6585, 1359, -19932, -1529, 10705, -10098,
+                -2544, 11351, -12926, 7056, 19262, -8452, -5745, -7733, 1193, -5048, -12602, 16826,
+                28847, -9539, -2931, 22363, 5053, 6662, 554, -9737, 13166, 11344, -6451, 7664,
+                -12379, -20026, -9066, 19489, 11167, -13409, 4177, 15052, 29459, 8427, -20551, 22770,
+                23810,
+            };
+            return values;
+        }
+    };
+
+    // straight-line pass for SparsePBC.h, weights below 0 pruned: 111 of 111 kept;
+    // against the dense network over 4096 states: max |u error| 0.00e+00, rms 0.00e+00
+    struct sparse {
+        static constexpr int num_weights = 111;
+        static constexpr int num_kept = 111;
+
+        // Hd(x) and into dh its derivative along the gains, as Chain::tangent()
+        template<class Elu = pbc::ExactElu>
+        static inline float tangent(const float* x, float* dh) {
+            float y0_0 = -0.501492441f - 1.50720739f*x[0] - 1.07922471f*x[1] - 0.0621010512f*x[2] - 0.137477472f*x[3] - 0.630449355f*x[4] - 0.846928477f*x[5];
+            float dy0_0 = -2.64582705f;
+            if (y0_0 <= 0.0f) {
+                y0_0 = Elu::expm1(y0_0);
+                dy0_0 *= y0_0 + 1.0f;
+            }
+            float y0_1 = -0.0528996438f + 0.384009331f*x[0] + 0.831700802f*x[1] + 0.0653073937f*x[2] + 0.196120501f*x[3] - 0.515619636f*x[4] - 0.776132941f*x[5];
+            float dy0_1 = -0.104362562f;
+            if (y0_1 <= 0.0f) {
+                y0_1 = Elu::expm1(y0_1);
+                dy0_1 *= y0_1 + 1.0f;
+            }
+            float y0_2 = -0.77393198f + 1.45295382f*x[0] + 0.284042507f*x[1] + 0.222544581f*x[2] - 0.422346175f*x[3] + 0.143265083f*x[4] + 1.77108192f*x[5];
+            float dy0_2 = 2.63137102f;
+            if (y0_2 <= 0.0f) {
+                y0_2 = Elu::expm1(y0_2);
+                dy0_2 *= y0_2 + 1.0f;
+            }
+            float y0_3 = 0.526882172f - 0.931562185f*x[0] - 0.841266274f*x[1] + 0.291652292f*x[2] + 0.783180118f*x[3] - 1.24061835f*x[4] + 0.56433785f*x[5];
+            float dy0_3 = -2.05246019f;
+            if (y0_3 <= 0.0f) {
+                y0_3 = Elu::expm1(y0_3);
+                dy0_3 *= y0_3 + 1.0f;
+            }
+            float y0_4 = 0.0147042861f - 0.765527904f*x[0] + 0.721823931f*x[1] - 0.112361111f*x[2] + 0.211929113f*x[3] - 0.0358633623f*x[4] - 0.271799386f*x[5];
+            float dy0_4 = -0.0869659707f;
+            if (y0_4 <= 0.0f) {
+                y0_4 = Elu::expm1(y0_4);
+                dy0_4 *= y0_4 + 1.0f;
+            }
+            float y0_5 = -0.534169197f - 0.587349832f*x[0] + 0.963882089f*x[1] + 0.705441475f*x[2] - 0.469790846f*x[3] + 0.319745332f*x[4] - 0.393468082f*x[5];
+            float dy0_5 = 1.00908792f;
+            if (y0_5 <= 0.0f) {
+                y0_5 = Elu::expm1(y0_5);
+                dy0_5 *= y0_5 + 1.0f;
+            }
+            float y0_6 = -0.0460167676f + 0.448976278f*x[0] - 2.92314386f*x[1] + 0.142964482f*x[2] - 0.288505286f*x[3] - 0.224271446f*x[4] - 0.0629133582f*x[5];
+            float dy0_6 = -2.40551901f;
+            if (y0_6 <= 0.0f) {
+                y0_6 = Elu::expm1(y0_6);
+                dy0_6 *= y0_6 + 1.0f;
+            }
+            float y0_7 = -1.23829401f - 1.00851488f*x[0] + 0.968797624f*x[1] - 0.0230681822f*x[2] + 0.0637383908f*x[3] + 0.255822599f*x[4] + 0.724841177f*x[5];
+            float dy0_7 = 1.06622314f;
+            if (y0_7 <= 0.0f) {
+                y0_7 = Elu::expm1(y0_7);
+                dy0_7 *= y0_7 + 1.0f;
+            }
+            float y1_0 = 0.308431029f + 0.190642595f*y0_0 - 1.21734548f*y0_1 + 0.363565028f*y0_2 - 0.497052461f*y0_3 - 0.0807108432f*y0_4 + 0.0829176605f*y0_5 - 0.788950741f*y0_6 - 0.308101773f*y0_7;
+            float dy1_0 = 0.190642595f*dy0_0 - 1.21734548f*dy0_1 + 0.363565028f*dy0_2 - 0.497052461f*dy0_3 - 0.0807108432f*dy0_4 + 0.0829176605f*dy0_5 - 0.788950741f*dy0_6 - 0.308101773f*dy0_7;
+            if (y1_0 <= 0.0f) {
+                y1_0 = Elu::expm1(y1_0);
+                dy1_0 *= y1_0 + 1.0f;
+            }
+            float y1_1 = 0.406627238f + 0.0677773431f*y0_0 - 1.54367745f*y0_1 - 0.634442568f*y0_2 + 0.0836407542f*y0_3 - 0.297770888f*y0_4 - 1.21654582f*y0_5 + 0.430651993f*y0_6 - 0.769192755f*y0_7;
+            float dy1_1 = 0.0677773431f*dy0_0 - 1.54367745f*dy0_1 - 0.634442568f*dy0_2 + 0.0836407542f*dy0_3 - 0.297770888f*dy0_4 - 1.21654582f*dy0_5 + 0.430651993f*dy0_6 - 0.769192755f*dy0_7;
+            if (y1_1 <= 0.0f) {
+                y1_1 = Elu::expm1(y1_1);
+                dy1_1 *= y1_1 + 1.0f;
+            }
+            float y1_2 = 0.0338012725f + 0.320093483f*y0_0 - 0.439480454f*y0_1 + 0.423182607f*y0_2 + 0.63167274f*y0_3 + 0.202521622f*y0_4 - 0.0933403745f*y0_5 + 1.17565131f*y0_6 + 1.02698553f*y0_7;
+            float dy1_2 = 0.320093483f*dy0_0 - 0.439480454f*dy0_1 + 0.423182607f*dy0_2 + 0.63167274f*dy0_3 + 0.202521622f*dy0_4 - 0.0933403745f*dy0_5 + 1.17565131f*dy0_6 + 1.02698553f*dy0_7;
+            if (y1_2 <= 0.0f) {
+                y1_2 = Elu::expm1(y1_2);
+                dy1_2 *= y1_2 + 1.0f;
+            }
+            float y1_3 = -0.594313383f + 0.746352613f*y0_0 + 0.6755898f*y0_1 + 0.0688398331f*y0_2 + 0.304776281f*y0_3 - 0.0312393904f*y0_4 + 0.653405905f*y0_5 - 0.515880167f*y0_6 + 1.76069021f*y0_7;
+            float dy1_3 = 0.746352613f*dy0_0 + 0.6755898f*dy0_1 + 0.0688398331f*dy0_2 + 0.304776281f*dy0_3 - 0.0312393904f*dy0_4 + 0.653405905f*dy0_5 - 0.515880167f*dy0_6 + 1.76069021f*dy0_7;
+            if (y1_3 <= 0.0f) {
+                y1_3 = Elu::expm1(y1_3);
+                dy1_3 *= y1_3 + 1.0f;
+            }
+            float y1_4 = 0.803564906f - 0.0892397687f*y0_0 + 0.327721208f*y0_1 + 0.977393925f*y0_2 - 0.681779563f*y0_3 - 0.172194213f*y0_4 - 0.616349816f*y0_5 - 0.350637436f*y0_6 - 0.582218111f*y0_7;
+            float dy1_4 = -0.0892397687f*dy0_0 + 0.327721208f*dy0_1 + 0.977393925f*dy0_2 - 0.681779563f*dy0_3 - 0.172194213f*dy0_4 - 0.616349816f*dy0_5 - 0.350637436f*dy0_6 - 0.582218111f*dy0_7;
+            if (y1_4 <= 0.0f) {
+                y1_4 = Elu::expm1(y1_4);
+                dy1_4 *= y1_4 + 1.0f;
+            }
+            float y1_5 = 0.69237411f - 0.395220041f*y0_0 + 0.296842784f*y0_1 + 0.584844232f*y0_2 - 0.216573104f*y0_3 + 0.186366871f*y0_4 - 0.155299008f*y0_5 - 0.472012669f*y0_6 - 0.178922176f*y0_7;
+            float dy1_5 = -0.395220041f*dy0_0 + 0.296842784f*dy0_1 + 0.584844232f*dy0_2 - 0.216573104f*dy0_3 + 0.186366871f*dy0_4 - 0.155299008f*dy0_5 - 0.472012669f*dy0_6 - 0.178922176f*dy0_7;
+            if (y1_5 <= 0.0f) {
+                y1_5 = Elu::expm1(y1_5);
+                dy1_5 *= y1_5 + 1.0f;
+            }
+            float y1_6 = -0.3937096f + 1.01789236f*y0_0 + 0.576398969f*y0_1 + 0.30697155f*y0_2 + 0.457816184f*y0_3 + 0.401938736f*y0_4 + 0.69279635f*y0_5 + 0.0727971941f*y0_6 + 1.36495876f*y0_7;
+            float dy1_6 = 1.01789236f*dy0_0 + 0.576398969f*dy0_1 + 0.30697155f*dy0_2 + 0.457816184f*dy0_3 + 0.401938736f*dy0_4 + 0.69279635f*dy0_5 + 0.0727971941f*dy0_6 + 1.36495876f*dy0_7;
+            if (y1_6 <= 0.0f) {
+                y1_6 = Elu::expm1(y1_6);
+                dy1_6 *= y1_6 + 1.0f;
+            }
+            *dh = 0.467799544f*dy1_0 - 0.755529583f*dy1_1 - 1.22230315f*dy1_2 - 0.553330839f*dy1_3 + 1.18950069f*dy1_4 + 0.681600809f*dy1_5 - 0.818445265f*dy1_6;
+            return 0.254948169f + 0.467799544f*y1_0 - 0.755529583f*y1_1 - 1.22230315f*y1_2 - 0.553330839f*y1_3 + 1.18950069f*y1_4 + 0.681600809f*y1_5 - 0.818445265f*y1_6;
+        }
+    };
+};
+
+} // namespace pbc_weights
+
+#endif //PbcWeights_deter2_hardware_even_1mpers_h
@@ -0,0 +1,176 @@
+// Generated by julia_pkg/src/exportWeights.py from saved_weights/deter_hardware_even_1mpers_6-8-8-7-7-1_elu.bson, do not edit.
+#ifndef PbcWeights_deter_hardware_even_1mpers_h
+#define PbcWeights_deter_hardware_even_1mpers_h
+
+#include "NeuralPBC.h"
+
+namespace pbc_weights {
+
+// deter_hardware_even_1mpers_6-8-8-7-7-1_elu.bson, evaluatePbc.jl
+struct deter_hardware_even_1mpers {
+    typedef pbc::Chain<6, 8, 7, 1> chain;
+    static constexpr int num_params = 133;
+    static const float* params() {
+        static const float values[num_params] = {
+            -0.918824315f, 0.623910189f, 1.39990354f, -0.0495406277f, -0.616936624f, -0.502371371f,
+            0.462781191f, -0.79740262f, -1.16447008f, 0.780759037f, 0.513018787f, -0.97137022f,
+            0.608188391f, 0.86628443f, -1.76766109f, 0.908113182f, 0.186709419f, 0.542027712f,
+            0.474020213f, 0.120657116f, 0.186154485f, 1.02841413f, -0.0955205411f, 0.0809557214f,
+            0.147859365f, 0.282366157f, -0.527948081f, -0.0408231132f, 0.102343589f, -0.594382048f,
+            0.33602944f, 0.00208294578f, -0.574890316f, -0.350656599f, 0.187371597f, -0.618271828f,
+            0.082370989f, 0.375334144f, -0.244563997f, 0.257382959f, -0.845167756f, -0.669676065f,
+            1.29050684f, 0.326096624f, -0.417257935f, -0.372137457f, -0.148980156f, 0.553872764f,
+            -0.496202856f, 0.0636046231f, -0.463826448f, 0.572335899f, 0.111199275f, -0.523403823f,
+            0.00892844889f, -1.0937953f, 0.0858904049f, 0.113280624f, 0.215996146f, 0.675559878f,
+            -0.228178337f, -0.498972178f, 0.875177801f, -0.654727995f, -1.57296741f, -0.586540103f,
+            0.875384331f, 0.417818844f, 0.277525336f, 0.420413256f, 0.154929072f, -0.608265102f,
+            0.399743527f, 0.108863287f, 0.83146739f, 0.460005254f, 0.319143236f, -0.553300738f,
+            0.0967919827f, 0.507950068f, -0.0586252846f, -0.467266232f, -0.143520027f, 0.391607404f,
+            0.0426971316f, -0.212163091f, -0.0180559643f, 0.0449222103f, -0.347157031f, 0.0709097907f,
+            0.216410622f, 0.0775969177f, -1.34636176f, -0.0850887224f, 0.734813154f, -0.710042298f,
+            -0.0824445263f, 0.749708235f, -0.701300025f, 0.402020097f, 0.932229161f, -0.645199835f,
+            -0.198543146f, -0.377580225f, 0.161816999f, -0.32397452f, -0.47852242f, 0.52599901f,
+            1.36233366f, -0.451587051f, -0.161525294f, 0.90104115f, 0.553429008f, 0.390970618f,
+            0.0748010129f, -0.125161871f, 0.574481606f, 0.69237411f, -0.401610523f, 0.201326877f,
+            -0.769140363f, -0.857818842f, -0.489220589f, 0.985998392f, 0.638239205f, -0.606189966f,
+            0.254948169f, 0.479883611f, 0.675276041f, 0.218709856f, -0.360251635f, 0.448031366f,
+            0.609325111f,
+        };
+        return values;
+    }
+
+    // int16 for FixedPBC.h, layer l scaled by 2^shifts()[l] and the gains by the last;
+    // against float64 over 4096 states: max |u error| 4.78e-04, rms 1.00e-04
+    struct fixed {
+        static constexpr int num_shifts = 4;
+        static const int8_t* shifts() {
+            static const int8_t values[num_shifts] = {14, 14, 15, 15};
+            return values;
+        }
+        static const int16_t* params() {
+            static const int16_t values[num_params] = {
+                -15054, 10222, 22936, -812, -10108, -8231, 7582, -13065, -19079, 12792, 8405, -15915,
+                9965, 14193, -28961, 14879, 3059, 8881, 7766, 1977, 3050, 16850, -1565, 1326,
+                2423, 4626, -8650, -669, 1677, -9738, 5506, 34, -9419, -5745, 3070, -10130,
+                1350, 6149, -4007, 4217, -13847, -10972, 21144, 5343, -6836, -6097, -2441, 9075,
+                -8130, 1042, -7599, 9377, 1822, -8575, 146, -17921, 1407, 1856, 3539, 11068,
+                -3738, -8175, 14339, -10727, -25771, -9610, 14342, 6846, 4547, 6888, 2538, -9966,
+                6549, 1784, 13623, 7537, 5229, -9065, 1586, 8322, -961, -7656, -2351, 6416,
+                700, -3476, -296, 736, -5688, 1162, 3546, 1271, -22059, -1394, 12039, -11633,
+                -1351, 12283, -11490, 6587, 15274, -10571, -3253, -6186, 2651, -5308, -7840, 8618,
+                22320, -7399, -2646, 14763, 9067, 6406, 1226, -2051, 9412, 11344, -6580, 6597,
+                -25203, -28109, -16031, 32309, 20914, -19864, 8354, 15725, 22127, 7167, -11805, 14681,
+                19966,
+            };
+            return values;
+        }
+    };
+
+    // straight-line pass for SparsePBC.h, weights below 0 pruned: 111 of 111 kept;
+    // against the dense network over 4096 states: max |u error| 0.00e+00, rms 0.00e+00
+    struct sparse {
+        static constexpr int num_weights = 111;
+        static constexpr int num_kept = 111;
+
+        // Hd(x) and into dh its derivative along the gains, as Chain::tangent()
+        template<class Elu = pbc::ExactElu>
+        static inline float tangent(const float* x, float* dh) {
+            float y0_0 = -0.496202856f - 0.918824315f*x[0] - 1.16447008f*x[1] + 0.186709419f*x[2] + 0.147859365f*x[3] - 0.574890316f*x[4] - 0.845167756f*x[5];
+            float dy0_0 = -2.01224971f;
+            if (y0_0 <= 0.0f) {
+                y0_0 = Elu::expm1(y0_0);
+                dy0_0 *= y0_0 + 1.0f;
+            }
+            float y0_1 = 0.0636046231f + 0.623910189f*x[0] + 0.780759037f*x[1] + 0.542027712f*x[2] + 0.282366157f*x[3] - 0.350656599f*x[4] - 0.669676065f*x[5];
+            float dy0_1 = 0.278300494f;
+            if (y0_1 <= 0.0f) {
+                y0_1 = Elu::expm1(y0_1);
+                dy0_1 *= y0_1 + 1.0f;
+            }
+            float y0_2 = -0.463826448f + 1.39990354f*x[0] + 0.513018787f*x[1] + 0.474020213f*x[2] - 0.527948081f*x[3] + 0.187371597f*x[4] + 1.29050684f*x[5];
+            float dy0_2 = 2.18237376f;
+            if (y0_2 <= 0.0f) {
+                y0_2 = Elu::expm1(y0_2);
+                dy0_2 *= y0_2 + 1.0f;
+            }
+            float y0_3 = 0.572335899f - 0.0495406277f*x[0] - 0.97137022f*x[1] + 0.120657116f*x[2] - 0.0408231132f*x[3] - 0.618271828f*x[4] + 0.326096624f*x[5];
+            float dy0_3 = -0.716927588f;
+            if (y0_3 <= 0.0f) {
+                y0_3 = Elu::expm1(y0_3);
+                dy0_3 *= y0_3 + 1.0f;
+            }
+            float y0_4 = 0.111199275f - 0.616936624f*x[0] + 0.608188391f*x[1] + 0.186154485f*x[2] + 0.102343589f*x[3] + 0.082370989f*x[4] - 0.417257935f*x[5];
+            float dy0_4 = -0.0988593027f;
+            if (y0_4 <= 0.0f) {
+                y0_4 = Elu::expm1(y0_4);
+                dy0_4 *= y0_4 + 1.0f;
+            }
+            float y0_5 = -0.523403823f - 0.502371371f*x[0] + 0.86628443f*x[1] + 1.02841413f*x[2] - 0.594382048f*x[3] + 0.375334144f*x[4] - 0.372137457f*x[5];
+            float dy0_5 = 0.724361539f;
+            if (y0_5 <= 0.0f) {
+                y0_5 = Elu::expm1(y0_5);
+                dy0_5 *= y0_5 + 1.0f;
+            }
+            float y0_6 = 0.00892844889f + 0.462781191f*x[0] - 1.76766109f*x[1] - 0.0955205411f*x[2] + 0.33602944f*x[3] - 0.244563997f*x[4] - 0.148980156f*x[5];
+            float dy0_6 = -1.31387424f;
+            if (y0_6 <= 0.0f) {
+                y0_6 = Elu::expm1(y0_6);
+                dy0_6 *= y0_6 + 1.0f;
+            }
+            float y0_7 = -1.0937953f - 0.79740262f*x[0] + 0.908113182f*x[1] + 0.0809557214f*x[2] + 0.00208294578f*x[3] + 0.257382959f*x[4] + 0.553872764f*x[5];
+            float dy0_7 = 0.700326264f;
+            if (y0_7 <= 0.0f) {
+                y0_7 = Elu::expm1(y0_7);
+                dy0_7 *= y0_7 + 1.0f;
+            }
+            float y1_0 = 0.553429008f + 0.0858904049f*y0_0 - 0.654727995f*y0_1 + 0.154929072f*y0_2 - 0.553300738f*y0_3 + 0.0426971316f*y0_4 + 0.0775969177f*y0_5 - 0.701300025f*y0_6 - 0.32397452f*y0_7;
+            float dy1_0 = 0.0858904049f*dy0_0 - 0.654727995f*dy0_1 + 0.154929072f*dy0_2 - 0.553300738f*dy0_3 + 0.0426971316f*dy0_4 + 0.0775969177f*dy0_5 - 0.701300025f*dy0_6 - 0.32397452f*dy0_7;
+            if (y1_0 <= 0.0f) {
+                y1_0 = Elu::expm1(y1_0);
+                dy1_0 *= y1_0 + 1.0f;
+            }
+            float y1_1 = 0.390970618f + 0.113280624f*y0_0 - 1.57296741f*y0_1 - 0.608265102f*y0_2 + 0.0967919827f*y0_3 - 0.212163091f*y0_4 - 1.34636176f*y0_5 + 0.402020097f*y0_6 - 0.47852242f*y0_7;
+            float dy1_1 = 0.113280624f*dy0_0 - 1.57296741f*dy0_1 - 0.608265102f*dy0_2 + 0.0967919827f*dy0_3 - 0.212163091f*dy0_4 - 1.34636176f*dy0_5 + 0.402020097f*dy0_6 - 0.47852242f*dy0_7;
+            if (y1_1 <= 0.0f) {
+                y1_1 = Elu::expm1(y1_1);
+                dy1_1 *= y1_1 + 1.0f;
+            }
+            float y1_2 = 0.0748010129f + 0.215996146f*y0_0 - 0.586540103f*y0_1 + 0.399743527f*y0_2 + 0.507950068f*y0_3 - 0.0180559643f*y0_4 - 0.0850887224f*y0_5 + 0.932229161f*y0_6 + 0.52599901f*y0_7;
+            float dy1_2 = 0.215996146f*dy0_0 - 0.586540103f*dy0_1 + 0.399743527f*dy0_2 + 0.507950068f*dy0_3 - 0.0180559643f*dy0_4 - 0.0850887224f*dy0_5 + 0.932229161f*dy0_6 + 0.52599901f*dy0_7;
+            if (y1_2 <= 0.0f) {
+                y1_2 = Elu::expm1(y1_2);
+                dy1_2 *= y1_2 + 1.0f;
+            }
+            float y1_3 = -0.125161871f + 0.675559878f*y0_0 + 0.875384331f*y0_1 + 0.108863287f*y0_2 - 0.0586252846f*y0_3 + 0.0449222103f*y0_4 + 0.734813154f*y0_5 - 0.645199835f*y0_6 + 1.36233366f*y0_7;
+            float dy1_3 = 0.675559878f*dy0_0 + 0.875384331f*dy0_1 + 0.108863287f*dy0_2 - 0.0586252846f*dy0_3 + 0.0449222103f*dy0_4 + 0.734813154f*dy0_5 - 0.645199835f*dy0_6 + 1.36233366f*dy0_7;
+            if (y1_3 <= 0.0f) {
+                y1_3 = Elu::expm1(y1_3);
+                dy1_3 *= y1_3 + 1.0f;
+            }
+            float y1_4 = 0.574481606f - 0.228178337f*y0_0 + 0.417818844f*y0_1 + 0.83146739f*y0_2 - 0.467266232f*y0_3 - 0.347157031f*y0_4 - 0.710042298f*y0_5 - 0.198543146f*y0_6 - 0.451587051f*y0_7;
+            float dy1_4 = -0.228178337f*dy0_0 + 0.417818844f*dy0_1 + 0.83146739f*dy0_2 - 0.467266232f*dy0_3 - 0.347157031f*dy0_4 - 0.710042298f*dy0_5 - 0.198543146f*dy0_6 - 0.451587051f*dy0_7;
+            if (y1_4 <= 0.0f) {
+                y1_4 = Elu::expm1(y1_4);
+                dy1_4 *= y1_4 + 1.0f;
+            }
+            float y1_5 = 0.69237411f - 0.498972178f*y0_0 + 0.277525336f*y0_1 + 0.460005254f*y0_2 - 0.143520027f*y0_3 + 0.0709097907f*y0_4 - 0.0824445263f*y0_5 - 0.377580225f*y0_6 - 0.161525294f*y0_7;
+            float dy1_5 = -0.498972178f*dy0_0 + 0.277525336f*dy0_1 + 0.460005254f*dy0_2 - 0.143520027f*dy0_3 + 0.0709097907f*dy0_4 - 0.0824445263f*dy0_5 - 0.377580225f*dy0_6 - 0.161525294f*dy0_7;
+            if (y1_5 <= 0.0f) {
+                y1_5 = Elu::expm1(y1_5);
+                dy1_5 *= y1_5 + 1.0f;
+            }
+            float y1_6 = -0.401610523f + 0.875177801f*y0_0 + 0.420413256f*y0_1 + 0.319143236f*y0_2 + 0.391607404f*y0_3 + 0.216410622f*y0_4 + 0.749708235f*y0_5 + 0.161816999f*y0_6 + 0.90104115f*y0_7;
+            float dy1_6 = 0.875177801f*dy0_0 + 0.420413256f*dy0_1 + 0.319143236f*dy0_2 + 0.391607404f*dy0_3 + 0.216410622f*dy0_4 + 0.749708235f*dy0_5 + 0.161816999f*dy0_6 + 0.90104115f*dy0_7;
+            if (y1_6 <= 0.0f) {
+                y1_6 = Elu::expm1(y1_6);
+                dy1_6 *= y1_6 + 1.0f;
+            }
+            *dh = 0.201326877f*dy1_0 - 0.769140363f*dy1_1 - 0.857818842f*dy1_2 - 0.489220589f*dy1_3 + 0.985998392f*dy1_4 + 0.638239205f*dy1_5 - 0.606189966f*dy1_6;
+            return 0.254948169f + 0.201326877f*y1_0 - 0.769140363f*y1_1 - 0.857818842f*y1_2 - 0.489220589f*y1_3 + 0.985998392f*y1_4 + 0.638239205f*y1_5 - 0.606189966f*y1_6;
+        }
+    };
+};
+
+} // namespace pbc_weights
+
+#endif //PbcWeights_deter_hardware_even_1mpers_h
@@ -0,0 +1,176 @@
+// Generated by julia_pkg/src/exportWeights.py from saved_weights/deterministic_hardware_6-8-8-7-7-1_elu.bson, do not edit.
+#ifndef PbcWeights_deterministic_hardware_h
+#define PbcWeights_deterministic_hardware_h
+
+#include "NeuralPBC.h"
+
+namespace pbc_weights {
+
+// deterministic_hardware_6-8-8-7-7-1_elu.bson
+struct deterministic_hardware {
+    typedef pbc::Chain<6, 8, 7, 1> chain;
+    static constexpr int num_params = 133;
+    static const float* params() {
+        static const float values[num_params] = {
+            0.539166272f, -0.925893426f, 0.0335611776f, -0.03257332f, -0.0952505246f, -0.348358154f,
+            -0.350212097f, 0.48987025f, 0.308859378f, -0.639934063f, 0.293907762f, 0.207754627f,
+            0.08480189f, -0.286747426f, -0.0107369116f, 0.31798318f, -0.281318069f, -0.158090264f,
+            -0.00382199488f, -0.38811627f, -0.466497749f, 0.237810418f, 0.603761435f, -0.0274680462f,
+            -0.0224301778f, -0.239806414f, 0.220434189f, -0.804217815f, -0.278744698f, -0.279227078f,
+            0.0402294062f, 0.529843986f, -0.0892707929f, -0.447197795f, 1.09909415f, 0.523322225f,
+            0.362608463f, -0.322878808f, 0.49230817f, -0.378747255f, 0.433446795f, -0.401895344f,
+            -0.0922730267f, 0.421090901f, -0.209574044f, -0.438004106f, -0.641183019f, 0.599974036f,
+            -0.0955272391f, 0.351928055f, 0.457977891f, -0.50639081f, -0.316139072f, 0.172662437f,
+            -0.162621379f, 0.300450385f, 0.247955516f, -0.234910041f, -0.40039593f, 0.0220024828f,
+            0.399801403f, 0.81227529f, -0.21688509f, -0.346616358f, 0.40254733f, -0.104634292f,
+            -0.526800454f, -0.152547076f, -0.403981954f, 0.303154469f, -0.363298863f, -0.463965744f,
+            0.121443301f, -0.213449687f, 0.23836118f, -0.311854631f, -0.469273597f, -0.463991731f,
+            0.214277685f, -0.217274487f, -0.145454928f, -0.189433664f, -0.0894473046f, -0.851050615f,
+            0.210365012f, -0.142395288f, 0.408721328f, 0.202360079f, 0.132897228f, 0.0324954316f,
+            -0.0441814587f, 0.261135489f, 0.416294903f, 0.0606867783f, -0.322264224f, -0.0121464003f,
+            -0.408580065f, -0.495505661f, -0.0384194031f, -0.154393539f, 0.138310596f, -0.335139036f,
+            0.333088338f, -1.06321287f, 0.0577290654f, -0.0520425811f, -0.188742951f, -0.0182041489f,
+            0.650482476f, 0.215037018f, 0.522661686f, -0.595259607f, 0.502714276f, -0.059378881f,
+            -0.0538652204f, 0.287522554f, 0.218532428f, -0.266357362f, -0.181970611f, 0.151138216f,
+            -0.680874169f, -0.189522475f, 0.335444778f, 0.0282569192f, 0.387233645f, -0.240908027f,
+            0.0880716518f, 0.27026242f, 0.289027661f, 0.0862757266f, 0.218189895f, 0.329120666f,
+            0.244169459f,
+        };
+        return values;
+    }
+
+    // int16 for FixedPBC.h, layer l scaled by 2^shifts()[l] and the gains by the last;
+    // against float64 over 4096 states: max |u error| 7.62e-05, rms 2.54e-05
+    struct fixed {
+        static constexpr int num_shifts = 4;
+        static const int8_t* shifts() {
+            static const int8_t values[num_shifts] = {14, 14, 15, 15};
+            return values;
+        }
+        static const int16_t* params() {
+            static const int16_t values[num_params] = {
+                8834, -15170, 550, -534, -1561, -5708, -5738, 8026, 5060, -10485, 4815, 3404,
+                1389, -4698, -176, 5210, -4609, -2590, -63, -6359, -7643, 3896, 9892, -450,
+                -367, -3929, 3612, -13176, -4567, -4575, 659, 8681, -1463, -7327, 18008, 8574,
+                5941, -5290, 8066, -6205, 7102, -6585, -1512, 6899, -3434, -7176, -10505, 9830,
+                -1565, 5766, 7504, -8297, -5180, 2829, -2664, 4923, 4063, -3849, -6560, 360,
+                6550, 13308, -3553, -5679, 6595, -1714, -8631, -2499, -6619, 4967, -5952, -7602,
+                1990, -3497, 3905, -5109, -7689, -7602, 3511, -3560, -2383, -3104, -1466, -13944,
+                3447, -2333, 6696, 3315, 2177, 532, -724, 4278, 6821, 994, -5280, -199,
+                -6694, -8118, -629, -2530, 2266, -5491, 5457, -17420, 946, -853, -3092, -298,
+                10658, 3523, 8563, -9753, 8236, -973, -883, 4711, 3580, -4364, -2981, 4952,
+                -22311, -6210, 10992, 926, 12689, -7894, 2886, 8856, 9471, 2827, 7150, 10785,
+                8001,
+            };
+            return values;
+        }
+    };
+
+    // straight-line pass for SparsePBC.h, weights below 0 pruned: 111 of 111 kept;
+    // against the dense network over 4096 states: max |u error| 0.00e+00, rms 0.00e+00
+    struct sparse {
+        static constexpr int num_weights = 111;
+        static constexpr int num_kept = 111;
+
+        // Hd(x) and into dh its derivative along the gains, as Chain::tangent()
+        template<class Elu = pbc::ExactElu>
+        static inline float tangent(const float* x, float* dh) {
+            float y0_0 = -0.0955272391f + 0.539166272f*x[0] + 0.308859378f*x[1] - 0.281318069f*x[2] - 0.0224301778f*x[3] - 0.0892707929f*x[4] + 0.433446795f*x[5];
+            float dy0_0 = 0.282273918f;
+            if (y0_0 <= 0.0f) {
+                y0_0 = Elu::expm1(y0_0);
+                dy0_0 *= y0_0 + 1.0f;
+            }
+            float y0_1 = 0.351928055f - 0.925893426f*x[0] - 0.639934063f*x[1] - 0.158090264f*x[2] - 0.239806414f*x[3] - 0.447197795f*x[4] - 0.401895344f*x[5];
+            float dy0_1 = -0.746468127f;
+            if (y0_1 <= 0.0f) {
+                y0_1 = Elu::expm1(y0_1);
+                dy0_1 *= y0_1 + 1.0f;
+            }
+            float y0_2 = 0.457977891f + 0.0335611776f*x[0] + 0.293907762f*x[1] - 0.00382199488f*x[2] + 0.220434189f*x[3] + 1.09909415f*x[4] - 0.0922730267f*x[5];
+            float dy0_2 = 0.48098892f;
+            if (y0_2 <= 0.0f) {
+                y0_2 = Elu::expm1(y0_2);
+                dy0_2 *= y0_2 + 1.0f;
+            }
+            float y0_3 = -0.50639081f - 0.03257332f*x[0] + 0.207754627f*x[1] - 0.38811627f*x[2] - 0.804217815f*x[3] + 0.523322225f*x[4] + 0.421090901f*x[5];
+            float dy0_3 = 0.117339969f;
+            if (y0_3 <= 0.0f) {
+                y0_3 = Elu::expm1(y0_3);
+                dy0_3 *= y0_3 + 1.0f;
+            }
+            float y0_4 = -0.316139072f - 0.0952505246f*x[0] + 0.08480189f*x[1] - 0.466497749f*x[2] - 0.278744698f*x[3] + 0.362608463f*x[4] - 0.209574044f*x[5];
+            float dy0_4 = -0.0341288969f;
+            if (y0_4 <= 0.0f) {
+                y0_4 = Elu::expm1(y0_4);
+                dy0_4 *= y0_4 + 1.0f;
+            }
+            float y0_5 = 0.172662437f - 0.348358154f*x[0] - 0.286747426f*x[1] + 0.237810418f*x[2] - 0.279227078f*x[3] - 0.322878808f*x[4] - 0.438004106f*x[5];
+            float dy0_5 = -0.430646628f;
+            if (y0_5 <= 0.0f) {
+                y0_5 = Elu::expm1(y0_5);
+                dy0_5 *= y0_5 + 1.0f;
+            }
+            float y0_6 = -0.162621379f - 0.350212097f*x[0] - 0.0107369116f*x[1] + 0.603761435f*x[2] + 0.0402294062f*x[3] + 0.49230817f*x[4] - 0.641183019f*x[5];
+            float dy0_6 = -0.0314133465f;
+            if (y0_6 <= 0.0f) {
+                y0_6 = Elu::expm1(y0_6);
+                dy0_6 *= y0_6 + 1.0f;
+            }
+            float y0_7 = 0.300450385f + 0.48987025f*x[0] + 0.31798318f*x[1] - 0.0274680462f*x[2] + 0.529843986f*x[3] - 0.378747255f*x[4] + 0.599974036f*x[5];
+            float dy0_7 = 0.35937801f;
+            if (y0_7 <= 0.0f) {
+                y0_7 = Elu::expm1(y0_7);
+                dy0_7 *= y0_7 + 1.0f;
+            }
+            float y1_0 = 0.502714276f + 0.247955516f*y0_0 - 0.346616358f*y0_1 - 0.363298863f*y0_2 - 0.463991731f*y0_3 + 0.210365012f*y0_4 + 0.261135489f*y0_5 - 0.0384194031f*y0_6 - 0.0520425811f*y0_7;
+            float dy1_0 = 0.247955516f*dy0_0 - 0.346616358f*dy0_1 - 0.363298863f*dy0_2 - 0.463991731f*dy0_3 + 0.210365012f*dy0_4 + 0.261135489f*dy0_5 - 0.0384194031f*dy0_6 - 0.0520425811f*dy0_7;
+            if (y1_0 <= 0.0f) {
+                y1_0 = Elu::expm1(y1_0);
+                dy1_0 *= y1_0 + 1.0f;
+            }
+            float y1_1 = -0.059378881f - 0.234910041f*y0_0 + 0.40254733f*y0_1 - 0.463965744f*y0_2 + 0.214277685f*y0_3 - 0.142395288f*y0_4 + 0.416294903f*y0_5 - 0.154393539f*y0_6 - 0.188742951f*y0_7;
+            float dy1_1 = -0.234910041f*dy0_0 + 0.40254733f*dy0_1 - 0.463965744f*dy0_2 + 0.214277685f*dy0_3 - 0.142395288f*dy0_4 + 0.416294903f*dy0_5 - 0.154393539f*dy0_6 - 0.188742951f*dy0_7;
+            if (y1_1 <= 0.0f) {
+                y1_1 = Elu::expm1(y1_1);
+                dy1_1 *= y1_1 + 1.0f;
+            }
+            float y1_2 = -0.0538652204f - 0.40039593f*y0_0 - 0.104634292f*y0_1 + 0.121443301f*y0_2 - 0.217274487f*y0_3 + 0.408721328f*y0_4 + 0.0606867783f*y0_5 + 0.138310596f*y0_6 - 0.0182041489f*y0_7;
+            float dy1_2 = -0.40039593f*dy0_0 - 0.104634292f*dy0_1 + 0.121443301f*dy0_2 - 0.217274487f*dy0_3 + 0.408721328f*dy0_4 + 0.0606867783f*dy0_5 + 0.138310596f*dy0_6 - 0.0182041489f*dy0_7;
+            if (y1_2 <= 0.0f) {
+                y1_2 = Elu::expm1(y1_2);
+                dy1_2 *= y1_2 + 1.0f;
+            }
+            float y1_3 = 0.287522554f + 0.0220024828f*y0_0 - 0.526800454f*y0_1 - 0.213449687f*y0_2 - 0.145454928f*y0_3 + 0.202360079f*y0_4 - 0.322264224f*y0_5 - 0.335139036f*y0_6 + 0.650482476f*y0_7;
+            float dy1_3 = 0.0220024828f*dy0_0 - 0.526800454f*dy0_1 - 0.213449687f*dy0_2 - 0.145454928f*dy0_3 + 0.202360079f*dy0_4 - 0.322264224f*dy0_5 - 0.335139036f*dy0_6 + 0.650482476f*dy0_7;
+            if (y1_3 <= 0.0f) {
+                y1_3 = Elu::expm1(y1_3);
+                dy1_3 *= y1_3 + 1.0f;
+            }
+            float y1_4 = 0.218532428f + 0.399801403f*y0_0 - 0.152547076f*y0_1 + 0.23836118f*y0_2 - 0.189433664f*y0_3 + 0.132897228f*y0_4 - 0.0121464003f*y0_5 + 0.333088338f*y0_6 + 0.215037018f*y0_7;
+            float dy1_4 = 0.399801403f*dy0_0 - 0.152547076f*dy0_1 + 0.23836118f*dy0_2 - 0.189433664f*dy0_3 + 0.132897228f*dy0_4 - 0.0121464003f*dy0_5 + 0.333088338f*dy0_6 + 0.215037018f*dy0_7;
+            if (y1_4 <= 0.0f) {
+                y1_4 = Elu::expm1(y1_4);
+                dy1_4 *= y1_4 + 1.0f;
+            }
+            float y1_5 = -0.266357362f + 0.81227529f*y0_0 - 0.403981954f*y0_1 - 0.311854631f*y0_2 - 0.0894473046f*y0_3 + 0.0324954316f*y0_4 - 0.408580065f*y0_5 - 1.06321287f*y0_6 + 0.522661686f*y0_7;
+            float dy1_5 = 0.81227529f*dy0_0 - 0.403981954f*dy0_1 - 0.311854631f*dy0_2 - 0.0894473046f*dy0_3 + 0.0324954316f*dy0_4 - 0.408580065f*dy0_5 - 1.06321287f*dy0_6 + 0.522661686f*dy0_7;
+            if (y1_5 <= 0.0f) {
+                y1_5 = Elu::expm1(y1_5);
+                dy1_5 *= y1_5 + 1.0f;
+            }
+            float y1_6 = -0.181970611f - 0.21688509f*y0_0 + 0.303154469f*y0_1 - 0.469273597f*y0_2 - 0.851050615f*y0_3 - 0.0441814587f*y0_4 - 0.495505661f*y0_5 + 0.0577290654f*y0_6 - 0.595259607f*y0_7;
+            float dy1_6 = -0.21688509f*dy0_0 + 0.303154469f*dy0_1 - 0.469273597f*dy0_2 - 0.851050615f*dy0_3 - 0.0441814587f*dy0_4 - 0.495505661f*dy0_5 + 0.0577290654f*dy0_6 - 0.595259607f*dy0_7;
+            if (y1_6 <= 0.0f) {
+                y1_6 = Elu::expm1(y1_6);
+                dy1_6 *= y1_6 + 1.0f;
+            }
+            *dh = 0.151138216f*dy1_0 - 0.680874169f*dy1_1 - 0.189522475f*dy1_2 + 0.335444778f*dy1_3 + 0.0282569192f*dy1_4 + 0.387233645f*dy1_5 - 0.240908027f*dy1_6;
+            return 0.0880716518f + 0.151138216f*y1_0 - 0.680874169f*y1_1 - 0.189522475f*y1_2 + 0.335444778f*y1_3 + 0.0282569192f*y1_4 + 0.387233645f*y1_5 - 0.240908027f*y1_6;
+        }
+    };
+};
+
+} // namespace pbc_weights
+
+#endif //PbcWeights_deterministic_hardware_h
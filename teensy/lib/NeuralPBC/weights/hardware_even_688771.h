@@ -0,0 +1,176 @@
+// Generated by julia_pkg/src/exportWeights.py from saved_weights/hardware_even_688771elu.bson, do not edit.
+#ifndef PbcWeights_hardware_even_688771_h
+#define PbcWeights_hardware_even_688771_h
+
+#include "NeuralPBC.h"
+
+namespace pbc_weights {
+
+// hardware_even_688771elu.bson
+struct hardware_even_688771 {
+    typedef pbc::Chain<6, 8, 7, 1> chain;
+    static constexpr int num_params = 133;
+    static const float* params() {
+        static const float values[num_params] = {
+            0.674539804f, 0.482310772f, 0.0399251357f, 0.444123834f, -0.520813644f, -0.920473874f,
+            0.642166018f, -0.0902036503f, -0.509473562f, -0.51530385f, 0.048497308f, -0.823441505f,
+            0.394977689f, 0.173070416f, -0.0848932862f, 0.20222716f, 0.0637281463f, -0.471935123f,
+            0.568852961f, 0.111304119f, -0.484752536f, -0.334669381f, 0.00770369545f, 0.0939139128f,
+            0.338041395f, -0.702534854f, 0.524234653f, 0.779751301f, -0.455154717f, -0.553317845f,
+            0.0289022997f, 0.00637799781f, -0.126226828f, -0.584068835f, 0.905413091f, -0.405196667f,
+            0.174783081f, 0.0776707605f, -0.297397584f, -0.114407651f, -0.666844904f, 0.0568836443f,
+            -0.0870609209f, 0.529057622f, -0.596232653f, -0.0374256559f, 0.628490925f, -0.624773324f,
+            -0.844743609f, 0.578965843f, 0.193827286f, 0.89927417f, 0.327451974f, 0.0220902637f,
+            0.532192111f, -0.144444302f, 0.228204757f, -0.184859812f, 0.431515545f, 0.695104301f,
+            -0.0164898727f, 0.0797012523f, -0.308469296f, 0.33496967f, 0.148180425f, 0.378654808f,
+            -0.64711827f, 0.397026777f, 0.49924162f, -1.02929425f, -0.396294773f, -0.450919062f,
+            -0.293548107f, 1.15199339f, -0.291977286f, 0.245233864f, 0.0452762246f, 0.469349235f,
+            0.290352464f, 0.508795083f, 0.010400312f, 0.591780424f, -0.372326523f, -0.887495637f,
+            -0.26179564f, 0.0184284411f, -0.777055085f, -0.53721565f, -0.826868057f, 0.415068567f,
+            0.558597088f, -0.233549625f, -0.434057683f, -0.266009092f, -0.315089047f, -0.159246042f,
+            -0.264743149f, 0.854295671f, 0.622604191f, 0.0692055449f, 0.645883381f, 0.0973357409f,
+            0.743959785f, -0.14482674f, 0.325305998f, -0.715542555f, -0.419403523f, -0.0965235084f,
+            -0.0713818818f, -0.365131795f, 0.0992083848f, 0.314479083f, 0.201187402f, 0.381018996f,
+            -0.327457815f, -0.558115721f, 0.39481917f, -0.100936659f, -0.351806521f, 0.484138876f,
+            0.566531062f, 1.0687753f, -0.468540192f, 1.23524439f, -0.431313306f, 0.493165851f,
+            -0.225900531f, 0.399941713f, -0.286575288f, 0.4048388f, 0.479118526f, 0.265982717f,
+            0.331335306f,
+        };
+        return values;
+    }
+
+    // int16 for FixedPBC.h, layer l scaled by 2^shifts()[l] and the gains by the last;
+    // against float64 over 4096 states: max |u error| 4.01e-04, rms 2.06e-04
+    struct fixed {
+        static constexpr int num_shifts = 4;
+        static const int8_t* shifts() {
+            static const int8_t values[num_shifts] = {15, 14, 14, 15};
+            return values;
+        }
+        static const int16_t* params() {
+            static const int16_t values[num_params] = {
+                22103, 15804, 1308, 14553, -17066, -30162, 21042, -2956, -16694, -16885, 1589, -26983,
+                12943, 5671, -2782, 6627, 2088, -15464, 18640, 3647, -15884, -10966, 252, 3077,
+                11077, -23021, 17178, 25551, -14915, -18131, 947, 209, -4136, -19139, 29669, -13277,
+                5727, 2545, -9745, -3749, -21851, 1864, -2853, 17336, -19537, -1226, 20594, -20473,
+                -27681, 18972, 6351, 29467, 10730, 724, 17439, -4733, 3739, -3029, 7070, 11389,
+                -270, 1306, -5054, 5488, 2428, 6204, -10602, 6505, 8180, -16864, -6493, -7388,
+                -4809, 18874, -4784, 4018, 742, 7690, 4757, 8336, 170, 9696, -6100, -14541,
+                -4289, 302, -12731, -8802, -13547, 6800, 9152, -3826, -7112, -4358, -5162, -2609,
+                -4338, 13997, 10201, 1134, 10582, 1595, 12189, -2373, 5330, -11723, -6872, -1581,
+                -1170, -5982, 1625, 5152, 3296, 6243, -5365, -9144, 6469, -1654, -5764, 7932,
+                9282, 17511, -7677, 20238, -7067, 8080, -3701, 13105, -9390, 13266, 15700, 8716,
+                10857,
+            };
+            return values;
+        }
+    };
+
+    // straight-line pass for SparsePBC.h, weights below 0 pruned: 111 of 111 kept;
+    // against the dense network over 4096 states: max |u error| 0.00e+00, rms 0.00e+00
+    struct sparse {
+        static constexpr int num_weights = 111;
+        static constexpr int num_kept = 111;
+
+        // Hd(x) and into dh its derivative along the gains, as Chain::tangent()
+        template<class Elu = pbc::ExactElu>
+        static inline float tangent(const float* x, float* dh) {
+            float y0_0 = -0.844743609f + 0.674539804f*x[0] - 0.509473562f*x[1] + 0.0637281463f*x[2] + 0.338041395f*x[3] - 0.126226828f*x[4] - 0.666844904f*x[5];
+            float dy0_0 = 0.349017233f;
+            if (y0_0 <= 0.0f) {
+                y0_0 = Elu::expm1(y0_0);
+                dy0_0 *= y0_0 + 1.0f;
+            }
+            float y0_1 = 0.578965843f + 0.482310772f*x[0] - 0.51530385f*x[1] - 0.471935123f*x[2] - 0.702534854f*x[3] - 0.584068835f*x[4] + 0.0568836443f*x[5];
+            float dy0_1 = -0.323590219f;
+            if (y0_1 <= 0.0f) {
+                y0_1 = Elu::expm1(y0_1);
+                dy0_1 *= y0_1 + 1.0f;
+            }
+            float y0_2 = 0.193827286f + 0.0399251357f*x[0] + 0.048497308f*x[1] + 0.568852961f*x[2] + 0.524234653f*x[3] + 0.905413091f*x[4] - 0.0870609209f*x[5];
+            float dy0_2 = 0.695511758f;
+            if (y0_2 <= 0.0f) {
+                y0_2 = Elu::expm1(y0_2);
+                dy0_2 *= y0_2 + 1.0f;
+            }
+            float y0_3 = 0.89927417f + 0.444123834f*x[0] - 0.823441505f*x[1] + 0.111304119f*x[2] + 0.779751301f*x[3] - 0.405196667f*x[4] + 0.529057622f*x[5];
+            float dy0_3 = 0.899775326f;
+            if (y0_3 <= 0.0f) {
+                y0_3 = Elu::expm1(y0_3);
+                dy0_3 *= y0_3 + 1.0f;
+            }
+            float y0_4 = 0.327451974f - 0.520813644f*x[0] + 0.394977689f*x[1] - 0.484752536f*x[2] - 0.455154717f*x[3] + 0.174783081f*x[4] - 0.596232653f*x[5];
+            float dy0_4 = -0.886869311f;
+            if (y0_4 <= 0.0f) {
+                y0_4 = Elu::expm1(y0_4);
+                dy0_4 *= y0_4 + 1.0f;
+            }
+            float y0_5 = 0.0220902637f - 0.920473874f*x[0] + 0.173070416f*x[1] - 0.334669381f*x[2] - 0.553317845f*x[3] + 0.0776707605f*x[4] - 0.0374256559f*x[5];
+            float dy0_5 = -0.810066938f;
+            if (y0_5 <= 0.0f) {
+                y0_5 = Elu::expm1(y0_5);
+                dy0_5 *= y0_5 + 1.0f;
+            }
+            float y0_6 = 0.532192111f + 0.642166018f*x[0] - 0.0848932862f*x[1] + 0.00770369545f*x[2] + 0.0289022997f*x[3] - 0.297397584f*x[4] + 0.628490925f*x[5];
+            float dy0_6 = 0.427262306f;
+            if (y0_6 <= 0.0f) {
+                y0_6 = Elu::expm1(y0_6);
+                dy0_6 *= y0_6 + 1.0f;
+            }
+            float y0_7 = -0.144444302f - 0.0902036503f*x[0] + 0.20222716f*x[1] + 0.0939139128f*x[2] + 0.00637799781f*x[3] - 0.114407651f*x[4] - 0.624773324f*x[5];
+            float dy0_7 = -0.290393621f;
+            if (y0_7 <= 0.0f) {
+                y0_7 = Elu::expm1(y0_7);
+                dy0_7 *= y0_7 + 1.0f;
+            }
+            float y1_0 = 0.201187402f + 0.228204757f*y0_0 + 0.33496967f*y0_1 - 0.396294773f*y0_2 + 0.469349235f*y0_3 - 0.26179564f*y0_4 - 0.233549625f*y0_5 + 0.622604191f*y0_6 - 0.715542555f*y0_7;
+            float dy1_0 = 0.228204757f*dy0_0 + 0.33496967f*dy0_1 - 0.396294773f*dy0_2 + 0.469349235f*dy0_3 - 0.26179564f*dy0_4 - 0.233549625f*dy0_5 + 0.622604191f*dy0_6 - 0.715542555f*dy0_7;
+            if (y1_0 <= 0.0f) {
+                y1_0 = Elu::expm1(y1_0);
+                dy1_0 *= y1_0 + 1.0f;
+            }
+            float y1_1 = 0.381018996f - 0.184859812f*y0_0 + 0.148180425f*y0_1 - 0.450919062f*y0_2 + 0.290352464f*y0_3 + 0.0184284411f*y0_4 - 0.434057683f*y0_5 + 0.0692055449f*y0_6 - 0.419403523f*y0_7;
+            float dy1_1 = -0.184859812f*dy0_0 + 0.148180425f*dy0_1 - 0.450919062f*dy0_2 + 0.290352464f*dy0_3 + 0.0184284411f*dy0_4 - 0.434057683f*dy0_5 + 0.0692055449f*dy0_6 - 0.419403523f*dy0_7;
+            if (y1_1 <= 0.0f) {
+                y1_1 = Elu::expm1(y1_1);
+                dy1_1 *= y1_1 + 1.0f;
+            }
+            float y1_2 = -0.327457815f + 0.431515545f*y0_0 + 0.378654808f*y0_1 - 0.293548107f*y0_2 + 0.508795083f*y0_3 - 0.777055085f*y0_4 - 0.266009092f*y0_5 + 0.645883381f*y0_6 - 0.0965235084f*y0_7;
+            float dy1_2 = 0.431515545f*dy0_0 + 0.378654808f*dy0_1 - 0.293548107f*dy0_2 + 0.508795083f*dy0_3 - 0.777055085f*dy0_4 - 0.266009092f*dy0_5 + 0.645883381f*dy0_6 - 0.0965235084f*dy0_7;
+            if (y1_2 <= 0.0f) {
+                y1_2 = Elu::expm1(y1_2);
+                dy1_2 *= y1_2 + 1.0f;
+            }
+            float y1_3 = -0.558115721f + 0.695104301f*y0_0 - 0.64711827f*y0_1 + 1.15199339f*y0_2 + 0.010400312f*y0_3 - 0.53721565f*y0_4 - 0.315089047f*y0_5 + 0.0973357409f*y0_6 - 0.0713818818f*y0_7;
+            float dy1_3 = 0.695104301f*dy0_0 - 0.64711827f*dy0_1 + 1.15199339f*dy0_2 + 0.010400312f*dy0_3 - 0.53721565f*dy0_4 - 0.315089047f*dy0_5 + 0.0973357409f*dy0_6 - 0.0713818818f*dy0_7;
+            if (y1_3 <= 0.0f) {
+                y1_3 = Elu::expm1(y1_3);
+                dy1_3 *= y1_3 + 1.0f;
+            }
+            float y1_4 = 0.39481917f - 0.0164898727f*y0_0 + 0.397026777f*y0_1 - 0.291977286f*y0_2 + 0.591780424f*y0_3 - 0.826868057f*y0_4 - 0.159246042f*y0_5 + 0.743959785f*y0_6 - 0.365131795f*y0_7;
+            float dy1_4 = -0.0164898727f*dy0_0 + 0.397026777f*dy0_1 - 0.291977286f*dy0_2 + 0.591780424f*dy0_3 - 0.826868057f*dy0_4 - 0.159246042f*dy0_5 + 0.743959785f*dy0_6 - 0.365131795f*dy0_7;
+            if (y1_4 <= 0.0f) {
+                y1_4 = Elu::expm1(y1_4);
+                dy1_4 *= y1_4 + 1.0f;
+            }
+            float y1_5 = -0.100936659f + 0.0797012523f*y0_0 + 0.49924162f*y0_1 + 0.245233864f*y0_2 - 0.372326523f*y0_3 + 0.415068567f*y0_4 - 0.264743149f*y0_5 - 0.14482674f*y0_6 + 0.0992083848f*y0_7;
+            float dy1_5 = 0.0797012523f*dy0_0 + 0.49924162f*dy0_1 + 0.245233864f*dy0_2 - 0.372326523f*dy0_3 + 0.415068567f*dy0_4 - 0.264743149f*dy0_5 - 0.14482674f*dy0_6 + 0.0992083848f*dy0_7;
+            if (y1_5 <= 0.0f) {
+                y1_5 = Elu::expm1(y1_5);
+                dy1_5 *= y1_5 + 1.0f;
+            }
+            float y1_6 = -0.351806521f - 0.308469296f*y0_0 - 1.02929425f*y0_1 + 0.0452762246f*y0_2 - 0.887495637f*y0_3 + 0.558597088f*y0_4 + 0.854295671f*y0_5 + 0.325305998f*y0_6 + 0.314479083f*y0_7;
+            float dy1_6 = -0.308469296f*dy0_0 - 1.02929425f*dy0_1 + 0.0452762246f*dy0_2 - 0.887495637f*dy0_3 + 0.558597088f*dy0_4 + 0.854295671f*dy0_5 + 0.325305998f*dy0_6 + 0.314479083f*dy0_7;
+            if (y1_6 <= 0.0f) {
+                y1_6 = Elu::expm1(y1_6);
+                dy1_6 *= y1_6 + 1.0f;
+            }
+            *dh = 0.484138876f*dy1_0 + 0.566531062f*dy1_1 + 1.0687753f*dy1_2 - 0.468540192f*dy1_3 + 1.23524439f*dy1_4 - 0.431313306f*dy1_5 + 0.493165851f*dy1_6;
+            return -0.225900531f + 0.484138876f*y1_0 + 0.566531062f*y1_1 + 1.0687753f*y1_2 - 0.468540192f*y1_3 + 1.23524439f*y1_4 - 0.431313306f*y1_5 + 0.493165851f*y1_6;
+        }
+    };
+};
+
+} // namespace pbc_weights
+
+#endif //PbcWeights_hardware_even_688771_h
@@ -0,0 +1,176 @@
+// Generated by julia_pkg/src/exportWeights.py from saved_weights/hardware_even_deter_1mpers_6-8-8-7-7-1_elu.bson, do not edit.
+#ifndef PbcWeights_hardware_even_deter_1mpers_h
+#define PbcWeights_hardware_even_deter_1mpers_h
+
+#include "NeuralPBC.h"
+
+namespace pbc_weights {
+
+// hardware_even_deter_1mpers_6-8-8-7-7-1_elu.bson
+struct hardware_even_deter_1mpers {
+    typedef pbc::Chain<6, 8, 7, 1> chain;
+    static constexpr int num_params = 133;
+    static const float* params() {
+        static const float values[num_params] = {
+            -1.03760612f, 0.684136748f, 1.18531299f, -0.0717146173f, -0.558188975f, -0.437459409f,
+            0.268402398f, -0.775428236f, -1.06482637f, 0.775028467f, 0.35612011f, -0.75298667f,
+            0.620256543f, 0.866580069f, -1.48105955f, 0.864896834f, 0.139529258f, 0.686294436f,
+            0.22334449f, -0.196527123f, 0.305951536f, 1.16619253f, -0.433144033f, 0.182485938f,
+            0.176102534f, 0.383240998f, -0.486864269f, -0.217770219f, 0.121946149f, -0.556434512f,
+            0.277371466f, 0.106396034f, -0.564489841f, -0.325311124f, 0.133403942f, -0.542858839f,
+            0.0759237036f, 0.3517721f, -0.245418385f, 0.216100737f, -0.855298936f, -0.715995193f,
+            1.35653245f, 0.467130065f, -0.411306292f, -0.352692723f, -0.138575673f, 0.563769579f,
+            -0.497657895f, 0.111719467f, -0.62225318f, 0.412650436f, 0.169587255f, -0.507706225f,
+            -0.0413608588f, -1.1077826f, 0.0876861438f, 0.122626729f, 0.315364182f, 0.676255107f,
+            -0.258027285f, -0.4989447f, 0.861748993f, -0.74903506f, -1.68619919f, -0.531420171f,
+            0.928356826f, 0.324516982f, 0.235480532f, 0.607742429f, -0.000380869198f, -0.657810807f,
+            0.394332319f, 0.248875409f, 0.667936325f, 0.321211666f, 0.454295218f, -0.420619458f,
+            0.0539627299f, 0.510241866f, -0.117534816f, -0.428819239f, 0.00371147529f, 0.198132515f,
+            -0.0375021435f, -0.125335172f, -0.0385113955f, 0.081585452f, -0.193009138f, 0.0790623724f,
+            0.280366927f, 0.0699521899f, -1.30725467f, -0.0805759877f, 0.7376827f, -0.716414273f,
+            -0.0954082161f, 0.795818567f, -0.608513713f, 0.353081495f, 0.872657895f, -0.703721404f,
+            -0.105805442f, -0.295566499f, 0.082785897f, -0.197465211f, -0.398238868f, 0.461498708f,
+            1.26651788f, -0.479511768f, -0.128421009f, 0.695769548f, 0.356724799f, 0.417461634f,
+            -0.0233373921f, -0.130245253f, 0.669956684f, 0.69237411f, -0.220012605f, 0.0658332556f,
+            -0.794813871f, -0.743102193f, -0.600317419f, 0.830011606f, 0.611904144f, -0.729965687f,
+            0.254948169f, 0.474862546f, 0.696493924f, 0.246509358f, -0.442075759f, 0.510072827f,
+            0.579670846f,
+        };
+        return values;
+    }
+
+    // int16 for FixedPBC.h, layer l scaled by 2^shifts()[l] and the gains by the last;
+    // against float64 over 4096 states: max |u error| 4.05e-04, rms 1.14e-04
+    struct fixed {
+        static constexpr int num_shifts = 4;
+        static const int8_t* shifts() {
+            static const int8_t values[num_shifts] = {14, 14, 15, 15};
+            return values;
+        }
+        static const int16_t* params() {
+            static const int16_t values[num_params] = {
+                -17000, 11209, 19420, -1175, -9145, -7167, 4398, -12705, -17446, 12698, 5835, -12337,
+                10162, 14198, -24266, 14170, 2286, 11244, 3659, -3220, 5013, 19107, -7097, 2990,
+                2885, 6279, -7977, -3568, 1998, -9117, 4544, 1743, -9249, -5330, 2186, -8894,
+                1244, 5763, -4021, 3541, -14013, -11731, 22225, 7653, -6739, -5779, -2270, 9237,
+                -8154, 1830, -10195, 6761, 2779, -8318, -678, -18150, 1437, 2009, 5167, 11080,
+                -4228, -8175, 14119, -12272, -27627, -8707, 15210, 5317, 3858, 9957, -6, -10778,
+                6461, 4078, 10943, 5263, 7443, -6891, 884, 8360, -1926, -7026, 61, 3246,
+                -614, -2053, -631, 1337, -3162, 1295, 4594, 1146, -21418, -1320, 12086, -11738,
+                -1563, 13039, -9970, 5785, 14298, -11530, -1734, -4843, 1356, -3235, -6525, 7561,
+                20751, -7856, -2104, 11399, 5845, 6840, -382, -2134, 10977, 11344, -3605, 2157,
+                -26044, -24350, -19671, 27198, 20051, -23920, 8354, 15560, 22823, 8078, -14486, 16714,
+                18995,
+            };
+            return values;
+        }
+    };
+
+    // straight-line pass for SparsePBC.h, weights below 0 pruned: 111 of 111 kept;
+    // against the dense network over 4096 states: max |u error| 0.00e+00, rms 0.00e+00
+    struct sparse {
+        static constexpr int num_weights = 111;
+        static constexpr int num_kept = 111;
+
+        // Hd(x) and into dh its derivative along the gains, as Chain::tangent()
+        template<class Elu = pbc::ExactElu>
+        static inline float tangent(const float* x, float* dh) {
+            float y0_0 = -0.497657895f - 1.03760612f*x[0] - 1.06482637f*x[1] + 0.139529258f*x[2] + 0.176102534f*x[3] - 0.564489841f*x[4] - 0.855298936f*x[5];
+            float dy0_0 = -2.06154346f;
+            if (y0_0 <= 0.0f) {
+                y0_0 = Elu::expm1(y0_0);
+                dy0_0 *= y0_0 + 1.0f;
+            }
+            float y0_1 = 0.111719467f + 0.684136748f*x[0] + 0.775028467f*x[1] + 0.686294436f*x[2] + 0.383240998f*x[3] - 0.325311124f*x[4] - 0.715995193f*x[5];
+            float dy0_1 = 0.283456087f;
+            if (y0_1 <= 0.0f) {
+                y0_1 = Elu::expm1(y0_1);
+                dy0_1 *= y0_1 + 1.0f;
+            }
+            float y0_2 = -0.62225318f + 1.18531299f*x[0] + 0.35612011f*x[1] + 0.22334449f*x[2] - 0.486864269f*x[3] + 0.133403942f*x[4] + 1.35653245f*x[5];
+            float dy0_2 = 1.93557167f;
+            if (y0_2 <= 0.0f) {
+                y0_2 = Elu::expm1(y0_2);
+                dy0_2 *= y0_2 + 1.0f;
+            }
+            float y0_3 = 0.412650436f - 0.0717146173f*x[0] - 0.75298667f*x[1] - 0.196527123f*x[2] - 0.217770219f*x[3] - 0.542858839f*x[4] + 0.467130065f*x[5];
+            float dy0_3 = -0.516795933f;
+            if (y0_3 <= 0.0f) {
+                y0_3 = Elu::expm1(y0_3);
+                dy0_3 *= y0_3 + 1.0f;
+            }
+            float y0_4 = 0.169587255f - 0.558188975f*x[0] + 0.620256543f*x[1] + 0.305951536f*x[2] + 0.121946149f*x[3] + 0.0759237036f*x[4] - 0.411306292f*x[5];
+            float dy0_4 = -0.0112432921f;
+            if (y0_4 <= 0.0f) {
+                y0_4 = Elu::expm1(y0_4);
+                dy0_4 *= y0_4 + 1.0f;
+            }
+            float y0_5 = -0.507706225f - 0.437459409f*x[0] + 0.866580069f*x[1] + 1.16619253f*x[2] - 0.556434512f*x[3] + 0.3517721f*x[4] - 0.352692723f*x[5];
+            float dy0_5 = 0.904281974f;
+            if (y0_5 <= 0.0f) {
+                y0_5 = Elu::expm1(y0_5);
+                dy0_5 *= y0_5 + 1.0f;
+            }
+            float y0_6 = -0.0413608588f + 0.268402398f*x[0] - 1.48105955f*x[1] - 0.433144033f*x[2] + 0.277371466f*x[3] - 0.245418385f*x[4] - 0.138575673f*x[5];
+            float dy0_6 = -1.33899748f;
+            if (y0_6 <= 0.0f) {
+                y0_6 = Elu::expm1(y0_6);
+                dy0_6 *= y0_6 + 1.0f;
+            }
+            float y0_7 = -1.1077826f - 0.775428236f*x[0] + 0.864896834f*x[1] + 0.182485938f*x[2] + 0.106396034f*x[3] + 0.216100737f*x[4] + 0.563769579f*x[5];
+            float dy0_7 = 0.669150829f;
+            if (y0_7 <= 0.0f) {
+                y0_7 = Elu::expm1(y0_7);
+                dy0_7 *= y0_7 + 1.0f;
+            }
+            float y1_0 = 0.356724799f + 0.0876861438f*y0_0 - 0.74903506f*y0_1 - 0.000380869198f*y0_2 - 0.420619458f*y0_3 - 0.0375021435f*y0_4 + 0.0699521899f*y0_5 - 0.608513713f*y0_6 - 0.197465211f*y0_7;
+            float dy1_0 = 0.0876861438f*dy0_0 - 0.74903506f*dy0_1 - 0.000380869198f*dy0_2 - 0.420619458f*dy0_3 - 0.0375021435f*dy0_4 + 0.0699521899f*dy0_5 - 0.608513713f*dy0_6 - 0.197465211f*dy0_7;
+            if (y1_0 <= 0.0f) {
+                y1_0 = Elu::expm1(y1_0);
+                dy1_0 *= y1_0 + 1.0f;
+            }
+            float y1_1 = 0.417461634f + 0.122626729f*y0_0 - 1.68619919f*y0_1 - 0.657810807f*y0_2 + 0.0539627299f*y0_3 - 0.125335172f*y0_4 - 1.30725467f*y0_5 + 0.353081495f*y0_6 - 0.398238868f*y0_7;
+            float dy1_1 = 0.122626729f*dy0_0 - 1.68619919f*dy0_1 - 0.657810807f*dy0_2 + 0.0539627299f*dy0_3 - 0.125335172f*dy0_4 - 1.30725467f*dy0_5 + 0.353081495f*dy0_6 - 0.398238868f*dy0_7;
+            if (y1_1 <= 0.0f) {
+                y1_1 = Elu::expm1(y1_1);
+                dy1_1 *= y1_1 + 1.0f;
+            }
+            float y1_2 = -0.0233373921f + 0.315364182f*y0_0 - 0.531420171f*y0_1 + 0.394332319f*y0_2 + 0.510241866f*y0_3 - 0.0385113955f*y0_4 - 0.0805759877f*y0_5 + 0.872657895f*y0_6 + 0.461498708f*y0_7;
+            float dy1_2 = 0.315364182f*dy0_0 - 0.531420171f*dy0_1 + 0.394332319f*dy0_2 + 0.510241866f*dy0_3 - 0.0385113955f*dy0_4 - 0.0805759877f*dy0_5 + 0.872657895f*dy0_6 + 0.461498708f*dy0_7;
+            if (y1_2 <= 0.0f) {
+                y1_2 = Elu::expm1(y1_2);
+                dy1_2 *= y1_2 + 1.0f;
+            }
+            float y1_3 = -0.130245253f + 0.676255107f*y0_0 + 0.928356826f*y0_1 + 0.248875409f*y0_2 - 0.117534816f*y0_3 + 0.081585452f*y0_4 + 0.7376827f*y0_5 - 0.703721404f*y0_6 + 1.26651788f*y0_7;
+            float dy1_3 = 0.676255107f*dy0_0 + 0.928356826f*dy0_1 + 0.248875409f*dy0_2 - 0.117534816f*dy0_3 + 0.081585452f*dy0_4 + 0.7376827f*dy0_5 - 0.703721404f*dy0_6 + 1.26651788f*dy0_7;
+            if (y1_3 <= 0.0f) {
+                y1_3 = Elu::expm1(y1_3);
+                dy1_3 *= y1_3 + 1.0f;
+            }
+            float y1_4 = 0.669956684f - 0.258027285f*y0_0 + 0.324516982f*y0_1 + 0.667936325f*y0_2 - 0.428819239f*y0_3 - 0.193009138f*y0_4 - 0.716414273f*y0_5 - 0.105805442f*y0_6 - 0.479511768f*y0_7;
+            float dy1_4 = -0.258027285f*dy0_0 + 0.324516982f*dy0_1 + 0.667936325f*dy0_2 - 0.428819239f*dy0_3 - 0.193009138f*dy0_4 - 0.716414273f*dy0_5 - 0.105805442f*dy0_6 - 0.479511768f*dy0_7;
+            if (y1_4 <= 0.0f) {
+                y1_4 = Elu::expm1(y1_4);
+                dy1_4 *= y1_4 + 1.0f;
+            }
+            float y1_5 = 0.69237411f - 0.4989447f*y0_0 + 0.235480532f*y0_1 + 0.321211666f*y0_2 + 0.00371147529f*y0_3 + 0.0790623724f*y0_4 - 0.0954082161f*y0_5 - 0.295566499f*y0_6 - 0.128421009f*y0_7;
+            float dy1_5 = -0.4989447f*dy0_0 + 0.235480532f*dy0_1 + 0.321211666f*dy0_2 + 0.00371147529f*dy0_3 + 0.0790623724f*dy0_4 - 0.0954082161f*dy0_5 - 0.295566499f*dy0_6 - 0.128421009f*dy0_7;
+            if (y1_5 <= 0.0f) {
+                y1_5 = Elu::expm1(y1_5);
+                dy1_5 *= y1_5 + 1.0f;
+            }
+            float y1_6 = -0.220012605f + 0.861748993f*y0_0 + 0.607742429f*y0_1 + 0.454295218f*y0_2 + 0.198132515f*y0_3 + 0.280366927f*y0_4 + 0.795818567f*y0_5 + 0.082785897f*y0_6 + 0.695769548f*y0_7;
+            float dy1_6 = 0.861748993f*dy0_0 + 0.607742429f*dy0_1 + 0.454295218f*dy0_2 + 0.198132515f*dy0_3 + 0.280366927f*dy0_4 + 0.795818567f*dy0_5 + 0.082785897f*dy0_6 + 0.695769548f*dy0_7;
+            if (y1_6 <= 0.0f) {
+                y1_6 = Elu::expm1(y1_6);
+                dy1_6 *= y1_6 + 1.0f;
+            }
+            *dh = 0.0658332556f*dy1_0 - 0.794813871f*dy1_1 - 0.743102193f*dy1_2 - 0.600317419f*dy1_3 + 0.830011606f*dy1_4 + 0.611904144f*dy1_5 - 0.729965687f*dy1_6;
+            return 0.254948169f + 0.0658332556f*y1_0 - 0.794813871f*y1_1 - 0.743102193f*y1_2 - 0.600317419f*y1_3 + 0.830011606f*y1_4 + 0.611904144f*y1_5 - 0.729965687f*y1_6;
+        }
+    };
+};
+
+} // namespace pbc_weights
+
+#endif //PbcWeights_hardware_even_deter_1mpers_h
@@ -0,0 +1,437 @@
+// Generated by julia_pkg/src/exportWeights.py from saved_weights/RW_bayesian_6-8-8-5-5-1_elu.bson, do not edit.
+#ifndef PbcWeights_rw_bayesian_h
+#define PbcWeights_rw_bayesian_h
+
+#include "NeuralPBC.h"
+
+namespace pbc_weights {
+
+// RW_bayesian_6-8-8-5-5-1_elu.bson, bayesianPBC.jl
+struct rw_bayesian {
+    typedef pbc::Chain<6, 8, 7, 1> chain;
+    static constexpr int num_params = 133;
+    static constexpr int num_samples = 10;
+
+    // the mean doubles as the network of map() in bayesianPBC.jl
+    static const float* params() { return mean(); }
+    static const float* mean() {
+        static const float values[num_params] = {
+            -0.5857898f, -0.2989963f, 0.394273639f, 0.526435852f, -0.995625854f, -0.0119393608f,
+            0.0213918183f, 0.149163321f, 1.7257483f, -1.09280372f, 0.203467712f, 0.31987232f,
+            0.476873726f, 1.83996558f, 1.23914897f, 0.782284856f, 0.0372416526f, 0.139827147f,
+            -0.156880006f, 0.29360503f, -0.0833433643f, 0.0281241126f, -0.120622419f, 0.462435693f,
+            -0.0889084712f, -0.226454332f, -0.244307801f, 0.255945772f, -0.82925421f, 0.179605886f,
+            0.24461329f, -0.148141742f, 0.258464992f, 0.42763859f, -2.07105374f, -1.04585755f,
+            0.557237506f, 0.0676455572f, 0.355339587f, -0.710294247f, 0.329413295f, -0.775718212f,
+            0.351598412f, 0.337005317f, 0.127751246f, 0.0885076001f, 0.37350741f, -0.39187485f,
+            0.707620323f, 0.172146127f, -0.359869808f, -0.351251394f, -0.0895425305f, -0.130369693f,
+            -0.588462412f, -0.155907184f, -0.48668465f, 0.098526597f, -0.0300272424f, 0.0662980005f,
+            -1.00874484f, -0.228562325f, -0.457749635f, -0.578828573f, 0.669073939f, 0.198102415f,
+            0.0954650715f, 0.784173548f, 0.289001256f, 0.43947652f, 1.5162946f, 0.768529654f,
+            0.0153791178f, 0.759068906f, -0.0955815017f, 0.396046221f, -0.506388187f, 0.912403524f,
+            0.0397213586f, 0.613012612f, 0.749202311f, -0.260833681f, -0.504312754f, -0.318688989f,
+            -0.181107849f, 0.460999399f, 0.86940968f, 0.280159295f, -0.358981192f, -0.0645752475f,
+            0.0900178328f, -0.118717961f, -0.063016139f, -0.289152324f, -0.203807324f, -1.26651132f,
+            -2.0175283f, -0.332332462f, -0.399462491f, -0.234450668f, -0.60794127f, -0.168480664f,
+            -0.817258596f, -0.725300848f, -0.295327246f, 0.186424762f, 1.04905748f, 0.547232509f,
+            0.486288935f, -0.684153855f, -0.55242008f, -0.300052553f, -0.702596545f, -0.151017383f,
+            0.353722513f, 0.32075122f, 0.189830065f, -0.0290324558f, -0.0789784417f, 1.25588274f,
+            0.991296351f, 0.809665799f, 0.364306688f, -1.19268537f, -0.823622167f, 0.450557649f,
+            0.425284117f, 0.673151076f, 0.933258116f, -0.0459144227f, 0.68115747f, -0.146749303f,
+            1.0268451f,
+        };
+        return values;
+    }
+    // softplus(sigma)
+    static const float* stddev() {
+        static const float values[num_params] = {
+            0.0349293165f, 0.0487631373f, 0.0261508301f, 0.0350743346f, 0.0629860684f, 0.0130593255f,
+            0.0155794285f, 0.0581717081f, 0.019302547f, 0.0404851437f, 0.029616883f, 0.0521363132f,
+            0.0203267578f, 0.0370630398f, 0.0465498567f, 0.0443183482f, 0.0450053215f, 0.0478728823f,
+            0.0424149968f, 0.0398119763f, 0.0221681502f, 0.0239234157f, 0.0628710464f, 0.0443187729f,
+            0.0694406331f, 0.0343885608f, 0.0346896723f, 0.0371278189f, 0.0495467782f, 0.0328248776f,
+            0.0550639704f, 0.0448925421f, 0.0237042513f, 0.0459220521f, 0.0410537682f, 0.0585896559f,
+            0.0258875247f, 0.0205229744f, 0.0232504942f, 0.0411763713f, 0.0091219712f, 0.0292589162f,
+            0.0302490797f, 0.0487591662f, 0.0242237858f, 0.00279214815f, 0.0278801154f, 0.0167453997f,
+            0.032009311f, 0.0228461716f, 0.0179893728f, 0.0479783826f, 0.0511044264f, 0.036848262f,
+            0.0344565623f, 0.0517562777f, 0.00862997398f, 0.0488307104f, 0.0290836617f, 0.0465797186f,
+            0.0398117378f, 0.0158570018f, 0.00796841085f, 0.0650000945f, 0.00637379568f, 0.0499099344f,
+            0.0700352415f, 0.027066268f, 0.0344082899f, 0.0701881424f, 0.0749712437f, 0.0552105047f,
+            0.0301253013f, 0.0118451286f, 0.0445111319f, 0.0335349217f, 0.00394542376f, 0.0129025932f,
+            0.00331098307f, 0.0183473639f, 0.0610977858f, 0.0211584009f, 0.0419996306f, 0.0344299488f,
+            0.0361190587f, 0.0438326448f, 0.070841983f, 0.0636340454f, 0.0176683124f, 0.0696148127f,
+            0.0389556736f, 0.0398230068f, 0.0384501964f, 0.0364085883f, 0.0622332804f, 0.0480704084f,
+            0.0342112929f, 0.0285712834f, 0.0320601463f, 0.0543471463f, 0.0425265953f, 0.0789397359f,
+            0.0179747976f, 0.0272595398f, 0.00388596999f, 0.0453528687f, 0.0530484319f, 0.00796575099f,
+            0.000961127167f, 0.0280691981f, 0.0363444798f, 0.0854570791f, 0.0220527351f, 0.00139324798f,
+            0.0561394319f, 0.0717679858f, 0.0399587862f, 0.0466509201f, 0.075837031f, 0.04959815f,
+            0.0589824989f, 0.0518777817f, 0.0527006835f, 0.0240759179f, 0.0347768962f, 0.0435827039f,
+            0.149174958f, 0.0130976336f, 0.0227243844f, 0.0196054783f, 0.00289698294f, 0.00699055055f,
+            0.0384458639f,
+        };
+        return values;
+    }
+    // mean + stddev .* randn, seed 0; samples()[k*num_samples + s] is parameter k of sample s
+    static const float* samples() {
+        static const float values[num_params*num_samples] = {
+            -0.552896321f, -0.580542445f, -0.565833449f, -0.621015191f, -0.603589237f, -0.573343098f,
+            -0.616710126f, -0.639068067f, -0.514731884f, -0.571808875f, -0.367097825f, -0.268598557f,
+            -0.297437251f, -0.277781785f, -0.312830329f, -0.199904606f, -0.366658717f, -0.187454f,
+            -0.350677878f, -0.317012668f, 0.37649855f, 0.40635398f, 0.371167481f, 0.357749552f,
+            0.444790423f, 0.394168496f, 0.342740446f, 0.404623449f, 0.353129983f, 0.407435149f,
+            0.539431036f, 0.535660267f, 0.580054939f, 0.54866612f, 0.475680739f, 0.508862197f,
+            0.519778252f, 0.54124105f, 0.464041471f, 0.488350034f, -1.05964172f, -0.906261384f,
+            -1.0068804f, -0.995565474f, -0.977232575f, -1.09210479f, -0.930231631f, -0.989451706f,
+            -0.997822106f, -1.05670202f, -0.0128811998f, -0.0167923216f, -0.0235748105f, -0.0219380781f,
+            -0.0226607453f, -0.00875810161f, 0.00108371652f, -0.0139203602f, 0.0150442617f, 0.00242838683f,
+            0.0241835974f, 0.0293294452f, 0.0181077793f, 0.0208775289f, 0.0225669127f, 0.0471153408f,
+            0.0401520617f, 0.0299807601f, 0.0245330948f, 0.0228651091f, 0.100816861f, 0.132678226f,
+            0.137570083f, 0.254827708f, 0.246610045f, 0.142680913f, 0.213503942f, 0.153906509f,
+            0.0702346116f, 0.0380188115f, 1.70048058f, 1.72562325f, 1.75391996f, 1.7410835f,
+            1.72060978f, 1.73460376f, 1.70745802f, 1.74378228f, 1.72976983f, 1.71271813f,
+            -1.08495414f, -0.995584667f, -0.994505882f, -1.06060386f, -1.05195892f, -1.12796092f,
+            -1.04577684f, -1.09655547f, -1.08740401f, -1.10937977f, 0.232884675f, 0.255771428f,
+            0.196171001f, 0.194642246f, 0.218580231f, 0.209917367f, 0.190922752f, 0.173426926f,
+            0.225908577f, 0.203770161f, 0.286141098f, 0.335243881f, 0.370518863f, 0.240263656f,
+            0.32782948f, 0.346682042f, 0.246476948f, 0.312324435f, 0.322599381f, 0.418223411f,
+            0.470091343f, 0.495067447f, 0.46071288f, 0.497101992f, 0.484993219f, 0.495402694f,
+            0.483696103f, 0.500358164f, 0.47843197f, 0.489793539f, 1.90095913f, 1.83180308f,
+            1.8307004f, 1.88900852f, 1.84188783f, 1.8716054f, 1.90883255f, 1.81499863f,
+            1.80343115f, 1.85851693f, 1.21313274f, 1.15087771f, 1.20501316f, 1.26455367f,
+            1.28270173f, 1.20919549f, 1.24263299f, 1.26424098f, 1.24953783f, 1.1500982f,
+            0.759498298f, 0.805823624f, 0.786792636f, 0.807687044f, 0.80282855f, 0.716448843f,
+            0.835736811f, 0.827735186f, 0.72095108f, 0.7773633f, 0.145439819f, 0.0238020644f,
+            0.0642673597f, 0.0638011023f, -0.0329897217f, 0.0602294691f, 0.0222722851f, 0.00394761935f,
+            -0.0339132734f, 0.102085263f, 0.0665298104f, 0.0815295428f, 0.148820862f, 0.147617564f,
+            0.115149662f, 0.114932805f, 0.1087474f, 0.221423075f, 0.203035757f, 0.213716403f,
+            -0.123097911f, -0.254640877f, -0.172971785f, -0.16944623f, -0.129056558f, -0.160254404f,
+            -0.180990398f, -0.167248815f, -0.110793889f, -0.111956738f, 0.213835821f, 0.349459738f,
+            0.291402072f, 0.333968133f, 0.3261123f, 0.330090046f, 0.269952923f, 0.265538752f,
+            0.304254353f, 0.243853748f, -0.0965769216f, -0.0714680478f, -0.0995780826f, -0.0781809539f,
+            -0.0894188657f, -0.0961659029f, -0.0641958043f, -0.0907572657f, -0.0777910352f, -0.0355551913f,
+            0.0640973002f, 0.0404824242f, 0.0403277762f, -0.0195419043f, 0.0204993226f, 0.0339328162f,
+            0.066496931f, 0.0179226566f, 0.0172007792f, 0.0220200047f, -0.0438294299f, -0.168138877f,
+            -0.145359606f, -0.114187114f, -0.177389517f, -0.181121036f, -0.173574567f, -0.184598908f,
+            -0.134399906f, -0.117706493f, 0.42249915f, 0.462177724f, 0.472789496f, 0.448861033f,
+            0.476895988f, 0.477830291f, 0.449492484f, 0.45437637f, 0.424123228f, 0.514684796f,
+            -0.120413594f, 0.00468370784f, -0.0228060521f, -0.190612376f, -0.0661577955f, -0.153544739f,
+            -0.102414332f, -0.158391386f, -0.0111423312f, -0.14154619f, -0.223695233f, -0.246387601f,
+            -0.247618273f, -0.167745337f, -0.23019886f, -0.222217977f, -0.230434328f, -0.233482987f,
+            -0.220527902f, -0.228628695f, -0.287950993f, -0.236682832f, -0.193049818f, -0.1612968f,
+            -0.274577171f, -0.221782997f, -0.220450193f, -0.244129792f, -0.254324824f, -0.235064551f,
+            0.276448488f, 0.218416035f, 0.170509264f, 0.212627947f, 0.276899874f, 0.301828891f,
+            0.283076614f, 0.255327523f, 0.254475385f, 0.240447924f, -0.718884945f, -0.820229411f,
+            -0.860662758f, -0.793146908f, -0.835208833f, -0.85348171f, -0.770718873f, -0.842313528f,
+            -0.871162176f, -0.809006155f, 0.135120243f, 0.144108534f, 0.210789368f, 0.171892226f,
+            0.151011363f, 0.210573614f, 0.173652589f, 0.161324888f, 0.167400375f, 0.161948457f,
+            0.135502204f, 0.216996983f, 0.226528659f, 0.25578022f, 0.257693499f, 0.261417836f,
+            0.327722937f, 0.178665131f, 0.280426681f, 0.235341638f, -0.135201752f, -0.164032891f,
+            -0.193129629f, -0.173433363f, -0.11228659f, -0.146250144f, -0.112832926f, -0.142120749f,
+            -0.147317216f, -0.102017805f, 0.255641252f, 0.279107988f, 0.246093035f, 0.260935247f,
+            0.201359749f, 0.268385082f, 0.266499043f, 0.23911491f, 0.281149983f, 0.305978268f,
+            0.510497093f, 0.445908308f, 0.498509884f, 0.489975631f, 0.448103577f, 0.433726758f,
+            0.349886715f, 0.415414631f, 0.464373738f, 0.405838162f, -2.0776372f, -2.09764624f,
+            -1.99841571f, -2.05952549f, -2.06152725f, -2.05808568f, -2.12843919f, -2.09679866f,
+            -1.98028231f, -2.0946486f, -1.04882574f, -1.05446279f, -1.12689638f, -1.06478119f,
+            -1.0910424f, -1.06923938f, -1.08408046f, -1.09839439f, -1.00987518f, -0.986452162f,
+            0.552296281f, 0.555715501f, 0.539668083f, 0.5483374f, 0.520326793f, 0.545052648f,
+            0.566806257f, 0.552919328f, 0.592336237f, 0.532244265f, 0.0473153703f, 0.0666629523f,
+            0.0534086712f, 0.0496049859f, 0.0564449728f, 0.0459593646f, 0.100102365f, 0.121988878f,
+            0.0267360136f, 0.0898530558f, 0.370987862f, 0.334331602f, 0.388101161f, 0.34882018f,
+            0.362491369f, 0.3348113f, 0.371204466f, 0.346953928f, 0.335350424f, 0.346388698f,
+            -0.764815152f, -0.678224862f, -0.719648063f, -0.76328361f, -0.753227592f, -0.724080145f,
+            -0.773929477f, -0.696729362f, -0.628206909f, -0.663027167f, 0.340053976f, 0.33151108f,
+            0.33292675f, 0.339972317f, 0.316875696f, 0.318919957f, 0.322030336f, 0.340810537f,
+            0.344856203f, 0.320515513f, -0.775473118f, -0.771232188f, -0.770771146f, -0.83600986f,
+            -0.746025741f, -0.788584709f, -0.744572163f, -0.812556088f, -0.780616522f, -0.754856348f,
+            0.366832763f, 0.426291108f, 0.35158959f, 0.355394334f, 0.330832064f, 0.412136018f,
+            0.306783557f, 0.421452194f, 0.34452045f, 0.357742459f, 0.310052961f, 0.312936693f,
+            0.319682956f, 0.294873625f, 0.352318108f, 0.304433942f, 0.261051923f, 0.394626796f,
+            0.408798486f, 0.331138194f, 0.105460674f, 0.143734336f, 0.151959077f, 0.110408887f,
+            0.0731935799f, 0.149142832f, 0.163481891f, 0.113057688f, 0.107419536f, 0.142249554f,
+            0.0935342014f, 0.0842212439f, 0.0886453539f, 0.0867990106f, 0.0904013291f, 0.086233668f,
+            0.0918290168f, 0.0877185538f, 0.0869006217f, 0.088655822f, 0.386570632f, 0.425775737f,
+            0.343305439f, 0.35480237f, 0.392919451f, 0.348748922f, 0.34759289f, 0.332085907f,
+            0.370126009f, 0.393411011f, -0.371663094f, -0.40743959f, -0.394051194f, -0.373861909f,
+            -0.377309024f, -0.351762533f, -0.394484192f, -0.414432496f, -0.386353493f, -0.378398418f,
+            0.713609993f, 0.67440331f, 0.665282726f, 0.741761208f, 0.683696926f, 0.686109006f,
+            0.702713013f, 0.764411747f, 0.719730198f, 0.682920039f, 0.23181136f, 0.167293206f,
+            0.174310699f, 0.143142477f, 0.152203783f, 0.220319852f, 0.173149332f, 0.188666523f,
+            0.180831015f, 0.181033209f, -0.353438616f, -0.377283126f, -0.367977738f, -0.381872892f,
+            -0.35955599f, -0.377789497f, -0.35497883f, -0.369389355f, -0.385465264f, -0.366735905f,
+            -0.40065977f, -0.411029279f, -0.396687239f, -0.277489156f, -0.34845981f, -0.399893522f,
+            -0.282698035f, -0.35135752f, -0.343016446f, -0.358504117f, -0.0502683148f, -0.0515716188f,
+            -0.192874506f, -0.00886383001f, -0.111900441f, -0.118434481f, -0.121267989f, -0.096448727f,
+            -0.0881470293f, -0.0928808525f, -0.114698164f, -0.106287904f, -0.0493427441f, -0.105295375f,
+            -0.178935677f, -0.137667358f, -0.16684413f, -0.111119039f, -0.141723171f, -0.126821354f,
+            -0.668441236f, -0.588246763f, -0.592554152f, -0.661653817f, -0.559478998f, -0.611473382f,
+            -0.550688982f, -0.629104853f, -0.583870053f, -0.590016067f, -0.161905959f, -0.175274581f,
+            -0.0664426908f, -0.101447545f, -0.15377827f, -0.157449558f, -0.17304042f, -0.108927883f,
+            -0.169710234f, -0.227597117f, -0.478225559f, -0.481176943f, -0.494069189f, -0.496051162f,
+            -0.485265166f, -0.484114379f, -0.493232727f, -0.489104956f, -0.500093281f, -0.476783961f,
+            0.137648061f, 0.0675657988f, 0.117798358f, 0.120361663f, 0.0302399956f, 0.100766502f,
+            0.185729414f, 0.0681653544f, 0.0712405071f, 0.108219847f, -0.0398992673f, -0.0515904576f,
+            0.0234133974f, -0.0627234802f, -0.0462997481f, -0.0278391875f, -0.0323048867f, -0.0482732244f,
+            -0.0783083886f, -0.0300315395f, 0.00981430523f, 0.109094284f, 0.102608867f, 0.0729679689f,
+            0.0586894155f, 0.0518463217f, 0.129620641f, 0.0792080909f, -0.0173225719f, 0.0912745148f,
+            -0.989185572f, -1.04512882f, -1.03428829f, -1.03388572f, -1.02093601f, -1.02682889f,
+            -1.03007531f, -1.06155026f, -1.03837609f, -1.05124354f, -0.246731713f, -0.242378458f,
+            -0.261270255f, -0.22511597f, -0.245797709f, -0.223090515f, -0.256756902f, -0.22785069f,
+            -0.211125001f, -0.201873839f, -0.44719404f, -0.453608632f, -0.469178677f, -0.46621576f,
+            -0.463621348f, -0.469468743f, -0.456020534f, -0.457777858f, -0.448892355f, -0.454468995f,
+            -0.598735988f, -0.598993957f, -0.549576998f, -0.575850129f, -0.677662909f, -0.514607847f,
+            -0.641249955f, -0.56652832f, -0.537437379f, -0.51064676f, 0.663179338f, 0.662741363f,
+            0.673784554f, 0.662052453f, 0.670268297f, 0.667900324f, 0.670733273f, 0.670546174f,
+            0.670730531f, 0.674740851f, 0.169770241f, 0.190004975f, 0.232268959f, 0.202962056f,
+            0.28215012f, 0.246425733f, 0.203169525f, 0.27892381f, 0.167224705f, 0.21132426f,
+            0.0386742763f, 0.0770022795f, 0.100918792f, 0.0685970038f, 0.0576106571f, 0.0589554273f,
+            0.0691033602f, 0.210091099f, 0.0879797786f, -0.00768018235f, 0.768997014f, 0.764429867f,
+            0.791827261f, 0.844863236f, 0.860633135f, 0.777467549f, 0.715794504f, 0.813544989f,
+            0.826097667f, 0.779609203f, 0.26366353f, 0.297974885f, 0.311727583f, 0.311227441f,
+            0.340778559f, 0.302527666f, 0.268491298f, 0.276507139f, 0.288351148f, 0.294458747f,
+            0.412874609f, 0.48658365f, 0.423754424f, 0.289073288f, 0.539702535f, 0.532043576f,
+            0.502591372f, 0.561915517f, 0.493835628f, 0.296405256f, 1.53421044f, 1.59309149f,
+            1.54648089f, 1.53029501f, 1.57216275f, 1.42670155f, 1.49966228f, 1.47077215f,
+            1.7653209f, 1.5809902f, 0.801484227f, 0.697872579f, 0.797697425f, 0.845475972f,
+            0.779244184f, 0.741590559f, 0.688604295f, 0.784906745f, 0.689874291f, 0.747782528f,
+            -0.0180672947f, 0.0184704941f, -0.0119110206f, 0.00019884613f, -0.0238562059f, 0.0451802313f,
+            0.0125262644f, -0.0337812081f, 0.051662717f, 0.0351040736f, 0.747797847f, 0.759915829f,
+            0.769398034f, 0.751632392f, 0.756515861f, 0.757765889f, 0.776709735f, 0.764774978f,
+            0.780117869f, 0.768238485f, -0.114683568f, -0.187893197f, -0.0181558393f, -0.109118626f,
+            -0.111996345f, -0.0859930441f, -0.109711289f, -0.0436734967f, -0.107391834f, -0.0550673567f,
+            0.398183912f, 0.367057681f, 0.477766693f, 0.447692335f, 0.405486286f, 0.426970214f,
+            0.425672084f, 0.32322365f, 0.392985612f, 0.383270174f, -0.506002605f, -0.506272078f,
+            -0.504164636f, -0.502343297f, -0.506440938f, -0.505347192f, -0.512597322f, -0.501946449f,
+            -0.511243701f, -0.506707847f, 0.886030853f, 0.889430404f, 0.911623359f, 0.929577291f,
+            0.922935426f, 0.916355252f, 0.907256067f, 0.916029036f, 0.902945042f, 0.896574557f,
+            0.0453633629f, 0.0409656987f, 0.0355718769f, 0.0360179059f, 0.039959088f, 0.0436292067f,
+            0.0401274078f, 0.0415146835f, 0.0451710857f, 0.0423801169f, 0.596679926f, 0.636750042f,
+            0.628448367f, 0.606922626f, 0.572883904f, 0.617704034f, 0.616159856f, 0.607194185f,
+            0.619523346f, 0.632071137f, 0.86021632f, 0.67017144f, 0.800569177f, 0.688729048f,
+            0.73564893f, 0.787110686f, 0.739739597f, 0.719148517f, 0.758937478f, 0.735455215f,
+            -0.289445221f, -0.229810327f, -0.278038085f, -0.264369994f, -0.264041126f, -0.276950806f,
+            -0.264229298f, -0.241535187f, -0.268262953f, -0.282812923f, -0.544807613f, -0.354306817f,
+            -0.472174436f, -0.484934121f, -0.494904816f, -0.564890742f, -0.475457609f, -0.472600102f,
+            -0.531951845f, -0.485768825f, -0.327345878f, -0.32832405f, -0.333816081f, -0.358449042f,
+            -0.347064972f, -0.344709843f, -0.311822653f, -0.30512616f, -0.34922424f, -0.313297987f,
+            -0.189150661f, -0.192299008f, -0.223549753f, -0.160174519f, -0.204870656f, -0.114890978f,
+            -0.188720211f, -0.228240013f, -0.178274408f, -0.145351797f, 0.427179068f, 0.441266656f,
+            0.461503983f, 0.55188036f, 0.506509423f, 0.459826469f, 0.447610229f, 0.462028384f,
+            0.509439945f, 0.434033036f, 0.921471119f, 0.663410902f, 0.846501172f, 0.792089224f,
+            0.870362997f, 0.93442589f, 1.04455614f, 0.813750982f, 0.903819859f, 0.813029647f,
+            0.165488586f, 0.201963827f, 0.242690757f, 0.255061656f, 0.423169345f, 0.275674611f,
+            0.345216721f, 0.265486032f, 0.328453839f, 0.17470707f, -0.340340108f, -0.343582541f,
+            -0.368558824f, -0.354897857f, -0.349527836f, -0.364164978f, -0.391971141f, -0.340734661f,
+            -0.370258182f, -0.375408798f, -0.121518284f, -0.0840646327f, -0.0957023501f, -0.0476766191f,
+            -0.00287936837f, -0.0398718789f, 0.00408767769f, 0.0459952578f, -0.130139098f, 0.0802106932f,
+            0.138774738f, 0.114717387f, 0.0363966785f, 0.0273041055f, 0.0783713907f, 0.0839513764f,
+            0.0987119079f, 0.0864558741f, 0.0442165509f, 0.0889831334f, -0.134994209f, -0.119275771f,
+            -0.0326070413f, -0.0761935487f, -0.0719727054f, -0.180754721f, -0.077088058f, -0.0720322803f,
+            -0.135880977f, -0.124500208f, -0.116810143f, -0.0656024665f, -0.00584493484f, -0.0549962744f,
+            -0.111295201f, -0.0480098464f, -0.0780816823f, -0.0788445473f, -0.0478808768f, -0.0572038405f,
+            -0.272800684f, -0.269456893f, -0.329001963f, -0.292655498f, -0.312078357f, -0.225827619f,
+            -0.271468133f, -0.393320322f, -0.319315732f, -0.320710659f, -0.0650164634f, -0.272274852f,
+            -0.169409186f, -0.21799013f, -0.266579896f, -0.170531452f, -0.29080826f, -0.267355233f,
+            -0.194014505f, -0.249356419f, -1.26903248f, -1.24674726f, -1.26049006f, -1.15894496f,
+            -1.27619588f, -1.21357512f, -1.14208329f, -1.23559117f, -1.28462398f, -1.26538777f,
+            -2.01371431f, -2.00760508f, -2.020118f, -2.06006479f, -2.04059005f, -2.02255392f,
+            -2.01809645f, -1.96196043f, -2.04618382f, -2.00774765f, -0.343743086f, -0.366708905f,
+            -0.282346874f, -0.334316224f, -0.354066432f, -0.323651165f, -0.360390872f, -0.318110853f,
+            -0.320651978f, -0.354548067f, -0.427564114f, -0.452043205f, -0.376220733f, -0.412237078f,
+            -0.38938424f, -0.3905285f, -0.420584232f, -0.45924899f, -0.457383066f, -0.347815841f,
+            -0.275283128f, -0.262657851f, -0.294566303f, -0.188098267f, -0.328664124f, -0.159143418f,
+            -0.211501792f, -0.234440207f, -0.203623131f, -0.209291741f, -0.664106846f, -0.492167056f,
+            -0.623285294f, -0.590781748f, -0.618700802f, -0.565841734f, -0.675970972f, -0.632651567f,
+            -0.733168066f, -0.612456381f, -0.27970925f, -0.0433161706f, -0.308818579f, -0.0967260823f,
+            -0.0950287431f, -0.320343673f, -0.193670779f, -0.263361514f, -0.186627164f, -0.15054889f,
+            -0.815983474f, -0.796502411f, -0.810346484f, -0.814207971f, -0.824508727f, -0.79651767f,
+            -0.825024307f, -0.851841211f, -0.811431289f, -0.821208477f, -0.681137919f, -0.734246433f,
+            -0.720658004f, -0.65167141f, -0.736835539f, -0.735472858f, -0.753307402f, -0.749084473f,
+            -0.735785902f, -0.726746142f, -0.293294519f, -0.294359654f, -0.294578433f, -0.294669241f,
+            -0.296571583f, -0.29475987f, -0.286863118f, -0.296751261f, -0.295667231f, -0.296209216f,
+            0.2079124f, 0.178720206f, 0.176987916f, 0.193711564f, 0.144411579f, 0.118251741f,
+            0.213075146f, 0.241763026f, 0.195302948f, 0.105819024f, 1.06224549f, 1.10662603f,
+            1.05143917f, 1.03064728f, 1.02460647f, 1.08847332f, 1.00469172f, 1.0278101f,
+            1.04799306f, 1.10008323f, 0.540349007f, 0.551395774f, 0.549498856f, 0.551497698f,
+            0.544867933f, 0.54831171f, 0.551523209f, 0.537890673f, 0.545672119f, 0.533055425f,
+            0.486467034f, 0.484445512f, 0.488132954f, 0.485881567f, 0.485847443f, 0.486049742f,
+            0.486813098f, 0.486988097f, 0.486763984f, 0.487648666f, -0.695987284f, -0.661383808f,
+            -0.678965807f, -0.672379732f, -0.707010746f, -0.670356631f, -0.683854699f, -0.677413166f,
+            -0.696240425f, -0.692912698f, -0.518345118f, -0.51963973f, -0.562854111f, -0.500201702f,
+            -0.589507878f, -0.514212906f, -0.522765458f, -0.577087641f, -0.563567698f, -0.600584984f,
+            -0.194920689f, -0.346116573f, -0.255818188f, -0.25948903f, -0.284926325f, -0.18013072f,
+            -0.375384748f, -0.195682809f, -0.284291267f, -0.258844078f, -0.674948096f, -0.719128191f,
+            -0.683465004f, -0.706873775f, -0.736204088f, -0.67042619f, -0.703972101f, -0.699932396f,
+            -0.710822105f, -0.68551451f, -0.150507107f, -0.150237367f, -0.149379447f, -0.149681434f,
+            -0.150704503f, -0.14989692f, -0.151801616f, -0.149054617f, -0.149734482f, -0.15259552f,
+            0.412318379f, 0.32102862f, 0.419007421f, 0.356154174f, 0.319807976f, 0.334003329f,
+            0.30190292f, 0.323187202f, 0.444505394f, 0.393465847f, 0.273223549f, 0.341289967f,
+            0.304067373f, 0.41737932f, 0.415595442f, 0.23673141f, 0.441159993f, 0.252099097f,
+            0.360266954f, 0.379360944f, 0.185903251f, 0.191170752f, 0.228215292f, 0.198229969f,
+            0.221203551f, 0.210128292f, 0.20275186f, 0.148657471f, 0.180785716f, 0.189017579f,
+            -0.0388692729f, -0.0540883429f, -0.0611247942f, -0.0100186178f, -0.0144713297f, -0.0419143103f,
+            -0.0607502908f, -0.104609087f, -0.0716546699f, -0.137608156f, -0.14745979f, -0.166963533f,
+            -0.181148872f, -0.116738051f, -0.0797272697f, 0.013327742f, 0.0571567677f, -0.0766543746f,
+            -0.0634488985f, -0.0829303637f, 1.20508134f, 1.36644173f, 1.22243023f, 1.29056287f,
+            1.23961627f, 1.26844549f, 1.26825476f, 1.25641215f, 1.23875642f, 1.2164923f,
+            0.939099073f, 0.945358932f, 1.02500963f, 1.02647138f, 0.981580734f, 1.03846836f,
+            1.04198039f, 1.11567235f, 1.04338121f, 1.05983388f, 0.785926223f, 0.822490275f,
+            0.727481484f, 0.836165786f, 0.801524997f, 0.743664503f, 0.889377594f, 0.790532053f,
+            0.82583642f, 0.817070663f, 0.262964696f, 0.356021821f, 0.451521844f, 0.357245147f,
+            0.255670011f, 0.389987588f, 0.351352632f, 0.489716768f, 0.436565429f, 0.29034546f,
+            -1.14347053f, -1.19288886f, -1.19505835f, -1.17035365f, -1.18371117f, -1.21092892f,
+            -1.20605087f, -1.18400335f, -1.21609044f, -1.19234288f, -0.816537559f, -0.877685726f,
+            -0.804014981f, -0.830509961f, -0.781163573f, -0.829715431f, -0.753416777f, -0.829864264f,
+            -0.84459877f, -0.846568227f, 0.452623934f, 0.412015229f, 0.434034228f, 0.414798468f,
+            0.453942269f, 0.453059614f, 0.497843772f, 0.382387638f, 0.401045442f, 0.47678116f,
+            0.517848134f, 0.230212659f, 0.228693068f, 0.445956618f, 0.699240327f, 0.499795079f,
+            0.255670071f, 0.50405997f, 0.476254642f, 0.400630713f, 0.671120405f, 0.688485861f,
+            0.669245422f, 0.70360738f, 0.683822393f, 0.674399734f, 0.662631691f, 0.658306301f,
+            0.660411417f, 0.663658917f, 0.944384575f, 0.914611638f, 0.94519639f, 0.91122508f,
+            0.91868341f, 0.923116028f, 0.920758188f, 0.941688597f, 0.973422945f, 0.923701704f,
+            -0.0364473984f, -0.0628626049f, -0.0659119338f, -0.0541296564f, -0.0756338984f, -0.047506012f,
+            -0.0429650247f, -0.0352078341f, -0.0391486511f, -0.0567136407f, 0.683292687f, 0.683743417f,
+            0.681890249f, 0.67976445f, 0.680997252f, 0.67897892f, 0.679385722f, 0.676916301f,
+            0.682205439f, 0.679360628f, -0.162357211f, -0.144315138f, -0.15345411f, -0.14350009f,
+            -0.147442356f, -0.149207383f, -0.149937049f, -0.142703429f, -0.140304044f, -0.156361073f,
+            1.06691658f, 1.07619941f, 0.962572098f, 1.02605319f, 1.07860887f, 1.08812499f,
+            1.04833066f, 1.02083361f, 1.01449919f, 1.05122948f,
+        };
+        return values;
+    }
+
+    // int16 for FixedPBC.h, layer l scaled by 2^shifts()[l] and the gains by the last;
+    // against float64 over 4096 states: max |u error| 4.06e-03, rms 7.45e-04
+    struct fixed {
+        static constexpr int num_shifts = 4;
+        static const int8_t* shifts() {
+            static const int8_t values[num_shifts] = {13, 13, 14, 14};
+            return values;
+        }
+        static const int16_t* params() {
+            static const int16_t values[num_params] = {
+                -4799, -2449, 3230, 4313, -8156, -98, 175, 1222, 14137, -8952, 1667, 2620,
+                3907, 15073, 10151, 6408, 305, 1145, -1285, 2405, -683, 230, -988, 3788,
+                -728, -1855, -2001, 2097, -6793, 1471, 2004, -1214, 2117, 3503, -16966, -8568,
+                4565, 554, 2911, -5819, 2699, -6355, 2880, 2761, 1047, 725, 3060, -3210,
+                5797, 1410, -2948, -2877, -734, -1068, -4821, -1277, -3987, 807, -246, 543,
+                -8264, -1872, -3750, -4742, 5481, 1623, 782, 6424, 2367, 3600, 12421, 6296,
+                126, 6218, -783, 3244, -4148, 7474, 325, 5022, 6137, -2137, -4131, -2611,
+                -1484, 3777, 7122, 2295, -2941, -529, 737, -973, -516, -2369, -1670, -10375,
+                -16528, -2722, -3272, -1921, -4980, -1380, -6695, -5942, -2419, 1527, 8594, 4483,
+                3984, -5605, -4525, -2458, -5756, -1237, 2898, 2628, 1555, -238, -647, 20576,
+                16241, 13266, 5969, -19541, -13494, 7382, 6968, 11029, 15291, -752, 11160, -2404,
+                16824,
+            };
+            return values;
+        }
+    };
+
+    // straight-line pass for SparsePBC.h, weights below 0 pruned: 111 of 111 kept;
+    // against the dense network over 4096 states: max |u error| 0.00e+00, rms 0.00e+00
+    struct sparse {
+        static constexpr int num_weights = 111;
+        static constexpr int num_kept = 111;
+
+        // Hd(x) and into dh its derivative along the gains, as Chain::tangent()
+        template<class Elu = pbc::ExactElu>
+        static inline float tangent(const float* x, float* dh) {
+            float y0_0 = 0.707620323f - 0.5857898f*x[0] + 1.7257483f*x[1] + 0.0372416526f*x[2] - 0.0889084712f*x[3] + 0.258464992f*x[4] + 0.329413295f*x[5];
+            float dy0_0 = 1.45429981f;
+            if (y0_0 <= 0.0f) {
+                y0_0 = Elu::expm1(y0_0);
+                dy0_0 *= y0_0 + 1.0f;
+            }
+            float y0_1 = 0.172146127f - 0.2989963f*x[0] - 1.09280372f*x[1] + 0.139827147f*x[2] - 0.226454332f*x[3] + 0.42763859f*x[4] - 0.775718212f*x[5];
+            float dy0_1 = -2.24110699f;
+            if (y0_1 <= 0.0f) {
+                y0_1 = Elu::expm1(y0_1);
+                dy0_1 *= y0_1 + 1.0f;
+            }
+            float y0_2 = -0.359869808f + 0.394273639f*x[0] + 0.203467712f*x[1] - 0.156880006f*x[2] - 0.244307801f*x[3] - 2.07105374f*x[4] + 0.351598412f*x[5];
+            float dy0_2 = 0.961047411f;
+            if (y0_2 <= 0.0f) {
+                y0_2 = Elu::expm1(y0_2);
+                dy0_2 *= y0_2 + 1.0f;
+            }
+            float y0_3 = -0.351251394f + 0.526435852f*x[0] + 0.31987232f*x[1] + 0.29360503f*x[2] + 0.255945772f*x[3] - 1.04585755f*x[4] + 0.337005317f*x[5];
+            float dy0_3 = 1.31328404f;
+            if (y0_3 <= 0.0f) {
+                y0_3 = Elu::expm1(y0_3);
+                dy0_3 *= y0_3 + 1.0f;
+            }
+            float y0_4 = -0.0895425305f - 0.995625854f*x[0] + 0.476873726f*x[1] - 0.0833433643f*x[2] - 0.82925421f*x[3] + 0.557237506f*x[4] + 0.127751246f*x[5];
+            float dy0_4 = -0.736779869f;
+            if (y0_4 <= 0.0f) {
+                y0_4 = Elu::expm1(y0_4);
+                dy0_4 *= y0_4 + 1.0f;
+            }
+            float y0_5 = -0.130369693f - 0.0119393608f*x[0] + 1.83996558f*x[1] + 0.0281241126f*x[2] + 0.179605886f*x[3] + 0.0676455572f*x[4] + 0.0885076001f*x[5];
+            float dy0_5 = 1.91113102f;
+            if (y0_5 <= 0.0f) {
+                y0_5 = Elu::expm1(y0_5);
+                dy0_5 *= y0_5 + 1.0f;
+            }
+            float y0_6 = -0.588462412f + 0.0213918183f*x[0] + 1.23914897f*x[1] - 0.120622419f*x[2] + 0.24461329f*x[3] + 0.355339587f*x[4] + 0.37350741f*x[5];
+            float dy0_6 = 1.6743927f;
+            if (y0_6 <= 0.0f) {
+                y0_6 = Elu::expm1(y0_6);
+                dy0_6 *= y0_6 + 1.0f;
+            }
+            float y0_7 = -0.155907184f + 0.149163321f*x[0] + 0.782284856f*x[1] + 0.462435693f*x[2] - 0.148141742f*x[3] - 0.710294247f*x[4] - 0.39187485f*x[5];
+            float dy0_7 = 0.410183221f;
+            if (y0_7 <= 0.0f) {
+                y0_7 = Elu::expm1(y0_7);
+                dy0_7 *= y0_7 + 1.0f;
+            }
+            float y1_0 = -0.702596545f - 0.48668465f*y0_0 - 0.578828573f*y0_1 + 1.5162946f*y0_2 + 0.912403524f*y0_3 - 0.181107849f*y0_4 - 0.118717961f*y0_5 - 0.399462491f*y0_6 + 0.186424762f*y0_7;
+            float dy1_0 = -0.48668465f*dy0_0 - 0.578828573f*dy0_1 + 1.5162946f*dy0_2 + 0.912403524f*dy0_3 - 0.181107849f*dy0_4 - 0.118717961f*dy0_5 - 0.399462491f*dy0_6 + 0.186424762f*dy0_7;
+            if (y1_0 <= 0.0f) {
+                y1_0 = Elu::expm1(y1_0);
+                dy1_0 *= y1_0 + 1.0f;
+            }
+            float y1_1 = -0.151017383f + 0.098526597f*y0_0 + 0.669073939f*y0_1 + 0.768529654f*y0_2 + 0.0397213586f*y0_3 + 0.460999399f*y0_4 - 0.063016139f*y0_5 - 0.234450668f*y0_6 + 1.04905748f*y0_7;
+            float dy1_1 = 0.098526597f*dy0_0 + 0.669073939f*dy0_1 + 0.768529654f*dy0_2 + 0.0397213586f*dy0_3 + 0.460999399f*dy0_4 - 0.063016139f*dy0_5 - 0.234450668f*dy0_6 + 1.04905748f*dy0_7;
+            if (y1_1 <= 0.0f) {
+                y1_1 = Elu::expm1(y1_1);
+                dy1_1 *= y1_1 + 1.0f;
+            }
+            float y1_2 = 0.353722513f - 0.0300272424f*y0_0 + 0.198102415f*y0_1 + 0.0153791178f*y0_2 + 0.613012612f*y0_3 + 0.86940968f*y0_4 - 0.289152324f*y0_5 - 0.60794127f*y0_6 + 0.547232509f*y0_7;
+            float dy1_2 = -0.0300272424f*dy0_0 + 0.198102415f*dy0_1 + 0.0153791178f*dy0_2 + 0.613012612f*dy0_3 + 0.86940968f*dy0_4 - 0.289152324f*dy0_5 - 0.60794127f*dy0_6 + 0.547232509f*dy0_7;
+            if (y1_2 <= 0.0f) {
+                y1_2 = Elu::expm1(y1_2);
+                dy1_2 *= y1_2 + 1.0f;
+            }
+            float y1_3 = 0.32075122f + 0.0662980005f*y0_0 + 0.0954650715f*y0_1 + 0.759068906f*y0_2 + 0.749202311f*y0_3 + 0.280159295f*y0_4 - 0.203807324f*y0_5 - 0.168480664f*y0_6 + 0.486288935f*y0_7;
+            float dy1_3 = 0.0662980005f*dy0_0 + 0.0954650715f*dy0_1 + 0.759068906f*dy0_2 + 0.749202311f*dy0_3 + 0.280159295f*dy0_4 - 0.203807324f*dy0_5 - 0.168480664f*dy0_6 + 0.486288935f*dy0_7;
+            if (y1_3 <= 0.0f) {
+                y1_3 = Elu::expm1(y1_3);
+                dy1_3 *= y1_3 + 1.0f;
+            }
+            float y1_4 = 0.189830065f - 1.00874484f*y0_0 + 0.784173548f*y0_1 - 0.0955815017f*y0_2 - 0.260833681f*y0_3 - 0.358981192f*y0_4 - 1.26651132f*y0_5 - 0.817258596f*y0_6 - 0.684153855f*y0_7;
+            float dy1_4 = -1.00874484f*dy0_0 + 0.784173548f*dy0_1 - 0.0955815017f*dy0_2 - 0.260833681f*dy0_3 - 0.358981192f*dy0_4 - 1.26651132f*dy0_5 - 0.817258596f*dy0_6 - 0.684153855f*dy0_7;
+            if (y1_4 <= 0.0f) {
+                y1_4 = Elu::expm1(y1_4);
+                dy1_4 *= y1_4 + 1.0f;
+            }
+            float y1_5 = -0.0290324558f - 0.228562325f*y0_0 + 0.289001256f*y0_1 + 0.396046221f*y0_2 - 0.504312754f*y0_3 - 0.0645752475f*y0_4 - 2.0175283f*y0_5 - 0.725300848f*y0_6 - 0.55242008f*y0_7;
+            float dy1_5 = -0.228562325f*dy0_0 + 0.289001256f*dy0_1 + 0.396046221f*dy0_2 - 0.504312754f*dy0_3 - 0.0645752475f*dy0_4 - 2.0175283f*dy0_5 - 0.725300848f*dy0_6 - 0.55242008f*dy0_7;
+            if (y1_5 <= 0.0f) {
+                y1_5 = Elu::expm1(y1_5);
+                dy1_5 *= y1_5 + 1.0f;
+            }
+            float y1_6 = -0.0789784417f - 0.457749635f*y0_0 + 0.43947652f*y0_1 - 0.506388187f*y0_2 - 0.318688989f*y0_3 + 0.0900178328f*y0_4 - 0.332332462f*y0_5 - 0.295327246f*y0_6 - 0.300052553f*y0_7;
+            float dy1_6 = -0.457749635f*dy0_0 + 0.43947652f*dy0_1 - 0.506388187f*dy0_2 - 0.318688989f*dy0_3 + 0.0900178328f*dy0_4 - 0.332332462f*dy0_5 - 0.295327246f*dy0_6 - 0.300052553f*dy0_7;
+            if (y1_6 <= 0.0f) {
+                y1_6 = Elu::expm1(y1_6);
+                dy1_6 *= y1_6 + 1.0f;
+            }
+            *dh = 1.25588274f*dy1_0 + 0.991296351f*dy1_1 + 0.809665799f*dy1_2 + 0.364306688f*dy1_3 - 1.19268537f*dy1_4 - 0.823622167f*dy1_5 + 0.450557649f*dy1_6;
+            return 0.425284117f + 1.25588274f*y1_0 + 0.991296351f*y1_1 + 0.809665799f*y1_2 + 0.364306688f*y1_3 - 1.19268537f*y1_4 - 0.823622167f*y1_5 + 0.450557649f*y1_6;
+        }
+    };
+};
+
+} // namespace pbc_weights
+
+#endif //PbcWeights_rw_bayesian_h
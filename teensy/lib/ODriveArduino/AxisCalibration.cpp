@@ -0,0 +1,86 @@
+#include "Arduino.h"
+#include "AxisCalibration.h"
+
+void AxisCalibration::start(int axis, bool motor, bool encoder, bool index_search, uint32_t now_ms) {
+    Axis& a = axes_[axis];
+    a.encoder = encoder;
+    a.index_search = index_search;
+    a.start_ms = now_ms;
+    if (motor)
+        enter(axis, MOTOR, now_ms);
+    else if (encoder)
+        enter(axis, index_search ? INDEX_SEARCH : ENCODER, now_ms);
+    else
+        enter(axis, SETTLE, now_ms);
+}
+
+bool AxisCalibration::update(uint32_t now_ms) {
+    bool changed = false;
+    for (int axis = 0; axis < 2; ++axis) {
+        Axis& a = axes_[axis];
+        if (!running(axis))
+            continue;
+        Phase before = a.phase;
+        if (a.phase == SETTLE) {
+            if (now_ms - a.phase_ms >= settle_ms_) enter(axis, DONE, now_ms);
+        } else if (now_ms - a.poll_ms >= poll_ms_) {
+            a.poll_ms = now_ms;
+            int state = driver_.readState(axis);
+            if (state > AXIS_STATE_IDLE) {
+                a.seen_active = true;
+            } else if (state == AXIS_STATE_IDLE && (a.seen_active || now_ms - a.phase_ms >= min_state_ms)) {
+                advance(axis, now_ms);
+            }
+            if (running(axis) && a.phase == before && now_ms - a.phase_ms >= timeout_ms(a.phase))
+                enter(axis, TIMEOUT, now_ms);
+        }
+        changed |= a.phase != before;
+    }
+    return changed;
+}
+
+void AxisCalibration::advance(int axis, uint32_t now_ms) {
+    Axis& a = axes_[axis];
+    if (a.phase == MOTOR && a.encoder)
+        enter(axis, a.index_search ? INDEX_SEARCH : ENCODER, now_ms);
+    else
+        enter(axis, SETTLE, now_ms);
+}
+
+void AxisCalibration::enter(int axis, Phase phase, uint32_t now_ms) {
+    Axis& a = axes_[axis];
+    a.phase_ms = a.poll_ms = now_ms;
+    a.seen_active = false;
+    switch (phase) {
+        case MOTOR:        driver_.runState(axis, AXIS_STATE_MOTOR_CALIBRATION, false); break;
+        case ENCODER:      driver_.runState(axis, AXIS_STATE_ENCODER_OFFSET_CALIBRATION, false); break;
+        case INDEX_SEARCH: driver_.runState(axis, AXIS_STATE_ENCODER_INDEX_SEARCH, false); break;
+        case SETTLE:       driver_.runState(axis, AXIS_STATE_CLOSED_LOOP_CONTROL, false); break;
+        default:           a.end_ms = now_ms; break;
+    }
+    a.phase = phase;
+}
+
+uint32_t AxisCalibration::elapsed_ms(int axis, uint32_t now_ms) const {
+    const Axis& a = axes_[axis];
+    if (a.phase == IDLE) return 0;
+    return (running(axis) ? now_ms : a.end_ms) - a.start_ms;
+}
+
+uint32_t AxisCalibration::timeout_ms(Phase phase) {
+    // the run_state() timeouts of a blocking calibration
+    return phase == ENCODER ? 25000 : 10000;
+}
+
+const char* AxisCalibration::name(Phase phase) {
+    switch (phase) {
+        case IDLE:         return "idle";
+        case MOTOR:        return "motor";
+        case ENCODER:      return "encoder_offset";
+        case INDEX_SEARCH: return "index_search";
+        case SETTLE:       return "closed_loop";
+        case DONE:         return "done";
+        case TIMEOUT:      return "timeout";
+    }
+    return "";
+}
@@ -0,0 +1,63 @@
+#ifndef AxisCalibration_h
+#define AxisCalibration_h
+
+#include "Arduino.h"
+#include "MotorDriver.h"
+
+/* Non-blocking calibration of both ODrive axes: each axis walks motor
+* calibration, encoder offset calibration (or only the index search for a
+* pre_calibrated encoder) and closed loop, with the states of both axes
+* requested at once.
+*
+* start() requests an axis' first state and returns. update() is called
+* periodically from whatever context owns the ODrive link (the control step),
+* reads each running axis' current_state at most every poll_ms and requests
+* the next state once the axis is back in IDLE. An axis that stays in a state
+* past its timeout stops there, as a blocking run_state() would; after closed
+* loop is requested it settles for settle_ms before it counts as done.
+*
+* A state requested less than min_state_ms ago that reads IDLE is taken as
+* not started yet unless the axis was seen leaving IDLE, since a CAN
+* heartbeat can still report the state from before the request.
+*/
+class AxisCalibration {
+public:
+    enum Phase : uint8_t { IDLE, MOTOR, ENCODER, INDEX_SEARCH, SETTLE, DONE, TIMEOUT };
+
+    AxisCalibration(MotorDriver& driver, uint32_t poll_ms = 100, uint32_t settle_ms = 250)
+        : driver_(driver), poll_ms_(poll_ms), settle_ms_(settle_ms) {}
+
+    // Runs the states axis needs: motor calibration, then the encoder's
+    // offset calibration or index search, then closed loop
+    void start(int axis, bool motor, bool encoder, bool index_search, uint32_t now_ms);
+    // Polls the running axes; true if any phase changed
+    bool update(uint32_t now_ms);
+
+    bool busy() const { return running(0) || running(1); }
+    Phase phase(int axis) const { return axes_[axis].phase; }
+    // Since start(), frozen once the axis is done or timed out
+    uint32_t elapsed_ms(int axis, uint32_t now_ms) const;
+    static const char* name(Phase phase);
+
+    static constexpr uint32_t min_state_ms = 500;
+
+private:
+    struct Axis {
+        volatile Phase phase = IDLE;
+        bool encoder, index_search;
+        bool seen_active;
+        uint32_t start_ms, phase_ms, poll_ms, end_ms;
+    };
+
+    bool running(int axis) const { return axes_[axis].phase != IDLE && axes_[axis].phase < DONE; }
+    void enter(int axis, Phase phase, uint32_t now_ms);
+    void advance(int axis, uint32_t now_ms);
+    static uint32_t timeout_ms(Phase phase);
+
+    MotorDriver& driver_;
+    uint32_t poll_ms_;
+    uint32_t settle_ms_;
+    Axis axes_[2];
+};
+
+#endif //AxisCalibration_h
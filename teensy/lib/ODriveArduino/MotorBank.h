@@ -0,0 +1,96 @@
+#ifndef MotorBank_h
+#define MotorBank_h
+
+#include "Arduino.h"
+#include "MotorDriver.h"
+
+/* Several two-axis ODrive boards driven as one, for actuators beyond the hip
+* pair. Each board is a MotorDriver of its own on whichever transport it
+* hangs off: a UART each (ODriveAsciiDriver, ODriveBinaryDriver), an I2C
+* address each (ODriveI2CDriver's odrive_num, on one bus or several), or a
+* pair of node ids each on the one CAN bus (ODriveCANDriver). Axis a of the
+* bank is axis a % 2 of board a / 2.
+*
+* A tick is split as the single board's is, across all boards at once:
+* requestFeedback() starts every board's exchange before any is waited for,
+* and readFeedback() then collects them in order, so the replies are on
+* their wires together and the tick waits for the slowest board rather than
+* for the sum. The setpoint calls only write or queue on every transport.
+* What still takes turns is what shares a wire: I2C boards on one bus in
+* its AsyncI2C queue (without waiting on the CPU), CAN nodes in
+* arbitration. Without ODRIVE_I2C_ASYNC an I2C board has no split either,
+* and its exchange blocks in readFeedback() board by board.
+*
+*     ODriveAsciiDriver hips(odriveA), ankles(odriveB);
+*     MotorDriver* const boards[2] = {&hips, &ankles};
+*     MotorBank bank(boards, 2);
+*     bank.requestFeedback();          // top of the step
+*     bank.readFeedback(position, velocity);
+*     bank.setTorques(torque);         // bank.axes() of each
+*/
+class MotorBank {
+public:
+    static constexpr uint8_t max_boards = 8;
+
+    MotorBank(MotorDriver* const* boards, uint8_t count)
+        : boards_(boards), count_(count < max_boards ? count : max_boards) {}
+
+    // Every board, even past one that fails; false if any did
+    bool begin() {
+        bool ok = true;
+        for (uint8_t i = 0; i < count_; ++i)
+            ok = boards_[i]->begin() && ok;
+        return ok;
+    }
+
+    // All the exchanges in flight before readFeedback() waits on the first
+    void requestFeedback() {
+        for (uint8_t i = 0; i < count_; ++i)
+            boards_[i]->requestFeedback();
+    }
+
+    // axes() positions in turns and velocities in turns/s; a board whose
+    // exchange failed keeps its last values and sets its bit in failed()
+    bool readFeedback(float* position, float* velocity) {
+        failed_ = 0;
+        for (uint8_t i = 0; i < count_; ++i) {
+            if (!boards_[i]->readFeedback(position + 2*i, velocity + 2*i)) {
+                failed_ |= 1u << i;
+                ++failures_[i];
+            }
+        }
+        return failed_ == 0;
+    }
+
+    void setTorques(const float* torque) {
+        for (uint8_t i = 0; i < count_; ++i)
+            boards_[i]->setTorques(torque[2*i], torque[2*i + 1]);
+    }
+    void setVelocities(const float* velocity, const float* torque_feedforward) {
+        for (uint8_t i = 0; i < count_; ++i)
+            boards_[i]->setVelocities(velocity + 2*i, torque_feedforward + 2*i);
+    }
+    void setPositions(const float* position, const float* velocity_feedforward, const float* torque_feedforward) {
+        for (uint8_t i = 0; i < count_; ++i)
+            boards_[i]->setPositions(position + 2*i, velocity_feedforward + 2*i, torque_feedforward + 2*i);
+    }
+
+    // The board behind bank axis a, and its axis there
+    MotorDriver& boardOf(uint8_t axis) const { return *boards_[axis / 2]; }
+    static int boardAxis(uint8_t axis) { return axis % 2; }
+
+    uint8_t boards() const { return count_; }
+    uint8_t axes() const { return 2*count_; }
+    MotorDriver& board(uint8_t i) const { return *boards_[i]; }
+    // Bit i for board i, as of the last readFeedback()
+    uint8_t failed() const { return failed_; }
+    uint32_t failures(uint8_t i) const { return failures_[i]; }
+
+private:
+    MotorDriver* const* boards_;
+    uint8_t count_;
+    uint8_t failed_ = 0;
+    uint32_t failures_[max_boards] = {};
+};
+
+#endif //MotorBank_h
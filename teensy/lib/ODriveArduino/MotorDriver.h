@@ -0,0 +1,204 @@
+#ifndef MotorDriver_h
+#define MotorDriver_h
+
+#include "Arduino.h"
+#include "ODriveArduino.h"
+#include "ODriveBinary.h"
+
+/* Transport-independent view of the two-axis ODrive used by the control loop.
+*
+* main.cpp declares one concrete driver at compile time (MOTOR_DRIVER). The
+* implementations are final, so calls through the concrete object are resolved
+* statically; the virtual interface is there for tools that switch at runtime.
+*
+* The two hips are one coupled joint, so the loop commands a mirrored pair:
+* setMirroredTorque() is one logical torque, axis 1 driven with it and axis 0
+* with its negative, and readFeedback() returns both axes in one exchange.
+* Transports fan the pair out in as few transactions as they have: one UART
+* write of both lines or frames for ASCII and binary, one frame per node for
+* CAN, one bus transaction per endpoint for I2C.
+*
+* Velocity and position setpoints carry a torque feed-forward in Nm, so the
+* non-torque modes can add the model's gravity torque; the pair calls write
+* both axes' setpoints and feed-forwards the same way as setTorques().
+*
+* sampleElectrical() adds both axes' measured Iq and the DC bus voltage to
+* the feedback exchange on the transports where that costs no turnaround:
+* three more reads in the binary batch, remote-request frames answered into
+* the CAN receive slots. readElectrical() returns them.
+*/
+class MotorDriver {
+public:
+    virtual ~MotorDriver() {}
+
+    virtual bool begin() { return true; }
+    // Start the feedback exchange early; readFeedback() collects it
+    virtual void requestFeedback() {}
+    // Positions in turns, velocities in turns/s
+    virtual bool readFeedback(float position[2], float velocity[2]) = 0;
+    virtual void setTorque(int axis, float torque) = 0;
+    // Both axes in one transaction where the transport has one
+    virtual void setTorques(float torque0, float torque1) {
+        setTorque(0, torque0);
+        setTorque(1, torque1);
+    }
+    // The mirrored pair: -torque on axis 0, torque on axis 1
+    void setMirroredTorque(float torque) { setTorques(-torque, torque); }
+    // Turns/s and turns, with a torque feed-forward in Nm
+    virtual void setVelocity(int axis, float velocity, float torque_feedforward) = 0;
+    virtual void setPosition(int axis, float position, float velocity_feedforward, float torque_feedforward) = 0;
+    virtual void setVelocities(const float velocity[2], const float torque_feedforward[2]) {
+        setVelocity(0, velocity[0], torque_feedforward[0]);
+        setVelocity(1, velocity[1], torque_feedforward[1]);
+    }
+    virtual void setPositions(const float position[2], const float velocity_feedforward[2],
+                              const float torque_feedforward[2]) {
+        setPosition(0, position[0], velocity_feedforward[0], torque_feedforward[0]);
+        setPosition(1, position[1], velocity_feedforward[1], torque_feedforward[1]);
+    }
+    virtual bool runState(int axis, int requested_state, bool wait_for_idle, float timeout = 10.0f) = 0;
+    // The axis' current_state, or -1 if it could not be read
+    virtual int readState(int axis) = 0;
+    virtual const char* name() const = 0;
+
+    // false where the transport cannot carry them in the feedback exchange
+    virtual bool sampleElectrical(bool on) { (void)on; return false; }
+    // Iq_measured in A and vbus_voltage in V as of the last feedback exchange; false if none yet
+    virtual bool readElectrical(float current[2], float& vbus) { (void)current; (void)vbus; return false; }
+};
+
+// ASCII lines over UART, feedback pipelined with "f <axis>"
+class ODriveAsciiDriver final : public MotorDriver {
+public:
+    ODriveAsciiDriver(ODriveArduino& odrive, uint32_t reply_timeout_us = 3000)
+        : odrive_(odrive), reply_timeout_us_(reply_timeout_us) {}
+
+    void requestFeedback() override {
+        odrive_.RequestFeedback(0);
+        odrive_.RequestFeedback(1);
+    }
+
+    bool readFeedback(float position[2], float velocity[2]) override {
+        if (odrive_.pending() == 0)
+            requestFeedback();
+        bool ok = odrive_.waitPending(reply_timeout_us_);
+        // a timed-out reply keeps the last good value rather than dropping to zero
+        const ODriveFeedback& feedback = odrive_.feedback();
+        position[0] = feedback.value[ODriveFeedback::POS0];
+        position[1] = feedback.value[ODriveFeedback::POS1];
+        velocity[0] = feedback.value[ODriveFeedback::VEL0];
+        velocity[1] = feedback.value[ODriveFeedback::VEL1];
+        return ok;
+    }
+
+    void setTorque(int axis, float torque) override { odrive_.SetTorque(axis, torque); }
+    void setTorques(float torque0, float torque1) override { odrive_.SetTorques(torque0, torque1); }
+    // "v"/"p" take input_torque as their last argument on firmware 0.5, the one the torque mode targets
+    void setVelocity(int axis, float velocity, float torque_feedforward) override {
+        odrive_.SetVelocity(axis, velocity, torque_feedforward);
+    }
+    void setPosition(int axis, float position, float velocity_feedforward, float torque_feedforward) override {
+        odrive_.SetPosition(axis, position, velocity_feedforward, torque_feedforward);
+    }
+    bool runState(int axis, int requested_state, bool wait_for_idle, float timeout = 10.0f) override {
+        return odrive_.run_state(axis, requested_state, wait_for_idle, timeout);
+    }
+    int readState(int axis) override {
+        int64_t state = odrive_.readProperty(axis, "current_state");
+        return odrive_.lastStatus() == ODriveArduino::READ_OK ? (int)state : -1;
+    }
+    const char* name() const override { return "uart-ascii"; }
+
+private:
+    ODriveArduino& odrive_;
+    uint32_t reply_timeout_us_;
+};
+
+// Native binary frames over UART
+class ODriveBinaryDriver final : public MotorDriver {
+public:
+    // counts_per_turn converts the endpoint table's encoder units to turns
+    ODriveBinaryDriver(ODriveBinary& odrive, float counts_per_turn = 1.0f)
+        : odrive_(odrive), turns_per_count_(1.0f / counts_per_turn) {}
+
+    // the four reads as one batch, a single turnaround on the UART; seven with sampleElectrical()
+    void requestFeedback() override {
+        static const uint16_t endpoints[7] = {
+            odrive::AXIS__ENCODER__POS_ESTIMATE, odrive::AXIS__ENCODER__POS_ESTIMATE + odrive::per_axis_offset,
+            odrive::AXIS__ENCODER__PLL_VEL, odrive::AXIS__ENCODER__PLL_VEL + odrive::per_axis_offset,
+            odrive::AXIS__MOTOR__CURRENT_CONTROL__IQ_MEASURED,
+            odrive::AXIS__MOTOR__CURRENT_CONTROL__IQ_MEASURED + odrive::per_axis_offset,
+            odrive::VBUS_VOLTAGE};
+        odrive_.request_floats(endpoints, electrical_ ? 7 : 4);
+    }
+
+    bool readFeedback(float position[2], float velocity[2]) override {
+        if (odrive_.requested() == 0)
+            requestFeedback();
+        // a missed reply keeps the last good value, as the ASCII driver does
+        bool ok = odrive_.collect_floats(counts_);
+        for (int axis = 0; axis < 2; ++axis) {
+            position[axis] = counts_[axis] * turns_per_count_;
+            velocity[axis] = counts_[2 + axis] * turns_per_count_;
+        }
+        if (ok && electrical_) has_electrical_ = true;
+        return ok;
+    }
+
+    void setTorque(int axis, float torque) override { odrive_.SetTorque(axis, torque); }
+    void setTorques(float torque0, float torque1) override { odrive_.SetTorques(torque0, torque1); }
+    // setpoint and feed-forward as one serial write; the feed-forward as a current, as SetTorque() sends it
+    void setVelocity(int axis, float velocity, float torque_feedforward) override {
+        const uint16_t offset = axis*odrive::per_axis_offset;
+        const uint16_t endpoints[2] = {(uint16_t)(odrive::AXIS__CONTROLLER__VEL_SETPOINT + offset),
+                                       (uint16_t)(odrive::AXIS__CONTROLLER__CURRENT_SETPOINT + offset)};
+        const float values[2] = {velocity / turns_per_count_, odrive_.current(torque_feedforward)};
+        odrive_.write_floats(endpoints, 2, values);
+    }
+    void setVelocities(const float velocity[2], const float torque_feedforward[2]) override {
+        static const uint16_t endpoints[4] = {
+            odrive::AXIS__CONTROLLER__VEL_SETPOINT, odrive::AXIS__CONTROLLER__VEL_SETPOINT + odrive::per_axis_offset,
+            odrive::AXIS__CONTROLLER__CURRENT_SETPOINT,
+            odrive::AXIS__CONTROLLER__CURRENT_SETPOINT + odrive::per_axis_offset};
+        const float values[4] = {velocity[0] / turns_per_count_, velocity[1] / turns_per_count_,
+                                 odrive_.current(torque_feedforward[0]), odrive_.current(torque_feedforward[1])};
+        odrive_.write_floats(endpoints, 4, values);
+    }
+    void setPosition(int axis, float position, float velocity_feedforward, float torque_feedforward) override {
+        const uint16_t offset = axis*odrive::per_axis_offset;
+        const uint16_t endpoints[3] = {(uint16_t)(odrive::AXIS__CONTROLLER__POS_SETPOINT + offset),
+                                       (uint16_t)(odrive::AXIS__CONTROLLER__VEL_SETPOINT + offset),
+                                       (uint16_t)(odrive::AXIS__CONTROLLER__CURRENT_SETPOINT + offset)};
+        const float values[3] = {position / turns_per_count_, velocity_feedforward / turns_per_count_,
+                                 odrive_.current(torque_feedforward)};
+        odrive_.write_floats(endpoints, 3, values);
+    }
+    bool runState(int axis, int requested_state, bool wait_for_idle, float timeout = 10.0f) override {
+        return odrive_.run_state(axis, requested_state, wait_for_idle, timeout);
+    }
+    int readState(int axis) override {
+        uint8_t state;
+        return odrive_.read_axis_property<odrive::AXIS__CURRENT_STATE>(axis, &state) ? state : -1;
+    }
+    const char* name() const override { return "uart-binary"; }
+
+    bool sampleElectrical(bool on) override {
+        electrical_ = on;
+        return true;
+    }
+    bool readElectrical(float current[2], float& vbus) override {
+        current[0] = counts_[4];
+        current[1] = counts_[5];
+        vbus = counts_[6];
+        return has_electrical_;
+    }
+
+private:
+    ODriveBinary& odrive_;
+    float turns_per_count_;
+    bool electrical_ = false;
+    bool has_electrical_ = false;
+    float counts_[7] = {}; // pos 0, pos 1, vel 0, vel 1, Iq 0, Iq 1, vbus
+};
+
+#endif //MotorDriver_h
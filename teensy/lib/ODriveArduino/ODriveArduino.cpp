@@ -1,14 +1,41 @@
 
 #include "Arduino.h"
 #include "ODriveArduino.h"
+#include "ODriveAscii.h"
+#include <Placement.h>
 
 // Print with stream operator
 template<class T> inline Print& operator <<(Print &obj,     T arg) { obj.print(arg);    return obj; }
 template<>        inline Print& operator <<(Print &obj, float arg) { obj.print(arg, 4); return obj; }
 
+// The control loop's lines, spelled out by the compiler once per axis
+static constexpr odrive_ascii::Line input_torque[2] = {
+    ODRIVE_ASCII_WRITE(0, AXIS__CONTROLLER__INPUT_TORQUE), ODRIVE_ASCII_WRITE(1, AXIS__CONTROLLER__INPUT_TORQUE)};
+static constexpr odrive_ascii::Line pos_estimate[2] = {
+    ODRIVE_ASCII_READ(0, AXIS__ENCODER__POS_ESTIMATE), ODRIVE_ASCII_READ(1, AXIS__ENCODER__POS_ESTIMATE)};
+static constexpr odrive_ascii::Line vel_estimate[2] = {
+    ODRIVE_ASCII_READ(0, AXIS__ENCODER__VEL_ESTIMATE), ODRIVE_ASCII_READ(1, AXIS__ENCODER__VEL_ESTIMATE)};
+
+static inline int axis_index(int motor_number) { return motor_number ? 1 : 0; }
+
 ODriveArduino::ODriveArduino(Stream& serial)
     : serial_(serial) {}
 
+// "<command> <axis>" and the values, space separated, as one write
+HOT_CODE void ODriveArduino::sendShort(char command, int motor_number, const float* values, uint8_t count) {
+    char line[4 + 3*(odrive_ascii::max_float_length + 1)];
+    size_t n = 0;
+    line[n++] = command;
+    line[n++] = ' ';
+    line[n++] = char('0' + axis_index(motor_number));
+    for (uint8_t i = 0; i < count; ++i) {
+        line[n++] = ' ';
+        n += odrive_ascii::formatFloat(line + n, values[i]);
+    }
+    line[n++] = '\n';
+    serial_.write((const uint8_t*)line, n);
+}
+
 void ODriveArduino::SetPosition(int motor_number, float position) {
     SetPosition(motor_number, position, 0.0f, 0.0f);
 }
@@ -17,20 +44,41 @@ void ODriveArduino::SetPosition(int motor_number, float position, float velocity
     SetPosition(motor_number, position, velocity_feedforward, 0.0f);
 }
 
-void ODriveArduino::SetPosition(int motor_number, float position, float velocity_feedforward, float current_feedforward) {
-    serial_ << "p " << motor_number  << " " << position << " " << velocity_feedforward << " " << current_feedforward << "\n";
+HOT_CODE void ODriveArduino::SetPosition(int motor_number, float position, float velocity_feedforward, float current_feedforward) {
+    const float values[3] = {position, velocity_feedforward, current_feedforward};
+    sendShort('p', motor_number, values, 3);
 }
 
 void ODriveArduino::SetVelocity(int motor_number, float velocity) {
     SetVelocity(motor_number, velocity, 0.0f);
 }
 
-void ODriveArduino::SetVelocity(int motor_number, float velocity, float current_feedforward) {
-    serial_ << "v " << motor_number  << " " << velocity << " " << current_feedforward << "\n";
+HOT_CODE void ODriveArduino::SetVelocity(int motor_number, float velocity, float current_feedforward) {
+    const float values[2] = {velocity, current_feedforward};
+    sendShort('v', motor_number, values, 2);
+}
+
+HOT_CODE void ODriveArduino::SetCurrent(int motor_number, float current) {
+    sendShort('c', motor_number, &current, 1);
 }
 
-void ODriveArduino::SetCurrent(int motor_number, float current) {
-    serial_ << "c " << motor_number << " " << current << "\n";
+HOT_CODE void ODriveArduino::SetTorque(int motor_number, float torque) {
+    char line[sizeof(odrive_ascii::Line::text) + odrive_ascii::max_float_length + 1];
+    size_t n = input_torque[axis_index(motor_number)].copy(line);
+    n += odrive_ascii::formatFloat(line + n, torque);
+    line[n++] = '\n';
+    serial_.write((const uint8_t*)line, n);
+}
+
+HOT_CODE void ODriveArduino::SetTorques(float torque0, float torque1) {
+    char lines[2*(sizeof(odrive_ascii::Line::text) + odrive_ascii::max_float_length + 1)];
+    size_t n = input_torque[0].copy(lines);
+    n += odrive_ascii::formatFloat(lines + n, torque0);
+    lines[n++] = '\n';
+    n += input_torque[1].copy(lines + n);
+    n += odrive_ascii::formatFloat(lines + n, torque1);
+    lines[n++] = '\n';
+    serial_.write((const uint8_t*)lines, n);
 }
 
 void ODriveArduino::TrapezoidalMove(int motor_number, float position) {
@@ -38,25 +86,144 @@ void ODriveArduino::TrapezoidalMove(int motor_number, float position) {
 }
 
 float ODriveArduino::readFloat() {
-    return readString().toFloat();
+    float value = 0.0f;
+    scanReply(readLine(), value);
+    return value;
 }
 
 float ODriveArduino::GetVelocity(int motor_number) {
-	serial_<< "r axis" << motor_number << ".encoder.vel_estimate\n";
-	return ODriveArduino::readFloat();
+    send(vel_estimate[axis_index(motor_number)]);
+    return ODriveArduino::readFloat();
 }
 
 float ODriveArduino::GetPosition(int motor_number) {
-    serial_ << "r axis" << motor_number << ".encoder.pos_estimate\n";
+    send(pos_estimate[axis_index(motor_number)]);
     return ODriveArduino::readFloat();
 }
 
+bool ODriveArduino::GetFeedback(int motor_number, float& position, float& velocity) {
+    serial_ << "f " << motor_number << "\n";
+    const char* line = readLine();
+    if (!line)
+        return false;
+    if (!scanFloat(line, position) || !scanFloat(line, velocity)) {
+        status_ = READ_PARSE_ERROR;
+        ++parse_errors_;
+        return false;
+    }
+    return true;
+}
+
+HOT_CODE bool ODriveArduino::GetFeedback(float position[2], float velocity[2]) {
+    // both queries go out before the first reply is read
+    serial_ << "f 0\nf 1\n";
+    bool ok = true;
+    for (int axis = 0; axis < 2; ++axis) {
+        const char* line = readLine();
+        if (!line) {
+            ok = false;
+            continue;
+        }
+        if (!scanFloat(line, position[axis]) || !scanFloat(line, velocity[axis])) {
+            status_ = READ_PARSE_ERROR;
+            ++parse_errors_;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
 int32_t ODriveArduino::readInt() {
-    return readString().toInt();
+    return readlong();
+}
+
+HOT_CODE int64_t ODriveArduino::readlong() {
+    int64_t value = 0;
+    const char* line = readLine();
+    if (line && !scanInt(line, value)) {
+        status_ = READ_PARSE_ERROR;
+        ++parse_errors_;
+        value = 0;
+    }
+    return value;
+}
+
+HOT_CODE void ODriveArduino::send(const odrive_ascii::Line& line) {
+    serial_.write((const uint8_t*)line.text, line.length);
+}
+
+HOT_CODE int64_t ODriveArduino::readProperty(const odrive_ascii::Line& query) {
+    send(query);
+    return readlong();
 }
 
-int64_t ODriveArduino::readlong() {
-    return readString().toInt();
+HOT_CODE int64_t ODriveArduino::readProperty(int axis, const char* property) {
+    if (axis < 0)
+        serial_ << "r " << property << "\n";
+    else
+        serial_ << "r axis" << axis << "." << property << "\n";
+    return readlong();
+}
+
+float ODriveArduino::readFloatProperty(int axis, const char* property) {
+    if (axis < 0)
+        serial_ << "r " << property << "\n";
+    else
+        serial_ << "r axis" << axis << "." << property << "\n";
+    return readFloat();
+}
+
+bool ODriveArduino::readFloatProperties(const int8_t* axes, const char* const* properties, uint8_t count,
+                                        float* values) {
+    if (count > max_pending)
+        return false;
+    // blocking reads must not consume replies that belong to pipelined queries
+    if (pending_count_ && !waitPending(reply_timeout_us_))
+        dropPending();
+    for (uint8_t i = 0; i < count; ++i) {
+        if (axes[i] < 0)
+            serial_ << "r " << properties[i] << "\n";
+        else
+            serial_ << "r axis" << (int)axes[i] << "." << properties[i] << "\n";
+    }
+    bool ok = true;
+    for (uint8_t i = 0; i < count; ++i) {
+        if (!scanReply(readLine(), values[i])) {
+            values[i] = NAN;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void ODriveArduino::writeProperty(int axis, const char* property, float value) {
+    if (axis < 0)
+        serial_ << "w " << property << " " << value << "\n";
+    else
+        serial_ << "w axis" << axis << "." << property << " " << value << "\n";
+}
+
+void ODriveArduino::writeIntProperty(int axis, const char* property, int32_t value) {
+    if (axis < 0)
+        serial_ << "w " << property << " " << value << "\n";
+    else
+        serial_ << "w axis" << axis << "." << property << " " << value << "\n";
+}
+
+COLD_CODE bool ODriveArduino::writeConfig(int axis, const char* property, float value) {
+    float current = readFloatProperty(axis, property);
+    if (status_ == READ_OK && fabsf(current - value) <= 1e-4f * fmaxf(1.0f, fabsf(value)))
+        return false;
+    writeProperty(axis, property, value);
+    return true;
+}
+
+COLD_CODE bool ODriveArduino::writeIntConfig(int axis, const char* property, int32_t value) {
+    int64_t current = readProperty(axis, property);
+    if (status_ == READ_OK && current == value)
+        return false;
+    writeIntProperty(axis, property, value);
+    return true;
 }
 
 bool ODriveArduino::run_state(int axis, int requested_state, bool wait_for_idle, float timeout) {
@@ -72,20 +239,256 @@ bool ODriveArduino::run_state(int axis, int requested_state, bool wait_for_idle,
     return timeout_ctr > 0;
 }
 
-String ODriveArduino::readString() {
-    String str = "";
+bool ODriveArduino::RequestPosition(int motor_number) {
+    if (!queueRequest(motor_number ? ODriveFeedback::POS1 : ODriveFeedback::POS0))
+        return false;
+    send(pos_estimate[axis_index(motor_number)]);
+    return true;
+}
+
+bool ODriveArduino::RequestVelocity(int motor_number) {
+    if (!queueRequest(motor_number ? ODriveFeedback::VEL1 : ODriveFeedback::VEL0))
+        return false;
+    send(vel_estimate[axis_index(motor_number)]);
+    return true;
+}
+
+HOT_CODE bool ODriveArduino::RequestFeedback(int motor_number) {
+    if (!queueRequest(FEEDBACK_REQUEST + (motor_number ? 1 : 0)))
+        return false;
+    serial_ << "f " << motor_number << "\n";
+    return true;
+}
+
+HOT_CODE bool ODriveArduino::queueRequest(uint8_t request) {
+    if (pending_count_ == max_pending)
+        return false;
+    if (pending_count_ == 0) {
+        pending_since_us_ = micros();
+        line_length_ = 0;
+    }
+    pending_[(pending_head_ + pending_count_) % max_pending] = request;
+    ++pending_count_;
+    return true;
+}
+
+HOT_CODE int ODriveArduino::poll() {
+    int completed = 0;
+    while (pending_count_ && serial_.available()) {
+        char c = serial_.read();
+        if (c != '\n') {
+            if (line_length_ < sizeof(line_) - 1)
+                line_[line_length_++] = c;
+            else
+                line_overflow_ = true;
+            continue;
+        }
+        bool overflow = line_overflow_;
+        line_overflow_ = false;
+        line_[line_length_] = '\0';
+        line_length_ = 0;
+
+        uint8_t request = pending_[pending_head_];
+        pending_head_ = (pending_head_ + 1) % max_pending;
+        --pending_count_;
+        pending_since_us_ = micros();
+
+        if (overflow) {
+            ++parse_errors_;
+            continue;
+        }
+        storeReply(request, line_, pending_since_us_);
+        ++completed;
+    }
+
+    // A lost reply would shift every later one onto the wrong field, so give up on the whole batch
+    if (pending_count_ && micros() - pending_since_us_ >= reply_timeout_us_) {
+        reply_timeouts_ += pending_count_;
+        dropPending();
+    }
+    return completed;
+}
+
+HOT_CODE void ODriveArduino::storeReply(uint8_t request, const char* line, uint32_t stamp_us) {
+    float value;
+    if (request < FEEDBACK_REQUEST) {
+        if (!scanFloat(line, value)) {
+            ++parse_errors_;
+            return;
+        }
+        feedback_.value[request] = value;
+        feedback_.stamp_us[request] = stamp_us;
+        feedback_.valid[request] = true;
+        return;
+    }
+
+    int axis = request - FEEDBACK_REQUEST;
+    uint8_t fields[2] = {
+        uint8_t(axis ? ODriveFeedback::POS1 : ODriveFeedback::POS0),
+        uint8_t(axis ? ODriveFeedback::VEL1 : ODriveFeedback::VEL0)
+    };
+    for (uint8_t field : fields) {
+        if (!scanFloat(line, value)) {
+            ++parse_errors_;
+            return;
+        }
+        feedback_.value[field] = value;
+        feedback_.stamp_us[field] = stamp_us;
+        feedback_.valid[field] = true;
+    }
+}
+
+HOT_CODE bool ODriveArduino::waitPending(uint32_t timeout_us) {
+    uint32_t start = micros();
+    while (pending_count_) {
+        poll();
+        if (micros() - start >= timeout_us)
+            return false;
+    }
+    return true;
+}
+
+HOT_CODE void ODriveArduino::dropPending() {
+    pending_count_ = 0;
+    line_length_ = 0;
+    line_overflow_ = false;
+    while (serial_.available()) serial_.read();
+}
+
+HOT_CODE const char* ODriveArduino::readLine() {
+    // blocking reads must not consume replies that belong to pipelined queries
+    if (pending_count_ && !waitPending(reply_timeout_us_))
+        dropPending();
+
     static const unsigned long timeout = 1000;
     unsigned long timeout_start = millis();
+    size_t length = 0;
+    bool overflow = false;
     for (;;) {
         while (!serial_.available()) {
             if (millis() - timeout_start >= timeout) {
-                return str;
+                status_ = READ_TIMEOUT;
+                return nullptr;
             }
         }
         char c = serial_.read();
         if (c == '\n')
             break;
-        str += c;
+        if (length < sizeof(line_) - 1)
+            line_[length++] = c;
+        else
+            overflow = true;
+    }
+    line_[length] = '\0';
+
+    if (overflow) {
+        status_ = READ_OVERFLOW;
+        ++parse_errors_;
+        return nullptr;
+    }
+    status_ = READ_OK;
+    return line_;
+}
+
+HOT_CODE bool ODriveArduino::scanReply(const char* line, float& value) {
+    if (!line)
+        return false;
+    if (!scanFloat(line, value)) {
+        status_ = READ_PARSE_ERROR;
+        ++parse_errors_;
+        value = 0.0f;
+        return false;
     }
-    return str;
+    return true;
+}
+
+static const float pow10_table[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+    1e11f, 1e12f, 1e13f, 1e14f, 1e15f, 1e16f, 1e17f, 1e18f, 1e19f, 1e20f
+};
+
+// Accepts [ws][+-]digits[.digits][e[+-]digits] as printed by the ODrive, plus "nan"/"inf"
+HOT_CODE bool ODriveArduino::scanFloat(const char*& p, float& value) {
+    const char* s = p;
+    while (*s == ' ' || *s == '\t' || *s == '\r') ++s;
+
+    bool negative = false;
+    if (*s == '-' || *s == '+') negative = (*s++ == '-');
+
+    if ((s[0] | 0x20) == 'n' && (s[1] | 0x20) == 'a' && (s[2] | 0x20) == 'n') {
+        value = NAN;
+        p = s + 3;
+        return true;
+    }
+    if ((s[0] | 0x20) == 'i' && (s[1] | 0x20) == 'n' && (s[2] | 0x20) == 'f') {
+        value = negative ? -INFINITY : INFINITY;
+        p = s + 3;
+        return true;
+    }
+
+    // up to 9 significant digits fit in a uint32_t, the rest only shift the exponent
+    uint32_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+    for (; *s >= '0' && *s <= '9'; ++s, any = true) {
+        if (digits < 9) {
+            mantissa = mantissa * 10 + (*s - '0');
+            if (mantissa) ++digits;
+        } else {
+            ++exponent;
+        }
+    }
+    if (*s == '.') {
+        ++s;
+        for (; *s >= '0' && *s <= '9'; ++s, any = true) {
+            if (digits < 9) {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa) ++digits;
+                --exponent;
+            }
+        }
+    }
+    if (!any)
+        return false;
+
+    if ((*s | 0x20) == 'e') {
+        const char* e = s + 1;
+        bool exp_negative = false;
+        if (*e == '-' || *e == '+') exp_negative = (*e++ == '-');
+        if (*e >= '0' && *e <= '9') {
+            int exp_value = 0;
+            for (; *e >= '0' && *e <= '9'; ++e)
+                if (exp_value < 100) exp_value = exp_value * 10 + (*e - '0');
+            exponent += exp_negative ? -exp_value : exp_value;
+            s = e;
+        }
+    }
+
+    float result = mantissa;
+    while (exponent > 20)  { result *= 1e20f; exponent -= 20; }
+    while (exponent < -20) { result /= 1e20f; exponent += 20; }
+    result = exponent >= 0 ? result * pow10_table[exponent] : result / pow10_table[-exponent];
+
+    value = negative ? -result : result;
+    p = s;
+    return true;
+}
+
+HOT_CODE bool ODriveArduino::scanInt(const char*& p, int64_t& value) {
+    const char* s = p;
+    while (*s == ' ' || *s == '\t' || *s == '\r') ++s;
+
+    bool negative = false;
+    if (*s == '-' || *s == '+') negative = (*s++ == '-');
+    if (*s < '0' || *s > '9')
+        return false;
+
+    uint64_t magnitude = 0;
+    for (; *s >= '0' && *s <= '9'; ++s)
+        magnitude = magnitude * 10 + (*s - '0');
+
+    value = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+    p = s;
+    return true;
 }
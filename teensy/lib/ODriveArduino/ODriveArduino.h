@@ -5,8 +5,25 @@
 #include "Arduino.h"
 #include "ODriveEnums.h"
 
+namespace odrive_ascii { struct Line; }
+
+// Latest values delivered by the pipelined queries, stamped when each reply was parsed
+struct ODriveFeedback {
+    enum Field : uint8_t { POS0, POS1, VEL0, VEL1, NUM_FIELDS };
+
+    float value[NUM_FIELDS] = {};
+    uint32_t stamp_us[NUM_FIELDS] = {};
+    bool valid[NUM_FIELDS] = {};
+
+    bool stale(Field field, uint32_t now_us, uint32_t max_age_us) const {
+        return !valid[field] || (now_us - stamp_us[field]) > max_age_us;
+    }
+};
+
 class ODriveArduino {
 public:
+    enum ReadStatus : uint8_t { READ_OK, READ_TIMEOUT, READ_PARSE_ERROR, READ_OVERFLOW };
+
     ODriveArduino(Stream& serial);
 
     // Commands
@@ -16,21 +33,85 @@ public:
     void SetVelocity(int motor_number, float velocity);
     void SetVelocity(int motor_number, float velocity, float current_feedforward);
     void SetCurrent(int motor_number, float current);
+    void SetTorque(int motor_number, float torque);
+    // Both axes' input_torque as one write to the serial port
+    void SetTorques(float torque0, float torque1);
     void TrapezoidalMove(int motor_number, float position);
     // Getters
     float GetVelocity(int motor_number);
     float GetPosition(int motor_number);
-    // General params
+    // Position and velocity in one round trip ("f <axis>")
+    bool GetFeedback(int motor_number, float& position, float& velocity);
+    bool GetFeedback(float position[2], float velocity[2]);
+    // General params (0 on failure, see lastStatus())
     float readFloat();
     int32_t readInt();
     int64_t readlong();
+    // "r axis<axis>.<property>", or "r <property>" for axis < 0
+    int64_t readProperty(int axis, const char* property);
+    // A query spelled out at compile time (ODRIVE_ASCII_READ in ODriveAscii.h), one write
+    int64_t readProperty(const odrive_ascii::Line& query);
+    // A whole line, e.g. an ODRIVE_ASCII_READ query, in one write
+    void send(const odrive_ascii::Line& line);
+    float readFloatProperty(int axis, const char* property);
+    // Up to max_pending "r" queries in one go, replies collected in request order; a
+    // value that did not come back is NAN and makes the result false
+    bool readFloatProperties(const int8_t* axes, const char* const* properties, uint8_t count, float* values);
+    // Unconditional "w", no reply
+    void writeProperty(int axis, const char* property, float value);
+    void writeIntProperty(int axis, const char* property, int32_t value);
+    // Configuration write that reads first and skips the "w" when the ODrive
+    // already holds value (to the 4 decimals sent); true if it wrote
+    bool writeConfig(int axis, const char* property, float value);
+    // The same for integer, enum and bool properties, sent without a decimal point
+    bool writeIntConfig(int axis, const char* property, int32_t value);
+    ReadStatus lastStatus() const { return status_; }
+    uint32_t parseErrors() const { return parse_errors_; }
+
+    // Allocation-free scanners, advance p past the parsed number
+    static bool scanFloat(const char*& p, float& value);
+    static bool scanInt(const char*& p, int64_t& value);
 
     // State helper
     bool run_state(int axis, int requested_state, bool wait_for_idle, float timeout = 10.0f);
+
+    // Pipelined reads: Request* writes the query and returns, poll() parses replies
+    // from the RX buffer without blocking. Replies arrive in request order.
+    bool RequestPosition(int motor_number);
+    bool RequestVelocity(int motor_number);
+    bool RequestFeedback(int motor_number);
+    int poll();
+    bool waitPending(uint32_t timeout_us);
+    uint8_t pending() const { return pending_count_; }
+    const ODriveFeedback& feedback() const { return feedback_; }
+    uint32_t replyTimeouts() const { return reply_timeouts_; }
+    void setReplyTimeout(uint32_t timeout_us) { reply_timeout_us_ = timeout_us; }
+
+    static constexpr uint8_t max_pending = 8;
 private:
-    String readString();
+    void sendShort(char command, int motor_number, const float* values, uint8_t count);
+    const char* readLine();
+    bool scanReply(const char* line, float& value);
+    // Pending entries are a single Field, or FEEDBACK_REQUEST + axis for a position/velocity pair
+    static constexpr uint8_t FEEDBACK_REQUEST = ODriveFeedback::NUM_FIELDS;
+    bool queueRequest(uint8_t request);
+    void storeReply(uint8_t request, const char* line, uint32_t stamp_us);
+    void dropPending();
 
     Stream& serial_;
+
+    ODriveFeedback feedback_;
+    uint8_t pending_[max_pending];
+    uint32_t pending_since_us_ = 0;
+    uint8_t pending_head_ = 0;
+    uint8_t pending_count_ = 0;
+    uint32_t reply_timeout_us_ = 5000;
+    uint32_t reply_timeouts_ = 0;
+    uint32_t parse_errors_ = 0;
+    ReadStatus status_ = READ_OK;
+    char line_[48];
+    uint8_t line_length_ = 0;
+    bool line_overflow_ = false;
 };
 
 #endif //ODriveArduino_h
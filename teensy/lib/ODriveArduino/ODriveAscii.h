@@ -0,0 +1,146 @@
+#ifndef ODriveAscii_h
+#define ODriveAscii_h
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* The ASCII protocol's command lines spelled out at compile time, and a
+* float formatter for their arguments, so a setpoint or a poll is built in
+* one buffer and goes out in one write instead of a Print call per piece.
+*
+* Endpoints are named the way odrive_endpoints.h names them, and
+* ODRIVE_ASCII_WRITE/READ turn the name into the line's property path:
+* "AXIS__" becomes "axis<n>.", every "__" a dot, the rest lower case.
+*
+*     constexpr odrive_ascii::Line torque0 = ODRIVE_ASCII_WRITE(0, AXIS__CONTROLLER__INPUT_TORQUE);
+*     char line[64];
+*     size_t n = torque0.copy(line);                  // "w axis0.controller.input_torque "
+*     n += odrive_ascii::formatFloat(line + n, torque);
+*     line[n++] = '\n';
+*
+* The names are not looked up in odrive_endpoints.h: that table is
+* generated from an older firmware than the ASCII path talks to and lacks
+* e.g. input_torque and controller.error.
+*/
+namespace odrive_ascii {
+
+// A command line or its fixed prefix
+struct Line {
+    char text[48];
+    uint8_t length;
+
+    size_t copy(char* out) const {
+        memcpy(out, text, length);
+        return length;
+    }
+};
+
+constexpr char lower(char c) { return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c; }
+
+constexpr bool isAxisName(const char* name) {
+    return name[0] == 'A' && name[1] == 'X' && name[2] == 'I' && name[3] == 'S' && name[4] == '_' && name[5] == '_';
+}
+
+// "<verb> [axis<axis>.]<path>" and end (0 for none) for the endpoint's enumerator name
+template<size_t N>
+constexpr Line line(char verb, int axis, const char (&name)[N], char end) {
+    static_assert(N + 9 <= sizeof(Line::text), "endpoint name too long for a Line");
+    Line l{};
+    uint8_t n = 0;
+    l.text[n++] = verb;
+    l.text[n++] = ' ';
+    size_t i = 0;
+    if (N > 6 && isAxisName(name)) {
+        l.text[n++] = 'a';
+        l.text[n++] = 'x';
+        l.text[n++] = 'i';
+        l.text[n++] = 's';
+        l.text[n++] = char('0' + axis);
+        l.text[n++] = '.';
+        i = 6;
+    }
+    for (; i + 1 < N; ++i) {
+        if (name[i] == '_' && name[i + 1] == '_') {
+            l.text[n++] = '.';
+            ++i;
+        } else {
+            l.text[n++] = lower(name[i]);
+        }
+    }
+    if (end) l.text[n++] = end;
+    l.length = n;
+    return l;
+}
+
+static constexpr size_t max_float_length = 16; // "-4294967040.0000"
+
+// value with 4 decimals, as Print::print(value, 4) writes it ("nan", "inf" and
+// "ovf" included), into out; the characters written, at most max_float_length
+inline size_t formatFloat(char* out, float value) {
+    if (isnan(value)) {
+        memcpy(out, "nan", 3);
+        return 3;
+    }
+    if (isinf(value)) {
+        memcpy(out, "inf", 3);
+        return 3;
+    }
+    if (value > 4294967040.0f || value < -4294967040.0f) {
+        memcpy(out, "ovf", 3);
+        return 3;
+    }
+    char* p = out;
+    double v = value;
+    if (v < 0.0) {
+        *p++ = '-';
+        v = -v;
+    }
+    uint32_t whole = (uint32_t)v;
+    uint32_t frac = (uint32_t)((v - whole) * 10000.0 + 0.5);
+    if (frac >= 10000) {
+        frac -= 10000;
+        ++whole;
+    }
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = char('0' + whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (count) *p++ = digits[--count];
+    *p++ = '.';
+    for (int i = 3; i >= 0; --i) {
+        p[i] = char('0' + frac % 10);
+        frac /= 10;
+    }
+    return p + 4 - out;
+}
+
+// An integer, e.g. "v <axis>"'s axis or a requested_state
+inline size_t formatInt(char* out, int32_t value) {
+    char* p = out;
+    uint32_t v = (uint32_t)value;
+    if (value < 0) {
+        *p++ = '-';
+        v = 0u - v;
+    }
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = char('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (count) *p++ = digits[--count];
+    return p - out;
+}
+
+} // namespace odrive_ascii
+
+// "w [axis<axis>.]<path> ", for the value to follow
+#define ODRIVE_ASCII_WRITE(axis, endpoint) (::odrive_ascii::line('w', (axis), #endpoint, ' '))
+// "r [axis<axis>.]<path>\n", a whole query
+#define ODRIVE_ASCII_READ(axis, endpoint) (::odrive_ascii::line('r', (axis), #endpoint, '\n'))
+
+#endif //ODriveAscii_h
@@ -0,0 +1,228 @@
+
+#include "Arduino.h"
+#include "ODriveBinary.h"
+#include <Placement.h>
+
+static constexpr uint8_t  PACKET_PREFIX = 0xAA;
+static constexpr uint8_t  CRC8_POLYNOMIAL = 0x37;
+static constexpr uint8_t  CRC8_INIT = 0x42;
+static constexpr uint16_t CRC16_POLYNOMIAL = 0x3d65;
+static constexpr uint16_t CRC16_INIT = 0x1337;
+static constexpr uint16_t ACK_FLAG = 0x8000;
+
+ODriveBinary::ODriveBinary(Stream& serial, uint32_t timeout_us)
+    : serial_(serial), timeout_us_(timeout_us) {}
+
+void ODriveBinary::SetPosition(int motor_number, float position) {
+    write_axis_property<odrive::AXIS__CONTROLLER__POS_SETPOINT>(motor_number, position);
+}
+
+void ODriveBinary::SetVelocity(int motor_number, float velocity) {
+    write_axis_property<odrive::AXIS__CONTROLLER__VEL_SETPOINT>(motor_number, velocity);
+}
+
+HOT_CODE void ODriveBinary::SetCurrent(int motor_number, float current) {
+    write_axis_property<odrive::AXIS__CONTROLLER__CURRENT_SETPOINT>(motor_number, current);
+}
+
+// The endpoint table predates input_torque, so torque goes out as a current setpoint
+HOT_CODE void ODriveBinary::SetTorque(int motor_number, float torque) {
+    SetCurrent(motor_number, torque / torque_constant_);
+}
+
+HOT_CODE void ODriveBinary::SetTorques(float torque0, float torque1) {
+    static const uint16_t endpoints[2] = {odrive::AXIS__CONTROLLER__CURRENT_SETPOINT,
+                                          odrive::AXIS__CONTROLLER__CURRENT_SETPOINT + odrive::per_axis_offset};
+    float currents[2] = {torque0 / torque_constant_, torque1 / torque_constant_};
+    write_floats(endpoints, 2, currents);
+}
+
+float ODriveBinary::GetVelocity(int motor_number) {
+    float vel = 0.0f;
+    read_axis_property<odrive::AXIS__ENCODER__PLL_VEL>(motor_number, &vel);
+    return vel;
+}
+
+float ODriveBinary::GetPosition(int motor_number) {
+    float pos = 0.0f;
+    read_axis_property<odrive::AXIS__ENCODER__POS_ESTIMATE>(motor_number, &pos);
+    return pos;
+}
+
+bool ODriveBinary::run_state(int axis, int requested_state, bool wait_for_idle, float timeout) {
+    int timeout_ctr = (int)(timeout * 10.0f);
+    write_axis_property<odrive::AXIS__REQUESTED_STATE>(axis, requested_state, true);
+    if (wait_for_idle) {
+        uint8_t state = AXIS_STATE_UNDEFINED;
+        do {
+            delay(100);
+            read_axis_property<odrive::AXIS__CURRENT_STATE>(axis, &state);
+        } while (state != AXIS_STATE_IDLE && --timeout_ctr > 0);
+    }
+
+    return timeout_ctr > 0;
+}
+
+HOT_CODE uint16_t ODriveBinary::nextSeq() {
+    // seq 0 is avoided so a stale zeroed reply can never match
+    if (++seq_ & ACK_FLAG || seq_ == 0) seq_ = 1;
+    return seq_;
+}
+
+size_t ODriveBinary::buildFrame(uint8_t* out, uint16_t seq, uint16_t endpoint, const uint8_t* tx, size_t tx_length,
+                                uint16_t reply_length) {
+    uint8_t* payload = out + 3;
+    size_t n = 0;
+    memcpy(payload + n, &seq, 2);          n += 2;
+    memcpy(payload + n, &endpoint, 2);     n += 2;
+    memcpy(payload + n, &reply_length, 2); n += 2;
+    if (tx_length) {
+        memcpy(payload + n, tx, tx_length);
+        n += tx_length;
+    }
+    memcpy(payload + n, &odrive::json_crc, 2); n += 2;
+
+    out[0] = PACKET_PREFIX;
+    out[1] = n;
+    out[2] = crc8(CRC8_INIT, out, 2);
+    uint16_t crc = crc16(CRC16_INIT, payload, n);
+    payload[n++] = crc >> 8;
+    payload[n++] = crc & 0xff;
+    return 3 + n;
+}
+
+bool ODriveBinary::exchange(uint16_t endpoint_id, const uint8_t* tx, size_t tx_length,
+                            uint8_t* rx, size_t rx_length, bool ack) {
+    if (tx_length > max_payload || rx_length > max_payload)
+        return false;
+
+    uint16_t seq = nextSeq();
+    uint16_t endpoint = endpoint_id | (ack ? ACK_FLAG : 0);
+    uint8_t frame[max_frame];
+    size_t length = buildFrame(frame, seq, endpoint, tx, tx_length, ack ? rx_length : 0);
+
+    if (ack) {
+        // drop anything left over from an earlier timed-out reply
+        while (serial_.available()) serial_.read();
+    }
+    serial_.write(frame, length);
+
+    if (!ack)
+        return true;
+    return readReply(seq | ACK_FLAG, rx, rx_length);
+}
+
+HOT_CODE bool ODriveBinary::read_floats(const uint16_t* endpoint_ids, uint8_t count, float* values) {
+    return request_floats(endpoint_ids, count) && collect_floats(values);
+}
+
+HOT_CODE bool ODriveBinary::request_floats(const uint16_t* endpoint_ids, uint8_t count) {
+    if (count > max_batch)
+        return false;
+    uint8_t frames[max_batch*(3 + 8 + 2)];
+    size_t length = 0;
+    for (uint8_t i = 0; i < count; ++i) {
+        batch_seqs_[i] = nextSeq();
+        length += buildFrame(frames + length, batch_seqs_[i], endpoint_ids[i] | ACK_FLAG, nullptr, 0, sizeof(float));
+    }
+
+    // an uncollected batch's replies are dropped with the rest
+    while (serial_.available()) serial_.read();
+    serial_.write(frames, length);
+    requested_ = count;
+    return true;
+}
+
+HOT_CODE bool ODriveBinary::collect_floats(float* values) {
+    // replies come back in request order; a missed one costs the rest of the batch its timeout
+    bool ok = requested_ > 0;
+    for (uint8_t i = 0; i < requested_; ++i) {
+        uint8_t rx[sizeof(float)];
+        if (readReply(batch_seqs_[i] | ACK_FLAG, rx, sizeof(rx)))
+            memcpy(&values[i], rx, sizeof(rx));
+        else
+            ok = false;
+    }
+    requested_ = 0;
+    return ok;
+}
+
+HOT_CODE bool ODriveBinary::write_floats(const uint16_t* endpoint_ids, uint8_t count, const float* values) {
+    if (count > max_batch)
+        return false;
+    uint8_t frames[max_batch*(3 + 8 + sizeof(float) + 2)];
+    size_t length = 0;
+    for (uint8_t i = 0; i < count; ++i) {
+        uint8_t tx[sizeof(float)];
+        memcpy(tx, &values[i], sizeof(tx));
+        length += buildFrame(frames + length, nextSeq(), endpoint_ids[i], tx, sizeof(tx), 0);
+    }
+    serial_.write(frames, length);
+    return true;
+}
+
+HOT_CODE int ODriveBinary::readByte(uint32_t start_us) {
+    while (!serial_.available()) {
+        if (micros() - start_us >= timeout_us_)
+            return -1;
+    }
+    return serial_.read();
+}
+
+HOT_CODE bool ODriveBinary::readReply(uint16_t seq, uint8_t* rx, size_t rx_length) {
+    uint32_t start = micros();
+    uint8_t header[3];
+    uint8_t payload[2 + max_payload + 2];
+    for (;;) {
+        int c;
+        do {
+            if ((c = readByte(start)) < 0) { ++timeouts_; return false; }
+        } while (c != PACKET_PREFIX);
+        header[0] = c;
+        if ((c = readByte(start)) < 0) { ++timeouts_; return false; }
+        header[1] = c;
+        if ((c = readByte(start)) < 0) { ++timeouts_; return false; }
+        header[2] = c;
+        if (header[2] != crc8(CRC8_INIT, header, 2) || header[1] > sizeof(payload) - 2) {
+            ++crc_errors_;
+            continue; // resync on the next prefix byte
+        }
+
+        size_t length = header[1] + 2;
+        for (size_t i = 0; i < length; ++i) {
+            if ((c = readByte(start)) < 0) { ++timeouts_; return false; }
+            payload[i] = c;
+        }
+        uint16_t crc = (payload[length - 2] << 8) | payload[length - 1];
+        if (crc != crc16(CRC16_INIT, payload, length - 2)) {
+            ++crc_errors_;
+            continue;
+        }
+
+        uint16_t reply_seq;
+        memcpy(&reply_seq, payload, 2);
+        if (reply_seq != seq || header[1] < 2 + rx_length)
+            continue; // reply to an older request
+        if (rx_length)
+            memcpy(rx, payload + 2, rx_length);
+        return true;
+    }
+}
+
+HOT_CODE uint8_t ODriveBinary::crc8(uint8_t crc, const uint8_t* data, size_t length) {
+    while (length--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 0x80) ? (crc << 1) ^ CRC8_POLYNOMIAL : (crc << 1);
+    }
+    return crc;
+}
+
+HOT_CODE uint16_t ODriveBinary::crc16(uint16_t crc, const uint8_t* data, size_t length) {
+    while (length--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 0x8000) ? (crc << 1) ^ CRC16_POLYNOMIAL : (crc << 1);
+    }
+    return crc;
+}
@@ -0,0 +1,122 @@
+#ifndef ODriveBinary_h
+#define ODriveBinary_h
+
+#include "Arduino.h"
+#include "ODriveEnums.h"
+#include <type_traits>
+#include <odrive_endpoints.h>
+
+/* ODrive native (binary) protocol over a UART stream.
+*
+* The ODrive accepts ASCII lines and native packets on the same UART, so this
+* can share Serial1 with ODriveArduino (e.g. ASCII for setup, binary in the loop).
+*
+* Frame layout:
+*   [0xAA][len][crc8]  [seq u16][endpoint u16 | ack][reply len u16][payload][json_crc u16]  [crc16 be]
+* Replies carry (seq | 0x8000) followed by the endpoint value.
+*
+* Endpoint ids come from odrive_endpoints.h, which matches a specific firmware
+* version (see json_crc). Regenerate it for the firmware on the robot.
+*/
+class ODriveBinary {
+public:
+    ODriveBinary(Stream& serial, uint32_t timeout_us = 2000);
+
+    // Commands (fire and forget, no reply is requested)
+    void SetPosition(int motor_number, float position);
+    void SetVelocity(int motor_number, float velocity);
+    void SetCurrent(int motor_number, float current);
+    void SetTorque(int motor_number, float torque);
+    // Both axes' setpoints in one serial write
+    void SetTorques(float torque0, float torque1);
+    void setTorqueConstant(float torque_constant) { torque_constant_ = torque_constant; }
+    // The current setpoint that stands for torque
+    float current(float torque) const { return torque / torque_constant_; }
+    // Getters
+    float GetVelocity(int motor_number);
+    float GetPosition(int motor_number);
+
+    // State helper
+    bool run_state(int axis, int requested_state, bool wait_for_idle, float timeout = 10.0f);
+
+    // Typed endpoint access, same shape as the I2C templates in odrive.h
+    template<int IPropertyId>
+    bool read_property(odrive::endpoint_type_t<IPropertyId>* value, uint16_t address = IPropertyId) {
+        uint8_t rx[sizeof(odrive::endpoint_type_t<IPropertyId>)];
+        if (!exchange(address, nullptr, 0, rx, sizeof(rx), true))
+            return false;
+        if (value)
+            memcpy(value, rx, sizeof(rx));
+        return true;
+    }
+
+    template<int IPropertyId>
+    bool write_property(odrive::endpoint_type_t<IPropertyId> value, uint16_t address = IPropertyId, bool ack = false) {
+        uint8_t tx[sizeof(odrive::endpoint_type_t<IPropertyId>)];
+        memcpy(tx, &value, sizeof(tx));
+        return exchange(address, tx, sizeof(tx), nullptr, 0, ack);
+    }
+
+    template<int IPropertyId,
+             typename = typename std::enable_if<std::is_void<odrive::endpoint_type_t<IPropertyId>>::value>::type>
+    bool trigger(uint16_t address = IPropertyId) {
+        return exchange(address, nullptr, 0, nullptr, 0, false);
+    }
+
+    template<int IPropertyId>
+    bool read_axis_property(uint8_t axis, odrive::endpoint_type_t<IPropertyId>* value) {
+        return read_property<IPropertyId>(value, IPropertyId + axis * odrive::per_axis_offset);
+    }
+
+    template<int IPropertyId>
+    bool write_axis_property(uint8_t axis, odrive::endpoint_type_t<IPropertyId> value, bool ack = false) {
+        return write_property<IPropertyId>(value, IPropertyId + axis * odrive::per_axis_offset, ack);
+    }
+
+    // Send one request frame and, if ack is set, wait for the matching reply.
+    bool exchange(uint16_t endpoint_id, const uint8_t* tx, size_t tx_length,
+                  uint8_t* rx, size_t rx_length, bool ack);
+
+    // Up to max_batch float endpoints in one go: the request frames leave in a
+    // single write and the replies are collected in order, so the lot costs one
+    // turnaround instead of one per endpoint. false if any reply was missed.
+    bool read_floats(const uint16_t* endpoint_ids, uint8_t count, float* values);
+    // read_floats() in two halves, so the replies can be on the wire while the
+    // caller does something else (another board's exchange): request_floats()
+    // writes the batch and returns, collect_floats() waits for its replies
+    bool request_floats(const uint16_t* endpoint_ids, uint8_t count);
+    bool collect_floats(float* values);
+    uint8_t requested() const { return requested_; }
+    // Up to max_batch float writes in a single serial write, no reply requested
+    bool write_floats(const uint16_t* endpoint_ids, uint8_t count, const float* values);
+
+    uint32_t crcErrors() const { return crc_errors_; }
+    uint32_t timeouts() const  { return timeouts_; }
+
+    static uint8_t crc8(uint8_t crc, const uint8_t* data, size_t length);
+    static uint16_t crc16(uint16_t crc, const uint8_t* data, size_t length);
+
+    static constexpr size_t max_payload = 32;
+    static constexpr uint8_t max_batch = 8;
+
+private:
+    static constexpr size_t max_frame = 3 + 8 + max_payload + 2;
+
+    uint16_t nextSeq();
+    // One request frame into out, returns its length
+    size_t buildFrame(uint8_t* out, uint16_t seq, uint16_t endpoint, const uint8_t* tx, size_t tx_length,
+                      uint16_t reply_length);
+    bool readReply(uint16_t seq, uint8_t* rx, size_t rx_length);
+    int readByte(uint32_t start_us);
+
+    Stream& serial_;
+    uint32_t timeout_us_;
+    uint16_t seq_ = 0;
+    float torque_constant_ = 1.0f;
+    uint32_t crc_errors_ = 0;
+    uint32_t timeouts_ = 0;
+    uint16_t batch_seqs_[max_batch];
+    uint8_t requested_ = 0;
+};
+
+#endif //ODriveBinary_h
@@ -0,0 +1,245 @@
+
+#include "Arduino.h"
+#include "ODriveCANDriver.h"
+#include <FlexCAN_T4.h>
+#include <atomic>
+
+// Callbacks run straight from the FIFO interrupt as long as events() is never called
+static FlexCAN_T4<CAN1, RX_SIZE_16, TX_SIZE_16> odrive_can;
+// One driver per board on the bus; written from loop() before the interrupt is on for it
+static ODriveCANDriver* can_drivers[ODriveCANDriver::max_boards] = {};
+static volatile uint8_t can_driver_count = 0;
+
+// Each driver keeps the frames of its own two nodes and ignores the rest
+static void onCanFrame(const CAN_message_t& msg) {
+    if (msg.flags.extended || msg.flags.remote)
+        return;
+    for (uint8_t i = 0; i < can_driver_count; ++i)
+        can_drivers[i]->receive(msg.id, msg.buf, msg.len);
+}
+
+ODriveCANDriver::ODriveCANDriver(uint8_t node0, uint8_t node1, uint32_t baud_rate, uint32_t max_age_us)
+    : node_id_{node0, node1}, baud_rate_(baud_rate), max_age_us_(max_age_us) {}
+
+// Off the interrupt's list; the bus stays up for the others
+ODriveCANDriver::~ODriveCANDriver() {
+    uint8_t count = can_driver_count;
+    for (uint8_t i = 0; i < count; ++i) {
+        if (can_drivers[i] != this)
+            continue;
+        noInterrupts();
+        can_drivers[i] = can_drivers[count - 1];
+        can_driver_count = count - 1;
+        interrupts();
+        return;
+    }
+}
+
+bool ODriveCANDriver::begin() {
+    uint8_t count = can_driver_count;
+    bool registered = false;
+    for (uint8_t i = 0; i < count; ++i)
+        registered = registered || can_drivers[i] == this;
+    if (!registered) {
+        if (count == max_boards)
+            return false;
+        can_drivers[count] = this;
+        can_driver_count = count + 1;
+    }
+    // the first board brings the bus up at its baud rate, the others join it
+    if (count == 0) {
+        odrive_can.begin();
+        odrive_can.setBaudRate(baud_rate_);
+        odrive_can.setMaxMB(16);
+        odrive_can.enableFIFO();
+        odrive_can.enableFIFOInterrupt();
+        odrive_can.onReceive(onCanFrame);
+    }
+
+    // both axes should be heard from within a few heartbeats
+    uint32_t start = millis();
+    uint32_t error, stamp;
+    uint8_t state;
+    while (millis() - start < 500) {
+        if (heartbeat(0, error, state, stamp) && heartbeat(1, error, state, stamp))
+            return true;
+    }
+    return false;
+}
+
+void ODriveCANDriver::requestFeedback() {
+    if (!electrical_)
+        return;
+    request(0, GET_IQ);
+    request(1, GET_IQ);
+    request(0, GET_VBUS_VOLTAGE);
+}
+
+bool ODriveCANDriver::readFeedback(float position[2], float velocity[2]) {
+    uint32_t now = micros();
+    bool ok = true;
+    for (int axis = 0; axis < 2; ++axis) {
+        uint32_t stamp;
+        float pos, vel;
+        if (!encoderEstimate(axis, pos, vel, stamp) || now - stamp > max_age_us_) {
+            // keep the caller's previous sample, as the UART drivers do on a timeout
+            ++stale_reads_;
+            ok = false;
+            continue;
+        }
+        position[axis] = pos;
+        velocity[axis] = vel;
+    }
+    return ok;
+}
+
+void ODriveCANDriver::setTorque(int axis, float torque) {
+    send(axis, SET_INPUT_TORQUE, &torque, sizeof(torque));
+}
+
+void ODriveCANDriver::setVelocity(int axis, float velocity, float torque_feedforward) {
+    float data[2] = {velocity, torque_feedforward};
+    send(axis, SET_INPUT_VEL, data, sizeof(data));
+}
+
+static int16_t milli(float value) {
+    float scaled = roundf(value * 1000.0f);
+    return scaled > 32767.0f ? 32767 : scaled < -32768.0f ? -32768 : (int16_t)scaled;
+}
+
+void ODriveCANDriver::setPosition(int axis, float position, float velocity_feedforward, float torque_feedforward) {
+    uint8_t data[8];
+    int16_t feedforward[2] = {milli(velocity_feedforward), milli(torque_feedforward)};
+    memcpy(data, &position, sizeof(position));
+    memcpy(data + 4, feedforward, sizeof(feedforward));
+    send(axis, SET_INPUT_POS, data, sizeof(data));
+}
+
+bool ODriveCANDriver::runState(int axis, int requested_state, bool wait_for_idle, float timeout) {
+    int timeout_ctr = (int)(timeout * 10.0f);
+    uint32_t state32 = requested_state;
+    if (!send(axis, SET_AXIS_REQUESTED_STATE, &state32, sizeof(state32)))
+        return false;
+    if (wait_for_idle) {
+        uint32_t error, stamp;
+        uint8_t state = AXIS_STATE_UNDEFINED;
+        // the first heartbeats may still report the state from before the request
+        delay(100);
+        do {
+            delay(100);
+            heartbeat(axis, error, state, stamp);
+        } while (state != AXIS_STATE_IDLE && --timeout_ctr > 0);
+    }
+    return timeout_ctr > 0;
+}
+
+int ODriveCANDriver::readState(int axis) {
+    uint32_t error, stamp;
+    uint8_t state;
+    return heartbeat(axis, error, state, stamp) ? state : -1;
+}
+
+bool ODriveCANDriver::readElectrical(float current[2], float& vbus) {
+    uint32_t now = micros();
+    uint32_t word[2], stamp;
+    bool ok = true;
+    for (int axis = 0; axis < 2; ++axis) {
+        if (readSlot(iq_[axis], word, stamp) && now - stamp <= max_age_us_)
+            memcpy(&current[axis], &word[1], 4);
+        else
+            ok = false;
+    }
+    if (readSlot(vbus_, word, stamp) && now - stamp <= max_age_us_)
+        memcpy(&vbus, &word[0], 4);
+    else
+        ok = false;
+    return ok;
+}
+
+bool ODriveCANDriver::encoderEstimate(int axis, float& position, float& velocity, uint32_t& stamp_us) const {
+    uint32_t word[2];
+    if (!readSlot(encoder_[axis], word, stamp_us))
+        return false;
+    memcpy(&position, &word[0], 4);
+    memcpy(&velocity, &word[1], 4);
+    return true;
+}
+
+bool ODriveCANDriver::heartbeat(int axis, uint32_t& axis_error, uint8_t& axis_state, uint32_t& stamp_us) const {
+    uint32_t word[2];
+    if (!readSlot(heartbeat_[axis], word, stamp_us))
+        return false;
+    axis_error = word[0];
+    axis_state = word[1] & 0xff;
+    return true;
+}
+
+bool ODriveCANDriver::send(int axis, uint8_t command, const void* data, uint8_t length) {
+    CAN_message_t msg;
+    msg.id = (node_id_[axis] << 5) | command;
+    msg.len = length;
+    memcpy(msg.buf, data, length);
+    if (odrive_can.write(msg) > 0)
+        return true;
+    ++send_failures_;
+    return false;
+}
+
+bool ODriveCANDriver::request(int axis, uint8_t command) {
+    CAN_message_t msg;
+    msg.id = (node_id_[axis] << 5) | command;
+    msg.len = 8;
+    msg.flags.remote = true;
+    if (odrive_can.write(msg) > 0)
+        return true;
+    ++send_failures_;
+    return false;
+}
+
+void ODriveCANDriver::receive(uint32_t id, const uint8_t* data, uint8_t length) {
+    int axis = axisOf(id >> 5);
+    if (axis < 0 || length != 8)
+        return;
+    ++frames_received_;
+    uint32_t now = micros();
+    switch (id & 0x1f) {
+        case GET_ENCODER_ESTIMATES: writeSlot(encoder_[axis], data, now); break;
+        case HEARTBEAT:             writeSlot(heartbeat_[axis], data, now); break;
+        case GET_IQ:                writeSlot(iq_[axis], data, now); break;
+        case GET_VBUS_VOLTAGE:      writeSlot(vbus_, data, now); break;
+        default: break;
+    }
+}
+
+int ODriveCANDriver::axisOf(uint8_t node_id) const {
+    if (node_id == node_id_[0]) return 0;
+    if (node_id == node_id_[1]) return 1;
+    return -1;
+}
+
+// Only the interrupt writes, so there is never more than one writer
+void ODriveCANDriver::writeSlot(Slot& slot, const uint8_t* data, uint32_t now_us) {
+    uint32_t word[2];
+    memcpy(word, data, 8);
+    slot.seq = slot.seq + 1;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    slot.word[0] = word[0];
+    slot.word[1] = word[1];
+    slot.stamp_us = now_us;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    slot.seq = slot.seq + 1;
+}
+
+bool ODriveCANDriver::readSlot(const Slot& slot, uint32_t word[2], uint32_t& stamp_us) {
+    uint32_t before, after;
+    do {
+        before = slot.seq;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        word[0] = slot.word[0];
+        word[1] = slot.word[1];
+        stamp_us = slot.stamp_us;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        after = slot.seq;
+    } while (before != after || (before & 1));
+    return before != 0;
+}
@@ -0,0 +1,114 @@
+#ifndef ODriveCANDriver_h
+#define ODriveCANDriver_h
+
+#include "Arduino.h"
+#include "MotorDriver.h"
+
+/* ODrive over CAN (CANSimple protocol) on the Teensy's FlexCAN1, pins 22/23.
+*
+* Each axis has its own node id and the arbitration id is (node_id << 5) | cmd.
+* The ODrive broadcasts Get_Encoder_Estimates and Heartbeat cyclically
+* (axisN.config.can.encoder_rate_ms / heartbeat_rate_ms). The receive interrupt
+* copies them into a per-axis latest-value slot, so readFeedback() never waits
+* on the bus. Commands are sent without waiting for a reply.
+*
+* The slots use a sequence counter: the interrupt makes it odd while it writes,
+* and the reader retries if the counter changed under it.
+*
+* Several boards share the one bus as one driver each, with node ids of
+* their own: the first begin() brings FlexCAN1 up at its baud rate, the rest
+* join it, and the interrupt hands every frame to each driver, which keeps
+* its own nodes'. Their commands and remote frames contend in arbitration,
+* the lower node ids first.
+*
+* Iq and the bus voltage are not broadcast on firmware 0.5: with
+* sampleElectrical(), requestFeedback() sends Get_Iq to both nodes and
+* Get_Vbus_Voltage to the first as remote frames, and their replies land in
+* slots of their own for readElectrical(), this step's or the next one's.
+*/
+class ODriveCANDriver final : public MotorDriver {
+public:
+    enum Command : uint8_t {
+        HEARTBEAT                = 0x001,
+        ESTOP                    = 0x002,
+        GET_MOTOR_ERROR          = 0x003,
+        GET_ENCODER_ERROR        = 0x004,
+        SET_AXIS_NODE_ID         = 0x006,
+        SET_AXIS_REQUESTED_STATE = 0x007,
+        GET_ENCODER_ESTIMATES    = 0x009,
+        SET_CONTROLLER_MODES     = 0x00B,
+        SET_INPUT_POS            = 0x00C,
+        SET_INPUT_VEL            = 0x00D,
+        SET_INPUT_TORQUE         = 0x00E,
+        GET_IQ                   = 0x014,
+        GET_VBUS_VOLTAGE         = 0x017,
+        CLEAR_ERRORS             = 0x018,
+    };
+
+    // Drivers on the bus, one per board
+    static constexpr uint8_t max_boards = 4;
+
+    // max_age_us: readFeedback() reports failure if an axis has not broadcast for this long
+    ODriveCANDriver(uint8_t node0 = 0, uint8_t node1 = 1, uint32_t baud_rate = 1000000,
+                    uint32_t max_age_us = 5000);
+    ~ODriveCANDriver();
+
+    bool begin() override;
+    // Only the Iq and vbus requests, with sampleElectrical(); the estimates are broadcast
+    void requestFeedback() override;
+    bool readFeedback(float position[2], float velocity[2]) override;
+    void setTorque(int axis, float torque) override;
+    void setVelocity(int axis, float velocity, float torque_feedforward) override;
+    // Set_Input_Pos carries the feed-forwards as int16 in 0.001 turns/s and 0.001 Nm
+    void setPosition(int axis, float position, float velocity_feedforward, float torque_feedforward) override;
+    bool runState(int axis, int requested_state, bool wait_for_idle, float timeout = 10.0f) override;
+    // From the last heartbeat, no bus traffic
+    int readState(int axis) override;
+    const char* name() const override { return "can"; }
+    bool sampleElectrical(bool on) override {
+        electrical_ = on;
+        return true;
+    }
+    // false if a reply is missing or older than max_age_us
+    bool readElectrical(float current[2], float& vbus) override;
+
+    // Latest broadcast values; false if nothing has arrived yet
+    bool encoderEstimate(int axis, float& position, float& velocity, uint32_t& stamp_us) const;
+    bool heartbeat(int axis, uint32_t& axis_error, uint8_t& axis_state, uint32_t& stamp_us) const;
+
+    bool send(int axis, uint8_t command, const void* data, uint8_t length);
+    // A remote frame asking the axis' node for command's reply
+    bool request(int axis, uint8_t command);
+
+    // Called from the CAN receive interrupt
+    void receive(uint32_t id, const uint8_t* data, uint8_t length);
+
+    uint32_t framesReceived() const { return frames_received_; }
+    uint32_t staleReads() const { return stale_reads_; }
+    uint32_t sendFailures() const { return send_failures_; }
+
+private:
+    struct Slot {
+        volatile uint32_t seq;
+        volatile uint32_t word[2];
+        volatile uint32_t stamp_us;
+    };
+
+    static void writeSlot(Slot& slot, const uint8_t* data, uint32_t now_us);
+    static bool readSlot(const Slot& slot, uint32_t word[2], uint32_t& stamp_us);
+    int axisOf(uint8_t node_id) const;
+
+    uint8_t node_id_[2];
+    uint32_t baud_rate_;
+    uint32_t max_age_us_;
+    Slot encoder_[2] = {};
+    Slot heartbeat_[2] = {};
+    Slot iq_[2] = {};      // Iq_Setpoint, Iq_Measured
+    Slot vbus_ = {};
+    bool electrical_ = false;
+    volatile uint32_t frames_received_ = 0;
+    uint32_t stale_reads_ = 0;
+    uint32_t send_failures_ = 0;
+};
+
+#endif //ODriveCANDriver_h
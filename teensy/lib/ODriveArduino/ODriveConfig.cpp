@@ -0,0 +1,106 @@
+#include "Arduino.h"
+#include "ODriveConfig.h"
+#include <Placement.h>
+
+COLD_CODE bool ODriveConfig::add(int8_t axis, const char* property, float value, bool integer) {
+    if (count_ >= max_entries)
+        return false;
+    Entry& e = entries_[count_++];
+    e.property = property;
+    e.value = value;
+    e.read = NAN;
+    e.axis = axis;
+    e.integer = integer;
+    e.state = UNCHECKED;
+    return true;
+}
+
+COLD_CODE bool ODriveConfig::matches(const Entry& e) {
+    if (isnan(e.read))
+        return false;
+    if (e.integer)
+        return lroundf(e.read) == lroundf(e.value);
+    return fabsf(e.read - e.value) <= 1e-4f * fmaxf(1.0f, fabsf(e.value));
+}
+
+COLD_CODE void ODriveConfig::readBack(ODriveArduino& odrive, State from, State matched, State differ) {
+    uint8_t index[batch];
+    int8_t axes[batch];
+    const char* properties[batch];
+    float values[batch];
+    uint8_t i = 0;
+    while (i < count_) {
+        uint8_t n = 0;
+        for (; i < count_ && n < batch; ++i) {
+            if (entries_[i].state != from) continue;
+            index[n] = i;
+            axes[n] = entries_[i].axis;
+            properties[n] = entries_[i].property;
+            ++n;
+        }
+        if (n == 0) break;
+        odrive.readFloatProperties(axes, properties, n, values);
+        for (uint8_t k = 0; k < n; ++k) {
+            Entry& e = entries_[index[k]];
+            e.read = values[k];
+            e.state = matches(e) ? matched : (isnan(e.read) ? UNREADABLE : differ);
+        }
+    }
+}
+
+COLD_CODE bool ODriveConfig::apply(ODriveArduino& odrive) {
+    for (uint8_t i = 0; i < count_; ++i)
+        entries_[i].state = UNCHECKED;
+    // UNCHECKED -> MATCHED, or WRITTEN for the ones to write
+    readBack(odrive, UNCHECKED, MATCHED, WRITTEN);
+    bool wrote = false;
+    for (uint8_t i = 0; i < count_; ++i) {
+        const Entry& e = entries_[i];
+        if (e.state != WRITTEN) continue;
+        if (e.integer)
+            odrive.writeIntProperty(e.axis, e.property, (int32_t)lroundf(e.value));
+        else
+            odrive.writeProperty(e.axis, e.property, e.value);
+        wrote = true;
+    }
+    // WRITTEN stays WRITTEN if it took, MISMATCHED if the ODrive kept another value
+    if (wrote)
+        readBack(odrive, WRITTEN, WRITTEN, MISMATCHED);
+    return count(MISMATCHED) == 0 && count(UNREADABLE) == 0;
+}
+
+COLD_CODE bool ODriveConfig::save(Stream& serial) {
+    if (count(WRITTEN) == 0)
+        return false;
+    serial.print("ss\n");
+    return true;
+}
+
+uint8_t ODriveConfig::count(State state) const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count_; ++i)
+        if (entries_[i].state == state) ++n;
+    return n;
+}
+
+COLD_CODE void ODriveConfig::print(Print& out) const {
+    for (uint8_t i = 0; i < count_; ++i) {
+        const Entry& e = entries_[i];
+        if (e.state != MISMATCHED && e.state != UNREADABLE) continue;
+        if (e.axis >= 0) {
+            out.print("axis");
+            out.print((int)e.axis);
+            out.print('.');
+        }
+        out.print(e.property);
+        if (e.state == UNREADABLE) {
+            out.print(": no reply\n");
+        } else {
+            out.print(": wanted ");
+            out.print(e.value, 4);
+            out.print(", reads ");
+            out.print(e.read, 4);
+            out.print('\n');
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef ODriveConfig_h
+#define ODriveConfig_h
+
+#include "Arduino.h"
+#include "ODriveArduino.h"
+
+/* The configuration the firmware wants on the ODrive, as a table applied in
+* one pass at boot instead of one read-then-write per property.
+*
+* apply() reads every entry back with pipelined "r" queries, batch at a time
+* so the replies fit the UART's 64-byte RX buffer, writes only those that
+* differ, then reads the written ones again to check they took. A warm boot therefore costs a few round trips
+* and no writes, and a property the firmware does not have (renamed between
+* versions, or a typo) shows up as unreadable instead of failing silently.
+* Integer, enum and bool entries are compared exactly and written without a
+* decimal point, floats within the 4 decimals the ASCII line carries.
+*
+* save() sends "ss" if apply() changed anything, so the next boot finds the
+* values in place; firmware 0.5 reboots on it, 0.4 only saves idle axes.
+*
+*     ODriveConfig config;
+*     config.set(0, "controller.config.vel_limit", 10.0f);
+*     config.setInt(0, "controller.config.control_mode", CONTROL_MODE_TORQUE_CONTROL);
+*     if (!config.apply(odrive)) config.print(Serial);
+*/
+class ODriveConfig {
+public:
+    static constexpr uint8_t max_entries = 16;
+    static constexpr uint8_t batch = 4;
+    static_assert(batch <= ODriveArduino::max_pending, "a batch is one pipelined read");
+
+    enum State : uint8_t { UNCHECKED, MATCHED, WRITTEN, MISMATCHED, UNREADABLE };
+
+    // axis < 0 for a property of the ODrive itself; false if the table is full
+    bool set(int8_t axis, const char* property, float value) { return add(axis, property, value, false); }
+    bool setInt(int8_t axis, const char* property, int32_t value) { return add(axis, property, (float)value, true); }
+
+    // true if every entry now reads back as wanted
+    bool apply(ODriveArduino& odrive);
+    bool save(Stream& serial);
+
+    uint8_t size() const { return count_; }
+    uint8_t count(State state) const;
+    State state(uint8_t i) const { return entries_[i].state; }
+
+    // One line per entry that is not MATCHED or WRITTEN
+    void print(Print& out) const;
+
+private:
+    struct Entry {
+        const char* property;
+        float value;
+        float read;
+        int8_t axis;
+        bool integer;
+        State state;
+    };
+
+    bool add(int8_t axis, const char* property, float value, bool integer);
+    // Reads the entries in state from into read, in batches; those that match move to
+    // matched, the rest to differ (UNREADABLE if no reply)
+    void readBack(ODriveArduino& odrive, State from, State matched, State differ);
+    static bool matches(const Entry& e);
+
+    Entry entries_[max_entries];
+    uint8_t count_ = 0;
+};
+
+#endif //ODriveConfig_h
@@ -0,0 +1,89 @@
+
+#include "Arduino.h"
+#include "ODriveErrorMonitor.h"
+#include "ODriveAscii.h"
+
+// Registers that are not axis.error, visited one per third slot
+static const ODriveErrorMonitor::Register other_registers[] = {
+    ODriveErrorMonitor::ODRIVE,
+    ODriveErrorMonitor::MOTOR0, ODriveErrorMonitor::MOTOR1,
+    ODriveErrorMonitor::ENCODER0, ODriveErrorMonitor::ENCODER1,
+    ODriveErrorMonitor::CONTROLLER0, ODriveErrorMonitor::CONTROLLER1,
+};
+static constexpr uint8_t num_other = sizeof(other_registers) / sizeof(other_registers[0]);
+
+// Each register's whole query, in Register order, so a poll is one write
+static constexpr odrive_ascii::Line queries[ODriveErrorMonitor::NUM_REGISTERS] = {
+    ODRIVE_ASCII_READ(-1, ERROR),
+    ODRIVE_ASCII_READ(0, AXIS__MOTOR__ERROR), ODRIVE_ASCII_READ(1, AXIS__MOTOR__ERROR),
+    ODRIVE_ASCII_READ(0, AXIS__ERROR), ODRIVE_ASCII_READ(1, AXIS__ERROR),
+    ODRIVE_ASCII_READ(0, AXIS__ENCODER__ERROR), ODRIVE_ASCII_READ(1, AXIS__ENCODER__ERROR),
+    ODRIVE_ASCII_READ(0, AXIS__CONTROLLER__ERROR), ODRIVE_ASCII_READ(1, AXIS__CONTROLLER__ERROR),
+};
+
+ODriveErrorMonitor::ODriveErrorMonitor(ODriveArduino& odrive, uint32_t poll_period_us)
+    : odrive_(odrive), poll_period_us_(poll_period_us) {}
+
+bool ODriveErrorMonitor::update(uint32_t now_us) {
+    if (now_us - last_poll_us_ < poll_period_us_)
+        return false;
+    last_poll_us_ = now_us;
+
+    Register reg = nextRegister();
+    bool was_clear = values_[reg] == 0;
+    read(reg, now_us);
+
+    if ((reg == AXIS0 || reg == AXIS1) && was_clear && values_[reg] != 0)
+        scanAll(now_us);
+    return true;
+}
+
+void ODriveErrorMonitor::scanAll(uint32_t now_us) {
+    for (uint8_t reg = 0; reg < NUM_REGISTERS; ++reg)
+        read(Register(reg), now_us);
+}
+
+bool ODriveErrorMonitor::anyError() const {
+    for (uint8_t reg = 0; reg < NUM_REGISTERS; ++reg)
+        if (values_[reg] != 0) return true;
+    return false;
+}
+
+ODriveErrorMonitor::Register ODriveErrorMonitor::nextRegister() {
+    // AXIS0, AXIS1, <other>, AXIS0, AXIS1, <next other>, ...
+    uint8_t slot = slot_;
+    slot_ = (slot_ + 1) % 3;
+    if (slot == 0) return AXIS0;
+    if (slot == 1) return AXIS1;
+    Register reg = other_registers[other_];
+    other_ = (other_ + 1) % num_other;
+    return reg;
+}
+
+const char* ODriveErrorMonitor::property(Register reg, int& axis) {
+    switch (reg) {
+        case ODRIVE:      axis = -1; return "error";
+        case MOTOR0:      axis = 0; return "motor.error";
+        case MOTOR1:      axis = 1; return "motor.error";
+        case AXIS0:       axis = 0; return "error";
+        case AXIS1:       axis = 1; return "error";
+        case ENCODER0:    axis = 0; return "encoder.error";
+        case ENCODER1:    axis = 1; return "encoder.error";
+        case CONTROLLER0: axis = 0; return "controller.error";
+        case CONTROLLER1: axis = 1; return "controller.error";
+        default:          axis = -1; return nullptr;
+    }
+}
+
+void ODriveErrorMonitor::read(Register reg, uint32_t now_us) {
+    if (reg >= NUM_REGISTERS)
+        return;
+    int64_t value = odrive_.readProperty(queries[reg]);
+    // a timed-out read says nothing about the register, keep the old value and age
+    if (odrive_.lastStatus() != ODriveArduino::READ_OK)
+        return;
+    if (value != values_[reg])
+        ++changes_;
+    values_[reg] = value;
+    stamp_us_[reg] = now_us;
+}
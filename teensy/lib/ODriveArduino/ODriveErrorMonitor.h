@@ -0,0 +1,52 @@
+#ifndef ODriveErrorMonitor_h
+#define ODriveErrorMonitor_h
+
+#include "Arduino.h"
+#include "ODriveArduino.h"
+
+/* Rate-limited ODrive error polling.
+*
+* Instead of reading all nine error registers every tick, update() reads one
+* register per poll period. The axis registers take every other slot because
+* axis.error is set whenever any of its motor/encoder/controller errors is.
+* When an axis error goes non-zero the remaining registers are read at once.
+*/
+class ODriveErrorMonitor {
+public:
+    enum Register : uint8_t {
+        ODRIVE, MOTOR0, MOTOR1, AXIS0, AXIS1, ENCODER0, ENCODER1, CONTROLLER0, CONTROLLER1,
+        NUM_REGISTERS
+    };
+
+    ODriveErrorMonitor(ODriveArduino& odrive, uint32_t poll_period_us = 0);
+
+    // Reads at most one register (or a full scan on a new axis error).
+    // Returns true if a register was read.
+    bool update(uint32_t now_us);
+    void scanAll(uint32_t now_us);
+    // One register now, e.g. to confirm a clear
+    void read(Register reg, uint32_t now_us);
+
+    int64_t value(Register reg) const { return values_[reg]; }
+    uint32_t age_us(Register reg, uint32_t now_us) const { return now_us - stamp_us_[reg]; }
+    bool anyError() const;
+    uint32_t changes() const { return changes_; }
+    void setPollPeriod(uint32_t poll_period_us) { poll_period_us_ = poll_period_us; }
+
+    // The register's property and its axis (-1 for the ODrive's own error)
+    static const char* property(Register reg, int& axis);
+
+private:
+    Register nextRegister();
+
+    ODriveArduino& odrive_;
+    uint32_t poll_period_us_;
+    uint32_t last_poll_us_ = 0;
+    uint8_t slot_ = 0;
+    uint8_t other_ = 0;
+    int64_t values_[NUM_REGISTERS] = {};
+    uint32_t stamp_us_[NUM_REGISTERS] = {};
+    uint32_t changes_ = 0;
+};
+
+#endif //ODriveErrorMonitor_h
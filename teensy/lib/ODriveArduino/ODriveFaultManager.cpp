@@ -0,0 +1,197 @@
+#include "Arduino.h"
+#include "ODriveFaultManager.h"
+
+typedef ODriveErrorMonitor::Register Register;
+
+// Each unit's registers in clear order, axis.error last
+static const Register unit_registers[ODriveFaultManager::NUM_UNITS][4] = {
+    {ODriveErrorMonitor::MOTOR0, ODriveErrorMonitor::ENCODER0, ODriveErrorMonitor::CONTROLLER0, ODriveErrorMonitor::AXIS0},
+    {ODriveErrorMonitor::MOTOR1, ODriveErrorMonitor::ENCODER1, ODriveErrorMonitor::CONTROLLER1, ODriveErrorMonitor::AXIS1},
+    {ODriveErrorMonitor::ODRIVE},
+};
+static const uint8_t unit_register_count[ODriveFaultManager::NUM_UNITS] = {4, 4, 1};
+
+// axis.error's summary bits for a failed motor, sensorless estimator, encoder or controller,
+// which ODriveEnums.h does not list; the sub-register they point at is classed on its own
+static constexpr uint64_t axis_error_subsystem_failed = 0x40 | 0x80 | 0x100 | 0x200;
+
+static const uint64_t default_recoverable[ODriveFaultManager::NUM_KINDS] = {
+    // ODRIVE_ERRORS
+    ODRIVE_ERROR_CONTROL_ITERATION_MISSED,
+    // AXIS_ERRORS
+    AXIS_ERROR_INVALID_STATE | AXIS_ERROR_WATCHDOG_TIMER_EXPIRED | AXIS_ERROR_UNKNOWN_POSITION |
+        axis_error_subsystem_failed,
+    // MOTOR_ERRORS: deadline and timing misses, and what an encoder error leaves unknown
+    MOTOR_ERROR_CONTROL_DEADLINE_MISSED | MOTOR_ERROR_MODULATION_MAGNITUDE | MOTOR_ERROR_CURRENT_SENSE_SATURATION |
+        MOTOR_ERROR_CURRENT_LIMIT_VIOLATION | MOTOR_ERROR_TIMER_UPDATE_MISSED | MOTOR_ERROR_CONTROLLER_FAILED |
+        MOTOR_ERROR_BAD_TIMING | MOTOR_ERROR_UNKNOWN_PHASE_ESTIMATE | MOTOR_ERROR_UNKNOWN_PHASE_VEL |
+        MOTOR_ERROR_UNKNOWN_TORQUE | MOTOR_ERROR_UNKNOWN_CURRENT_COMMAND | MOTOR_ERROR_UNKNOWN_CURRENT_MEASUREMENT |
+        MOTOR_ERROR_UNKNOWN_VBUS_VOLTAGE | MOTOR_ERROR_UNKNOWN_VOLTAGE_COMMAND | MOTOR_ERROR_CONTROLLER_INITIALIZING,
+    // ENCODER_ERRORS: the signal glitches; an unstable gain or a lost index needs a calibration
+    ENCODER_ERROR_CPR_POLEPAIRS_MISMATCH | ENCODER_ERROR_NO_RESPONSE | ENCODER_ERROR_ILLEGAL_HALL_STATE |
+        ENCODER_ERROR_ABS_SPI_TIMEOUT | ENCODER_ERROR_ABS_SPI_COM_FAIL | ENCODER_ERROR_ABS_SPI_NOT_READY,
+    // CONTROLLER_ERRORS
+    CONTROLLER_ERROR_OVERSPEED | CONTROLLER_ERROR_INVALID_ESTIMATE,
+};
+
+ODriveFaultManager::ODriveFaultManager(ODriveArduino& odrive, ODriveErrorMonitor& monitor, uint32_t verify_us,
+                                       uint8_t max_attempts, uint32_t retry_window_us)
+    : odrive_(odrive), monitor_(monitor), verify_us_(verify_us), max_attempts_(max_attempts),
+      retry_window_us_(retry_window_us) {
+    for (uint8_t k = 0; k < NUM_KINDS; ++k)
+        recoverable_[k] = default_recoverable[k];
+}
+
+ODriveFaultManager::Kind ODriveFaultManager::kind(Register reg) {
+    switch (reg) {
+        case ODriveErrorMonitor::AXIS0: case ODriveErrorMonitor::AXIS1: return AXIS_ERRORS;
+        case ODriveErrorMonitor::MOTOR0: case ODriveErrorMonitor::MOTOR1: return MOTOR_ERRORS;
+        case ODriveErrorMonitor::ENCODER0: case ODriveErrorMonitor::ENCODER1: return ENCODER_ERRORS;
+        case ODriveErrorMonitor::CONTROLLER0: case ODriveErrorMonitor::CONTROLLER1: return CONTROLLER_ERRORS;
+        default: return ODRIVE_ERRORS;
+    }
+}
+
+bool ODriveFaultManager::update(uint32_t now_us, bool restore_allowed) {
+    // round robin, so a unit waiting out its verify delay does not hold the others
+    for (uint8_t i = 0; i < NUM_UNITS; ++i) {
+        uint8_t unit = next_unit_;
+        next_unit_ = (next_unit_ + 1) % NUM_UNITS;
+        if (step(unit, now_us, restore_allowed))
+            return true;
+    }
+    return false;
+}
+
+void ODriveFaultManager::reset() {
+    for (uint8_t unit = 0; unit < NUM_UNITS; ++unit) {
+        units_[unit].attempts = 0;
+        units_[unit].fault_bits = 0;
+        units_[unit].fault_reg = ODriveErrorMonitor::NUM_REGISTERS;
+        enter(unit, NOMINAL, 0);
+    }
+}
+
+bool ODriveFaultManager::step(uint8_t unit, uint32_t now_us, bool restore_allowed) {
+    Unit& u = units_[unit];
+    const Register* regs = unit_registers[unit];
+    const uint8_t count = unit_register_count[unit];
+    switch (u.state) {
+        case NOMINAL:
+            if (clear(unit))
+                return false;
+            if (now_us - u.recovered_us > retry_window_us_)
+                u.attempts = 0;
+            u.fault_us = now_us;
+            if (critical(unit) || u.attempts >= max_attempts_) {
+                fault(unit, now_us);
+                return false;
+            }
+            ++u.attempts;
+            enter(unit, CLEAR, now_us);
+            return false;
+
+        case CLEAR: {
+            // the sub-registers that are set, then axis.error whatever it reads
+            while (u.step < count - 1 && monitor_.value(regs[u.step]) == 0)
+                ++u.step;
+            int axis;
+            const char* property = ODriveErrorMonitor::property(regs[u.step], axis);
+            odrive_.writeIntProperty(axis, property, 0);
+            if (++u.step == count)
+                enter(unit, unit < 2 ? RESTORE : VERIFY, now_us);
+            return true;
+        }
+
+        case RESTORE:
+            if (!restore_allowed)
+                return false;
+            odrive_.writeIntProperty(unit, "requested_state", AXIS_STATE_CLOSED_LOOP_CONTROL);
+            enter(unit, VERIFY, now_us);
+            return true;
+
+        case VERIFY:
+            if (now_us - u.action_us < verify_us_)
+                return false;
+            if (u.step < count) {
+                monitor_.read(regs[u.step++], now_us);
+                return true;
+            }
+            if (clear(unit)) {
+                u.recovered_us = now_us;
+                last_recovery_us_ = now_us - u.fault_us;
+                if (last_recovery_us_ > max_recovery_us_) max_recovery_us_ = last_recovery_us_;
+                ++recoveries_;
+                enter(unit, NOMINAL, now_us);
+            } else if (critical(unit) || u.attempts >= max_attempts_) {
+                fault(unit, now_us);
+            } else {
+                ++u.attempts;
+                enter(unit, CLEAR, now_us);
+            }
+            return false;
+
+        case FAULTED:
+            // cleared from outside, e.g. "sc" before a recalibration
+            if (clear(unit))
+                enter(unit, NOMINAL, now_us);
+            return false;
+    }
+    return false;
+}
+
+bool ODriveFaultManager::critical(uint8_t unit) {
+    Unit& u = units_[unit];
+    for (uint8_t i = 0; i < unit_register_count[unit]; ++i) {
+        Register reg = unit_registers[unit][i];
+        uint64_t bits = (uint64_t)monitor_.value(reg) & ~recoverable_[kind(reg)];
+        if (bits) {
+            u.fault_reg = reg;
+            u.fault_bits = bits;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ODriveFaultManager::fault(uint8_t unit, uint32_t now_us) {
+    Unit& u = units_[unit];
+    // out of attempts on recoverable bits: latch the first register still set
+    if (!critical(unit)) {
+        u.fault_reg = unit_registers[unit][unit_register_count[unit] - 1];
+        for (uint8_t i = 0; i < unit_register_count[unit]; ++i) {
+            if (monitor_.value(unit_registers[unit][i]) != 0) {
+                u.fault_reg = unit_registers[unit][i];
+                break;
+            }
+        }
+        u.fault_bits = (uint64_t)monitor_.value(u.fault_reg);
+    }
+    ++faults_;
+    enter(unit, FAULTED, now_us);
+}
+
+bool ODriveFaultManager::clear(uint8_t unit) const {
+    for (uint8_t i = 0; i < unit_register_count[unit]; ++i)
+        if (monitor_.value(unit_registers[unit][i]) != 0) return false;
+    return true;
+}
+
+void ODriveFaultManager::enter(uint8_t unit, State state, uint32_t now_us) {
+    Unit& u = units_[unit];
+    u.state = state;
+    u.step = 0;
+    u.action_us = now_us;
+    ++changes_;
+}
+
+const char* ODriveFaultManager::name(State state) {
+    switch (state) {
+        case NOMINAL: return "nominal";
+        case CLEAR:   return "clear";
+        case RESTORE: return "restore";
+        case VERIFY:  return "verify";
+        case FAULTED: return "faulted";
+    }
+    return "?";
+}
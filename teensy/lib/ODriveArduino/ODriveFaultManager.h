@@ -0,0 +1,99 @@
+#ifndef ODriveFaultManager_h
+#define ODriveFaultManager_h
+
+#include "Arduino.h"
+#include "ODriveArduino.h"
+#include "ODriveErrorMonitor.h"
+
+/* Reaction to the errors ODriveErrorMonitor finds: recoverable ones are
+* cleared and the axis put back in closed loop, critical ones are latched
+* for the operator.
+*
+* Each error bit is classed by the mask of its register kind. The defaults
+* take as recoverable what a transient causes and a clear undoes, e.g. an
+* encoder's CPR/pole-pair mismatch or SPI timeout after an impact, the
+* overspeed, estimate and phase errors that follow it, a missed control
+* deadline, the watchdog; every other bit, and any bit the masks do not
+* know, is critical. setRecoverable() changes a mask.
+*
+* The units are the two axes (their motor, encoder, controller and axis
+* registers) and the ODrive's own error. A unit in error goes through
+*
+*   CLEAR    "w <register> 0" for each set register, axis.error last
+*   RESTORE  requested_state closed loop (axes only), held while restore
+*            is not allowed, e.g. during the E-stop
+*   VERIFY   after verify_us, each register read back; all clear is a
+*            recovery, anything else another attempt or, past
+*            max_attempts, FAULTED
+*
+* with at most one ODrive line per update(), so it can run from the control
+* step on the ticks the monitor does not poll. A fault within retry_window_us
+* of the unit's last recovery counts as the same attempt series. FAULTED
+* holds until reset() or until the registers read clear again.
+*/
+class ODriveFaultManager {
+public:
+    enum Kind : uint8_t { ODRIVE_ERRORS, AXIS_ERRORS, MOTOR_ERRORS, ENCODER_ERRORS, CONTROLLER_ERRORS, NUM_KINDS };
+    enum State : uint8_t { NOMINAL, CLEAR, RESTORE, VERIFY, FAULTED };
+    static constexpr uint8_t NUM_UNITS = 3; // axis 0, axis 1, the ODrive
+
+    ODriveFaultManager(ODriveArduino& odrive, ODriveErrorMonitor& monitor, uint32_t verify_us = 50000,
+                       uint8_t max_attempts = 3, uint32_t retry_window_us = 1000000);
+
+    // At most one ODrive transaction; true if it made one
+    bool update(uint32_t now_us, bool restore_allowed = true);
+    // Back to NOMINAL with no attempts, after the operator cleared or recalibrated
+    void reset();
+
+    void setRecoverable(Kind kind, uint64_t mask) { recoverable_[kind] = mask; }
+    uint64_t recoverable(Kind kind) const { return recoverable_[kind]; }
+    static Kind kind(ODriveErrorMonitor::Register reg);
+
+    State state(uint8_t unit) const { return units_[unit].state; }
+    // The register and bits that latched a FAULTED unit
+    ODriveErrorMonitor::Register faultRegister(uint8_t unit) const { return units_[unit].fault_reg; }
+    uint64_t faultBits(uint8_t unit) const { return units_[unit].fault_bits; }
+    uint32_t recoveries() const { return recoveries_; }
+    uint32_t faults() const { return faults_; }
+    // Time to recovery: from the error seen to the registers read back clear
+    uint32_t lastRecovery_us() const { return last_recovery_us_; }
+    uint32_t maxRecovery_us() const { return max_recovery_us_; }
+    // Bumped on every state change, for publishing
+    uint32_t changes() const { return changes_; }
+    static const char* name(State state);
+
+private:
+    struct Unit {
+        State state = NOMINAL;
+        uint8_t step = 0;
+        uint8_t attempts = 0;
+        uint32_t fault_us = 0;
+        uint32_t action_us = 0;
+        uint32_t recovered_us = 0;
+        ODriveErrorMonitor::Register fault_reg = ODriveErrorMonitor::NUM_REGISTERS;
+        uint64_t fault_bits = 0;
+    };
+
+    bool step(uint8_t unit, uint32_t now_us, bool restore_allowed);
+    // true if one of the unit's registers holds a critical bit, which goes into fault_reg/bits
+    bool critical(uint8_t unit);
+    void fault(uint8_t unit, uint32_t now_us);
+    bool clear(uint8_t unit) const;
+    void enter(uint8_t unit, State state, uint32_t now_us);
+
+    ODriveArduino& odrive_;
+    ODriveErrorMonitor& monitor_;
+    uint32_t verify_us_;
+    uint8_t max_attempts_;
+    uint32_t retry_window_us_;
+    uint64_t recoverable_[NUM_KINDS];
+    Unit units_[NUM_UNITS];
+    uint8_t next_unit_ = 0;
+    uint32_t recoveries_ = 0;
+    uint32_t faults_ = 0;
+    uint32_t last_recovery_us_ = 0;
+    uint32_t max_recovery_us_ = 0;
+    uint32_t changes_ = 0;
+};
+
+#endif //ODriveFaultManager_h
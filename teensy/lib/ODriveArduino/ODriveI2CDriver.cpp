@@ -0,0 +1,286 @@
+
+#include "Arduino.h"
+#include "ODriveI2CDriver.h"
+
+// Bus used by I2C_transaction(), and the queue on it if there is one; set by each
+// ODriveI2CDriver call that goes through them, so several drivers can share them
+static TwoWire* odrive_bus = &Wire1;
+static AsyncI2C* odrive_async = nullptr;
+static uint8_t odrive_device = AsyncI2C::no_device;
+
+static constexpr size_t max_async_segments = 8;
+static constexpr uint32_t async_timeout_us = 2000;
+
+// odrive.h's segments as AsyncI2C's; the endpoint accesses are all far under 256 bytes
+static void to_async(const I2C_segment* in, size_t count, AsyncI2C::Segment* out) {
+    for (size_t i = 0; i < count; ++i)
+        out[i] = {in[i].tx_buffer, (uint8_t)in[i].tx_length, in[i].rx_buffer, (uint8_t)in[i].rx_length};
+}
+
+// The blocking form through the queue, behind the control step's traffic
+static bool async_transactions(uint8_t slave_addr, const I2C_segment * segments, size_t count) {
+    if (count > max_async_segments)
+        return false;
+    AsyncI2C::Segment async_segments[max_async_segments];
+    to_async(segments, count, async_segments);
+    AsyncI2C::Transaction transaction;
+    transaction.address = slave_addr;
+    transaction.segments = async_segments;
+    transaction.count = count;
+    transaction.priority = AsyncI2C::BACKGROUND;
+    transaction.device = odrive_device;
+    // wait() takes it out of the queue on a timeout, so it can live on the stack
+    return odrive_async->submit(transaction) && odrive_async->wait(transaction, async_timeout_us);
+}
+
+// See odrive.h for a description
+bool I2C_transaction(uint8_t slave_addr, const uint8_t * tx_buffer, size_t tx_length, uint8_t * rx_buffer, size_t rx_length) {
+    if (odrive_async) {
+        const I2C_segment segment = {tx_buffer, tx_length, rx_buffer, rx_length};
+        return async_transactions(slave_addr, &segment, 1);
+    }
+    TwoWire& bus = *odrive_bus;
+    if (tx_buffer) {
+        bus.beginTransmission(slave_addr);
+        if (bus.write(tx_buffer, tx_length) != tx_length)
+            return false;
+        bool should_stop = !rx_buffer;
+        if (bus.endTransmission(should_stop) != 0)
+            return false;
+    }
+
+    if (rx_buffer) {
+        while (bus.available()) bus.read();
+        if (bus.requestFrom(slave_addr, (uint8_t)rx_length, (uint8_t)true) != rx_length)
+            return false;
+        for (size_t i = 0; i < rx_length; ++i)
+            rx_buffer[i] = bus.read();
+    }
+    return true;
+}
+
+// See odrive.h; Wire's endTransmission(false) and requestFrom(..., false)
+// leave the bus held, so the next segment starts with a repeated start
+bool I2C_transactions(uint8_t slave_addr, const I2C_segment * segments, size_t count) {
+    if (odrive_async)
+        return async_transactions(slave_addr, segments, count);
+    TwoWire& bus = *odrive_bus;
+    for (size_t s = 0; s < count; ++s) {
+        const I2C_segment& segment = segments[s];
+        bool last = s + 1 == count;
+        bool ok = true;
+        if (segment.tx_buffer) {
+            bus.beginTransmission(slave_addr);
+            ok = bus.write(segment.tx_buffer, segment.tx_length) == segment.tx_length
+              && bus.endTransmission(last && !segment.rx_buffer) == 0;
+        }
+        if (ok && segment.rx_buffer) {
+            while (bus.available()) bus.read();
+            ok = bus.requestFrom(slave_addr, (uint8_t)segment.rx_length, (uint8_t)last) == segment.rx_length;
+            for (size_t i = 0; ok && i < segment.rx_length; ++i)
+                segment.rx_buffer[i] = bus.read();
+        }
+        if (!ok) {
+            // release the bus a failed segment may have left held
+            if (!last) {
+                bus.beginTransmission(slave_addr);
+                bus.endTransmission(true);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+ODriveI2CDriver::ODriveI2CDriver(TwoWire& bus, uint8_t odrive_num, uint32_t clock_hz, float counts_per_turn,
+                                 AsyncI2C* async)
+    : bus_(bus), odrive_num_(odrive_num), clock_hz_(clock_hz), turns_per_count_(1.0f / counts_per_turn),
+      async_(async) {}
+
+void ODriveI2CDriver::select() const {
+    odrive_bus = &bus_;
+    odrive_async = async_;
+    odrive_device = bus_device_;
+}
+
+bool ODriveI2CDriver::begin() {
+    select();
+    bus_.begin();
+    bus_.setClock(clock_hz_);
+    if (async_) {
+        using namespace odrive;
+        static const uint16_t addresses[4] = {
+            AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL,
+            AXIS__ENCODER__POS_ESTIMATE + per_axis_offset, AXIS__ENCODER__PLL_VEL + per_axis_offset};
+        // the addresses never change, so the requests are encoded once
+        feedback_batch_.prepare(addresses);
+        to_async(feedback_batch_.segments, FeedbackBatch::count, feedback_segments_);
+        feedback_.address = i2c_addr + odrive_num_;
+        feedback_.segments = feedback_segments_;
+        feedback_.count = FeedbackBatch::count;
+        feedback_.done = feedbackDone;
+        feedback_.context = this;
+        feedback_.priority = AsyncI2C::URGENT;
+        feedback_.device = bus_device_;
+        for (Setpoint& setpoint : setpoints_) {
+            setpoint.transaction.priority = AsyncI2C::URGENT;
+            setpoint.transaction.device = bus_device_;
+        }
+        async_->setClock(clock_hz_);
+        async_->begin();
+    }
+    float vbus = 0.0f;
+    return odrive::read_property<odrive::VBUS_VOLTAGE>(odrive_num_, &vbus);
+}
+
+// From the LPI2C interrupt
+void ODriveI2CDriver::feedbackDone(AsyncI2C::Transaction& transaction, bool ok) {
+    if (!ok)
+        return;
+    ODriveI2CDriver& driver = *static_cast<ODriveI2CDriver*>(transaction.context);
+    odrive::properties_t<odrive::AXIS__ENCODER__POS_ESTIMATE, odrive::AXIS__ENCODER__PLL_VEL,
+                         odrive::AXIS__ENCODER__POS_ESTIMATE, odrive::AXIS__ENCODER__PLL_VEL> feedback;
+    driver.feedback_batch_.decode(&feedback);
+    driver.feedback_counts_[0] = std::get<0>(feedback);
+    driver.feedback_counts_[1] = std::get<1>(feedback);
+    driver.feedback_counts_[2] = std::get<2>(feedback);
+    driver.feedback_counts_[3] = std::get<3>(feedback);
+}
+
+void ODriveI2CDriver::requestFeedback() {
+    if (async_ && !feedback_.pending() && !async_->submit(feedback_))
+        ++failures_;
+}
+
+// Both axes' estimates in one bus operation, four reads behind one arbitration
+bool ODriveI2CDriver::readFeedback(float position[2], float velocity[2]) {
+    using namespace odrive;
+    if (async_) {
+        // outside the loop (setup, E-stop) nobody requested it
+        if (feedback_.status == AsyncI2C::Status::idle)
+            requestFeedback();
+        // a failed batch keeps the last good value
+        bool ok = async_->wait(feedback_, async_timeout_us);
+        position[0] = feedback_counts_[0] * turns_per_count_;
+        velocity[0] = feedback_counts_[1] * turns_per_count_;
+        position[1] = feedback_counts_[2] * turns_per_count_;
+        velocity[1] = feedback_counts_[3] * turns_per_count_;
+        return ok;
+    }
+    select();
+    static const uint16_t addresses[4] = {
+        AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL,
+        AXIS__ENCODER__POS_ESTIMATE + per_axis_offset, AXIS__ENCODER__PLL_VEL + per_axis_offset};
+    properties_t<AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL,
+                 AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL> feedback;
+    if (!read_properties_at<AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL,
+                            AXIS__ENCODER__POS_ESTIMATE, AXIS__ENCODER__PLL_VEL>(odrive_num_, addresses, &feedback)) {
+        ++failures_;
+        return false;
+    }
+    position[0] = std::get<0>(feedback) * turns_per_count_;
+    velocity[0] = std::get<1>(feedback) * turns_per_count_;
+    position[1] = std::get<2>(feedback) * turns_per_count_;
+    velocity[1] = std::get<3>(feedback) * turns_per_count_;
+    return true;
+}
+
+// A setpoint batch into the queue, not waited for; AsyncI2C counts the failures
+bool ODriveI2CDriver::submit(AsyncI2C::Transaction& transaction, AsyncI2C::Segment* segments,
+                             const I2C_segment* batch, size_t count) {
+    to_async(batch, count, segments);
+    transaction.address = odrive::i2c_addr + odrive_num_;
+    transaction.segments = segments;
+    transaction.count = count;
+    return async_->submit(transaction);
+}
+
+// The endpoint table predates input_torque, so torque goes out as a current setpoint
+void ODriveI2CDriver::setTorque(int axis, float torque) {
+    if (async_) {
+        Setpoint& setpoint = setpoints_[axis];
+        if (setpoint.transaction.pending()) {
+            ++dropped_;
+            return;
+        }
+        const uint16_t addresses[1] = {(uint16_t)(odrive::AXIS__CONTROLLER__CURRENT_SETPOINT + axis * odrive::per_axis_offset)};
+        setpoint.torque.encode(addresses, torque / torque_constant_);
+        if (!submit(setpoint.transaction, setpoint.segments, setpoint.torque.segments, setpoint.torque.count))
+            ++failures_;
+        return;
+    }
+    select();
+    if (!odrive::write_axis_property<odrive::AXIS__CONTROLLER__CURRENT_SETPOINT>(odrive_num_, axis, torque / torque_constant_))
+        ++failures_;
+}
+
+void ODriveI2CDriver::setVelocity(int axis, float velocity, float torque_feedforward) {
+    if (async_) {
+        Setpoint& setpoint = setpoints_[axis];
+        if (setpoint.transaction.pending()) {
+            ++dropped_;
+            return;
+        }
+        const uint16_t offset = axis * odrive::per_axis_offset;
+        const uint16_t addresses[2] = {(uint16_t)(odrive::AXIS__CONTROLLER__VEL_SETPOINT + offset),
+                                       (uint16_t)(odrive::AXIS__CONTROLLER__CURRENT_SETPOINT + offset)};
+        setpoint.velocity.encode(addresses, velocity / turns_per_count_, torque_feedforward / torque_constant_);
+        if (!submit(setpoint.transaction, setpoint.segments, setpoint.velocity.segments, setpoint.velocity.count))
+            ++failures_;
+        return;
+    }
+    select();
+    if (!odrive::write_axis_properties<odrive::AXIS__CONTROLLER__VEL_SETPOINT, odrive::AXIS__CONTROLLER__CURRENT_SETPOINT>(
+            odrive_num_, axis, velocity / turns_per_count_, torque_feedforward / torque_constant_))
+        ++failures_;
+}
+
+void ODriveI2CDriver::setPosition(int axis, float position, float velocity_feedforward, float torque_feedforward) {
+    if (async_) {
+        Setpoint& setpoint = setpoints_[axis];
+        if (setpoint.transaction.pending()) {
+            ++dropped_;
+            return;
+        }
+        const uint16_t offset = axis * odrive::per_axis_offset;
+        const uint16_t addresses[3] = {(uint16_t)(odrive::AXIS__CONTROLLER__POS_SETPOINT + offset),
+                                       (uint16_t)(odrive::AXIS__CONTROLLER__VEL_SETPOINT + offset),
+                                       (uint16_t)(odrive::AXIS__CONTROLLER__CURRENT_SETPOINT + offset)};
+        setpoint.position.encode(addresses, position / turns_per_count_, velocity_feedforward / turns_per_count_,
+                                 torque_feedforward / torque_constant_);
+        if (!submit(setpoint.transaction, setpoint.segments, setpoint.position.segments, setpoint.position.count))
+            ++failures_;
+        return;
+    }
+    select();
+    if (!odrive::write_axis_properties<odrive::AXIS__CONTROLLER__POS_SETPOINT, odrive::AXIS__CONTROLLER__VEL_SETPOINT,
+                                       odrive::AXIS__CONTROLLER__CURRENT_SETPOINT>(
+            odrive_num_, axis, position / turns_per_count_, velocity_feedforward / turns_per_count_,
+            torque_feedforward / torque_constant_))
+        ++failures_;
+}
+
+int ODriveI2CDriver::readState(int axis) {
+    uint8_t state;
+    select();
+    if (!odrive::read_axis_property<odrive::AXIS__CURRENT_STATE>(odrive_num_, axis, &state)) {
+        ++failures_;
+        return -1;
+    }
+    return state;
+}
+
+bool ODriveI2CDriver::runState(int axis, int requested_state, bool wait_for_idle, float timeout) {
+    int timeout_ctr = (int)(timeout * 10.0f);
+    select();
+    if (!odrive::write_axis_property<odrive::AXIS__REQUESTED_STATE>(odrive_num_, axis, requested_state))
+        return false;
+    if (wait_for_idle) {
+        uint8_t state = AXIS_STATE_UNDEFINED;
+        do {
+            delay(100);
+            odrive::read_axis_property<odrive::AXIS__CURRENT_STATE>(odrive_num_, axis, &state);
+        } while (state != AXIS_STATE_IDLE && --timeout_ctr > 0);
+    }
+    return timeout_ctr > 0;
+}
@@ -0,0 +1,96 @@
+#ifndef ODriveI2CDriver_h
+#define ODriveI2CDriver_h
+
+#include "Arduino.h"
+#include <Wire.h>
+#include <AsyncI2C.h>
+#include <odrive.h>
+#include "MotorDriver.h"
+
+/* ODrive over I2C using the typed templates in lib/ArduinoI2C/odrive.h.
+*
+* The driver owns the bus it is given (normally Wire1, so the IMU keeps Wire)
+* and provides the I2C_transaction() and I2C_transactions() that odrive.h
+* expects. A torque write is a single 8-byte transaction: address, float
+* value and json_crc; the feedback of both axes, and a setpoint with its
+* feed-forwards, are one batched bus operation each.
+*
+* Given an AsyncI2C on the bus's LPI2C module (LPI2C3 for Wire1), all of it
+* goes through that queue instead: requestFeedback() submits the feedback
+* batch and its completion callback decodes it from the interrupt, so
+* readFeedback() only waits if it is still on the wire; the setpoint writes
+* are submitted and not waited for, a write to an axis whose last one is
+* still queued is counted in dropped() and left to the next tick or
+* keepalive; and the blocking calls (begin(), runState(), readState())
+* submit and wait in the same queue, so nothing uses the TwoWire after
+* begin(). Feedback and setpoints are URGENT in the queue, the blocking
+* calls BACKGROUND; setBusDevice() charges all of them to one device's
+* budget, which makes a blocking call fail instead of wait once the
+* ODrive's share of the tick is spent.
+*
+* Several boards are several drivers, one per odrive_num (the address
+* odrive.h derives from it) and bus. odrive.h's transaction functions are
+* free ones, so each call that goes through them first points them at its
+* own driver's bus and queue. One board's call must thus not preempt
+* another's, as calls on one bus already must not.
+*/
+class ODriveI2CDriver final : public MotorDriver {
+public:
+    ODriveI2CDriver(TwoWire& bus, uint8_t odrive_num, uint32_t clock_hz = 1000000,
+                    float counts_per_turn = 1.0f, AsyncI2C* async = nullptr);
+
+    bool begin() override;
+    void requestFeedback() override;
+    bool readFeedback(float position[2], float velocity[2]) override;
+    void setTorque(int axis, float torque) override;
+    // The feed-forward as a current setpoint alongside, in the same bus operation
+    void setVelocity(int axis, float velocity, float torque_feedforward) override;
+    void setPosition(int axis, float position, float velocity_feedforward, float torque_feedforward) override;
+    bool runState(int axis, int requested_state, bool wait_for_idle, float timeout = 10.0f) override;
+    int readState(int axis) override;
+    const char* name() const override { return "i2c"; }
+
+    void setTorqueConstant(float torque_constant) { torque_constant_ = torque_constant; }
+    // The AsyncI2C device the transactions count against, before begin()
+    void setBusDevice(uint8_t device) { bus_device_ = device; }
+    uint32_t failures() const { return failures_ + (async_ ? async_->failures() : 0); }
+    uint32_t dropped() const { return dropped_; }
+
+private:
+    typedef odrive::read_batch<odrive::AXIS__ENCODER__POS_ESTIMATE, odrive::AXIS__ENCODER__PLL_VEL,
+                               odrive::AXIS__ENCODER__POS_ESTIMATE, odrive::AXIS__ENCODER__PLL_VEL> FeedbackBatch;
+
+    // One axis' setpoint write in flight, in whichever of the three forms was last sent
+    struct Setpoint {
+        odrive::write_batch<odrive::AXIS__CONTROLLER__CURRENT_SETPOINT> torque;
+        odrive::write_batch<odrive::AXIS__CONTROLLER__VEL_SETPOINT, odrive::AXIS__CONTROLLER__CURRENT_SETPOINT> velocity;
+        odrive::write_batch<odrive::AXIS__CONTROLLER__POS_SETPOINT, odrive::AXIS__CONTROLLER__VEL_SETPOINT,
+                            odrive::AXIS__CONTROLLER__CURRENT_SETPOINT> position;
+        AsyncI2C::Segment segments[3];
+        AsyncI2C::Transaction transaction;
+    };
+
+    static void feedbackDone(AsyncI2C::Transaction& transaction, bool ok);
+    // I2C_transaction() and I2C_transactions() on this driver's bus and queue
+    void select() const;
+    bool submit(AsyncI2C::Transaction& transaction, AsyncI2C::Segment* segments,
+                const I2C_segment* batch, size_t count);
+
+    TwoWire& bus_;
+    uint8_t odrive_num_;
+    uint32_t clock_hz_;
+    float turns_per_count_;
+    float torque_constant_ = 1.0f;
+    uint32_t failures_ = 0;
+
+    AsyncI2C* async_;
+    uint8_t bus_device_ = AsyncI2C::no_device;
+    FeedbackBatch feedback_batch_;
+    AsyncI2C::Segment feedback_segments_[FeedbackBatch::count];
+    AsyncI2C::Transaction feedback_;
+    float feedback_counts_[4] = {}; // pos 0, vel 0, pos 1, vel 1, from feedbackDone()
+    Setpoint setpoints_[2];
+    uint32_t dropped_ = 0;
+};
+
+#endif //ODriveI2CDriver_h
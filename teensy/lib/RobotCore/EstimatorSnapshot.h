@@ -0,0 +1,84 @@
+#ifndef EstimatorSnapshot_h
+#define EstimatorSnapshot_h
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+/* The state of any set of estimators as one value, taken and put back in a
+* call each, so a run can resume from any tick: the replay harness from the
+* middle of a log, the firmware from before a disturbance.
+*
+* Every estimator here (TorsoEstimator, SpokeEstimator, GyroBiasEstimator,
+* HybridEKF, VelocityEstimator, the filter banks, the attitude filters) is a
+* value type: arrays and scalars, no pointers and nothing on the heap, with
+* its design (gains, windows, coefficients) compile-time constants or a few
+* words. So the snapshot is the objects copied whole, which cannot miss a
+* field a later change adds, and the static_assert keeps it that way: a
+* part that is not trivially copyable does not compile. A part can be a
+* plain scalar or array too, for state a caller keeps beside them.
+*
+*     EstimatorSnapshot<decltype(torso), decltype(spokes), decltype(ekf)> snapshot;
+*     snapshot.take(stamp_us, torso, spokes, ekf);
+*     ...
+*     snapshot.restore(torso, spokes, ekf);   // false if none was taken
+*
+* bytes() is its size, for the budget: 912 for replay's set, the torso and
+* spoke 0 filters, the impact detector, terrain and EKF.
+*/
+template<class... Parts>
+struct SnapshotParts;
+
+template<>
+struct SnapshotParts<> {
+    void take() {}
+    void restore() const {}
+};
+
+template<class First, class... Rest>
+struct SnapshotParts<First, Rest...> {
+    static_assert(std::is_trivially_copyable<First>::value, "a snapshot part must copy as plain data");
+
+    void take(const First& first, const Rest&... rest) {
+        memcpy(first_, &first, sizeof(First));
+        rest_.take(rest...);
+    }
+    void restore(First& first, Rest&... rest) const {
+        memcpy(&first, first_, sizeof(First));
+        rest_.restore(rest...);
+    }
+
+    // the bytes rather than a First, which need not be default constructible
+    alignas(First) unsigned char first_[sizeof(First)];
+    SnapshotParts<Rest...> rest_;
+};
+
+template<class... Parts>
+class EstimatorSnapshot {
+public:
+    void take(uint32_t stamp_us, const Parts&... parts) {
+        parts_.take(parts...);
+        stamp_us_ = stamp_us;
+        valid_ = true;
+    }
+
+    bool restore(Parts&... parts) const {
+        if (!valid_)
+            return false;
+        parts_.restore(parts...);
+        return true;
+    }
+
+    void clear() { valid_ = false; }
+    bool valid() const { return valid_; }
+    // When take() was called, on the caller's clock
+    uint32_t stamp_us() const { return stamp_us_; }
+    static constexpr uint32_t bytes() { return sizeof(SnapshotParts<Parts...>); }
+
+private:
+    SnapshotParts<Parts...> parts_;
+    uint32_t stamp_us_ = 0;
+    bool valid_ = false;
+};
+
+#endif //EstimatorSnapshot_h
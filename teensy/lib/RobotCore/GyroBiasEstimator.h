@@ -0,0 +1,99 @@
+#ifndef GyroBiasEstimator_h
+#define GyroBiasEstimator_h
+
+#include <math.h>
+#include <stdint.h>
+#include "Vec3.h"
+
+/* Online gyro bias from the stretches where the robot is known to be still,
+* so the LSM6DSOX's drift since the boot calibration does not leak into the
+* torso rate and the angular acceleration differenced from it.
+*
+* A sample counts as still when the caller says the robot is held (the
+* E-stop, the wheel at rest on its stance spoke), every axis of the
+* corrected gyro is within gyro_threshold of zero and the accel magnitude is
+* within accel_tolerance of g. Over the current still stretch a running mean
+* and variance are kept (Welford, O(1) memory); once the stretch has lasted
+* settle_s and its spread is below max_std, the bias follows the stretch's
+* mean with time constant tau_s. Any motion ends the stretch and freezes the
+* bias, so a slow roll cannot be learned as drift. The bias is bounded by
+* max_bias.
+*
+*     GyroBiasEstimator gyroBias;
+*     gyroBias.update(gyro, &accel, dt, estopActive);
+*     torso.fuse(gyroBias.correct(gyro), &accel, mag, dt);
+*/
+class GyroBiasEstimator {
+public:
+    GyroBiasEstimator(float gyro_threshold = 0.05f, float accel_tolerance = 0.5f, float settle_s = 0.5f,
+                      float tau_s = 5.0f, float max_std = 0.01f, float max_bias = 0.1f)
+        : gyro_threshold_(gyro_threshold), accel_tolerance_(accel_tolerance), settle_s_(settle_s),
+          tau_s_(tau_s), max_var_(max_std * max_std), max_bias_(max_bias) {}
+
+    // One calibrated sample over dt seconds; accel may be null (gyro-only ticks),
+    // which skips the accel test. True if the bias moved.
+    bool update(const Vec3& gyro, const Vec3* accel, float dt, bool held) {
+        const Vec3 w = gyro - bias_;
+        bool still = held && fabsf(w.x) < gyro_threshold_ && fabsf(w.y) < gyro_threshold_ &&
+                     fabsf(w.z) < gyro_threshold_;
+        if (still && accel)
+            still = fabsf(sqrtf(dot(*accel, *accel)) - gravity) < accel_tolerance_;
+        if (!still) {
+            n_ = 0;
+            still_s_ = 0.0f;
+            return false;
+        }
+
+        // Welford over the stretch
+        ++n_;
+        const Vec3 delta = gyro - mean_;
+        mean_ = n_ == 1 ? gyro : mean_ + delta * (1.0f / n_);
+        const Vec3 delta2 = gyro - mean_;
+        m2_ = n_ == 1 ? Vec3() : m2_ + Vec3(delta.x * delta2.x, delta.y * delta2.y, delta.z * delta2.z);
+        still_s_ += dt;
+        if (still_s_ < settle_s_ || n_ < 2)
+            return false;
+        const float limit = max_var_ * (n_ - 1);
+        if (m2_.x > limit || m2_.y > limit || m2_.z > limit)
+            return false;
+
+        bias_ = bias_ + (mean_ - bias_) * (dt / (tau_s_ + dt));
+        bias_ = Vec3(clamp(bias_.x), clamp(bias_.y), clamp(bias_.z));
+        ++updates_;
+        return true;
+    }
+
+    Vec3 correct(const Vec3& gyro) const { return gyro - bias_; }
+    const Vec3& bias() const { return bias_; }
+    void reset(const Vec3& bias = Vec3()) {
+        bias_ = bias;
+        n_ = 0;
+        still_s_ = 0.0f;
+    }
+
+    // In a still stretch, and for how long
+    bool still() const { return n_ > 0; }
+    float stillTime() const { return still_s_; }
+    // Samples the bias learned from since boot
+    uint32_t updates() const { return updates_; }
+
+    static constexpr float gravity = 9.80665f;
+
+private:
+    float clamp(float b) const { return b > max_bias_ ? max_bias_ : (b < -max_bias_ ? -max_bias_ : b); }
+
+    float gyro_threshold_;
+    float accel_tolerance_;
+    float settle_s_;
+    float tau_s_;
+    float max_var_;
+    float max_bias_;
+    Vec3 bias_;
+    Vec3 mean_;
+    Vec3 m2_;
+    uint32_t n_ = 0;
+    float still_s_ = 0.0f;
+    uint32_t updates_ = 0;
+};
+
+#endif //GyroBiasEstimator_h
@@ -0,0 +1,66 @@
+#ifndef ImuArray_h
+#define ImuArray_h
+
+#include <stdint.h>
+#include "Vec3.h"
+
+/* N IMUs of one kind read side by side each tick, e.g. the torso's LSM6DSOX
+* on Wire and the wheel hub's on Wire1, each bus with its own queue. Driver
+* is the sensor's non-blocking register burst (Lsm6dsBurst in
+* src/LSM6DS_LIS3MDL.h):
+*
+*     bool start(bool with_accel);           // submit the burst, do not wait
+*     uint8_t join(Vec3& gyro, Vec3& accel); // bytes read: 12, 6 (gyro only) or 0,
+*                                            // leaving what was not read alone
+*
+* start() submits every burst at the top of the step, so the buses run in
+* parallel with each other and with the encoder exchange; join(i) waits for
+* IMU i alone, so each consumer joins its own sensor where it needs it. An
+* IMU keeps its last sample through a failed read, and the reads and failures
+* are counted per IMU. Nothing here touches hardware.
+*
+*     ImuArray<Lsm6dsBurst, 2> imus(torsoBurst, wheelBurst);
+*     imus.start(true);
+*     if (imus.join(0) == 12) torso.fuse(imus.gyro(0), &imus.accel(0), ...);
+*/
+template<class Driver, int N>
+class ImuArray {
+public:
+    static constexpr int count = N;
+
+    template<class... Drivers>
+    explicit ImuArray(Drivers&... drivers) : drivers_{&drivers...} {
+        static_assert(sizeof...(Drivers) == N, "one driver per IMU");
+    }
+
+    // Submit every IMU's burst; the accel half only with with_accel
+    void start(bool with_accel) {
+        for (int i = 0; i < N; ++i) started_[i] = drivers_[i]->start(with_accel);
+    }
+
+    // IMU i's burst of this tick into gyro(i) and accel(i); the bytes read, 0
+    // if it was not started or failed
+    uint8_t join(int i) {
+        uint8_t length = started_[i] ? drivers_[i]->join(gyro_[i], accel_[i]) : 0;
+        started_[i] = false;
+        if (length == 0) ++failures_[i];
+        else ++reads_[i];
+        return length;
+    }
+
+    const Vec3& gyro(int i) const { return gyro_[i]; }
+    const Vec3& accel(int i) const { return accel_[i]; }
+    Driver& driver(int i) { return *drivers_[i]; }
+    uint32_t reads(int i) const { return reads_[i]; }
+    uint32_t failures(int i) const { return failures_[i]; }
+
+private:
+    Driver* drivers_[N];
+    bool started_[N] = {};
+    Vec3 gyro_[N];
+    Vec3 accel_[N];
+    uint32_t reads_[N] = {};
+    uint32_t failures_[N] = {};
+};
+
+#endif //ImuArray_h
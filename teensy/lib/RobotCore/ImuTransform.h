@@ -0,0 +1,122 @@
+#ifndef ImuTransform_h
+#define ImuTransform_h
+
+#include <stdint.h>
+#include "Vec3.h"
+
+/* The calibration and the LSB scale of each sensor folded into one transform at boot, so a
+* sample costs a multiply-add per term instead of Adafruit_Sensor_Calibration's per-event
+* passes: out = m*raw - b, applied straight to the int16 registers. The Adafruit
+* calibration has offsets only for gyro and accel, which keep a per-axis scale; the
+* magnetometer's soft iron makes its transform a full 3x3. Built from a calibration in
+* src/LSM6DS_LIS3MDL.h, from the scales alone here.
+*/
+struct ImuDiagonal {
+    float scale[3];
+    float b[3];
+};
+
+struct ImuAffine {
+    float m[9]; // row-major
+    float b[3];
+};
+
+struct ImuTransform {
+    ImuDiagonal gyro;
+    ImuDiagonal accel;
+    ImuAffine mag;
+};
+
+inline void imu_diagonal(ImuDiagonal& t, float scale, const float offset[3]) {
+    for (int i = 0; i < 3; i++) {
+        t.scale[i] = scale;
+        t.b[i] = offset[i];
+    }
+}
+
+// LSB scales alone, no offsets: gyro_scale, accel_scale and mag_scale take a count to
+// rad/s, m/s^2 and uT
+inline void imu_scale_transform(ImuTransform& t, float gyro_scale, float accel_scale, float mag_scale) {
+    const float zero[3] = {0.0f, 0.0f, 0.0f};
+    imu_diagonal(t.gyro, gyro_scale, zero);
+    imu_diagonal(t.accel, accel_scale, zero);
+    for (int i = 0; i < 9; i++) t.mag.m[i] = i % 4 == 0 ? mag_scale : 0.0f;
+    for (int i = 0; i < 3; i++) t.mag.b[i] = 0.0f;
+}
+
+// T is int16_t for register samples, float for getEvent() values
+template <class T>
+inline Vec3 imu_apply(const ImuDiagonal& t, const T raw[3]) {
+    return Vec3(t.scale[0] * raw[0] - t.b[0],
+                t.scale[1] * raw[1] - t.b[1],
+                t.scale[2] * raw[2] - t.b[2]);
+}
+
+template <class T>
+inline Vec3 imu_apply(const ImuAffine& t, const T raw[3]) {
+    const float x = raw[0], y = raw[1], z = raw[2];
+    return Vec3(t.m[0] * x + t.m[1] * y + t.m[2] * z - t.b[0],
+                t.m[3] * x + t.m[4] * y + t.m[5] * z - t.b[1],
+                t.m[6] * x + t.m[7] * y + t.m[8] * z - t.b[2]);
+}
+
+// The three sensors of one tick in one pass: the nine samples are converted together and
+// the transforms, contiguous in ImuTransform, applied back to back. Without mag_raw (the
+// read failed) mag is left as it was.
+template <class T>
+inline void imu_apply_all(const ImuTransform& t, const T gyro_raw[3], const T accel_raw[3], const T* mag_raw,
+                          Vec3& gyro, Vec3& accel, Vec3& mag) {
+    float v[9];
+    for (int i = 0; i < 3; i++) {
+        v[i] = gyro_raw[i];
+        v[3 + i] = accel_raw[i];
+        v[6 + i] = mag_raw ? (float)mag_raw[i] : 0.0f;
+    }
+    gyro = Vec3(t.gyro.scale[0] * v[0] - t.gyro.b[0],
+                t.gyro.scale[1] * v[1] - t.gyro.b[1],
+                t.gyro.scale[2] * v[2] - t.gyro.b[2]);
+    accel = Vec3(t.accel.scale[0] * v[3] - t.accel.b[0],
+                 t.accel.scale[1] * v[4] - t.accel.b[1],
+                 t.accel.scale[2] * v[5] - t.accel.b[2]);
+    if (mag_raw) {
+        const float* m = t.mag.m;
+        mag = Vec3(m[0] * v[6] + m[1] * v[7] + m[2] * v[8] - t.mag.b[0],
+                   m[3] * v[6] + m[4] * v[7] + m[5] * v[8] - t.mag.b[1],
+                   m[6] * v[6] + m[7] * v[7] + m[8] * v[8] - t.mag.b[2]);
+    }
+}
+
+// A FIFO drain's samples, calibrated into rows of one axis each: gyro[axis][n], accel[axis][n]
+template <uint16_t N>
+struct ImuBatch {
+    float gyro[3][N];
+    float accel[3][N];
+
+    Vec3 gyroAt(uint16_t n) const { return Vec3(gyro[0][n], gyro[1][n], gyro[2][n]); }
+    Vec3 accelAt(uint16_t n) const { return Vec3(accel[0][n], accel[1][n], accel[2][n]); }
+};
+
+// The whole batch through the transforms in one pass, ahead of the fusion: the twelve
+// scales and offsets are loaded once for the batch instead of once a sample around each
+// fusion call, and no iteration depends on another, so the M7 can issue the next
+// sample's loads and converts beside this one's multiply-subtracts. It costs a store and
+// a load of each result; imu_transform/* in the compute benchmarks weigh the two. Sample
+// is any type with int16_t gyro[3] and accel[3] (ImuFifoSample); count is at most N.
+template <class Sample, uint16_t N>
+inline void imu_apply_batch(const ImuTransform& t, const Sample* samples, uint16_t count, ImuBatch<N>& out) {
+    const float gs0 = t.gyro.scale[0], gs1 = t.gyro.scale[1], gs2 = t.gyro.scale[2];
+    const float gb0 = t.gyro.b[0], gb1 = t.gyro.b[1], gb2 = t.gyro.b[2];
+    const float as0 = t.accel.scale[0], as1 = t.accel.scale[1], as2 = t.accel.scale[2];
+    const float ab0 = t.accel.b[0], ab1 = t.accel.b[1], ab2 = t.accel.b[2];
+    for (uint16_t n = 0; n < count; n++) {
+        const Sample& s = samples[n];
+        out.gyro[0][n] = gs0 * s.gyro[0] - gb0;
+        out.gyro[1][n] = gs1 * s.gyro[1] - gb1;
+        out.gyro[2][n] = gs2 * s.gyro[2] - gb2;
+        out.accel[0][n] = as0 * s.accel[0] - ab0;
+        out.accel[1][n] = as1 * s.accel[1] - ab1;
+        out.accel[2][n] = as2 * s.accel[2] - ab2;
+    }
+}
+
+#endif //ImuTransform_h
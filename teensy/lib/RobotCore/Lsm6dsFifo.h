@@ -0,0 +1,96 @@
+#ifndef Lsm6dsFifo_h
+#define Lsm6dsFifo_h
+
+#include <stdint.h>
+#include <string.h>
+
+/* The LSM6DSOX's FIFO drained and decoded into one sample per gyro word,
+* paired with the latest accel word and, with timestamp batching, stamped
+* with the sensor's 25 us clock. Each FIFO word is a tag byte plus 6 data
+* bytes; the address rolls back to FIFO_DATA_OUT_TAG, so consecutive words
+* come out of one read. Wire buffers 32 bytes, so a drain is split into
+* reads of IMU_FIFO_WORDS_PER_READ words. Read is the bus, so the same drain
+* runs on Wire in the firmware and on the host's emulated sensor (imu_sim.h):
+*
+*     bool read(uint8_t reg, uint8_t* buffer, uint8_t length);
+*
+*     Lsm6dsFifo fifo;
+*     uint16_t count = fifo.drain(lsm6ds_read, samples, IMU_FIFO_MAX_SAMPLES);
+*/
+#define LSM6DSOX_FIFO_CTRL3 0x09
+#define LSM6DSOX_FIFO_CTRL4 0x0A
+#define LSM6DSOX_CTRL10_C 0x19
+#define LSM6DSOX_FIFO_STATUS1 0x3A
+#define LSM6DSOX_FIFO_DATA_OUT_TAG 0x78
+#define LSM6DSOX_FIFO_MODE_CONTINUOUS 0x06
+#define LSM6DSOX_DEC_TS_BATCH_1 0x40
+#define LSM6DSOX_TIMESTAMP_EN 0x20
+#define LSM6DSOX_FIFO_OVR_IA 0x40 // of FIFO_STATUS2, set while the FIFO overruns
+#define LSM6DSOX_FIFO_OVR_LATCHED 0x08 // of FIFO_STATUS2, an overrun since its last read
+#define LSM6DSOX_TAG_GYRO 0x01
+#define LSM6DSOX_TAG_ACCEL 0x02
+#define LSM6DSOX_TAG_TIMESTAMP 0x04
+#define LSM6DSOX_TIMESTAMP_US 25
+#define IMU_FIFO_WORDS_PER_READ 4
+
+struct ImuFifoSample {
+    int16_t gyro[3];
+    int16_t accel[3];
+    uint32_t stamp_us; // sensor time, 0 without timestamps
+};
+
+class Lsm6dsFifo {
+public:
+    // Drain the FIFO into samples[]; the number of samples, at most max_samples,
+    // the rest staying for the next call
+    template<class Read>
+    uint16_t drain(Read&& read, ImuFifoSample* samples, uint16_t max_samples) {
+        uint8_t status[2];
+        if (!read(LSM6DSOX_FIFO_STATUS1, status, 2)) return 0;
+        if (status[1] & LSM6DSOX_FIFO_OVR_LATCHED) overruns_++; // a word overwritten since the last drain
+        uint16_t words = status[0] | ((status[1] & 0x03) << 8);
+
+        uint16_t count = 0;
+        while (words > 0 && count < max_samples) {
+            uint8_t chunk = words < IMU_FIFO_WORDS_PER_READ ? words : IMU_FIFO_WORDS_PER_READ;
+            uint8_t raw[7*IMU_FIFO_WORDS_PER_READ];
+            if (!read(LSM6DSOX_FIFO_DATA_OUT_TAG, raw, 7*chunk)) break;
+            words -= chunk;
+            for (uint8_t w = 0; w < chunk; w++) count += decode(raw + 7*w, samples + count, count < max_samples);
+        }
+        return count;
+    }
+
+    // One FIFO word; 1 if it was a gyro word written to sample (only with room)
+    uint16_t decode(const uint8_t* word, ImuFifoSample* sample, bool room) {
+        int16_t v[3];
+        for (int i = 0; i < 3; i++) v[i] = (int16_t)(word[1 + 2*i] | (word[2 + 2*i] << 8));
+        switch (word[0] >> 3) {
+            case LSM6DSOX_TAG_ACCEL:
+                memcpy(accel_, v, sizeof(accel_));
+                return 0;
+            case LSM6DSOX_TAG_TIMESTAMP:
+                stamp_us_ = (word[1] | (word[2] << 8) | ((uint32_t)word[3] << 16) | ((uint32_t)word[4] << 24))
+                            * LSM6DSOX_TIMESTAMP_US;
+                return 0;
+            case LSM6DSOX_TAG_GYRO:
+                if (!room) return 0;
+                memcpy(sample->gyro, v, sizeof(v));
+                memcpy(sample->accel, accel_, sizeof(accel_));
+                sample->stamp_us = stamp_us_;
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+    // Drains that found FIFO_OVR_LATCHED, i.e. samples lost to a full FIFO since the drain before
+    uint32_t overruns() const { return overruns_; }
+
+private:
+    int16_t accel_[3] = {0, 0, 0};
+    uint32_t stamp_us_ = 0;
+    uint32_t overruns_ = 0;
+};
+
+#endif //Lsm6dsFifo_h
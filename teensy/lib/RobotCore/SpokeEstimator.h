@@ -0,0 +1,113 @@
+#ifndef SpokeEstimator_h
+#define SpokeEstimator_h
+
+#include <math.h>
+#include <stdint.h>
+#include "VelocityEstimator.h"
+#include "filters_bank.h"
+#include "RobotModel.h"
+#include "SpokeTracker.h"
+
+/* The encoder half of the sense step, from readEncoder(): the motor driver's
+* positions (turns) and velocities (turns/s) of the two hip axes become spoke
+* angles and rates, [angle 0, angle 1, rate 0, rate 1].
+*
+* The angle is SpokeTracker's, continuous through the gear from where zero()
+* was called at start-up; unwrap() takes the whole spokes off it, and index()
+* and contactAngle() give the stance spoke and its angle in [-alpha, alpha).
+* Each channel's rate is one of
+*
+*     RATE_DIFF_LPF   the angle differenced over the period, then RateFilter
+*     RATE_ESTIMATOR  its VelocityEstimator on the sample timestamps
+*     RATE_DRIVER     the driver's own velocity estimate
+*
+* RateFilter is a FixedFilterBank config (order, type, hz, ts), and ts is the
+* differencing period. Nothing here touches hardware.
+*/
+template<class RateFilter, class Model = RimlessWheelModel>
+class SpokeEstimator {
+public:
+    enum RateMethod : uint8_t { RATE_DIFF_LPF, RATE_ESTIMATOR, RATE_DRIVER };
+    static constexpr float period = RateFilter::ts;
+
+    // direction: the sign of the spoke angle per positive motor turn, see SpokeTracker
+    SpokeEstimator(const VelocityEstimator& estimator0, RateMethod method0,
+                   const VelocityEstimator& estimator1, RateMethod method1,
+                   float direction0 = -1.0f, float direction1 = -1.0f)
+        : tracker_(direction0, direction1), estimator_{estimator0, estimator1}, method_{method0, method1},
+          direction_{direction0, direction1} {}
+
+    // pos and vel from MotorDriver::readFeedback(); a stale reply repeats the
+    // old position, so the estimators hold instead of seeing a stop
+    void update(const float* pos, const float* vel, bool stale, uint32_t t_us, float* spokeStates) {
+        tracker_.update(pos);
+        for (int i = 0; i < 2; ++i)
+            spokeStates[i] = tracker_.angle(i);
+
+        // the low-pass runs on both channels so either can switch to it
+        float rates[2] = {(spokeStates[0] - last_[0]) / period, (spokeStates[1] - last_[1]) / period};
+        lpf_.filterIn(rates, rates);
+        for (int i = 0; i < 2; ++i) {
+            if (method_[i] == RATE_DRIVER) {
+                spokeStates[2 + i] = direction_[i]*vel[i]*Model::turnToSpoke;
+            } else if (method_[i] == RATE_DIFF_LPF) {
+                spokeStates[2 + i] = rates[i];
+            } else {
+                if (!stale) estimator_[i].update(spokeStates[i], t_us);
+                spokeStates[2 + i] = estimator_[i].velocity();
+            }
+            last_[i] = spokeStates[i];
+        }
+    }
+
+    // The current angles read zero from now on
+    void zero() {
+        tracker_.zero();
+        for (int i = 0; i < 2; ++i) moveZero(i, last_[i]);
+    }
+
+    // The angles read zero at the motor positions ref instead, e.g. a stored reference
+    void zeroAt(const float* ref) {
+        tracker_.zeroAt(ref);
+        for (int i = 0; i < 2; ++i) moveZero(i, last_[i] - tracker_.angle(i));
+    }
+
+    // Take whole spokes off the angles, so the stance spoke keeps its angle;
+    // from the tracker's spoke count, no new reading needed
+    void unwrap() {
+        for (int i = 0; i < 2; ++i) moveZero(i, Model::spokeSpacing*tracker_.index(i));
+        tracker_.unwrap();
+    }
+
+    // The rate paths restarted at rest on the current angles, e.g. at an
+    // E-stop release with the wheel braked: the estimators start over at
+    // t_us and the low-pass holds zero, with no transient from before
+    void reseed(uint32_t t_us) {
+        for (int i = 0; i < 2; ++i) estimator_[i].reset(last_[i], t_us);
+        lpf_.flush();
+    }
+
+    float angle(int i) const { return last_[i]; }
+    // The driver's position of the last update(), motor turns
+    float position(int i) const { return tracker_.position(i); }
+    int32_t index(int i) const { return tracker_.index(i); }
+    float contactAngle(int i) const { return tracker_.contactAngle(i); }
+    RateMethod method(int i) const { return method_[i]; }
+
+private:
+    // the rate paths move with the angle, so a new zero is not a step in the rates
+    void moveZero(int i, float delta) {
+        last_[i] -= delta;
+        estimator_[i].shift(-delta);
+    }
+
+    SpokeTracker<Model> tracker_;
+
+    FixedFilterBank<2, RateFilter> lpf_;
+    VelocityEstimator estimator_[2];
+    RateMethod method_[2];
+    float direction_[2];
+    float last_[2] = {Model::alpha, Model::alpha};
+};
+
+#endif //SpokeEstimator_h
@@ -0,0 +1,94 @@
+#ifndef SpokeTracker_h
+#define SpokeTracker_h
+
+#include <math.h>
+#include <stdint.h>
+#include "RobotModel.h"
+
+/* Continuous multi-turn spoke angles of the two hip axes, in fixed point.
+*
+* Each channel keeps the whole spokes it moved since zero() in index() and
+* the angle from the nearest spoke, the in-contact angle in [-alpha, alpha),
+* as a signed fraction of the spoke spacing with frac_bits bits. Every
+* update() adds the motion since the last sample and carries whole spokes
+* into the index, so neither a long run nor a spoke change loses resolution
+* and the contact angle never needs a division or a hardware re-read.
+*
+* direction is the sign of the spoke angle per positive motor turn for each
+* axis; unlike -|pos| it keeps a spoke that rocks back across its zero.
+* Positions are the motor driver's turns, and a quantization remainder is
+* carried from sample to sample so the angle does not drift.
+*/
+template<class Model = RimlessWheelModel>
+class SpokeTracker {
+public:
+    static constexpr int frac_bits = 24;
+    static constexpr int32_t one = int32_t(1) << frac_bits; // a spoke spacing
+    static constexpr float unit = Model::spokeSpacing / one; // rad per step
+
+    SpokeTracker(float direction0 = -1.0f, float direction1 = -1.0f)
+        : direction_{direction0, direction1} {}
+
+    // pos in motor turns; a stale, repeated position is no motion
+    void update(const float* pos) {
+        for (int i = 0; i < 2; ++i) {
+            float steps = (pos[i] - pos_[i])*direction_[i]*(Model::turnToSpoke/Model::spokeSpacing*one) + residual_[i];
+            pos_[i] = pos[i];
+            // whole spokes first, so a jump (an ODrive reboot) cannot overflow the phase
+            float spokes = roundf(steps*(1.0f/one));
+            steps -= spokes*one;
+            int32_t step = (int32_t)lroundf(steps);
+            residual_[i] = steps - step;
+            index_[i] += (int32_t)spokes;
+            phase_[i] += step;
+            if (phase_[i] >= one/2) {
+                phase_[i] -= one;
+                ++index_[i];
+            } else if (phase_[i] < -one/2) {
+                phase_[i] += one;
+                --index_[i];
+            }
+        }
+    }
+
+    // The current positions are the zero from now on
+    void zero() {
+        for (int i = 0; i < 2; ++i) index_[i] = phase_[i] = 0, residual_[i] = 0.0f;
+    }
+
+    // The zero at the motor positions ref instead of the current ones, e.g. a stored reference
+    void zeroAt(const float* ref) {
+        float pos[2] = {pos_[0], pos_[1]};
+        zero();
+        pos_[0] = ref[0];
+        pos_[1] = ref[1];
+        update(pos);
+    }
+
+    // Drop the whole spokes, the contact angles stay
+    void unwrap() {
+        index_[0] = index_[1] = 0;
+    }
+
+    // The positions of the last update(), motor turns
+    float position(int i) const { return pos_[i]; }
+    // Whole spokes since zero(), rounded to the nearest
+    int32_t index(int i) const { return index_[i]; }
+    // In [-alpha, alpha), measured from the spoke index() counts
+    float contactAngle(int i) const { return phase_[i]*unit; }
+    // index()*spokeSpacing + contactAngle()
+    float angle(int i) const { return index_[i]*Model::spokeSpacing + phase_[i]*unit; }
+
+private:
+    float direction_[2];
+    float pos_[2] = {0.0f, 0.0f};
+    float residual_[2] = {0.0f, 0.0f};
+    int32_t index_[2] = {0, 0};
+    int32_t phase_[2] = {0, 0};
+};
+
+template<class Model> constexpr int SpokeTracker<Model>::frac_bits;
+template<class Model> constexpr int32_t SpokeTracker<Model>::one;
+template<class Model> constexpr float SpokeTracker<Model>::unit;
+
+#endif //SpokeTracker_h
@@ -0,0 +1,146 @@
+#ifndef TorsoEstimator_h
+#define TorsoEstimator_h
+
+#include <math.h>
+#include <stdint.h>
+#include "Vec3.h"
+#include "RobotModel.h"
+#include "RollEstimator.h"
+#include "VelocityEstimator.h"
+
+/* The torso half of the sense step, from fuseImuSample() and readIMU(): each
+* calibrated IMU sample is shifted to the COM and fused by Filter, and the
+* torso states come out as [roll, roll rate, yaw] in the robot's convention
+* (the torso turns about -x of the IMU).
+*
+* Filter is MahonyFilter or RollEstimator, or anything with their update(),
+* reset(), roll() and yaw() (and seed() for reseed()). Only Vec3 samples
+* cross in, so the same code runs behind the LSM6DS reads on the Teensy and
+* behind a log on the host.
+*
+* The shift's lever arm is Model's imuToCOMx/y/z, constants, so the cross
+* products of alpha x r + w x (w x r) are expanded for alpha = (alpha_x, 0,
+* 0) at compile time: w x (w x r) = w (w.r) - r |w|^2 and the alpha term is
+* two products, about half the multiplies of the general form; a zero lever
+* arm shifts nothing and leaves no code at all.
+*
+* The COM shift needs the torso's angular acceleration alpha_x, about the
+* IMU's x like the gyro. Without one from the model it is the derivative of
+* the gyro x rate, by the VelocityEstimator given (a quadratic's slope over a
+* few samples keeps most of the rate noise out of it), at the samples' real
+* spacing from the dt passed in; by default consecutive samples are
+* differenced.
+*
+* reseed() puts the filter straight on the attitude of the last accel
+* fused, e.g. at an E-stop release, instead of letting it converge there.
+*/
+
+// Linear acceleration at the COM from the IMU's; alpha_x is the torso's
+// angular acceleration, the robot taken as rigid in y and z. Arm has the
+// lever arm as static constexpr imuToCOMx/y/z (the IMU to the COM, m).
+template<class Arm, bool Zero = Arm::imuToCOMx == 0.0f && Arm::imuToCOMy == 0.0f && Arm::imuToCOMz == 0.0f>
+struct ComShift {
+    static inline Vec3 apply(const Vec3& accel, const Vec3& gyro, float alpha_x) {
+        constexpr float rx = Arm::imuToCOMx, ry = Arm::imuToCOMy, rz = Arm::imuToCOMz;
+        const float wr = gyro.x*rx + gyro.y*ry + gyro.z*rz;
+        const float ww = gyro.x*gyro.x + gyro.y*gyro.y + gyro.z*gyro.z;
+        // accel - (0, -alpha_x rz, alpha_x ry) - (w (w.r) - r |w|^2)
+        return Vec3(accel.x - gyro.x*wr + rx*ww,
+                    accel.y + alpha_x*rz - gyro.y*wr + ry*ww,
+                    accel.z - alpha_x*ry - gyro.z*wr + rz*ww);
+    }
+};
+template<class Arm>
+struct ComShift<Arm, true> {
+    static inline Vec3 apply(const Vec3& accel, const Vec3&, float) { return accel; }
+};
+
+template<class Arm = RimlessWheelModel>
+inline Vec3 comAcceleration(const Vec3& accel, const Vec3& gyro, float alpha_x) {
+    return ComShift<Arm>::apply(accel, gyro, alpha_x);
+}
+
+// Model supplies the lever arm, see comAcceleration()
+template<class Filter, class Model = RimlessWheelModel>
+class TorsoEstimator {
+public:
+    TorsoEstimator() : alpha_estimator_(VelocityEstimator::savitzkyGolay(2)), estimate_alpha_(false) {}
+    // alpha_x from alpha_estimator on the gyro x rate, e.g. VelocityEstimator::savitzkyGolay(5, 2)
+    explicit TorsoEstimator(const VelocityEstimator& alpha_estimator)
+        : alpha_estimator_(alpha_estimator), estimate_alpha_(true) {}
+
+    // One sample over dt seconds; gyro in rad/s, accel in m/s^2 (null for
+    // gyro-only integration), mag in uT. alpha_x is e.g. the model's; without
+    // it the gyro rate is differentiated.
+    void fuse(const Vec3& gyro, const Vec3* accel, const Vec3& mag, float dt, float alpha_x) {
+        const Vec3 acc_COM = accel ? comAcceleration<Model>(*accel, gyro, alpha_x) : Vec3();
+        filter_.update(gyro.x, gyro.y, gyro.z,
+                       acc_COM.x, acc_COM.y, acc_COM.z,
+                       mag.x, mag.y, mag.z, dt);
+        omega_ = -gyro.x;
+        alpha_x_ = alpha_x;
+        if (accel) accel_ = acc_COM;
+    }
+    void fuse(const Vec3& gyro, const Vec3* accel, const Vec3& mag, float dt) {
+        fuse(gyro, accel, mag, dt, estimateAlpha(gyro.x, dt));
+    }
+
+    // [roll, roll rate, yaw]; the rate is the gyro's, less the bias a RollEstimator tracks
+    void states(float* torso) {
+        torso[0] = -filter_.roll();
+        torso[1] = omega_ + bias(filter_);
+        torso[2] = filter_.yaw() - yaw_offset_;
+    }
+
+    // The filter seeded from the last accel fused (Filter::seed()), gyro
+    // history and yaw kept; nothing before the first accel
+    void reseed() { filter_.seed(accel_.x, accel_.y, accel_.z); }
+
+    // The current heading reads zero from now on
+    void zeroYaw() { yaw_offset_ = filter_.yaw(); }
+    // The filter's heading that reads zero, e.g. a stored one
+    void setYawOffset(float yaw) { yaw_offset_ = yaw; }
+    float yawOffset() const { return yaw_offset_; }
+
+    // states() reports this gyro x instead of the last fused sample's, e.g. a decimated one
+    void setRate(float gx) { omega_ = -gx; }
+
+    Filter& filter() { return filter_; }
+    float rate() const { return omega_; }
+    // alpha_x of the last sample, rad/s^2 about the IMU's x
+    float alpha() const { return alpha_x_; }
+
+private:
+    float estimateAlpha(float gx, float dt) {
+        if (!(dt > 0.0f))
+            return alpha_x_;
+        float alpha;
+        if (estimate_alpha_) {
+            // the estimator takes stamps; dt accumulated to the us keeps the real spacing
+            clock_us_ += (uint32_t)lroundf(dt * 1e6f);
+            alpha = alpha_estimator_.update(gx, clock_us_);
+        } else {
+            alpha = started_ ? (gx - last_gx_) / dt : 0.0f;
+        }
+        last_gx_ = gx;
+        started_ = true;
+        return alpha;
+    }
+
+    // -(gx - bias) for the Kalman roll, the plain gyro otherwise
+    template<class Config> static float bias(RollEstimator<Config>& f) { return f.bias(); }
+    template<class Other> static float bias(Other&) { return 0.0f; }
+
+    Filter filter_;
+    VelocityEstimator alpha_estimator_;
+    bool estimate_alpha_;
+    bool started_ = false;
+    uint32_t clock_us_ = 0;
+    float last_gx_ = 0.0f;
+    float alpha_x_ = 0.0f;
+    float omega_ = 0.0f;
+    float yaw_offset_ = 0.0f;
+    Vec3 accel_;
+};
+
+#endif //TorsoEstimator_h
@@ -0,0 +1,58 @@
+#ifndef ActuatorModel_h
+#define ActuatorModel_h
+
+#include <math.h>
+#include "RobotModel.h"
+
+/* The hip drive between the controllers and the motor driver, in one place:
+* the signs of the mirrored pair, the gearing, its efficiency and the
+* saturation, all fixed at compile time.
+*
+* Torque side: command() takes the controller's one logical torque, clamps
+* it at the saturation (satu of the Julia scripts) and fans it out to the
+* motors, axis 0 with the negative; with joint_torque it is a torque at the
+* spoke, so it goes through the gear ratio and the efficiency on the way.
+* feedforward() does the same for a model torque at the spoke shared by the
+* two motors (the torso's gravity torque), always through the gearing and
+* unclamped. Both give Nm at the motor shaft, what input_torque takes with
+* torqueConstant set on the ODrive.
+*
+* Encoder side: direction(i) is the spoke angle sign per positive motor turn
+* of axis i, handed to SpokeEstimator, which scales the turns by
+* Model::turnToSpoke.
+*/
+template<class Model = RimlessWheelModel>
+class ActuatorModel {
+public:
+    // efficiency: of the gearing driving the spoke, 1 for none lost
+    constexpr ActuatorModel(bool joint_torque, float efficiency, float saturation,
+                            float direction0, float direction1)
+        : scale_(joint_torque ? Model::gearRatio/efficiency : 1.0f),
+          gear_(Model::gearRatio/efficiency), saturation_(saturation),
+          direction_{direction0, direction1} {}
+
+    // The controller's torque as the mirrored pair of motor torques
+    inline void command(float torque, float motor[2]) const {
+        float t = fminf(fmaxf(torque, -saturation_), saturation_)*scale_;
+        motor[0] = -t;
+        motor[1] = t;
+    }
+
+    // A torque at the spoke, half on each motor, mirrored like command()
+    inline void feedforward(float joint, float motor[2]) const {
+        float t = 0.5f*joint*gear_;
+        motor[0] = -t;
+        motor[1] = t;
+    }
+
+    constexpr float direction(int axis) const { return direction_[axis]; }
+    constexpr float saturation() const { return saturation_; }
+
+private:
+    float scale_;
+    float gear_;
+    float saturation_;
+    float direction_[2];
+};
+
+#endif //ActuatorModel_h
@@ -0,0 +1,111 @@
+#ifndef RobotModel_h
+#define RobotModel_h
+
+#include <math.h>
+
+/* The rimless wheel, once: masses, lengths and inertias of the wheel (1) and
+* torso (2), the spoke geometry and the drive. main.cpp, the EKF model
+* (src/RimlessWheelModel.h), ImpactMap and the host tools all read these, and
+* julia_pkg/src/robotModel.jl mirrors the ones the Julia scripts need.
+*
+* Everything is constexpr, including the derived terms below, so a consumer
+* that multiplies by them gets an immediate instead of a load and a
+* recomputation. With c = cos(theta - phi) the mass matrix of the stance
+* phase is
+*
+*     M(q) = [ M11      M12 c ]     det M = -(M11 M22 - M12^2 c^2)
+*            [ M12 c    M22   ]
+*
+* (the sign of alphaDynamics()), and the gravity terms are G1 sin(theta -
+* incline) and G2 sin(phi - incline).
+*
+* The spoke count is a template parameter, so each wheel build is its own
+* type and firmware: RimlessWheelModel is the build picked by WHEEL_SPOKES
+* (10 unless the build flags say otherwise, see platformio.ini), and
+* wrapSpoke() reduces an angle by the spacing with a multiply by its folded
+* reciprocal instead of an fmod.
+*/
+#ifndef WHEEL_SPOKES
+  #define WHEEL_SPOKES 10
+#endif
+
+template<int Spokes>
+struct RimlessWheelBuild {
+    static_assert(Spokes >= 3, "a rimless wheel needs at least three spokes");
+
+    static constexpr float m1 = 1.13f;
+    static constexpr float m2 = 3.385f;
+    static constexpr float l1 = 0.3f;
+    static constexpr float l2 = 0.06f;
+    static constexpr float I1 = 0.0885f/2.0f;
+    static constexpr float I2 = m2*l2*l2/3.0f;
+    static constexpr float W = 0.026f;        // IMU to torso COM
+    // IMU to torso COM in the IMU's frame, m, for the COM shift of the
+    // accel (lib/RobotCore/TorsoEstimator.h). W long, but its direction was
+    // never measured, so zero (no shift) as in the original sketch; with all
+    // three zero the shift compiles away.
+    static constexpr float imuToCOMx = 0.0f;
+    static constexpr float imuToCOMy = 0.0f;
+    static constexpr float imuToCOMz = 0.0f;
+    static constexpr float g = 9.81f;
+    static constexpr float incline = 0.0f;
+    static constexpr int spokes = Spokes;
+    static constexpr float k = (float)Spokes;
+    static constexpr float alpha = 360.0f/k/2.0f * M_PI/180.0f;
+
+    static constexpr float Kv = 0.13f;
+    static constexpr float gearRatio = 1.0f/6.0f;
+    static constexpr float torqueConstant = 8.23f/210.0f;
+
+    static constexpr float mt = m1 + m2;
+    static constexpr float spokeSpacing = 2.0f*alpha;
+    static constexpr float uprightSpokeAngle = M_PI; // inputLayer()'s spoke angle at the upright contact
+    static constexpr float turnToSpoke = 2.0f*M_PI*gearRatio; // rad of spoke per motor turn
+
+    static constexpr float M11 = I1 + mt*l1*l1;
+    static constexpr float M22 = I2 + m2*l2*l2;
+    static constexpr float M12 = m2*l1*l2;
+    static constexpr float det0 = -M11*M22;
+    static constexpr float det1 = M12*M12;
+    static constexpr float G1 = g*mt*l1;
+    static constexpr float G2 = g*m2*l2;
+
+    // theta - n spokeSpacing in [-alpha, alpha], n the nearest whole spoke
+    static inline float wrapSpoke(float theta) { return theta - spokeSpacing*spokeCount(theta); }
+    // whole spokes in theta, rounded to nearest
+    static inline float spokeCount(float theta) { return roundf(theta*(1.0f/spokeSpacing)); }
+};
+
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::m1;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::m2;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::l1;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::l2;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::I1;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::I2;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::W;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::imuToCOMx;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::imuToCOMy;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::imuToCOMz;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::g;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::incline;
+template<int Spokes> constexpr int RimlessWheelBuild<Spokes>::spokes;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::k;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::alpha;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::Kv;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::gearRatio;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::torqueConstant;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::mt;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::spokeSpacing;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::uprightSpokeAngle;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::turnToSpoke;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::M11;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::M22;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::M12;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::det0;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::det1;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::G1;
+template<int Spokes> constexpr float RimlessWheelBuild<Spokes>::G2;
+
+typedef RimlessWheelBuild<WHEEL_SPOKES> RimlessWheelModel;
+
+#endif //RobotModel_h
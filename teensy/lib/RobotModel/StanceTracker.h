@@ -0,0 +1,71 @@
+#ifndef StanceTracker_h
+#define StanceTracker_h
+
+#include <math.h>
+#include <stdint.h>
+#include "RobotModel.h"
+
+/* Which spoke is in stance, from the continuous spoke angle, and the
+* network's state [torso angle, spoke angle, torso rate, spoke rate] for it.
+*
+* The stance spoke is the nearest whole spoke, but it only changes once the
+* angle from it has passed +-alpha by hysteresis rad, so a wheel rocking on
+* the point of an impact, or encoder noise there, does not flip it back and
+* forth tick by tick. The check is one compare each way; a jump of several
+* spokes (an unwrap, a zero) re-rounds, so update() is O(1) either way.
+*
+* One tracker per axis in spokeStates = [angle 0, angle 1, rate 0, rate 1],
+* SpokeEstimator's layout, which /sensors also carries; the controllers read
+* axis 0. Shared by the firmware and the Pi (pbc_controller's
+* ~contact_angle); nothing here allocates or touches hardware.
+*/
+template<class Model = RimlessWheelModel>
+class StanceTracker {
+public:
+    explicit StanceTracker(float hysteresis = 0.0f, int axis = 0)
+        : hysteresis_(hysteresis), axis_(axis) {}
+
+    // true when the stance spoke changed, the spoke touchdown
+    bool update(const float spokeStates[4]) {
+        float angle = spokeStates[axis_];
+        rate_ = spokeStates[2 + axis_];
+        float contact = angle - Model::spokeSpacing*index_;
+        if (!started_ || fabsf(contact) > Model::spokeSpacing + Model::alpha) {
+            // first sample, or a whole-spoke move of the angles: no touchdown
+            index_ = (int32_t)Model::spokeCount(angle);
+            contact_ = angle - Model::spokeSpacing*index_;
+            started_ = true;
+            return false;
+        }
+        int32_t step = contact >= Model::alpha + hysteresis_ ? 1 : (contact < -Model::alpha - hysteresis_ ? -1 : 0);
+        index_ += step;
+        contact_ = contact - Model::spokeSpacing*step;
+        return step != 0;
+    }
+
+    // The next update() re-rounds, e.g. after SpokeEstimator::unwrap() or zero()
+    void reset() { started_ = false; }
+
+    // The stance spoke, whole spokes since the angle's zero
+    int32_t index() const { return index_; }
+    // From the stance spoke, in [-alpha - hysteresis, alpha + hysteresis)
+    float contactAngle() const { return contact_; }
+
+    // inputLayer()'s state, measured from the upright contact as in evaluatePbc.jl's update_state!
+    inline void features(const float torsoStates[2], float x[4]) const {
+        x[0] = torsoStates[0];
+        x[1] = Model::uprightSpokeAngle + contact_;
+        x[2] = torsoStates[1];
+        x[3] = rate_;
+    }
+
+private:
+    float hysteresis_;
+    int axis_;
+    bool started_ = false;
+    int32_t index_ = 0;
+    float contact_ = 0.0f;
+    float rate_ = 0.0f;
+};
+
+#endif //StanceTracker_h
@@ -0,0 +1,165 @@
+#ifndef TerrainEstimator_h
+#define TerrainEstimator_h
+
+#include <math.h>
+#include <stdint.h>
+#include "RobotModel.h"
+
+/* The ground under the wheel from where each touchdown lands, so a
+* controller scheduled on it can change before the next spoke is down
+* rather than after the step that told it.
+*
+* On ground inclined by gamma (the model's incline, gravity acting through
+* sin(theta - incline)) both spokes of a touchdown are symmetric about the
+* ground normal, so the old stance spoke meets it at contact angle
+* s alpha + gamma, s the direction of travel. Each sensed touchdown thus
+* samples the incline under that step: the spoke angle at the touchdown's
+* time, interpolated between the encoder samples around it, less s alpha
+* from the old stance spoke. A crossing of +-alpha carries no such
+* information, it is only where a flat floor's touchdown would be, so the
+* time handed to impact() should be ImpactDetector::touchdownTime_us().
+*
+* The samples go through an alpha-beta (Holt) filter over touchdowns: a
+* level, the incline, and a trend per step, whose sum predicts the next
+* touchdown's. A sample further than obstacle rad from the prediction is an
+* obstacle (a bump, a hole, an edge); it moves the filter by at most that
+* much, so one stone does not tilt the estimate while a new slope, seen on
+* step after step, is followed in a few. Samples beyond max_incline are not
+* the ground, say a touchdown sensed mid-stance, and are rejected. An
+* exponential mean of the squared residuals is the roughness.
+*
+*     TerrainEstimator<Robot> terrain;
+*     terrain.update(spokeStates[0], spokeStates[2], stamp_us);   // each tick
+*     if (impactSensed) terrain.impact(impactDetector.touchdownTime_us());
+*     pbcSchedule = terrain.predicted();
+*
+* update() and impact() are O(1) and allocate nothing.
+*/
+template<class Model = RimlessWheelModel>
+class TerrainEstimator {
+public:
+    // gain and trend_gain per touchdown, obstacle and max_incline in rad
+    TerrainEstimator(float gain = 0.3f, float trend_gain = 0.05f, float obstacle = 0.05f, float max_incline = 0.3f)
+        : gain_(gain), trend_gain_(trend_gain), obstacle_(obstacle), max_incline_(max_incline) {}
+
+    // The continuous spoke angle and rate once per tick, before impact() on the same tick
+    void update(float theta, float thetadot, uint32_t t_us) {
+        if (!started_ || fabsf(theta - Model::spokeSpacing*stance_) > Model::spokeSpacing + Model::alpha) {
+            // first sample, or a whole-spoke move of the angle (a zero, an unwrap)
+            stance_ = (int32_t)Model::spokeCount(theta);
+            theta0_ = theta;
+            rate0_ = thetadot;
+            t0_us_ = t_us;
+            started_ = true;
+        } else {
+            theta0_ = theta1_;
+            rate0_ = rate1_;
+            t0_us_ = t1_us_;
+        }
+        theta1_ = theta;
+        rate1_ = thetadot;
+        t1_us_ = t_us;
+    }
+
+    // A sensed touchdown at touchdown_us; false if its sample was rejected
+    bool impact(uint32_t touchdown_us) {
+        if (!started_ || rate0_ == 0.0f)
+            return false;
+        const float s = rate0_ > 0.0f ? 1.0f : -1.0f;
+
+        // the angle is continuous through a touchdown, only its rate jumps
+        float theta;
+        int32_t span = (int32_t)(t1_us_ - t0_us_), into = (int32_t)(touchdown_us - t0_us_);
+        if (into < 0 || span <= 0) theta = theta0_ + rate0_*into*1e-6f;
+        else if (into >= span) theta = theta1_;
+        else theta = theta0_ + (theta1_ - theta0_)*((float)into/(float)span);
+
+        const float old = Model::spokeCount(theta - s*Model::alpha);
+        const float sample = theta - Model::spokeSpacing*old - s*Model::alpha;
+        if (fabsf(sample) > max_incline_) {
+            ++rejected_;
+            return false;
+        }
+        stance_ = (int32_t)old + (int32_t)s;
+
+        if (impacts_ == 0) {
+            level_ = sample;
+            trend_ = 0.0f;
+            residual_ = 0.0f;
+            obstacle_seen_ = false;
+        } else {
+            const float prediction = level_ + trend_;
+            residual_ = sample - prediction;
+            obstacle_seen_ = fabsf(residual_) > obstacle_;
+            if (obstacle_seen_) ++obstacles_;
+            const float r = residual_ > obstacle_ ? obstacle_ : (residual_ < -obstacle_ ? -obstacle_ : residual_);
+            level_ = prediction + gain_*r;
+            trend_ += trend_gain_*r;
+            variance_ += gain_*(residual_*residual_ - variance_);
+
+            float stride_s = (touchdown_us - last_us_)*1e-6f;
+            if (stride_s < 2.0f)
+                stride_s_ = strides_++ == 0 ? stride_s : stride_s_ + gain_*(stride_s - stride_s_);
+        }
+        sample_ = sample;
+        direction_ = s;
+        last_us_ = touchdown_us;
+        ++impacts_;
+        return true;
+    }
+
+    void reset() {
+        started_ = false;
+        impacts_ = obstacles_ = rejected_ = strides_ = 0;
+        level_ = trend_ = variance_ = residual_ = sample_ = stride_s_ = 0.0f;
+        obstacle_seen_ = false;
+    }
+
+    // The ground's incline, rad, and the one expected under the next touchdown
+    float incline() const { return level_; }
+    float predicted() const { return level_ + trend_; }
+    // RMS of the touchdowns about their prediction, rad
+    float roughness() const { return sqrtf(variance_); }
+    // The last touchdown's own incline, and how far it was from its prediction
+    float lastIncline() const { return sample_; }
+    float residual() const { return residual_; }
+    // The last touchdown was an obstacle, and its height over the predicted
+    // ground, m, up in the direction of travel: 2 l1 sin(alpha) chords apart
+    bool obstacle() const { return obstacle_seen_; }
+    float stepHeight() const {
+        return -2.0f*direction_*Model::l1*sinf(Model::alpha)*(sinf(sample_) - sinf(sample_ - residual_));
+    }
+    // Mean time between touchdowns, s, over strides shorter than 2 s; 0 before two
+    float stride_s() const { return stride_s_; }
+
+    // Seconds from the last update() until the next spoke lands on the predicted
+    // incline at the current rate; negative if the wheel is not heading there
+    float timeToImpact() const {
+        if (!started_ || rate1_ == 0.0f)
+            return -1.0f;
+        const float s = rate1_ > 0.0f ? 1.0f : -1.0f;
+        const float ahead = Model::spokeSpacing*stance_ + s*Model::alpha + predicted() - theta1_;
+        return ahead*s > 0.0f ? ahead/rate1_ : -1.0f;
+    }
+
+    uint32_t impacts() const { return impacts_; }
+    uint32_t obstacles() const { return obstacles_; }
+    uint32_t rejected() const { return rejected_; }
+
+private:
+    float gain_, trend_gain_, obstacle_, max_incline_;
+
+    bool started_ = false;
+    int32_t stance_ = 0;
+    float theta0_ = 0.0f, rate0_ = 0.0f, theta1_ = 0.0f, rate1_ = 0.0f;
+    uint32_t t0_us_ = 0, t1_us_ = 0;
+
+    float level_ = 0.0f, trend_ = 0.0f, variance_ = 0.0f;
+    float sample_ = 0.0f, residual_ = 0.0f, direction_ = 1.0f;
+    bool obstacle_seen_ = false;
+    uint32_t last_us_ = 0;
+    float stride_s_ = 0.0f;
+    uint32_t impacts_ = 0, obstacles_ = 0, rejected_ = 0, strides_ = 0;
+};
+
+#endif //TerrainEstimator_h
@@ -0,0 +1,122 @@
+#ifndef TransportMeter_h
+#define TransportMeter_h
+
+#include <math.h>
+#include <stdint.h>
+#include "RobotModel.h"
+#include "StanceTracker.h"
+
+/* The hips' work and the cost of transport of every step, for comparing
+* controllers by what they spend rather than only by how they walk.
+*
+* Each tick the shaft power of each motor, Iq Kt w with w the motor's own
+* rate (rad/s, the ODrive's sign, so a motor driven backwards reads
+* negative), is integrated over the tick into whole microjoules. The sums
+* are integers, so a step's energy is exact to the microjoule however many
+* ticks it spans, and a run's total neither drifts nor loses the small
+* ticks once it is large, as a float sum would. Positive work is what the
+* motors put in; the negative, regenerated work goes to the ODrive's brake
+* resistor and is not recovered, so the cost of transport of a step is its
+* positive work over m g d, the wheel's weight times the chord it moved.
+* The net work is kept beside it.
+*
+* A step is touchdown to touchdown, StanceTracker's change of stance spoke
+* with its hysteresis. A tick that is not valid (E-stop, calibration, an
+* ODrive reset) drops the step in progress and the next touchdown starts
+* one, as it does after a gap of more than max_gap_us between ticks.
+*
+*     TransportMeter<Robot> transport(STANCE_HYSTERESIS, torqueConstant);
+*     if (transport.update(stamp_us, current, motorRate, spokeStates, valid))
+*         publish(transport.last());                      // a step closed
+*
+* update() is O(1), allocates nothing and is for the control step only;
+* copy last() out with interrupts off.
+*/
+template<class Model = RimlessWheelModel>
+class TransportMeter {
+public:
+    struct Step {
+        uint32_t duration_us;
+        int32_t spokes;        // whole spokes moved, negative backwards
+        int64_t positive_uj;   // both motors, the ticks they drove the wheel
+        int64_t net_uj;        // less what they took back
+        float cost;            // positive work over m g d, NaN for a step that went nowhere
+    };
+
+    TransportMeter(float hysteresis, float torque_constant, uint32_t max_gap_us = 50000)
+        : tracker_(hysteresis), kt_(torque_constant), max_gap_us_(max_gap_us) {}
+
+    // current: Iq_measured of both axes (A); motor_rate: each shaft's rad/s in
+    // the same sign; spokeStates: SpokeEstimator's. True when this tick's
+    // touchdown closed a whole step, in last()
+    bool update(uint32_t t_us, const float current[2], const float motor_rate[2],
+                const float spokeStates[4], bool valid) {
+        if (!valid) {
+            in_step_ = false;
+            started_ = false;
+            tracker_.reset();
+            return false;
+        }
+        uint32_t dt_us = t_us - last_us_;
+        bool gap = !started_ || dt_us > max_gap_us_;
+        last_us_ = t_us;
+        started_ = true;
+        if (gap) {
+            in_step_ = false;
+        } else if (in_step_) {
+            // W over us is uJ; a tick at the motors' limits is well inside an int32
+            for (int axis = 0; axis < 2; ++axis) {
+                int32_t uj = (int32_t)lrintf(current[axis]*kt_*motor_rate[axis]*(float)dt_us);
+                net_uj_ += uj;
+                if (uj > 0) positive_uj_ += uj;
+            }
+        }
+        bool closed = false;
+        if (tracker_.update(spokeStates)) {
+            if (in_step_) {
+                last_.duration_us = t_us - start_us_;
+                last_.spokes = tracker_.index() - start_index_;
+                last_.positive_uj = positive_uj_;
+                last_.net_uj = net_uj_;
+                float distance = fabsf((float)last_.spokes)*chord();
+                last_.cost = distance > 0.0f ? (float)positive_uj_*1e-6f/(Model::mt*Model::g*distance) : NAN;
+                total_positive_uj_ += positive_uj_;
+                total_spokes_ += last_.spokes < 0 ? -last_.spokes : last_.spokes;
+                ++steps_;
+                closed = true;
+            }
+            in_step_ = true;
+            start_us_ = t_us;
+            start_index_ = tracker_.index();
+            positive_uj_ = net_uj_ = 0;
+        }
+        return closed;
+    }
+
+    // m the wheel moves for a spoke, the chord between two feet
+    static float chord() { return 2.0f*Model::l1*sinf(Model::alpha); }
+
+    const Step& last() const { return last_; }
+    uint32_t steps() const { return steps_; }
+    // Over every step closed so far, NaN before the first that moved
+    float runCost() const {
+        return total_spokes_ > 0 ? (float)total_positive_uj_*1e-6f/(Model::mt*Model::g*total_spokes_*chord()) : NAN;
+    }
+
+private:
+    StanceTracker<Model> tracker_;
+    float kt_;
+    uint32_t max_gap_us_;
+    bool started_ = false;
+    bool in_step_ = false;
+    uint32_t last_us_ = 0;
+    uint32_t start_us_ = 0;
+    int32_t start_index_ = 0;
+    int64_t positive_uj_ = 0, net_uj_ = 0;
+    int64_t total_positive_uj_ = 0;
+    uint32_t total_spokes_ = 0;
+    uint32_t steps_ = 0;
+    Step last_ = {0, 0, 0, 0, NAN};
+};
+
+#endif //TransportMeter_h
@@ -0,0 +1,130 @@
+#ifndef RollEstimator_h
+#define RollEstimator_h
+
+#include <math.h>
+#include <FastMath.h>
+
+/* Reduced-order attitude estimator for the rimless wheel, a drop-in for
+* MahonyFilter when only roll, its rate and a yaw offset are used.
+*
+* Roll and gyro x bias are a 2-state Kalman filter: the gyro drives the
+* prediction and atan2(ay, az) of the (COM-shifted) accel is the measurement.
+* Pitch is taken as zero, which is what the torso's single joint allows, so
+* roll rate is gx and yaw rate is gy sin(roll) + gz cos(roll). Yaw is that
+* rate integrated and pulled toward the roll-compensated magnetometer heading
+* with a first-order gain. Angles follow MahonyFilter (ZYX, radians), so
+* torsoStates do not change meaning.
+*
+* The first sample with a valid accel sets roll directly; reset() after an
+* E-stop re-arms that, so the estimate does not have to converge from the
+* stale state. The trig is FastMath's, not libm's, so the Teensy and the
+* host's replay agree on it to the bit.
+*
+*     struct TorsoRoll {
+*         static constexpr float period = 0.01f;   // s
+*         static constexpr float q_angle = 1e-3f;  // roll process noise, rad^2/s
+*         static constexpr float q_bias = 3e-6f;   // bias random walk, (rad/s)^2/s
+*         static constexpr float r_angle = 3e-2f;  // accel roll noise, rad^2
+*         static constexpr float yaw_gain = 0.5f;  // 1/s toward the mag heading
+*     };
+*/
+template<class Config>
+class RollEstimator {
+public:
+    static constexpr float period = Config::period;
+
+    RollEstimator() { reset(); }
+
+    void reset() {
+        roll_ = yaw_ = bias_ = 0.0f;
+        p00_ = p11_ = 1.0f;
+        p01_ = p10_ = 0.0f;
+        have_roll_ = have_yaw_ = false;
+    }
+
+    // Roll straight from the accel, as the first sample after reset() takes
+    // it, with the covariance of a fresh start; bias and yaw are kept
+    void seed(float ax, float ay, float az) {
+        (void)ax;
+        if (ay == 0.0f && az == 0.0f)
+            return;
+        roll_ = fastmath::atan2(ay, az);
+        p00_ = p11_ = 1.0f;
+        p01_ = p10_ = 0.0f;
+        have_roll_ = true;
+    }
+
+    void update(float gx, float gy, float gz, float ax, float ay, float az,
+                float mx, float my, float mz) {
+        update(gx, gy, gz, ax, ay, az, mx, my, mz, period);
+    }
+
+    // Same arguments as MahonyFilter::update(); ax alone is not used
+    void update(float gx, float gy, float gz, float ax, float ay, float az,
+                float mx, float my, float mz, float dt) {
+        (void)ax;
+        float s, c;
+        fastmath::sincos(roll_, s, c);
+        yaw_ = wrap(yaw_ + (gy * s + gz * c) * dt);
+
+        // predict
+        roll_ = wrap(roll_ + (gx - bias_) * dt);
+        p00_ += dt * (dt * p11_ - p01_ - p10_ + Config::q_angle);
+        p01_ -= dt * p11_;
+        p10_ -= dt * p11_;
+        p11_ += Config::q_bias * dt;
+
+        // correct with the accel roll
+        if (!(ay == 0.0f && az == 0.0f)) {
+            float measured = fastmath::atan2(ay, az);
+            if (!have_roll_) {
+                roll_ = measured;
+                have_roll_ = true;
+            } else {
+                float innovation = wrap(measured - roll_);
+                float k0 = p00_ / (p00_ + Config::r_angle);
+                float k1 = p10_ / (p00_ + Config::r_angle);
+                roll_ = wrap(roll_ + k0 * innovation);
+                bias_ += k1 * innovation;
+                float p00 = p00_, p01 = p01_;
+                p00_ -= k0 * p00;
+                p01_ -= k0 * p01;
+                p10_ -= k1 * p00;
+                p11_ -= k1 * p01;
+            }
+            fastmath::sincos(roll_, s, c);
+        }
+
+        // heading of the field rotated back to level, pitch taken as zero
+        if (!(mx == 0.0f && my == 0.0f && mz == 0.0f)) {
+            float heading = fastmath::atan2(-fmaf(my, c, -mz * s), mx);
+            if (!have_yaw_) {
+                yaw_ = heading;
+                have_yaw_ = true;
+            } else {
+                yaw_ = wrap(yaw_ + Config::yaw_gain * dt * wrap(heading - yaw_));
+            }
+        }
+    }
+
+    float roll() const { return roll_; }
+    float pitch() const { return 0.0f; }
+    float yaw() const { return yaw_; }
+    // Estimated gyro x bias, rad/s
+    float bias() const { return bias_; }
+
+private:
+    static float wrap(float angle) {
+        if (angle > (float)M_PI) return angle - 2.0f * (float)M_PI;
+        if (angle < -(float)M_PI) return angle + 2.0f * (float)M_PI;
+        return angle;
+    }
+
+    float roll_, yaw_, bias_;
+    float p00_, p01_, p10_, p11_;
+    bool have_roll_, have_yaw_;
+};
+
+template<class Config> constexpr float RollEstimator<Config>::period;
+
+#endif //RollEstimator_h
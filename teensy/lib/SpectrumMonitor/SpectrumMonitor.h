@@ -0,0 +1,168 @@
+#ifndef SpectrumMonitor_h
+#define SpectrumMonitor_h
+
+#include "Arduino.h"
+#include <math.h>
+
+/* Vibration energy in a few frequency bands, for condition monitoring: a
+* drivetrain that works loose shows up as energy growing at its rattle and
+* the wheel's harmonics long before it shows in the control.
+*
+* The control step push()es one value per IMU sample (the accel magnitude)
+* into a ring and is done. service() in loop() runs the queued samples
+* through a Goertzel recursion per band, s = x + c*s1 - s2, one multiply-add
+* per band and sample, and stops when its time budget is spent; what it
+* leaves waits for the next call, and what the ring cannot hold is dropped
+* and counted, never waited for. Each block of block samples ends in every
+* band's power,
+*
+*     P = (s1^2 + s2^2 - c*s1*s2) * (2/block)^2
+*
+* the squared amplitude of a sinusoid at the band's centre, so the bands are
+* fs/block wide. Each sample has the last block's mean taken off first: the
+* gravity in the magnitude would otherwise leak into the lowest bands.
+* snapshot() hands over the mean and peak power per band since the last one.
+*
+* Bands at or above fs/2 are not run and read 0. push() is for one context
+* (the control interrupt), everything else for loop().
+*/
+template<uint8_t Bands, uint16_t Capacity>
+class SpectrumMonitor {
+public:
+    static_assert((Capacity & (Capacity - 1)) == 0, "the ring index wraps with a mask");
+    static constexpr uint8_t bands = Bands;
+
+    struct Window {
+        uint32_t blocks;
+        uint32_t dropped;   // samples since boot the ring had no room for
+        float mean[Bands];  // (m/s^2)^2, or the pushed unit squared
+        float peak[Bands];
+    };
+
+    SpectrumMonitor(const float (&hz)[Bands], float fs, uint16_t block) : block_(block) {
+        for (uint8_t b = 0; b < Bands; ++b) hz_[b] = hz[b];
+        setRate(fs);
+    }
+
+    // The sample rate of what push() gets; starts over from an empty ring
+    void setRate(float fs) {
+        fs_ = fs;
+        for (uint8_t b = 0; b < Bands; ++b) {
+            active_[b] = hz_[b] > 0.0f && hz_[b] < 0.5f*fs;
+            coeff_[b] = active_[b] ? 2.0f*cosf(2.0f*(float)M_PI*hz_[b]/fs) : 0.0f;
+        }
+        __atomic_store_n(&tail_, __atomic_load_n(&head_, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+        restart();
+        offset_ = 0.0f;
+        primed_ = false;
+        clearWindow();
+    }
+
+    // From the control step; false, and counted, when the ring is full
+    bool push(float x) {
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+        if (head - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE) >= Capacity) {
+            __atomic_fetch_add(&dropped_, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        ring_[head & (Capacity - 1)] = x;
+        __atomic_store_n(&head_, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // From loop(): the queued samples for at most budget_us; returns how many were run
+    uint32_t service(uint32_t budget_us) {
+        const uint32_t start = micros();
+        uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+        const uint32_t head = __atomic_load_n(&head_, __ATOMIC_ACQUIRE);
+        uint32_t run = 0;
+        while (tail != head) {
+            // the clock is read once per 16 samples, a few us of work each
+            if ((run & 15) == 0 && run > 0 && micros() - start >= budget_us) break;
+            float x = ring_[tail & (Capacity - 1)];
+            ++tail;
+            ++run;
+            if (!primed_) {
+                offset_ = x;
+                primed_ = true;
+            }
+            x -= offset_;
+            sum_ += x;
+            for (uint8_t b = 0; b < Bands; ++b) {
+                const float s = x + coeff_[b]*s1_[b] - s2_[b];
+                s2_[b] = s1_[b];
+                s1_[b] = s;
+            }
+            if (++count_ == block_) endBlock();
+        }
+        __atomic_store_n(&tail_, tail, __ATOMIC_RELEASE);
+        return run;
+    }
+
+    // The mean and peak power per band since the last snapshot, and starts a new window
+    void snapshot(Window& window) {
+        window.blocks = window_blocks_;
+        window.dropped = __atomic_load_n(&dropped_, __ATOMIC_RELAXED);
+        for (uint8_t b = 0; b < Bands; ++b) {
+            window.mean[b] = window_blocks_ > 0 ? window_sum_[b]/window_blocks_ : 0.0f;
+            window.peak[b] = window_peak_[b];
+        }
+        clearWindow();
+    }
+
+    float hz(uint8_t b) const { return hz_[b]; }
+    float rate() const { return fs_; }
+    uint16_t block() const { return block_; }
+    uint32_t pending() const { return __atomic_load_n(&head_, __ATOMIC_ACQUIRE) - tail_; }
+
+private:
+    void endBlock() {
+        const float scale = 4.0f/((float)block_*block_);
+        for (uint8_t b = 0; b < Bands; ++b) {
+            float p = 0.0f;
+            if (active_[b]) p = (s1_[b]*s1_[b] + s2_[b]*s2_[b] - coeff_[b]*s1_[b]*s2_[b])*scale;
+            window_sum_[b] += p;
+            if (p > window_peak_[b]) window_peak_[b] = p;
+        }
+        ++window_blocks_;
+        offset_ += sum_/block_;
+        restart();
+    }
+
+    void restart() {
+        for (uint8_t b = 0; b < Bands; ++b) s1_[b] = s2_[b] = 0.0f;
+        count_ = 0;
+        sum_ = 0.0f;
+    }
+
+    void clearWindow() {
+        window_blocks_ = 0;
+        for (uint8_t b = 0; b < Bands; ++b) window_sum_[b] = window_peak_[b] = 0.0f;
+    }
+
+    float hz_[Bands];
+    float coeff_[Bands];
+    bool active_[Bands];
+    float fs_ = 0.0f;
+    uint16_t block_;
+
+    // the ring: head_ moved by push() only, tail_ by service() and setRate()
+    float ring_[Capacity];
+    uint32_t head_ = 0;
+    uint32_t tail_ = 0;
+    uint32_t dropped_ = 0;
+
+    // the block under way
+    float s1_[Bands];
+    float s2_[Bands];
+    uint16_t count_ = 0;
+    float sum_ = 0.0f;
+    float offset_ = 0.0f;
+    bool primed_ = false;
+
+    uint32_t window_blocks_ = 0;
+    float window_sum_[Bands];
+    float window_peak_[Bands];
+};
+
+#endif //SpectrumMonitor_h
@@ -0,0 +1,68 @@
+#ifndef StatePredictor_h
+#define StatePredictor_h
+
+#include <math.h>
+#include <string.h>
+
+/* Forward prediction of a hybrid model's state over a latency, so a
+* controller acting on an old sample computes the torque for the state the
+* robot will be in when that torque lands rather than the one it was in when
+* the sample was taken.
+*
+* Model is the HybridEKF's (lib/HybridEKF): step() integrates the continuous
+* dynamics, guard() and jump() take the state across an event, e.g. the
+* rimless wheel's stance phase and impact in src/RimlessWheelModel.h. The
+* horizon is cut into equal substeps of at most max_step, each checked
+* against the guard, so an impact inside the latency is applied where it
+* happens; horizons beyond max_horizon are clamped, a stale sample is not
+* worth extrapolating that far.
+*
+* The input is held over the whole horizon, which is what the actuator does
+* with the previous command until the new one arrives. Nothing is kept
+* between calls, so the Pi's controller node can predict each /sensors
+* sample by its measured age, and on-device inference running slower than
+* the sensor rate can predict to the next NN tick.
+*/
+template<class Model, int MaxSubsteps = 32>
+class StatePredictor {
+public:
+    static constexpr int N = Model::num_states;
+
+    StatePredictor(float max_step = 0.002f, float max_horizon = 0.05f)
+        : max_step_(max_step), max_horizon_(max_horizon) {}
+
+    // out = x advanced by horizon seconds under the held input u; returns
+    // the events crossed on the way
+    int predict(const float* x, float u, float horizon, float* out) const {
+        memcpy(out, x, sizeof(float)*N);
+        if (!(horizon > 0.0f))
+            return 0;
+        if (horizon > max_horizon_)
+            horizon = max_horizon_;
+        int substeps = (int)ceilf(horizon/max_step_);
+        if (substeps > MaxSubsteps) substeps = MaxSubsteps;
+        if (substeps < 1) substeps = 1;
+        const float dt = horizon/substeps;
+
+        int events = 0;
+        float next[N];
+        for (int k = 0; k < substeps; ++k) {
+            Model::step(out, u, dt, next);
+            if (Model::guard(next)) {
+                Model::jump(next, out);
+                ++events;
+            } else {
+                memcpy(out, next, sizeof(next));
+            }
+        }
+        return events;
+    }
+
+    float maxHorizon() const { return max_horizon_; }
+
+private:
+    float max_step_;
+    float max_horizon_;
+};
+
+#endif //StatePredictor_h
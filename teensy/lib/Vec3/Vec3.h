@@ -0,0 +1,33 @@
+#ifndef Vec3_h
+#define Vec3_h
+
+/* Three floats by value. Everything is constexpr and inline, so results stay
+* in FPU registers instead of going through static scratch arrays, and two
+* results can never alias each other.
+*/
+struct Vec3 {
+    float x, y, z;
+
+    constexpr Vec3() : x(0.0f), y(0.0f), z(0.0f) {}
+    constexpr Vec3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+    // From a float[3], e.g. a calibrated sensor sample
+    static constexpr Vec3 from(const float* v) { return Vec3(v[0], v[1], v[2]); }
+
+    void to(float* v) const { v[0] = x; v[1] = y; v[2] = z; }
+};
+
+constexpr Vec3 operator+(const Vec3& a, const Vec3& b) { return Vec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+constexpr Vec3 operator-(const Vec3& a, const Vec3& b) { return Vec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+constexpr Vec3 operator-(const Vec3& a) { return Vec3(-a.x, -a.y, -a.z); }
+constexpr Vec3 operator*(float s, const Vec3& a) { return Vec3(s * a.x, s * a.y, s * a.z); }
+constexpr Vec3 operator*(const Vec3& a, float s) { return s * a; }
+
+constexpr float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+constexpr Vec3 cross(const Vec3& a, const Vec3& b) {
+    return Vec3(a.y * b.z - a.z * b.y,
+                a.z * b.x - a.x * b.z,
+                a.x * b.y - a.y * b.x);
+}
+
+#endif //Vec3_h
@@ -0,0 +1,116 @@
+#include <math.h>
+#include "VelocityEstimator.h"
+#include <Placement.h>
+
+constexpr uint8_t VelocityEstimator::max_window;
+
+VelocityEstimator::VelocityEstimator(Method method, float bandwidth_hz, uint8_t window, uint8_t degree)
+    : method_(method), omega_(2.0f * (float)M_PI * bandwidth_hz),
+      window_(window < 2 ? 2 : (window > max_window ? max_window : window)),
+      degree_(degree >= 2 ? 2 : 1) {
+    // a quadratic needs three points
+    if (degree_ == 2 && window_ < 3) window_ = 3;
+}
+
+VelocityEstimator VelocityEstimator::tracking(float bandwidth_hz) {
+    return VelocityEstimator(TRACKING, bandwidth_hz, 2, 1);
+}
+
+VelocityEstimator VelocityEstimator::savitzkyGolay(uint8_t window, uint8_t degree) {
+    return VelocityEstimator(SAVITZKY_GOLAY, 0.0f, window, degree);
+}
+
+void VelocityEstimator::reset(float position, uint32_t t_us) {
+    started_ = true;
+    last_us_ = t_us;
+    position_ = position;
+    velocity_ = 0.0f;
+    head_ = 0;
+    count_ = 1;
+    x_[0] = position;
+    t_[0] = t_us;
+}
+
+void VelocityEstimator::shift(float delta) {
+    position_ += delta;
+    for (uint8_t i = 0; i < count_; ++i)
+        x_[(uint8_t)((head_ + window_ - i) % window_)] += delta;
+}
+
+HOT_CODE float VelocityEstimator::update(float position, uint32_t t_us) {
+    if (!started_) {
+        reset(position, t_us);
+        return velocity_;
+    }
+    uint32_t elapsed = t_us - last_us_;
+    // a repeated timestamp carries no rate information
+    if (elapsed == 0) return velocity_;
+    last_us_ = t_us;
+
+    if (method_ == TRACKING) return updateTracking(position, elapsed * 1e-6f);
+
+    head_ = (uint8_t)((head_ + 1) % window_);
+    x_[head_] = position;
+    t_[head_] = t_us;
+    if (count_ < window_) ++count_;
+    return updateFit();
+}
+
+HOT_CODE float VelocityEstimator::updateTracking(float position, float dt) {
+    // double pole at r: z^2 - (2 - alpha - beta) z + (1 - alpha)
+    float r = expf(-omega_ * dt);
+    float alpha = 1.0f - r * r;
+    float beta = (1.0f - r) * (1.0f - r);
+
+    float predicted = position_ + velocity_ * dt;
+    float residual = position - predicted;
+    position_ = predicted + alpha * residual;
+    velocity_ += beta * residual / dt;
+    return velocity_;
+}
+
+HOT_CODE float VelocityEstimator::updateFit() {
+    // Least squares relative to the newest sample, time in units of the window
+    // span (t in [-1, 0]), which keeps the sums well conditioned in float
+    uint8_t degree = count_ > degree_ ? degree_ : count_ - 1;
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f, s4 = 0.0f;
+    float sx = 0.0f, stx = 0.0f, sttx = 0.0f;
+    float x0 = x_[head_];
+    uint32_t t0 = t_[head_];
+    uint32_t span_us = t0 - t_[(head_ + window_ - (count_ - 1)) % window_];
+    float span = span_us * 1e-6f;
+    float inv_span_us = 1.0f / (float)span_us;
+    for (uint8_t k = 0; k < count_; ++k) {
+        uint8_t i = (uint8_t)((head_ + window_ - k) % window_);
+        float t = -(float)(t0 - t_[i]) * inv_span_us;
+        float x = x_[i] - x0;
+        float tt = t * t;
+        s0 += 1.0f;
+        s1 += t;
+        s2 += tt;
+        s3 += tt * t;
+        s4 += tt * tt;
+        sx += x;
+        stx += t * x;
+        sttx += tt * x;
+    }
+
+    if (degree == 1) {
+        // x = c0 + c1 t, slope c1
+        float det = s0 * s2 - s1 * s1;
+        if (det <= 0.0f) return velocity_;
+        float c0 = (s2 * sx - s1 * stx) / det;
+        velocity_ = (s0 * stx - s1 * sx) / det / span;
+        position_ = x0 + c0;
+        return velocity_;
+    }
+
+    // x = c0 + c1 t + c2 t^2 by Cramer's rule; the slope at t = 0 is c1
+    float det = s0 * (s2 * s4 - s3 * s3) - s1 * (s1 * s4 - s3 * s2) + s2 * (s1 * s3 - s2 * s2);
+    if (fabsf(det) < 1e-12f) return velocity_;
+    float c0 = sx * (s2 * s4 - s3 * s3) - s1 * (stx * s4 - s3 * sttx) + s2 * (stx * s3 - s2 * sttx);
+    float c1 = s0 * (stx * s4 - s3 * sttx) - sx * (s1 * s4 - s3 * s2) + s2 * (s1 * sttx - stx * s2);
+    velocity_ = c1 / det / span;
+    position_ = x0 + c0 / det;
+    return velocity_;
+}
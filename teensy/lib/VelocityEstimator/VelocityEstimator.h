@@ -0,0 +1,69 @@
+#ifndef VelocityEstimator_h
+#define VelocityEstimator_h
+
+#include <stdint.h>
+
+/* Velocity of an encoder channel from timestamped positions, in place of
+* differencing over a nominal period and low-passing the result.
+*
+* TRACKING is an alpha-beta tracking loop, the discrete form of the ODrive's
+* encoder PLL: the prediction pos + vel*dt is corrected by the residual r with
+* pos += alpha*r, vel += beta*r/dt. The gains place a double pole at
+* exp(-2*pi*bandwidth*dt) for the measured dt of every sample, so the loop
+* stays critically damped when the period jitters and has no steady lag on a
+* constant velocity.
+*
+* SAVITZKY_GOLAY fits a polynomial of degree 1 or 2 by least squares to the
+* last window samples at their real timestamps and returns its slope at the
+* newest one: a causal Savitzky-Golay differentiator that does not assume a
+* uniform grid. Degree 2 has no lag on a constant acceleration and more noise.
+*
+* Positions in rad (or any unit), timestamps in us from micros(), which may
+* wrap. No Arduino dependency.
+*/
+class VelocityEstimator {
+public:
+    enum Method { TRACKING, SAVITZKY_GOLAY };
+    static constexpr uint8_t max_window = 16;
+
+    // TRACKING observer with the given closed-loop bandwidth
+    static VelocityEstimator tracking(float bandwidth_hz);
+    // SAVITZKY_GOLAY fit over window (2 to max_window) samples
+    static VelocityEstimator savitzkyGolay(uint8_t window, uint8_t degree = 1);
+
+    // Start from a known position at rest
+    void reset(float position, uint32_t t_us);
+    // One measurement; returns the velocity estimate
+    float update(float position, uint32_t t_us);
+    // Move the position and its history by delta, e.g. when the angle's zero is moved; the velocity is kept
+    void shift(float delta);
+
+    float velocity() const { return velocity_; }
+    // Filtered position for TRACKING, the fit at the newest sample for SAVITZKY_GOLAY
+    float position() const { return position_; }
+    Method method() const { return method_; }
+
+private:
+    VelocityEstimator(Method method, float bandwidth_hz, uint8_t window, uint8_t degree);
+
+    float updateTracking(float position, float dt);
+    float updateFit();
+
+    Method method_;
+    float omega_;
+    uint8_t window_;
+    uint8_t degree_;
+
+    bool started_ = false;
+    uint32_t last_us_ = 0;
+    float position_ = 0.0f;
+    float velocity_ = 0.0f;
+
+    // SAVITZKY_GOLAY history, ring buffer with head_ the newest sample
+    float x_[max_window];
+    uint32_t t_[max_window];
+    uint8_t head_ = 0;
+    uint8_t count_ = 0;
+};
+
+#endif //VelocityEstimator_h
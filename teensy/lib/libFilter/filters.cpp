@@ -72,6 +72,7 @@ void Filter::flush() {
   }
 }
 
+#if defined(ARDUINO)
 void Filter::dumpParams() {
   uint8_t p = 6;
   Serial.println("Filter parameters:");
@@ -86,6 +87,7 @@ void Filter::dumpParams() {
   Serial.print("k4\t= ");  Serial.println(k4, p);
   Serial.print("k5\t= ");  Serial.println(k5, p);
 }
+#endif
 
 // PRIVATE METHODS  * * * * * * * * * * * * * * * * * * * *
 
@@ -52,7 +52,9 @@ public:
 
   bool isInErrorState() { return f_err;  }
   bool isInWarnState()  { return f_warn; }
-  void dumpParams();
+#if defined(ARDUINO)
+  void dumpParams(); // prints on Serial, so target only
+#endif
 
 private:
   float_t ts;
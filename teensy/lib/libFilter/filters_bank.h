@@ -0,0 +1,117 @@
+/***
+ * IIR Filter Library - Multi-channel filter bank
+ *
+ * Copyright (C) 2016  Martin Vincent Bloedorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "filters_static.h"
+
+/** \brief N independent channels through the same StaticFilter design.
+ *
+ *  The history is stored structure-of-arrays, y[k][ch] is output delay k+1 of
+ *  channel ch, so filterIn() runs every term of the difference equation as one
+ *  unit-stride loop over the channels with N independent accumulators; the
+ *  compiler vectorizes that where the target has SIMD and otherwise keeps the
+ *  FPU pipeline full. Each channel has its own state, unlike sharing one Filter
+ *  between signals.
+ *
+ *      FilterBank<2, IIR::ORDER::OD3> spokeLpf(30.0, samplingTime);
+ *      spokeLpf.filterIn(raw, filtered);
+ */
+template<uint8_t N, IIR::ORDER od, IIR::TYPE ty = IIR::TYPE::LOWPASS>
+class FilterBank {
+public:
+  typedef IIR::Design<od, ty> Coefficients;
+  static constexpr uint8_t NY = Coefficients::NY;
+  static constexpr uint8_t NU = Coefficients::NU;
+  static constexpr uint8_t channels = N;
+
+  FilterBank(float_t hz_, float_t ts_) : ts( ts_ ), hz( hz_ ) { init(); }
+
+  /// One sample of every channel, input[N] -> output[N]; input and output may alias
+  inline void filterIn(const float_t* input, float_t* output) { c.template stepBank<N>(y, u, input, output); }
+
+  /// Latest output of one channel
+  float_t output(uint8_t ch) const { return y[0][ch]; }
+
+  void flush() {
+    for(uint8_t k=0; k<NY; k++) for(uint8_t ch=0; ch<N; ch++) y[k][ch] = 0.0;
+    for(uint8_t k=0; k<NU; k++) for(uint8_t ch=0; ch<N; ch++) u[k][ch] = 0.0;
+  }
+
+  void init(bool doFlush=true) {
+    if(doFlush) flush();
+    c.compute(hz, ts);
+  }
+
+  void setSamplingTime(float_t ts_, bool doFlush=true) { ts = ts_; init(doFlush); }
+  void setCutoffFreqHZ(float_t hz_, bool doFlush=true) { hz = hz_; init(doFlush); }
+
+  bool isInErrorState() { return c.f_err;  }
+  bool isInWarnState()  { return c.f_warn; }
+
+private:
+  typedef float_t Row[N];
+
+  float_t ts;
+  float_t hz;
+
+  Coefficients c;
+  Row y[NY], u[NU];
+};
+
+template<uint8_t N, IIR::ORDER od, IIR::TYPE ty> constexpr uint8_t FilterBank<N, od, ty>::NY;
+template<uint8_t N, IIR::ORDER od, IIR::TYPE ty> constexpr uint8_t FilterBank<N, od, ty>::NU;
+template<uint8_t N, IIR::ORDER od, IIR::TYPE ty> constexpr uint8_t FilterBank<N, od, ty>::channels;
+
+/** \brief FilterBank with the design fixed at compile time, see FixedFilter.
+ *
+ *      FixedFilterBank<2, SpokeRate> spokeLpf;
+ */
+template<uint8_t N, class Config>
+class FixedFilterBank {
+public:
+  typedef IIR::Design<Config::order, Config::type> Coefficients;
+  static constexpr uint8_t NY = Coefficients::NY;
+  static constexpr uint8_t NU = Coefficients::NU;
+  static constexpr uint8_t channels = N;
+  static constexpr Coefficients coefficients = Coefficients::make(Config::hz, Config::ts);
+  static_assert(!coefficients.f_err, "cutoff and sampling time give degenerate coefficients");
+
+  FixedFilterBank() { flush(); }
+
+  /// One sample of every channel, input[N] -> output[N]; input and output may alias
+  inline void filterIn(const float_t* input, float_t* output) { coefficients.template stepBank<N>(y, u, input, output); }
+
+  /// Latest output of one channel
+  float_t output(uint8_t ch) const { return y[0][ch]; }
+
+  void flush() {
+    for(uint8_t k=0; k<NY; k++) for(uint8_t ch=0; ch<N; ch++) y[k][ch] = 0.0;
+    for(uint8_t k=0; k<NU; k++) for(uint8_t ch=0; ch<N; ch++) u[k][ch] = 0.0;
+  }
+
+  bool isInWarnState() { return coefficients.f_warn; }
+
+private:
+  float_t y[NY][N], u[NU][N];
+};
+
+template<uint8_t N, class Config> constexpr uint8_t FixedFilterBank<N, Config>::NY;
+template<uint8_t N, class Config> constexpr uint8_t FixedFilterBank<N, Config>::NU;
+template<uint8_t N, class Config> constexpr uint8_t FixedFilterBank<N, Config>::channels;
+template<uint8_t N, class Config> constexpr typename FixedFilterBank<N, Config>::Coefficients FixedFilterBank<N, Config>::coefficients;
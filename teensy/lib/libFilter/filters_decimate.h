@@ -0,0 +1,130 @@
+/***
+ * IIR Filter Library - FIR decimation
+ *
+ * Copyright (C) 2016  Martin Vincent Bloedorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+#include "filters_defs.h"
+
+/** \brief N channels of oversampled input through a linear-phase FIR
+ *  low-pass, read at a lower rate.
+ *
+ *  push() takes a batch of inputs and only stores them; output() computes the
+ *  one output that is read, at the newest input. That is the polyphase
+ *  saving: the outputs between two reads, which decimation throws away, are
+ *  never computed, so a read costs Taps*N multiply-adds however many inputs
+ *  came in, and the ratio need not be an integer (1.66 kHz into 100 Hz).
+ *
+ *  The history is structure-of-arrays like FilterBank's, and every input is
+ *  written twice, Taps rows apart, so the newest Taps rows are always one
+ *  contiguous block: output() is a unit-stride loop over the channels per
+ *  tap, with no wrap, which the compiler vectorizes.
+ *
+ *  design() is a Hamming-windowed sinc at hz for inputs at fs, with unit DC
+ *  gain. The delay is (Taps-1)/2 inputs at every frequency, so the phase is
+ *  linear; the transition band is about 3.3*fs/Taps wide. The first push()
+ *  after a flush() fills the history with its first input, so there is no
+ *  start-up transient from zero.
+ *
+ *      FirDecimator<6, 33> imu(40.0, 1660.0);
+ *      imu.push(&rows[0][0], count); // count rows of 6, oldest first
+ *      imu.output(filtered);
+ */
+template<uint8_t N, uint8_t Taps>
+class FirDecimator {
+public:
+  static_assert(Taps >= 2 && Taps <= 127, "2 to 127 taps, the doubled history is indexed by a uint8_t");
+  static constexpr uint8_t channels = N;
+  static constexpr uint8_t taps = Taps;
+
+  FirDecimator(float_t hz_, float_t fs_) { design(hz_, fs_); }
+
+  void design(float_t hz_, float_t fs_) {
+    hz = hz_;
+    fs = fs_;
+    const double fc = (double)hz / fs; // cycles per input
+    const double mid = 0.5*(Taps - 1);
+    double sum = 0.0;
+    for(uint8_t k=0; k<Taps; k++) {
+      const double t = k - mid;
+      const double sinc = t == 0.0 ? 2.0*fc : sin(2.0*M_PI*fc*t)/(M_PI*t);
+      const double window = 0.54 - 0.46*cos(2.0*M_PI*k/(Taps - 1));
+      b[k] = (float_t)(sinc*window);
+      sum += b[k];
+    }
+    for(uint8_t k=0; k<Taps; k++) b[k] = (float_t)(b[k]/sum);
+    flush();
+  }
+
+  /// count inputs, rows of N values oldest first
+  void push(const float_t* rows, uint16_t count) {
+    if(count == 0) return;
+    if(!primed) {
+      for(uint8_t k=0; k<2*Taps; k++) for(uint8_t ch=0; ch<N; ch++) h[k][ch] = rows[ch];
+      primed = true;
+    }
+    for(uint16_t n=0; n<count; n++) {
+      const float_t* in = rows + (uint32_t)n*N;
+      for(uint8_t ch=0; ch<N; ch++) {
+        h[head][ch] = in[ch];
+        h[head + Taps][ch] = in[ch];
+      }
+      head = head + 1 == Taps ? 0 : head + 1;
+    }
+  }
+
+  /// The filtered value of every channel at the newest input, out[N]
+  void output(float_t* out) const {
+    // rows head..head+Taps-1 are the inputs oldest to newest
+    float_t acc[N];
+    for(uint8_t ch=0; ch<N; ch++) acc[ch] = 0.0;
+    for(uint8_t k=0; k<Taps; k++) {
+      const float_t c = b[k];
+      const float_t* row = h[head + k];
+      for(uint8_t ch=0; ch<N; ch++) acc[ch] += c*row[ch];
+    }
+    for(uint8_t ch=0; ch<N; ch++) out[ch] = acc[ch];
+  }
+
+  void flush() {
+    head = 0;
+    primed = false;
+  }
+
+  /// The group delay, in inputs
+  static constexpr float_t delay() { return 0.5*(Taps - 1); }
+
+  float_t cutoffFreqHZ() const { return hz; }
+  float_t samplingFreqHZ() const { return fs; }
+  const float_t* coefficients() const { return b; }
+
+private:
+  typedef float_t Row[N];
+
+  float_t hz;
+  float_t fs;
+  float_t b[Taps];
+  Row h[2*Taps];
+  uint8_t head = 0;
+  bool primed = false;
+};
+
+template<uint8_t N, uint8_t Taps> constexpr uint8_t FirDecimator<N, Taps>::channels;
+template<uint8_t N, uint8_t Taps> constexpr uint8_t FirDecimator<N, Taps>::taps;
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <ConstexprMath.h>
+
 // Uncomment to use `double` instead of `float` for all library functions.
 //#define LIBFILTER_USE_DOUBLE
 
@@ -34,11 +36,13 @@ namespace IIR {
   enum class ORDER  : uint8_t {OD1 = 0, OD2, OD3, OD4};//, OD5};
   enum class TYPE   : uint8_t {LOWPASS = 0, HIGHPASS = 1};
 
-  const float_t SQRT2 = sqrt(2.0);
-  const float_t SQRT3 = sqrt(3.0);
-  const float_t SQRT5 = sqrt(5.0);
+  constexpr float_t SQRT2 = 1.41421356237309505;
+  constexpr float_t SQRT3 = 1.73205080756887729;
+  constexpr float_t SQRT5 = 2.23606797749978970;
+
+  constexpr float_t EPSILON   = 0.00001;    // Tolerance for numerical constants
+  constexpr float_t WEPSILON  = 0.00010;    // Warning threshold for numerical degradation
+  constexpr float_t KM        = 100.0;      // Pre-multiplier to reduce the impact of the AVRs limited float representation
 
-  const float_t EPSILON   = 0.00001;    // Tolerance for numerical constants
-  const float_t WEPSILON  = 0.00010;    // Warning threshold for numerical degradation
-  const float_t KM        = 100.0;      // Pre-multiplier to reduce the impact of the AVRs limited float representation
+  // constexpr sin, cos and exp for the coefficient designs: cx:: in ConstexprMath.h
 }
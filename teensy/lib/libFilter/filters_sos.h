@@ -0,0 +1,224 @@
+/***
+ * IIR Filter Library - Second-order sections
+ *
+ * Copyright (C) 2016  Martin Vincent Bloedorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/// Has to be executed on Arduino IDE > 1.6.7
+#include <Arduino.h>
+
+#include "filters_defs.h"
+
+// Define to run SosFilter through CMSIS-DSP's arm_biquad_cascade_df2T_f32
+// (arm_math.h, shipped with the Teensy core) instead of the inline loop.
+//#define LIBFILTER_USE_CMSIS_DSP
+
+#if defined(LIBFILTER_USE_CMSIS_DSP)
+  #if defined(LIBFILTER_USE_DOUBLE)
+    #error "LIBFILTER_USE_CMSIS_DSP is single precision only"
+  #endif
+  #include <arm_math.h>
+#endif
+
+namespace IIR {
+  enum class PROTOTYPE : uint8_t {BUTTERWORTH = 0, BESSEL = 1};
+
+  /// One biquad, H(z) = (b0 + b1 z^-1 + b2 z^-2)/(1 + a1 z^-1 + a2 z^-2)
+  struct Biquad {
+    float_t b0, b1, b2, a1, a2;
+  };
+
+  /// Cascade of (od+1)/2 sections for an analog prototype of order od
+  template<uint8_t od>
+  struct Sections {
+    static constexpr uint8_t count = (od + 1)/2;
+    Biquad s[count];
+  };
+
+  template<uint8_t od> constexpr uint8_t Sections<od>::count;
+
+  namespace sos {
+    // Bessel poles with -3 dB at 1 rad/s, upper half plane, orders 1 to 8;
+    // the real pole of an odd order comes last
+    constexpr uint8_t BESSEL_MAX_ORDER = 8;
+    constexpr double BESSEL_POLES[][2] = {
+      {-1.000000000000000, 0.000000000000000},
+      {-1.101601330592162, 0.636009824757034},
+      {-1.047409161008935, 0.999264436280637}, {-1.322675799910444, 0.000000000000000},
+      {-0.995208764350274, 1.257105739454667}, {-1.370067830551444, 0.410249717493753},
+      {-0.957676548562681, 1.471124320730394}, {-1.380877325860441, 0.717909587626768},
+      {-1.502316271447482, 0.000000000000000},
+      {-0.930656522946859, 1.661863268942591}, {-1.381858097596565, 0.971471890711578},
+      {-1.571490403616028, 0.320896374222642},
+      {-0.909867780623466, 1.836451353036393}, {-1.378903216795442, 1.191566777800625},
+      {-1.612038766226060, 0.589244506931513}, {-1.684368179273154, 0.000000000000000},
+      {-0.892869718847141, 1.998325843641304}, {-1.373841217637338, 1.388356575877583},
+      {-1.636939418126907, 0.822795625139746}, {-1.757408400401728, 0.272867575102304},
+    };
+
+    constexpr uint8_t besselOffset(uint8_t od) {
+      uint8_t offset = 0;
+      for(uint8_t m=1; m<od; m++) offset += (m + 1)/2;
+      return offset;
+    }
+
+    // Bilinear transform of the normalized analog section
+    // (n2 s^2 + n1 s + n0)/(d2 s^2 + d1 s + d0) with s = (1/K)(1 - z^-1)/(1 + z^-1)
+    constexpr Biquad bilinear2(double n2, double n1, double n0, double d2, double d1, double d0, double K) {
+      double a0 = d2 + d1*K + d0*K*K;
+      return Biquad{ (float_t)((n2 + n1*K + n0*K*K)/a0),
+                     (float_t)((2.0*n0*K*K - 2.0*n2)/a0),
+                     (float_t)((n2 - n1*K + n0*K*K)/a0),
+                     (float_t)((2.0*d0*K*K - 2.0*d2)/a0),
+                     (float_t)((d2 - d1*K + d0*K*K)/a0) };
+    }
+
+    // Same for (n1 s + n0)/(d1 s + d0); b2 = a2 = 0
+    constexpr Biquad bilinear1(double n1, double n0, double d1, double d0, double K) {
+      double a0 = d1 + d0*K;
+      return Biquad{ (float_t)((n1 + n0*K)/a0),
+                     (float_t)((n0*K - n1)/a0),
+                     (float_t)0.0,
+                     (float_t)((d0*K - d1)/a0),
+                     (float_t)0.0 };
+    }
+  }
+
+  /** \brief Butterworth or Bessel sections of any order via the bilinear transform.
+   *
+   *  The cutoff is pre-warped, so the -3 dB point lands exactly at hz. Sections
+   *  are ordered from lowest to highest Q. Everything is constexpr, so with a
+   *  constant cutoff and sampling time the coefficients are folded at compile time:
+   *
+   *      constexpr auto c = IIR::design<4, IIR::PROTOTYPE::BUTTERWORTH>(30.0, samplingTime);
+   *      SosFilter<4> f(c);
+   */
+  template<uint8_t od, PROTOTYPE proto, TYPE ty = TYPE::LOWPASS>
+  constexpr Sections<od> design(double hz, double ts) {
+    static_assert(od >= 1, "order must be at least 1");
+    static_assert(proto != PROTOTYPE::BESSEL || od <= sos::BESSEL_MAX_ORDER, "Bessel poles are tabulated up to order 8");
+
+    double x = PI*hz*ts;
+    double K = cx::sin(x)/cx::cos(x);
+    Sections<od> r{};
+    for(uint8_t i=0; i<Sections<od>::count; i++) {
+      // Pole i from the real axis outwards: re < 0, im >= 0
+      uint8_t k = Sections<od>::count - 1 - i;
+      double re = 0.0, im = 0.0;
+      if(proto == PROTOTYPE::BUTTERWORTH) {
+        double phi = PI*(2.0*k + 1.0)/(2.0*od);
+        re = (2*k + 1 == od) ? -1.0 : -cx::sin(phi);
+        im = (2*k + 1 == od) ?  0.0 :  cx::cos(phi);
+      } else {
+        re = sos::BESSEL_POLES[sos::besselOffset(od) + k][0];
+        im = sos::BESSEL_POLES[sos::besselOffset(od) + k][1];
+      }
+
+      if(od % 2 == 1 && 2*k + 1 == od) {
+        // Real pole p: p/(s + p), or p s/(1 + p s) for the high-pass
+        double p = -re;
+        r.s[i] = (ty == TYPE::LOWPASS) ? sos::bilinear1(0.0, p, 1.0, p, K)
+                                       : sos::bilinear1(p, 0.0, p, 1.0, K);
+      } else {
+        // Pair: c/(s^2 + b s + c), or c s^2/(c s^2 + b s + 1) for the high-pass
+        double b = -2.0*re;
+        double c = re*re + im*im;
+        r.s[i] = (ty == TYPE::LOWPASS) ? sos::bilinear2(0.0, 0.0, c, 1.0, b, c, K)
+                                       : sos::bilinear2(c, 0.0, 0.0, c, b, 1.0, K);
+      }
+    }
+    return r;
+  }
+}
+
+/** \brief Cascade of biquads in transposed direct form II.
+ *
+ *  Two state words per section and no KM scaling; the poles are split into
+ *  sections, so the coefficients stay well conditioned at any order, unlike
+ *  Filter's single high-order difference equation. filterIn() matches Filter's
+ *  interface; filterBlock() runs a buffer through in one call, which is where
+ *  the CMSIS-DSP backend pays off.
+ */
+template<uint8_t od>
+class SosFilter {
+public:
+  static constexpr uint8_t stages = IIR::Sections<od>::count;
+
+  explicit SosFilter(const IIR::Sections<od>& c) { setCoefficients(c); }
+
+  void setCoefficients(const IIR::Sections<od>& c, bool doFlush=true) {
+    sections = c;
+    #if defined(LIBFILTER_USE_CMSIS_DSP)
+      // CMSIS adds the feedback terms, so a1 and a2 go in negated
+      for(uint8_t i=0; i<stages; i++) {
+        cmsisCoeffs[5*i + 0] =  c.s[i].b0;
+        cmsisCoeffs[5*i + 1] =  c.s[i].b1;
+        cmsisCoeffs[5*i + 2] =  c.s[i].b2;
+        cmsisCoeffs[5*i + 3] = -c.s[i].a1;
+        cmsisCoeffs[5*i + 4] = -c.s[i].a2;
+      }
+      arm_biquad_cascade_df2T_init_f32(&cmsis, stages, cmsisCoeffs, w[0]);
+    #endif
+    if(doFlush) flush();
+  }
+
+  inline float_t filterIn(float_t input) {
+    #if defined(LIBFILTER_USE_CMSIS_DSP)
+      float_t output;
+      arm_biquad_cascade_df2T_f32(&cmsis, &input, &output, 1);
+      return output;
+    #else
+      float_t x = input;
+      for(uint8_t i=0; i<stages; i++) {
+        const IIR::Biquad& q = sections.s[i];
+        float_t y = q.b0*x + w[i][0];
+        w[i][0]   = q.b1*x - q.a1*y + w[i][1];
+        w[i][1]   = q.b2*x - q.a2*y;
+        x = y;
+      }
+      return x;
+    #endif
+  }
+
+  /// n samples from input to output; the buffers may be the same
+  void filterBlock(const float_t* input, float_t* output, uint32_t n) {
+    #if defined(LIBFILTER_USE_CMSIS_DSP)
+      arm_biquad_cascade_df2T_f32(&cmsis, const_cast<float_t*>(input), output, n);
+    #else
+      for(uint32_t k=0; k<n; k++) output[k] = filterIn(input[k]);
+    #endif
+  }
+
+  void flush() {
+    for(uint8_t i=0; i<stages; i++) {
+      w[i][0] = 0.0;
+      w[i][1] = 0.0;
+    }
+  }
+
+  const IIR::Sections<od>& coefficients() const { return sections; }
+
+private:
+  IIR::Sections<od> sections;
+  float_t w[stages][2];
+  #if defined(LIBFILTER_USE_CMSIS_DSP)
+    float32_t cmsisCoeffs[5*stages];
+    arm_biquad_cascade_df2T_instance_f32 cmsis;
+  #endif
+};
+
+template<uint8_t od> constexpr uint8_t SosFilter<od>::stages;
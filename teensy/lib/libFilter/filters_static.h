@@ -0,0 +1,290 @@
+/***
+ * IIR Filter Library - Compile-time order variant
+ *
+ * Copyright (C) 2016  Martin Vincent Bloedorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/// Has to be executed on Arduino IDE > 1.6.7
+#include <Arduino.h>
+
+#include "filters_defs.h"
+
+namespace IIR {
+  namespace detail {
+    // c[I]*s[I] + ... + c[N-1]*s[N-1], expanded at compile time
+    template<uint8_t I, uint8_t N> struct Dot {
+      static inline float_t run(const float_t* c, const float_t* s) { return c[I]*s[I] + Dot<I+1, N>::run(c, s); }
+    };
+    template<uint8_t N> struct Dot<N, N> {
+      static inline float_t run(const float_t*, const float_t*) { return 0.0; }
+    };
+
+    // s[K] = s[K-1], ..., s[1] = s[0]
+    template<uint8_t K> struct Shift {
+      static inline void run(float_t* s) { s[K] = s[K-1]; Shift<K-1>::run(s); }
+    };
+    template<> struct Shift<0> {
+      static inline void run(float_t*) { }
+    };
+  }
+
+  /** \brief Butterworth coefficients of Filter in vector form.
+   *
+   *  a[i] multiplies y[n-1-i] and b[i] multiplies u[n-i]; the low-pass KM
+   *  pre-multiplier is folded into b[0]. Shared by StaticFilter and FilterBank.
+   *  make() is constexpr, so a constant cutoff and sampling time give a design
+   *  that lives in flash, see FixedFilter.
+   */
+  template<ORDER od, TYPE ty = TYPE::LOWPASS>
+  struct Design {
+    /// Output and input history lengths; the high-pass designs stop at order 2, as in Filter
+    static constexpr uint8_t NY = (ty == TYPE::HIGHPASS && (uint8_t)od > 1) ? 2 : (uint8_t)od + 1;
+    static constexpr uint8_t NU = (ty == TYPE::HIGHPASS) ? NY + 1 : 1;
+
+    float_t a[NY], b[NU];
+    bool f_err, f_warn;
+
+    static constexpr Design make(float_t hz, float_t ts) {
+      Design d{};
+      if(ty == TYPE::LOWPASS) d.initLowPass(hz, ts);
+      else                    d.initHighPass(hz, ts);
+      return d;
+    }
+
+    void compute(float_t hz, float_t ts) { *this = make(hz, ts); }
+
+    /// One step of the difference equation over the history y[NY], u[NU]
+    inline float_t step(float_t* y, float_t* u, float_t input) const {
+      if(f_err) return 0.0;
+      detail::Shift<NU-1>::run(u);
+      u[0] = input;
+      float_t out = detail::Dot<0, NY>::run(a, y) + detail::Dot<0, NU>::run(b, u);
+      detail::Shift<NY-1>::run(y);
+      y[0] = out;
+      return out;
+    }
+
+    /// step() for N channels of structure-of-arrays history, y[k][ch] and u[k][ch];
+    /// each term is one unit-stride loop over the channels
+    template<uint8_t N>
+    inline void stepBank(float_t (*y)[N], float_t (*u)[N], const float_t* input, float_t* output) const {
+      if(f_err) {
+        for(uint8_t ch=0; ch<N; ch++) output[ch] = 0.0;
+        return;
+      }
+      shiftBank<N>(u, NU);
+      float_t out[N];
+      for(uint8_t ch=0; ch<N; ch++) {
+        u[0][ch] = input[ch];
+        out[ch]  = b[0]*input[ch];
+      }
+      for(uint8_t k=1; k<NU; k++)
+        for(uint8_t ch=0; ch<N; ch++) out[ch] += b[k]*u[k][ch];
+      for(uint8_t k=0; k<NY; k++)
+        for(uint8_t ch=0; ch<N; ch++) out[ch] += a[k]*y[k][ch];
+      shiftBank<N>(y, NY);
+      for(uint8_t ch=0; ch<N; ch++) {
+        y[0][ch]   = out[ch];
+        output[ch] = out[ch];
+      }
+    }
+
+  private:
+    // Delay line by one sample; len is a constant, so the loops unroll
+    template<uint8_t N>
+    static inline void shiftBank(float_t (*s)[N], uint8_t len) {
+      for(uint8_t k=len-1; k>0; k--)
+        for(uint8_t ch=0; ch<N; ch++) s[k][ch] = s[k-1][ch];
+    }
+
+    constexpr float_t ap(float_t p) {
+      f_err  = f_err  | (cx::fabs(p) <= EPSILON );
+      f_warn = f_warn | (cx::fabs(p) <= WEPSILON);
+      return (f_err) ? 0.0 : p;
+    }
+
+    // Pole-zero matching, as Filter::initLowPass(). The designs are computed into
+    // full-length locals and the first NY terms kept, so no case indexes past a[];
+    // od is a constant and only one case survives.
+    constexpr void initLowPass(float_t hz, float_t ts) {
+      float_t p = 0.0, q = 0.0, r = 0.0, s = 0.0, b1 = 0.0, b2 = 0.0, b3 = 0.0, b4 = 0.0;
+      float_t c[4] = {0.0, 0.0, 0.0, 0.0};
+      switch((uint8_t)od) {
+        case (uint8_t)ORDER::OD1:
+            c[0] = cx::exp(-2.0*PI*hz*ts);
+          break;
+        case (uint8_t)ORDER::OD2:
+            p    = -PI*hz*SQRT2;
+            q    =  PI*hz*SQRT2;
+            c[0] =  ap(2.0*cx::exp(p*ts)*cx::cos(q*ts));
+            c[1] = -ap(cx::exp(2.0*ts*p));
+          break;
+        case (uint8_t)ORDER::OD3:
+            p    = -PI*hz;
+            q    =  PI*hz*SQRT3;
+            r    =  2.0*PI*hz;
+            b3   = cx::exp(-r*ts);
+            b2   = cx::exp(2.0*ts*p);
+            b1   = 2.0*cx::exp(p*ts)*cx::cos(q*ts);
+            c[0] =  ap(b1 + b3);
+            c[1] = -ap(b2 + b1*b3);
+            c[2] =  ap(b2*b3);
+          break;
+        default:
+            p    = -0.3827*2.0*PI*hz;
+            q    =  0.9238*2.0*PI*hz;
+            r    = -0.9238*2.0*PI*hz;
+            s    =  0.3827*2.0*PI*hz;
+            b4   = cx::exp(2.0*ts*r);
+            b3   = 2.0*cx::exp(r*ts)*cx::cos(s*ts);
+            b2   = cx::exp(2.0*ts*p);
+            b1   = 2.0*cx::exp(p*ts)*cx::cos(q*ts);
+            c[0] =  ap(b1 + b3);
+            c[1] = -ap(b4 + b1*b3 + b2);
+            c[2] =  ap(b1*b4 + b2*b3);
+            c[3] = -ap(b2*b4);
+          break;
+      }
+      // Unit DC gain, the k0/KM of Filter
+      float_t gain = 1.0;
+      for(uint8_t i=0; i<NY; i++) {
+        a[i] = c[i];
+        gain -= c[i];
+      }
+      b[0] = (NY == 1) ? gain : ap(gain);
+    }
+
+    // Bilinear transformation, as Filter::initHighPass()
+    constexpr void initHighPass(float_t hz, float_t ts) {
+      float_t k  = 2.0/ts;
+      float_t w0 = 2.0*PI*hz;
+      float_t c[2] = {0.0, 0.0}, j[3] = {0.0, 0.0, 0.0};
+      if(NY == 1) {
+        float_t a0 = w0 + k;
+        j[0] =  k/a0;
+        j[1] = -k/a0;
+        j[2] =  0.0;
+        c[0] = -(w0 - k)/a0;
+        c[1] =  0.0;
+      } else {
+        float_t ksq = k*k;
+        float_t a0  = w0*w0 + k*w0 + ksq;
+        j[0] =  ksq/a0;
+        j[1] = -2.0*ksq/a0;
+        j[2] =  ksq/a0;
+        c[0] = -(2.0*w0*w0 - 2.0*ksq)/a0;
+        c[1] = -(w0*w0 - k*w0 + ksq)/a0;
+      }
+      for(uint8_t i=0; i<NY; i++) a[i] = c[i];
+      for(uint8_t i=0; i<NU; i++) b[i] = j[i];
+    }
+  };
+
+  template<ORDER od, TYPE ty> constexpr uint8_t Design<od, ty>::NY;
+  template<ORDER od, TYPE ty> constexpr uint8_t Design<od, ty>::NU;
+}
+
+/** \brief Filter with the order and type fixed at compile time.
+ *
+ *  Same Butterworth designs as Filter, but the difference equation is expanded
+ *  by templates, so filterIn() has no switch and touches only the od+1 history
+ *  terms the order needs, all at constant indices that the compiler keeps in
+ *  registers across the call. Drop-in for Filter where the order never changes:
+ *
+ *      StaticFilter<IIR::ORDER::OD3> lpf(30.0, samplingTime);
+ */
+template<IIR::ORDER od, IIR::TYPE ty = IIR::TYPE::LOWPASS>
+class StaticFilter {
+public:
+  typedef IIR::Design<od, ty> Coefficients;
+  static constexpr uint8_t NY = Coefficients::NY;
+  static constexpr uint8_t NU = Coefficients::NU;
+
+  StaticFilter(float_t hz_, float_t ts_) : ts( ts_ ), hz( hz_ ) { init(); }
+
+  inline float_t filterIn(float_t input) { return c.step(y, u, input); }
+
+  void flush() {
+    for(uint8_t i=0; i<NY; i++) y[i] = 0.0;
+    for(uint8_t i=0; i<NU; i++) u[i] = 0.0;
+  }
+
+  void init(bool doFlush=true) {
+    if(doFlush) flush();
+    c.compute(hz, ts);
+  }
+
+  void setSamplingTime(float_t ts_, bool doFlush=true) { ts = ts_; init(doFlush); }
+  void setCutoffFreqHZ(float_t hz_, bool doFlush=true) { hz = hz_; init(doFlush); }
+
+  bool isInErrorState() { return c.f_err;  }
+  bool isInWarnState()  { return c.f_warn; }
+
+private:
+  float_t ts;
+  float_t hz;
+
+  Coefficients c;
+  float_t y[NY], u[NU];
+};
+
+template<IIR::ORDER od, IIR::TYPE ty> constexpr uint8_t StaticFilter<od, ty>::NY;
+template<IIR::ORDER od, IIR::TYPE ty> constexpr uint8_t StaticFilter<od, ty>::NU;
+
+/** \brief StaticFilter with the cutoff and sampling time fixed at compile time.
+ *
+ *  Config supplies the design as constants,
+ *
+ *      struct SpokeRate {
+ *        static constexpr IIR::ORDER order = IIR::ORDER::OD3;
+ *        static constexpr IIR::TYPE  type  = IIR::TYPE::LOWPASS;
+ *        static constexpr float_t    hz    = 30.0;
+ *        static constexpr float_t    ts    = samplingTime;
+ *      };
+ *      FixedFilter<SpokeRate> lpf;
+ *
+ *  and the coefficients are computed by the compiler into flash; nothing runs at
+ *  startup, and the compiler folds them into filterIn() as immediates. A design
+ *  that would put Filter in its error state fails to compile.
+ */
+template<class Config>
+class FixedFilter {
+public:
+  typedef IIR::Design<Config::order, Config::type> Coefficients;
+  static constexpr uint8_t NY = Coefficients::NY;
+  static constexpr uint8_t NU = Coefficients::NU;
+  static constexpr Coefficients coefficients = Coefficients::make(Config::hz, Config::ts);
+  static_assert(!coefficients.f_err, "cutoff and sampling time give degenerate coefficients");
+
+  FixedFilter() { flush(); }
+
+  inline float_t filterIn(float_t input) { return coefficients.step(y, u, input); }
+
+  void flush() {
+    for(uint8_t i=0; i<NY; i++) y[i] = 0.0;
+    for(uint8_t i=0; i<NU; i++) u[i] = 0.0;
+  }
+
+  bool isInWarnState() { return coefficients.f_warn; }
+
+private:
+  float_t y[NY], u[NU];
+};
+
+template<class Config> constexpr uint8_t FixedFilter<Config>::NY;
+template<class Config> constexpr uint8_t FixedFilter<Config>::NU;
+template<class Config> constexpr typename FixedFilter<Config>::Coefficients FixedFilter<Config>::coefficients;
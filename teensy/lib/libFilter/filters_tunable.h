@@ -0,0 +1,165 @@
+/***
+ * IIR Filter Library - Run-time retunable filter bank
+ *
+ * Copyright (C) 2016  Martin Vincent Bloedorn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <math.h>
+
+#include "filters_static.h"
+
+/** \brief FilterBank with a cutoff per channel that can move while it runs.
+ *
+ *  setCutoffFreqHZ(hz, false) on the other filters swaps the coefficients under
+ *  the old history, and the mismatch rings out as a transient; flushing instead
+ *  drops the output to zero. Here a new cutoff is reached over rampSamples()
+ *  samples, in equal ratios of the cutoff, with each step a full Butterworth
+ *  design: every intermediate filter is stable and has unit DC gain, so the
+ *  history stays consistent and the output follows without a glitch. Linear
+ *  steps in the coefficients themselves are not stable in general beyond
+ *  order 2. A ramp costs one design per retuning channel and sample, paid only
+ *  while it runs; a ramp of 0 is the immediate swap.
+ *
+ *      TunableFilterBank<2, IIR::ORDER::OD3> spokeLpf(30.0, samplingTime);
+ *      spokeLpf.setCutoffFreqHZ(0, 12.0);   // channel 0, over the next 8 samples
+ *      spokeLpf.filterIn(raw, filtered);
+ */
+template<uint8_t N, IIR::ORDER od, IIR::TYPE ty = IIR::TYPE::LOWPASS>
+class TunableFilterBank {
+public:
+  typedef IIR::Design<od, ty> Coefficients;
+  static constexpr uint8_t NY = Coefficients::NY;
+  static constexpr uint8_t NU = Coefficients::NU;
+  static constexpr uint8_t channels = N;
+
+  TunableFilterBank(float_t hz_, float_t ts_, uint8_t ramp_ = 8) : ts( ts_ ), ramp( ramp_ ) {
+    for(uint8_t ch=0; ch<N; ch++) {
+      target[ch] = hz_;
+      steps[ch]  = 0;
+      design(ch, hz_);
+    }
+    flush();
+  }
+
+  /// One sample of every channel, input[N] -> output[N]; input and output may alias
+  inline void filterIn(const float_t* input, float_t* output) {
+    if(retuning) advance();
+    for(uint8_t k=NU-1; k>0; k--)
+      for(uint8_t ch=0; ch<N; ch++) u[k][ch] = u[k-1][ch];
+    float_t out[N];
+    for(uint8_t ch=0; ch<N; ch++) {
+      u[0][ch] = input[ch];
+      out[ch]  = b[0][ch]*input[ch];
+    }
+    for(uint8_t k=1; k<NU; k++)
+      for(uint8_t ch=0; ch<N; ch++) out[ch] += b[k][ch]*u[k][ch];
+    for(uint8_t k=0; k<NY; k++)
+      for(uint8_t ch=0; ch<N; ch++) out[ch] += a[k][ch]*y[k][ch];
+    for(uint8_t k=NY-1; k>0; k--)
+      for(uint8_t ch=0; ch<N; ch++) y[k][ch] = y[k-1][ch];
+    for(uint8_t ch=0; ch<N; ch++) {
+      // a degenerate design outputs zero, as Design::step()
+      y[0][ch]   = err[ch] ? 0.0 : out[ch];
+      output[ch] = y[0][ch];
+    }
+  }
+
+  /// Latest output of one channel
+  float_t output(uint8_t ch) const { return y[0][ch]; }
+
+  void flush() {
+    for(uint8_t k=0; k<NY; k++) for(uint8_t ch=0; ch<N; ch++) y[k][ch] = 0.0;
+    for(uint8_t k=0; k<NU; k++) for(uint8_t ch=0; ch<N; ch++) u[k][ch] = 0.0;
+  }
+
+  /// Move channel ch to hz_ over rampSamples() samples, keeping its history
+  void setCutoffFreqHZ(uint8_t ch, float_t hz_) {
+    target[ch] = hz_;
+    if(ramp == 0 || !(hz[ch] > 0.0) || !(hz_ > 0.0)) {
+      steps[ch] = 0;
+      design(ch, hz_);
+      return;
+    }
+    ratio[ch] = pow(hz_/hz[ch], (float_t)1.0/ramp);
+    steps[ch] = ramp;
+    retuning  = true;
+  }
+
+  /// The same cutoff for every channel
+  void setCutoffFreqHZ(float_t hz_) { for(uint8_t ch=0; ch<N; ch++) setCutoffFreqHZ(ch, hz_); }
+
+  /// A new sampling time redesigns every channel at once, and flushes by default as the others
+  void setSamplingTime(float_t ts_, bool doFlush=true) {
+    ts = ts_;
+    for(uint8_t ch=0; ch<N; ch++) {
+      steps[ch] = 0;
+      design(ch, target[ch]);
+    }
+    retuning = false;
+    if(doFlush) flush();
+  }
+
+  void setRampSamples(uint8_t ramp_) { ramp = ramp_; }
+  uint8_t rampSamples() const { return ramp; }
+
+  /// The cutoff channel ch runs at now, and the one it is moving to
+  float_t cutoffFreqHZ(uint8_t ch) const { return hz[ch]; }
+  float_t targetFreqHZ(uint8_t ch) const { return target[ch]; }
+  bool isRetuning() const { return retuning; }
+
+  bool isInErrorState() const { bool e = false; for(uint8_t ch=0; ch<N; ch++) e |= err[ch];  return e; }
+  bool isInWarnState()  const { bool w = false; for(uint8_t ch=0; ch<N; ch++) w |= warn[ch]; return w; }
+
+private:
+  typedef float_t Row[N];
+
+  // Next step of every ramp under way; the last lands on the target exactly
+  void advance() {
+    bool more = false;
+    for(uint8_t ch=0; ch<N; ch++) {
+      if(steps[ch] == 0) continue;
+      design(ch, --steps[ch] == 0 ? target[ch] : hz[ch]*ratio[ch]);
+      more |= steps[ch] > 0;
+    }
+    retuning = more;
+  }
+
+  void design(uint8_t ch, float_t hz_) {
+    Coefficients c = Coefficients::make(hz_, ts);
+    hz[ch] = hz_;
+    for(uint8_t k=0; k<NY; k++) a[k][ch] = c.a[k];
+    for(uint8_t k=0; k<NU; k++) b[k][ch] = c.b[k];
+    err[ch]  = c.f_err;
+    warn[ch] = c.f_warn;
+  }
+
+  float_t ts;
+  uint8_t ramp;
+  bool retuning = false;
+
+  float_t hz[N], target[N], ratio[N];
+  uint8_t steps[N];
+  bool err[N], warn[N];
+
+  // Coefficients and history structure-of-arrays, a[k][ch] as FilterBank's y[k][ch]
+  Row a[NY], b[NU];
+  Row y[NY], u[NU];
+};
+
+template<uint8_t N, IIR::ORDER od, IIR::TYPE ty> constexpr uint8_t TunableFilterBank<N, od, ty>::NY;
+template<uint8_t N, IIR::ORDER od, IIR::TYPE ty> constexpr uint8_t TunableFilterBank<N, od, ty>::NU;
+template<uint8_t N, IIR::ORDER od, IIR::TYPE ty> constexpr uint8_t TunableFilterBank<N, od, ty>::channels;
@@ -104,15 +104,22 @@ class ArduinoHardware {
     }
 
     int read(){return iostream->read();};
+    int available(){return iostream->available();}
     void write(uint8_t* data, int length){
       iostream->write(data, length);
+      written_ += length;
     }
+    // bytes through write() since boot
+    uint32_t written(){return written_;}
+    // bytes write() takes without waiting
+    int availableForWrite(){return iostream->availableForWrite();}
 
     unsigned long time(){return millis();}
 
   protected:
     SERIAL_CLASS* iostream;
     long baud_;
+    uint32_t written_ = 0;
 };
 
 #endif
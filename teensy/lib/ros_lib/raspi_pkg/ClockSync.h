@@ -0,0 +1,101 @@
+#ifndef _ROS_raspi_pkg_ClockSync_h
+#define _ROS_raspi_pkg_ClockSync_h
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ros/msg.h"
+#include "ros/time.h"
+
+namespace raspi_pkg
+{
+
+  class ClockSync : public ros::Msg
+  {
+    public:
+      typedef uint32_t _id_type;
+      _id_type id;
+      typedef ros::Time _pi_send_type;
+      _pi_send_type pi_send;
+      typedef uint32_t _teensy_receive_us_type;
+      _teensy_receive_us_type teensy_receive_us;
+      typedef uint32_t _teensy_send_us_type;
+      _teensy_send_us_type teensy_send_us;
+
+    ClockSync():
+      id(0),
+      pi_send(),
+      teensy_receive_us(0),
+      teensy_send_us(0)
+    {
+    }
+
+    virtual int serialize(unsigned char *outbuffer) const override
+    {
+      int offset = 0;
+      *(outbuffer + offset + 0) = (this->id >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->id >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->id >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->id >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->id);
+      *(outbuffer + offset + 0) = (this->pi_send.sec >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->pi_send.sec >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->pi_send.sec >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->pi_send.sec >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->pi_send.sec);
+      *(outbuffer + offset + 0) = (this->pi_send.nsec >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->pi_send.nsec >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->pi_send.nsec >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->pi_send.nsec >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->pi_send.nsec);
+      *(outbuffer + offset + 0) = (this->teensy_receive_us >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->teensy_receive_us >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->teensy_receive_us >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->teensy_receive_us >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->teensy_receive_us);
+      *(outbuffer + offset + 0) = (this->teensy_send_us >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->teensy_send_us >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->teensy_send_us >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->teensy_send_us >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->teensy_send_us);
+      return offset;
+    }
+
+    virtual int deserialize(unsigned char *inbuffer) override
+    {
+      int offset = 0;
+      this->id =  ((uint32_t) (*(inbuffer + offset)));
+      this->id |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->id |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->id |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->id);
+      this->pi_send.sec =  ((uint32_t) (*(inbuffer + offset)));
+      this->pi_send.sec |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->pi_send.sec |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->pi_send.sec |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->pi_send.sec);
+      this->pi_send.nsec =  ((uint32_t) (*(inbuffer + offset)));
+      this->pi_send.nsec |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->pi_send.nsec |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->pi_send.nsec |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->pi_send.nsec);
+      this->teensy_receive_us =  ((uint32_t) (*(inbuffer + offset)));
+      this->teensy_receive_us |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->teensy_receive_us |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->teensy_receive_us |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->teensy_receive_us);
+      this->teensy_send_us =  ((uint32_t) (*(inbuffer + offset)));
+      this->teensy_send_us |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->teensy_send_us |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->teensy_send_us |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->teensy_send_us);
+     return offset;
+    }
+
+    virtual const char * getType() override { return "raspi_pkg/ClockSync"; };
+    virtual const char * getMD5() override { return "4a71b5e685562202820a05110a6766fe"; };
+
+  };
+
+}
+#endif
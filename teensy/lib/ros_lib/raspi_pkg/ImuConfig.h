@@ -0,0 +1,113 @@
+#ifndef _ROS_raspi_pkg_ImuConfig_h
+#define _ROS_raspi_pkg_ImuConfig_h
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ros/msg.h"
+
+namespace raspi_pkg
+{
+
+  class ImuConfig : public ros::Msg
+  {
+    public:
+      typedef uint16_t _accel_range_g_type;
+      _accel_range_g_type accel_range_g;
+      typedef uint16_t _gyro_range_dps_type;
+      _gyro_range_dps_type gyro_range_dps;
+      typedef float _rate_hz_type;
+      _rate_hz_type rate_hz;
+      typedef uint16_t _mag_range_gauss_type;
+      _mag_range_gauss_type mag_range_gauss;
+      typedef float _mag_rate_hz_type;
+      _mag_rate_hz_type mag_rate_hz;
+
+    ImuConfig():
+      accel_range_g(0),
+      gyro_range_dps(0),
+      rate_hz(0),
+      mag_range_gauss(0),
+      mag_rate_hz(0)
+    {
+    }
+
+    virtual int serialize(unsigned char *outbuffer) const override
+    {
+      int offset = 0;
+      *(outbuffer + offset + 0) = (this->accel_range_g >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->accel_range_g >> (8 * 1)) & 0xFF;
+      offset += sizeof(this->accel_range_g);
+      *(outbuffer + offset + 0) = (this->gyro_range_dps >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->gyro_range_dps >> (8 * 1)) & 0xFF;
+      offset += sizeof(this->gyro_range_dps);
+      union {
+        float real;
+        uint32_t base;
+      } u_rate_hz;
+      u_rate_hz.real = this->rate_hz;
+      *(outbuffer + offset + 0) = (u_rate_hz.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_rate_hz.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_rate_hz.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_rate_hz.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->rate_hz);
+      *(outbuffer + offset + 0) = (this->mag_range_gauss >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->mag_range_gauss >> (8 * 1)) & 0xFF;
+      offset += sizeof(this->mag_range_gauss);
+      union {
+        float real;
+        uint32_t base;
+      } u_mag_rate_hz;
+      u_mag_rate_hz.real = this->mag_rate_hz;
+      *(outbuffer + offset + 0) = (u_mag_rate_hz.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_mag_rate_hz.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_mag_rate_hz.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_mag_rate_hz.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->mag_rate_hz);
+      return offset;
+    }
+
+    virtual int deserialize(unsigned char *inbuffer) override
+    {
+      int offset = 0;
+      this->accel_range_g =  ((uint16_t) (*(inbuffer + offset)));
+      this->accel_range_g |= ((uint16_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      offset += sizeof(this->accel_range_g);
+      this->gyro_range_dps =  ((uint16_t) (*(inbuffer + offset)));
+      this->gyro_range_dps |= ((uint16_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      offset += sizeof(this->gyro_range_dps);
+      union {
+        float real;
+        uint32_t base;
+      } u_rate_hz;
+      u_rate_hz.base = 0;
+      u_rate_hz.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_rate_hz.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_rate_hz.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_rate_hz.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->rate_hz = u_rate_hz.real;
+      offset += sizeof(this->rate_hz);
+      this->mag_range_gauss =  ((uint16_t) (*(inbuffer + offset)));
+      this->mag_range_gauss |= ((uint16_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      offset += sizeof(this->mag_range_gauss);
+      union {
+        float real;
+        uint32_t base;
+      } u_mag_rate_hz;
+      u_mag_rate_hz.base = 0;
+      u_mag_rate_hz.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_mag_rate_hz.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_mag_rate_hz.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_mag_rate_hz.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->mag_rate_hz = u_mag_rate_hz.real;
+      offset += sizeof(this->mag_rate_hz);
+     return offset;
+    }
+
+    virtual const char * getType() override { return "raspi_pkg/ImuConfig"; };
+    virtual const char * getMD5() override { return "e7657924b6c7817808f6cbb0f48929e1"; };
+
+  };
+
+}
+#endif
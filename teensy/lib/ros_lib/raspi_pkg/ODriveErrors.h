@@ -0,0 +1,131 @@
+#ifndef _ROS_raspi_pkg_ODriveErrors_h
+#define _ROS_raspi_pkg_ODriveErrors_h
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ros/msg.h"
+
+namespace raspi_pkg
+{
+
+  class ODriveErrors : public ros::Msg
+  {
+    public:
+      typedef uint32_t _changes_type;
+      _changes_type changes;
+      typedef uint16_t _nonzero_type;
+      _nonzero_type nonzero;
+      typedef uint16_t _age_ms_type;
+      _age_ms_type age_ms;
+      uint32_t values_length;
+      typedef int64_t _values_type;
+      _values_type st_values;
+      _values_type * values;
+      enum { ODRIVE = 0 };
+      enum { MOTOR0 = 1 };
+      enum { MOTOR1 = 2 };
+      enum { AXIS0 = 3 };
+      enum { AXIS1 = 4 };
+      enum { ENCODER0 = 5 };
+      enum { ENCODER1 = 6 };
+      enum { CONTROLLER0 = 7 };
+      enum { CONTROLLER1 = 8 };
+      enum { NUM_REGISTERS = 9 };
+
+    ODriveErrors():
+      changes(0),
+      nonzero(0),
+      age_ms(0),
+      values_length(0), st_values(), values(nullptr)
+    {
+    }
+
+    virtual int serialize(unsigned char *outbuffer) const override
+    {
+      int offset = 0;
+      *(outbuffer + offset + 0) = (this->changes >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->changes >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->changes >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->changes >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->changes);
+      *(outbuffer + offset + 0) = (this->nonzero >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->nonzero >> (8 * 1)) & 0xFF;
+      offset += sizeof(this->nonzero);
+      *(outbuffer + offset + 0) = (this->age_ms >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->age_ms >> (8 * 1)) & 0xFF;
+      offset += sizeof(this->age_ms);
+      *(outbuffer + offset + 0) = (this->values_length >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->values_length >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->values_length >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->values_length >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->values_length);
+      for( uint32_t i = 0; i < values_length; i++){
+      union {
+        int64_t real;
+        uint64_t base;
+      } u_valuesi;
+      u_valuesi.real = this->values[i];
+      *(outbuffer + offset + 0) = (u_valuesi.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_valuesi.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_valuesi.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_valuesi.base >> (8 * 3)) & 0xFF;
+      *(outbuffer + offset + 4) = (u_valuesi.base >> (8 * 4)) & 0xFF;
+      *(outbuffer + offset + 5) = (u_valuesi.base >> (8 * 5)) & 0xFF;
+      *(outbuffer + offset + 6) = (u_valuesi.base >> (8 * 6)) & 0xFF;
+      *(outbuffer + offset + 7) = (u_valuesi.base >> (8 * 7)) & 0xFF;
+      offset += sizeof(this->values[i]);
+      }
+      return offset;
+    }
+
+    virtual int deserialize(unsigned char *inbuffer) override
+    {
+      int offset = 0;
+      this->changes =  ((uint32_t) (*(inbuffer + offset)));
+      this->changes |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->changes |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->changes |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->changes);
+      this->nonzero =  ((uint16_t) (*(inbuffer + offset)));
+      this->nonzero |= ((uint16_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      offset += sizeof(this->nonzero);
+      this->age_ms =  ((uint16_t) (*(inbuffer + offset)));
+      this->age_ms |= ((uint16_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      offset += sizeof(this->age_ms);
+      uint32_t values_lengthT = ((uint32_t) (*(inbuffer + offset))); 
+      values_lengthT |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1); 
+      values_lengthT |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2); 
+      values_lengthT |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3); 
+      offset += sizeof(this->values_length);
+      if(values_lengthT > values_length)
+        this->values = (int64_t*)realloc(this->values, values_lengthT * sizeof(int64_t));
+      values_length = values_lengthT;
+      for( uint32_t i = 0; i < values_length; i++){
+      union {
+        int64_t real;
+        uint64_t base;
+      } u_st_values;
+      u_st_values.base = 0;
+      u_st_values.base |= ((uint64_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_st_values.base |= ((uint64_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_st_values.base |= ((uint64_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_st_values.base |= ((uint64_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      u_st_values.base |= ((uint64_t) (*(inbuffer + offset + 4))) << (8 * 4);
+      u_st_values.base |= ((uint64_t) (*(inbuffer + offset + 5))) << (8 * 5);
+      u_st_values.base |= ((uint64_t) (*(inbuffer + offset + 6))) << (8 * 6);
+      u_st_values.base |= ((uint64_t) (*(inbuffer + offset + 7))) << (8 * 7);
+      this->st_values = u_st_values.real;
+      offset += sizeof(this->st_values);
+        memcpy( &(this->values[i]), &(this->st_values), sizeof(int64_t));
+      }
+     return offset;
+    }
+
+    virtual const char * getType() override { return "raspi_pkg/ODriveErrors"; };
+    virtual const char * getMD5() override { return "9dbb1e174a5e194b646081b383e12665"; };
+
+  };
+
+}
+#endif
@@ -0,0 +1,90 @@
+#ifndef _ROS_raspi_pkg_SensorBatch_h
+#define _ROS_raspi_pkg_SensorBatch_h
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ros/msg.h"
+#include "raspi_pkg/SensorSample.h"
+
+namespace raspi_pkg
+{
+
+  class SensorBatch : public ros::Msg
+  {
+    public:
+      typedef uint32_t _seq_type;
+      _seq_type seq;
+      typedef uint32_t _stamp_us_type;
+      _stamp_us_type stamp_us;
+      typedef uint8_t _stride_type;
+      _stride_type stride;
+      typedef uint8_t _count_type;
+      _count_type count;
+      raspi_pkg::SensorSample samples[8];
+      enum { MAX_SAMPLES = 8 };
+      // every sample is sent, used or not, so every batch is this long, for NodeHandle_::publishFixed()
+      static constexpr int serialized_size = 354;
+
+    SensorBatch():
+      seq(0),
+      stamp_us(0),
+      stride(0),
+      count(0),
+      samples()
+    {
+    }
+
+    virtual int serialize(unsigned char *outbuffer) const override
+    {
+      int offset = 0;
+      *(outbuffer + offset + 0) = (this->seq >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->seq >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->seq >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->seq >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->seq);
+      *(outbuffer + offset + 0) = (this->stamp_us >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->stamp_us >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->stamp_us >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->stamp_us >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->stamp_us);
+      *(outbuffer + offset + 0) = (this->stride >> (8 * 0)) & 0xFF;
+      offset += sizeof(this->stride);
+      *(outbuffer + offset + 0) = (this->count >> (8 * 0)) & 0xFF;
+      offset += sizeof(this->count);
+      for( uint32_t i = 0; i < 8; i++){
+      offset += this->samples[i].serialize(outbuffer + offset);
+      }
+      return offset;
+    }
+
+    virtual int deserialize(unsigned char *inbuffer) override
+    {
+      int offset = 0;
+      this->seq =  ((uint32_t) (*(inbuffer + offset)));
+      this->seq |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->seq |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->seq |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->seq);
+      this->stamp_us =  ((uint32_t) (*(inbuffer + offset)));
+      this->stamp_us |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->stamp_us |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->stamp_us |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->stamp_us);
+      this->stride =  ((uint8_t) (*(inbuffer + offset)));
+      offset += sizeof(this->stride);
+      this->count =  ((uint8_t) (*(inbuffer + offset)));
+      offset += sizeof(this->count);
+      for( uint32_t i = 0; i < 8; i++){
+      offset += this->samples[i].deserialize(inbuffer + offset);
+      }
+     return offset;
+    }
+
+    virtual const char * getType() override { return "raspi_pkg/SensorBatch"; };
+    virtual const char * getMD5() override { return "1e4ce69ac61de922ea2f09af4d659881"; };
+
+  };
+
+}
+#endif
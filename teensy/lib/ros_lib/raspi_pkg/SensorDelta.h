@@ -0,0 +1,126 @@
+#ifndef _ROS_raspi_pkg_SensorDelta_h
+#define _ROS_raspi_pkg_SensorDelta_h
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ros/msg.h"
+
+namespace raspi_pkg
+{
+
+  class SensorDelta : public ros::Msg
+  {
+    public:
+      typedef uint16_t _frame_type;
+      _frame_type frame;
+      typedef uint32_t _seq_type;
+      _seq_type seq;
+      typedef uint8_t _stride_type;
+      _stride_type stride;
+      typedef uint8_t _count_type;
+      _count_type count;
+      typedef uint8_t _flags_type;
+      _flags_type flags;
+      uint32_t data_length;
+      typedef uint8_t _data_type;
+      _data_type st_data;
+      _data_type * data;
+      enum { FLAG_KEYFRAME = 1 };
+      enum { CH_STAMP_US = 0 };
+      enum { CH_TORSO_ROLL = 1 };
+      enum { CH_TORSO_OMEGA = 2 };
+      enum { CH_YAW = 3 };
+      enum { CH_SPOKE_ANGLE_0 = 4 };
+      enum { CH_SPOKE_ANGLE_1 = 5 };
+      enum { CH_SPOKE_OMEGA_0 = 6 };
+      enum { CH_SPOKE_OMEGA_1 = 7 };
+      enum { CH_STATUS = 8 };
+      enum { CH_MOTOR_CURRENT_0 = 9 };
+      enum { CH_MOTOR_CURRENT_1 = 10 };
+      enum { CH_VBUS_VOLTAGE = 11 };
+      enum { NUM_CHANNELS = 12 };
+      static constexpr float ANGLE_LSB = 0.00001;
+      static constexpr float RATE_LSB = 0.0001;
+      static constexpr float CURRENT_LSB = 0.01;
+      static constexpr float VOLTAGE_LSB = 0.01;
+
+    SensorDelta():
+      frame(0),
+      seq(0),
+      stride(0),
+      count(0),
+      flags(0),
+      data_length(0), st_data(), data(nullptr)
+    {
+    }
+
+    virtual int serialize(unsigned char *outbuffer) const override
+    {
+      int offset = 0;
+      *(outbuffer + offset + 0) = (this->frame >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->frame >> (8 * 1)) & 0xFF;
+      offset += sizeof(this->frame);
+      *(outbuffer + offset + 0) = (this->seq >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->seq >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->seq >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->seq >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->seq);
+      *(outbuffer + offset + 0) = (this->stride >> (8 * 0)) & 0xFF;
+      offset += sizeof(this->stride);
+      *(outbuffer + offset + 0) = (this->count >> (8 * 0)) & 0xFF;
+      offset += sizeof(this->count);
+      *(outbuffer + offset + 0) = (this->flags >> (8 * 0)) & 0xFF;
+      offset += sizeof(this->flags);
+      *(outbuffer + offset + 0) = (this->data_length >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->data_length >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->data_length >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->data_length >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->data_length);
+      for( uint32_t i = 0; i < data_length; i++){
+      *(outbuffer + offset + 0) = (this->data[i] >> (8 * 0)) & 0xFF;
+      offset += sizeof(this->data[i]);
+      }
+      return offset;
+    }
+
+    virtual int deserialize(unsigned char *inbuffer) override
+    {
+      int offset = 0;
+      this->frame =  ((uint16_t) (*(inbuffer + offset)));
+      this->frame |= ((uint16_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      offset += sizeof(this->frame);
+      this->seq =  ((uint32_t) (*(inbuffer + offset)));
+      this->seq |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->seq |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->seq |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->seq);
+      this->stride =  ((uint8_t) (*(inbuffer + offset)));
+      offset += sizeof(this->stride);
+      this->count =  ((uint8_t) (*(inbuffer + offset)));
+      offset += sizeof(this->count);
+      this->flags =  ((uint8_t) (*(inbuffer + offset)));
+      offset += sizeof(this->flags);
+      uint32_t data_lengthT = ((uint32_t) (*(inbuffer + offset))); 
+      data_lengthT |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1); 
+      data_lengthT |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2); 
+      data_lengthT |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3); 
+      offset += sizeof(this->data_length);
+      if(data_lengthT > data_length)
+        this->data = (uint8_t*)realloc(this->data, data_lengthT * sizeof(uint8_t));
+      data_length = data_lengthT;
+      for( uint32_t i = 0; i < data_length; i++){
+      this->st_data =  ((uint8_t) (*(inbuffer + offset)));
+      offset += sizeof(this->st_data);
+        memcpy( &(this->data[i]), &(this->st_data), sizeof(uint8_t));
+      }
+     return offset;
+    }
+
+    virtual const char * getType() override { return "raspi_pkg/SensorDelta"; };
+    virtual const char * getMD5() override { return "a2d263dc7a86e1cf18c204c4c14e6fff"; };
+
+  };
+
+}
+#endif
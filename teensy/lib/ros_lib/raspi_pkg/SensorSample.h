@@ -0,0 +1,233 @@
+#ifndef _ROS_raspi_pkg_SensorSample_h
+#define _ROS_raspi_pkg_SensorSample_h
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ros/msg.h"
+
+namespace raspi_pkg
+{
+
+  class SensorSample : public ros::Msg
+  {
+    public:
+      typedef uint16_t _offset_us_type;
+      _offset_us_type offset_us;
+      typedef float _torso_roll_type;
+      _torso_roll_type torso_roll;
+      typedef float _torso_omega_type;
+      _torso_omega_type torso_omega;
+      typedef float _yaw_type;
+      _yaw_type yaw;
+      float spoke_angle[2];
+      float spoke_omega[2];
+      typedef uint8_t _status_type;
+      _status_type status;
+      float motor_current[2];
+      typedef float _vbus_voltage_type;
+      _vbus_voltage_type vbus_voltage;
+      // fixed size, so raspi_pkg/SensorBatch is too
+      static constexpr int serialized_size = 43;
+
+    SensorSample():
+      offset_us(0),
+      torso_roll(0),
+      torso_omega(0),
+      yaw(0),
+      spoke_angle(),
+      spoke_omega(),
+      status(0),
+      motor_current(),
+      vbus_voltage(0)
+    {
+    }
+
+    virtual int serialize(unsigned char *outbuffer) const override
+    {
+      int offset = 0;
+      *(outbuffer + offset + 0) = (this->offset_us >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->offset_us >> (8 * 1)) & 0xFF;
+      offset += sizeof(this->offset_us);
+      union {
+        float real;
+        uint32_t base;
+      } u_torso_roll;
+      u_torso_roll.real = this->torso_roll;
+      *(outbuffer + offset + 0) = (u_torso_roll.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_torso_roll.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_torso_roll.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_torso_roll.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->torso_roll);
+      union {
+        float real;
+        uint32_t base;
+      } u_torso_omega;
+      u_torso_omega.real = this->torso_omega;
+      *(outbuffer + offset + 0) = (u_torso_omega.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_torso_omega.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_torso_omega.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_torso_omega.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->torso_omega);
+      union {
+        float real;
+        uint32_t base;
+      } u_yaw;
+      u_yaw.real = this->yaw;
+      *(outbuffer + offset + 0) = (u_yaw.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_yaw.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_yaw.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_yaw.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->yaw);
+      for( uint32_t i = 0; i < 2; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_spoke_anglei;
+      u_spoke_anglei.real = this->spoke_angle[i];
+      *(outbuffer + offset + 0) = (u_spoke_anglei.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_spoke_anglei.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_spoke_anglei.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_spoke_anglei.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->spoke_angle[i]);
+      }
+      for( uint32_t i = 0; i < 2; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_spoke_omegai;
+      u_spoke_omegai.real = this->spoke_omega[i];
+      *(outbuffer + offset + 0) = (u_spoke_omegai.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_spoke_omegai.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_spoke_omegai.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_spoke_omegai.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->spoke_omega[i]);
+      }
+      *(outbuffer + offset + 0) = (this->status >> (8 * 0)) & 0xFF;
+      offset += sizeof(this->status);
+      for( uint32_t i = 0; i < 2; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_motor_currenti;
+      u_motor_currenti.real = this->motor_current[i];
+      *(outbuffer + offset + 0) = (u_motor_currenti.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_motor_currenti.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_motor_currenti.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_motor_currenti.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->motor_current[i]);
+      }
+      union {
+        float real;
+        uint32_t base;
+      } u_vbus_voltage;
+      u_vbus_voltage.real = this->vbus_voltage;
+      *(outbuffer + offset + 0) = (u_vbus_voltage.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_vbus_voltage.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_vbus_voltage.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_vbus_voltage.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->vbus_voltage);
+      return offset;
+    }
+
+    virtual int deserialize(unsigned char *inbuffer) override
+    {
+      int offset = 0;
+      this->offset_us =  ((uint16_t) (*(inbuffer + offset)));
+      this->offset_us |= ((uint16_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      offset += sizeof(this->offset_us);
+      union {
+        float real;
+        uint32_t base;
+      } u_torso_roll;
+      u_torso_roll.base = 0;
+      u_torso_roll.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_torso_roll.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_torso_roll.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_torso_roll.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->torso_roll = u_torso_roll.real;
+      offset += sizeof(this->torso_roll);
+      union {
+        float real;
+        uint32_t base;
+      } u_torso_omega;
+      u_torso_omega.base = 0;
+      u_torso_omega.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_torso_omega.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_torso_omega.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_torso_omega.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->torso_omega = u_torso_omega.real;
+      offset += sizeof(this->torso_omega);
+      union {
+        float real;
+        uint32_t base;
+      } u_yaw;
+      u_yaw.base = 0;
+      u_yaw.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_yaw.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_yaw.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_yaw.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->yaw = u_yaw.real;
+      offset += sizeof(this->yaw);
+      for( uint32_t i = 0; i < 2; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_spoke_anglei;
+      u_spoke_anglei.base = 0;
+      u_spoke_anglei.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_spoke_anglei.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_spoke_anglei.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_spoke_anglei.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->spoke_angle[i] = u_spoke_anglei.real;
+      offset += sizeof(this->spoke_angle[i]);
+      }
+      for( uint32_t i = 0; i < 2; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_spoke_omegai;
+      u_spoke_omegai.base = 0;
+      u_spoke_omegai.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_spoke_omegai.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_spoke_omegai.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_spoke_omegai.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->spoke_omega[i] = u_spoke_omegai.real;
+      offset += sizeof(this->spoke_omega[i]);
+      }
+      this->status =  ((uint8_t) (*(inbuffer + offset)));
+      offset += sizeof(this->status);
+      for( uint32_t i = 0; i < 2; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_motor_currenti;
+      u_motor_currenti.base = 0;
+      u_motor_currenti.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_motor_currenti.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_motor_currenti.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_motor_currenti.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->motor_current[i] = u_motor_currenti.real;
+      offset += sizeof(this->motor_current[i]);
+      }
+      union {
+        float real;
+        uint32_t base;
+      } u_vbus_voltage;
+      u_vbus_voltage.base = 0;
+      u_vbus_voltage.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_vbus_voltage.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_vbus_voltage.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_vbus_voltage.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->vbus_voltage = u_vbus_voltage.real;
+      offset += sizeof(this->vbus_voltage);
+     return offset;
+    }
+
+    virtual const char * getType() override { return "raspi_pkg/SensorSample"; };
+    virtual const char * getMD5() override { return "543c967ebc173e1c934bac03f6cc0453"; };
+
+  };
+
+}
+#endif
@@ -0,0 +1,65 @@
+#ifndef _ROS_raspi_pkg_Teleop_h
+#define _ROS_raspi_pkg_Teleop_h
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ros/msg.h"
+
+namespace raspi_pkg
+{
+
+  class Teleop : public ros::Msg
+  {
+    public:
+      float velocity[2];
+
+    Teleop():
+      velocity()
+    {
+    }
+
+    virtual int serialize(unsigned char *outbuffer) const override
+    {
+      int offset = 0;
+      for( uint32_t i = 0; i < 2; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_velocityi;
+      u_velocityi.real = this->velocity[i];
+      *(outbuffer + offset + 0) = (u_velocityi.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_velocityi.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_velocityi.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_velocityi.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->velocity[i]);
+      }
+      return offset;
+    }
+
+    virtual int deserialize(unsigned char *inbuffer) override
+    {
+      int offset = 0;
+      for( uint32_t i = 0; i < 2; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_velocityi;
+      u_velocityi.base = 0;
+      u_velocityi.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_velocityi.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_velocityi.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_velocityi.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->velocity[i] = u_velocityi.real;
+      offset += sizeof(this->velocity[i]);
+      }
+     return offset;
+    }
+
+    virtual const char * getType() override { return "raspi_pkg/Teleop"; };
+    virtual const char * getMD5() override { return "2fc2245d885b8a0704f57430560283d3"; };
+
+  };
+
+}
+#endif
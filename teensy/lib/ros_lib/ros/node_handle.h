@@ -172,6 +172,7 @@ protected:
   int checksum_{0};
 
   bool configured_{false};
+  uint32_t dropped_frames_{0};
 
   /* used for syncing the time */
   uint32_t last_sync_time{0};
@@ -467,6 +468,19 @@ public:
   }
 
   virtual int publish(int id, const Msg * msg) override
+  {
+    int l = frame(id, msg);
+    if (l > 0)
+      hardware_.write(message_out, l);
+    return l;
+  }
+
+  /* Frame a message into message_out, as publish() would send it, without
+   * sending it: for a caller that queues the frame (LinkScheduler). The
+   * frame is framed() until the next publish() or frame(); returns its
+   * length, 0 before the topics are negotiated, -1 if it is too long.
+   */
+  int frame(int id, const Msg * msg)
   {
     if (id >= 100 && !configured_)
       return 0;
@@ -492,7 +506,6 @@ public:
 
     if (l <= OUTPUT_SIZE)
     {
-      hardware_.write(message_out, l);
       return l;
     }
     else
@@ -502,6 +515,58 @@ public:
     }
   }
 
+  const uint8_t * framed() const
+  {
+    return message_out;
+  }
+
+  /* Publish a message of fixed serialized size (M::serialized_size) without
+   * message_out: the frame is built on the stack, header in front of the
+   * body, and written in one call. A frame the hardware cannot take
+   * without waiting (its transmit buffer is short of it) is dropped instead
+   * and counted in droppedFrames(); it returns 0 then.
+   */
+  template<class M>
+  int publishFixed(int id, const M& msg)
+  {
+    if (id >= 100 && !configured_)
+      return 0;
+
+    constexpr int l = M::serialized_size;
+    static_assert(l + 8 <= OUTPUT_SIZE, "no larger than a frame in message_out");
+    uint8_t frame[l + 8];
+    if (hardware_.availableForWrite() < l + 8)
+    {
+      ++dropped_frames_;
+      return 0;
+    }
+    if (msg.serialize(frame + 7) != l)
+    {
+      logerror("Message from device dropped: serialized_size mismatch.");
+      return -1;
+    }
+
+    frame[0] = 0xff;
+    frame[1] = PROTOCOL_VER;
+    frame[2] = (uint8_t)((uint16_t)l & 255);
+    frame[3] = (uint8_t)((uint16_t)l >> 8);
+    frame[4] = 255 - ((frame[2] + frame[3]) % 256);
+    frame[5] = (uint8_t)((int16_t)id & 255);
+    frame[6] = (uint8_t)((int16_t)id >> 8);
+    int chk = frame[5] + frame[6];
+    for (int i = 7; i < l + 7; i++)
+      chk += frame[i];
+    frame[l + 7] = 255 - (chk % 256);
+
+    hardware_.write(frame, l + 8);
+    return l + 8;
+  }
+
+  uint32_t droppedFrames() const
+  {
+    return dropped_frames_;
+  }
+
   /********************************************************************
    * Logging
    */
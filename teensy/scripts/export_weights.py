@@ -0,0 +1,19 @@
+# PlatformIO pre-build step: regenerate lib/NeuralPBC/weights from the Julia
+# package's saved_weights, see julia_pkg/src/exportWeights.py; an env's
+# custom_pbc_prune = T is passed on as --prune T, for SparsePBC's pass
+Import("env")
+import os
+import subprocess
+
+project_dir = env.subst("$PROJECT_DIR")
+exporter = os.path.join(project_dir, "..", "julia_ws", "catkin_ws", "src", "julia_pkg", "src", "exportWeights.py")
+out_dir = os.path.join(project_dir, "lib", "NeuralPBC", "weights")
+
+if os.path.exists(exporter):
+    command = [env.subst("$PYTHONEXE"), exporter, "--out", out_dir]
+    prune = env.GetProjectOption("custom_pbc_prune", "")
+    if prune:
+        command += ["--prune", prune]
+    subprocess.check_call(command)
+else:
+    print("export_weights: %s not found, using the committed headers" % exporter)
@@ -0,0 +1,129 @@
+# PlatformIO post-build step, or on its own:
+#
+#     python3 scripts/memory_report.py .pio/build/teensy40/firmware.map [--objects]
+#
+# RAM1 (ITCM code, DTCM .data/.bss and what is left of it for the stack), RAM2
+# (DMAMEM, heap) and flash of the firmware, per library or object file, from
+# the link map. The firmware's own view at run time, stack high-water and
+# heap included, is the "memory" status on /diagnostics (lib/ControlLoop/MemoryBudget.h).
+import argparse
+import collections
+import os
+import re
+import sys
+
+try:
+    Import("env")
+except NameError:
+    env = None
+
+FLEXRAM = 512*1024
+FLEXRAM_BLOCK = 32*1024
+RAM2 = 512*1024
+STACK_RESERVE = 16*1024  # below this much DTCM left for the stack, warn
+
+# output section -> region, imxrt1062.ld
+REGIONS = {
+    ".text.itcm": "itcm",
+    ".ARM.exidx": "itcm",
+    ".data": "dtcm",
+    ".bss": "dtcm",
+    ".bss.dma": "ram2",
+    ".text.progmem": "flash",
+    ".text.code": "flash",
+    ".text.csf": "flash",
+    ".text.headers": "flash",
+}
+COLUMNS = ("itcm", "dtcm", "ram2", "flash")
+
+INPUT = re.compile(r"^ (\S+)?\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+NAME_ONLY = re.compile(r"^ (\S+)$")
+OUTPUT = re.compile(r"^(\.\S+)")
+ARCHIVE = re.compile(r"([^/\\]+)\.a\(([^)]+)\)$")
+
+
+def module(path, objects):
+    m = ARCHIVE.search(path)
+    if m:
+        lib = m.group(1)
+        lib = lib[3:] if lib.startswith("lib") else lib
+        return "%s(%s)" % (lib, m.group(2)) if objects else lib
+    return os.path.basename(path)
+
+
+def parse(map_path, objects):
+    usage = collections.defaultdict(lambda: collections.Counter())
+    section = None
+    pending = False
+    with open(map_path) as f:
+        for line in f:
+            if line.startswith("Linker script and memory map"):
+                break
+        for line in f:
+            line = line.rstrip("\n")
+            m = OUTPUT.match(line)
+            if m:
+                section = REGIONS.get(m.group(1))
+                continue
+            if section is None:
+                continue
+            if NAME_ONLY.match(line):
+                pending = True  # a long input section name, its numbers follow
+                continue
+            m = INPUT.match(line)
+            if not m or (m.group(1) is None and not pending):
+                pending = False
+                continue
+            pending = False
+            if m.group(1) and m.group(1).startswith("*"):
+                continue  # *fill*, *(pattern)
+            size = int(m.group(3), 16)
+            if size:
+                usage[module(m.group(4), objects)][section] += size
+    return usage
+
+
+def report(usage, out=sys.stdout, top=12):
+    totals = collections.Counter()
+    for counts in usage.values():
+        totals.update(counts)
+
+    itcm = -(-totals["itcm"] // FLEXRAM_BLOCK)*FLEXRAM_BLOCK
+    stack = FLEXRAM - itcm - totals["dtcm"]
+    out.write("RAM1: itcm %d of %d (%d blocks), dtcm %d, stack %d free\n"
+              % (totals["itcm"], itcm, itcm // FLEXRAM_BLOCK, totals["dtcm"], stack))
+    out.write("RAM2: dmamem %d, heap %d\n" % (totals["ram2"], RAM2 - totals["ram2"]))
+    out.write("flash: %d\n" % totals["flash"])
+
+    out.write("%-40s" % "module" + "".join("%10s" % c for c in COLUMNS) + "\n")
+    ranked = sorted(usage.items(), key=lambda kv: -(kv[1]["itcm"] + kv[1]["dtcm"]))
+    for name, counts in ranked[:top]:
+        out.write("%-40s" % name[:40] + "".join("%10d" % counts[c] for c in COLUMNS) + "\n")
+    if len(ranked) > top:
+        rest = collections.Counter()
+        for _, counts in ranked[top:]:
+            rest.update(counts)
+        out.write("%-40s" % ("%d more" % (len(ranked) - top))
+                  + "".join("%10d" % rest[c] for c in COLUMNS) + "\n")
+
+    if stack < STACK_RESERVE:
+        out.write("WARNING: %d bytes of DTCM left for the stack, under %d\n" % (stack, STACK_RESERVE))
+    return stack >= STACK_RESERVE
+
+
+if env is not None:
+    map_path = os.path.join(env.subst("$BUILD_DIR"), env.subst("${PROGNAME}.map"))
+    env.Append(LINKFLAGS=["-Wl,-Map," + map_path])
+
+    def after_link(source, target, env):
+        report(parse(map_path, False))
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", after_link)
+
+elif __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="RAM1/RAM2/flash use per module from a link map")
+    parser.add_argument("map", help="the linker's map file, e.g. .pio/build/teensy40/firmware.map")
+    parser.add_argument("--objects", action="store_true", help="one row per object file instead of per library")
+    parser.add_argument("--top", type=int, default=12)
+    args = parser.parse_args()
+    sys.exit(0 if report(parse(args.map, args.objects), top=args.top) else 1)
@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""Performance gate: the micro-benchmarks and the replay suite against a saved baseline.
+
+    ./perf_gate.py --build build-host --baseline perf_baseline --update RUN.bson ...  # save one
+    ./perf_gate.py --build build-host --baseline perf_baseline RUN.bson ...           # compare
+
+bench (host/bench.cpp) gives the time per call of every compute-core benchmark,
+in cycles when the report has them (the Teensy's, env:teensy40_bench), in ns
+otherwise; replay (host/replay.cpp) gives per run the estimators' RMS errors,
+the event counts and the mean time per call of every stage. A directory among
+the runs stands for the .bson, .BIN and .rwa files in it.
+
+A benchmark or stage that got slower by more than --threshold (20 %), an
+error that grew by more than --error-threshold (5 %), or a stage that started
+producing non-finite values is a regression, and the exit code is 1. Changed
+event counts are listed, as the estimators now see the runs differently, but
+do not fail the gate. --bench-report and --replay-report compare saved
+reports instead of running the tools, e.g. a bench JSON captured from the
+Teensy's serial port.
+
+Host timings move by a few percent from run to run; --repeat takes the
+fastest of several bench and replay runs, for the baseline and the
+comparison alike, and a replay stage with fewer than --min-calls calls is
+not timed at all. On a shared or frequency-scaled machine the whole suite
+can drift by more than the threshold between runs: save the baseline and
+compare on the same idle machine, or raise --threshold there.
+"""
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+
+RUN_SUFFIXES = (".bson", ".BIN", ".bin", ".rwa")
+
+
+def expand_runs(paths):
+    runs = []
+    for path in paths:
+        if os.path.isdir(path):
+            runs += sorted(os.path.join(path, f) for f in os.listdir(path) if f.endswith(RUN_SUFFIXES))
+        else:
+            runs.append(path)
+    return runs
+
+
+def run_bench(build, repeat, min_time):
+    best = None
+    for _ in range(repeat):
+        out = subprocess.run([os.path.join(build, "bench"), str(min_time)], check=True,
+                             stdout=subprocess.PIPE, universal_newlines=True).stdout
+        report = json.loads(out)
+        if best is None:
+            best = report
+            continue
+        fastest = {b["name"]: b for b in best["benchmarks"]}
+        for b in report["benchmarks"]:
+            if b["name"] in fastest and per_call(b)[0] < per_call(fastest[b["name"]])[0]:
+                fastest[b["name"]].update(b)
+    return best
+
+
+def run_replay(build, runs, repeat):
+    """replay's summary; with repeat, the fastest mean of each stage over that many replays"""
+    best = None
+    for _ in range(repeat):
+        # exit code 1 is a non-finite value, which the comparison reports
+        out = subprocess.run([os.path.join(build, "replay")] + runs, stdout=subprocess.PIPE,
+                             universal_newlines=True).stdout
+        report = parse_replay(out)
+        if best is None:
+            best = report
+            continue
+        for run, keys in report.items():
+            for key, value in keys.items():
+                if key.startswith("time_") and not key.endswith("_calls") and value < best[run].get(key, value + 1):
+                    best[run][key] = value
+    return best
+
+
+def per_call(bench):
+    """The benchmark's cost per call and its unit: cycles where the target counts them"""
+    if "cycles" in bench:
+        return bench["cycles"], "cycles"
+    return bench["cpu_time"], bench.get("time_unit", "ns")
+
+
+def parse_replay(text):
+    """{run: {key: value}} from replay's "key value" summary; stage times as time_<stage>_ns"""
+    runs = {}
+    current = None
+    for line in text.splitlines():
+        fields = line.split()
+        if len(fields) < 2:
+            continue
+        if fields[0] == "run":
+            current = runs.setdefault(os.path.basename(" ".join(fields[1:])), {})
+        elif current is not None:
+            try:
+                # time_<stage>_ns mean M max X calls N: the mean is what a regression moves
+                if fields[1] == "mean":
+                    current[fields[0]] = float(fields[2])
+                    current[fields[0] + "_calls"] = float(fields[6])
+                else:
+                    current[fields[0]] = float(fields[1])
+            except (ValueError, IndexError):
+                pass
+    return runs
+
+
+def slower(new, old, threshold):
+    return old > 0 and new > old*(1.0 + threshold)
+
+
+def compare_bench(base, new, threshold, out):
+    regressions = 0
+    old = {b["name"]: b for b in base["benchmarks"]}
+    for b in new["benchmarks"]:
+        if b["name"] not in old:
+            print("  new      %-40s %10.1f %s" % ((b["name"],) + per_call(b)), file=out)
+            continue
+        value, unit = per_call(b)
+        before, base_unit = per_call(old[b["name"]])
+        if unit != base_unit:
+            print("  skipped  %-40s %s against a %s baseline" % (b["name"], unit, base_unit), file=out)
+            continue
+        change = value/before - 1.0 if before > 0 else 0.0
+        if slower(value, before, threshold):
+            regressions += 1
+            tag = "SLOWER"
+        elif change < -threshold:
+            tag = "faster"
+        else:
+            continue
+        print("  %-8s %-40s %10.1f -> %10.1f %s (%+.0f %%)" % (tag, b["name"], before, value, unit, 100*change), file=out)
+    for name in sorted(set(old) - {b["name"] for b in new["benchmarks"]}):
+        print("  gone     %s" % name, file=out)
+    return regressions
+
+
+def compare_replay(base, new, threshold, error_threshold, min_calls, out):
+    regressions = 0
+    for run in sorted(new):
+        if run not in base:
+            print("  new run  %s" % run, file=out)
+            continue
+        for key, value in sorted(new[run].items()):
+            if key not in base[run]:
+                continue
+            before = base[run][key]
+            what = None
+            if key.startswith("time_"):
+                # a stage called a few times, the impact map's, is timed to within the noise only
+                if key.endswith("_calls") or new[run].get(key + "_calls", 0) < min_calls:
+                    continue
+                if slower(value, before, threshold):
+                    what = "SLOWER"
+            elif key.endswith("_rms"):
+                if math.isnan(before) and math.isnan(value):
+                    continue
+                if math.isnan(value) or (not math.isnan(before) and value > before*(1.0 + error_threshold) + 1e-9):
+                    what = "WORSE"
+            elif key == "non_finite":
+                if value > before:
+                    what = "WORSE"
+            elif key in ("impacts", "ekf_events") and value != before:
+                print("  changed  %-24s %-24s %g -> %g" % (run, key, before, value), file=out)
+            if what:
+                regressions += 1
+                print("  %-8s %-24s %-24s %g -> %g" % (what, run, key, before, value), file=out)
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="bench and replay against a baseline; exit 1 on a regression")
+    parser.add_argument("runs", nargs="*", help="recorded runs for replay, or directories of them")
+    parser.add_argument("--build", default="build-host", help="the host build with bench and replay")
+    parser.add_argument("--baseline", required=True, help="directory of bench.json and replay.json")
+    parser.add_argument("--update", action="store_true", help="save the reports as the baseline and compare nothing")
+    parser.add_argument("--threshold", type=float, default=0.20, help="fraction a time may grow by")
+    parser.add_argument("--error-threshold", type=float, default=0.05, help="fraction an RMS error may grow by")
+    parser.add_argument("--repeat", type=int, default=1, help="bench and replay runs, the fastest of each is kept")
+    parser.add_argument("--min-calls", type=int, default=1000, help="calls a replay stage needs for its time to count")
+    parser.add_argument("--min-time", type=float, default=0.5, help="bench's seconds per benchmark")
+    parser.add_argument("--bench-report", help="a bench JSON to use instead of running bench")
+    parser.add_argument("--replay-report", help="a replay summary to use instead of running replay")
+    args = parser.parse_args()
+
+    if args.bench_report:
+        with open(args.bench_report) as f:
+            bench = json.load(f)
+    else:
+        bench = run_bench(args.build, max(args.repeat, 1), args.min_time)
+    replay = None
+    if args.replay_report:
+        with open(args.replay_report) as f:
+            replay = parse_replay(f.read())
+    elif args.runs:
+        replay = run_replay(args.build, expand_runs(args.runs), max(args.repeat, 1))
+
+    bench_path = os.path.join(args.baseline, "bench.json")
+    replay_path = os.path.join(args.baseline, "replay.json")
+    if args.update:
+        os.makedirs(args.baseline, exist_ok=True)
+        with open(bench_path, "w") as f:
+            json.dump(bench, f, indent=1)
+        if replay:
+            with open(replay_path, "w") as f:
+                json.dump(replay, f, indent=1, sort_keys=True)
+        print("baseline saved to %s" % args.baseline)
+        return 0
+
+    regressions = 0
+    with open(bench_path) as f:
+        base_bench = json.load(f)
+    print("bench: %s against %s" % (bench["context"].get("target", "?"), base_bench["context"].get("target", "?")))
+    regressions += compare_bench(base_bench, bench, args.threshold, sys.stdout)
+    if replay and os.path.exists(replay_path):
+        with open(replay_path) as f:
+            base_replay = json.load(f)
+        print("replay:")
+        regressions += compare_replay(base_replay, replay, args.threshold, args.error_threshold, args.min_calls,
+                                      sys.stdout)
+    elif replay:
+        print("replay: no baseline in %s, run with --update" % args.baseline)
+
+    print("%d regression(s)" % regressions)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
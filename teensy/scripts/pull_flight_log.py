@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Pull flight-recorder runs off the SPI flash over the Teensy's second USB serial.
+
+The firmware serves SpiFlashLog::serveDump() on SerialUSB1 while the E-stop
+is engaged (build env teensy40_flightlog). Usage:
+
+    ./pull_flight_log.py /dev/ttyACM1            # list the runs, oldest first
+    ./pull_flight_log.py /dev/ttyACM1 -1 -o run.bin   # newest run to run.bin
+
+The file is the run as recorded, header block first, the same layout as the
+FLIGHTnn.BIN files SdFlightLog writes.
+"""
+import argparse
+import sys
+import time
+
+import serial  # pyserial
+
+
+def list_runs(port):
+    port.write(b"L")
+    runs = []
+    while True:
+        line = port.readline().decode("ascii", "replace").strip()
+        if not line:
+            raise IOError("no reply, is the E-stop engaged?")
+        if line == "END":
+            return runs
+        if line.startswith("ERR"):
+            raise IOError(line)
+        _, n, address, size = line.split()
+        runs.append((int(n), int(address), int(size)))
+
+
+def dump_run(port, n, out):
+    port.write(b"D%d\n" % n)
+    line = port.readline().decode("ascii", "replace").strip()
+    if not line.startswith("BIN "):
+        raise IOError(line or "no reply")
+    size = int(line.split()[1])
+    left, start = size, time.time()
+    while left > 0:
+        chunk = port.read(min(left, 1 << 16))
+        if not chunk:
+            raise IOError("transfer stalled with %d bytes left" % left)
+        out.write(chunk)
+        left -= len(chunk)
+    return size, time.time() - start
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("device", help="SerialUSB1 of the Teensy, e.g. /dev/ttyACM1")
+    parser.add_argument("run", nargs="?", type=int, help="run to pull, negative counts from the newest")
+    parser.add_argument("-o", "--out", help="output file (default: flight<run>.bin)")
+    args = parser.parse_args(argv)
+
+    with serial.Serial(args.device, timeout=2.0) as port:
+        port.reset_input_buffer()
+        runs = list_runs(port)
+        if args.run is None:
+            for n, address, size in runs:
+                print("run %d  at 0x%08x  %d bytes" % (n, address, size))
+            return 0
+        if not runs or not -len(runs) <= args.run < len(runs):
+            print("no run %d, %d on the flash" % (args.run, len(runs)), file=sys.stderr)
+            return 1
+        n = runs[args.run][0]
+        path = args.out or "flight%02d.bin" % n
+        with open(path, "wb") as out:
+            size, elapsed = dump_run(port, n, out)
+        print("%s: %d bytes in %.1f s" % (path, size, elapsed))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Pull the stage trace off the Teensy over its second USB serial as Chrome trace JSON.
+
+The firmware serves TraceBuffer::serveDump() on SerialUSB1 while the E-stop
+is engaged (build env teensy40_trace). The ring freezes on the first
+failure of a run (TRACE_TRIGGER_STATUS, the E-stop included) and the
+E-stop's release re-arms it, so pull before releasing. Usage:
+
+    ./pull_trace.py /dev/ttyACM1 -o trace.json            # pull and convert
+    ./pull_trace.py /dev/ttyACM1 -o trace.json --raw t.bin  # keep the dump too
+    ./pull_trace.py --from t.bin -o trace.json             # convert a kept dump
+    ./pull_trace.py /dev/ttyACM1 --arm                     # record over again
+
+Open the JSON in chrome://tracing or ui.perfetto.dev: the control interrupt
+and loop() are a thread each, every profiler section a slice, and the
+trigger an instant event with the /sensors status bits that fired it.
+"""
+import argparse
+import json
+import struct
+import sys
+
+EVENT = struct.Struct("<IBBBB")
+BEGIN, END, TRIGGER = 0, 1, 2
+THREADS = {0: "loop()", 1: "control interrupt"}
+# raspi_pkg/SensorState's STATUS_* bits
+STATUS_BITS = ((1, "estop"), (2, "odrive_error"), (4, "feedback_stale"), (8, "overrun"),
+               (16, "calibrating"), (32, "command_timeout"))
+
+
+def read_line(port):
+    line = port.readline().decode("ascii", "replace").strip()
+    if not line:
+        raise IOError("no reply, is the E-stop engaged and the build TRACE_BUFFER?")
+    return line
+
+
+def pull(port):
+    """the dump's bytes as the firmware sent them"""
+    port.write(b"T")
+    header = read_line(port)
+    if not header.startswith("TRACE "):
+        raise IOError(header)
+    events, _, sections = (int(x) for x in header.split()[1:])
+    names = [read_line(port) for _ in range(sections)]
+    size = events * EVENT.size
+    data = bytearray()
+    while len(data) < size:
+        chunk = port.read(min(size - len(data), 1 << 16))
+        if not chunk:
+            raise IOError("transfer stalled with %d bytes left" % (size - len(data)))
+        data += chunk
+    return "\n".join([header] + names).encode() + b"\n" + bytes(data)
+
+
+def parse(dump):
+    """(cpu_hz, section names, [(cycles, section, phase, context)])"""
+    header, _, rest = dump.partition(b"\n")
+    fields = header.decode().split()
+    if len(fields) != 4 or fields[0] != "TRACE":
+        raise ValueError("not a trace dump")
+    events, cpu_hz, sections = (int(x) for x in fields[1:])
+    names = []
+    for _ in range(sections):
+        name, _, rest = rest.partition(b"\n")
+        names.append(name.decode())
+    if len(rest) < events * EVENT.size:
+        raise ValueError("dump cut short: %d of %d events" % (len(rest) // EVENT.size, events))
+    return cpu_hz, names, [EVENT.unpack_from(rest, i * EVENT.size)[:4] for i in range(events)]
+
+
+def chrome_trace(cpu_hz, names, events):
+    """Chrome trace JSON events; the stamps are unwrapped from 32-bit cycles by signed
+    differences, which the few cycles of disorder a preemption leaves do not upset"""
+    out = [{"name": "thread_name", "ph": "M", "pid": 0, "tid": tid, "args": {"name": name}}
+           for tid, name in THREADS.items()]
+    # a slice open when the ring starts has lost its begin, one left open at the end its end
+    depth = {tid: 0 for tid in THREADS}
+    t, last = 0, None
+    for cycles, section, phase, context in events:
+        if last is not None:
+            t += ((cycles - last + (1 << 31)) & 0xFFFFFFFF) - (1 << 31)
+        last = cycles
+        ts = t * 1e6 / cpu_hz
+        if phase == TRIGGER:
+            bits = [name for bit, name in STATUS_BITS if section & bit] or ["dump"]
+            out.append({"name": "trigger " + "|".join(bits), "ph": "i", "s": "g", "pid": 0, "tid": context,
+                        "ts": ts, "args": {"status": section}})
+            continue
+        name = names[section] if section < len(names) else "section%d" % section
+        if phase == BEGIN:
+            depth[context] += 1
+        elif depth[context] == 0:
+            continue
+        else:
+            depth[context] -= 1
+        out.append({"name": name, "ph": "B" if phase == BEGIN else "E", "pid": 0, "tid": context, "ts": ts})
+    for tid, open_slices in depth.items():
+        out += [{"ph": "E", "pid": 0, "tid": tid, "ts": t * 1e6 / cpu_hz}] * open_slices
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("device", nargs="?", help="SerialUSB1 of the Teensy, e.g. /dev/ttyACM1")
+    parser.add_argument("-o", "--out", default="trace.json", help="Chrome trace JSON (default: %(default)s)")
+    parser.add_argument("--raw", help="also keep the dump as pulled in this file")
+    parser.add_argument("--from", dest="source", help="convert a kept dump instead of pulling one")
+    parser.add_argument("--arm", action="store_true", help="re-arm the ring instead of pulling it")
+    args = parser.parse_args(argv)
+    if bool(args.device) == bool(args.source):
+        parser.error("give a device or --from, not both")
+
+    if args.source:
+        with open(args.source, "rb") as f:
+            dump = f.read()
+    else:
+        import serial  # pyserial
+        with serial.Serial(args.device, timeout=2.0) as port:
+            port.reset_input_buffer()
+            if args.arm:
+                port.write(b"R")
+                print(read_line(port))
+                return 0
+            dump = pull(port)
+        if args.raw:
+            with open(args.raw, "wb") as f:
+                f.write(dump)
+
+    cpu_hz, names, events = parse(dump)
+    trace = chrome_trace(cpu_hz, names, events)
+    with open(args.out, "w") as f:
+        json.dump(trace, f)
+    span = (trace["traceEvents"][-1].get("ts", 0.0) / 1e3) if events else 0.0
+    print("%s: %d events over %.1f ms at %d MHz" % (args.out, len(events), span, cpu_hz // 1000000))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Upload an exportWeights.py .pbcw to the Teensy's on-board PBC over ROS, without a reflash.
+
+The firmware (built with WEIGHT_UPLOAD) takes the file as raspi_pkg/WeightChunk
+messages on /weight_upload, small enough for its 512-byte input buffer, and
+answers each with the "weight_upload" entry on /diagnostics. This sends one
+chunk, waits for the answer and goes on from what the Teensy says it has, so
+a lost chunk or answer is a resend. The weights are swapped in between two
+control steps once the whole file is there and checked. Usage, on the Pi with
+teensy_bridge (or serial_node.py) running:
+
+    ./upload_weights.py ../lib/NeuralPBC/weights/deterministic_hardware.pbcw
+    ./upload_weights.py --prefix /wheel2 new.pbcw     # a second wheel's Teensy
+
+The widths must be the build's network's (PbcNetwork in main.cpp): a file of
+another shape is refused after the last chunk with the weights left as they were.
+"""
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+WEIGHT_FILE_HEADER = struct.Struct("<IHH8HIIII24s")  # weightFile.h's Header
+WEIGHT_FILE_MAGIC = 0x31574250  # "PBW1"
+
+
+def describe(blob):
+    magic, _, num_widths, *rest = WEIGHT_FILE_HEADER.unpack_from(blob)
+    if magic != WEIGHT_FILE_MAGIC:
+        raise ValueError("not a weight file")
+    widths, num_params, num_samples = rest[:num_widths], rest[8], rest[9]
+    name = rest[12].rstrip(b"\0").decode()
+    if num_samples:
+        raise ValueError("%s is a posterior of %d samples, the Teensy swaps one network" % (name, num_samples))
+    return "%s, %s, %d parameters" % (name, "-".join(map(str, widths)), num_params)
+
+
+class Uploader:
+    def __init__(self, prefix, timeout):
+        import rospy
+        from diagnostic_msgs.msg import DiagnosticArray
+        from raspi_pkg.msg import WeightChunk
+        self.rospy, self.WeightChunk = rospy, WeightChunk
+        self.timeout = timeout
+        self.answer = None
+        self.pub = rospy.Publisher(prefix + "/weight_upload", WeightChunk, queue_size=1)
+        rospy.Subscriber(prefix + "/diagnostics", DiagnosticArray, self.diagnostics)
+
+    def diagnostics(self, msg):
+        for status in msg.status:
+            if status.name == "weight_upload":
+                self.answer = (status.level, status.message, {kv.key: kv.value for kv in status.values})
+
+    def send(self, upload, offset, size, data):
+        """the Teensy's answer to one chunk, None if none came"""
+        self.answer = None
+        self.pub.publish(self.WeightChunk(upload=upload, offset=offset, size=size,
+                                          crc=zlib.crc32(data) & 0xFFFFFFFF, data=data))
+        deadline = time.monotonic() + self.timeout
+        while self.answer is None and time.monotonic() < deadline and not self.rospy.is_shutdown():
+            time.sleep(0.005)
+        return self.answer
+
+    def upload(self, blob, retries):
+        upload = int(time.time() * 1000) & 0xFFFFFFFF or 1
+        chunk = self.WeightChunk.MAX_DATA
+        offset, failures, swaps = 0, 0, None
+        while True:
+            answer = self.send(upload, offset, len(blob), blob[offset:offset + chunk])
+            # a chunk damaged on the way is sent again, like one that got no answer
+            damaged = answer is not None and answer[1] == "chunk crc mismatch"
+            if answer is not None and answer[0] != 0 and not damaged:
+                raise IOError("refused at offset %d: %s" % (offset, answer[1]))
+            if answer is None or damaged or answer[2].get("upload") != str(upload):
+                failures += 1
+                if failures > retries:
+                    raise IOError("no answer at offset %d, is the build WEIGHT_UPLOAD?" % offset)
+                continue
+            level, message, values = answer
+            if swaps is None:
+                swaps = int(values["swaps"]) - (1 if message == "complete" else 0)
+            failures = 0
+            offset = int(values["received"])
+            if int(values["size"]) != len(blob):
+                raise IOError("the build's network is a %s-byte file" % values["size"])
+            if int(values["swaps"]) > swaps:
+                return values["network"]
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("file", help="a one-network .pbcw from exportWeights.py")
+    parser.add_argument("--prefix", default="", help="the firmware's ROS_TOPIC_PREFIX, e.g. /wheel2")
+    parser.add_argument("--timeout", type=float, default=0.5, help="s to wait for each answer (default: %(default)s)")
+    parser.add_argument("--retries", type=int, default=10, help="resends of one chunk before giving up")
+    args = parser.parse_args(argv)
+
+    with open(args.file, "rb") as f:
+        blob = f.read()
+    print("%s: %s" % (args.file, describe(blob)))
+
+    import rospy
+    rospy.init_node("upload_weights", anonymous=True, disable_signals=True)
+    uploader = Uploader(args.prefix, args.timeout)
+    time.sleep(1.0)  # for the publisher and subscriber to connect
+    start = time.monotonic()
+    network = uploader.upload(blob, args.retries)
+    print("%s running after %.2f s" % (network, time.monotonic() - start))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
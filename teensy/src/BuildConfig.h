@@ -0,0 +1,206 @@
+// Build profiles: the motor transport, command mode, controller site, attitude
+// estimator and flight-log backend the firmware is built with, chosen per
+// PlatformIO env with -D BUILD_PROFILE=BUILD_PROFILE_<name> (platformio.ini)
+// instead of by editing main.cpp. Without one the build is BUILD_PROFILE_LAB,
+// main.cpp's configuration before the profiles: the Pi's torques, so a plain
+// build still answers /torso_command. The on-board PBC is opt-in, in
+// BUILD_PROFILE_ONBOARD or BUILD_PROFILE_FIELD.
+//
+// A profile is one block of the feature macros main.cpp tests. They stay
+// macros because they pick declarations and libraries (a CAN driver, the PBC
+// weights, an SD card); BuildConfig is the typed view of the same choices,
+// for function bodies to branch on with if constexpr so the other side is
+// not compiled in, and for the static_asserts on combinations. Features
+// outside the profiles (MODEL_EKF, FLIGHT_RECORDER on a profile without it, ...)
+// are still a #define in main.cpp or a -D in the env's build_flags.
+//
+// The one control step in main.cpp is the whole pipeline: sources (IMU_MODE,
+// the MotorDriver's encoder feedback), estimators (ATTITUDE_ESTIMATOR,
+// MODEL_EKF, the spoke velocity estimators), the controller (ONBOARD_PBC,
+// /torso_command or SUPERVISED_CONTROL's stabilizer around it, the command mode) and sinks (the MotorDriver, /sensors,
+// FLIGHT_LOG_SINK), each a lib/ stage the profile picks. The bring-up
+// sketches that used to fork it are profiles too: setup/imuOnly.cpp is
+// BUILD_PROFILE_SENSORS, setup/imuOdriveWorking.cpp BUILD_PROFILE_TELEOP and
+// setup/motorEncoderImuWithImpactMap.cpp BUILD_PROFILE_IMPACT_MAP.
+
+#include <stdint.h>
+
+#define BUILD_PROFILE_LAB        1 // tethered: torques from the Pi on /torso_command, debug text on the USB serial
+#define BUILD_PROFILE_OFFBOARD   2 // deployed: torques from the Pi's or Julia's controller on /torso_command, no debug text
+#define BUILD_PROFILE_FIELD      3 // untethered runs: the on-board PBC, SD flight log, no debug text
+#define BUILD_PROFILE_TELEOP     4 // joystick velocities as raspi_pkg/Teleop, velocity control
+#define BUILD_PROFILE_TRAJECTORY 5 // uploaded hip trajectories, position control
+#define BUILD_PROFILE_SENSORS    6 // IMU and ROS only, no ODrive on the UART
+#define BUILD_PROFILE_IMPACT_MAP 7 // off-board torques, the rimless-wheel EKF with its impact map and sensed touchdowns
+#define BUILD_PROFILE_SUPERVISED 8 // the torso stabilizer on board at 1 kHz, its setpoints and gains from the Pi on /torso_command
+#define BUILD_PROFILE_ONBOARD    9 // tethered: the on-board PBC, /torso_command ignored, debug text on the USB serial
+
+#ifndef BUILD_PROFILE
+  #define BUILD_PROFILE BUILD_PROFILE_LAB
+#endif
+
+#define MOTOR_DRIVER_ASCII  1 // ASCII lines over Serial1, encoder queries pipelined around the IMU read
+#define MOTOR_DRIVER_BINARY 2 // native frames over Serial1
+#define MOTOR_DRIVER_I2C    3 // odrive.h endpoints over Wire1 at 1 MHz
+#define MOTOR_DRIVER_CAN    4 // CANSimple on CAN1, encoder estimates broadcast by the ODrive
+#define ATTITUDE_MAHONY      1 // full quaternion MahonyFilter on gyro, accel and mag
+#define ATTITUDE_ROLL_KALMAN 2 // RollEstimator: Kalman filter on roll and gyro bias, yaw from gyro and mag heading
+#define FLIGHT_LOG_SD       1 // SdFlightLog: a pre-allocated FLIGHTnn.BIN per run on an SD card
+#define FLIGHT_LOG_SPIFLASH 2 // SpiFlashLog: circular raw log on a SPI NOR flash, erased ahead; runs dumped over SerialUSB1
+
+#if BUILD_PROFILE == BUILD_PROFILE_LAB
+  #define BUILD_PROFILE_NAME "lab"
+  #define ODRIVE_CONNECTED
+  #define TORQUE_CONTROL
+#elif BUILD_PROFILE == BUILD_PROFILE_OFFBOARD
+  #define BUILD_PROFILE_NAME "offboard"
+  #define ODRIVE_CONNECTED
+  #define TORQUE_CONTROL
+  #define BUILD_QUIET // no debug text: it would share the USB serial with rosserial
+#elif BUILD_PROFILE == BUILD_PROFILE_FIELD
+  #define BUILD_PROFILE_NAME "field"
+  #define ODRIVE_CONNECTED
+  #define TORQUE_CONTROL
+  #define ONBOARD_PBC
+  #define FLIGHT_RECORDER // one FlightRecord per tick to FLIGHT_LOG_SINK, see main.cpp
+  #define FLIGHT_LOG_SINK FLIGHT_LOG_SD
+  #define BUILD_QUIET // no debug text, nobody reads the USB serial
+#elif BUILD_PROFILE == BUILD_PROFILE_TELEOP
+  #define BUILD_PROFILE_NAME "teleop"
+  #define ODRIVE_CONNECTED
+  #define TELEOP_MSG // joystick velocities also as the 8-byte raspi_pkg/Teleop on /teleop (joystick relay ~teleop)
+  #define TELEOP_SHAPING // deadband, expo and rate limit on the firmware (TeleopShaper), see main.cpp
+#elif BUILD_PROFILE == BUILD_PROFILE_TRAJECTORY
+  #define BUILD_PROFILE_NAME "trajectory"
+  #define ODRIVE_CONNECTED
+  #define POSITION_CONTROL // /torso_command position[] as hip targets in turns and velocity[] as their feed-forward
+  #define TRAJECTORY_PLAYBACK // raspi_pkg/Trajectory uploads on /trajectory played back from a ring at the control rate
+#elif BUILD_PROFILE == BUILD_PROFILE_SENSORS
+  #define BUILD_PROFILE_NAME "sensors"
+  #define TORQUE_CONTROL
+#elif BUILD_PROFILE == BUILD_PROFILE_IMPACT_MAP
+  #define BUILD_PROFILE_NAME "impact_map"
+  #define ODRIVE_CONNECTED
+  #define TORQUE_CONTROL
+  #define MODEL_EKF // the torso's angular acceleration for the COM shift from the model, see main.cpp
+  #define IMPACT_DETECTOR
+#elif BUILD_PROFILE == BUILD_PROFILE_SUPERVISED
+  #define BUILD_PROFILE_NAME "supervised"
+  #define ODRIVE_CONNECTED
+  #define TORQUE_CONTROL
+  #define SUPERVISED_CONTROL // TorsoStabilizer every step around /torso_command's setpoint, see main.cpp
+  #define MOTOR_DRIVER MOTOR_DRIVER_CAN // encoder estimates broadcast every 1 ms; an ASCII exchange does not fit a 1 ms step
+  #define FILTER_UPDATE_RATE_HZ 1000
+#elif BUILD_PROFILE == BUILD_PROFILE_ONBOARD
+  #define BUILD_PROFILE_NAME "onboard"
+  #define ODRIVE_CONNECTED
+  #define TORQUE_CONTROL
+  #define ONBOARD_PBC // evaluate the neural PBC in controlStep() instead of waiting for /torso_command
+#else
+  #error "unknown BUILD_PROFILE, see src/BuildConfig.h"
+#endif
+
+// The choices every profile shares unless it says otherwise
+#ifndef MOTOR_DRIVER
+  #define MOTOR_DRIVER MOTOR_DRIVER_ASCII // transport for the loop's encoder reads and torque writes
+#endif
+#ifndef ATTITUDE_ESTIMATOR
+  #define ATTITUDE_ESTIMATOR ATTITUDE_MAHONY
+#endif
+#ifndef FLIGHT_LOG_SINK
+  #define FLIGHT_LOG_SINK FLIGHT_LOG_SD
+#endif
+#ifndef FILTER_UPDATE_RATE_HZ
+  #define FILTER_UPDATE_RATE_HZ 100
+#endif
+#if !defined(ROS_FAST_LINK) && !defined(BUILD_QUIET) // debug text shares the USB serial with rosserial
+  #define AHRS_DEBUG_OUTPUT
+#endif
+
+enum class Transport : uint8_t {
+  Ascii = MOTOR_DRIVER_ASCII, Binary = MOTOR_DRIVER_BINARY, I2C = MOTOR_DRIVER_I2C, Can = MOTOR_DRIVER_CAN
+};
+enum class CommandMode : uint8_t { Torque, Velocity, Position };
+enum class ControllerSite : uint8_t { OffBoard, OnBoard, Supervised };
+enum class Attitude : uint8_t { Mahony = ATTITUDE_MAHONY, RollKalman = ATTITUDE_ROLL_KALMAN };
+enum class LogBackend : uint8_t { None, Sd = FLIGHT_LOG_SD, SpiFlash = FLIGHT_LOG_SPIFLASH };
+
+template<Transport T, CommandMode C, ControllerSite S, Attitude A, LogBackend L,
+         bool Odrive, bool Teleop, bool Trajectory, bool Debug, uint32_t RateHz>
+struct BuildProfile {
+  static constexpr Transport transport = T;
+  static constexpr CommandMode commandMode = C;
+  static constexpr ControllerSite controllerSite = S;
+  static constexpr Attitude attitude = A;
+  static constexpr LogBackend logBackend = L;
+  static constexpr bool odriveConnected = Odrive;
+  static constexpr bool teleopMsg = Teleop;
+  static constexpr bool trajectoryPlayback = Trajectory;
+  static constexpr bool debugOutput = Debug;
+  static constexpr uint32_t controlRateHz = RateHz;
+  static constexpr uint32_t controlPeriod_us = 1000000/RateHz;
+  static constexpr float samplingTime = 1.0f/RateHz;
+
+  static constexpr bool torqueControl = C == CommandMode::Torque;
+  static constexpr bool onboardPbc = S == ControllerSite::OnBoard;
+  static constexpr bool supervised = S == ControllerSite::Supervised;
+  static constexpr bool flightRecorder = L != LogBackend::None;
+
+  static_assert(!onboardPbc || torqueControl, "the on-board PBC outputs a torque, use CommandMode::Torque");
+  static_assert(!supervised || torqueControl, "the torso stabilizer outputs a torque, use CommandMode::Torque");
+  static_assert(!Teleop || C == CommandMode::Velocity, "TELEOP_MSG carries joystick velocities, undefine TORQUE_CONTROL");
+  static_assert(!Trajectory || C == CommandMode::Position, "TRAJECTORY_PLAYBACK plays back position setpoints, define POSITION_CONTROL");
+  static_assert(1000000 % RateHz == 0, "the control period is a whole number of microseconds");
+};
+
+typedef BuildProfile<
+  (Transport)MOTOR_DRIVER,
+#if defined(TORQUE_CONTROL) && defined(POSITION_CONTROL)
+  #error "POSITION_CONTROL takes /torso_command positions, undefine TORQUE_CONTROL"
+#elif defined(TORQUE_CONTROL)
+  CommandMode::Torque,
+#elif defined(POSITION_CONTROL)
+  CommandMode::Position,
+#else
+  CommandMode::Velocity,
+#endif
+#if defined(ONBOARD_PBC) && defined(SUPERVISED_CONTROL)
+  #error "SUPERVISED_CONTROL takes its setpoints from the Pi, undefine ONBOARD_PBC"
+#elif defined(ONBOARD_PBC)
+  ControllerSite::OnBoard,
+#elif defined(SUPERVISED_CONTROL)
+  ControllerSite::Supervised,
+#else
+  ControllerSite::OffBoard,
+#endif
+  (Attitude)ATTITUDE_ESTIMATOR,
+#if defined(FLIGHT_RECORDER)
+  (LogBackend)FLIGHT_LOG_SINK,
+#else
+  LogBackend::None,
+#endif
+#if defined(ODRIVE_CONNECTED)
+  true,
+#else
+  false,
+#endif
+#if defined(TELEOP_MSG)
+  true,
+#else
+  false,
+#endif
+#if defined(TRAJECTORY_PLAYBACK)
+  true,
+#else
+  false,
+#endif
+#if defined(AHRS_DEBUG_OUTPUT)
+  true,
+#else
+  false,
+#endif
+  FILTER_UPDATE_RATE_HZ> BuildConfig;
+
+static_assert(sizeof(BuildConfig) > 0, "instantiated here, so its checks run in every build");
+
+constexpr const char* buildProfileName = BUILD_PROFILE_NAME;
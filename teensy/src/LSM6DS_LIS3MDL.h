@@ -5,7 +5,10 @@ Adafruit_LIS3MDL lis3mdl;
 #include <Adafruit_LSM6DSOX.h>
 Adafruit_LSM6DSOX lsm6ds;
 
-bool init_sensors(void) {
+#include <Lsm6dsFifo.h>
+#include <ImuTransform.h>
+
+COLD_CODE bool init_sensors(void) {
   if (!lsm6ds.begin_I2C()){  
     Serial.print("Accelerometer and gyro not connecting");
     if (!lis3mdl.begin_I2C()) {
@@ -21,16 +24,451 @@ bool init_sensors(void) {
   return true;
 }
 
-void setup_sensors(void) {
-  // set lowest range
-  lsm6ds.setAccelRange(LSM6DS_ACCEL_RANGE_2_G);
-  lsm6ds.setGyroRange(LSM6DS_GYRO_RANGE_250_DPS);
-  lis3mdl.setRange(LIS3MDL_RANGE_4_GAUSS);
+// The full-scale ranges and output data rates of the three sensors. setup_sensors() writes
+// them and the register transform takes its LSB scales from them, so the two cannot
+// disagree; the defaults are the lowest ranges at slightly above the refresh rate. With a
+// fast LIS3MDL rate (155 Hz and up) the performance mode decides the rate, see lis3mdl_rate_hz().
+struct ImuSettings {
+  lsm6ds_accel_range_t accel_range = LSM6DS_ACCEL_RANGE_2_G;
+  lsm6ds_gyro_range_t gyro_range = LSM6DS_GYRO_RANGE_250_DPS;
+  lsm6ds_data_rate_t rate = LSM6DS_RATE_104_HZ; // gyro and accel
+  lis3mdl_range_t mag_range = LIS3MDL_RANGE_4_GAUSS;
+  lis3mdl_dataRate_t mag_rate = LIS3MDL_DATARATE_1000_HZ;
+  lis3mdl_performancemode_t mag_mode = LIS3MDL_MEDIUMMODE;
+};
+
+ImuSettings imuSettings;
+
+// Writes the gyro and accel half of settings to one LSM6DSOX and reads it back
+COLD_CODE bool setup_lsm6ds(Adafruit_LSM6DSOX &imu, const ImuSettings &settings) {
+  imu.setAccelRange(settings.accel_range);
+  imu.setGyroRange(settings.gyro_range);
+  imu.setAccelDataRate(settings.rate);
+  imu.setGyroDataRate(settings.rate);
+  return imu.getAccelRange() == settings.accel_range && imu.getGyroRange() == settings.gyro_range
+      && imu.getAccelDataRate() == settings.rate && imu.getGyroDataRate() == settings.rate;
+}
 
-  // set slightly above refresh rate
-  lsm6ds.setAccelDataRate(LSM6DS_RATE_104_HZ);
-  lsm6ds.setGyroDataRate(LSM6DS_RATE_104_HZ);
-  lis3mdl.setDataRate(LIS3MDL_DATARATE_1000_HZ);
-  lis3mdl.setPerformanceMode(LIS3MDL_MEDIUMMODE);
+// Writes settings and reads them back; false if a sensor did not take them
+COLD_CODE bool setup_sensors(const ImuSettings &settings) {
+  bool imu_ok = setup_lsm6ds(lsm6ds, settings);
+
+  lis3mdl.setRange(settings.mag_range);
+  lis3mdl.setDataRate(settings.mag_rate);
+  lis3mdl.setPerformanceMode(settings.mag_mode);
   lis3mdl.setOperationMode(LIS3MDL_CONTINUOUSMODE);
+
+  return imu_ok && lis3mdl.getRange() == settings.mag_range && lis3mdl.getDataRate() == settings.mag_rate
+      && lis3mdl.getPerformanceMode() == settings.mag_mode;
+}
+
+// Data-ready sampling of the LSM6DSOX: INT1 pulses when a gyro sample is ready and the
+// interrupt burst-reads gyro+accel (OUTX_L_G..OUTZ_H_A, 12 bytes) into a double buffer,
+// stamped with micros() at the edge. The pin interrupt runs at the control timer's NVIC
+// priority, so it never preempts a Wire transaction of the control step (and vice versa).
+#define LSM6DSOX_COUNTER_BDR_REG1 0x0B
+#define LSM6DSOX_INT1_CTRL 0x0D
+#define LSM6DSOX_OUTX_L_G 0x22
+#define LSM6DSOX_OUTX_L_A 0x28
+#define LSM6DSOX_DATAREADY_PULSED 0x80
+#define LSM6DSOX_INT1_DRDY_G 0x02
+
+struct ImuRawSample {
+  uint32_t seq;
+  uint32_t stamp_us;
+  int16_t gyro[3];
+  int16_t accel[3];
+};
+
+volatile ImuRawSample imuSamples[2];
+volatile uint8_t imuFront = 0;
+volatile uint32_t imuReadErrors = 0;
+
+HOT_CODE bool lsm6ds_read(uint8_t reg, uint8_t *buffer, uint8_t length) {
+  Wire.beginTransmission(LSM6DS_I2CADDR_DEFAULT);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom((uint8_t)LSM6DS_I2CADDR_DEFAULT, length) != length) return false;
+  for (uint8_t i = 0; i < length; i++) buffer[i] = Wire.read();
+  return true;
+}
+
+bool lsm6ds_write(uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(LSM6DS_I2CADDR_DEFAULT);
+  Wire.write(reg);
+  Wire.write(value);
+  return Wire.endTransmission() == 0;
+}
+
+HOT_CODE void imu_data_ready_isr() {
+  uint32_t stamp = micros();
+  uint8_t raw[12];
+  if (!lsm6ds_read(LSM6DSOX_OUTX_L_G, raw, sizeof(raw))) {
+    imuReadErrors = imuReadErrors + 1;
+    return;
+  }
+  uint8_t back = imuFront ^ 1;
+  volatile ImuRawSample &sample = imuSamples[back];
+  for (int i = 0; i < 3; i++) {
+    sample.gyro[i] = (int16_t)(raw[2*i] | (raw[2*i + 1] << 8));
+    sample.accel[i] = (int16_t)(raw[6 + 2*i] | (raw[6 + 2*i + 1] << 8));
+  }
+  sample.stamp_us = stamp;
+  sample.seq = imuSamples[imuFront].seq + 1;
+  imuFront = back;
+}
+
+// Route the gyro data-ready to INT1 as 75 us pulses, so a missed read cannot latch the line
+COLD_CODE bool init_data_ready(uint8_t pin) {
+  if (!lsm6ds_write(LSM6DSOX_COUNTER_BDR_REG1, LSM6DSOX_DATAREADY_PULSED) ||
+      !lsm6ds_write(LSM6DSOX_INT1_CTRL, LSM6DSOX_INT1_DRDY_G)) {
+    return false;
+  }
+  pinMode(pin, INPUT);
+  attachInterrupt(digitalPinToInterrupt(pin), imu_data_ready_isr, RISING);
+  NVIC_SET_PRIORITY(IRQ_GPIO6789, 192);
+  return true;
+}
+
+// Latest sample; false until the first data-ready edge
+HOT_CODE bool imu_latest(ImuRawSample &sample) {
+  noInterrupts();
+  const volatile ImuRawSample &front = imuSamples[imuFront];
+  sample.seq = front.seq;
+  sample.stamp_us = front.stamp_us;
+  for (int i = 0; i < 3; i++) {
+    sample.gyro[i] = front.gyro[i];
+    sample.accel[i] = front.accel[i];
+  }
+  interrupts();
+  return sample.seq != 0;
+}
+
+// FIFO batching of the LSM6DSOX: gyro and accel are batched at a high rate, optionally
+// with the sensor's 25 us timestamp, and drained once per control tick by imuFifo
+// (Lsm6dsFifo.h, with the FIFO's registers).
+Lsm6dsFifo imuFifo;
+
+float lsm6ds_rate_hz(lsm6ds_data_rate_t rate) {
+  switch (rate) {
+    case LSM6DS_RATE_12_5_HZ: return 12.5f;
+    case LSM6DS_RATE_26_HZ: return 26.0f;
+    case LSM6DS_RATE_52_HZ: return 52.0f;
+    case LSM6DS_RATE_104_HZ: return 104.0f;
+    case LSM6DS_RATE_208_HZ: return 208.0f;
+    case LSM6DS_RATE_416_HZ: return 416.0f;
+    case LSM6DS_RATE_833_HZ: return 833.0f;
+    case LSM6DS_RATE_1_66K_HZ: return 1660.0f;
+    case LSM6DS_RATE_3_33K_HZ: return 3330.0f;
+    case LSM6DS_RATE_6_66K_HZ: return 6660.0f;
+    default: return 0.0f;
+  }
+}
+
+// The settings in physical units, as raspi_pkg/ImuConfig carries them, with the LSB scale of
+// each range from the datasheets (LSM6DSOX table 2, LIS3MDL table 2)
+template <class Code>
+struct ImuRangeEntry {
+  uint16_t full_scale; // g, dps or gauss
+  Code code;
+  float per_lsb;       // g, dps or gauss
+};
+
+static const ImuRangeEntry<lsm6ds_accel_range_t> lsm6dsAccelRanges[] = {
+  {2, LSM6DS_ACCEL_RANGE_2_G, 0.061e-3f}, {4, LSM6DS_ACCEL_RANGE_4_G, 0.122e-3f},
+  {8, LSM6DS_ACCEL_RANGE_8_G, 0.244e-3f}, {16, LSM6DS_ACCEL_RANGE_16_G, 0.488e-3f}};
+static const ImuRangeEntry<lsm6ds_gyro_range_t> lsm6dsGyroRanges[] = {
+  {125, LSM6DS_GYRO_RANGE_125_DPS, 4.375e-3f}, {250, LSM6DS_GYRO_RANGE_250_DPS, 8.75e-3f},
+  {500, LSM6DS_GYRO_RANGE_500_DPS, 17.5e-3f}, {1000, LSM6DS_GYRO_RANGE_1000_DPS, 35.0e-3f},
+  {2000, LSM6DS_GYRO_RANGE_2000_DPS, 70.0e-3f}};
+static const ImuRangeEntry<lis3mdl_range_t> lis3mdlRanges[] = {
+  {4, LIS3MDL_RANGE_4_GAUSS, 1.0f/6842.0f}, {8, LIS3MDL_RANGE_8_GAUSS, 1.0f/3421.0f},
+  {12, LIS3MDL_RANGE_12_GAUSS, 1.0f/2281.0f}, {16, LIS3MDL_RANGE_16_GAUSS, 1.0f/1711.0f}};
+
+// The entry of a code, or of a full scale; nullptr if there is none
+template <class Code, size_t N>
+const ImuRangeEntry<Code> *imu_range(const ImuRangeEntry<Code> (&table)[N], Code code) {
+  for (const ImuRangeEntry<Code> &entry : table)
+    if (entry.code == code) return &entry;
+  return nullptr;
+}
+
+template <class Code, size_t N>
+const ImuRangeEntry<Code> *imu_range(const ImuRangeEntry<Code> (&table)[N], uint16_t full_scale) {
+  for (const ImuRangeEntry<Code> &entry : table)
+    if (entry.full_scale == full_scale) return &entry;
+  return nullptr;
+}
+
+// The LIS3MDL's rates; from 155 Hz up (FAST_ODR) the performance mode sets the rate, and
+// these are the modes that give it
+struct Lis3mdlRateEntry {
+  float hz;
+  lis3mdl_dataRate_t rate;
+  lis3mdl_performancemode_t mode;
+};
+
+static const Lis3mdlRateEntry lis3mdlRates[] = {
+  {0.625f, LIS3MDL_DATARATE_0_625_HZ, LIS3MDL_ULTRAHIGHMODE}, {1.25f, LIS3MDL_DATARATE_1_25_HZ, LIS3MDL_ULTRAHIGHMODE},
+  {2.5f, LIS3MDL_DATARATE_2_5_HZ, LIS3MDL_ULTRAHIGHMODE}, {5.0f, LIS3MDL_DATARATE_5_HZ, LIS3MDL_ULTRAHIGHMODE},
+  {10.0f, LIS3MDL_DATARATE_10_HZ, LIS3MDL_ULTRAHIGHMODE}, {20.0f, LIS3MDL_DATARATE_20_HZ, LIS3MDL_ULTRAHIGHMODE},
+  {40.0f, LIS3MDL_DATARATE_40_HZ, LIS3MDL_ULTRAHIGHMODE}, {80.0f, LIS3MDL_DATARATE_80_HZ, LIS3MDL_ULTRAHIGHMODE},
+  {155.0f, LIS3MDL_DATARATE_155_HZ, LIS3MDL_ULTRAHIGHMODE}, {300.0f, LIS3MDL_DATARATE_300_HZ, LIS3MDL_HIGHMODE},
+  {560.0f, LIS3MDL_DATARATE_560_HZ, LIS3MDL_MEDIUMMODE}, {1000.0f, LIS3MDL_DATARATE_1000_HZ, LIS3MDL_LOWPOWERMODE}};
+
+// The rate the magnetometer runs at in this mode
+float lis3mdl_rate_hz(lis3mdl_dataRate_t rate, lis3mdl_performancemode_t mode) {
+  if (rate & 0x01) { // FAST_ODR
+    for (const Lis3mdlRateEntry &entry : lis3mdlRates)
+      if ((entry.rate & 0x01) && entry.mode == mode) return entry.hz;
+    return 0.0f;
+  }
+  for (const Lis3mdlRateEntry &entry : lis3mdlRates)
+    if (entry.rate == rate) return entry.hz;
+  return 0.0f;
+}
+
+// Settings from ranges in g, dps and gauss and rates in Hz, a 0 keeping what base has. A
+// range must be one of the sensor's; a rate becomes the slowest at or above it, so the
+// samples are never older than asked for. False, with settings untouched, on anything else.
+bool imu_settings_from_units(const ImuSettings &base, uint16_t accel_range_g, uint16_t gyro_range_dps, float rate_hz,
+                             uint16_t mag_range_gauss, float mag_rate_hz, ImuSettings &settings) {
+  ImuSettings s = base;
+  if (accel_range_g != 0) {
+    const ImuRangeEntry<lsm6ds_accel_range_t> *entry = imu_range(lsm6dsAccelRanges, accel_range_g);
+    if (!entry) return false;
+    s.accel_range = entry->code;
+  }
+  if (gyro_range_dps != 0) {
+    const ImuRangeEntry<lsm6ds_gyro_range_t> *entry = imu_range(lsm6dsGyroRanges, gyro_range_dps);
+    if (!entry) return false;
+    s.gyro_range = entry->code;
+  }
+  if (mag_range_gauss != 0) {
+    const ImuRangeEntry<lis3mdl_range_t> *entry = imu_range(lis3mdlRanges, mag_range_gauss);
+    if (!entry) return false;
+    s.mag_range = entry->code;
+  }
+  if (rate_hz > 0.0f) {
+    int code = LSM6DS_RATE_12_5_HZ;
+    while (code <= LSM6DS_RATE_6_66K_HZ && lsm6ds_rate_hz((lsm6ds_data_rate_t)code) < rate_hz) code++;
+    if (code > LSM6DS_RATE_6_66K_HZ) return false;
+    s.rate = (lsm6ds_data_rate_t)code;
+  }
+  if (mag_rate_hz > 0.0f) {
+    const Lis3mdlRateEntry *found = nullptr;
+    for (const Lis3mdlRateEntry &entry : lis3mdlRates) {
+      if (entry.hz >= mag_rate_hz) {
+        found = &entry;
+        break;
+      }
+    }
+    if (!found) return false;
+    s.mag_rate = found->rate;
+    s.mag_mode = found->mode;
+  }
+  settings = s;
+  return true;
+}
+
+// rate must be a LSM6DS data rate at least 12.5 Hz; the ODRs are raised to match
+COLD_CODE bool init_fifo(lsm6ds_data_rate_t rate, bool timestamps) {
+  lsm6ds.setAccelDataRate(rate);
+  lsm6ds.setGyroDataRate(rate);
+  // the batch data rate codes match the ODR codes from 12.5 Hz up
+  uint8_t bdr = (uint8_t)rate;
+  bool ok = lsm6ds_write(LSM6DSOX_FIFO_CTRL4, 0) // bypass mode empties the FIFO
+         && lsm6ds_write(LSM6DSOX_FIFO_CTRL3, (bdr << 4) | bdr);
+  if (timestamps) {
+    uint8_t ctrl10 = 0;
+    ok = ok && lsm6ds_read(LSM6DSOX_CTRL10_C, &ctrl10, 1)
+            && lsm6ds_write(LSM6DSOX_CTRL10_C, ctrl10 | LSM6DSOX_TIMESTAMP_EN);
+  }
+  return ok && lsm6ds_write(LSM6DSOX_FIFO_CTRL4, LSM6DSOX_FIFO_MODE_CONTINUOUS |
+                                                 (timestamps ? LSM6DSOX_DEC_TS_BATCH_1 : 0));
+}
+
+// Drain the FIFO into samples[], one per gyro word paired with the latest accel word.
+// Returns the number of samples, at most max_samples; the rest stays for the next call.
+HOT_CODE uint16_t drain_fifo(ImuFifoSample *samples, uint16_t max_samples) {
+  return imuFifo.drain(lsm6ds_read, samples, max_samples);
+}
+
+// Raw-register path: the calibration of Adafruit_Sensor_Calibration and the LSB scale
+// of the configured ranges are folded into one affine map per sensor, out = m*raw - b,
+// applied straight to the int16 registers. Gyro comes out in rad/s and accel in m/s^2
+// (Mahony normalizes it), mag in calibrated uT, with no sensors_event_t in between.
+// The scales are those of the ranges in imuSettings.
+#define LIS3MDL_OUT_X_L 0x28
+#define LIS3MDL_AUTO_INCREMENT 0x80
+
+// The transform itself and its application are ImuTransform.h's, shared with the host tools
+ImuTransform imuTransform;
+
+// gyro_scale, accel_scale and mag_scale take a sample to rad/s, m/s^2 and uT; 1 for the
+// getEvent() SI values. Must be rebuilt whenever cal is reloaded.
+void imu_build_transform(const Adafruit_Sensor_Calibration &cal, ImuTransform &t, float gyro_scale,
+                         float accel_scale, float mag_scale) {
+  // gyro: raw*lsb - zerorate
+  imu_diagonal(t.gyro, gyro_scale, cal.gyro_zerorate);
+  // accel: raw*lsb - zerog
+  imu_diagonal(t.accel, accel_scale, cal.accel_zerog);
+  // mag: softiron*(raw*lsb - hardiron)
+  for (int r = 0; r < 3; r++) {
+    t.mag.b[r] = 0.0f;
+    for (int c = 0; c < 3; c++) {
+      t.mag.m[3*r + c] = cal.mag_softiron[3*r + c] * mag_scale;
+      t.mag.b[r] += cal.mag_softiron[3*r + c] * cal.mag_hardiron[c];
+    }
+  }
+}
+
+// For the register reads, in the ranges of settings; rebuilt whenever those change
+void imu_build_transform(const Adafruit_Sensor_Calibration &cal, ImuTransform &t, const ImuSettings &settings) {
+  imu_build_transform(cal, t, imu_range(lsm6dsGyroRanges, settings.gyro_range)->per_lsb * SENSORS_DPS_TO_RADS,
+                      imu_range(lsm6dsAccelRanges, settings.accel_range)->per_lsb * SENSORS_GRAVITY_STANDARD,
+                      imu_range(lis3mdlRanges, settings.mag_range)->per_lsb * 100.0f);
+}
+
+// An LSM6DSOX without a calibration file of its own (the wheel hub's): the LSB scales of
+// settings alone, its zero rate left to a GyroBiasEstimator
+void imu_build_transform(ImuTransform &t, const ImuSettings &settings) {
+  imu_scale_transform(t, imu_range(lsm6dsGyroRanges, settings.gyro_range)->per_lsb * SENSORS_DPS_TO_RADS,
+                      imu_range(lsm6dsAccelRanges, settings.accel_range)->per_lsb * SENSORS_GRAVITY_STANDARD,
+                      imu_range(lis3mdlRanges, settings.mag_range)->per_lsb * 100.0f);
+}
+
+// Gyro and accel in one 12-byte burst from OUTX_L_G
+bool imu_read_raw(int16_t gyro[3], int16_t accel[3]) {
+  uint8_t raw[12];
+  if (!lsm6ds_read(LSM6DSOX_OUTX_L_G, raw, sizeof(raw))) return false;
+  for (int i = 0; i < 3; i++) {
+    gyro[i] = (int16_t)(raw[2*i] | (raw[2*i + 1] << 8));
+    accel[i] = (int16_t)(raw[6 + 2*i] | (raw[6 + 2*i + 1] << 8));
+  }
+  return true;
+}
+
+bool imu_read_fast(Vec3 &gyro_rads, Vec3 &accel) {
+  int16_t g[3], a[3];
+  if (!imu_read_raw(g, a)) return false;
+  gyro_rads = imu_apply(imuTransform.gyro, g);
+  accel = imu_apply(imuTransform.accel, a);
+  return true;
+}
+
+// Gyro or accel alone, 6 bytes, for the multi-rate step
+bool imu_read_axes(uint8_t reg, const ImuDiagonal &t, Vec3 &out) {
+  uint8_t raw[6];
+  if (!lsm6ds_read(reg, raw, sizeof(raw))) return false;
+  int16_t v[3];
+  for (int i = 0; i < 3; i++) v[i] = (int16_t)(raw[2*i] | (raw[2*i + 1] << 8));
+  out = imu_apply(t, v);
+  return true;
+}
+
+bool gyro_read_fast(Vec3 &gyro_rads) { return imu_read_axes(LSM6DSOX_OUTX_L_G, imuTransform.gyro, gyro_rads); }
+bool accel_read_fast(Vec3 &accel) { return imu_read_axes(LSM6DSOX_OUTX_L_A, imuTransform.accel, accel); }
+
+// The same 12-byte burst without blocking, queued on an AsyncI2C port: start() submits it,
+// its completion callback unpacks the counts from the interrupt while the encoder exchange
+// runs, and join() applies the transform, waiting only if the burst is still on the wire.
+// Only the gyro half (6 bytes) when accel is not wanted. One per LSM6DSOX, the Driver of
+// ImuArray (lib/RobotCore); the torso's is torsoBurst on Wire's LPI2C1, where no Wire call
+// may come in between. With magQueued, mag_read_raw() goes through the same queue, behind
+// the burst and within the magnetometer's budget.
+class Lsm6dsBurst {
+public:
+  Lsm6dsBurst(AsyncI2C &bus, uint8_t address, uint8_t device, const ImuTransform &transform)
+      : bus_(bus), transform_(transform) {
+    segment_ = {&reg_, 1, raw_, sizeof(raw_)};
+    burst_.address = address;
+    burst_.segments = &segment_;
+    burst_.count = 1;
+    burst_.done = done;
+    burst_.context = this;
+    burst_.priority = AsyncI2C::URGENT;
+    burst_.device = device;
+  }
+
+  bool start(bool with_accel) {
+    if (burst_.pending()) return false;
+    length_ = with_accel ? 12 : 6;
+    segment_.rx_length = length_;
+    if (!bus_.submit(burst_)) {
+      length_ = 0;
+      return false;
+    }
+    return true;
+  }
+
+  // Bytes read: 12 with accel, 6 gyro only, 0 on failure
+  uint8_t join(Vec3 &gyro_rads, Vec3 &accel) {
+    if (length_ == 0 || !bus_.wait(burst_)) {
+      length_ = 0;
+      return 0;
+    }
+    gyro_rads = imu_apply(transform_.gyro, counts_);
+    if (length_ == 12)
+      accel = imu_apply(transform_.accel, counts_ + 3);
+    uint8_t length = length_;
+    length_ = 0;
+    return length;
+  }
+
+  AsyncI2C &bus() { return bus_; }
+
+private:
+  static void done(AsyncI2C::Transaction &transaction, bool ok) {
+    Lsm6dsBurst &self = *static_cast<Lsm6dsBurst *>(transaction.context);
+    if (!ok) return;
+    for (int i = 0; i < self.length_ / 2; i++)
+      self.counts_[i] = (int16_t)(self.raw_[2*i] | (self.raw_[2*i + 1] << 8));
+  }
+
+  AsyncI2C &bus_;
+  const ImuTransform &transform_;
+  uint8_t reg_ = LSM6DSOX_OUTX_L_G;
+  uint8_t raw_[12];
+  uint8_t length_ = 0;
+  int16_t counts_[6];
+  AsyncI2C::Segment segment_;
+  AsyncI2C::Transaction burst_;
+};
+
+static constexpr uint8_t imuBusDevice = 0; // AsyncI2C budgets and usage on Wire
+static constexpr uint8_t magBusDevice = 1;
+AsyncI2C imuAsync(IMXRT_LPI2C1, IRQ_LPI2C1);
+Lsm6dsBurst torsoBurst(imuAsync, LSM6DS_I2CADDR_DEFAULT, imuBusDevice, imuTransform);
+bool magQueued = false;
+
+bool mag_read_raw(int16_t mag[3]) {
+  uint8_t raw[6];
+  if (magQueued) {
+    // refused when the magnetometer's share of the tick is spent; wait() drops it on a timeout
+    uint8_t reg = LIS3MDL_OUT_X_L | LIS3MDL_AUTO_INCREMENT;
+    AsyncI2C::Segment segment = {&reg, 1, raw, sizeof(raw)};
+    AsyncI2C::Transaction read;
+    read.address = LIS3MDL_I2CADDR_DEFAULT;
+    read.segments = &segment;
+    read.count = 1;
+    read.priority = AsyncI2C::NORMAL;
+    read.device = magBusDevice;
+    if (!imuAsync.submit(read) || !imuAsync.wait(read)) return false;
+  } else {
+    Wire.beginTransmission(LIS3MDL_I2CADDR_DEFAULT);
+    Wire.write(LIS3MDL_OUT_X_L | LIS3MDL_AUTO_INCREMENT);
+    if (Wire.endTransmission(false) != 0) return false;
+    if (Wire.requestFrom((uint8_t)LIS3MDL_I2CADDR_DEFAULT, (uint8_t)sizeof(raw)) != sizeof(raw)) return false;
+    for (int i = 0; i < 6; i++) raw[i] = Wire.read();
+  }
+  for (int i = 0; i < 3; i++) mag[i] = (int16_t)(raw[2*i] | (raw[2*i + 1] << 8));
+  return true;
+}
+
+bool mag_read_fast(Vec3 &mag) {
+  int16_t m[3];
+  if (!mag_read_raw(m)) return false;
+  mag = imu_apply(imuTransform.mag, m);
+  return true;
 }
@@ -0,0 +1,105 @@
+// Rimless-wheel model for the HybridEKF (lib/HybridEKF), from alphaDynamics() and
+// impactMap() of the former setup/motorEncoderImuWithImpactMap.cpp and literature/sensorFusion.jpg.
+// The parameters come from RimlessWheelModel (lib/RobotModel).
+//
+// x = [theta, phi, thetadot, phidot]: theta is the stance spoke angle, kept in
+// [-alpha, alpha) by the impact jump, phi the torso angle (torsoStates[0]).
+// z = [spoke angle, torso angle, spoke rate, torso rate] as in spokeStates/torsoStates;
+// the spoke angle is compared modulo the spoke spacing 2*alpha. u is the hip torque.
+
+struct RimlessWheel {
+  static constexpr int num_states = 4;
+  static constexpr int num_measurements = 4;
+
+  // [thetadotdot, phidotdot] from M(q) qdd = B - C - G
+  static void accelerations(const float* x, float u, float* acc) {
+    const float theta = x[0], phi = x[1], thetadot = x[2], phidot = x[3];
+    const float s = sinf(theta - phi), c = cosf(theta - phi);
+    typedef RimlessWheelModel P;
+    const float BCG[2] = {-u + P::M12*s*phidot*phidot + P::G1*sinf(theta - P::incline),
+                          u - P::M12*s*thetadot*thetadot - P::G2*sinf(phi - P::incline)};
+    const float detM = P::det0 + P::det1*c*c;
+    acc[0] = 1.0f/detM*(-P::M22*BCG[0] - P::M12*c*BCG[1]);
+    acc[1] = 1.0f/detM*(-P::M12*c*BCG[0] - P::M11*BCG[1]);
+  }
+
+  // midpoint rule, the zero-order-held torque over the tick
+  static void step(const float* x, float u, float dt, float* next) {
+    float acc[2], mid[4];
+    accelerations(x, u, acc);
+    mid[0] = x[0] + 0.5f*dt*x[2];
+    mid[1] = x[1] + 0.5f*dt*x[3];
+    mid[2] = x[2] + 0.5f*dt*acc[0];
+    mid[3] = x[3] + 0.5f*dt*acc[1];
+    accelerations(mid, u, acc);
+    next[0] = x[0] + dt*mid[2];
+    next[1] = x[1] + dt*mid[3];
+    next[2] = x[2] + dt*acc[0];
+    next[3] = x[3] + dt*acc[1];
+  }
+
+  // the next spoke touches down when the stance spoke passes +-alpha moving outward
+  static bool guard(const float* x) { return (x[0] >= RimlessWheelModel::alpha && x[2] > 0.0f) || (x[0] < -RimlessWheelModel::alpha && x[2] < 0.0f); }
+
+  // impactMap(): the angle moves to the new stance spoke, the rates through the plastic impact.
+  // The direction of travel picks the new spoke, so a sensed impact that HybridEKF::jump()
+  // forces before the guard fires still rolls the wheel forward.
+  static void jump(const float* x, float* next) {
+    // the closed form rather than the table: the EKF differentiates through it
+    const float phi = x[1], thetadot = x[2], phidot = x[3];
+    const ImpactMap<RimlessWheelModel>::Velocities post = ImpactMap<RimlessWheelModel>::apply(phi, thetadot, phidot);
+    next[0] = thetadot > 0.0f ? x[0] - RimlessWheelModel::spokeSpacing : x[0] + RimlessWheelModel::spokeSpacing;
+    next[1] = phi;
+    next[2] = post.thetadot;
+    next[3] = post.phidot;
+  }
+
+  static void measure(const float* x, float* z) {
+    z[0] = x[0];
+    z[1] = x[1];
+    z[2] = x[2];
+    z[3] = x[3];
+  }
+
+  static void residual(const float* z, const float* zhat, float* y) {
+    y[0] = RimlessWheelModel::wrapSpoke(z[0] - zhat[0]);
+    y[1] = z[1] - zhat[1];
+    y[2] = z[2] - zhat[2];
+    y[3] = z[3] - zhat[3];
+  }
+
+  // the model is trusted for angles, less so for rates (friction, ground compliance)
+  static const float* processNoise() {
+    static const float q[4] = {1e-6f, 1e-6f, 1e-1f, 1e-1f};
+    return q;
+  }
+
+  // encoder angle, fused roll, differenced (or ODrive) spoke rate, gyro
+  static const float* measurementNoise() {
+    static const float r[4] = {1e-6f, 1e-3f, 1e-2f, 1e-4f};
+    return r;
+  }
+};
+
+// With WHEEL_IMU, z gains the hub gyro's spoke rate: a second, independent measurement of
+// thetadot, far less noisy than the encoder's tracked rate, so the filter leans on it and
+// the encoder's rate needs less low-pass lag
+struct RimlessWheelHubGyro : RimlessWheel {
+  static constexpr int num_measurements = 5;
+
+  static void measure(const float* x, float* z) {
+    RimlessWheel::measure(x, z);
+    z[4] = x[2];
+  }
+
+  static void residual(const float* z, const float* zhat, float* y) {
+    RimlessWheel::residual(z, zhat, y);
+    y[4] = z[4] - zhat[4];
+  }
+
+  // as RimlessWheel, then the hub gyro (less the torso's) at about the torso gyro's noise
+  static const float* measurementNoise() {
+    static const float r[5] = {1e-6f, 1e-3f, 1e-2f, 1e-4f, 2e-4f};
+    return r;
+  }
+};
@@ -0,0 +1,409 @@
+// The compute-core micro-benchmarks, shared by the Teensy sketch next to this
+// file (env:teensy40_bench) and the host build (teensy/host, target bench).
+// Configurations are main.cpp's; inputs walk a 64-entry table of plausible
+// states so no call sees the same argument twice in a row.
+//
+// Names are <component>/<variant>, e.g. filter/OD3 or pbc/6-8-8-7-7-1; keep
+// them stable, compare.py matches reports by name.
+
+#include <math.h>
+#include <FastMath.h>
+#include <MicroBench.h>
+#include <Vec3.h>
+#include <ImuTransform.h>
+#include <Lsm6dsFifo.h>
+#include <filters.h>
+#include <filters_bank.h>
+#include <filters_tunable.h>
+#include <MahonyFilter.h>
+#include <RollEstimator.h>
+#include <TorsoEstimator.h>
+#include <VelocityEstimator.h>
+#include <RobotModel.h>
+#include <ImpactMap.h>
+#include <HybridEKF.h>
+#include <StatePredictor.h>
+#include <NeuralPBC.h>
+#include <PosteriorBank.h>
+#include <FixedPBC.h>
+#include <SparsePBC.h>
+#include <Placement.h>
+#include <weights/deter_hardware_even_1mpers.h>
+#include <weights/rw_bayesian.h>
+#include "../RimlessWheelModel.h"
+#if defined(ARDUINO)
+  #include <Adafruit_AHRS.h>
+#endif
+
+namespace compute_bench {
+
+constexpr float samplingTime = 0.01f;
+constexpr uint32_t table_size = 64;
+typedef RimlessWheelModel Robot;
+
+struct TorsoAhrs {
+  static constexpr float period = samplingTime;
+  static constexpr float two_kp = 2.0f*0.5f;
+  static constexpr float two_ki = 0.0f;
+};
+struct TorsoRoll {
+  static constexpr float period = samplingTime;
+  static constexpr float q_angle = 1e-3f;
+  static constexpr float q_bias = 3e-6f;
+  static constexpr float r_angle = 3e-2f;
+  static constexpr float yaw_gain = 0.5f;
+};
+struct SpokeRate {
+  static constexpr IIR::ORDER order = IIR::ORDER::OD3;
+  static constexpr IIR::TYPE  type  = IIR::TYPE::LOWPASS;
+  static constexpr float_t    hz    = 30.0;
+  static constexpr float_t    ts    = samplingTime;
+};
+// a non-zero lever arm, so com_acceleration times the expanded shift rather than nothing
+struct BenchLeverArm {
+  static constexpr float imuToCOMx = 0.0f;
+  static constexpr float imuToCOMy = 0.01f;
+  static constexpr float imuToCOMz = -0.05f;
+};
+
+// Architectures evaluatePbc.jl has been trained with; only 6-8-7-1 ships
+// weights, the others run on deterministic stand-in parameters
+template<class ChainType>
+struct StandIn {
+  typedef ChainType chain;
+  static constexpr int num_params = ChainType::num_params + pbc::num_features;
+  static const float* params() {
+    static float values[num_params];
+    static bool filled = false;
+    if (!filled) {
+      uint32_t state = 12345u;
+      for (int k = 0; k < num_params; ++k) {
+        state = state*1664525u + 1013904223u;
+        values[k] = ((state >> 8) * (1.0f/16777216.0f) - 0.5f);
+      }
+      filled = true;
+    }
+    return values;
+  }
+};
+
+struct Inputs {
+  float roll[table_size], spoke[table_size], rollRate[table_size], spokeRate[table_size];
+  Vec3 gyro[table_size], accel[table_size], mag[table_size];
+
+  Inputs() {
+    for (uint32_t i = 0; i < table_size; ++i) {
+      float t = i * (6.2831853f/table_size);
+      roll[i] = 0.3f*sinf(t);
+      spoke[i] = (Robot::alpha - 0.02f)*sinf(3.0f*t);
+      rollRate[i] = 1.5f*cosf(t);
+      spokeRate[i] = -2.0f + 0.5f*cosf(2.0f*t);
+      gyro[i] = Vec3(rollRate[i], 0.05f*sinf(5.0f*t), 0.02f*cosf(7.0f*t));
+      accel[i] = Vec3(0.3f*cosf(3.0f*t), 9.81f*sinf(roll[i]), 9.81f*cosf(roll[i]));
+      mag[i] = Vec3(22.0f, 5.0f*sinf(t), -40.0f);
+    }
+  }
+};
+
+// One FIFO drain of count samples through the transform, per sample as the loop did and
+// as one batch; count 17 is 1.66 kHz at 100 Hz
+template<uint16_t count>
+void imuTransformBenchmarks(microbench::Runner& bench, const char* perSample, const char* batched) {
+  static ImuFifoSample samples[table_size + count];
+  static ImuTransform transform;
+  static ImuBatch<count> out;
+  const float offset[3] = {0.01f, -0.02f, 0.005f};
+  imu_diagonal(transform.gyro, 0.0012217f, offset);
+  imu_diagonal(transform.accel, 0.0023926f, offset);
+  for (uint32_t i = 0; i < table_size + count; ++i) {
+    for (int a = 0; a < 3; ++a) {
+      samples[i].gyro[a] = (int16_t)(i*37u + a*1000u);
+      samples[i].accel[a] = (int16_t)(4096 - i*53u + a*911u);
+    }
+  }
+  bench.run(perSample, [&](uint32_t i) {
+    const ImuFifoSample* batch = samples + i % table_size;
+    Vec3 sum;
+    for (uint16_t n = 0; n < count; ++n) {
+      sum = sum + imu_apply(transform.gyro, batch[n].gyro);
+      sum = sum + imu_apply(transform.accel, batch[n].accel);
+    }
+    microbench::doNotOptimize(sum);
+  });
+  bench.run(batched, [&](uint32_t i) {
+    const ImuFifoSample* batch = samples + i % table_size;
+    imu_apply_batch(transform, batch, count, out);
+    Vec3 sum;
+    for (uint16_t n = 0; n < count; ++n) sum = sum + out.gyroAt(n) + out.accelAt(n);
+    microbench::doNotOptimize(sum);
+  });
+}
+
+template<class Controller>
+void pbcBenchmark(microbench::Runner& bench, const char* name, const Inputs& in) {
+  Controller pbc(1.0f);
+  bench.run(name, [&](uint32_t i) {
+    uint32_t k = i % table_size;
+    microbench::doNotOptimize(pbc.control(in.roll[k], Robot::uprightSpokeAngle + in.spoke[k],
+                                          in.rollRate[k], in.spokeRate[k]));
+  });
+}
+
+template<IIR::ORDER od>
+void filterBenchmark(microbench::Runner& bench, const char* name, const Inputs& in) {
+  Filter filter(30.0, samplingTime, od);
+  bench.run(name, [&](uint32_t i) {
+    microbench::doNotOptimize(filter.filterIn(in.spokeRate[i % table_size]));
+  });
+}
+
+#if defined(__IMXRT1062__)
+// The PBC forward pass compiled twice, once into ITCM and once into flash
+// (lib/ControlLoop/Placement.h); flatten inlines the whole network into each
+// copy, libm's sinf/expm1f stay in ITCM for both. Flushing the instruction
+// cache before each call gives the flash copy's first-touch cost, the
+// jitter a control step sees after loop() ran through other code.
+typedef NeuralPBC<pbc_weights::deter_hardware_even_1mpers> PlacedPbc;
+
+HOT_CODE __attribute__((noinline, flatten)) float pbcInItcm(PlacedPbc& pbc, const Inputs& in, uint32_t k) {
+  return pbc.control(in.roll[k], Robot::uprightSpokeAngle + in.spoke[k], in.rollRate[k], in.spokeRate[k]);
+}
+COLD_CODE __attribute__((noinline, flatten)) float pbcInFlash(PlacedPbc& pbc, const Inputs& in, uint32_t k) {
+  return pbc.control(in.roll[k], Robot::uprightSpokeAngle + in.spoke[k], in.rollRate[k], in.spokeRate[k]);
+}
+
+inline void flushInstructionCache() {
+  asm volatile("dsb");
+  SCB_CACHE_ICIALLU = 0;
+  asm volatile("dsb");
+  asm volatile("isb");
+}
+
+inline void placementBenchmarks(microbench::Runner& bench, const Inputs& in) {
+  static PlacedPbc pbc(1.0f);
+  bench.run("placement/pbc_itcm", [&](uint32_t i) {
+    microbench::doNotOptimize(pbcInItcm(pbc, in, i % table_size));
+  });
+  bench.run("placement/pbc_flash", [&](uint32_t i) {
+    microbench::doNotOptimize(pbcInFlash(pbc, in, i % table_size));
+  });
+  // the flush is in both, the difference is the misses
+  bench.run("placement/pbc_itcm_cold", [&](uint32_t i) {
+    flushInstructionCache();
+    microbench::doNotOptimize(pbcInItcm(pbc, in, i % table_size));
+  });
+  bench.run("placement/pbc_flash_cold", [&](uint32_t i) {
+    flushInstructionCache();
+    microbench::doNotOptimize(pbcInFlash(pbc, in, i % table_size));
+  });
+}
+#endif
+
+inline void runAll(microbench::Runner& bench) {
+  static const Inputs in;
+
+  // libFilter, the runtime Filter of each order and the bank the sketch uses
+  filterBenchmark<IIR::ORDER::OD1>(bench, "filter/OD1", in);
+  filterBenchmark<IIR::ORDER::OD2>(bench, "filter/OD2", in);
+  filterBenchmark<IIR::ORDER::OD3>(bench, "filter/OD3", in);
+  filterBenchmark<IIR::ORDER::OD4>(bench, "filter/OD4", in);
+  {
+    static FixedFilterBank<2, SpokeRate> bank;
+    bench.run("filter_bank/2xOD3", [&](uint32_t i) {
+      float x[2] = {in.spokeRate[i % table_size], in.spokeRate[(i + 7) % table_size]};
+      bank.filterIn(x, x);
+      microbench::doNotOptimize(x);
+    });
+  }
+  {
+    // the same bank retunable, holding its cutoff and then always in a ramp between two
+    static TunableFilterBank<2, SpokeRate::order> tunable(SpokeRate::hz, SpokeRate::ts);
+    bench.run("filter_bank/2xOD3_tunable", [&](uint32_t i) {
+      float x[2] = {in.spokeRate[i % table_size], in.spokeRate[(i + 7) % table_size]};
+      tunable.filterIn(x, x);
+      microbench::doNotOptimize(x);
+    });
+    bench.run("filter_bank/2xOD3_retune", [&](uint32_t i) {
+      if (!tunable.isRetuning())
+        tunable.setCutoffFreqHZ(tunable.cutoffFreqHZ(0) > 20.0f ? 15.0f : SpokeRate::hz);
+      float x[2] = {in.spokeRate[i % table_size], in.spokeRate[(i + 7) % table_size]};
+      tunable.filterIn(x, x);
+      microbench::doNotOptimize(x);
+    });
+  }
+
+  // attitude: the Adafruit library the first sketches used against ours
+  #if defined(ARDUINO)
+  {
+    static Adafruit_Mahony adafruit;
+    adafruit.begin(1.0f/samplingTime);
+    bench.run("attitude/adafruit_mahony", [&](uint32_t i) {
+      uint32_t k = i % table_size;
+      const float deg = 57.29578f;
+      adafruit.update(in.gyro[k].x*deg, in.gyro[k].y*deg, in.gyro[k].z*deg, in.accel[k].x, in.accel[k].y, in.accel[k].z,
+                      in.mag[k].x, in.mag[k].y, in.mag[k].z);
+      microbench::doNotOptimize(adafruit.getRollRadians());
+    });
+  }
+  #endif
+  {
+    static MahonyFilter<TorsoAhrs> mahony;
+    bench.run("attitude/mahony_filter", [&](uint32_t i) {
+      uint32_t k = i % table_size;
+      mahony.update(in.gyro[k].x, in.gyro[k].y, in.gyro[k].z, in.accel[k].x, in.accel[k].y, in.accel[k].z,
+                    in.mag[k].x, in.mag[k].y, in.mag[k].z);
+      microbench::doNotOptimize(mahony.roll());
+    });
+  }
+  {
+    static RollEstimator<TorsoRoll> roll;
+    bench.run("attitude/roll_estimator", [&](uint32_t i) {
+      uint32_t k = i % table_size;
+      roll.update(in.gyro[k].x, in.gyro[k].y, in.gyro[k].z, in.accel[k].x, in.accel[k].y, in.accel[k].z,
+                  in.mag[k].x, in.mag[k].y, in.mag[k].z);
+      microbench::doNotOptimize(roll.roll());
+    });
+  }
+  {
+    static TorsoEstimator<MahonyFilter<TorsoAhrs>> torso;
+    bench.run("attitude/torso_estimator", [&](uint32_t i) {
+      uint32_t k = i % table_size;
+      float states[3];
+      torso.fuse(in.gyro[k], &in.accel[k], in.mag[k], samplingTime);
+      torso.states(states);
+      microbench::doNotOptimize(states);
+    });
+  }
+  imuTransformBenchmarks<4>(bench, "imu_transform/per_sample_4", "imu_transform/batch_4");
+  imuTransformBenchmarks<17>(bench, "imu_transform/per_sample_17", "imu_transform/batch_17");
+  bench.run("com_acceleration", [&](uint32_t i) {
+    uint32_t k = i % table_size;
+    microbench::doNotOptimize(comAcceleration<BenchLeverArm>(in.accel[k], in.gyro[k], in.rollRate[(k + 1) % table_size]));
+  });
+
+  // spoke rates
+  {
+    static VelocityEstimator tracking = VelocityEstimator::tracking(30.0f);
+    static VelocityEstimator savgol = VelocityEstimator::savitzkyGolay(6, 2);
+    bench.run("velocity/tracking", [&](uint32_t i) {
+      microbench::doNotOptimize(tracking.update(in.spoke[i % table_size], i*10000u));
+    });
+    bench.run("velocity/savgol6x2", [&](uint32_t i) {
+      microbench::doNotOptimize(savgol.update(in.spoke[i % table_size], i*10000u));
+    });
+  }
+
+  // impact map: closed form, table, Chebyshev series
+  {
+    static ImpactMap<Robot> table;
+    bench.run("impact_map/evaluate", [&](uint32_t i) {
+      microbench::doNotOptimize(ImpactMap<Robot>::evaluate(in.roll[i % table_size]));
+    });
+    bench.run("impact_map/lookup", [&](uint32_t i) {
+      microbench::doNotOptimize(table.lookup(in.roll[i % table_size]));
+    });
+    bench.run("impact_map/series", [&](uint32_t i) {
+      microbench::doNotOptimize(table.series(in.roll[i % table_size]));
+    });
+  }
+
+  // one estimator tick of the MODEL_EKF build
+  {
+    static HybridEKF<RimlessWheel> ekf;
+    float x0[4] = {0.0f, 0.0f, -2.0f, 0.0f};
+    ekf.reset(x0, 0.1f);
+    bench.run("ekf/predict_correct", [&](uint32_t i) {
+      uint32_t k = i % table_size;
+      float z[4] = {in.spoke[k], in.roll[k], in.spokeRate[k], in.rollRate[k]};
+      ekf.predict(0.1f*in.roll[k], samplingTime);
+      ekf.correct(z);
+      microbench::doNotOptimize(ekf.state(2));
+    });
+  }
+
+  // a sample carried over 10 ms of latency in 2 ms substeps
+  {
+    static const StatePredictor<RimlessWheel> predictor;
+    bench.run("predictor/10ms", [&](uint32_t i) {
+      uint32_t k = i % table_size;
+      float x[4] = {in.spoke[k], in.roll[k], in.spokeRate[k], in.rollRate[k]}, xp[4];
+      predictor.predict(x, 0.1f*in.roll[k], 0.01f, xp);
+      microbench::doNotOptimize(xp);
+    });
+  }
+
+  // neural PBC forward pass and input gradient per architecture
+  pbcBenchmark<NeuralPBC<pbc_weights::deter_hardware_even_1mpers>>(bench, "pbc/6-8-7-1", in);
+  pbcBenchmark<NeuralPBC<pbc_weights::deter_hardware_even_1mpers, pbc::FastElu>>(bench, "pbc/6-8-7-1_fast_elu", in);
+  pbcBenchmark<NeuralPBC<pbc_weights::deter_hardware_even_1mpers, pbc::FastElu, pbc::FastTrig>>(bench, "pbc/6-8-7-1_fast_elu_trig", in);
+  pbcBenchmark<FixedPBC<pbc_weights::deter_hardware_even_1mpers>>(bench, "pbc/6-8-7-1_fixed", in);
+  pbcBenchmark<FixedPBC<pbc_weights::deter_hardware_even_1mpers, pbc::FastTrig>>(bench, "pbc/6-8-7-1_fixed_fast_trig", in);
+  pbcBenchmark<SparsePBC<pbc_weights::deter_hardware_even_1mpers>>(bench, "pbc/6-8-7-1_sparse", in);
+  pbcBenchmark<SparsePBC<pbc_weights::deter_hardware_even_1mpers, pbc::FastElu, pbc::FastTrig>>(bench, "pbc/6-8-7-1_sparse_fast", in);
+  pbcBenchmark<NeuralPBC<StandIn<pbc::Chain<6, 8, 8, 5, 5, 1>>>>(bench, "pbc/6-8-8-5-5-1", in);
+  pbcBenchmark<NeuralPBC<StandIn<pbc::Chain<6, 8, 8, 7, 7, 1>>>>(bench, "pbc/6-8-8-7-7-1", in);
+  {
+    static PosteriorBank<pbc_weights::rw_bayesian, pbc_weights::rw_bayesian::num_samples> bank(2.0f);
+    bank.load(pbc_weights::rw_bayesian::samples());
+    bench.run("pbc/bayes_6-8-7-1x10", [&](uint32_t i) {
+      uint32_t k = i % table_size;
+      microbench::doNotOptimize(bank.control(in.roll[k], Robot::uprightSpokeAngle + in.spoke[k], in.rollRate[k], in.spokeRate[k]));
+    });
+    static PosteriorBank<pbc_weights::rw_bayesian, pbc_weights::rw_bayesian::num_samples, pbc::FastElu> fastBank(2.0f);
+    fastBank.load(pbc_weights::rw_bayesian::samples());
+    bench.run("pbc/bayes_6-8-7-1x10_fast_elu", [&](uint32_t i) {
+      uint32_t k = i % table_size;
+      microbench::doNotOptimize(fastBank.control(in.roll[k], Robot::uprightSpokeAngle + in.spoke[k], in.rollRate[k], in.spokeRate[k]));
+    });
+    static PosteriorBank<pbc_weights::rw_bayesian, pbc_weights::rw_bayesian::num_samples, pbc::FastElu, pbc::FastTrig> fastTrigBank(2.0f);
+    fastTrigBank.load(pbc_weights::rw_bayesian::samples());
+    bench.run("pbc/bayes_6-8-7-1x10_fast_elu_trig", [&](uint32_t i) {
+      uint32_t k = i % table_size;
+      microbench::doNotOptimize(fastTrigBank.control(in.roll[k], Robot::uprightSpokeAngle + in.spoke[k], in.rollRate[k], in.spokeRate[k]));
+    });
+  }
+
+  // the input layer's four sin/cos, libm against pbc::FastTrig
+  bench.run("pbc/input_layer", [&](uint32_t i) {
+    uint32_t k = i % table_size;
+    float xi[pbc::num_features];
+    pbc::inputLayer(in.roll[k], Robot::uprightSpokeAngle + in.spoke[k], in.rollRate[k], in.spokeRate[k], xi);
+    microbench::doNotOptimize(xi);
+  });
+  bench.run("pbc/input_layer_fast_trig", [&](uint32_t i) {
+    uint32_t k = i % table_size;
+    float xi[pbc::num_features];
+    pbc::inputLayer<pbc::FastTrig>(in.roll[k], Robot::uprightSpokeAngle + in.spoke[k], in.rollRate[k], in.spokeRate[k], xi);
+    microbench::doNotOptimize(xi);
+  });
+
+  // libm against FastMath, one call each on the table's angles and accels
+  bench.run("math/sincosf", [&](uint32_t i) {
+    float x = in.spoke[i % table_size];
+    microbench::doNotOptimize(sinf(x) + cosf(x));
+  });
+  bench.run("math/sincos_fast", [&](uint32_t i) {
+    float s, c;
+    fastmath::sincos(in.spoke[i % table_size], s, c);
+    microbench::doNotOptimize(s + c);
+  });
+  bench.run("math/atan2f", [&](uint32_t i) {
+    microbench::doNotOptimize(atan2f(in.accel[i % table_size].y, in.accel[i % table_size].z));
+  });
+  bench.run("math/atan2_fast", [&](uint32_t i) {
+    microbench::doNotOptimize(fastmath::atan2(in.accel[i % table_size].y, in.accel[i % table_size].z));
+  });
+  bench.run("math/expm1f", [&](uint32_t i) {
+    microbench::doNotOptimize(expm1f(-fabsf(in.spokeRate[i % table_size])));
+  });
+  bench.run("math/expm1_fast", [&](uint32_t i) {
+    microbench::doNotOptimize(fastmath::expm1(-fabsf(in.spokeRate[i % table_size])));
+  });
+
+  // the same code from ITCM and from flash, Teensy 4 only
+  #if defined(__IMXRT1062__)
+    placementBenchmarks(bench, in);
+  #endif
+}
+
+} // namespace compute_bench
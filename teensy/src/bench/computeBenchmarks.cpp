@@ -0,0 +1,34 @@
+// On-target run of ComputeBenchmarks.h, built alone by env:teensy40_bench
+// in place of main.cpp:
+//
+//   pio run -e teensy40_bench -t upload
+//   pio device monitor > teensy40.json   (a key press reruns the suite)
+//
+// The report is the same JSON the host bench writes, with cycles per call.
+
+#include <Arduino.h>
+#include "ComputeBenchmarks.h"
+
+static void writeSerial(const char* text) { Serial.print(text); }
+
+static void runSuite() {
+  microbench::Runner bench(writeSerial, "teensy40");
+  compute_bench::runAll(bench);
+  bench.finish();
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial && millis() < 3000) {}
+  // the core starts DWT for micros(); make sure on older cores
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+  runSuite();
+}
+
+void loop() {
+  if (Serial.available()) {
+    while (Serial.available()) Serial.read();
+    runSuite();
+  }
+}
@@ -5,13 +5,91 @@
 #include <std_msgs/Int64MultiArray.h>
 #include <sensor_msgs/JointState.h>
 #include <sensor_msgs/Joy.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <raspi_pkg/SensorState.h>
+#include <raspi_pkg/SensorBatch.h>
+#include <raspi_pkg/SensorDelta.h>
+#include <raspi_pkg/ClockSync.h>
+#include <raspi_pkg/Teleop.h>
+#include <raspi_pkg/ImuConfig.h>
+#include <raspi_pkg/ODriveErrors.h>
 #include <Wire.h>
+#include <AsyncI2C.h>
 #include <HardwareSerial.h>
 #include <ODriveArduino.h>
+#include <ODriveConfig.h>
+#include <ODriveBinary.h>
+#include <MotorDriver.h>
+#include <ODriveI2CDriver.h>
+#include <ODriveCANDriver.h>
+#include <AxisCalibration.h>
+#include <ControlScheduler.h>
+#include <CycleProfiler.h>
+#include <TraceBuffer.h>
+#include <LoopTiming.h>
+#include <CpuLoad.h>
+#include <MemoryBudget.h>
+#include <CpuClock.h>
+#include <Placement.h>
+#include <CommandLatency.h>
+#include <CommandQueue.h>
+#include <SeqSnapshot.h>
+#include <SampleBatcher.h>
+#include <LinkScheduler.h>
+#include <LinkGovernor.h>
+#include <TeleopShaper.h>
+#include <BootSelfTest.h>
+#include <HealthMonitor.h>
+#include <DeltaCodec.h>
+#include <TorqueOutput.h>
+#include <TorqueLimiter.h>
+#include <TorsoStabilizer.h>
+#include <RateTask.h>
+#include <Protothread.h>
+#include <ODriveErrorMonitor.h>
+#include <ODriveFaultManager.h>
+#include <NeuralPBC.h>
+#include <PosteriorBank.h>
+#include <FixedPBC.h>
+#include <SparsePBC.h>
+#include <ScheduledPBC.h>
+#include <weights/deter_hardware_even_1mpers.h>
+#include <weights/deterministic_hardware.h>
+#include <weights/rw_bayesian.h>
 #include <Adafruit_Sensor_Calibration.h>
-#include <Adafruit_AHRS.h>
+#include <CalibrationBlob.h>
+#include <ReferenceBlob.h>
+#include <MahonyFilter.h>
+#include <RollEstimator.h>
+#include <HybridEKF.h>
+#include <ImpactMap.h>
+#include <RobotModel.h>
+#include <ActuatorModel.h>
+#include <StanceTracker.h>
+#include <FlightRecorder.h>
+#include <SdFlightLog.h>
+#include <SpiFlashLog.h>
+#include <Vec3.h>
 #include <cassert> 
-#include <filters.h>
+#include <filters_bank.h>
+#include <filters_decimate.h>
+#include <VelocityEstimator.h>
+#include <TorsoEstimator.h>
+#include <GyroBiasEstimator.h>
+#include <ImuArray.h>
+#include <SpokeEstimator.h>
+#include <ImpactDetector.h>
+#include <TerrainEstimator.h>
+#include <TransportMeter.h>
+#include <SpectrumMonitor.h>
+#include <DeferredLog.h>
+#include <JointStateView.h>
+#include <TrajectoryView.h>
+#include <WeightChunkView.h>
+#include <WeightUpload.h>
+#include <TrajectoryBuffer.h>
+#include <StepBenchmark.h>
+#include "BuildConfig.h" // the build profile: transport, command mode, controller site, estimator, flight log
 
 Adafruit_Sensor *accelerometer, *gyroscope, *magnetometer;
 
@@ -25,59 +103,201 @@ template<>        inline Print& operator <<(Print &obj, float arg) { obj.print(a
 
 
 // #define USE_TEENSY_HW_SERIAL // for using a hardware serial port w/ ROS
-#define MOTOR_SUBSCRIBER_NAME "/torso_command"
-#define ODRIVE_SUBSCRIBER_NAME "/odrive_command"
-#define ENCODER_PUBLISHER_NAME "/sensors"
-#define ODRIVE_ERROR_PUBLISHER_NAME "/odrive_errors"
+#ifndef ROS_TOPIC_PREFIX
+  #define ROS_TOPIC_PREFIX "" // e.g. "/wheel2" (env:teensy40_wheel2) for a second wheel through serial_node.py; teensy_bridge namespaces the plain names itself
+#endif
+#define MOTOR_SUBSCRIBER_NAME ROS_TOPIC_PREFIX "/torso_command"
+#define ODRIVE_SUBSCRIBER_NAME ROS_TOPIC_PREFIX "/odrive_command"
+#define TELEOP_SUBSCRIBER_NAME ROS_TOPIC_PREFIX "/teleop"
+#define TRAJECTORY_SUBSCRIBER_NAME ROS_TOPIC_PREFIX "/trajectory"
+#define IMU_CONFIG_SUBSCRIBER_NAME ROS_TOPIC_PREFIX "/imu_config"
+#define WEIGHT_UPLOAD_SUBSCRIBER_NAME ROS_TOPIC_PREFIX "/weight_upload"
+#define ENCODER_PUBLISHER_NAME ROS_TOPIC_PREFIX "/sensors"
+#define PACKED_SENSOR_PUBLISHER_NAME ROS_TOPIC_PREFIX "/sensors_packed"
+#define SENSOR_BATCH_PUBLISHER_NAME ROS_TOPIC_PREFIX "/sensors_batch"
+#define SENSOR_DELTA_PUBLISHER_NAME ROS_TOPIC_PREFIX "/sensors_delta"
+#define ODRIVE_ERROR_PUBLISHER_NAME ROS_TOPIC_PREFIX "/odrive_errors"
+#define DIAGNOSTICS_PUBLISHER_NAME ROS_TOPIC_PREFIX "/diagnostics"
+#define LOOP_TIMING_PUBLISHER_NAME ROS_TOPIC_PREFIX "/loop_timing"
+#define CLOCK_PING_SUBSCRIBER_NAME ROS_TOPIC_PREFIX "/clock_sync_ping"
+#define CLOCK_PONG_PUBLISHER_NAME ROS_TOPIC_PREFIX "/clock_sync_pong"
+
+#define PACKED_SENSOR_MSG // publish raspi_pkg/SensorState on /sensors_packed instead of JointState on /sensors
+// #define SENSOR_BATCH 4 // with PACKED_SENSOR_MSG, this many samples (up to raspi_pkg::SensorBatch::MAX_SAMPLES) a raspi_pkg/SensorBatch on /sensors_batch instead of one a message on /sensors_packed, for control rates the link cannot carry a frame per step of
+// #define SENSOR_DELTA // with PACKED_SENSOR_MSG, raspi_pkg/SensorDelta on /sensors_delta instead: the samples (a SENSOR_BATCH of them, if defined) quantized and sent as zig-zag varint deltas, ~16 bytes a sample against 43
+#define SENSOR_DELTA_KEYFRAME 100 // samples from one SENSOR_DELTA keyframe to the next, the most a lost frame costs the Pi
+#define SENSOR_DECIMATION 1 // every Nth control step's sample is published (or batched)
+// #define SENSOR_EVENTS // a touchdown, an E-stop edge or a change of the ODrive error bit publishes its sample at once, between the SENSOR_DECIMATION ones (or closes the SENSOR_BATCH early)
+#define SENSOR_EVENT_MIN_STEPS 5 // control steps from one event-triggered send to the next, the most SENSOR_EVENTS adds to the message rate
+#define SENSOR_PUBLISH_FIXED // with PACKED_SENSOR_MSG, framed on the stack by nh.publishFixed() and dropped (a gap in seq) rather than waited for when the USB transmit buffer is full
+// #define LINK_SCHEDULER // everything but the sensor and clock frames queued by priority (LinkScheduler): status before telemetry, each within its byte budget, and only while the USB buffer keeps LINK_CRITICAL_RESERVE free; depths and drops on /diagnostics
+#define LINK_STATUS_RATE 20000 // bytes/s for /odrive_errors and the calibration and fault diagnostics
+#define LINK_TELEMETRY_RATE 20000 // bytes/s for /loop_timing and the periodic diagnostics
+#define LINK_QUEUE_BYTES 4096 // per class, also its burst
+#define LINK_CRITICAL_RESERVE 64 // bytes held back for the next sensor frame; a SENSOR_BATCH frame needs ~40 a sample
+// #define LINK_GOVERNOR // with the Pi's TORQUE_CONTROL: as the link falls behind, telemetry cut, then the debug text held, then the Pi's torque replaced by the torso held on board, then the brake (LinkGovernor); each change on /diagnostics and in the flight log
+#define LINK_REDUCE_ROUND_TRIP_US 20000 // with COMMAND_LATENCY, the newest command computed from a sample this old cuts the telemetry
+#define LINK_QUIET_ROUND_TRIP_US 35000 // and this old holds the debug text
+#define LINK_REDUCE_BACKLOG_BYTES 1024 // rosserial's unread input, and with LINK_SCHEDULER the output queued
+#define LINK_QUIET_BACKLOG_BYTES 2048
+#define LINK_FALLBACK_US 50000 // a command this old, or computed from a sample this old, gives way to the fallback; COMMAND_TIMEOUT_US's
+#define LINK_BRAKE_AFTER_MS 2000 // of the fallback without the commands back before the brake
+#define LINK_RECOVER_MS 2000 // of the link keeping up before each step back up
+#define LINK_REDUCED_TELEMETRY_DIVIDER 4 // degraded, the telemetry goes out one whole second in this many
+#define LINK_FALLBACK_KP 2.0f // Nm/rad; the fallback holds the torso at the angle it found it at
+#define LINK_FALLBACK_KD 0.2f // Nm s/rad
+#define TRAJECTORY_INPUT_SIZE 4096 // nh's input buffer with TRAJECTORY_PLAYBACK, ~250 points an upload
 
 #define MOTOR_VELOCITY_LIMIT 50.0 // radians per second? Maybe rotations per second?
 #define MOTOR_CURRENT_LIMIT  20.0 // amps
 
 
-ros::NodeHandle nh;
+#if defined(ROS_FAST_LINK)
+  // 6 subscribers (with TELEOP_MSG or TRAJECTORY_PLAYBACK, IMU_CONFIG_MSG and WEIGHT_UPLOAD) and 5 publishers; the largest outgoing message is /loop_timing at ~300 bytes
+  #if defined(TRAJECTORY_PLAYBACK)
+    typedef ros::NodeHandle_<ArduinoHardware, 6, 6, TRAJECTORY_INPUT_SIZE, 1024> FastNodeHandle;
+  #elif defined(WEIGHT_UPLOAD)
+    typedef ros::NodeHandle_<ArduinoHardware, 6, 6, 512, 1024> FastNodeHandle; // a whole WeightChunk
+  #else
+    typedef ros::NodeHandle_<ArduinoHardware, 6, 6, 256, 1024> FastNodeHandle;
+  #endif
+  FastNodeHandle nh;
+#elif defined(TRAJECTORY_PLAYBACK)
+  ros::NodeHandle_<ArduinoHardware, 25, 25, TRAJECTORY_INPUT_SIZE, 512> nh; // the default with room for an upload
+#else
+  ros::NodeHandle nh;
+#endif
 
-void receiveJointState(const sensor_msgs::JointState &msg);
-sensor_msgs::JointState motorStates; // comands for the motors
-ros::Subscriber<sensor_msgs::JointState> motors(MOTOR_SUBSCRIBER_NAME, &receiveJointState);
+void receiveJointState(const JointStateView &msg);
+// read in place from nh's input buffer, only the fields the callback uses are decoded
+ros::Subscriber<JointStateView> motors(MOTOR_SUBSCRIBER_NAME, &receiveJointState);
 
 void receiveODriveCommand(const sensor_msgs::Joy &msg);
 sensor_msgs::Joy odriveCommand; // commands for clearing errors, rebooting, etc
 ros::Subscriber<sensor_msgs::Joy> odriveCmd(ODRIVE_SUBSCRIBER_NAME, &receiveODriveCommand);
 
-void publishSensorStates(const float* torsoStates, const float* spokeStates );
-sensor_msgs::JointState sensorStates; // feedback of the encoder positions
-ros::Publisher sensors(ENCODER_PUBLISHER_NAME, &sensorStates);
+void receiveClockPing(const raspi_pkg::ClockSync &msg);
+raspi_pkg::ClockSync clockPong; // the Pi's ping with our micros(), so it can stamp stamp_us in its own time
+ros::Subscriber<raspi_pkg::ClockSync> clockPing(CLOCK_PING_SUBSCRIBER_NAME, &receiveClockPing);
+ros::Publisher clockPongPub(CLOCK_PONG_PUBLISHER_NAME, &clockPong);
+
+void publishSensorStates(const float* torsoStates, const float* spokeStates, uint32_t seq, uint32_t stamp_us, uint8_t status,
+                         const float* current, float vbus);
+#if defined(PACKED_SENSOR_MSG)
+  raspi_pkg::SensorState sensorStates; // float32 sample, expanded back to JointState on /sensors by the Pi's sensor_relay
+  ros::Publisher sensors(PACKED_SENSOR_PUBLISHER_NAME, &sensorStates);
+  #if defined(SENSOR_BATCH)
+    raspi_pkg::SensorBatch sensorBatch; // SENSOR_BATCH consecutive samples, expanded onto /sensors_packed and /sensors by the Pi's bridge
+    ros::Publisher sensorBatches(SENSOR_BATCH_PUBLISHER_NAME, &sensorBatch);
+  #endif
+  #if defined(SENSOR_DELTA)
+    raspi_pkg::SensorDelta sensorDelta; // delta coded samples, decoded onto /sensors_packed and /sensors by the Pi's bridge
+    ros::Publisher sensorDeltas(SENSOR_DELTA_PUBLISHER_NAME, &sensorDelta);
+  #endif
+#else
+  sensor_msgs::JointState sensorStates; // feedback of the encoder positions
+  ros::Publisher sensors(ENCODER_PUBLISHER_NAME, &sensorStates);
+#endif
 
 void publishErrorState();
-std_msgs::Int64MultiArray errorStates; // error states for the ODrive
+raspi_pkg::ODriveErrors errorStates; // the ODrive's non-zero error registers, on a change and as a heartbeat
 ros::Publisher odriveErrors(ODRIVE_ERROR_PUBLISHER_NAME, &errorStates);
 
+void publishProfile();
+diagnostic_msgs::DiagnosticArray profileArray; // per-section timing, one section per message to fit the 512 byte buffer
+ros::Publisher diagnostics(DIAGNOSTICS_PUBLISHER_NAME, &profileArray);
+
+void publishLoopTiming();
+void publishRateTasks();
+void publishCommandLatency();
+void publishCalibration();
+void publishMemory();
+void publishCpuClock();
+void publishCpuLoad();
+void publishI2CBus(const char* name, AsyncI2C& bus, uint8_t index);
+void publishSpectrum();
+void publishFaultState();
+void publishBackground();
+void publishHealth();
+#if defined(BOOT_SELF_TEST)
+  BootSelfTest selfTest(BOOT_SELF_TEST_BUDGET_MS*1000ul);
+  float selfTestVbus = 0.0f; // V, the property probe's last good read
+  void runSelfTest(bool odrive);
+  void publishSelfTest();
+#endif
+std_msgs::Int64MultiArray loopTimingStates; // period histogram, deadline misses and sense-to-actuate latency
+ros::Publisher loopTimingPub(LOOP_TIMING_PUBLISHER_NAME, &loopTimingStates);
+
+// what a non-critical frame is queued as with LINK_SCHEDULER, in drain order
+enum LinkClass : uint8_t { LINK_STATUS, LINK_TELEMETRY, LINK_CLASSES };
+#if defined(LINK_SCHEDULER)
+  void publishLink();
+  LinkScheduler<LINK_CLASSES, LINK_QUEUE_BYTES> linkScheduler(
+    {{LINK_STATUS_RATE, LINK_QUEUE_BYTES}, {LINK_TELEMETRY_RATE, LINK_QUEUE_BYTES}}, LINK_CRITICAL_RESERVE);
+#endif
+#if defined(LINK_GOVERNOR)
+  LinkGovernor linkGovernor({LINK_REDUCE_ROUND_TRIP_US, LINK_QUIET_ROUND_TRIP_US, LINK_REDUCE_BACKLOG_BYTES,
+                             LINK_QUIET_BACKLOG_BYTES, LINK_FALLBACK_US, LINK_BRAKE_AFTER_MS*1000ul, LINK_RECOVER_MS*1000ul});
+  volatile uint32_t linkRoundTrip_us = 0; // of the newest /torso_command, 0 unless it echoed its sample's seq
+  volatile uint32_t linkBacklog = 0;      // bytes, measured in loop()
+  uint32_t linkTelemetryShed = 0;         // telemetry frames not sent while degraded
+  void publishLinkGovernor();
+#endif
+// Publish from loop() through the link scheduler, or straight out without it
+template<class M>
+void linkPublish(LinkClass linkClass, ros::Publisher& pub, const M* msg) {
+  #if defined(LINK_GOVERNOR)
+    // whole seconds, so the statuses of one second stay together
+    if (linkClass == LINK_TELEMETRY && linkGovernor.mode() >= LinkGovernor::REDUCED
+        && (millis() / 1000) % LINK_REDUCED_TELEMETRY_DIVIDER != 0) {
+      ++linkTelemetryShed;
+      return;
+    }
+  #endif
+  #if defined(LINK_SCHEDULER)
+    int length = nh.frame(pub.id_, msg);
+    if (length > 0) linkScheduler.enqueue(linkClass, nh.framed(), length);
+  #else
+    (void)linkClass;
+    pub.publish(msg);
+  #endif
+}
+
 // Teensy 3 and 4 (all versions) - Serial1
 // pin 0: RX - connect to ODrive TX (GPIO1)
 // pin 1: TX - connect to ODrive RX (GPIO2)
 // See https://www.pjrc.com/teensy/td_uart.html for other options on Teensy
 HardwareSerial &odriveSerial = Serial1;
+// the rings' added memory, in RAM2 with the other buffers the CPU only copies through;
+// given to odriveSerial in setup() before its first begin()
+#if ODRIVE_SERIAL_TX_BUFFER > 0
+  DMAMEM uint8_t odriveTxBuffer[ODRIVE_SERIAL_TX_BUFFER];
+#endif
+#if ODRIVE_SERIAL_RX_BUFFER > 0
+  DMAMEM uint8_t odriveRxBuffer[ODRIVE_SERIAL_RX_BUFFER];
+#endif
 
 // ODrive object
 ODriveArduino ODrive(odriveSerial);
+// Native-protocol transport on the same UART, used by the MOTOR_DRIVER_BINARY backend
+ODriveBinary ODriveFast(odriveSerial);
 // E-stop pins
 int estop_in = 3;
 
 bool estop();
+void estopIsr();
 void brake();
-void calibrateMotor(bool motor);
-int64_t readErrors();
-int64_t readODriveErrors();
-int64_t readMotorErrors(int motor_number);
-int64_t readAxisErrors(int axis_number);
-int64_t readEncoderErrors(int encoder_number);
-int64_t readControllerErrors(int controller_number);
-float* readEncoder(float* torsoStates);
-float* readIMU();
-void commandTorque(int axis, float torque);
+void startCalibration(bool motor);
+bool probeODrive(uint32_t baud);
+uint32_t connectODrive();
+void readErrors();
+void readEncoder(float* spokeStates);
+void readIMU(float* torsoStates);
+float readWheelImu(const float* torsoStates);
+void commandTorques(const float torque[2]);
 void computeTorque(const float* torsoStates, const float* spokeStates);
+void controlStep();
 
-Adafruit_Mahony filter;  // fastest/smalleset
 
 #if defined(ADAFRUIT_SENSOR_CALIBRATION_USE_EEPROM)
   Adafruit_Sensor_Calibration_EEPROM cal;
@@ -85,61 +305,872 @@ Adafruit_Mahony filter;  // fastest/smalleset
   Adafruit_Sensor_Calibration_SDFat cal;
 #endif
 
-#define FILTER_UPDATE_RATE_HZ 100
-#define PRINT_EVERY_N_UPDATES 10
-#define AHRS_DEBUG_OUTPUT
-#define TORQUE_CONTROL
-#define ODRIVE_CONNECTED
-
-const float m1 = 1.13f;    
-const float m2 = 3.385f; 
-const float l1 = 0.3f;
-const float l2 = 0.06f;
-const float I1 = 0.0885f/2.0f;
-const float I2 = m2*l2*l2/3.0f;
-const float mt = m1 + m2;
-const float W = 0.026f;
-const float g  = 9.81f;
-const float incline = 0.0f; 
-const float k = 10.0f;
-const float alpha = 360.0f/k/2.0f * M_PI/180.0f;
-const float Kv = 0.13f;
-const float gearRatio = 1.0f/6.0f;
-
-const float samplingTime = 1.0f/FILTER_UPDATE_RATE_HZ;
-float oldTorsoOmega = 0.0f;
-float oldSpoke1Angle = alpha;
-float oldSpoke2Angle = alpha;
-float oldSpokeSpeed = 0.0f;
-float torque0 = 0.0;
-float torque1 = 0.0;
-float enc0Offset = 0.0;
-float enc1Offset = 0.0;
-float yawOffset = 0.0;
-
-uint32_t timestamp;
+// TORQUE_CONTROL, POSITION_CONTROL, TELEOP_MSG, TRAJECTORY_PLAYBACK, ODRIVE_CONNECTED, ONBOARD_PBC,
+// MOTOR_DRIVER, ATTITUDE_ESTIMATOR, FLIGHT_LOG_SINK, AHRS_DEBUG_OUTPUT and FILTER_UPDATE_RATE_HZ
+// come from the build profile (BuildConfig.h, -D BUILD_PROFILE in platformio.ini)
+#define VELOCITY_FEEDFORWARD // without TORQUE_CONTROL, the torso's gravity torque from the model as torque feed-forward on the hips
+#define TELEOP_DEADBAND 0.08f // with TELEOP_SHAPING (TeleopShaper), the stick's rest, stretched out of the remaining travel
+#define TELEOP_EXPO 0.4f // 0 linear, 1 cubic: fine control about the centre, the full speed kept
+// #define TELEOP_CURVE {0.0f, 0.1f, 0.25f, 0.5f, 1.0f} // and |stick| through this table, up to TeleopShaper::MAX_POINTS from 0 to 1
+#define TELEOP_RATE_LIMIT 100.0f // MOTOR_VELOCITY_LIMIT's units a second; 0.5 s from rest to full stick
+#define TELEOP_TIMEOUT_MS 500 // a stick not heard for this long ramps to 0; joy_node's autorepeat_rate keeps a held one heard
+// #define MOTOR_DRIVER_BENCHMARK // time readFeedback/setTorques and print min/mean/max over Serial
+// #define STEP_BENCHMARK // with TORQUE_CONTROL, a press of STEP_BENCHMARK_BUTTON on /odrive_command runs (or stops) torque steps at each of STEP_BENCHMARK_RATES_HZ (StepBenchmark); wheel off the ground, results on /diagnostics
+#define STEP_BENCHMARK_BUTTON 4 // the Joy button; 0 and 3 are the calibration and the reboot
+#define STEP_BENCHMARK_RATES_HZ {100, 200, 500, 1000} // control rates swept, then back to the build profile's
+#define STEP_BENCHMARK_TORQUE 0.2f // Nm, the hip torque of the +/- steps
+#define STEP_BENCHMARK_SETTLE_MS 500 // at zero torque after each rate change
+#define STEP_BENCHMARK_STEP_MS 500 // each of +, 0, -, 0
+#define STEP_BENCHMARK_BAND 0.02f // Nm; a step has settled once both motors are this close to their command (ODRIVE_ELECTRICAL_FEEDBACK)
+#define ODRIVE_REPLY_TIMEOUT_US 3000
+// #define ODRIVE_ELECTRICAL_FEEDBACK // with MOTOR_DRIVER_BINARY or MOTOR_DRIVER_CAN, both axes' Iq_measured and vbus_voltage in the feedback exchange and the /sensors_packed samples
+// #define ODRIVE_I2C_ASYNC // with MOTOR_DRIVER_I2C, Wire1's traffic queued on LPI2C3 (AsyncI2C): feedback requested at the top of the step, setpoints not waited for
+// #define ODRIVE_I2C_SHARED_BUS // with ODRIVE_I2C_ASYNC and IMU_ASYNC_BURST, the ODrive on Wire at 400 kHz in the IMU's queue instead of on Wire1
+#define I2C_MAG_BUDGET_US 300 // the magnetometer's share of Wire per tick (AsyncI2C::setBudget), with IMU_ASYNC_BURST; one 6-byte read is about 210 us
+#define I2C_ODRIVE_BUDGET_US 2000 // the ODrive's share of its bus per tick with ODRIVE_I2C_ASYNC; feedback and setpoints always go, polls past it fail for the tick
+#define I2C_BUSY_WARN_PERMILLE 800 // a bus busier than this over a tick is a warning on /diagnostics
+#define I2C_PUBLISH_PERIOD_MS 1000 // bus use of each AsyncI2C queue on /diagnostics
+#define ODRIVE_BAUD_DEFAULT 115200 // the ODrive's factory UART rate, the fallback
+#define ODRIVE_BAUD 921600 // UART rate set on (and saved to) the ODrive by connectODrive(); ODRIVE_BAUD_DEFAULT to leave it
+#define ODRIVE_BAUD_PROPERTY "config.uart_baudrate" // "config.uart_a_baudrate" from ODrive firmware 0.5.2
+#define ODRIVE_REBOOT_MS 2000 // after "sr" before the ODrive answers again, at boot; /odrive_command's reboot probes instead
+#define ODRIVE_REBOOT_QUIET_MS 100 // after a /odrive_command "sr" before the first probe, so the ODrive is down by then
+#define ODRIVE_PROBE_PERIOD_MS 20 // an "f 0" this often after a /odrive_command clear or reboot, until the ODrive answers
+#define ODRIVE_RESET_TIMEOUT_MS 5000 // no answer by then and the calibration is not started; the control step takes the link back
+#define ODRIVE_SERIAL_TX_BUFFER 2048 // bytes added to Serial1's 64-byte transmit ring, so setup()'s config burst and a tick's lines return from write() at once; 0 for the core's ring alone
+#define ODRIVE_SERIAL_RX_BUFFER 512 // and to its receive ring, for a full pipeline of replies (max_pending) arriving while the step is elsewhere
+// #define ODRIVE_SAVE_CONFIG // "ss" when setup() changed the ODrive's configuration, so the next boot writes nothing
+#define BOOT_SELF_TEST // setup() times the ODrive over each UART transport (and the build's I2C or CAN driver) and the IMU's reads, loop() rosserial's first BOOT_SELF_TEST_LINK_MS in sync (BootSelfTest); one report on /diagnostics
+#define BOOT_SELF_TEST_BUDGET_MS 250 // the setup() probes stop short once this is spent
+#define BOOT_SELF_TEST_RUNS 16 // calls of each probe
+#define BOOT_SELF_TEST_LINK_MS 500 // the link's window, the sensor stream and everything else that goes out in it
+#define TORQUE_EPSILON 1e-4f // Nm; a torque within this of the last one sent is not sent again (the ASCII line has 4 decimals)
+#define ROS_SPIN_TIMEOUT_MS 2 // spinOnce() returns after this even mid-burst, so the next /sensors sample is not held behind it
+#define TORQUE_KEEPALIVE_US 100000 // an unchanged torque is still re-sent this often
+#define SETPOINT_EPSILON 1e-3f // turns/s or turns; without TORQUE_CONTROL, TORQUE_EPSILON's counterpart for the setpoints
+#define ESTOP_BRAKE_REPEAT_MS 100 // the zero torque goes out once on the E-stop, then again this often in case a command was lost
+// #define ESTOP_RESEED // at the E-stop release, the attitude re-read from gravity and the spoke rates restarted at rest, rather than carried on from filters that ran through the stop (TorsoEstimator::reseed(), SpokeEstimator::reseed())
+#define ODRIVE_FAST_BOOT // skip the calibration states an axis already has from the ODrive's saved config (pre_calibrated offsets)
+#define ODRIVE_CAN_ENCODER_RATE_MS 1 // broadcast period of Get_Encoder_Estimates
+#define ODRIVE_ENCODER_CPR 8192 // encoder.config.cpr: MOTOR_DRIVER_BINARY and MOTOR_DRIVER_I2C read pos_estimate and pll_vel in counts, "f" and CAN in turns
+#define CALIBRATION_POLL_MS 100 // current_state reads of a calibrating axis, from controlStep()
+#define CALIBRATION_SETTLE_MS 250 // in closed loop before the spokes are zeroed
+#define PERSIST_REFERENCES // spoke zeros (an indexed axis' ODrive position) and the heading zero in EEPROM (ReferenceBlob): a boot with both axes indexed takes them instead of zeroing where the wheel stands, the first such boot stores its own
+// #define REFERENCE_RETAKE // zero at this boot's pose even over a valid blob, and store that: one boot with the wheel in its reference pose
+#define CALIBRATION_PUBLISH_PERIOD_MS 500 // progress on /diagnostics while an axis calibrates, and on every phase change
+#define ERROR_POLL_PERIOD_US 10000 // one error register per poll, see ODriveErrorMonitor
+#define ODRIVE_ERROR_HEARTBEAT_MS 1000 // /odrive_errors this often when no register changed, so the Pi can tell a quiet ODrive from a lost link
+#define ODRIVE_FAULT_RECOVERY // recoverable ODrive errors are cleared and the axis put back in closed loop from the control step, see ODriveFaultManager
+#define FAULT_VERIFY_MS 50 // after the closed-loop request, before the registers are read back
+#define FAULT_MAX_ATTEMPTS 3 // clears of one fault before it is latched
+#define CYCLE_PROFILER // DWT timing of the hot-path sections, published on /diagnostics
+#define PROFILE_PUBLISH_PERIOD_MS 1000
+#define BACKGROUND_SLICE_US 500 // of one loop() background job between two yields (Protothread); longer slices are counted on /diagnostics
+// #define TRACE_BUFFER // begin/end events of the profiler's sections into a TraceBuffer ring, frozen on a failure and dumped over SerialUSB1 under the E-stop (scripts/pull_trace.py); env:teensy40_trace
+#define TRACE_EVENTS 4096 // ring size, a power of two; 8 bytes each in DMAMEM, about 3 s at 100 Hz
+#define TRACE_POST_EVENTS 64 // still recorded after a trigger, so the tick that saw the failure is finished
+#define TRACE_TRIGGER_STATUS (raspi_pkg::SensorState::STATUS_ESTOP | raspi_pkg::SensorState::STATUS_ODRIVE_ERROR | raspi_pkg::SensorState::STATUS_FEEDBACK_STALE | raspi_pkg::SensorState::STATUS_OVERRUN) // /sensors status bits that freeze the trace; the E-stop's release re-arms it
+// #define CPU_CLOCK_PROFILES // CPU_IDLE_HZ while the E-stop is engaged, CPU_RUN_MODE's clock otherwise, switched between steps (CpuClock); mode and cycle budget on /diagnostics
+#define CPU_IDLE_HZ 396000000 // low enough to save power, high enough that a step still fits the period
+#define CPU_NOMINAL_HZ 600000000
+#define CPU_BOOST_HZ 816000000 // raises the core voltage; above 912 MHz the chip needs a heat sink
+#define CPU_RUN_MODE CpuClock::NOMINAL // CpuClock::BOOST for heavier on-board inference
+#define CPU_MAX_TEMP_C 85.0f // die temperature at which BOOST falls back to nominal
+#define CPU_SWITCH_MARGIN_US 500 // a switch needs this much of the gap before the next step
+#define MEMORY_PUBLISH_PERIOD_MS 5000 // RAM1/RAM2 use, stack high-water and heap on /diagnostics; -D HEAP_GUARD (env:teensy40_heapguard) counts the allocations
+#define STACK_RESERVE_BYTES 8192 // less stack than this left below the high-water is a warning
+#define CPU_LOAD // share of each window in the control step, in loop() passes that did work and in passes that only polled (CpuLoad), on /diagnostics
+#define CPU_LOAD_WINDOW_MS 1000 // load is the last whole window's; under 5 s, the cycle counter's span at 816 MHz
+#define CPU_LOAD_IDLE_MARGIN_US 5 // a loop() pass at most this much slower than the cheapest one did no work
+#define CPU_LOAD_WARN_PERMILLE 900 // a window busier than this is a warning on /diagnostics
+#define CPU_LOAD_BACKGROUND_PERMILLE 700 // optional background work (SPECTRUM_MONITOR's service) waits while the last window was busier than this
+#define LOOP_TIMING_BIN_US 20 // period histogram resolution, 16 bins around the control period
+#define LOOP_DEADLINE_TOLERANCE_US 500 // a period longer than the control period + this is a deadline miss
+#define HEALTH_SUMMARY // the counters above, as their publishers take them, in one "health" status on /diagnostics every PROFILE_PUBLISH_PERIOD_MS with the worst level of the others and what set it (HealthMonitor); with FLIGHT_RECORDER also a FlightHealthRecord in the log
+// #define COMMAND_LATENCY // sample-to-torque latency of the off-board controller, which echoes the /sensors seq in /torso_command's header.frame_id; on /diagnostics
+#define COMMAND_LATENCY_BIN_US 1000 // histogram resolution, 16 bins from zero
+#define COMMAND_TIMEOUT_US 50000 // a /torso_command torque older than this falls to zero (STATUS_COMMAND_TIMEOUT)
+// #define COMMAND_INTERPOLATE // ramp between the last two /torso_command torques over their arrival interval instead of holding the newest
+// SUPERVISED_CONTROL (BUILD_PROFILE_SUPERVISED): /torso_command is a TorsoStabilizer setpoint, position[0] the torso angle, velocity[0] its rate, effort[] {feed-forward, kp, kd}
+#define SUPERVISED_DEFAULT_KP 0.0f // Nm/rad; a setpoint with a position[0] but no effort[1] gets these gains
+#define SUPERVISED_DEFAULT_KD 0.0f // Nm s/rad
+#define SUPERVISED_FALLBACK_KP 2.0f // Nm/rad; the torso held at the last target angle with these once the setpoints time out (COMMAND_TIMEOUT_US)
+#define SUPERVISED_FALLBACK_KD 0.2f // Nm s/rad
+#define SUPERVISED_MAX_KP 10.0f // a setpoint's gains are clamped to these
+#define SUPERVISED_MAX_KD 1.0f
+#define ONBOARD_PBC_SATURATION 1.0f // satu in evaluatePbc.jl
+// #define WEIGHT_UPLOAD // new weights for the on-board NeuralPBC without a reflash: a .pbcw in raspi_pkg/WeightChunk pieces on /weight_upload (scripts/upload_weights.py), staged and swapped in between two steps once whole and checked; each chunk answered on /diagnostics
+// #define ONBOARD_PBC_BAYESIAN 10 // instead marginalize over this many posterior samples, as bayesianPBC.jl does
+// #define ONBOARD_PBC_BAYESIAN_QUASI // draw the bank in setup() from scrambled Halton points in antithetic pairs (drawQuasi()), instead of the exported iid one
+#define ONBOARD_PBC_BAYESIAN_CHUNK 2 // samples per batch; the adaptive count below works in whole chunks
+#define ONBOARD_PBC_BAYESIAN_TOLERANCE 0.02f // Nm; a tick stops once the standard error of its mean torque is this small; 0 runs every sample
+#define ONBOARD_PBC_BAYESIAN_MIN_SAMPLES 4
+#define ONBOARD_PBC_BAYESIAN_MAX_SAMPLES 10 // an ordinary tick's budget; one with an impact coming runs the whole bank
+#define ONBOARD_PBC_BAYESIAN_IMPACT_MARGIN 0.05f // rad; a stance spoke this close to +-alpha is an impact coming
+// #define ONBOARD_PBC_SCHEDULED // instead blend the networks of the schedule below by the forward speed, lib/NeuralPBC/ScheduledPBC.h
+#define ONBOARD_PBC_SCHEDULE_TAU 0.5f // s, low-pass on the forward speed the schedule reads, so the blend does not follow each step
+// #define ONBOARD_PBC_SCHEDULE_TERRAIN // with TERRAIN_ESTIMATOR, schedule on the incline predicted for the next touchdown instead, knots in rad
+#define PBC_ELU_EXACT 1 // expm1f from libm
+#define PBC_ELU_FAST  2 // pbc::FastElu, a quartic 2^x within 4e-6 of expm1f
+#define PBC_FIXED     3 // FixedPBC: int16 weights and Q16 activations, error in the weights header; not with ONBOARD_PBC_BAYESIAN
+#define PBC_SPARSE    4 // SparsePBC: the weights header's straight-line pass, pruned by exportWeights.py --prune, error in the header; not with ONBOARD_PBC_BAYESIAN
+#define ONBOARD_PBC_INFERENCE PBC_ELU_EXACT
+// #define ONBOARD_PBC_FAST_TRIG // input layer sin/cos from pbc::FastTrig polynomials instead of libm, within 1e-7; time pbc/input_layer* on the board
+#define IMU_MODE_POLL       1 // getEvent() on every sensor each tick
+#define IMU_MODE_DATA_READY 2 // burst read on the LSM6DSOX INT1 data-ready line, only fresh samples are fused
+#define IMU_MODE_FIFO       3 // gyro+accel batched in the LSM6DSOX FIFO at IMU_FIFO_RATE, all fused each tick
+#define IMU_MODE_BURST      4 // one 12-byte gyro+accel register burst per tick, calibration folded into imuTransform
+#define IMU_MODE IMU_MODE_POLL
+// #define IMU_ASYNC_BURST // IMU_MODE_BURST without blocking: the burst runs on LPI2C1 during the encoder exchange
+#define IMU_INT1_PIN 2 // LSM6DSOX INT1, for IMU_MODE_DATA_READY
+// #define WHEEL_IMU // a second LSM6DSOX on spoke 0's hub, on Wire1: its burst runs beside the torso's (ImuArray), its axle rate is a fifth MODEL_EKF measurement and the SPOKE_VEL_WHEEL_IMU rate; needs IMU_ASYNC_BURST
+#define WHEEL_IMU_DIRECTION 1.0f // the sign that makes the hub's x rate read as spoke 0's rate with the torso held; mounted with x along the axle like the torso's
+#define WHEEL_IMU_GYRO_RANGE LSM6DS_GYRO_RANGE_1000_DPS // the wheel turns faster than the torso rocks
+#define WHEEL_IMU_ACCEL_RANGE LSM6DS_ACCEL_RANGE_8_G // gyro bias tracking only, but a touchdown hits the hub first
+#define CALIBRATION_BLOB // IMU calibration from a CRC-checked CalibrationBlob in EEPROM; the SD JSON file only when there is none, and then copied in
+// #define CALIBRATION_REIMPORT // take the SD file even over a valid blob, and store it: one boot after a new MotionCal calibration
+#define IMU_FIFO_RATE LSM6DS_RATE_833_HZ // or LSM6DS_RATE_1_66K_HZ
+#define IMU_FIFO_TIMESTAMPS // integrate FIFO samples over the sensor's own timestamps
+#define IMU_FIFO_MAX_SAMPLES 32 // per tick; 1.66 kHz at 100 Hz needs 17
+// #define IMU_FIFO_DECIMATE // in IMU_MODE_FIFO, the torso rate (and the flight record's gyro and accel) from each tick's batch through a FirDecimator instead of the newest raw sample
+// #define IMU_FIFO_BATCH_CALIBRATE // in IMU_MODE_FIFO, each tick's drain calibrated in one pass (imu_apply_batch) before the fusion instead of sample by sample; imu_transform/* of env:teensy40_bench weigh the two
+#define IMU_FIFO_DECIMATE_HZ 40.0f // anti-aliasing cutoff, below the control rate's Nyquist
+#define IMU_FIFO_DECIMATE_TAPS 33 // linear phase, (TAPS-1)/2 samples of delay: 9.6 ms at 1.66 kHz, 19 ms at 833 Hz
+// #define SPECTRUM_MONITOR // the accel magnitude of every IMU sample through a Goertzel band bank (SpectrumMonitor) from loop(), for drivetrain wear; band powers on /diagnostics
+#define SPECTRUM_BANDS_HZ {5.0f, 12.5f, 25.0f, 50.0f, 100.0f, 200.0f, 400.0f} // band centres; those at or above half the IMU sample rate read 0, so IMU_MODE_FIFO for the high ones
+#define SPECTRUM_BLOCK 128 // samples a block; a band is the sample rate over this wide
+#define SPECTRUM_RING 512 // samples queued for loop(), 0.3 s at 1.66 kHz
+#define SPECTRUM_BUDGET_US 200 // of each loop() pass at most; samples past the ring are dropped and counted
+#define SPECTRUM_PUBLISH_PERIOD_MS 10000
+#define IMU_ACCEL_RANGE LSM6DS_ACCEL_RANGE_2_G // the boot ranges and rates, see ImuSettings; a touchdown may clip 2 g
+#define IMU_GYRO_RANGE LSM6DS_GYRO_RANGE_250_DPS
+#if defined(SUPERVISED_CONTROL)
+  #define IMU_DATA_RATE LSM6DS_RATE_1_66K_HZ // a fresh torso rate for each step of the 1 kHz inner loop
+#else
+  #define IMU_DATA_RATE LSM6DS_RATE_104_HZ // gyro and accel ODR, IMU_FIFO_RATE in IMU_MODE_FIFO; below the control rate a tick may read the last one's sample
+#endif
+#define IMU_MAG_RANGE LIS3MDL_RANGE_4_GAUSS
+#define IMU_MAG_RATE LIS3MDL_DATARATE_1000_HZ // a fast ODR, which IMU_MAG_MODE makes 560 Hz
+#define IMU_MAG_MODE LIS3MDL_MEDIUMMODE
+// #define IMU_CONFIG_MSG // ranges and rates at run time from raspi_pkg/ImuConfig on /imu_config (the Pi's imu_config node), applied between two steps and reported on /diagnostics
+// #define MULTI_RATE_STEP // gyro+encoder+torque every tick, accel fusion and magnetometer+error poll at divided rates; needs IMU_MODE_BURST
+#define ACCEL_FUSION_DIVIDER 2 // accel correction of the filter every 2nd tick, gyro-only integration in between
+#define SLOW_TASK_DIVIDER 10 // magnetometer and ODrive error poll every 10th tick
+#define FAST_TASK_BUDGET_US 2000
+#define ACCEL_TASK_BUDGET_US 400
+#define SLOW_TASK_BUDGET_US 4000 // an ASCII error poll waits up to ODRIVE_REPLY_TIMEOUT_US
+#define GYRO_BIAS_ONLINE // track the gyro bias while the robot is held still (E-stop, wheel at rest), see GyroBiasEstimator
+#define GYRO_BIAS_STILL_SPOKE_RATE 0.02f // rad/s; both spoke rates below this is the wheel at rest
+#define TORSO_ALPHA_SAVGOL_WINDOW 5 // without MODEL_EKF, torso angular acceleration for the COM shift as a quadratic's slope over this many gyro samples; 0 differences consecutive ones
+// #define MODEL_EKF // torso angular acceleration for the COM shift from the rimless-wheel dynamics (HybridEKF) instead of from the gyro
+// #define MODEL_EKF_RATES // with MODEL_EKF, also hand the filtered torso and spoke rates to the controller
+// #define FLIGHT_RECORDER // one FlightRecord per tick to FLIGHT_LOG_SINK, written from loop() in 8 KiB blocks, with impacts, E-stop edges and ODrive error changes indexed
+#define FLIGHT_RECORDER_CS_PIN 10 // SPI chip select of the card or flash, or BUILTIN_SDCARD on a Teensy 4.1
+#define FLIGHT_RECORDER_CAPACITY_MB 512 // per run, about 23 h at 100 Hz; the flash caps it at the chip size
+// #define IMPACT_DETECTOR // with MODEL_EKF, sensed touchdowns (accel spike, spoke crossing, rate jump) jump the EKF
+#define IMPACT_ACCEL_SPIKE 15.0f // m/s^2 above the running accel magnitude
+#define IMPACT_RATE_JUMP 1.5f // rad/s between encoder samples
+// #define TERRAIN_ESTIMATOR // with IMPACT_DETECTOR, the ground's incline and obstacles from where each touchdown lands (TerrainEstimator), on /diagnostics
+#define TERRAIN_OBSTACLE 0.05f // rad; a touchdown this far off the predicted incline is an obstacle, and moves the estimate by no more
+#define TERRAIN_PUBLISH_PERIOD_MS 500
+// #define TRANSPORT_METER // with ODRIVE_ELECTRICAL_FEEDBACK, the hips' shaft work (Iq Kt w) summed each tick in microjoules and every step's cost of transport on /diagnostics (TransportMeter)
+// #define ODRIVE_VEL_ESTIMATE // spoke velocities from the ODrive's encoder estimate instead of the estimators below
+#define SPOKE_VEL_DIFF_LPF 1 // difference over samplingTime, then spokeLpf
+#define SPOKE_VEL_TRACKING 2 // VelocityEstimator alpha-beta tracking loop on micros() timestamps
+#define SPOKE_VEL_SAVGOL   3 // VelocityEstimator least-squares slope over the last SPOKE_VEL_SAVGOL_WINDOW timestamped samples
+#define SPOKE_VEL_WHEEL_IMU 4 // spoke 0 only, with WHEEL_IMU: the hub gyro's rate less the torso's, no differencing; the encoder keeps the tracking loop for MODEL_EKF
+#define SPOKE0_VEL_ESTIMATOR SPOKE_VEL_TRACKING
+#define SPOKE1_VEL_ESTIMATOR SPOKE_VEL_TRACKING
+#define SPOKE_VEL_TRACKING_BANDWIDTH_HZ 30.0f
+#define SPOKE_VEL_SAVGOL_WINDOW 6
+#define SPOKE_VEL_SAVGOL_DEGREE 2 // 1 for a line, 2 for a quadratic (no lag on constant acceleration)
+#define SPOKE0_DIRECTION  1.0f // spoke angle sign per positive motor turn; axis 0 is mirrored, as in ActuatorModel::command()
+#define SPOKE1_DIRECTION -1.0f
+// #define ACTUATOR_JOINT_TORQUE // controller torques are at the spoke and go through the gear ratio and ACTUATOR_EFFICIENCY; the trained weights output motor torque
+#define ACTUATOR_EFFICIENCY 1.0f // of the gearing, for ACTUATOR_JOINT_TORQUE and the feed-forward; never measured
+#define ACTUATOR_SATURATION 2.0f // Nm; every controller torque is clamped here before the gearing, satu in bayesianPBC.jl
+#define TORQUE_LIMIT 2.0f // Nm at the motor, whatever the controller sent; 0 for none
+#define TORQUE_FADE_SPEED 0.0f // rad/s of spoke at which TORQUE_LIMIT has fallen linearly to zero; 0 for a flat limit
+#define TORQUE_SLEW_LIMIT 100.0f // Nm/s, a torque step of at most 1 Nm per 10 ms tick; 0 for none
+// #define SPOKE_CONTACT_ANGLE // the on-board PBC sees the stance spoke's angle in [-alpha, alpha) instead of the angle since start-up
+#define STANCE_HYSTERESIS 0.01f // rad past +-alpha before SPOKE_CONTACT_ANGLE moves to the next spoke (StanceTracker)
+
+// lib/RobotModel, shared with the EKF model, the impact map and the host tools
+typedef RimlessWheelModel Robot;
+constexpr float m1 = Robot::m1;
+constexpr float m2 = Robot::m2;
+constexpr float l1 = Robot::l1;
+constexpr float l2 = Robot::l2;
+constexpr float I1 = Robot::I1;
+constexpr float I2 = Robot::I2;
+constexpr float mt = Robot::mt;
+constexpr float W = Robot::W;
+constexpr float g  = Robot::g;
+constexpr float incline = Robot::incline;
+constexpr float k = Robot::k;
+constexpr float alpha = Robot::alpha;
+constexpr float torqueConstant = Robot::torqueConstant;
+
+// controller and model torques to the motors, and the encoders' signs
+#if defined(ACTUATOR_JOINT_TORQUE)
+  constexpr ActuatorModel<Robot> actuator(true, ACTUATOR_EFFICIENCY, ACTUATOR_SATURATION, SPOKE0_DIRECTION, SPOKE1_DIRECTION);
+#else
+  constexpr ActuatorModel<Robot> actuator(false, ACTUATOR_EFFICIENCY, ACTUATOR_SATURATION, SPOKE0_DIRECTION, SPOKE1_DIRECTION);
+#endif
+
+#if defined(MODEL_EKF)
+  #include "RimlessWheelModel.h"
+  #if defined(WHEEL_IMU)
+    typedef RimlessWheelHubGyro EkfModel;
+  #else
+    typedef RimlessWheel EkfModel;
+  #endif
+  HybridEKF<EkfModel> ekf;
+  bool ekfStarted = false; // (re)initialized from the first measurement, e.g. after an E-stop
+  float modelTorsoAlpha = 0.0f; // about the IMU x axis, rad/s^2
+#endif
+
+#if defined(ONBOARD_PBC_BAYESIAN) && ONBOARD_PBC_INFERENCE == PBC_FIXED
+  #error "PBC_FIXED quantizes one network, the posterior bank runs in float (PBC_ELU_FAST for speed)"
+#endif
+
+#if defined(ONBOARD_PBC_BAYESIAN) && ONBOARD_PBC_INFERENCE == PBC_SPARSE
+  #error "PBC_SPARSE is one network's pass, the posterior bank reads its samples from memory (PBC_ELU_FAST for speed)"
+#endif
+#if defined(ONBOARD_PBC_SCHEDULED) && (defined(ONBOARD_PBC_BAYESIAN) || ONBOARD_PBC_INFERENCE == PBC_FIXED || ONBOARD_PBC_INFERENCE == PBC_SPARSE)
+  #error "ONBOARD_PBC_SCHEDULED blends float networks, undefine ONBOARD_PBC_BAYESIAN and pick PBC_ELU_EXACT or PBC_ELU_FAST"
+#endif
+#if defined(WEIGHT_UPLOAD) && (!defined(ONBOARD_PBC) || defined(ONBOARD_PBC_BAYESIAN) || defined(ONBOARD_PBC_SCHEDULED) || ONBOARD_PBC_INFERENCE == PBC_FIXED || ONBOARD_PBC_INFERENCE == PBC_SPARSE)
+  #error "WEIGHT_UPLOAD swaps one NeuralPBC's float weights: ONBOARD_PBC with PBC_ELU_EXACT or PBC_ELU_FAST, neither BAYESIAN nor SCHEDULED"
+#endif
+#if defined(COMMAND_LATENCY) && (defined(ONBOARD_PBC) || !defined(TORQUE_CONTROL))
+  #error "COMMAND_LATENCY times /torso_command torques, undefine ONBOARD_PBC and define TORQUE_CONTROL"
+#endif
+#if defined(SUPERVISED_CONTROL) && defined(COMMAND_INTERPOLATE)
+  #error "SUPERVISED_CONTROL holds the newest setpoint and closes the loop between them, undefine COMMAND_INTERPOLATE"
+#endif
+#if defined(STEP_BENCHMARK) && !defined(TORQUE_CONTROL)
+  #error "STEP_BENCHMARK steps the hip torque, define TORQUE_CONTROL"
+#endif
+#if defined(LINK_GOVERNOR) && (defined(ONBOARD_PBC) || !defined(TORQUE_CONTROL))
+  #error "LINK_GOVERNOR watches the Pi's /torso_command torques, undefine ONBOARD_PBC and define TORQUE_CONTROL"
+#endif
+#if defined(TELEOP_SHAPING) && (defined(TORQUE_CONTROL) || defined(POSITION_CONTROL))
+  #error "TELEOP_SHAPING shapes joystick velocities, undefine TORQUE_CONTROL and POSITION_CONTROL"
+#endif
+
+#if defined(IMPACT_DETECTOR)
+  #if !defined(MODEL_EKF)
+    #error "IMPACT_DETECTOR resets the HybridEKF, define MODEL_EKF"
+  #endif
+  ImpactDetector impactDetector(alpha, IMPACT_ACCEL_SPIKE, IMPACT_RATE_JUMP);
+  uint32_t ekfEvent_us = 0; // last impact the model predicted itself
+  #define IMPACT_ACCEL_SAMPLE(a, t_us) impactDetector.accelSample((a).x, (a).y, (a).z, (t_us))
+#else
+  #define IMPACT_ACCEL_SAMPLE(a, t_us) do {} while (0)
+#endif
+#if defined(TERRAIN_ESTIMATOR)
+  #if !defined(IMPACT_DETECTOR)
+    #error "TERRAIN_ESTIMATOR reads the sensed touchdowns, define IMPACT_DETECTOR"
+  #endif
+  void publishTerrain();
+  TerrainEstimator<Robot> terrain(0.3f, 0.05f, TERRAIN_OBSTACLE);
+#endif
+#if defined(TRANSPORT_METER)
+  #if !defined(ODRIVE_ELECTRICAL_FEEDBACK)
+    #error "TRANSPORT_METER integrates the measured Iq, define ODRIVE_ELECTRICAL_FEEDBACK"
+  #endif
+  void publishTransport();
+  TransportMeter<Robot> transport(STANCE_HYSTERESIS, torqueConstant);
+  float motorRate[2] = {0.0f, 0.0f}; // rad/s of each shaft, the driver's own estimate
+#endif
+#if defined(ONBOARD_PBC_SCHEDULE_TERRAIN) && !(defined(ONBOARD_PBC_SCHEDULED) && defined(TERRAIN_ESTIMATOR))
+  #error "ONBOARD_PBC_SCHEDULE_TERRAIN schedules on TerrainEstimator, define ONBOARD_PBC_SCHEDULED and TERRAIN_ESTIMATOR"
+#endif
+
+constexpr float samplingTime = BuildConfig::samplingTime;
+
+#if TORSO_ALPHA_SAVGOL_WINDOW > 0
+  #define TORSO_ALPHA_ESTIMATOR_INIT (VelocityEstimator::savitzkyGolay(TORSO_ALPHA_SAVGOL_WINDOW, 2))
+#else
+  #define TORSO_ALPHA_ESTIMATOR_INIT
+#endif
+#if ATTITUDE_ESTIMATOR == ATTITUDE_ROLL_KALMAN
+  // accel roll trusted to ~10 deg per sample, bias drifting over minutes
+  struct TorsoRoll {
+    static constexpr float period = BuildConfig::samplingTime;
+    static constexpr float q_angle = 1e-3f;
+    static constexpr float q_bias = 3e-6f;
+    static constexpr float r_angle = 3e-2f;
+    static constexpr float yaw_gain = 0.5f;
+  };
+  TorsoEstimator<RollEstimator<TorsoRoll>> torso TORSO_ALPHA_ESTIMATOR_INIT;
+#else
+  // Adafruit_Mahony's default gains at the control rate
+  struct TorsoAhrs {
+    static constexpr float period = BuildConfig::samplingTime;
+    static constexpr float two_kp = 2.0f*0.5f;
+    static constexpr float two_ki = 0.0f;
+  };
+  TorsoEstimator<MahonyFilter<TorsoAhrs>> torso TORSO_ALPHA_ESTIMATOR_INIT;
+#endif
+float torque0 = 0.0; // the hips' one logical torque, to the motors through actuator.command()
+
 bool impactOccurredBefore = false;
 
-IIR::ORDER  order  = IIR::ORDER::OD3; // Order (OD1 to OD4)
-Filter lpf = Filter(30.0, samplingTime, order);
+#if defined(ONBOARD_PBC_FAST_TRIG)
+  typedef pbc::FastTrig PbcTrig;
+#else
+  typedef pbc::ExactTrig PbcTrig;
+#endif
+#if defined(ONBOARD_PBC) && defined(ONBOARD_PBC_BAYESIAN)
+  // bayesianPBC.jl's marginalize() and satu, over a bank filled once in setup()
+  typedef pbc_weights::rw_bayesian PbcNetwork;
+  #if ONBOARD_PBC_INFERENCE == PBC_ELU_FAST
+    PosteriorBank<PbcNetwork, ONBOARD_PBC_BAYESIAN, pbc::FastElu, PbcTrig, ONBOARD_PBC_BAYESIAN_CHUNK> pbc(2.0f);
+  #else
+    PosteriorBank<PbcNetwork, ONBOARD_PBC_BAYESIAN, pbc::ExactElu, PbcTrig, ONBOARD_PBC_BAYESIAN_CHUNK> pbc(2.0f);
+  #endif
+#elif defined(ONBOARD_PBC) && defined(ONBOARD_PBC_SCHEDULED)
+  // each network used alone at its knot, m/s of forward speed, and blended in between; to
+  // add one include its weights header and list it here with its knot, in ascending order
+  #if defined(ONBOARD_PBC_SCHEDULE_TERRAIN)
+    // rad of incline; both networks were trained on the flat, list slope-trained ones here
+    const float pbcKnots[] = {-0.05f, 0.05f};
+  #else
+    const float pbcKnots[] = {0.0f, 1.0f};
+  #endif
+  #if ONBOARD_PBC_INFERENCE == PBC_ELU_FAST
+    typedef pbc::FastElu PbcElu;
+  #else
+    typedef pbc::ExactElu PbcElu;
+  #endif
+  ScheduledPBC<PbcElu, PbcTrig, pbc_weights::deterministic_hardware,
+               pbc_weights::deter_hardware_even_1mpers> pbc(pbcKnots, ONBOARD_PBC_SATURATION);
+  float pbcSchedule = 0.0f; // the forward speed, low-passed over ONBOARD_PBC_SCHEDULE_TAU, or the predicted incline
+#elif defined(ONBOARD_PBC)
+  // same network and clamp as julia_pkg/src/evaluatePbc.jl; to swap controllers include
+  // another lib/NeuralPBC/weights header (exportWeights.py) and change this type
+  typedef pbc_weights::deter_hardware_even_1mpers PbcNetwork;
+  #if ONBOARD_PBC_INFERENCE == PBC_FIXED
+    FixedPBC<PbcNetwork, PbcTrig> pbc(ONBOARD_PBC_SATURATION);
+  #elif ONBOARD_PBC_INFERENCE == PBC_SPARSE
+    SparsePBC<PbcNetwork, pbc::ExactElu, PbcTrig> pbc(ONBOARD_PBC_SATURATION);
+  #elif ONBOARD_PBC_INFERENCE == PBC_ELU_FAST
+    NeuralPBC<PbcNetwork, pbc::FastElu, PbcTrig> pbc(ONBOARD_PBC_SATURATION);
+  #else
+    NeuralPBC<PbcNetwork, pbc::ExactElu, PbcTrig> pbc(ONBOARD_PBC_SATURATION);
+  #endif
+#endif
+
+// The control step runs from the timer interrupt; loop() only does ROS and Serial I/O
+ControlScheduler controlScheduler(BuildConfig::controlPeriod_us);
+// Debug text once setup() is done: callers, ISRs included, only queue it; loop() writes
+// it out when the USB serial has room, so nothing waits on the link rosserial shares
+DeferredLog debugLog(Serial);
+// One tick's sample, built by controlStep()'s sensing stage and read from then on by the
+// controller, the flight recorder and (through sensorSnapshot) the /sensors publisher in
+// loop(); nothing keeps a pointer into the sensing functions' state
+struct SensorSnapshot {
+  uint32_t seq; // /sensors seq, one per tick
+  uint32_t stamp_us;
+  float torso[3]; // roll, omega, yaw
+  float spoke[4]; // angle 0, angle 1, rate 0, rate 1
+  uint8_t status;
+  float current[2]; // Iq_measured, A; 0 without ODRIVE_ELECTRICAL_FEEDBACK
+  float vbus; // V
+};
+SeqSnapshot<SensorSnapshot> sensorSnapshot;
+#if defined(SENSOR_EVENTS)
+  volatile uint32_t sensorEventSeq = 0; // the seq of the last sample an event asked to send at once
+#endif
+#if defined(SENSOR_BATCH)
+  // every SENSOR_DECIMATION-th snapshot, SENSOR_BATCH of them to a /sensors_batch message
+  SampleBatcher<SensorSnapshot, raspi_pkg::SensorBatch::MAX_SAMPLES> sensorBatcher(SENSOR_BATCH, SENSOR_DECIMATION);
+  void publishSensorBatch(const SampleBatcher<SensorSnapshot, raspi_pkg::SensorBatch::MAX_SAMPLES>::Batch& batch);
+#endif
+#if defined(SENSOR_DELTA)
+  DeltaEncoder sensorEncoder(raspi_pkg::SensorDelta::NUM_CHANNELS, SENSOR_DELTA_KEYFRAME);
+  void publishSensorDelta(const SensorSnapshot* samples, uint8_t count, uint8_t stride);
+#endif
+volatile bool estopActive = false;
+volatile bool estopLatched = false; // set by estopIsr() on the press, taken by the next estop()
+volatile bool feedbackStale = false;
+#if !defined(TORQUE_CONTROL)
+  // the latest targets, sent from computeTorque() through torqueOutput like a torque
+  volatile float velocityCommand[2] = {0.0f, 0.0f};
+  #if defined(POSITION_CONTROL)
+    volatile float positionCommand[2] = {0.0f, 0.0f};
+    volatile bool positionCommandValid = false; // no target before the first /torso_command
+  #endif
+#endif
+#if defined(TELEOP_SHAPING)
+  TeleopShaper::Config teleopConfig(float scale) {
+    TeleopShaper::Config config = {TELEOP_DEADBAND, TELEOP_EXPO, scale, TELEOP_RATE_LIMIT, TELEOP_TIMEOUT_MS*1000ul, 0, {}};
+    #if defined(TELEOP_CURVE)
+      const float curve[] = TELEOP_CURVE;
+      static_assert(sizeof(curve)/sizeof(curve[0]) <= TeleopShaper::MAX_POINTS, "TELEOP_CURVE has too many points");
+      config.points = sizeof(curve)/sizeof(curve[0]);
+      for (uint8_t i = 0; i < config.points; ++i) config.curve[i] = curve[i];
+    #endif
+    return config;
+  }
+  // in place of velocityCommand: the sticks shaped as they arrive and rate limited in the control step, axis 0 mirrored
+  TeleopShaper teleopShaper[2] = {TeleopShaper(teleopConfig(-MOTOR_VELOCITY_LIMIT)),
+                                  TeleopShaper(teleopConfig(MOTOR_VELOCITY_LIMIT))};
+#endif
+#if defined(TRAJECTORY_PLAYBACK)
+  // an uploaded trajectory, while one plays, takes over from the /torso_command targets
+  TrajectoryBuffer trajectory;
+  void receiveTrajectory(const TrajectoryView &msg);
+  // read in place from nh's input buffer and copied straight into the ring
+  ros::Subscriber<TrajectoryView> trajectorySub(TRAJECTORY_SUBSCRIBER_NAME, &receiveTrajectory);
+#endif
+#if defined(TELEOP_MSG)
+  void receiveTeleop(const raspi_pkg::Teleop &msg);
+  ros::Subscriber<raspi_pkg::Teleop> teleop(TELEOP_SUBSCRIBER_NAME, &receiveTeleop);
+#endif
+#if defined(IMU_CONFIG_MSG)
+  void receiveImuConfig(const raspi_pkg::ImuConfig &msg);
+  ros::Subscriber<raspi_pkg::ImuConfig> imuConfigSub(IMU_CONFIG_SUBSCRIBER_NAME, &receiveImuConfig);
+  void publishImuConfig();
+  // what the last /imu_config did, published from loop()
+  enum ImuConfigResult : uint8_t { IMU_CONFIG_APPLIED, IMU_CONFIG_REJECTED, IMU_CONFIG_FAILED };
+  volatile ImuConfigResult imuConfigResult = IMU_CONFIG_APPLIED;
+  volatile bool imuConfigChanged = false;
+#endif
+#if defined(WEIGHT_UPLOAD)
+  // staged beside the weights pbc runs on, which start as the compiled-in ones
+  WeightUpload<PbcNetwork> weightUpload;
+  void receiveWeightChunk(const WeightChunkView &msg);
+  ros::Subscriber<WeightChunkView> weightUploadSub(WEIGHT_UPLOAD_SUBSCRIBER_NAME, &receiveWeightChunk);
+  void publishWeightUpload();
+  bool weightUploadAnswer = false; // a chunk came in, its acknowledgement goes out from loop()
+#endif
+
+// Round-robin error polling; errorValues holds the non-zero registers of the last /odrive_errors
+ODriveErrorMonitor errorMonitor(ODrive, ERROR_POLL_PERIOD_US);
+int64_t errorValues[ODriveErrorMonitor::NUM_REGISTERS];
+#if defined(ODRIVE_FAULT_RECOVERY)
+  // steps on the control ticks the monitor does not poll, one ODrive line at most
+  ODriveFaultManager faultManager(ODrive, errorMonitor, FAULT_VERIFY_MS*1000, FAULT_MAX_ATTEMPTS);
+#endif
+
+// Control-loop transport; setup writes and error polling stay on the ASCII UART
+#if MOTOR_DRIVER == MOTOR_DRIVER_BINARY
+  ODriveBinaryDriver motorDriver(ODriveFast, ODRIVE_ENCODER_CPR);
+#elif MOTOR_DRIVER == MOTOR_DRIVER_I2C
+  #if defined(ODRIVE_I2C_SHARED_BUS)
+    // one queue for all three devices: the IMU burst and ODrive exchange ahead of the polls
+    AsyncI2C &odriveAsync = imuAsync;
+    ODriveI2CDriver motorDriver(Wire, 0, 400000, ODRIVE_ENCODER_CPR, &odriveAsync);
+  #elif defined(ODRIVE_I2C_ASYNC)
+    // above the control step's 192, so the step can join the feedback batch
+    AsyncI2C odriveAsync(IMXRT_LPI2C3, IRQ_LPI2C3);
+    ODriveI2CDriver motorDriver(Wire1, 0, 1000000, ODRIVE_ENCODER_CPR, &odriveAsync);
+  #else
+    ODriveI2CDriver motorDriver(Wire1, 0, 1000000, ODRIVE_ENCODER_CPR);
+  #endif
+#elif MOTOR_DRIVER == MOTOR_DRIVER_CAN
+  // node ids 0 and 1; the ODrive's can.config.baud_rate must be set (and saved) to 1 Mbit/s
+  ODriveCANDriver motorDriver(0, 1, 1000000, 3000*ODRIVE_CAN_ENCODER_RATE_MS);
+#else
+  ODriveAsciiDriver motorDriver(ODrive, ODRIVE_REPLY_TIMEOUT_US);
+#endif
+// Both axes' calibration states, stepped from controlStep() so loop() keeps ROS going
+AxisCalibration calibration(motorDriver, CALIBRATION_POLL_MS, CALIBRATION_SETTLE_MS);
+volatile bool calibrationChanged = false;
+volatile bool zeroAfterCalibration = false; // the boot calibration, then spokes.zero() and torso.zeroYaw()
+#if defined(PERSIST_REFERENCES)
+  ReferenceBlob references; // valid() if setup() loaded one
+  bool axisIndexed[2] = {false, false}; // encoder.config.use_index: once calibrated the position is absolute
+  float takenReferences[3]; // the zeros the boot took itself, spoke 0 and 1 in motor turns and the heading
+  volatile bool referencesTaken = false; // and loop() is to store them
+#endif
+// Only changed torques go out, and an unchanged one every TORQUE_KEEPALIVE_US; without
+// TORQUE_CONTROL the same for the velocity or position setpoints and their feed-forward
+#if defined(TORQUE_CONTROL)
+  TorqueOutput torqueOutput(TORQUE_EPSILON, TORQUE_KEEPALIVE_US);
+  // the motor torques' last word: saturation, torque-speed line and slew, lib/ControlLoop
+  struct TorqueLimits {
+    static constexpr float max        = TORQUE_LIMIT;
+    static constexpr float fade_speed = TORQUE_FADE_SPEED;
+    static constexpr float slew       = TORQUE_SLEW_LIMIT;
+    static constexpr float ts         = samplingTime;
+  };
+  TorqueLimiter<TorqueLimits> torqueLimiter;
+#else
+  TorqueOutput torqueOutput(SETPOINT_EPSILON, TORQUE_KEEPALIVE_US, TORQUE_EPSILON);
+  void commandSetpoints(const float* torsoStates);
+#endif
+
+// Calibrated magnetometer in uT, kept over failed or skipped reads
+Vec3 imuMag;
+#if defined(GYRO_BIAS_ONLINE)
+  GyroBiasEstimator gyroBias;
+  bool wheelAtRest = false; // from the last tick's spoke rates, read after the IMU
+#endif
+#if IMU_MODE == IMU_MODE_POLL
+  ImuTransform imuEventTransform; // the calibration alone, for getEvent()'s SI values
+#endif
+#if defined(SPECTRUM_MONITOR)
+  constexpr float spectrumBandsHz[] = SPECTRUM_BANDS_HZ;
+  // the rate comes with the IMU settings in setup()
+  SpectrumMonitor<sizeof(spectrumBandsHz)/sizeof(spectrumBandsHz[0]), SPECTRUM_RING>
+    spectrum(spectrumBandsHz, BuildConfig::controlRateHz, SPECTRUM_BLOCK);
+#endif
+
+// The rate fuseImuSample() gets accel samples at, in the IMU mode and settings built
+float imuAccelRate() {
+  #if IMU_MODE == IMU_MODE_FIFO
+    return lsm6ds_rate_hz(imuSettings.rate);
+  #elif IMU_MODE == IMU_MODE_DATA_READY
+    return fminf(lsm6ds_rate_hz(imuSettings.rate), (float)BuildConfig::controlRateHz);
+  #elif defined(MULTI_RATE_STEP)
+    return (float)BuildConfig::controlRateHz/ACCEL_FUSION_DIVIDER;
+  #else
+    return (float)BuildConfig::controlRateHz;
+  #endif
+}
+#if defined(IMU_FIFO_DECIMATE)
+  // gyro xyz and accel xyz of every FIFO sample, read once a tick at the control rate
+  FirDecimator<6, IMU_FIFO_DECIMATE_TAPS> imuDecimator(IMU_FIFO_DECIMATE_HZ, lsm6ds_rate_hz(IMU_FIFO_RATE));
+#endif
+
+#if defined(FLIGHT_RECORDER)
+  #if FLIGHT_LOG_SINK == FLIGHT_LOG_SPIFLASH
+    Adafruit_FlashTransport_SPI flashTransport(FLIGHT_RECORDER_CS_PIN, SPI);
+    Adafruit_SPIFlash flash(&flashTransport);
+    SpiFlashLog flightLog(flash);
+  #else
+    SdFlightLog flightLog(FLIGHT_RECORDER_CS_PIN);
+  #endif
+  FlightRecorder flightRecorder(flightLog);
+  Vec3 recordGyro, recordAccel; // the last sample fuseImuSample() saw
+#endif
+
+#if defined(IMU_ASYNC_BURST) && IMU_MODE != IMU_MODE_BURST
+  #error "IMU_ASYNC_BURST is the non-blocking form of IMU_MODE_BURST"
+#endif
+#if defined(IMU_FIFO_DECIMATE) && IMU_MODE != IMU_MODE_FIFO
+  #error "IMU_FIFO_DECIMATE filters the FIFO's oversampled batches, use IMU_MODE_FIFO"
+#endif
+#if defined(IMU_FIFO_BATCH_CALIBRATE) && IMU_MODE != IMU_MODE_FIFO
+  #error "IMU_FIFO_BATCH_CALIBRATE calibrates the FIFO's batches, use IMU_MODE_FIFO"
+#endif
+#if defined(SENSOR_PUBLISH_FIXED) && !defined(PACKED_SENSOR_MSG)
+  #error "SENSOR_PUBLISH_FIXED frames the fixed-size raspi_pkg/SensorState, define PACKED_SENSOR_MSG"
+#endif
+#if defined(SENSOR_BATCH)
+  #if !defined(PACKED_SENSOR_MSG)
+    #error "SENSOR_BATCH packs raspi_pkg/SensorState samples, define PACKED_SENSOR_MSG"
+  #endif
+  static_assert(SENSOR_BATCH >= 1 && SENSOR_BATCH <= raspi_pkg::SensorBatch::MAX_SAMPLES, "SENSOR_BATCH is 1 to raspi_pkg::SensorBatch::MAX_SAMPLES");
+  static_assert((uint32_t)SENSOR_BATCH*SENSOR_DECIMATION*BuildConfig::controlPeriod_us <= 65535, "a batch spans more than the uint16 offset_us");
+#endif
+#if defined(SENSOR_EVENTS)
+  static_assert(SENSOR_EVENT_MIN_STEPS >= 1, "SENSOR_EVENT_MIN_STEPS is at least one step");
+#endif
+static_assert((int)raspi_pkg::ODriveErrors::NUM_REGISTERS == (int)ODriveErrorMonitor::NUM_REGISTERS, "raspi_pkg/ODriveErrors packs ODriveErrorMonitor's registers");
+#if defined(SENSOR_DELTA) && !defined(PACKED_SENSOR_MSG)
+  #error "SENSOR_DELTA codes raspi_pkg/SensorState samples, define PACKED_SENSOR_MSG"
+#endif
+#if defined(ODRIVE_ELECTRICAL_FEEDBACK) && MOTOR_DRIVER != MOTOR_DRIVER_BINARY && MOTOR_DRIVER != MOTOR_DRIVER_CAN
+  #error "ODRIVE_ELECTRICAL_FEEDBACK rides on the binary batch or the CAN slots, use MOTOR_DRIVER_BINARY or MOTOR_DRIVER_CAN"
+#endif
+#if defined(ODRIVE_I2C_ASYNC) && MOTOR_DRIVER != MOTOR_DRIVER_I2C
+  #error "ODRIVE_I2C_ASYNC is the queued form of MOTOR_DRIVER_I2C"
+#endif
+#if defined(ODRIVE_I2C_SHARED_BUS) && !(defined(ODRIVE_I2C_ASYNC) && defined(IMU_ASYNC_BURST))
+  #error "ODRIVE_I2C_SHARED_BUS needs every device on Wire queued: ODRIVE_I2C_ASYNC and IMU_ASYNC_BURST"
+#endif
+static constexpr uint8_t odriveBusDevice = 2; // after the IMU's two in LSM6DS_LIS3MDL.h
+static constexpr uint8_t wheelImuBusDevice = 3;
+
+#if defined(WHEEL_IMU)
+  #if !defined(IMU_ASYNC_BURST)
+    #error "WHEEL_IMU reads both IMUs as queued bursts, define IMU_ASYNC_BURST"
+  #endif
+  #if MOTOR_DRIVER == MOTOR_DRIVER_I2C && !defined(ODRIVE_I2C_ASYNC)
+    #error "WHEEL_IMU shares Wire1 with the ODrive, define ODRIVE_I2C_ASYNC (or ODRIVE_I2C_SHARED_BUS)"
+  #endif
+  // the hub's queue on LPI2C3, or the ODrive's when that is on Wire1 too
+  #if defined(ODRIVE_I2C_ASYNC) && !defined(ODRIVE_I2C_SHARED_BUS)
+    AsyncI2C &wheelImuAsync = odriveAsync;
+  #else
+    AsyncI2C wheelImuAsync(IMXRT_LPI2C3, IRQ_LPI2C3);
+  #endif
+  Adafruit_LSM6DSOX lsm6dsWheel;
+  ImuSettings wheelImuSettings;
+  ImuTransform wheelImuTransform; // the LSB scales; the zero rate is wheelGyroBias's
+  Lsm6dsBurst wheelBurst(wheelImuAsync, LSM6DS_I2CADDR_DEFAULT, wheelImuBusDevice, wheelImuTransform);
+  constexpr int torsoImu = 0, wheelImu = 1;
+  ImuArray<Lsm6dsBurst, 2> imus(torsoBurst, wheelBurst);
+  #if defined(GYRO_BIAS_ONLINE)
+    GyroBiasEstimator wheelGyroBias;
+  #endif
+#elif defined(IMU_ASYNC_BURST)
+  constexpr int torsoImu = 0;
+  ImuArray<Lsm6dsBurst, 1> imus(torsoBurst);
+#endif
+#if SPOKE0_VEL_ESTIMATOR == SPOKE_VEL_WHEEL_IMU && !defined(WHEEL_IMU)
+  #error "SPOKE_VEL_WHEEL_IMU reads the hub gyro, define WHEEL_IMU"
+#endif
+#if SPOKE1_VEL_ESTIMATOR == SPOKE_VEL_WHEEL_IMU
+  #error "the hub IMU is on spoke 0's wheel, SPOKE_VEL_WHEEL_IMU is for SPOKE0_VEL_ESTIMATOR"
+#endif
+
+#if defined(MULTI_RATE_STEP)
+  #if IMU_MODE != IMU_MODE_BURST
+    #error "MULTI_RATE_STEP reads gyro, accel and magnetometer registers separately, use IMU_MODE_BURST"
+  #endif
+  // accel and the slow task sit on different ticks so their bus time does not add up
+  uint32_t controlTick = 0;
+  RateTask fastTask("fastTask", 1, 0, FAST_TASK_BUDGET_US);
+  RateTask accelTask("accelTask", ACCEL_FUSION_DIVIDER, 0, ACCEL_TASK_BUDGET_US);
+  RateTask slowTask("slowTask", SLOW_TASK_DIVIDER, 1, SLOW_TASK_BUDGET_US);
+  RateTask* const rateTasks[3] = {&fastTask, &accelTask, &slowTask};
+  Vec3 imuAccel;
+  bool imuAccelFresh = false;
+#endif
+
+// loop()'s background work as Protothreads: each yields at its waits and between its messages,
+// so none holds a pass for long and a reboot's wait no longer stalls rosserial
+Protothread::State odriveCommandThread(Protothread& pt);
+Protothread::State telemetryThread(Protothread& pt);
+Protothread::State logThread(Protothread& pt);
+Protothread odriveCommandJob("odrive_command", odriveCommandThread, BACKGROUND_SLICE_US);
+Protothread telemetryJob("telemetry", telemetryThread, BACKGROUND_SLICE_US);
+Protothread logJob("logs", logThread, BACKGROUND_SLICE_US);
+Protothread* const backgroundJobs[3] = {&odriveCommandJob, &telemetryJob, &logJob};
+BackgroundRunner background(backgroundJobs, 3);
+// a /odrive_command press for odriveCommandThread, which clears or reboots the ODrive;
+// while it has the link the control step sends nothing and holds the spokes (STATUS_ODRIVE_RESET)
+enum OdriveRequest : uint8_t { ODRIVE_REQUEST_NONE, ODRIVE_REQUEST_CLEAR, ODRIVE_REQUEST_REBOOT };
+volatile OdriveRequest odriveRequest = ODRIVE_REQUEST_NONE;
+volatile bool odriveResetting = false;
+
+#if defined(MOTOR_DRIVER_BENCHMARK)
+  #define BENCHMARK_PRINT_EVERY 500
+  struct TransportTiming {
+    uint32_t min_us = UINT32_MAX, max_us = 0, count = 0;
+    uint64_t total_us = 0;
+    void add(uint32_t dt) {
+      if (dt < min_us) min_us = dt;
+      if (dt > max_us) max_us = dt;
+      total_us += dt;
+      ++count;
+    }
+    void print(const char* label) {
+      if (count == 0) return;
+      Serial << motorDriver.name() << ' ' << label << " us min/mean/max: " << min_us << '/'
+             << (uint32_t)(total_us/count) << '/' << max_us << '\n';
+      *this = TransportTiming();
+    }
+  };
+  TransportTiming feedbackTiming;
+  TransportTiming torqueTiming;
+#endif
+
+enum ProfileSection {
+  PROFILE_CONTROL_STEP,
+  PROFILE_READ_IMU,
+  PROFILE_READ_ENCODER,
+  PROFILE_ERROR_POLL,
+  PROFILE_COMPUTE_TORQUE,
+  PROFILE_PUBLISH_SENSORS,
+  PROFILE_SPIN_ONCE,
+  PROFILE_FUSE_IMU,
+  NUM_PROFILE_SECTIONS
+};
+const char* const profileNames[NUM_PROFILE_SECTIONS] = {
+  "controlStep", "readIMU", "readEncoder", "errorPoll", "computeTorque", "publishSensorStates", "spinOnce",
+  "fuseImuSample"
+};
+CycleProfiler profiler(profileNames, NUM_PROFILE_SECTIONS);
+#if defined(CPU_CLOCK_PROFILES)
+  CpuClock cpuClock(CPU_IDLE_HZ, CPU_NOMINAL_HZ, CPU_BOOST_HZ, CPU_MAX_TEMP_C);
+#endif
+
+// loopTimingData: 8 summary fields (see LOOP_TIMING_FIELDS) followed by the period histogram
+LoopTiming loopTiming(BuildConfig::controlPeriod_us, LOOP_TIMING_BIN_US, LOOP_DEADLINE_TOLERANCE_US);
+#define LOOP_TIMING_FIELDS "samples,misses,min_period_us,max_period_us,max_latency_us,mean_latency_us,first_bin_us,bin_us,bins"
+int64_t loopTimingData[8 + LoopTiming::num_bins];
+std_msgs::MultiArrayDimension loopTimingDim;
+uint32_t heapAtArm = 0; // heap in use when setup() hands over to the loop
+#if defined(CPU_LOAD)
+  CpuLoad cpuLoad(CPU_LOAD_WINDOW_MS*1000ul, CPU_LOAD_IDLE_MARGIN_US);
+#endif
+#if defined(HEALTH_SUMMARY)
+  HealthMonitor health;
+  // every status on /diagnostics counts towards the summary's level
+  #define HEALTH_LEVEL(status) health.level((status).level, (status).name)
+#else
+  #define HEALTH_LEVEL(status)
+#endif
+#if defined(COMMAND_LATENCY)
+  CommandLatency commandLatency(COMMAND_LATENCY_BIN_US);
+#endif
+#if defined(TORQUE_CONTROL) && !defined(ONBOARD_PBC)
+  #if defined(COMMAND_INTERPOLATE)
+    CommandQueue commandQueue(COMMAND_TIMEOUT_US, true);
+  #else
+    CommandQueue commandQueue(COMMAND_TIMEOUT_US, false);
+  #endif
+#endif
+#if defined(LINK_GOVERNOR)
+  TorsoStabilizer linkFallback(LINK_FALLBACK_KP, LINK_FALLBACK_KD, LINK_FALLBACK_KP, LINK_FALLBACK_KD);
+  CommandQueue::Setpoint linkHold = {0.0f, 0.0f, 0.0f, LINK_FALLBACK_KP, LINK_FALLBACK_KD};
+#endif
+#if defined(SUPERVISED_CONTROL)
+  TorsoStabilizer torsoStabilizer(SUPERVISED_FALLBACK_KP, SUPERVISED_FALLBACK_KD, SUPERVISED_MAX_KP, SUPERVISED_MAX_KD);
+#endif
+#if defined(STEP_BENCHMARK)
+  constexpr uint32_t stepBenchmarkRates[] = STEP_BENCHMARK_RATES_HZ;
+  constexpr uint8_t stepBenchmarkCount = sizeof(stepBenchmarkRates)/sizeof(stepBenchmarkRates[0]);
+  static_assert(stepBenchmarkCount <= StepBenchmark::max_rates, "STEP_BENCHMARK_RATES_HZ has more rates than StepBenchmark keeps");
+  StepBenchmark stepBenchmark(stepBenchmarkRates, stepBenchmarkCount, BuildConfig::controlRateHz, STEP_BENCHMARK_TORQUE,
+                              STEP_BENCHMARK_SETTLE_MS*1000ul, STEP_BENCHMARK_STEP_MS*1000ul, STEP_BENCHMARK_BAND, torqueConstant);
+  void publishBenchmark(const StepBenchmark::Result& result);
+#endif
+#if defined(TRACE_BUFFER)
+  #if !defined(USB_DUAL_SERIAL) && !defined(USB_TRIPLE_SERIAL)
+    #error "TRACE_BUFFER is dumped over SerialUSB1, build with -D USB_DUAL_SERIAL (env:teensy40_trace)"
+  #endif
+  static_assert((TRACE_EVENTS & (TRACE_EVENTS - 1)) == 0, "TRACE_EVENTS is a power of two");
+  DMAMEM TraceBuffer::Event traceEvents[TRACE_EVENTS];
+  TraceBuffer traceBuffer(traceEvents, TRACE_EVENTS, profileNames, NUM_PROFILE_SECTIONS);
+#endif
+#if defined(CYCLE_PROFILER) && defined(TRACE_BUFFER)
+  #define PROFILE_SCOPE(section) ProfileScope profileScope(profiler, section); TraceScope traceScope(traceBuffer, section)
+#elif defined(CYCLE_PROFILER)
+  #define PROFILE_SCOPE(section) ProfileScope profileScope(profiler, section)
+#elif defined(TRACE_BUFFER)
+  #define PROFILE_SCOPE(section) TraceScope traceScope(traceBuffer, section)
+#else
+  #define PROFILE_SCOPE(section)
+#endif
+
+// coefficients computed by the compiler, one channel per spoke
+struct SpokeRate {
+  static constexpr IIR::ORDER order = IIR::ORDER::OD3; // Order (OD1 to OD4)
+  static constexpr IIR::TYPE  type  = IIR::TYPE::LOWPASS;
+  static constexpr float_t    hz    = 30.0;
+  static constexpr float_t    ts    = samplingTime;
+};
+typedef SpokeEstimator<SpokeRate> Spokes;
+#define SPOKE_VEL_ESTIMATOR_INIT(m) ((m) == SPOKE_VEL_SAVGOL ? VelocityEstimator::savitzkyGolay(SPOKE_VEL_SAVGOL_WINDOW, SPOKE_VEL_SAVGOL_DEGREE) \
+                                                             : VelocityEstimator::tracking(SPOKE_VEL_TRACKING_BANDWIDTH_HZ))
+#if defined(ODRIVE_VEL_ESTIMATE)
+  #define SPOKE_VEL_METHOD(m) Spokes::RATE_DRIVER
+#else
+  #define SPOKE_VEL_METHOD(m) ((m) == SPOKE_VEL_DIFF_LPF ? Spokes::RATE_DIFF_LPF : Spokes::RATE_ESTIMATOR)
+#endif
+// angles and rates from the driver's turns, lib/RobotCore
+Spokes spokes(SPOKE_VEL_ESTIMATOR_INIT(SPOKE0_VEL_ESTIMATOR), SPOKE_VEL_METHOD(SPOKE0_VEL_ESTIMATOR),
+              SPOKE_VEL_ESTIMATOR_INIT(SPOKE1_VEL_ESTIMATOR), SPOKE_VEL_METHOD(SPOKE1_VEL_ESTIMATOR),
+              actuator.direction(0), actuator.direction(1));
+#if defined(SPOKE_CONTACT_ANGLE)
+  // the stance spoke of axis 0, lib/RobotModel
+  StanceTracker<Robot> stance(STANCE_HYSTERESIS);
+#endif
+
+COLD_CODE void setup() {
 
-void setup() {
+  MemoryBudget::paintStack(); // first, so the high-water covers everything after it
 
   nh.initNode();
+  nh.setSpinTimeout(ROS_SPIN_TIMEOUT_MS);
   nh.subscribe(motors);
   nh.subscribe(odriveCmd);
-  nh.advertise(sensors);
+  nh.subscribe(clockPing);
+  #if defined(TELEOP_MSG)
+    nh.subscribe(teleop);
+  #endif
+  #if defined(TRAJECTORY_PLAYBACK)
+    nh.subscribe(trajectorySub);
+  #endif
+  #if defined(IMU_CONFIG_MSG)
+    nh.subscribe(imuConfigSub);
+  #endif
+  #if defined(WEIGHT_UPLOAD)
+    nh.subscribe(weightUploadSub);
+  #endif
+  #if defined(SENSOR_DELTA)
+    nh.advertise(sensorDeltas);
+  #elif defined(SENSOR_BATCH)
+    nh.advertise(sensorBatches);
+  #else
+    nh.advertise(sensors);
+  #endif
   nh.advertise(odriveErrors);
+  nh.advertise(diagnostics);
+  nh.advertise(loopTimingPub);
+  nh.advertise(clockPongPub);
+
+  errorStates.values = errorValues;
+
+  loopTimingDim.label = LOOP_TIMING_FIELDS;
+  loopTimingDim.size = 8 + LoopTiming::num_bins;
+  loopTimingDim.stride = 8 + LoopTiming::num_bins;
+  loopTimingStates.layout.dim_length = 1;
+  loopTimingStates.layout.dim = &loopTimingDim;
+  loopTimingStates.data_length = 8 + LoopTiming::num_bins;
+  loopTimingStates.data = loopTimingData;
+
+  profiler.begin();
 
   // Serial output over USB
   Serial.begin(115200);
   while (!Serial) ; // wait for USB connection
+  if constexpr (BuildConfig::debugOutput) {
+    Serial << "Build profile " << buildProfileName << ", " << BuildConfig::controlRateHz << " Hz\n";
+  }
 
-  if (!cal.begin()) {
+  #if defined(CALIBRATION_BLOB) && !defined(CALIBRATION_REIMPORT)
+    bool calibrationLoaded = CalibrationBlob::load(cal);
+  #else
+    bool calibrationLoaded = false;
+  #endif
+  if (calibrationLoaded) {
+    Serial.println("Calibration loaded from EEPROM");
+  } else if (!cal.begin()) {
     Serial.println("Failed to initialize calibration helper");
   } else if (! cal.loadCalibration()) {
     Serial.println("No calibration loaded/found");
+  } else {
+    #if defined(CALIBRATION_BLOB)
+      // the file becomes the blob the next boots load
+      if (CalibrationBlob::store(cal)) Serial.println("Calibration imported into EEPROM");
+    #endif
   }
+  #if defined(PERSIST_REFERENCES) && !defined(REFERENCE_RETAKE)
+    if (ReferenceBlob::load(references)) Serial.println("Spoke and heading zeros loaded from EEPROM");
+  #endif
+  // the boot ranges and rates, which the register transform's LSB scales follow
+  imuSettings.accel_range = IMU_ACCEL_RANGE;
+  imuSettings.gyro_range = IMU_GYRO_RANGE;
+  #if IMU_MODE == IMU_MODE_FIFO
+    imuSettings.rate = IMU_FIFO_RATE;
+  #else
+    imuSettings.rate = IMU_DATA_RATE;
+  #endif
+  imuSettings.mag_range = IMU_MAG_RANGE;
+  #if defined(MULTI_RATE_STEP)
+    // read at the slow rate only, so trade the magnetometer's ODR for noise
+    imuSettings.mag_rate = LIS3MDL_DATARATE_20_HZ;
+    imuSettings.mag_mode = LIS3MDL_ULTRAHIGHMODE;
+  #else
+    imuSettings.mag_rate = IMU_MAG_RATE;
+    imuSettings.mag_mode = IMU_MAG_MODE;
+  #endif
+  imu_build_transform(cal, imuTransform, imuSettings);
+  #if defined(SPECTRUM_MONITOR)
+    spectrum.setRate(imuAccelRate());
+  #endif
+  #if IMU_MODE == IMU_MODE_POLL
+    imu_build_transform(cal, imuEventTransform, 1.0f, 1.0f, 1.0f);
+  #endif
 
   if (!init_sensors()) {
     Serial.println("Failed to find sensors");
@@ -147,288 +1178,1735 @@ void setup() {
   }
   
   pinMode(estop_in, INPUT_PULLDOWN);
+  attachInterrupt(digitalPinToInterrupt(estop_in), estopIsr, FALLING);
 
   accelerometer->printSensorDetails();
   gyroscope->printSensorDetails();
   magnetometer->printSensorDetails();
 
-  setup_sensors();
-  filter.begin(FILTER_UPDATE_RATE_HZ);
+  if (!setup_sensors(imuSettings)) {
+    Serial.println("IMU did not take the configured ranges and rates");
+  }
 
   Wire.setClock(400000); // 400KHz
+  #if defined(IMU_ASYNC_BURST)
+    imuAsync.setClock(400000);
+    imuAsync.setBudget(magBusDevice, I2C_MAG_BUDGET_US);
+    imuAsync.begin();
+    magQueued = true;
+  #endif
+  #if defined(WHEEL_IMU)
+    // the hub has no calibration file; its rate's zero is learned while the wheel is held
+    wheelImuSettings = imuSettings;
+    wheelImuSettings.gyro_range = WHEEL_IMU_GYRO_RANGE;
+    wheelImuSettings.accel_range = WHEEL_IMU_ACCEL_RANGE;
+    if (!lsm6dsWheel.begin_I2C(LSM6DS_I2CADDR_DEFAULT, &Wire1)) {
+      Serial.println("Wheel IMU not connecting");
+    } else if (!setup_lsm6ds(lsm6dsWheel, wheelImuSettings)) {
+      Serial.println("Wheel IMU did not take the configured ranges and rates");
+    }
+    imu_build_transform(wheelImuTransform, wheelImuSettings);
+    #if !defined(ODRIVE_I2C_ASYNC) || defined(ODRIVE_I2C_SHARED_BUS)
+      Wire1.setClock(400000);
+      wheelImuAsync.setClock(400000);
+      wheelImuAsync.begin();
+    #endif
+    // sharing the ODrive's queue, motorDriver.begin() starts it at the ODrive's clock
+  #endif
   
+  #if ODRIVE_SERIAL_TX_BUFFER > 0
+    odriveSerial.addMemoryForWrite(odriveTxBuffer, sizeof(odriveTxBuffer));
+  #endif
+  #if ODRIVE_SERIAL_RX_BUFFER > 0
+    odriveSerial.addMemoryForRead(odriveRxBuffer, sizeof(odriveRxBuffer));
+  #endif
   #if defined(ODRIVE_CONNECTED)
-    // ODrive uses 115200 as the baudrate
-    odriveSerial.begin(115200);
+    ODrive.setReplyTimeout(ODRIVE_REPLY_TIMEOUT_US);
+    uint32_t odriveBaud = connectODrive();
+    if (odriveBaud == 0) {
+      Serial << "ODrive not answering at " << ODRIVE_BAUD << " or " << ODRIVE_BAUD_DEFAULT << " baud\n";
+    } else {
+      Serial << "ODrive UART at " << odriveBaud << " baud\n";
+    }
+    ODriveFast.setTorqueConstant(torqueConstant);
+    #if MOTOR_DRIVER == MOTOR_DRIVER_I2C
+      motorDriver.setTorqueConstant(torqueConstant);
+      #if defined(ODRIVE_I2C_ASYNC)
+        motorDriver.setBusDevice(odriveBusDevice);
+        odriveAsync.setBudget(odriveBusDevice, I2C_ODRIVE_BUDGET_US);
+      #endif
+    #elif MOTOR_DRIVER == MOTOR_DRIVER_CAN
+      for (int axis = 0; axis < 2; ++axis) {
+        ODrive.writeIntConfig(axis, "config.can.node_id", axis);
+        ODrive.writeIntConfig(axis, "config.can.encoder_rate_ms", ODRIVE_CAN_ENCODER_RATE_MS);
+      }
+    #endif
+    if (!motorDriver.begin()) {
+      Serial << "Motor driver " << motorDriver.name() << " not responding\n";
+    }
+    #if MOTOR_DRIVER == MOTOR_DRIVER_BINARY || MOTOR_DRIVER == MOTOR_DRIVER_I2C
+      // the driver turns counts into turns with ODRIVE_ENCODER_CPR; another cpr scales every position
+      for (int axis = 0; axis < 2; ++axis) {
+        int64_t cpr = ODrive.readProperty(axis, "encoder.config.cpr");
+        if (ODrive.lastStatus() == ODriveArduino::READ_OK && cpr != ODRIVE_ENCODER_CPR) {
+          Serial << "Axis " << axis << " encoder.config.cpr is " << (long)cpr << ", not ODRIVE_ENCODER_CPR "
+                 << ODRIVE_ENCODER_CPR << '\n';
+        }
+      }
+    #endif
+    #if defined(ODRIVE_ELECTRICAL_FEEDBACK)
+      motorDriver.sampleElectrical(true);
+    #endif
 
     // odriveSerial << "sr" << "\n";
     // delay(5000);
     
-    // TODO: figure out why this returns zero. Maybe the ODrive needs a FW update?
-    odriveSerial << "r vbus_voltage\n";
-    Serial << "Vbus voltage: " << ODrive.readFloat() << '\n';
+    Serial << "Vbus voltage: " << ODrive.readFloatProperty(-1, "vbus_voltage") << '\n';
 
     Serial.println("Setting parameters...");
 
-    // set the parameters for both motors
+    // set the parameters for both motors from one table: all are read back in a few
+    // pipelined batches and only those that differ are written, so a warm boot
+    // leaves the ODrive's configuration alone
+    ODriveConfig odriveConfig;
     for (int axis = 0; axis < 2; ++axis) {
       odriveSerial << "w axis" << axis << ".error " << 0 << '\n';
-      odriveSerial << "w axis" << axis << ".controller.config.vel_limit " << MOTOR_VELOCITY_LIMIT << '\n';
-      odriveSerial << "w axis" << axis << ".motor.config.current_lim " << MOTOR_CURRENT_LIMIT << '\n';
-      // This ends up writing something like "w axis0.motor.config.current_lim 10.0\n"
+      odriveConfig.set(axis, "controller.config.vel_limit", MOTOR_VELOCITY_LIMIT);
+      odriveConfig.set(axis, "motor.config.current_lim", MOTOR_CURRENT_LIMIT);
+      #if defined(TORQUE_CONTROL)
+        odriveConfig.setInt(axis, "controller.config.control_mode", CONTROL_MODE_TORQUE_CONTROL);
+        odriveConfig.set(axis, "motor.config.torque_constant", torqueConstant);
+        odriveConfig.setInt(axis, "controller.config.enable_torque_mode_vel_limit", 0);
+      #elif defined(POSITION_CONTROL)
+        odriveConfig.setInt(axis, "controller.config.control_mode", CONTROL_MODE_POSITION_CONTROL);
+        odriveConfig.set(axis, "motor.config.torque_constant", torqueConstant);
+      #else
+        odriveConfig.setInt(axis, "controller.config.control_mode", CONTROL_MODE_VELOCITY_CONTROL);
+        odriveConfig.set(axis, "motor.config.torque_constant", torqueConstant);
+      #endif
+      odriveConfig.setInt(axis, "config.startup_closed_loop_control", 0);
     }
+    bool configured = odriveConfig.apply(ODrive);
+    Serial << "ODrive config: " << odriveConfig.count(ODriveConfig::MATCHED) << " set, "
+           << odriveConfig.count(ODriveConfig::WRITTEN) << " written\n";
+    if (!configured) {
+      odriveConfig.print(Serial);
+    }
+    #if defined(ODRIVE_SAVE_CONFIG)
+      if (odriveConfig.save(odriveSerial)) {
+        Serial.println("ODrive config saved");
+        delay(ODRIVE_REBOOT_MS);
+        if (odriveBaud != 0 && !probeODrive(odriveBaud)) {
+          Serial << "ODrive not answering after saving its config\n";
+        }
+      }
+    #endif
+
+    #if defined(BOOT_SELF_TEST)
+      // with the axes idle, so the replies are all the ODrive sends
+      runSelfTest(odriveBaud != 0);
+    #endif
 
-    // calibrate the motors
-    calibrateMotor(0);
-    calibrateMotor(1);
+    // calibrate the motors, or only enter closed loop if the saved offsets are valid;
+    // controlStep() runs the states and zeroes the spokes once both axes settled
+    startCalibration(0);
+    startCalibration(1);
+    zeroAfterCalibration = true;
 
-    delay(5000);
+    // start the round robin from a complete picture
+    readErrors();
 
-    #if defined(TORQUE_CONTROL)
-      for (int axis = 0; axis < 2; ++axis) {
-        odriveSerial << "w axis" << axis << ".controller.config.control_mode " << CONTROL_MODE_TORQUE_CONTROL << '\n';
-        odriveSerial << "w axis" << axis << ".motor.config.torque_constant " << 8.23 / 210.0 << '\n';
-        odriveSerial << "w axis" << axis << ".motor.controller.enable_torque_mode_vel_limit = False" << '\n';
+  #elif defined(BOOT_SELF_TEST)
+    runSelfTest(false);
+  #endif
+
+  #if defined(ONBOARD_PBC) && defined(ONBOARD_PBC_BAYESIAN)
+    #if defined(ONBOARD_PBC_BAYESIAN_QUASI)
+      // fixed seed, so every boot flies the same bank
+      pbc.drawQuasi(1);
+    #else
+      // the exported bank if the sizes match, otherwise draw one here
+      if (ONBOARD_PBC_BAYESIAN == PbcNetwork::num_samples) {
+        pbc.load(PbcNetwork::samples());
+      } else {
+        pbc.draw(micros());
       }
     #endif
+    pbc.setAdaptive(ONBOARD_PBC_BAYESIAN_TOLERANCE, ONBOARD_PBC_BAYESIAN_MIN_SAMPLES, ONBOARD_PBC_BAYESIAN_MAX_SAMPLES);
+  #endif
 
-    for (int axis = 0; axis < 2; ++axis) {
-        odriveSerial << "w axis" << axis << ".motor.config.startup_closed_loop_control = False" << '\n';
+  #if IMU_MODE == IMU_MODE_DATA_READY
+    // only now: the interrupt reads over Wire and setup() itself is not an interrupt
+    if (!init_data_ready(IMU_INT1_PIN)) {
+      Serial.println("Failed to route the IMU data-ready to INT1");
     }
+  #elif IMU_MODE == IMU_MODE_FIFO
+    #if defined(IMU_FIFO_TIMESTAMPS)
+      bool fifoOk = init_fifo(imuSettings.rate, true);
+    #else
+      bool fifoOk = init_fifo(imuSettings.rate, false);
+    #endif
+    if (!fifoOk) {
+      Serial.println("Failed to configure the IMU FIFO");
+    }
+  #endif
 
-    auto torsoStates = readIMU();
-    auto spokeStates = readEncoder(torsoStates);
-  
-    delay(250);
-    enc0Offset = spokeStates[0];
-    enc1Offset = spokeStates[1];
-    yawOffset = torsoStates[2];
-
-
+  #if defined(FLIGHT_RECORDER)
+    if (flightRecorder.begin(BuildConfig::controlPeriod_us, FLIGHT_RECORDER_CAPACITY_MB*1024ul*1024ul)) {
+      Serial << "Flight recorder on " << flightLog.name() << '\n';
+    } else {
+      Serial << "Flight recorder: no " << flightLog.name() << " or no space, not recording\n";
+    }
   #endif
 
-  //Keep track of time to sample the encoders and the IMU evenly
-  timestamp = millis();
+  if constexpr (BuildConfig::debugOutput) {
+    MemoryBudget::Layout layout;
+    MemoryBudget::layout(layout);
+    Serial << "RAM1: " << layout.itcm_code << " of " << layout.itcm_size << " code, " << layout.dtcm_data + layout.dtcm_bss
+           << " data, " << layout.stack_size << " stack; RAM2: " << layout.ram2_dma << " DMAMEM, " << MemoryBudget::heapUsed() << " heap\n";
+  }
+  // from here on the loop runs, and nothing should allocate
+  heapAtArm = MemoryBudget::heapUsed();
+  MemoryBudget::arm();
+
+  // sample the encoders and the IMU on a fixed microsecond grid
+  controlScheduler.begin(controlStep);
 
   Serial.println("Ready!");
 }
 
 void loop() { 
 
-  if ((millis() - timestamp) >= (1000*samplingTime)) {
-
-    timestamp = millis();
-    
-    auto torsoStates = readIMU();
-    auto spokeStates = readEncoder(torsoStates);
-    publishSensorStates(torsoStates, spokeStates);
-
-    #if defined(ODRIVE_CONNECTED)
-      if (readErrors() != 0) {
-        // TODO: clear non-critical errors
-        odriveErrors.publish(&errorStates);
+  #if defined(SENSOR_BATCH)
+    static uint32_t publishedBatch = 0;
+    static SampleBatcher<SensorSnapshot, raspi_pkg::SensorBatch::MAX_SAMPLES>::Batch batch;
+    if (sensorBatcher.read(publishedBatch, batch)) {
+      #if defined(SENSOR_DELTA)
+        publishSensorDelta(batch.samples, batch.count, sensorBatcher.stride());
+      #else
+        publishSensorBatch(batch);
+      #endif
+    }
+  #else
+    static uint32_t publishedSeq = 0;
+    static uint32_t lastPublished = 0;
+    SensorSnapshot sample;
+    // the newest sample, once SENSOR_DECIMATION steps have passed since the last one sent
+    bool fresh = sensorSnapshot.read(publishedSeq, sample);
+    bool due = fresh && (lastPublished == 0 || sample.seq - lastPublished >= SENSOR_DECIMATION);
+    #if defined(SENSOR_EVENTS)
+      // or at once from an event's sample on; read after the sample, which the event came before
+      static uint32_t handledEvent = 0;
+      uint32_t eventSeq = sensorEventSeq;
+      if (fresh && eventSeq != handledEvent && (int32_t)(sample.seq - eventSeq) >= 0) {
+        handledEvent = eventSeq;
+        due = true;
       }
     #endif
+    if (due) {
+      lastPublished = sample.seq;
+      #if defined(SENSOR_DELTA)
+        publishSensorDelta(&sample, 1, SENSOR_DECIMATION);
+      #else
+        publishSensorStates(sample.torso, sample.spoke, sample.seq, sample.stamp_us, sample.status, sample.current, sample.vbus);
+      #endif
+    }
+  #endif
 
-    computeTorque(torsoStates, spokeStates);
-  }
-  nh.spinOnce();
-
-}
+  #if defined(STEP_BENCHMARK)
+    if (stepBenchmark.pendingRate() != 0) {
+      // a rate done or the script stopped: the next period, set between two ticks
+      controlScheduler.pause();
+      StepBenchmark::Result result;
+      bool finished = stepBenchmark.takeResult(result);
+      uint32_t period_us = 1000000/stepBenchmark.pendingRate();
+      controlScheduler.setPeriod(period_us);
+      loopTiming.setPeriod(period_us);
+      stepBenchmark.rateApplied();
+      controlScheduler.resume();
+      if (finished) publishBenchmark(result);
+    }
+  #endif
 
-void computeTorque(const float* torsoStates, const float* spokeStates){
-  if (estop()){
-      brake();
-      while (estop()) {
+  #if defined(IMU_CONFIG_MSG)
+    if (imuConfigChanged) {
+      imuConfigChanged = false;
+      publishImuConfig();
+    }
+  #endif
 
-        commandTorque(0, 0);
-        commandTorque(1, 0);
+  #if defined(WEIGHT_UPLOAD)
+    if (weightUploadAnswer) {
+      weightUploadAnswer = false;
+      publishWeightUpload();
+    }
+  #endif
 
-        auto getTorsoStates = readIMU();
-        auto getSpokeStates = readEncoder(getTorsoStates);
+  #if defined(CPU_CLOCK_PROFILES)
+    cpuClock.request(estopActive ? CpuClock::IDLE : CPU_RUN_MODE);
+    // only in the gap after a step: the core crawls while the PLL relocks
+    int32_t gap_us = (int32_t)(controlScheduler.period_us() - controlScheduler.lastDuration_us())
+                   - (int32_t)(micros() - controlScheduler.lastEnd_us());
+    if (cpuClock.due() && gap_us > CPU_SWITCH_MARGIN_US && cpuClock.update()) {
+      // what converts cycles to microseconds
+      loopTiming.setClock(F_CPU_ACTUAL);
+      #if defined(CPU_LOAD)
+        cpuLoad.setClock(F_CPU_ACTUAL);
+      #endif
+      #if defined(MULTI_RATE_STEP)
+        for (RateTask* task : rateTasks) task->setClock(F_CPU_ACTUAL);
+      #endif
+      background.setClock(F_CPU_ACTUAL);
+      profiler.reset();
+      publishCpuClock();
+    }
+    static uint32_t cpuClockStamp = millis();
+    if (millis() - cpuClockStamp >= PROFILE_PUBLISH_PERIOD_MS) {
+      cpuClockStamp += PROFILE_PUBLISH_PERIOD_MS;
+      publishCpuClock();
+    }
+  #endif
 
-        publishSensorStates(getTorsoStates, getSpokeStates);
+  #if defined(SPECTRUM_MONITOR)
+    // in what is left of the pass, after the sensor sample went out; the ring holds what waits
+    #if defined(CPU_LOAD)
+      if (cpuLoad.allows(CPU_LOAD_BACKGROUND_PERMILLE))
+    #endif
+        spectrum.service(SPECTRUM_BUDGET_US);
+  #endif
+  #if defined(PERSIST_REFERENCES)
+    if (referencesTaken) {
+      referencesTaken = false;
+      // an EEPROM write stalls flash reads, so not under a running step
+      controlScheduler.pause();
+      bool stored = ReferenceBlob::store(ReferenceBlob::pack(takenReferences, takenReferences[2]));
+      controlScheduler.resume();
+      loopTiming.restart();
+      if constexpr (BuildConfig::debugOutput) {
+        if (stored) debugLog.log("Spoke and heading zeros stored in EEPROM\n");
       }
-
-      //When the encoder wraps, and you switch the Estop off, it starts from configurations not visited by the training. So, unwrap it. 
-
-      enc0Offset = 0.0f;
-      enc1Offset = 0.0f;
-      auto getTorsoStates = readIMU();
-      auto getSpokeStates = readEncoder(getTorsoStates);
-      enc0Offset = getSpokeStates[0];
-      enc1Offset = getSpokeStates[1];
     }
-  else{
+  #endif
 
-    commandTorque(0, -1.0f*torque0);
-    commandTorque(1, 1.0f*torque1);
-  }
-}
+  // one slice of each: a pending ODrive command, the next diagnostics message that is due, the logs
+  background.pass();
 
-void receiveJointState(const sensor_msgs::JointState &msg) {
+  #if defined(LINK_SCHEDULER)
+    // after everything above has queued: the queues, status first, into the room the link has
+    linkScheduler.service(*nh.getHardware(), micros());
+  #endif
 
-  #if defined(TORQUE_CONTROL)
+  #if defined(MOTOR_DRIVER_BENCHMARK)
+    if (feedbackTiming.count >= BENCHMARK_PRINT_EVERY) {
+      feedbackTiming.print("readFeedback");
+      torqueTiming.print("setTorques");
+    }
+  #endif
 
-      ///////////// for neural net //////////////
+  #if defined(TRACE_BUFFER)
+    // like the flight log's dump, only with the motors braked
+    if (estopActive) traceBuffer.serveDump(SerialUSB1);
+  #endif
+  #if defined(FLIGHT_RECORDER)
+    #if FLIGHT_LOG_SINK == FLIGHT_LOG_SPIFLASH && (defined(USB_DUAL_SERIAL) || defined(USB_TRIPLE_SERIAL))
+      // a dump holds loop() for the transfer, so only with the motors braked
+      if (estopActive) flightLog.serveDump(SerialUSB1);
+    #endif
+  #endif
 
-      torque0 = msg.effort[0];
-      // torque1 = msg.effort[1];
-      torque1 = torque0;
-      Serial.print("Received torque command: ");
-      Serial.print(torque0);
-      Serial.print(torque1);
+  #if defined(LINK_GOVERNOR)
+    // what rosserial has yet to read and, with the scheduler, what is yet to be sent
+    uint32_t backlog = (uint32_t)max(nh.getHardware()->available(), 0);
+    #if defined(LINK_SCHEDULER)
+      backlog += linkScheduler.usedBytes(LINK_STATUS) + linkScheduler.usedBytes(LINK_TELEMETRY);
+    #endif
+    linkBacklog = backlog;
+  #endif
 
-      ///////////// for joystick ////////////////////
-      // torque0 = msg.velocity[0];
-      // torque1 = torque0;
+  {
+    PROFILE_SCOPE(PROFILE_SPIN_ONCE);
+    nh.spinOnce();
+  }
 
-    #else
-    #if defined(ODRIVE_CONNECTED)
-      float velocity0 = msg.velocity[0];
-      float velocity1 = msg.velocity[1];
-      ODrive.SetVelocity(0, -1*velocity0*MOTOR_VELOCITY_LIMIT);
-      ODrive.SetVelocity(1, velocity1*MOTOR_VELOCITY_LIMIT);
+  #if defined(BOOT_SELF_TEST)
+    // the self-test's link window, once: from the first pass in sync
+    if (!selfTest.linkDone() && nh.connected()) {
+      if (!selfTest.linkStarted()) {
+        selfTest.linkStart(millis(), nh.getHardware()->written(), nh.droppedFrames());
+      } else if (millis() - selfTest.syncMs() >= BOOT_SELF_TEST_LINK_MS) {
+        selfTest.linkEnd(millis(), nh.getHardware()->written(), nh.droppedFrames());
+        publishSelfTest();
+      }
+    }
+  #endif
 
-      #endif 
-    #endif
-  
-  return;
+  #if defined(CPU_LOAD)
+    cpuLoad.pass();
+  #endif
 }
 
-void receiveODriveCommand(const sensor_msgs::Joy &msg) {
-  if (msg.buttons[0] == 1) {
-    ODrive.SetVelocity(0, 0);
-    ODrive.SetVelocity(1, 0);
-
-    odriveSerial << "sc" << "\n";
-    delay(250);
+// The low-rate diagnostics, at most one message a pass: each publish yields to the next pass
+Protothread::State telemetryThread(Protothread& pt) {
+  // when each message was last sent, some only used by the options that publish them
+  static struct {
+    uint32_t profile, rateTasks, loopTiming, i2c, spectrum, terrain, memory, calibration, faultChanges, errors, errorChanges,
+             transportSteps, linkGovernor, linkTransitions;
+  } last = {millis(), millis(), millis(), millis(), millis(), millis(), millis(), 0, 0, millis(), 0, 0, millis(), 0};
+
+  PT_BEGIN(pt);
+  #if defined(LINK_GOVERNOR)
+    // every change, and a heartbeat while degraded
+    if (linkGovernor.transitions() != last.linkTransitions
+        || (linkGovernor.mode() != LinkGovernor::NORMAL && millis() - last.linkGovernor >= PROFILE_PUBLISH_PERIOD_MS)) {
+      last.linkTransitions = linkGovernor.transitions();
+      last.linkGovernor = millis();
+      publishLinkGovernor();
+      PT_YIELD(pt);
+    }
+  #endif
 
-    calibrateMotor(0);
-    calibrateMotor(1);
+  #if defined(CYCLE_PROFILER)
+    if (millis() - last.profile >= PROFILE_PUBLISH_PERIOD_MS) {
+      last.profile += PROFILE_PUBLISH_PERIOD_MS;
+      publishProfile();
+      PT_YIELD(pt);
+    }
+  #endif
 
-  } else if (msg.buttons[3] == 1) {
-    ODrive.SetVelocity(0, 0);
-    ODrive.SetVelocity(1, 0);
+  #if defined(MULTI_RATE_STEP)
+    if (millis() - last.rateTasks >= PROFILE_PUBLISH_PERIOD_MS) {
+      last.rateTasks += PROFILE_PUBLISH_PERIOD_MS;
+      publishRateTasks();
+      PT_YIELD(pt);
+    }
+  #endif
 
-    odriveSerial << "sr" << "\n";
-    delay(2000);
+  if (millis() - last.loopTiming >= PROFILE_PUBLISH_PERIOD_MS) {
+    last.loopTiming += PROFILE_PUBLISH_PERIOD_MS;
+    publishLoopTiming();
+    PT_YIELD(pt);
+    publishBackground();
+    #if defined(CPU_LOAD)
+      PT_YIELD(pt);
+      publishCpuLoad();
+    #endif
+    #if defined(COMMAND_LATENCY)
+      PT_YIELD(pt);
+      publishCommandLatency();
+    #endif
+    #if defined(LINK_SCHEDULER)
+      PT_YIELD(pt);
+      publishLink();
+    #endif
+    #if defined(HEALTH_SUMMARY)
+      // last, so the window has this pass's figures
+      PT_YIELD(pt);
+      publishHealth();
+    #endif
+    PT_YIELD(pt);
+  }
+
+  #if defined(IMU_ASYNC_BURST) || defined(ODRIVE_I2C_ASYNC)
+    if (millis() - last.i2c >= I2C_PUBLISH_PERIOD_MS) {
+      last.i2c += I2C_PUBLISH_PERIOD_MS;
+      #if defined(IMU_ASYNC_BURST)
+        publishI2CBus("i2c_wire", imuAsync, 0);
+      #endif
+      #if defined(ODRIVE_I2C_ASYNC) && !defined(ODRIVE_I2C_SHARED_BUS)
+        PT_YIELD(pt);
+        publishI2CBus("i2c_wire1", odriveAsync, 1);
+      #elif defined(WHEEL_IMU)
+        PT_YIELD(pt);
+        publishI2CBus("i2c_wire1", wheelImuAsync, 1);
+      #endif
+      PT_YIELD(pt);
+    }
+  #endif
+
+  #if defined(SPECTRUM_MONITOR)
+    if (millis() - last.spectrum >= SPECTRUM_PUBLISH_PERIOD_MS) {
+      last.spectrum += SPECTRUM_PUBLISH_PERIOD_MS;
+      publishSpectrum();
+      PT_YIELD(pt);
+    }
+  #endif
+
+  #if defined(TERRAIN_ESTIMATOR)
+    if (millis() - last.terrain >= TERRAIN_PUBLISH_PERIOD_MS) {
+      last.terrain += TERRAIN_PUBLISH_PERIOD_MS;
+      publishTerrain();
+      PT_YIELD(pt);
+    }
+  #endif
+
+  #if defined(TRANSPORT_METER)
+    // once a step; a step closed while the last was still waiting is only in the run's figure
+    if (transport.steps() != last.transportSteps) {
+      last.transportSteps = transport.steps();
+      publishTransport();
+      PT_YIELD(pt);
+    }
+  #endif
+
+  if (millis() - last.memory >= MEMORY_PUBLISH_PERIOD_MS) {
+    last.memory += MEMORY_PUBLISH_PERIOD_MS;
+    publishMemory();
+    PT_YIELD(pt);
+  }
+
+  if (calibrationChanged || (calibration.busy() && millis() - last.calibration >= CALIBRATION_PUBLISH_PERIOD_MS)) {
+    calibrationChanged = false;
+    last.calibration = millis();
+    publishCalibration();
+    PT_YIELD(pt);
+  }
 
-    calibrateMotor(0);
-    calibrateMotor(1);
+  // a persistent fault changes nothing, so it costs the link a heartbeat only
+  if (errorMonitor.changes() != last.errorChanges || millis() - last.errors >= ODRIVE_ERROR_HEARTBEAT_MS) {
+    last.errors = millis();
+    publishErrorState();
+    last.errorChanges = errorStates.changes;
+    PT_YIELD(pt);
   }
+
+  #if defined(ODRIVE_FAULT_RECOVERY)
+    if (faultManager.changes() != last.faultChanges) {
+      last.faultChanges = faultManager.changes();
+      publishFaultState();
+    }
+  #endif
+  PT_END(pt);
 }
 
-void commandTorque(int axis, float torque){
-  odriveSerial << "w axis" << axis << ".controller.input_torque " << torque << '\n';
+// DeferredLog's text and the flight log's card writes, one per pass
+Protothread::State logThread(Protothread& pt) {
+  static uint32_t reportedOverruns = 0;
+
+  PT_BEGIN(pt);
+  if constexpr (BuildConfig::debugOutput) {
+    if (controlScheduler.overruns() != reportedOverruns) {
+      reportedOverruns = controlScheduler.overruns();
+      debugLog.log("Control step overruns: {}, max {} us\n", reportedOverruns, controlScheduler.maxDuration_us());
+    }
+  }
+  #if defined(LINK_GOVERNOR)
+    // the text shares the USB port with rosserial: held in the ring while QUIET, and dropped and
+    // counted once that is full
+    if (linkGovernor.mode() < LinkGovernor::QUIET)
+  #endif
+      debugLog.service();
+  #if defined(FLIGHT_RECORDER)
+    PT_YIELD(pt);
+    // the card write happens here, between ticks, never in controlStep()
+    flightRecorder.service();
+  #endif
+  PT_END(pt);
 }
 
-bool estop(){
-  if (digitalRead(estop_in) == LOW){
-    return true;
+// sense -> estimate -> actuate, called by controlScheduler every BuildConfig::controlPeriod_us
+HOT_CODE void controlStep() {
+
+  #if defined(CPU_LOAD)
+    CpuLoadScope cpuLoadScope(cpuLoad);
+  #endif
+  PROFILE_SCOPE(PROFILE_CONTROL_STEP);
+  loopTiming.markSample();
+  #if defined(MULTI_RATE_STEP)
+    uint32_t tick = controlTick++;
+    fastTask.start();
+  #endif
+
+  // a calibrating axis gets no torque; its encoder is still read and published
+  bool calibrating = calibration.busy();
+  // odriveCommandThread has the link: no exchange, no commands, the spokes hold
+  bool resetting = odriveResetting;
+
+  // the bus budgets, and the bus use of the tick that just ended
+  #if defined(IMU_ASYNC_BURST)
+    imuAsync.beginTick();
+  #endif
+  #if defined(ODRIVE_I2C_ASYNC) && !defined(ODRIVE_I2C_SHARED_BUS)
+    odriveAsync.beginTick();
+  #elif defined(WHEEL_IMU)
+    wheelImuAsync.beginTick();
+  #endif
+
+  // for the UART drivers the replies come in over the UART while the IMU is read over I2C,
+  // with ODRIVE_I2C_ASYNC the batch goes out on Wire1 from the LPI2C3 interrupt
+  if (!resetting) motorDriver.requestFeedback();
+
+  loopTiming.markSense();
+  uint32_t stamp_us = micros();
+  #if defined(MODEL_EKF)
+    // the torque held over the last tick drives the prediction; the torso is about -x of the IMU
+    float modelTorque = estopActive ? 0.0f : torque0;
+    if (ekfStarted) {
+      float acc[2];
+      if (ekf.predict(modelTorque, samplingTime)) {
+        #if defined(IMPACT_DETECTOR)
+          ekfEvent_us = stamp_us;
+        #endif
+      }
+      RimlessWheel::accelerations(ekf.state(), modelTorque, acc);
+      modelTorsoAlpha = -acc[1];
+    }
+  #endif
+  #if defined(MULTI_RATE_STEP) && defined(IMU_ASYNC_BURST)
+    // the accel bytes ride on the gyro burst, so accelTask only counts its runs
+    bool accelDue = accelTask.due(tick);
+    imus.start(accelDue);
+    if (accelDue) accelTask.finish();
+  #elif defined(MULTI_RATE_STEP)
+    if (accelTask.due(tick)) {
+      fastTask.stop();
+      accelTask.start();
+      imuAccelFresh = accel_read_fast(imuAccel);
+      accelTask.stop();
+      accelTask.finish();
+      fastTask.start();
+    }
+  #elif defined(IMU_ASYNC_BURST)
+    imus.start(true);
+  #endif
+  SensorSnapshot snapshot;
+  snapshot.stamp_us = stamp_us;
+  float* torsoStates = snapshot.torso;
+  float* spokeStates = snapshot.spoke;
+  #if defined(IMU_ASYNC_BURST)
+    // the IMU bursts are on the wire while the encoders are exchanged; readIMU() joins the torso's
+    readEncoder(spokeStates);
+    readIMU(torsoStates);
+    #if defined(WHEEL_IMU)
+      const float hubSpokeRate = readWheelImu(torsoStates);
+      (void)hubSpokeRate; // for MODEL_EKF or SPOKE_VEL_WHEEL_IMU
+    #endif
+  #else
+    readIMU(torsoStates);
+    readEncoder(spokeStates);
+  #endif
+  snapshot.current[0] = snapshot.current[1] = snapshot.vbus = 0.0f;
+  #if defined(ODRIVE_ELECTRICAL_FEEDBACK)
+    // the last exchange's, kept through a missed one as the positions are
+    static float current[2] = {0.0f, 0.0f}, vbus = 0.0f;
+    motorDriver.readElectrical(current, vbus);
+    snapshot.current[0] = current[0];
+    snapshot.current[1] = current[1];
+    snapshot.vbus = vbus;
+  #endif
+  if (zeroAfterCalibration && !calibrating && !resetting) {
+    // the first sample in closed loop after the boot calibration
+    zeroAfterCalibration = false;
+    #if defined(PERSIST_REFERENCES)
+      // indexed positions mean the same on every boot, so an earlier boot's zeros still hold
+      bool indexed = axisIndexed[0] && axisIndexed[1];
+      if (indexed && references.valid()) {
+        spokes.zeroAt(references.spoke_zero);
+        torso.setYawOffset(references.yaw_zero);
+      } else {
+        spokes.zero();
+        torso.zeroYaw();
+        if (indexed) {
+          takenReferences[0] = spokes.position(0);
+          takenReferences[1] = spokes.position(1);
+          takenReferences[2] = torso.yawOffset();
+          referencesTaken = true;
+        }
+      }
+      spokeStates[0] = spokes.angle(0);
+      spokeStates[1] = spokes.angle(1);
+    #else
+      spokes.zero();
+      torso.zeroYaw();
+      spokeStates[0] = spokeStates[1] = 0.0f;
+    #endif
+    #if defined(SPOKE_CONTACT_ANGLE)
+      stance.reset();
+    #endif
+    #if defined(MODEL_EKF)
+      ekfStarted = false;
+    #endif
+    #if defined(TERRAIN_ESTIMATOR)
+      terrain.reset();
+    #endif
+  }
+
+  #if defined(IMPACT_DETECTOR)
+    // a touchdown the guard has not seen yet: jump the model from the sensed impact time
+    bool impactSensed = impactDetector.encoderSample(spokeStates[0], spokeStates[2], stamp_us);
+    if (impactSensed && ekfStarted && stamp_us - ekfEvent_us > 2*BuildConfig::controlPeriod_us) {
+      float late_dt = (int32_t)(stamp_us - impactDetector.impactTime_us()) * 1e-6f;
+      late_dt = late_dt < 0.0f ? 0.0f : (late_dt > 2.0f*samplingTime ? 2.0f*samplingTime : late_dt);
+      ekf.jump(modelTorque, late_dt);
+    }
+  #endif
+  #if defined(TERRAIN_ESTIMATOR)
+    // where the touchdown landed against the old spoke's +-alpha
+    terrain.update(spokeStates[0], spokeStates[2], stamp_us);
+    if (impactSensed) terrain.impact(impactDetector.touchdownTime_us());
+  #endif
+  #if defined(MODEL_EKF)
+    #if defined(WHEEL_IMU)
+      // the encoder and hub rates weighed by their noise, so the encoder's needs less filtering
+      float z[EkfModel::num_measurements] = {spokeStates[0], torsoStates[0], spokeStates[2], torsoStates[1], hubSpokeRate};
+    #else
+      float z[EkfModel::num_measurements] = {spokeStates[0], torsoStates[0], spokeStates[2], torsoStates[1]};
+    #endif
+    if (!ekfStarted) {
+      z[0] = Robot::wrapSpoke(z[0]);
+      ekf.reset(z, 0.1f);
+      ekfStarted = true;
+    } else {
+      ekf.correct(z);
+    }
+    #if defined(MODEL_EKF_RATES)
+      spokeStates[2] = ekf.state(2);
+      torsoStates[1] = ekf.state(3);
+    #endif
+  #endif
+  #if SPOKE0_VEL_ESTIMATOR == SPOKE_VEL_WHEEL_IMU && !defined(MODEL_EKF_RATES)
+    // after the EKF and the impact detector, which take the encoder's rate
+    spokeStates[2] = hubSpokeRate;
+  #endif
+
+  #if defined(ODRIVE_CONNECTED) && !defined(MULTI_RATE_STEP)
+  if (!resetting) {
+    PROFILE_SCOPE(PROFILE_ERROR_POLL);
+    if (!errorMonitor.update(micros())) {
+      #if defined(ODRIVE_FAULT_RECOVERY)
+        if (!calibrating) faultManager.update(micros(), !estopActive);
+      #endif
+    }
+  }
+  #endif
+
+  if (calibrating || resetting) {
+    // after the feedback exchange, so the state reads do not delay the sample
+    if (!resetting && calibration.update(millis())) calibrationChanged = true;
+    torqueOutput.invalidate();
+    #if defined(TORQUE_CONTROL)
+      torqueLimiter.reset();
+    #endif
+  } else {
+    computeTorque(torsoStates, spokeStates);
+  }
+  loopTiming.markActuate();
+  #if defined(COMMAND_LATENCY)
+    if (!estopActive && !calibrating && !resetting) commandLatency.applied(micros());
+  #endif
+  #if defined(STEP_BENCHMARK)
+    if (stepBenchmark.active() && !estopActive && !calibrating) {
+      #if defined(ODRIVE_ELECTRICAL_FEEDBACK)
+        stepBenchmark.measure(loopTiming.lastPeriod_us(), loopTiming.lastLatency_us(), snapshot.current);
+      #else
+        stepBenchmark.measure(loopTiming.lastPeriod_us(), loopTiming.lastLatency_us(), nullptr);
+      #endif
+    }
+  #endif
+
+  #if defined(MULTI_RATE_STEP)
+    fastTask.stop();
+    fastTask.finish();
+    // after the torque is out, so the slow bus traffic adds no sense-to-actuate latency
+    if (slowTask.due(tick)) {
+      slowTask.start();
+      mag_read_fast(imuMag);
+      #if defined(ODRIVE_CONNECTED)
+      if (!resetting) {
+        PROFILE_SCOPE(PROFILE_ERROR_POLL);
+        if (!errorMonitor.update(micros())) {
+          #if defined(ODRIVE_FAULT_RECOVERY)
+            if (!calibrating) faultManager.update(micros(), !estopActive);
+          #endif
+        }
+      }
+      #endif
+      slowTask.stop();
+      slowTask.finish();
+    }
+  #endif
+
+  static uint32_t lastOverruns = 0;
+  uint8_t status = 0;
+  if (estopActive) status |= raspi_pkg::SensorState::STATUS_ESTOP;
+  if (errorMonitor.anyError()) status |= raspi_pkg::SensorState::STATUS_ODRIVE_ERROR;
+  if (feedbackStale) status |= raspi_pkg::SensorState::STATUS_FEEDBACK_STALE;
+  if (controlScheduler.overruns() != lastOverruns) status |= raspi_pkg::SensorState::STATUS_OVERRUN;
+  if (calibrating) status |= raspi_pkg::SensorState::STATUS_CALIBRATING;
+  if (resetting) status |= raspi_pkg::SensorState::STATUS_ODRIVE_RESET;
+  #if defined(TORQUE_CONTROL) && !defined(ONBOARD_PBC)
+    if (commandQueue.timedOut()) status |= raspi_pkg::SensorState::STATUS_COMMAND_TIMEOUT;
+  #endif
+  lastOverruns = controlScheduler.overruns();
+  #if defined(TRANSPORT_METER)
+    transport.update(stamp_us, snapshot.current, motorRate, spokeStates, !estopActive && !calibrating && !resetting);
+  #endif
+  #if defined(TRACE_BUFFER)
+    // the ticks up to the first failure stay in the ring for pull_trace.py
+    if (status & (TRACE_TRIGGER_STATUS)) traceBuffer.trigger(status, TRACE_POST_EVENTS);
+  #endif
+
+  snapshot.status = status;
+  snapshot.seq = sensorSnapshot.seq() + 1;
+  #if defined(SENSOR_EVENTS)
+    // set before the write, so loop() never sees the sample without its event
+    static float eventSpoke = 0.0f;
+    static uint8_t eventStatus = 0;
+    static uint32_t lastEventSeq = 0;
+    #if defined(IMPACT_DETECTOR)
+      bool touchdown = impactSensed;
+    #else
+      // a new stance spoke; the whole-spoke moves of a zero or an unwrap send one spare sample
+      float eventStance = Robot::spokeCount(spokeStates[0]);
+      bool touchdown = eventStance != eventSpoke;
+      eventSpoke = eventStance;
+    #endif
+    bool edge = (status ^ eventStatus) & (raspi_pkg::SensorState::STATUS_ESTOP | raspi_pkg::SensorState::STATUS_ODRIVE_ERROR);
+    eventStatus = status;
+    bool urgent = (touchdown || edge) && (lastEventSeq == 0 || snapshot.seq - lastEventSeq >= SENSOR_EVENT_MIN_STEPS);
+    if (urgent) {
+      lastEventSeq = snapshot.seq;
+      sensorEventSeq = snapshot.seq;
+    }
+  #else
+    constexpr bool urgent = false;
+  #endif
+  sensorSnapshot.write(snapshot);
+  #if defined(SENSOR_BATCH)
+    sensorBatcher.add(snapshot, urgent);
+  #else
+    (void)urgent;
+  #endif
+  #if defined(FLIGHT_RECORDER)
+    FlightRecord record;
+    record.stamp_us = stamp_us;
+    record.status = status;
+    record.errors = 0;
+    for (int reg = 0; reg < ODriveErrorMonitor::NUM_REGISTERS && reg < 8; ++reg)
+      if (errorMonitor.value((ODriveErrorMonitor::Register)reg) != 0) record.errors |= 1 << reg;
+    // the event index: touchdowns, E-stop edges and changes of the ODrive error registers
+    static uint8_t lastRecordStatus = 0, lastRecordErrors = 0;
+    #if defined(IMPACT_DETECTOR)
+      if (impactSensed) flightRecorder.event(FlightEvent::IMPACT, impactDetector.cues());
+    #else
+      // a new stance spoke, except where the angle moves by whole spokes: the zeroing after the
+      // calibration, and spokes.unwrap() at the E-stop release, seen on the tick after
+      static float lastStanceSpoke = 0.0f;
+      static uint8_t settling = 2;
+      float stanceSpoke = Robot::spokeCount(spokeStates[0]);
+      if (status & (raspi_pkg::SensorState::STATUS_ESTOP | raspi_pkg::SensorState::STATUS_CALIBRATING |
+                    raspi_pkg::SensorState::STATUS_ODRIVE_RESET)) settling = 2;
+      else if (settling > 0) --settling;
+      else if (stanceSpoke != lastStanceSpoke) flightRecorder.event(FlightEvent::IMPACT);
+      lastStanceSpoke = stanceSpoke;
+    #endif
+    if ((status ^ lastRecordStatus) & raspi_pkg::SensorState::STATUS_ESTOP)
+      flightRecorder.event(status & raspi_pkg::SensorState::STATUS_ESTOP ? FlightEvent::ESTOP_ON : FlightEvent::ESTOP_OFF);
+    if (record.errors != lastRecordErrors) flightRecorder.event(FlightEvent::ODRIVE_ERRORS, record.errors);
+    #if defined(STEP_BENCHMARK)
+      // each rate's steps start here; the periods are the stamps' differences
+      static uint32_t lastBenchmarkRate = 0;
+      if (stepBenchmark.rateHz() != lastBenchmarkRate) {
+        lastBenchmarkRate = stepBenchmark.rateHz();
+        flightRecorder.event(FlightEvent::BENCHMARK, lastBenchmarkRate);
+      }
+    #endif
+    lastRecordStatus = status;
+    lastRecordErrors = record.errors;
+    recordGyro.to(record.gyro);
+    recordAccel.to(record.accel);
+    memcpy(record.spoke, snapshot.spoke, sizeof(record.spoke));
+    memcpy(record.torso, snapshot.torso, sizeof(record.torso));
+    record.torque = estopActive || calibrating || resetting ? 0.0f : torque0;
+    record.latency_us = loopTiming.lastLatency_us() > 0xFFFF ? 0xFFFF : loopTiming.lastLatency_us();
+    flightRecorder.record(record);
+  #endif
+}
+
+HOT_CODE void computeTorque(const float* torsoStates, const float* spokeStates){
+  PROFILE_SCOPE(PROFILE_COMPUTE_TORQUE);
+  #if defined(LINK_GOVERNOR)
+    uint32_t linkNow = micros();
+    if (linkGovernor.update(linkNow, commandQueue.age_us(linkNow), linkRoundTrip_us, linkBacklog)) {
+      #if defined(FLIGHT_RECORDER)
+        flightRecorder.event(FlightEvent::LINK_MODE, linkGovernor.mode());
+      #endif
+      // into the fallback, from either side: the torso held where it is now
+      if (linkGovernor.mode() == LinkGovernor::FALLBACK) linkHold.angle = torsoStates[0];
+    }
+  #endif
+  // runs in the timer interrupt, so the E-stop holds the brake one step at a time instead of spinning here
+  if (estop()){
+    static uint32_t brakeStamp = 0;
+    if (!estopActive || millis() - brakeStamp >= ESTOP_BRAKE_REPEAT_MS) {
+      brakeStamp = millis();
+      brake();
+    }
+    #if defined(STEP_BENCHMARK)
+      stepBenchmark.abort();
+    #endif
+    estopActive = true;
+  }
+  else if (estopActive){
+    //When the encoder wraps, and you switch the Estop off, it starts from configurations not visited by the training. So, unwrap it. 
+    // Whole spokes only, so the stance spoke keeps its angle; the tracker counts them, nothing is re-read
+    spokes.unwrap();
+    #if defined(SPOKE_CONTACT_ANGLE)
+      stance.reset();
+    #endif
+    #if defined(ESTOP_RESEED)
+      torso.reseed(); // roll and pitch from the last accel sample, the yaw kept
+      spokes.reseed(micros());
+    #elif ATTITUDE_ESTIMATOR == ATTITUDE_ROLL_KALMAN
+      torso.filter().reset(); // take roll straight from the next accel sample
+    #endif
+    #if defined(SUPERVISED_CONTROL)
+      torsoStabilizer.reset(); // no holding a target from before the stop
+    #endif
+    #if defined(TELEOP_SHAPING)
+      teleopShaper[0].reset(); // from rest, on the next stick
+      teleopShaper[1].reset();
+    #endif
+    #if defined(TRACE_BUFFER)
+      traceBuffer.arm(); // the E-stop froze it; a dump is taken before the release
+    #endif
+    #if defined(MODEL_EKF)
+      ekfStarted = false; // the spoke angle just moved with the offsets
+      #if defined(IMPACT_DETECTOR)
+        impactDetector.reset();
+      #endif
+      #if defined(TERRAIN_ESTIMATOR)
+        terrain.reset(); // the robot may have been carried anywhere
+      #endif
+    #endif
+    estopActive = false;
+  }
+  #if defined(LINK_GOVERNOR)
+  else if (linkGovernor.mode() == LinkGovernor::BRAKE){
+    // as under the E-stop, but the estimators run on, so the release needs nothing reset
+    static uint32_t linkBrakeStamp = 0, linkBrakeTransitions = 0;
+    if (linkGovernor.transitions() != linkBrakeTransitions || millis() - linkBrakeStamp >= ESTOP_BRAKE_REPEAT_MS) {
+      linkBrakeTransitions = linkGovernor.transitions();
+      linkBrakeStamp = millis();
+      brake();
+    }
+    torque0 = 0.0f;
   }
+  #endif
   else{
-    return false;
+
+    #if defined(ONBOARD_PBC)
+      // state as in evaluatePbc.jl's update_state!: the spoke angle is measured from the upright contact
+      #if defined(SPOKE_CONTACT_ANGLE)
+        stance.update(spokeStates);
+        float spokeAngle = stance.contactAngle();
+      #else
+        float spokeAngle = spokeStates[0];
+      #endif
+      #if defined(ONBOARD_PBC_BAYESIAN)
+        // every sample when the next spoke is about to land, fewer once the mean has settled otherwise
+        bool impactNear = fabsf(spokes.contactAngle(0)) > Robot::alpha - ONBOARD_PBC_BAYESIAN_IMPACT_MARGIN;
+        torque0 = pbc.control(torsoStates[0], Robot::uprightSpokeAngle + spokeAngle, torsoStates[1], spokeStates[2], impactNear);
+      #elif defined(ONBOARD_PBC_SCHEDULED)
+        #if defined(ONBOARD_PBC_SCHEDULE_TERRAIN)
+          // set at the touchdown before this one lands, so the blend has changed by then
+          pbcSchedule = terrain.predicted();
+        #else
+          // the hub's speed over the stance spoke
+          pbcSchedule += (Robot::l1*fabsf(spokeStates[2]) - pbcSchedule)*(samplingTime/ONBOARD_PBC_SCHEDULE_TAU);
+        #endif
+        torque0 = pbc.control(pbcSchedule, torsoStates[0], Robot::uprightSpokeAngle + spokeAngle, torsoStates[1], spokeStates[2]);
+      #else
+        torque0 = pbc.control(torsoStates[0], Robot::uprightSpokeAngle + spokeAngle, torsoStates[1], spokeStates[2]);
+      #endif
+    #elif defined(SUPERVISED_CONTROL)
+      // the torso loop closes here at the step's rate, the Pi only moves its setpoint
+      CommandQueue::Setpoint setpoint;
+      bool fresh = commandQueue.newest(setpoint, micros());
+      torque0 = torsoStabilizer.control(fresh ? &setpoint : nullptr, torsoStates[0], torsoStates[1]);
+    #elif defined(TORQUE_CONTROL)
+      // the newest /torso_command, ramped or timed out to zero at this step's rate
+      torque0 = commandQueue.sample(micros());
+    #endif
+    #if defined(LINK_GOVERNOR)
+      // the Pi's torque is too late to act on
+      if (linkGovernor.mode() == LinkGovernor::FALLBACK)
+        torque0 = linkFallback.control(&linkHold, torsoStates[0], torsoStates[1]);
+    #endif
+    #if defined(STEP_BENCHMARK)
+      // the script's torque in place of the controller's, through the same limits
+      if (stepBenchmark.active()) torque0 = stepBenchmark.command(micros());
+    #endif
+    #if defined(TORQUE_CONTROL)
+      float motor[2];
+      actuator.command(torque0, motor);
+      torqueLimiter.apply(motor, spokeStates + 2);
+      #if defined(STEP_BENCHMARK)
+        if (stepBenchmark.active()) stepBenchmark.commanded(motor);
+      #endif
+      if (torqueOutput.update(motor[0], motor[1], micros())) {
+        commandTorques(motor);
+      }
+    #else
+      commandSetpoints(torsoStates);
+    #endif
   }
 }
 
-void brake(){
-  commandTorque(0, 0);
-  commandTorque(1, 0);
+#if !defined(TORQUE_CONTROL)
+// The control step's command without torque control: the targets from /torso_command (or
+// /teleop) with the torque feed-forward, through the torque's delta suppression and keepalive
+HOT_CODE void commandSetpoints(const float* torsoStates){
+  float feedforward[2] = {0.0f, 0.0f};
+  #if defined(VELOCITY_FEEDFORWARD)
+    // the torso's gravity torque G2 sin(phi - incline) at the hips
+    actuator.feedforward(Robot::G2*sinf(torsoStates[0] - Robot::incline), feedforward);
+  #else
+    (void)torsoStates;
+  #endif
+  #if defined(TELEOP_SHAPING)
+    const uint32_t now = micros();
+    float velocity[2] = {teleopShaper[0].update(now), teleopShaper[1].update(now)};
+  #else
+    float velocity[2] = {velocityCommand[0], velocityCommand[1]};
+  #endif
+  #if defined(POSITION_CONTROL)
+    float position[2] = {positionCommand[0], positionCommand[1]};
+    #if defined(TRAJECTORY_PLAYBACK)
+      TrajectoryBuffer::Point point;
+      if (trajectory.sample(micros(), point)) {
+        // the trajectory's feed-forward adds to the model's, mirrored like torque0
+        position[0] = -point.position;
+        position[1] = point.position;
+        velocity[0] = -point.velocity;
+        velocity[1] = point.velocity;
+        feedforward[0] -= point.torque;
+        feedforward[1] += point.torque;
+      } else if (!positionCommandValid) return;
+    #else
+      if (!positionCommandValid) return;
+    #endif
+    if (torqueOutput.update(position, feedforward, micros())) {
+      motorDriver.setPositions(position, velocity, feedforward);
+    }
+  #else
+    if (torqueOutput.update(velocity, feedforward, micros())) {
+      motorDriver.setVelocities(velocity, feedforward);
+    }
+  #endif
 }
+#endif
 
-float* cross(float x[3], float y[3]){
+void receiveJointState(const JointStateView &msg) {
 
-  static float crossProd[3];
-  crossProd[0] = x[1]*y[2] - x[2]*y[1];
-  crossProd[1] = x[2]*y[0] - x[0]*y[2];
-  crossProd[2] = x[0]*y[1] - x[1]*y[0];
+  #if defined(TORQUE_CONTROL)
 
-  return crossProd;
+      ///////////// for neural net //////////////
 
-}
+      #if defined(ONBOARD_PBC)
+        // the torque comes from the on-board controller; said once on /rosout, so a Pi
+        // controller driving this build is not ignored in silence
+        static bool warned = false;
+        if (!warned) {
+          nh.logwarn("ONBOARD_PBC build: /torso_command ignored");
+          warned = true;
+        }
+        (void)msg;
+        return;
+      #endif
+      if (msg.effortLength() == 0) return;
+      #if defined(LINK_GOVERNOR)
+        linkRoundTrip_us = 0; // unless this one echoes its sample's seq
+      #endif
+      #if defined(SUPERVISED_CONTROL)
+        // without a position[0] a plain torque; the gains default when effort[] stops at the feed-forward
+        CommandQueue::Setpoint setpoint = {msg.effort(0), 0.0f, 0.0f, 0.0f, 0.0f};
+        if (msg.positionLength() >= 1) {
+          setpoint.angle = msg.position(0);
+          setpoint.rate = msg.velocityLength() >= 1 ? msg.velocity(0) : 0.0f;
+          setpoint.kp = msg.effortLength() >= 2 ? msg.effort(1) : SUPERVISED_DEFAULT_KP;
+          setpoint.kd = msg.effortLength() >= 3 ? msg.effort(2) : SUPERVISED_DEFAULT_KD;
+        }
+        commandQueue.push(setpoint, micros());
+      #else
+        // effort[1] is not used: the coupled hips take one torque; the control step takes it from the queue
+        commandQueue.push(msg.effort(0), micros());
+      #endif
+      #if defined(COMMAND_LATENCY)
+        // the seq of the /sensors sample this torque was computed from; empty or
+        // non-numeric from the joystick and the zero-torque fallbacks
+        uint32_t sampleSeq;
+        if (msg.frameIdNumber(sampleSeq)) {
+          bool matched = commandLatency.echoed(sampleSeq, micros());
+          #if defined(LINK_GOVERNOR)
+            if (matched) linkRoundTrip_us = commandLatency.lastRtt_us();
+          #else
+            (void)matched;
+          #endif
+        }
+      #endif
+      if constexpr (BuildConfig::debugOutput) {
+        debugLog.log("Received torque command: {}\n", msg.effort(0));
+      }
+
+      ///////////// for joystick ////////////////////
+      // torque0 = msg.velocity(0);
+
+    #else
+    #if defined(ODRIVE_CONNECTED)
+      // applied by the next controlStep(), which owns the ODrive link
+      if (msg.velocityLength() >= 2) {
+        #if defined(TELEOP_SHAPING)
+          teleopShaper[0].target(msg.velocity(0), micros());
+          teleopShaper[1].target(msg.velocity(1), micros());
+        #else
+          velocityCommand[0] = -1*msg.velocity(0)*MOTOR_VELOCITY_LIMIT;
+          velocityCommand[1] = msg.velocity(1)*MOTOR_VELOCITY_LIMIT;
+        #endif
+      }
+      #if defined(POSITION_CONTROL)
+        if (msg.positionLength() >= 2) {
+          positionCommand[0] = -1*msg.position(0);
+          positionCommand[1] = msg.position(1);
+          positionCommandValid = true;
+        }
+      #endif
 
-float* comAcceleration(const sensors_event_t& accel, const sensors_event_t& gyro, float alpha_x){
+      #endif 
+    #endif
   
-  static float acc_COM[3]; 
+  return;
+}
+
+#if defined(TELEOP_MSG)
+// receiveJointState()'s velocity command without the JointState around it
+void receiveTeleop(const raspi_pkg::Teleop &msg) {
+  #if defined(ODRIVE_CONNECTED) && defined(TELEOP_SHAPING)
+    teleopShaper[0].target(msg.velocity[0], micros());
+    teleopShaper[1].target(msg.velocity[1], micros());
+  #elif defined(ODRIVE_CONNECTED)
+    velocityCommand[0] = -1*msg.velocity[0]*MOTOR_VELOCITY_LIMIT;
+    velocityCommand[1] = msg.velocity[1]*MOTOR_VELOCITY_LIMIT;
+  #else
+    (void)msg;
+  #endif
+}
+#endif
+
+#if defined(IMU_CONFIG_MSG)
+// New ranges and rates, written with the control step paused, since both the writes and the
+// step's reads go over Wire; the transform follows the new LSB scales before the step resumes
+void receiveImuConfig(const raspi_pkg::ImuConfig &msg) {
+  ImuSettings settings;
+  if (!imu_settings_from_units(imuSettings, msg.accel_range_g, msg.gyro_range_dps, msg.rate_hz,
+                               msg.mag_range_gauss, msg.mag_rate_hz, settings)) {
+    imuConfigResult = IMU_CONFIG_REJECTED;
+    imuConfigChanged = true;
+    return;
+  }
+  controlScheduler.pause();
+  #if IMU_MODE == IMU_MODE_DATA_READY
+    // and no data-ready read in between
+    detachInterrupt(digitalPinToInterrupt(IMU_INT1_PIN));
+  #endif
+  bool ok = setup_sensors(settings);
+  #if IMU_MODE == IMU_MODE_DATA_READY
+    ok = init_data_ready(IMU_INT1_PIN) && ok;
+  #elif IMU_MODE == IMU_MODE_FIFO
+    #if defined(IMU_FIFO_TIMESTAMPS)
+      ok = init_fifo(settings.rate, true) && ok;
+    #else
+      ok = init_fifo(settings.rate, false) && ok;
+    #endif
+    #if defined(IMU_FIFO_DECIMATE)
+      imuDecimator.design(IMU_FIFO_DECIMATE_HZ, lsm6ds_rate_hz(settings.rate));
+    #endif
+  #endif
+  // what was written, even if a read-back differs: the diagnostics then say so
+  imuSettings = settings;
+  imu_build_transform(cal, imuTransform, imuSettings);
+  #if defined(SPECTRUM_MONITOR)
+    spectrum.setRate(imuAccelRate());
+  #endif
+  controlScheduler.resume();
+  imuConfigResult = ok ? IMU_CONFIG_APPLIED : IMU_CONFIG_FAILED;
+  imuConfigChanged = true;
+}
+#endif
+
+void receiveODriveCommand(const sensor_msgs::Joy &msg) {
+  #if defined(STEP_BENCHMARK)
+    // a press stops a running benchmark, and any other command too; loop() restores the rate.
+    // Between two steps, which read the script
+    controlScheduler.pause();
+    bool benchmarkPressed = msg.buttons_length > STEP_BENCHMARK_BUTTON && msg.buttons[STEP_BENCHMARK_BUTTON] == 1;
+    if (stepBenchmark.active() && (benchmarkPressed || msg.buttons[0] == 1 || msg.buttons[3] == 1)) {
+      stepBenchmark.abort();
+    } else if (benchmarkPressed && !estopActive && !calibration.busy()) {
+      stepBenchmark.start();
+    }
+    controlScheduler.resume();
+  #endif
+  // odriveCommandThread carries it out and clears the request; a press while one runs is dropped
+  if (odriveRequest != ODRIVE_REQUEST_NONE) return;
+  if (msg.buttons[0] == 1) odriveRequest = ODRIVE_REQUEST_CLEAR;
+  else if (msg.buttons[3] == 1) odriveRequest = ODRIVE_REQUEST_REBOOT;
+}
 
-  float imuToCOM[3] = {0.0f, 0.0f, 0.0f};
-  float omega[3]    = {gyro.gyro.x, gyro.gyro.y, gyro.gyro.z};
-  float ap[3]       = {accel.acceleration.x, accel.acceleration.y, accel.acceleration.z};
-  float alpha[3]    = {alpha_x, 0.0f, 0.0f}; //assumes the robot has no tolerance/play in the y and z direction
+// A pipelined "f 0" collected, or given up on after the reply timeout
+bool odriveProbeDone() {
+  ODrive.poll();
+  return ODrive.pending() == 0;
+}
 
-  auto omegaCrossR  = cross(omega, imuToCOM);
-  auto alphaCrossR  = cross(alpha, imuToCOM);
-  auto omegaCrossOmegaCrossR = cross(omega, omegaCrossR); 
+// A clear ("sc") or a reboot ("sr") and the calibration after it. The control step keeps
+// running, off the link: the Pi goes on getting samples, flagged STATUS_ODRIVE_RESET. The
+// ODrive is probed until it answers, after the clear at once and after the reboot once booted
+Protothread::State odriveCommandThread(Protothread& pt) {
+  static uint32_t start_ms = 0, probe_us = 0;
+  static bool answered = false;
+
+  PT_BEGIN(pt);
+  PT_WAIT_UNTIL(pt, odriveRequest != ODRIVE_REQUEST_NONE);
+  odriveResetting = true;
+  ODrive.SetVelocity(0, 0);
+  ODrive.SetVelocity(1, 0);
+  start_ms = millis();
+  if (odriveRequest == ODRIVE_REQUEST_CLEAR) {
+    odriveSerial << "sc" << "\n";
+  } else {
+    odriveSerial << "sr" << "\n";
+    PT_SLEEP_MS(pt, ODRIVE_REBOOT_QUIET_MS);
+  }
 
-  for (int i = 0; i < 3; ++i){
-    acc_COM[i] = ap[i] - alphaCrossR[i] - omegaCrossOmegaCrossR[i];
+  // the UART answers in order, so a reply comes after the clear has been done
+  answered = false;
+  while (!answered && millis() - start_ms < ODRIVE_RESET_TIMEOUT_MS) {
+    if (ODrive.pending() == 0) {
+      while (odriveSerial.available()) odriveSerial.read(); // the boot's noise
+    }
+    probe_us = micros();
+    ODrive.RequestFeedback(0);
+    PT_WAIT_UNTIL(pt, odriveProbeDone());
+    answered = ODrive.feedback().valid[ODriveFeedback::POS0] &&
+               (int32_t)(ODrive.feedback().stamp_us[ODriveFeedback::POS0] - probe_us) >= 0;
+    if (!answered) PT_SLEEP_MS(pt, ODRIVE_PROBE_PERIOD_MS);
   }
 
-  return acc_COM;
+  #if defined(ODRIVE_FAULT_RECOVERY)
+    faultManager.reset();
+  #endif
+  if (answered) {
+    debugLog.log("ODrive {} done in {} ms\n", odriveRequest == ODRIVE_REQUEST_CLEAR ? "clear" : "reboot",
+                 (int)(millis() - start_ms));
+    startCalibration(0);
+    PT_YIELD(pt);
+    startCalibration(1);
+  } else {
+    debugLog.log("ODrive not answering {} ms after the {}\n", (int)ODRIVE_RESET_TIMEOUT_MS,
+                 odriveRequest == ODRIVE_REQUEST_CLEAR ? "clear" : "reboot");
+  }
+  odriveRequest = ODRIVE_REQUEST_NONE;
+  odriveResetting = false;
+  PT_END(pt);
 }
 
-float* readEncoder(float* torsoStates){
+// NTP-style: runs from nh.spinOnce() as soon as the ping's frame is parsed
+void receiveClockPing(const raspi_pkg::ClockSync &msg) {
+  clockPong.teensy_receive_us = micros();
+  clockPong.id = msg.id;
+  clockPong.pi_send = msg.pi_send;
+  clockPong.teensy_send_us = micros();
+  clockPongPub.publish(&clockPong);
+}
 
-  static float spokeStates[4];
-  spokeStates[0] = -abs(ODrive.GetPosition(0))*2.0f*M_PI*gearRatio - enc0Offset;
-  spokeStates[1] = -abs(ODrive.GetPosition(1))*2.0f*M_PI*gearRatio - enc1Offset;
-  // spokeStates[2] = ODrive.GetVelocity(0);
-  // spokeStates[3] = ODrive.GetVelocity(1);
+// Both hips' motor torques, in one transaction where the transport has one
+HOT_CODE void commandTorques(const float torque[2]){
+  #if defined(MOTOR_DRIVER_BENCHMARK)
+    uint32_t start = micros();
+    motorDriver.setTorques(torque[0], torque[1]);
+    torqueTiming.add(micros() - start);
+  #else
+    motorDriver.setTorques(torque[0], torque[1]);
+  #endif
+}
 
-  spokeStates[2] = lpf.filterIn((spokeStates[0] - oldSpoke1Angle)/samplingTime);
-  spokeStates[3] = lpf.filterIn((spokeStates[1] - oldSpoke2Angle)/samplingTime);
-  oldSpoke1Angle = spokeStates[0] ;
-  oldSpoke2Angle = spokeStates[1]; 
-  oldSpokeSpeed = spokeStates[2];
+// Held, or pressed since the last call: a press shorter than the control period still brakes
+// odriveSerial at baud with the RX buffer emptied, then a vbus_voltage read as the check
+// that the ODrive is there at that rate
+COLD_CODE bool probeODrive(uint32_t baud) {
+  odriveSerial.end();
+  odriveSerial.begin(baud);
+  // a newline first ends whatever half line the other rate left in the ODrive's parser
+  odriveSerial << "\n";
+  delay(5);
+  for (int attempt = 0; attempt < 3; ++attempt) {
+    while (odriveSerial.available()) odriveSerial.read();
+    ODrive.readFloatProperty(-1, "vbus_voltage");
+    if (ODrive.lastStatus() == ODriveArduino::READ_OK) return true;
+  }
+  return false;
+}
 
-  return spokeStates;
+#if defined(BOOT_SELF_TEST)
+// The setup() probes, BOOT_SELF_TEST_RUNS calls each within BOOT_SELF_TEST_BUDGET_MS: the ODrive
+// (if it answered connectODrive()) over both UART protocols, which it takes on the same port,
+// and over the build's own driver when that is I2C or CAN; then the IMU. Printed as they stand;
+// the report waits for the link's window
+COLD_CODE void runSelfTest(bool odrive) {
+  auto clock = [] { return (uint32_t)micros(); };
+  selfTest.begin(micros());
+  #if defined(ODRIVE_CONNECTED)
+    if (odrive) {
+      float position[2], velocity[2];
+      selfTest.run(BootSelfTest::ODRIVE_PROPERTY, BOOT_SELF_TEST_RUNS, clock, [] {
+        float vbus = ODrive.readFloatProperty(-1, "vbus_voltage");
+        if (ODrive.lastStatus() != ODriveArduino::READ_OK) return false;
+        selfTestVbus = vbus;
+        return true;
+      });
+      ODriveAsciiDriver ascii(ODrive, ODRIVE_REPLY_TIMEOUT_US);
+      selfTest.run(BootSelfTest::ODRIVE_ASCII, BOOT_SELF_TEST_RUNS, clock, [&] {
+        if (ascii.readFeedback(position, velocity)) return true;
+        ODrive.dropPending(); // or every later call waits on the lost reply
+        return false;
+      });
+      ODriveBinaryDriver binary(ODriveFast, ODRIVE_ENCODER_CPR);
+      selfTest.run(BootSelfTest::ODRIVE_BINARY, BOOT_SELF_TEST_RUNS, clock, [&] {
+        return binary.readFeedback(position, velocity);
+      });
+      #if MOTOR_DRIVER == MOTOR_DRIVER_I2C || MOTOR_DRIVER == MOTOR_DRIVER_CAN
+        selfTest.run(BootSelfTest::ODRIVE_DRIVER, BOOT_SELF_TEST_RUNS, clock, [&] {
+          motorDriver.requestFeedback();
+          return motorDriver.readFeedback(position, velocity);
+        });
+      #endif
+      delay(2);
+      while (odriveSerial.available()) odriveSerial.read(); // a reply that came in late
+    }
+  #else
+    (void)odrive;
+  #endif
+  #if defined(IMU_ASYNC_BURST)
+    selfTest.run(BootSelfTest::IMU_BURST, BOOT_SELF_TEST_RUNS, clock, [] {
+      imus.start(true);
+      return imus.join(torsoImu) == 12;
+    });
+  #else
+    selfTest.run(BootSelfTest::IMU_BURST, BOOT_SELF_TEST_RUNS, clock, [] {
+      int16_t gyro[3], accel[3];
+      return imu_read_raw(gyro, accel);
+    });
+  #endif
+  selfTest.run(BootSelfTest::MAG_READ, BOOT_SELF_TEST_RUNS, clock, [] {
+    int16_t mag[3];
+    return mag_read_raw(mag);
+  });
+
+  Serial << "Self-test in " << selfTest.elapsed_us() << " us" << (selfTest.overBudget() ? ", over budget" : "") << '\n';
+  for (uint8_t p = 0; p < BootSelfTest::NUM_PROBES; ++p) {
+    const BootSelfTest::Timing& t = selfTest.timing(p);
+    if (t.runs == 0) continue;
+    Serial << "  " << BootSelfTest::name(p) << ' ' << t.ok << '/' << t.runs << " min/mean/max us: " << t.min_us << '/'
+           << t.mean_us() << '/' << t.max_us << '\n';
+  }
 }
 
-float* readIMU(){
+// The ODrive transport a probe timed, by its driver's name()
+const char* selfTestTransport(uint8_t probe) {
+  switch (probe) {
+    case BootSelfTest::ODRIVE_ASCII: return "uart-ascii";
+    case BootSelfTest::ODRIVE_BINARY: return "uart-binary";
+    case BootSelfTest::ODRIVE_DRIVER: return motorDriver.name();
+    default: return "none";
+  }
+}
 
-  static float torsoStates[3]; 
+// Once, at the end of the link's window; under the 512-byte buffer with every probe run:
+//   <probe>     ok/runs min/mean/max_us, of those run
+//   vbus        V, the property probe's read; elapsed_us, the setup() probes' total
+//   odrive      the fastest transport/the build's
+//   link        ms from boot to the sync/bytes a second over the window/sensor frames dropped in it
+// Warned when a probe failed a call or ran out of budget, when frames were dropped, or when
+// another transport answers in under 80% of the build's time; an error when the ODrive did not
+// answer
+void publishSelfTest() {
+  static const char* keys[BootSelfTest::NUM_PROBES + 4];
+  static char values[BootSelfTest::NUM_PROBES + 4][28];
+  diagnostic_msgs::KeyValue keyValues[BootSelfTest::NUM_PROBES + 4];
+  diagnostic_msgs::DiagnosticStatus status;
+  static char message[48];
+
+  int n = 0;
+  auto add = [&](const char* key) -> char* { keys[n] = key; return values[n++]; };
+  bool failed = selfTest.overBudget();
+  for (uint8_t p = 0; p < BootSelfTest::NUM_PROBES; ++p) {
+    const BootSelfTest::Timing& t = selfTest.timing(p);
+    if (t.runs == 0) continue;
+    snprintf(add(BootSelfTest::name(p)), sizeof(values[0]), "%u/%u %lu/%lu/%lu", (unsigned)t.ok, (unsigned)t.runs,
+             (unsigned long)t.min_us, (unsigned long)t.mean_us(), (unsigned long)t.max_us);
+    if (t.ok < t.runs) failed = true;
+  }
+  snprintf(add("vbus"), sizeof(values[0]), "%.2f", selfTestVbus);
+  snprintf(add("elapsed_us"), sizeof(values[0]), "%lu", (unsigned long)selfTest.elapsed_us());
+  #if MOTOR_DRIVER == MOTOR_DRIVER_ASCII
+    const uint8_t built = BootSelfTest::ODRIVE_ASCII;
+  #elif MOTOR_DRIVER == MOTOR_DRIVER_BINARY
+    const uint8_t built = BootSelfTest::ODRIVE_BINARY;
+  #else
+    const uint8_t built = BootSelfTest::ODRIVE_DRIVER;
+  #endif
+  const uint8_t fastest = selfTest.fastestOdrive();
+  snprintf(add("odrive"), sizeof(values[0]), "%s/%s", selfTestTransport(fastest), motorDriver.name());
+  snprintf(add("link"), sizeof(values[0]), "%lu/%lu/%lu", (unsigned long)selfTest.syncMs(),
+           (unsigned long)selfTest.linkBytesPerS(), (unsigned long)selfTest.linkDropped());
+  for (int i = 0; i < n; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
 
-  //All angles are given in radians.
-  sensors_event_t accel, gyro, mag;
-  accelerometer->getEvent(&accel);
-  gyroscope->getEvent(&gyro);
-  magnetometer->getEvent(&mag);
+  bool odriveAnswered = selfTest.timing(BootSelfTest::ODRIVE_PROPERTY).ok > 0;
+  bool faster = fastest != BootSelfTest::NUM_PROBES && fastest != built && selfTest.timing(built).ok > 0
+                && selfTest.timing(fastest).mean_us() < selfTest.timing(built).mean_us()*4/5;
+  message[0] = '\0';
+  #if defined(ODRIVE_CONNECTED)
+    if (!odriveAnswered) {
+      status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+      snprintf(message, sizeof(message), "the ODrive did not answer");
+    } else
+  #endif
+  if (faster) {
+    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+    snprintf(message, sizeof(message), "%s answers faster, see MOTOR_DRIVER", selfTestTransport(fastest));
+  } else if (failed || selfTest.linkDropped() > 0) {
+    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+    snprintf(message, sizeof(message), "%s", selfTest.overBudget() ? "over BOOT_SELF_TEST_BUDGET_MS"
+                                             : failed ? "a probe failed" : "sensor frames dropped");
+  } else {
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  }
+  (void)odriveAnswered;
+  status.message = message;
+  status.name = "self_test";
+  status.hardware_id = "teensy";
+  status.values_length = n;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_STATUS, diagnostics, &profileArray);
+}
+#endif
 
-  cal.calibrate(mag);
-  cal.calibrate(accel);
-  cal.calibrate(gyro);
+// Brings the UART up at ODRIVE_BAUD: a warm ODrive already runs at it; a factory one is
+// found at ODRIVE_BAUD_DEFAULT, given ODRIVE_BAUD_PROPERTY, saved and rebooted, then checked
+// at the new rate. If that check fails the ODrive is looked for at the default rate again
+// (firmware without the property ignores the write). Returns the rate in use, 0 for none.
+COLD_CODE uint32_t connectODrive() {
+  if (probeODrive(ODRIVE_BAUD)) return ODRIVE_BAUD;
+  if (!probeODrive(ODRIVE_BAUD_DEFAULT)) return 0;
+  if (ODRIVE_BAUD == ODRIVE_BAUD_DEFAULT) return ODRIVE_BAUD_DEFAULT;
+
+  Serial << "ODrive at " << ODRIVE_BAUD_DEFAULT << " baud, switching it to " << ODRIVE_BAUD << '\n';
+  // already set but never saved, or written now; either way read back before saving
+  ODrive.writeIntConfig(-1, ODRIVE_BAUD_PROPERTY, ODRIVE_BAUD);
+  if (ODrive.readProperty(-1, ODRIVE_BAUD_PROPERTY) == ODRIVE_BAUD) {
+    // firmware 0.5 reboots on the save by itself, the "sr" then goes nowhere
+    odriveSerial << "ss\n";
+    delay(500);
+    odriveSerial << "sr\n";
+    delay(ODRIVE_REBOOT_MS);
+    if (probeODrive(ODRIVE_BAUD)) return ODRIVE_BAUD;
+    Serial << "ODrive not answering at " << ODRIVE_BAUD << " after the reboot\n";
+  } else {
+    Serial << "ODrive did not take " << ODRIVE_BAUD_PROPERTY << ", see ODRIVE_BAUD_PROPERTY\n";
+  }
+  return probeODrive(ODRIVE_BAUD_DEFAULT) ? ODRIVE_BAUD_DEFAULT : 0;
+}
 
+bool estop(){
+  bool latched = estopLatched;
+  estopLatched = false;
+  return latched || digitalRead(estop_in) == LOW;
+}
 
-  // Compute the angular acceleration from the dynamics inorder to shift the linear acceleration at the COM
-  //find shifted linear acceleration
-  
-  float alpha_x = (gyro.gyro.x - (-1.0f*oldTorsoOmega))/samplingTime;
-  auto acc_COM = comAcceleration(accel, gyro, alpha_x);
+#if defined(TRAJECTORY_PLAYBACK)
+// An upload, queued whole: the control step sees all of its points at once or none
+void receiveTrajectory(const TrajectoryView &msg) {
+  trajectory.begin(msg.mode() != TrajectoryView::MODE_APPEND);
+  for (uint32_t i = 0; i < msg.points(); ++i) {
+    if (!trajectory.add(msg.time(i), msg.position(i), msg.velocity(i), msg.torque(i))) break;
+  }
+  trajectory.commit();
+  if constexpr (BuildConfig::debugOutput) {
+    debugLog.log("Trajectory: {} points queued, {} dropped\n", trajectory.queued(), trajectory.dropped());
+  }
+}
+#endif
+
+#if defined(WEIGHT_UPLOAD)
+// From spinOnce() in loop(), so the swap falls between two steps: each runs on the old weights or the new
+void receiveWeightChunk(const WeightChunkView &msg) {
+  uint32_t length = msg.length() < WeightChunkView::MAX_DATA ? msg.length() : WeightChunkView::MAX_DATA;
+  if (weightUpload.add(msg.upload(), msg.offset(), msg.size(), msg.crc(), msg.data(), length) == decltype(weightUpload)::COMPLETE) {
+    pbc.setParams(weightUpload.take());
+    if constexpr (BuildConfig::debugOutput) {
+      debugLog.log("Weights: {} swapped in\n", weightUpload.name());
+    }
+  }
+  weightUploadAnswer = true;
+}
+#endif
+
+// Only latches the press; the brake goes out from controlStep(), which owns the ODrive link
+HOT_CODE void estopIsr(){
+  estopLatched = true;
+}
+
+HOT_CODE void brake(){
+  static const float zero[2] = {0.0f, 0.0f};
+  #if defined(TORQUE_CONTROL) || defined(POSITION_CONTROL)
+    commandTorques(zero);
+  #else
+    // in velocity control input_torque is only the feed-forward, so the brake is a zero velocity
+    motorDriver.setVelocities(zero, zero);
+  #endif
+  // the torque after the E-stop goes out even if it equals the one before, and ramps up from zero
+  torqueOutput.invalidate();
+  #if defined(TORQUE_CONTROL)
+    torqueLimiter.reset();
+  #endif
+}
+
+HOT_CODE void readEncoder(float* spokeStates){
+
+  PROFILE_SCOPE(PROFILE_READ_ENCODER);
+  // kept from the last exchange for a reset, which has none
+  static float pos[2] = {0.0f, 0.0f}, vel[2] = {0.0f, 0.0f};
+  if (odriveResetting) {
+    spokes.update(pos, vel, true, micros(), spokeStates);
+    return;
+  }
+  // outside the loop (setup, E-stop) the driver sends the request itself
+  #if defined(MOTOR_DRIVER_BENCHMARK)
+    uint32_t start = micros();
+    feedbackStale = !motorDriver.readFeedback(pos, vel);
+    feedbackTiming.add(micros() - start);
+  #else
+    feedbackStale = !motorDriver.readFeedback(pos, vel);
+  #endif
+  spokes.update(pos, vel, feedbackStale, micros(), spokeStates);
+  #if defined(TRANSPORT_METER)
+    // in the ODrive's sign, which Iq_measured shares, whatever the spoke rates are estimated from
+    motorRate[0] = 2.0f*(float)M_PI*vel[0];
+    motorRate[1] = 2.0f*(float)M_PI*vel[1];
+  #endif
+  #if defined(GYRO_BIAS_ONLINE)
+    wheelAtRest = !feedbackStale && fabsf(spokeStates[2]) < GYRO_BIAS_STILL_SPOKE_RATE
+                  && fabsf(spokeStates[3]) < GYRO_BIAS_STILL_SPOKE_RATE;
+  #endif
+}
+
+// Shift one calibrated sample to the COM and run the filter over dt seconds;
+// gyro in rad/s, accel in m/s^2, mag in uT. Without accel the filter only
+// integrates the gyro (Mahony skips its feedback on a zero accel).
+HOT_CODE void fuseImuSample(const Vec3& gyroSample, const Vec3* accel, const Vec3& mag, float dt){
+
+  PROFILE_SCOPE(PROFILE_FUSE_IMU);
+  // the boot calibration's zero rate drifts; the rest of the step sees the corrected rate
+  #if defined(GYRO_BIAS_ONLINE)
+    gyroBias.update(gyroSample, accel, dt, estopActive || wheelAtRest);
+    const Vec3 gyro = gyroBias.correct(gyroSample);
+  #else
+    const Vec3& gyro = gyroSample;
+  #endif
+
+  // the angular acceleration for the COM shift from the dynamics, or the differenced gyro
+  #if defined(MODEL_EKF)
+    torso.fuse(gyro, accel, mag, dt, modelTorsoAlpha);
+  #else
+    torso.fuse(gyro, accel, mag, dt);
+  #endif
+  #if defined(FLIGHT_RECORDER)
+    recordGyro = gyro;
+    if (accel) recordAccel = *accel;
+  #endif
+  #if defined(SPECTRUM_MONITOR)
+    if (accel) spectrum.push(sqrtf(dot(*accel, *accel)));
+  #endif
+}
+
+// The new IMU samples into the filter; nothing to do on a tick without one
+HOT_CODE void fuseImu(){
+
+  //All angles are given in radians.
+  Vec3 gyro, accel;
+  #if IMU_MODE == IMU_MODE_DATA_READY
+    // only fresh samples go into the filter, integrated over the time between their edges
+    static uint32_t lastImuSeq = 0;
+    static uint32_t lastImuStamp_us = 0;
+    ImuRawSample sample;
+    if (!imu_latest(sample) || sample.seq == lastImuSeq) {
+      return;
+    }
+    float dt = (sample.stamp_us - lastImuStamp_us) * 1e-6f;
+    if (lastImuSeq == 0 || dt > 10.0f*samplingTime) dt = samplingTime; // first sample or after a pause
+    lastImuSeq = sample.seq;
+    lastImuStamp_us = sample.stamp_us;
+    int16_t mag[3];
+    imu_apply_all(imuTransform, sample.gyro, sample.accel, mag_read_raw(mag) ? mag : nullptr, gyro, accel, imuMag);
+    IMPACT_ACCEL_SAMPLE(accel, sample.stamp_us);
+    fuseImuSample(gyro, &accel, imuMag, dt);
+  #elif IMU_MODE == IMU_MODE_FIFO
+    // every batched sample goes through the filter; the magnetometer is read once per tick
+    static ImuFifoSample samples[IMU_FIFO_MAX_SAMPLES];
+    #if defined(IMU_FIFO_BATCH_CALIBRATE)
+      static ImuBatch<IMU_FIFO_MAX_SAMPLES> calibrated;
+    #endif
+    #if defined(IMU_FIFO_DECIMATE)
+      static float decimateRows[IMU_FIFO_MAX_SAMPLES][6];
+    #endif
+    static uint32_t lastFifoStamp_us = 0;
+    const float fifoPeriod = 1.0f/lsm6ds_rate_hz(imuSettings.rate);
+    uint16_t count = drain_fifo(samples, IMU_FIFO_MAX_SAMPLES);
+    if (count == 0) {
+      return;
+    }
+    mag_read_fast(imuMag);
+    #if defined(IMU_FIFO_BATCH_CALIBRATE)
+      imu_apply_batch(imuTransform, samples, count, calibrated);
+    #endif
+    const uint32_t drain_us = micros();
+    for (uint16_t n = 0; n < count; n++) {
+      float dt = fifoPeriod;
+      #if defined(IMU_FIFO_TIMESTAMPS)
+        uint32_t elapsed_us = samples[n].stamp_us - lastFifoStamp_us;
+        if (lastFifoStamp_us != 0 && elapsed_us > 0 && elapsed_us < 4.0f*fifoPeriod*1e6f) dt = elapsed_us * 1e-6f;
+        lastFifoStamp_us = samples[n].stamp_us;
+      #endif
+      #if defined(IMU_FIFO_BATCH_CALIBRATE)
+        gyro = calibrated.gyroAt(n);
+        accel = calibrated.accelAt(n);
+      #else
+        gyro = imu_apply(imuTransform.gyro, samples[n].gyro);
+        accel = imu_apply(imuTransform.accel, samples[n].accel);
+      #endif
+      // back from the drain by the sensor's clock, or by the ODR without timestamps; the newest sample is ~now
+      IMPACT_ACCEL_SAMPLE(accel, samples[count - 1].stamp_us != 0
+                                   ? drain_us - (samples[count - 1].stamp_us - samples[n].stamp_us)
+                                   : drain_us - (uint32_t)((count - 1 - n)*fifoPeriod*1e6f));
+      fuseImuSample(gyro, &accel, imuMag, dt);
+      #if defined(IMU_FIFO_DECIMATE)
+        gyro.to(decimateRows[n]);
+        accel.to(decimateRows[n] + 3);
+      #endif
+    }
+    #if defined(IMU_FIFO_DECIMATE)
+      // the attitude integrates every sample; the rate the controller sees is the batch's band-limited one
+      float decimated[6];
+      imuDecimator.push(decimateRows[0], count);
+      imuDecimator.output(decimated);
+      #if defined(GYRO_BIAS_ONLINE)
+        const Vec3 rate = gyroBias.correct(Vec3(decimated[0], decimated[1], decimated[2]));
+      #else
+        const Vec3 rate(decimated[0], decimated[1], decimated[2]);
+      #endif
+      torso.setRate(rate.x);
+      #if defined(FLIGHT_RECORDER)
+        recordGyro = rate;
+        recordAccel = Vec3(decimated[3], decimated[4], decimated[5]);
+      #endif
+    #endif
+  #elif IMU_MODE == IMU_MODE_BURST && defined(MULTI_RATE_STEP)
+    // gyro every tick; accel and magnetometer come from their tasks in controlStep()
+    (void)accel;
+    #if defined(IMU_ASYNC_BURST)
+      uint8_t length = imus.join(torsoImu);
+      if (length == 0) {
+        return;
+      }
+      gyro = imus.gyro(torsoImu);
+      if (length == 12) imuAccel = imus.accel(torsoImu);
+      imuAccelFresh = length == 12;
+    #else
+      if (!gyro_read_fast(gyro)) {
+        return;
+      }
+    #endif
+    if (imuAccelFresh) IMPACT_ACCEL_SAMPLE(imuAccel, micros());
+    fuseImuSample(gyro, imuAccelFresh ? &imuAccel : nullptr, imuMag, samplingTime);
+    imuAccelFresh = false;
+  #elif IMU_MODE == IMU_MODE_BURST
+    #if defined(IMU_ASYNC_BURST)
+      if (imus.join(torsoImu) != 12) {
+        return;
+      }
+      gyro = imus.gyro(torsoImu);
+      accel = imus.accel(torsoImu);
+      mag_read_fast(imuMag);
+    #else
+      int16_t gyroRaw[3], accelRaw[3], mag[3];
+      if (!imu_read_raw(gyroRaw, accelRaw)) {
+        return;
+      }
+      imu_apply_all(imuTransform, gyroRaw, accelRaw, mag_read_raw(mag) ? mag : nullptr, gyro, accel, imuMag);
+    #endif
+    IMPACT_ACCEL_SAMPLE(accel, micros());
+    fuseImuSample(gyro, &accel, imuMag, samplingTime);
+  #else
+    sensors_event_t accelEvent, gyroEvent, magEvent;
+    accelerometer->getEvent(&accelEvent);
+    gyroscope->getEvent(&gyroEvent);
+    magnetometer->getEvent(&magEvent);
+    // the calibration from imuEventTransform, built once in setup() instead of cal.calibrate() per event
+    imu_apply_all(imuEventTransform, gyroEvent.gyro.v, accelEvent.acceleration.v, magEvent.magnetic.v,
+                  gyro, accel, imuMag);
+    IMPACT_ACCEL_SAMPLE(accel, micros());
+    fuseImuSample(gyro, &accel, imuMag, samplingTime);
+  #endif
+
+}
 
-  // Gyroscope needs to be converted from Rad/s to Degree/s
-  // the rest are not unit-important
-  float gx, gy, gz;
-  gx = gyro.gyro.x * SENSORS_RADS_TO_DPS;
-  gy = gyro.gyro.y * SENSORS_RADS_TO_DPS;
-  gz = gyro.gyro.z * SENSORS_RADS_TO_DPS;
+// Torso roll, rate and yaw after this tick's IMU samples, from the filter's state
+HOT_CODE void readIMU(float* torsoStates){
 
-  // Update the SensorFusion filter
-  filter.update(gx, gy, gz, 
-                acc_COM[0], acc_COM[1], acc_COM[2], 
-                mag.magnetic.x, mag.magnetic.y, mag.magnetic.z);
+  PROFILE_SCOPE(PROFILE_READ_IMU);
+  fuseImu();
+  torso.states(torsoStates);
+}
 
-  torsoStates[0] = -filter.getRoll() * 1.0f/SENSORS_RADS_TO_DPS;
-  torsoStates[1] = -gyro.gyro.x;
-  torsoStates[2] = filter.getYaw() * 1.0f/SENSORS_RADS_TO_DPS - yawOffset;
-  // torsoStates[2]   = filter.getPitch() * 1.0f/SENSORS_RADS_TO_DPS - yawOffset;
-  oldTorsoOmega = torsoStates[1];
+#if defined(WHEEL_IMU)
+// Spoke 0's rate from the hub gyro: the wheel's rate about the axle less the torso's, which
+// is what the encoder measures, without differencing its angle; the last one through a
+// failed read. After readIMU(), for the torso rate.
+HOT_CODE float readWheelImu(const float* torsoStates){
 
-  return torsoStates;
+  static float rate = 0.0f;
+  uint8_t length = imus.join(wheelImu);
+  if (length == 0) {
+    return rate;
+  }
+  #if defined(GYRO_BIAS_ONLINE)
+    wheelGyroBias.update(imus.gyro(wheelImu), length == 12 ? &imus.accel(wheelImu) : nullptr, samplingTime,
+                         estopActive || wheelAtRest);
+    const float axle = wheelGyroBias.correct(imus.gyro(wheelImu)).x;
+  #else
+    const float axle = imus.gyro(wheelImu).x;
+  #endif
+  // the torso rate is about -x of its IMU, so its x rate is -torsoStates[1]
+  rate = WHEEL_IMU_DIRECTION*(axle + torsoStates[1]);
+  return rate;
 }
+#endif
 
-void publishSensorStates(const float* torsoStates, const float* spokeStates) {
+void publishSensorStates(const float* torsoStates, const float* spokeStates, uint32_t seq, uint32_t stamp_us, uint8_t status,
+                         const float* current, float vbus) {
 
+  PROFILE_SCOPE(PROFILE_PUBLISH_SENSORS);
+  #if defined(COMMAND_LATENCY)
+    commandLatency.sent(seq, stamp_us);
+  #endif
   float encPos0 = spokeStates[0];
   float encPos1 = spokeStates[1];
   float encVel0 = spokeStates[2];
@@ -437,113 +2915,1125 @@ void publishSensorStates(const float* torsoStates, const float* spokeStates) {
   float torsoOmega = torsoStates[1];
   float yaw = torsoStates[2];
 
-  #if defined(AHRS_DEBUG_OUTPUT)
-    Serial.print("Sensor: ");
-    Serial.print(torsoRoll);
-    Serial.print(", ");
-    Serial.print(encPos0);
-    Serial.print(", ");
-    Serial.print(encPos1);
-    Serial.print(", ");
-    // Serial.print(encPos0 - (-torsoRoll));
-    // Serial.print(", ");
-    // Serial.print(encPos1 - (torsoRoll));
-    // Serial.print(", ");
-    Serial.println(yaw);
-    Serial.print("Angular velocities: ");
-    Serial.println(torsoOmega);
-    Serial.print(", ");
-    Serial.print(encVel0);
-    Serial.print(", ");
-    Serial.println(encVel1);
-  #endif
-
-  sensorStates.header = std_msgs::Header();
-  sensorStates.header.stamp = nh.now();
-  sensorStates.position_length = 4;
-  sensorStates.velocity_length = 3;
-
-  float sensorPosition[4] = 
-      {
-      torsoRoll, encPos0, encPos1, yaw
+  if constexpr (BuildConfig::debugOutput) {
+    debugLog.log("Sensor: {}, {}, {}, {}\nAngular velocities: {}, {}, {}\n",
+                 torsoRoll, encPos0, encPos1, yaw, torsoOmega, encVel0, encVel1);
+  }
+
+  #if defined(PACKED_SENSOR_MSG)
+    sensorStates.seq = seq;
+    sensorStates.stamp_us = stamp_us;
+    sensorStates.torso_roll = torsoRoll;
+    sensorStates.torso_omega = torsoOmega;
+    sensorStates.yaw = yaw;
+    sensorStates.spoke_angle[0] = encPos0;
+    sensorStates.spoke_angle[1] = encPos1;
+    sensorStates.spoke_omega[0] = encVel0;
+    sensorStates.spoke_omega[1] = encVel1;
+    sensorStates.status = status;
+    sensorStates.motor_current[0] = current[0];
+    sensorStates.motor_current[1] = current[1];
+    sensorStates.vbus_voltage = vbus;
+    #if defined(SENSOR_PUBLISH_FIXED)
+      nh.publishFixed(sensors.id_, sensorStates);
+    #else
+      sensors.publish(&sensorStates);
+    #endif
+  #else
+    (void)stamp_us;
+    (void)status;
+    (void)current;
+    (void)vbus;
+
+    // rospy (rosserial_python, RobotOS.jl) renumbers header.seq on publish,
+    // so the seq also travels as text in frame_id, which the controllers echo
+    static char seqText[11];
+    snprintf(seqText, sizeof(seqText), "%lu", (unsigned long)seq);
+    sensorStates.header = std_msgs::Header();
+    sensorStates.header.seq = seq;
+    sensorStates.header.frame_id = seqText;
+    sensorStates.header.stamp = nh.now();
+    sensorStates.position_length = 4;
+    sensorStates.velocity_length = 3;
+
+    float sensorPosition[4] = 
+        {
+        torsoRoll, encPos0, encPos1, yaw
+        };
+    float sensorVelocity[3] = 
+        {
+        torsoOmega, encVel0, encVel1
       };
-  float sensorVelocity[3] = 
-      {
-      torsoOmega, encVel0, encVel1
-    };
 
-  sensorStates.position = sensorPosition;
-  sensorStates.velocity = sensorVelocity;
-  sensors.publish(&sensorStates);
+    sensorStates.position = sensorPosition;
+    sensorStates.velocity = sensorVelocity;
+    sensors.publish(&sensorStates);
+  #endif
 
 }
 
-void calibrateMotor(bool motornum) {
-  char c = motornum+'0';
-  int requested_state;
+#if defined(SENSOR_BATCH)
+// The samples as offsets from the first one's stamp; unused slots go out zeroed.
+// Only the newest reaches the controller, so it alone is timed for COMMAND_LATENCY.
+void publishSensorBatch(const SampleBatcher<SensorSnapshot, raspi_pkg::SensorBatch::MAX_SAMPLES>::Batch& batch) {
+
+  PROFILE_SCOPE(PROFILE_PUBLISH_SENSORS);
+  const SensorSnapshot& first = batch.samples[0];
+  const SensorSnapshot& newest = batch.samples[batch.count - 1];
+  #if defined(COMMAND_LATENCY)
+    commandLatency.sent(newest.seq, newest.stamp_us);
+  #endif
 
-  requested_state = AXIS_STATE_MOTOR_CALIBRATION;
-  Serial << "Axis" << c << ": Requesting state " << requested_state << '\n';
-  if(!ODrive.run_state(motornum, requested_state, true)) return;
+  sensorBatch.seq = first.seq;
+  sensorBatch.stamp_us = first.stamp_us;
+  sensorBatch.stride = sensorBatcher.stride();
+  sensorBatch.count = batch.count;
+  for (uint8_t i = 0; i < raspi_pkg::SensorBatch::MAX_SAMPLES; ++i) {
+    raspi_pkg::SensorSample& out = sensorBatch.samples[i];
+    if (i >= batch.count) {
+      out = raspi_pkg::SensorSample();
+      continue;
+    }
+    const SensorSnapshot& sample = batch.samples[i];
+    out.offset_us = (uint16_t)(sample.stamp_us - first.stamp_us);
+    out.torso_roll = sample.torso[0];
+    out.torso_omega = sample.torso[1];
+    out.yaw = sample.torso[2];
+    out.spoke_angle[0] = sample.spoke[0];
+    out.spoke_angle[1] = sample.spoke[1];
+    out.spoke_omega[0] = sample.spoke[2];
+    out.spoke_omega[1] = sample.spoke[3];
+    out.status = sample.status;
+    out.motor_current[0] = sample.current[0];
+    out.motor_current[1] = sample.current[1];
+    out.vbus_voltage = sample.vbus;
+  }
 
-  requested_state = AXIS_STATE_ENCODER_OFFSET_CALIBRATION;
-  Serial << "Axis" << c << ": Requesting state " << requested_state << '\n';
-  if(!ODrive.run_state(motornum, requested_state, true, 25.0f)) return;
+  if constexpr (BuildConfig::debugOutput) {
+    debugLog.log("Sensor batch: {} from {}, newest {}, {}, {}, {}\n", (int)batch.count, first.seq,
+                 newest.torso[0], newest.spoke[0], newest.spoke[1], newest.torso[2]);
+  }
 
-  requested_state = AXIS_STATE_CLOSED_LOOP_CONTROL;
-  Serial << "Axis" << c << ": Requesting state " << requested_state << '\n';
-  if(!ODrive.run_state(motornum, requested_state, false /*don't wait*/)) return;
+  #if defined(SENSOR_PUBLISH_FIXED)
+    nh.publishFixed(sensorBatches.id_, sensorBatch);
+  #else
+    sensorBatches.publish(&sensorBatch);
+  #endif
 }
+#endif
+
+#if defined(SENSOR_DELTA)
+// One frame of count samples, stride control steps apart, coded against the previous
+// frame's last sample or, every SENSOR_DELTA_KEYFRAME samples, against zero
+void publishSensorDelta(const SensorSnapshot* samples, uint8_t count, uint8_t stride) {
 
-int64_t readErrors() {
-  int64_t errors[9];
-  errorStates.data_length = 9;
+  PROFILE_SCOPE(PROFILE_PUBLISH_SENSORS);
+  #if defined(COMMAND_LATENCY)
+    commandLatency.sent(samples[count - 1].seq, samples[count - 1].stamp_us);
+  #endif
 
-  errors[0] = readODriveErrors();
+  static uint8_t data[raspi_pkg::SensorBatch::MAX_SAMPLES*raspi_pkg::SensorDelta::NUM_CHANNELS*DeltaEncoder::max_varint];
+  static uint16_t frame = 0;
+  typedef raspi_pkg::SensorDelta D;
+  uint8_t* out = data;
+  sensorDelta.flags = sensorEncoder.beginFrame() ? D::FLAG_KEYFRAME : 0;
+  for (uint8_t i = 0; i < count; ++i) {
+    const SensorSnapshot& sample = samples[i];
+    int32_t q[D::NUM_CHANNELS];
+    q[D::CH_STAMP_US] = (int32_t)sample.stamp_us;
+    q[D::CH_TORSO_ROLL] = DeltaEncoder::quantize(sample.torso[0], D::ANGLE_LSB);
+    q[D::CH_TORSO_OMEGA] = DeltaEncoder::quantize(sample.torso[1], D::RATE_LSB);
+    q[D::CH_YAW] = DeltaEncoder::quantize(sample.torso[2], D::ANGLE_LSB);
+    q[D::CH_SPOKE_ANGLE_0] = DeltaEncoder::quantize(sample.spoke[0], D::ANGLE_LSB);
+    q[D::CH_SPOKE_ANGLE_1] = DeltaEncoder::quantize(sample.spoke[1], D::ANGLE_LSB);
+    q[D::CH_SPOKE_OMEGA_0] = DeltaEncoder::quantize(sample.spoke[2], D::RATE_LSB);
+    q[D::CH_SPOKE_OMEGA_1] = DeltaEncoder::quantize(sample.spoke[3], D::RATE_LSB);
+    q[D::CH_STATUS] = sample.status;
+    q[D::CH_MOTOR_CURRENT_0] = DeltaEncoder::quantize(sample.current[0], D::CURRENT_LSB);
+    q[D::CH_MOTOR_CURRENT_1] = DeltaEncoder::quantize(sample.current[1], D::CURRENT_LSB);
+    q[D::CH_VBUS_VOLTAGE] = DeltaEncoder::quantize(sample.vbus, D::VOLTAGE_LSB);
+    sensorEncoder.add(q, out, data + sizeof(data));
+  }
 
-  errors[1] = readMotorErrors(0);
-  errors[2] = readMotorErrors(1);
+  sensorDelta.frame = frame++;
+  sensorDelta.seq = samples[0].seq;
+  sensorDelta.stride = stride;
+  sensorDelta.count = count;
+  sensorDelta.data = data;
+  sensorDelta.data_length = out - data;
+  sensorDeltas.publish(&sensorDelta);
+}
+#endif
 
-  errors[3] = readAxisErrors(0);
-  errors[4] = readAxisErrors(1);
+// Motor and encoder calibration, then closed loop, run by controlStep() through
+// AxisCalibration; call with the control step paused (or before it started).
+// With ODRIVE_FAST_BOOT the ODrive is asked first: after a boot that loaded its saved
+// config, motor.is_calibrated and encoder.is_ready say which offsets are already valid,
+// and a pre_calibrated encoder on an index only needs the short index search.
+void startCalibration(bool motornum) {
+  bool motorReady = false, encoderReady = false, indexOnly = false;
+
+  #if defined(ODRIVE_FAST_BOOT)
+    if (ODrive.readProperty(-1, "user_config_loaded") == 1) {
+      motorReady = ODrive.readProperty(motornum, "motor.is_calibrated") == 1;
+      encoderReady = ODrive.readProperty(motornum, "encoder.is_ready") == 1;
+      indexOnly = !encoderReady && ODrive.readProperty(motornum, "encoder.config.pre_calibrated") == 1
+                  && ODrive.readProperty(motornum, "encoder.config.use_index") == 1;
+    }
+  #endif
 
-  errors[5] = readEncoderErrors(0);
-  errors[6] = readEncoderErrors(1);
+  #if defined(PERSIST_REFERENCES)
+    axisIndexed[motornum] = ODrive.readProperty(motornum, "encoder.config.use_index") == 1;
+  #endif
 
-  errors[7] = readControllerErrors(0);
-  errors[8] = readControllerErrors(1);
+  debugLog.log("Axis{}: calibrating motor {}, encoder {}, index only {}\n", (int)motornum,
+               (int)!motorReady, (int)!encoderReady, (int)indexOnly);
+  calibration.start(motornum, !motorReady, !encoderReady, indexOnly, millis());
+  calibrationChanged = true;
+}
 
-  errorStates.data = errors;
+void readErrors() {
+  errorMonitor.scanAll(micros());
+}
 
-  int64_t ret = 0;
-  for (int i=0; i<9; i++) {
-    ret |= errors[i] != 0;
+void publishErrorState() {
+  // the monitor is updated from controlStep()
+  uint16_t nonzero = 0;
+  uint32_t oldest_us = 0;
+  uint8_t count = 0;
+  noInterrupts();
+  uint32_t now = micros();
+  for (int i = 0; i < ODriveErrorMonitor::NUM_REGISTERS; ++i) {
+    auto reg = ODriveErrorMonitor::Register(i);
+    if (errorMonitor.value(reg) != 0) {
+      nonzero |= 1 << i;
+      errorValues[count++] = errorMonitor.value(reg);
+    }
+    uint32_t age_us = errorMonitor.age_us(reg, now);
+    if (age_us > oldest_us) oldest_us = age_us;
   }
-  
-  return ret;
+  errorStates.changes = errorMonitor.changes();
+  interrupts();
+  errorStates.nonzero = nonzero;
+  #if defined(HEALTH_SUMMARY)
+    health.odrive(nonzero);
+  #endif
+  errorStates.age_ms = oldest_us / 1000 > UINT16_MAX ? UINT16_MAX : oldest_us / 1000;
+  errorStates.values_length = count;
+  linkPublish(LINK_STATUS, odriveErrors, &errorStates);
 }
 
-int64_t readODriveErrors() {
-    odriveSerial << "error" << "\n";
-    return ODrive.readlong();
+void publishProfile() {
+  static const char* const keys[5] = {"count", "min_us", "mean_us", "max_us", "p99_us"};
+  static char values[5][16];
+  diagnostic_msgs::KeyValue keyValues[5];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  for (int section = 0; section < NUM_PROFILE_SECTIONS; ++section) {
+    CycleProfiler::Stats stats;
+    profiler.snapshot(section, stats);
+    #if defined(HEALTH_SUMMARY)
+      if (section == PROFILE_CONTROL_STEP) health.step(stats.mean_us, stats.p99_us, stats.max_us);
+      else if (section == PROFILE_READ_IMU) health.imu(stats.max_us);
+      else if (section == PROFILE_READ_ENCODER) health.encoder(stats.p99_us, stats.max_us);
+    #endif
+    snprintf(values[0], sizeof(values[0]), "%lu", (unsigned long)stats.count);
+    snprintf(values[1], sizeof(values[1]), "%.1f", stats.min_us);
+    snprintf(values[2], sizeof(values[2]), "%.1f", stats.mean_us);
+    snprintf(values[3], sizeof(values[3]), "%.1f", stats.max_us);
+    snprintf(values[4], sizeof(values[4]), "%.1f", stats.p99_us);
+    for (int i = 0; i < 5; ++i) {
+      keyValues[i].key = keys[i];
+      keyValues[i].value = values[i];
+    }
+
+    // a control step that can run past its period is worth a warning
+    bool late = section == PROFILE_CONTROL_STEP && stats.max_us >= BuildConfig::controlPeriod_us;
+    status.level = late ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+    status.name = profiler.name(section);
+    status.message = late ? "overran control period" : "";
+    status.hardware_id = "teensy";
+    status.values_length = 5;
+    status.values = keyValues;
+    HEALTH_LEVEL(status);
+
+    profileArray.header.stamp = nh.now();
+    profileArray.status_length = 1;
+    profileArray.status = &status;
+    linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+  }
 }
 
-int64_t readMotorErrors(int motor_number) {
-    odriveSerial << "r axis" << motor_number << ".motor.error" << "\n";
-    return ODrive.readlong();
+#if defined(MULTI_RATE_STEP)
+void publishRateTasks() {
+  static const char* const keys[6] = {"divider", "budget_us", "runs", "over_budget", "mean_us", "max_us"};
+  static char values[6][16];
+  diagnostic_msgs::KeyValue keyValues[6];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  for (RateTask* task : rateTasks) {
+    RateTask::Window window;
+    task->snapshot(window);
+    snprintf(values[0], sizeof(values[0]), "%u", (unsigned)task->divider());
+    snprintf(values[1], sizeof(values[1]), "%lu", (unsigned long)task->budget_us());
+    snprintf(values[2], sizeof(values[2]), "%lu", (unsigned long)window.runs);
+    snprintf(values[3], sizeof(values[3]), "%lu", (unsigned long)window.over_budget);
+    snprintf(values[4], sizeof(values[4]), "%lu", (unsigned long)window.mean_us);
+    snprintf(values[5], sizeof(values[5]), "%lu", (unsigned long)window.max_us);
+    for (int i = 0; i < 6; ++i) {
+      keyValues[i].key = keys[i];
+      keyValues[i].value = values[i];
+    }
+
+    bool over = window.over_budget > 0;
+    status.level = over ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+    status.name = task->name();
+    status.message = over ? "over budget" : "";
+    status.hardware_id = "teensy";
+    status.values_length = 6;
+    status.values = keyValues;
+    HEALTH_LEVEL(status);
+
+    profileArray.header.stamp = nh.now();
+    profileArray.status_length = 1;
+    profileArray.status = &status;
+    linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+  }
 }
+#endif
+
+// One status per background job: its slices in the last window and the longest of them
+void publishBackground() {
+  static const char* const keys[6] = {"slice_us", "slices", "waits", "over_slice", "mean_us", "max_us"};
+  static char values[6][16];
+  diagnostic_msgs::KeyValue keyValues[6];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  for (uint8_t i = 0; i < background.count(); ++i) {
+    const Protothread& job = background.thread(i);
+    Protothread::Window window;
+    background.snapshot(i, window);
+    #if defined(HEALTH_SUMMARY)
+      health.background(window.over_slice);
+    #endif
+    snprintf(values[0], sizeof(values[0]), "%lu", (unsigned long)job.slice_us());
+    snprintf(values[1], sizeof(values[1]), "%lu", (unsigned long)window.slices);
+    snprintf(values[2], sizeof(values[2]), "%lu", (unsigned long)window.waits);
+    snprintf(values[3], sizeof(values[3]), "%lu", (unsigned long)window.over_slice);
+    snprintf(values[4], sizeof(values[4]), "%lu", (unsigned long)window.mean_us);
+    snprintf(values[5], sizeof(values[5]), "%lu", (unsigned long)window.max_us);
+    for (int k = 0; k < 6; ++k) {
+      keyValues[k].key = keys[k];
+      keyValues[k].value = values[k];
+    }
 
-int64_t readAxisErrors(int axis_number) {
-    odriveSerial << "r axis" << axis_number << ".error" << "\n";
-    return ODrive.readlong();
+    bool over = window.over_slice > 0;
+    status.level = over ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+    status.name = job.name();
+    status.message = over ? "slice over BACKGROUND_SLICE_US" : "";
+    status.hardware_id = "teensy";
+    status.values_length = 6;
+    status.values = keyValues;
+    HEALTH_LEVEL(status);
+
+    profileArray.header.stamp = nh.now();
+    profileArray.status_length = 1;
+    profileArray.status = &status;
+    linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+  }
 }
 
-int64_t readEncoderErrors(int encoder_number) {
-    odriveSerial << "r axis" << encoder_number << ".encoder.error" << "\n";
-    return ODrive.readlong();
+void publishLoopTiming() {
+  LoopTiming::Window window;
+  loopTiming.snapshot(window);
+  #if defined(HEALTH_SUMMARY)
+    health.loop(window.samples, window.misses, window.min_period_us, window.max_period_us, window.mean_latency_us,
+                window.max_latency_us);
+  #endif
+  loopTimingData[0] = window.samples;
+  loopTimingData[1] = window.misses;
+  loopTimingData[2] = window.min_period_us;
+  loopTimingData[3] = window.max_period_us;
+  loopTimingData[4] = window.max_latency_us;
+  loopTimingData[5] = window.mean_latency_us;
+  loopTimingData[6] = loopTiming.firstBin_us();
+  loopTimingData[7] = loopTiming.bin_us();
+  for (int i = 0; i < LoopTiming::num_bins; ++i) {
+    loopTimingData[8 + i] = window.bins[i];
+  }
+  linkPublish(LINK_TELEMETRY, loopTimingPub, &loopTimingStates);
+}
+
+#if defined(LINK_GOVERNOR)
+// The mode and the change into it: from where, why, and its measure (us, bytes, or the us the
+// fallback was held); the changes so far, the telemetry frames shed and the debug lines dropped
+void publishLinkGovernor() {
+  static const char* const keys[8] = {"mode", "from", "reason", "value", "transitions", "held_ms", "telemetry_shed",
+                                      "debug_dropped"};
+  static const char* const messages[LinkGovernor::NUM_MODES] = {
+    "", "telemetry reduced", "telemetry reduced, debug text held", "the Pi's torque replaced on board", "braked"};
+  static char values[8][16];
+  diagnostic_msgs::KeyValue keyValues[8];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  noInterrupts();
+  LinkGovernor::Transition change = linkGovernor.last();
+  uint8_t mode = linkGovernor.mode();
+  uint32_t transitions = linkGovernor.transitions();
+  uint32_t held_us = linkGovernor.held_us(micros());
+  interrupts();
+  snprintf(values[0], sizeof(values[0]), "%s", LinkGovernor::name(mode));
+  snprintf(values[1], sizeof(values[1]), "%s", LinkGovernor::name(change.from));
+  snprintf(values[2], sizeof(values[2]), "%s", LinkGovernor::reasonName(change.reason));
+  snprintf(values[3], sizeof(values[3]), "%lu", (unsigned long)change.value);
+  snprintf(values[4], sizeof(values[4]), "%lu", (unsigned long)transitions);
+  snprintf(values[5], sizeof(values[5]), "%lu", (unsigned long)(held_us / 1000));
+  snprintf(values[6], sizeof(values[6]), "%lu", (unsigned long)linkTelemetryShed);
+  snprintf(values[7], sizeof(values[7]), "%lu", (unsigned long)debugLog.dropped());
+  for (int i = 0; i < 8; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  // shedding load is a warning, the Pi losing the wheel an error
+  status.level = mode >= LinkGovernor::FALLBACK ? diagnostic_msgs::DiagnosticStatus::ERROR
+               : mode > LinkGovernor::NORMAL ? diagnostic_msgs::DiagnosticStatus::WARN
+               : diagnostic_msgs::DiagnosticStatus::OK;
+  status.message = messages[mode < LinkGovernor::NUM_MODES ? mode : 0];
+  status.name = "link_governor";
+  status.hardware_id = "teensy";
+  status.values_length = 8;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_STATUS, diagnostics, &profileArray);
+}
+#endif
+
+#if defined(HEALTH_SUMMARY)
+// The summary of the second's counters, one status in one frame. Each value is a source's figures
+// joined by '/', a source that did not report in the window left out:
+//   step_us    control step mean/p99/max     odrive_us  ODrive exchange p99/max, imu_us the IMU read's max
+//   loop       misses/jitter_us/mean_latency_us/max_latency_us
+//   cpu        load_permille/control_permille
+//   link       status_frames/telemetry_frames/dropped/sensor_dropped, queued now and dropped in the window
+//   i2c        Wire/Wire1 max_permille       command_us p50/p99/lost
+//   overruns, over_slice (background), odrive_errors (the non-zero registers' bits), stack_used
+void publishHealth() {
+  static const char* keys[12];
+  static char values[12][24];
+  diagnostic_msgs::KeyValue keyValues[12];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  health.overruns(controlScheduler.overruns());
+  FlightHealthRecord r;
+  health.take(r);
+  #if defined(FLIGHT_RECORDER)
+    flightRecorder.health(r);
+  #endif
+
+  int n = 0;
+  auto add = [&](const char* key) -> char* { keys[n] = key; return values[n++]; };
+  if (r.sources & FlightHealthRecord::STEP) {
+    snprintf(add("step_us"), sizeof(values[0]), "%.1f/%.1f/%.1f", r.step_mean_dus*0.1f, r.step_p99_dus*0.1f,
+             r.step_max_dus*0.1f);
+    snprintf(add("odrive_us"), sizeof(values[0]), "%u/%u", (unsigned)r.encoder_p99_us, (unsigned)r.encoder_max_us);
+    snprintf(add("imu_us"), sizeof(values[0]), "%u", (unsigned)r.imu_max_us);
+  }
+  if (r.sources & FlightHealthRecord::LOOP)
+    snprintf(add("loop"), sizeof(values[0]), "%u/%u/%u/%u", (unsigned)r.misses, (unsigned)r.jitter_us,
+             (unsigned)r.latency_mean_us, (unsigned)r.latency_max_us);
+  if (r.sources & FlightHealthRecord::CPU)
+    snprintf(add("cpu"), sizeof(values[0]), "%u/%u", (unsigned)r.load_permille, (unsigned)r.control_permille);
+  if (r.sources & FlightHealthRecord::LINK)
+    snprintf(add("link"), sizeof(values[0]), "%u/%u/%u/%u", (unsigned)r.queue_depth[0], (unsigned)r.queue_depth[1],
+             (unsigned)r.link_dropped, (unsigned)r.sensor_dropped);
+  if (r.sources & FlightHealthRecord::I2C)
+    snprintf(add("i2c"), sizeof(values[0]), "%u/%u", (unsigned)r.bus_max_permille[0], (unsigned)r.bus_max_permille[1]);
+  if (r.sources & FlightHealthRecord::COMMAND)
+    snprintf(add("command_us"), sizeof(values[0]), "%u/%u/%u", (unsigned)r.command_p50_us, (unsigned)r.command_p99_us,
+             (unsigned)r.command_lost);
+  snprintf(add("overruns"), sizeof(values[0]), "%u", (unsigned)r.overruns);
+  if (r.sources & FlightHealthRecord::BACKGROUND)
+    snprintf(add("over_slice"), sizeof(values[0]), "%u", (unsigned)r.over_slice);
+  if (r.sources & FlightHealthRecord::ODRIVE)
+    snprintf(add("odrive_errors"), sizeof(values[0]), "0x%02x", (unsigned)r.odrive_errors);
+  if (r.sources & FlightHealthRecord::MEMORY)
+    snprintf(add("stack_used"), sizeof(values[0]), "%lu", (unsigned long)r.stack_used);
+  for (int i = 0; i < n; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  // the worst of the window's statuses, by name
+  status.level = r.level;
+  status.message = health.lastWorst();
+  status.name = "health";
+  status.hardware_id = "teensy";
+  status.values_length = n;
+  status.values = keyValues;
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+}
+#endif
+
+#if defined(COMMAND_LATENCY)
+void publishCommandLatency() {
+  static const char* const keys[11] = {"echoed", "unmatched", "lost", "mean_rtt_us", "max_rtt_us",
+                                       "min_us", "mean_us", "p50_us", "p99_us", "max_us", "bins"};
+  static char values[11][12];
+  static char bins[CommandLatency::num_bins*6 + 16];
+  diagnostic_msgs::KeyValue keyValues[11];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  CommandLatency::Window window;
+  commandLatency.snapshot(window);
+  #if defined(HEALTH_SUMMARY)
+    health.command(commandLatency.quantile_us(window, 0.5f), commandLatency.quantile_us(window, 0.99f), window.lost);
+  #endif
+  snprintf(values[0], sizeof(values[0]), "%lu", (unsigned long)window.echoed);
+  snprintf(values[1], sizeof(values[1]), "%lu", (unsigned long)window.unmatched);
+  snprintf(values[2], sizeof(values[2]), "%lu", (unsigned long)window.lost);
+  snprintf(values[3], sizeof(values[3]), "%lu", (unsigned long)window.mean_rtt_us);
+  snprintf(values[4], sizeof(values[4]), "%lu", (unsigned long)window.max_rtt_us);
+  snprintf(values[5], sizeof(values[5]), "%lu", (unsigned long)window.min_us);
+  snprintf(values[6], sizeof(values[6]), "%lu", (unsigned long)window.mean_us);
+  snprintf(values[7], sizeof(values[7]), "%lu", (unsigned long)commandLatency.quantile_us(window, 0.5f));
+  snprintf(values[8], sizeof(values[8]), "%lu", (unsigned long)commandLatency.quantile_us(window, 0.99f));
+  snprintf(values[9], sizeof(values[9]), "%lu", (unsigned long)window.max_us);
+  // bin width, then the counts of bins [k*width, (k+1)*width)
+  int n = snprintf(bins, sizeof(bins), "%lu:", (unsigned long)commandLatency.bin_us());
+  for (int i = 0; i < CommandLatency::num_bins && n < (int)sizeof(bins); ++i) {
+    n += snprintf(bins + n, sizeof(bins) - n, i ? ",%lu" : "%lu", (unsigned long)window.bins[i]);
+  }
+  for (int i = 0; i < 11; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = i < 10 ? values[i] : bins;
+  }
+
+  // no echo at all means the controller is not echoing, or not running
+  bool silent = window.echoed == 0;
+  status.level = silent ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "command_latency";
+  status.message = silent ? "no /torso_command echoed a /sensors seq" : "";
+  status.hardware_id = "teensy";
+  status.values_length = 11;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+}
+#endif
+
+void publishCalibration() {
+  static const char* const keys[4] = {"axis0", "axis0_ms", "axis1", "axis1_ms"};
+  static char values[2][12];
+  diagnostic_msgs::KeyValue keyValues[4];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  // the phases move on in controlStep()
+  AxisCalibration::Phase phase[2];
+  uint32_t elapsed_ms[2];
+  noInterrupts();
+  uint32_t now = millis();
+  for (int axis = 0; axis < 2; ++axis) {
+    phase[axis] = calibration.phase(axis);
+    elapsed_ms[axis] = calibration.elapsed_ms(axis, now);
+  }
+  interrupts();
+  for (int axis = 0; axis < 2; ++axis) {
+    snprintf(values[axis], sizeof(values[axis]), "%lu", (unsigned long)elapsed_ms[axis]);
+    keyValues[2*axis].key = keys[2*axis];
+    keyValues[2*axis].value = AxisCalibration::name(phase[axis]);
+    keyValues[2*axis + 1].key = keys[2*axis + 1];
+    keyValues[2*axis + 1].value = values[axis];
+  }
+
+  bool timeout = phase[0] == AxisCalibration::TIMEOUT || phase[1] == AxisCalibration::TIMEOUT;
+  status.level = timeout ? diagnostic_msgs::DiagnosticStatus::ERROR : diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "calibration";
+  status.message = timeout ? "an axis did not finish its calibration state" : (calibration.busy() ? "calibrating" : "");
+  status.hardware_id = "teensy";
+  status.values_length = 4;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_STATUS, diagnostics, &profileArray);
+}
+
+#if defined(IMU_CONFIG_MSG)
+#if defined(WEIGHT_UPLOAD)
+// the chunk just handled: which upload, how far it is, what became of the chunk and the weights running
+void publishWeightUpload() {
+  static const char* const keys[5] = {"upload", "received", "size", "swaps", "network"};
+  static char values[4][12];
+  diagnostic_msgs::KeyValue keyValues[5];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  typedef decltype(weightUpload) Upload;
+  snprintf(values[0], sizeof(values[0]), "%lu", (unsigned long)weightUpload.upload());
+  snprintf(values[1], sizeof(values[1]), "%lu", (unsigned long)weightUpload.received());
+  snprintf(values[2], sizeof(values[2]), "%lu", (unsigned long)Upload::file_size);
+  snprintf(values[3], sizeof(values[3]), "%lu", (unsigned long)weightUpload.swaps());
+  for (int i = 0; i < 4; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+  keyValues[4].key = keys[4];
+  keyValues[4].value = weightUpload.swaps() ? weightUpload.name() : "compiled-in";
+
+  Upload::Result result = weightUpload.last();
+  bool refused = result != Upload::ACCEPTED && result != Upload::COMPLETE;
+  status.level = refused ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+  status.message = Upload::describe(result);
+  status.name = "weight_upload";
+  status.hardware_id = "teensy";
+  status.values_length = 5;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_STATUS, diagnostics, &profileArray);
+}
+#endif
+
+void publishImuConfig() {
+  static const char* const keys[5] = {"accel_range_g", "gyro_range_dps", "rate_hz", "mag_range_gauss", "mag_rate_hz"};
+  static char values[5][12];
+  diagnostic_msgs::KeyValue keyValues[5];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  // imuSettings only changes in receiveImuConfig(), which runs from this loop() too
+  const float rate_hz = lsm6ds_rate_hz(imuSettings.rate);
+  snprintf(values[0], sizeof(values[0]), "%u", imu_range(lsm6dsAccelRanges, imuSettings.accel_range)->full_scale);
+  snprintf(values[1], sizeof(values[1]), "%u", imu_range(lsm6dsGyroRanges, imuSettings.gyro_range)->full_scale);
+  snprintf(values[2], sizeof(values[2]), "%.1f", rate_hz);
+  snprintf(values[3], sizeof(values[3]), "%u", imu_range(lis3mdlRanges, imuSettings.mag_range)->full_scale);
+  snprintf(values[4], sizeof(values[4]), "%.3f", lis3mdl_rate_hz(imuSettings.mag_rate, imuSettings.mag_mode));
+  for (int i = 0; i < 5; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.message = "";
+  if (imuConfigResult == IMU_CONFIG_REJECTED) {
+    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+    status.message = "not a range or rate of the sensors, kept these";
+  } else if (imuConfigResult == IMU_CONFIG_FAILED) {
+    status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+    status.message = "a sensor did not take the settings";
+  #if IMU_MODE == IMU_MODE_FIFO
+  } else if (rate_hz > IMU_FIFO_MAX_SAMPLES*BuildConfig::controlRateHz) {
+    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+    status.message = "more samples a tick than IMU_FIFO_MAX_SAMPLES, the FIFO fills";
+  #elif IMU_MODE != IMU_MODE_DATA_READY
+  } else if (rate_hz < BuildConfig::controlRateHz) {
+    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+    status.message = "rate below the control rate, ticks read repeated samples";
+  #endif
+  }
+  status.name = "imu";
+  status.hardware_id = "teensy";
+  status.values_length = 5;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_STATUS, diagnostics, &profileArray);
+}
+#endif
+
+void publishMemory() {
+  static const char* const keys[9] = {"stack_used", "stack_size", "heap_used", "heap_growth", "heap_free",
+                                      "allocs", "allocs_isr", "alloc_bytes", "first_alloc_pc"};
+  static char values[9][12];
+  diagnostic_msgs::KeyValue keyValues[9];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  MemoryBudget::Layout layout;
+  MemoryBudget::layout(layout);
+  uint32_t stackUsed = MemoryBudget::stackUsed();
+  uint32_t heapUsed = MemoryBudget::heapUsed();
+  MemoryBudget::Allocations allocations;
+  MemoryBudget::allocations(allocations);
+  #if defined(HEALTH_SUMMARY)
+    health.memory(stackUsed);
+  #endif
+  snprintf(values[0], sizeof(values[0]), "%lu", (unsigned long)stackUsed);
+  snprintf(values[1], sizeof(values[1]), "%lu", (unsigned long)layout.stack_size);
+  snprintf(values[2], sizeof(values[2]), "%lu", (unsigned long)heapUsed);
+  snprintf(values[3], sizeof(values[3]), "%ld", (long)(heapUsed - heapAtArm));
+  snprintf(values[4], sizeof(values[4]), "%lu", (unsigned long)MemoryBudget::heapFree());
+  snprintf(values[5], sizeof(values[5]), "%lu", (unsigned long)allocations.after_arm);
+  snprintf(values[6], sizeof(values[6]), "%lu", (unsigned long)allocations.interrupt);
+  snprintf(values[7], sizeof(values[7]), "%lu", (unsigned long)allocations.bytes_after_arm);
+  snprintf(values[8], sizeof(values[8]), "0x%08lx", (unsigned long)allocations.first_caller);
+  // the allocation counts only where the allocator is wrapped
+  int count = MemoryBudget::guarded() ? 9 : 5;
+  for (int i = 0; i < count; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  // an allocation in the control step is an error, one in loop() or a stack close to full a warning
+  bool stackLow = stackUsed + STACK_RESERVE_BYTES > layout.stack_size;
+  bool allocating = allocations.after_arm > 0 || heapUsed != heapAtArm;
+  if (allocations.interrupt > 0) {
+    status.level = diagnostic_msgs::DiagnosticStatus::ERROR;
+    status.message = "heap allocation in an interrupt";
+  } else if (allocating || stackLow) {
+    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+    status.message = allocating ? "heap allocation after setup" : "stack high-water near DTCM's end";
+  } else {
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.message = "";
+  }
+  status.name = "memory";
+  status.hardware_id = "teensy";
+  status.values_length = count;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
 }
 
-int64_t readControllerErrors(int controller_number) {
-    odriveSerial << "r axis" << controller_number << ".controller.error" << "\n";
-    return ODrive.readlong();
+#if defined(LINK_SCHEDULER)
+// per class: frames and bytes queued now, the most bytes ever queued, frames dropped for a full
+// queue and bytes sent; and the sensor frames publishFixed() dropped for a full USB buffer
+void publishLink() {
+  static const char* const keys[11] = {"status_frames", "status_bytes", "status_peak_bytes", "status_dropped", "status_sent_bytes",
+                                       "telemetry_frames", "telemetry_bytes", "telemetry_peak_bytes", "telemetry_dropped", "telemetry_sent_bytes",
+                                       "sensor_dropped"};
+  static char values[11][12];
+  diagnostic_msgs::KeyValue keyValues[11];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  bool dropping = false;
+  for (uint8_t c = 0; c < LINK_CLASSES; ++c) {
+    snprintf(values[5*c + 0], sizeof(values[0]), "%u", (unsigned)linkScheduler.depth(c));
+    snprintf(values[5*c + 1], sizeof(values[0]), "%u", (unsigned)linkScheduler.usedBytes(c));
+    snprintf(values[5*c + 2], sizeof(values[0]), "%u", (unsigned)linkScheduler.maxUsedBytes(c));
+    snprintf(values[5*c + 3], sizeof(values[0]), "%lu", (unsigned long)linkScheduler.dropped(c));
+    snprintf(values[5*c + 4], sizeof(values[0]), "%lu", (unsigned long)linkScheduler.sentBytes(c));
+    if (linkScheduler.dropped(c) > 0) dropping = true;
+  }
+  snprintf(values[10], sizeof(values[10]), "%lu", (unsigned long)nh.droppedFrames());
+  #if defined(HEALTH_SUMMARY)
+    health.link(linkScheduler.depth(LINK_STATUS), linkScheduler.depth(LINK_TELEMETRY),
+                linkScheduler.dropped(LINK_STATUS) + linkScheduler.dropped(LINK_TELEMETRY), nh.droppedFrames());
+  #endif
+  for (int i = 0; i < 11; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  status.level = dropping ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+  status.message = dropping ? "link queue overflowed, raise LINK_QUEUE_BYTES or the budgets" : "";
+  status.name = "link";
+  status.hardware_id = "teensy";
+  status.values_length = 11;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
 }
+#endif
+
+#if defined(CPU_LOAD)
+// the last whole window: load and its control step and loop() work parts in per mille, the loop()
+// passes and those that only polled, the polling cost and the background passes turned away
+void publishCpuLoad() {
+  static const char* const keys[8] = {"load_permille", "control_permille", "loop_permille", "passes", "idle_passes",
+                                      "idle_pass_cycles", "background_deferred", "window_ms"};
+  static char values[8][12];
+  diagnostic_msgs::KeyValue keyValues[8];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  const CpuLoad::Window& window = cpuLoad.last();
+  uint16_t load = cpuLoad.loadPermille();
+  #if defined(HEALTH_SUMMARY)
+    health.cpu(load, cpuLoad.interruptPermille());
+  #endif
+  snprintf(values[0], sizeof(values[0]), "%u", (unsigned)load);
+  snprintf(values[1], sizeof(values[1]), "%u", (unsigned)cpuLoad.interruptPermille());
+  snprintf(values[2], sizeof(values[2]), "%u", (unsigned)cpuLoad.workPermille());
+  snprintf(values[3], sizeof(values[3]), "%lu", (unsigned long)window.passes);
+  snprintf(values[4], sizeof(values[4]), "%lu", (unsigned long)window.idle_passes);
+  snprintf(values[5], sizeof(values[5]), "%lu", (unsigned long)window.floor_cycles);
+  snprintf(values[6], sizeof(values[6]), "%lu", (unsigned long)cpuLoad.deferred());
+  snprintf(values[7], sizeof(values[7]), "%lu", (unsigned long)(window.cycles / (F_CPU_ACTUAL / 1000)));
+  for (int i = 0; i < 8; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  bool busy = load > CPU_LOAD_WARN_PERMILLE;
+  status.level = busy ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+  status.message = busy ? "loop() close to never idle, background work deferred" : "";
+  status.name = "cpu_load";
+  status.hardware_id = "teensy";
+  status.values_length = 8;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+}
+#endif
+
+#if defined(CPU_CLOCK_PROFILES)
+void publishCpuClock() {
+  static const char* const keys[6] = {"mode", "mhz", "budget_cycles", "step_max_cycles", "temp_c", "switches"};
+  static char values[6][12];
+  diagnostic_msgs::KeyValue keyValues[6];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  // the step's worst case in the profiler's window, which a switch restarts,
+  // in this mode's cycles against the period's
+  uint32_t mhz = cpuClock.hz() / 1000000;
+  uint32_t budget = cpuClock.budgetCycles(BuildConfig::controlPeriod_us);
+  CycleProfiler::Stats step;
+  profiler.snapshot(PROFILE_CONTROL_STEP, step, false);
+  uint32_t stepMax = (uint32_t)(step.max_us * mhz);
+  snprintf(values[0], sizeof(values[0]), "%s", CpuClock::name(cpuClock.mode()));
+  snprintf(values[1], sizeof(values[1]), "%lu", (unsigned long)mhz);
+  snprintf(values[2], sizeof(values[2]), "%lu", (unsigned long)budget);
+  snprintf(values[3], sizeof(values[3]), "%lu", (unsigned long)stepMax);
+  snprintf(values[4], sizeof(values[4]), "%d", (int)cpuClock.temperature_c());
+  snprintf(values[5], sizeof(values[5]), "%lu", (unsigned long)cpuClock.switches());
+  for (int i = 0; i < 6; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  bool warn = cpuClock.throttled() || stepMax >= budget;
+  status.level = warn ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "cpu_clock";
+  status.message = cpuClock.throttled() ? "boost held back by the die temperature" : (stepMax >= budget ? "step over its cycle budget" : "");
+  status.hardware_id = "teensy";
+  status.values_length = 6;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+}
+#endif
+
+#if defined(IMU_ASYNC_BURST) || defined(ODRIVE_I2C_ASYNC)
+// One AsyncI2C queue: bus busy time over the last tick, and the time charged to each device
+#if defined(SPECTRUM_MONITOR)
+void publishSpectrum() {
+  constexpr int bands = decltype(spectrum)::bands;
+  constexpr int count = 2*bands + 3;
+  static char keys[2*bands][16];
+  static char values[count][12];
+  static bool named = false;
+  static uint32_t lastDropped = 0;
+  diagnostic_msgs::KeyValue keyValues[count];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  if (!named) {
+    for (int b = 0; b < bands; ++b) {
+      snprintf(keys[2*b], sizeof(keys[2*b]), "%g_hz", spectrum.hz(b));
+      snprintf(keys[2*b + 1], sizeof(keys[2*b + 1]), "%g_hz_peak", spectrum.hz(b));
+    }
+    named = true;
+  }
+  decltype(spectrum)::Window window;
+  spectrum.snapshot(window);
+  // RMS of the band's sinusoid, m/s^2: sqrt(P/2)
+  for (int b = 0; b < bands; ++b) {
+    snprintf(values[2*b], sizeof(values[2*b]), "%.4f", sqrtf(0.5f*window.mean[b]));
+    snprintf(values[2*b + 1], sizeof(values[2*b + 1]), "%.4f", sqrtf(0.5f*window.peak[b]));
+    keyValues[2*b].key = keys[2*b];
+    keyValues[2*b].value = values[2*b];
+    keyValues[2*b + 1].key = keys[2*b + 1];
+    keyValues[2*b + 1].value = values[2*b + 1];
+  }
+  snprintf(values[2*bands], sizeof(values[0]), "%.1f", spectrum.rate());
+  snprintf(values[2*bands + 1], sizeof(values[0]), "%lu", (unsigned long)window.blocks);
+  snprintf(values[2*bands + 2], sizeof(values[0]), "%lu", (unsigned long)window.dropped);
+  keyValues[2*bands].key = "rate_hz";
+  keyValues[2*bands].value = values[2*bands];
+  keyValues[2*bands + 1].key = "blocks";
+  keyValues[2*bands + 1].value = values[2*bands + 1];
+  keyValues[2*bands + 2].key = "dropped";
+  keyValues[2*bands + 2].value = values[2*bands + 2];
+
+  bool dropping = window.dropped != lastDropped;
+  lastDropped = window.dropped;
+  status.level = dropping ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "spectrum";
+  status.message = dropping ? "samples dropped, SPECTRUM_BUDGET_US or SPECTRUM_RING is short" : "";
+  status.hardware_id = "teensy";
+  status.values_length = count;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+}
+#endif
+
+#if defined(TERRAIN_ESTIMATOR)
+// The ground TerrainEstimator has learned from the touchdowns so far
+void publishTerrain() {
+  static const char* const keys[9] = {"incline", "predicted", "roughness", "last_incline", "step_height_mm",
+                                      "time_to_impact_ms", "stride_ms", "touchdowns", "obstacles"};
+  static char values[9][12];
+  diagnostic_msgs::KeyValue keyValues[9];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  // controlStep() feeds it
+  noInterrupts();
+  float incline = terrain.incline(), predicted = terrain.predicted(), roughness = terrain.roughness();
+  float last = terrain.lastIncline(), height = terrain.stepHeight(), toImpact = terrain.timeToImpact();
+  float stride = terrain.stride_s();
+  uint32_t touchdowns = terrain.impacts(), obstacles = terrain.obstacles();
+  bool obstacle = terrain.obstacle();
+  interrupts();
+
+  snprintf(values[0], sizeof(values[0]), "%.4f", incline);
+  snprintf(values[1], sizeof(values[1]), "%.4f", predicted);
+  snprintf(values[2], sizeof(values[2]), "%.4f", roughness);
+  snprintf(values[3], sizeof(values[3]), "%.4f", last);
+  snprintf(values[4], sizeof(values[4]), "%.1f", height * 1e3f);
+  snprintf(values[5], sizeof(values[5]), "%.0f", toImpact < 0.0f ? -1.0f : toImpact * 1e3f);
+  snprintf(values[6], sizeof(values[6]), "%.0f", stride * 1e3f);
+  snprintf(values[7], sizeof(values[7]), "%lu", (unsigned long)touchdowns);
+  snprintf(values[8], sizeof(values[8]), "%lu", (unsigned long)obstacles);
+  for (int i = 0; i < 9; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  status.level = obstacle ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "terrain";
+  status.message = obstacle ? "obstacle at the last touchdown" : "";
+  status.hardware_id = "teensy";
+  status.values_length = 9;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+}
+#endif
+
+#if defined(TRANSPORT_METER)
+// The step TransportMeter closed last and the run so far
+void publishTransport() {
+  static const char* const keys[7] = {"cost_of_transport", "work_j", "net_work_j", "power_w", "step_ms",
+                                      "spokes", "run_cost_of_transport"};
+  static char values[7][14];
+  diagnostic_msgs::KeyValue keyValues[7];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  // controlStep() feeds it
+  noInterrupts();
+  TransportMeter<Robot>::Step step = transport.last();
+  float runCost = transport.runCost();
+  interrupts();
+
+  float duration = step.duration_us*1e-6f;
+  snprintf(values[0], sizeof(values[0]), "%.4f", step.cost);
+  snprintf(values[1], sizeof(values[1]), "%.4f", step.positive_uj*1e-6);
+  snprintf(values[2], sizeof(values[2]), "%.4f", step.net_uj*1e-6);
+  snprintf(values[3], sizeof(values[3]), "%.3f", duration > 0.0f ? step.positive_uj*1e-6f/duration : 0.0f);
+  snprintf(values[4], sizeof(values[4]), "%.0f", duration*1e3f);
+  snprintf(values[5], sizeof(values[5]), "%ld", (long)step.spokes);
+  snprintf(values[6], sizeof(values[6]), "%.4f", runCost);
+  for (int i = 0; i < 7; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "transport";
+  status.message = "";
+  status.hardware_id = "teensy";
+  status.values_length = 7;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+}
+#endif
+
+#if defined(STEP_BENCHMARK)
+// One rate of the step benchmark; the tracking and settle times read 0 without ODRIVE_ELECTRICAL_FEEDBACK
+void publishBenchmark(const StepBenchmark::Result& result) {
+  static const char* const keys[13] = {"rate_hz", "samples", "min_period_us", "mean_period_us", "max_period_us", "late",
+                                       "mean_latency_us", "max_latency_us", "tracked", "rms_error_nm", "max_error_nm",
+                                       "mean_settle_us", "max_settle_us"};
+  static char values[13][12];
+  diagnostic_msgs::KeyValue keyValues[13];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  const uint32_t counts[9] = {result.rate_hz, result.samples, result.min_period_us, result.mean_period_us,
+                              result.max_period_us, result.late, result.mean_latency_us, result.max_latency_us,
+                              result.tracked};
+  for (int i = 0; i < 9; ++i) snprintf(values[i], sizeof(values[i]), "%lu", (unsigned long)counts[i]);
+  snprintf(values[9], sizeof(values[9]), "%.4f", result.rms_error);
+  snprintf(values[10], sizeof(values[10]), "%.4f", result.max_error);
+  snprintf(values[11], sizeof(values[11]), "%lu", (unsigned long)result.mean_settle_us);
+  snprintf(values[12], sizeof(values[12]), "%lu", (unsigned long)result.max_settle_us);
+  for (int i = 0; i < 13; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  status.level = result.late > 0 ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "benchmark";
+  status.message = result.late > 0 ? "ticks late by half a period, the step does not fit the rate" : "";
+  status.hardware_id = "teensy";
+  status.values_length = 13;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_STATUS, diagnostics, &profileArray);
+}
+#endif
+
+void publishI2CBus(const char* name, AsyncI2C& bus, uint8_t index) {
+  static const char* const keys[10] = {"busy_permille", "max_permille", "busy_us", "transactions", "failures",
+                                       "rejected", "overflows", "imu_us", "mag_us", "odrive_us"};
+  static char values[10][12];
+  diagnostic_msgs::KeyValue keyValues[10];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  AsyncI2C::Usage usage;
+  bus.usage(usage);
+  bus.resetUsage();
+  #if defined(HEALTH_SUMMARY)
+    health.bus(index, usage.max_permille);
+  #endif
+  snprintf(values[0], sizeof(values[0]), "%u", (unsigned)usage.busy_permille);
+  snprintf(values[1], sizeof(values[1]), "%u", (unsigned)usage.max_permille);
+  snprintf(values[2], sizeof(values[2]), "%lu", (unsigned long)usage.busy_us);
+  snprintf(values[3], sizeof(values[3]), "%u", (unsigned)usage.transactions);
+  snprintf(values[4], sizeof(values[4]), "%lu", (unsigned long)bus.failures());
+  snprintf(values[5], sizeof(values[5]), "%lu", (unsigned long)bus.rejected());
+  snprintf(values[6], sizeof(values[6]), "%lu", (unsigned long)bus.overflows());
+  snprintf(values[7], sizeof(values[7]), "%u", (unsigned)usage.device_us[imuBusDevice]);
+  snprintf(values[8], sizeof(values[8]), "%u", (unsigned)usage.device_us[magBusDevice]);
+  snprintf(values[9], sizeof(values[9]), "%u", (unsigned)usage.device_us[odriveBusDevice]);
+  for (int i = 0; i < 10; ++i) {
+    keyValues[i].key = keys[i];
+    keyValues[i].value = values[i];
+  }
+
+  // max_permille is over the publish period, so a single crowded tick shows
+  bool busy = usage.max_permille > I2C_BUSY_WARN_PERMILLE;
+  status.level = busy ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = name;
+  status.message = busy ? "bus near full within a tick" : "";
+  status.hardware_id = "teensy";
+  status.values_length = 10;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_TELEMETRY, diagnostics, &profileArray);
+}
+#endif
+
+#if defined(ODRIVE_FAULT_RECOVERY)
+void publishFaultState() {
+  static const char* const keys[7] = {"axis0", "axis1", "odrive", "recoveries", "faults", "last_recovery_ms", "max_recovery_ms"};
+  static char values[4][12];
+  static char faultText[3][40];
+  diagnostic_msgs::KeyValue keyValues[7];
+  diagnostic_msgs::DiagnosticStatus status;
+
+  // the units move on in controlStep()
+  ODriveFaultManager::State state[3];
+  ODriveErrorMonitor::Register faultReg[3];
+  uint64_t faultBits[3];
+  noInterrupts();
+  for (int unit = 0; unit < 3; ++unit) {
+    state[unit] = faultManager.state(unit);
+    faultReg[unit] = faultManager.faultRegister(unit);
+    faultBits[unit] = faultManager.faultBits(unit);
+  }
+  uint32_t recoveries = faultManager.recoveries(), faults = faultManager.faults();
+  uint32_t last_us = faultManager.lastRecovery_us(), max_us = faultManager.maxRecovery_us();
+  interrupts();
+
+  bool faulted = false;
+  for (int unit = 0; unit < 3; ++unit) {
+    keyValues[unit].key = keys[unit];
+    if (state[unit] == ODriveFaultManager::FAULTED) {
+      // the register that latched it and its critical bits, e.g. "faulted motor.error 0x8"
+      int axis;
+      snprintf(faultText[unit], sizeof(faultText[unit]), "faulted %s 0x%llx",
+               ODriveErrorMonitor::property(faultReg[unit], axis), (unsigned long long)faultBits[unit]);
+      keyValues[unit].value = faultText[unit];
+      faulted = true;
+    } else {
+      keyValues[unit].value = ODriveFaultManager::name(state[unit]);
+    }
+  }
+  snprintf(values[0], sizeof(values[0]), "%lu", (unsigned long)recoveries);
+  snprintf(values[1], sizeof(values[1]), "%lu", (unsigned long)faults);
+  snprintf(values[2], sizeof(values[2]), "%.1f", last_us * 1e-3f);
+  snprintf(values[3], sizeof(values[3]), "%.1f", max_us * 1e-3f);
+  for (int i = 0; i < 4; ++i) {
+    keyValues[3 + i].key = keys[3 + i];
+    keyValues[3 + i].value = values[i];
+  }
+
+  status.level = faulted ? diagnostic_msgs::DiagnosticStatus::ERROR : diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "odrive_faults";
+  status.message = faulted ? "a critical ODrive error needs a clear and recalibration" : "";
+  status.hardware_id = "teensy";
+  status.values_length = 7;
+  status.values = keyValues;
+  HEALTH_LEVEL(status);
+
+  profileArray.header.stamp = nh.now();
+  profileArray.status_length = 1;
+  profileArray.status = &status;
+  linkPublish(LINK_STATUS, diagnostics, &profileArray);
+}
+#endif